@@ -485,6 +485,7 @@ static int kvm_create_vcpu(CPUState *cpu)
         cpu->vcpu_dirty = true;
     }
     cpu->dirty_pages = 0;
+    cpu->dirty_ring_full_exits = 0;
     cpu->throttle_us_per_full = 0;
 
     trace_kvm_create_vcpu(cpu->cpu_index, vcpu_id, kvm_fd);
@@ -947,8 +948,9 @@ static uint64_t kvm_dirty_ring_reap_locked(KVMState *s, CPUState* cpu)
 }
 
 /*
- * Currently for simplicity, we must hold BQL before calling this.  We can
- * consider to drop the BQL if we're clear with all the race conditions.
+ * Currently for simplicity, we must hold BQL before calling this to reap
+ * all rings.  Reaping the ring of a single vCPU only relies on the slots
+ * lock, which serializes it against every other reaper.
  */
 static uint64_t kvm_dirty_ring_reap(KVMState *s, CPUState *cpu)
 {
@@ -3273,19 +3275,17 @@ int kvm_cpu_exec(CPUState *cpu)
              * still full.  Got kicked by KVM_RESET_DIRTY_RINGS.
              */
             trace_kvm_dirty_ring_full(cpu->cpu_index);
-            bql_lock();
+            cpu->dirty_ring_full_exits++;
             /*
-             * We throttle vCPU by making it sleep once it exit from kernel
-             * due to dirty ring full. In the dirtylimit scenario, reaping
-             * all vCPUs after a single vCPU dirty ring get full result in
-             * the miss of sleep, so just reap the ring-fulled vCPU.
+             * Reap only the ring that filled up, from this vCPU's own
+             * thread and without the BQL.  Reaping every vCPU here made
+             * each full ring pay for all the others and, with many vCPUs
+             * writing at once, serialized them all on the BQL.  Other
+             * rings are reaped by their own full exits or by the reaper
+             * thread.  This also keeps the dirtylimit throttle, which
+             * relies on every vCPU hitting its own full exit.
              */
-            if (dirtylimit_in_service()) {
-                kvm_dirty_ring_reap(kvm_state, cpu);
-            } else {
-                kvm_dirty_ring_reap(kvm_state, NULL);
-            }
-            bql_unlock();
+            kvm_dirty_ring_reap(kvm_state, cpu);
             dirtylimit_vcpu_execute(cpu);
             ret = 0;
             break;
@@ -4219,6 +4219,40 @@ exit:
     return list;
 }
 
+/*
+ * Per-vCPU dirty ring counters kept by QEMU rather than the kernel; they
+ * are reported next to the kernel's vCPU statistics.
+ */
+static StatsList *add_dirty_ring_stat(StatsList *list, strList *names,
+                                      const char *name, uint64_t value)
+{
+    Stats *stats;
+
+    if (!apply_str_list_filter(name, names)) {
+        return list;
+    }
+
+    stats = g_new0(Stats, 1);
+    stats->name = g_strdup(name);
+    stats->value = g_new0(StatsValue, 1);
+    stats->value->type = QTYPE_QNUM;
+    stats->value->u.scalar = value;
+
+    QAPI_LIST_PREPEND(list, stats);
+    return list;
+}
+
+static StatsSchemaValueList *add_dirty_ring_schema(StatsSchemaValueList *list,
+                                                   const char *name)
+{
+    StatsSchemaValue *value = g_new0(StatsSchemaValue, 1);
+
+    value->name = g_strdup(name);
+    value->type = STATS_TYPE_CUMULATIVE;
+    QAPI_LIST_PREPEND(list, value);
+    return list;
+}
+
 /* Cached stats descriptors */
 typedef struct StatsDescriptors {
     const char *ident; /* cache key, currently the StatsTarget */
@@ -4335,6 +4369,15 @@ static void query_stats(StatsResultList **result, StatsTarget target,
         stats_list = add_kvmstat_entry(pdesc, stats, stats_list, errp);
     }
 
+    if (target == STATS_TARGET_VCPU && kvm_dirty_ring_enabled()) {
+        stats_list = add_dirty_ring_stat(stats_list, names,
+                                         "dirty_ring_full_exits",
+                                         cpu->dirty_ring_full_exits);
+        stats_list = add_dirty_ring_stat(stats_list, names,
+                                         "dirty_ring_pages",
+                                         cpu->dirty_pages);
+    }
+
     if (!stats_list) {
         return;
     }
@@ -4379,6 +4422,12 @@ static void query_stats_schema(StatsSchemaList **result, StatsTarget target,
         stats_list = add_kvmschema_entry(pdesc, stats_list, errp);
     }
 
+    if (target == STATS_TARGET_VCPU && kvm_dirty_ring_enabled()) {
+        stats_list = add_dirty_ring_schema(stats_list,
+                                           "dirty_ring_full_exits");
+        stats_list = add_dirty_ring_schema(stats_list, "dirty_ring_pages");
+    }
+
     add_stats_schema(result, STATS_PROVIDER_KVM, target, stats_list);
 }
 
@@ -47,6 +47,8 @@
 #include "tb-internal.h"
 #include "internal-common.h"
 
+unsigned int tb_jmp_cache_bits = TB_JMP_CACHE_BITS;
+
 /* -icount align implementation. */
 
 typedef struct SyncClocks {
@@ -210,6 +212,33 @@ static TranslationBlock *tb_htable_lookup(CPUState *cpu, TCGTBCPUState s)
     return qht_lookup_custom(&tb_ctx.htable, &desc, h, tb_lookup_cmp);
 }
 
+static inline bool tb_jmp_cache_match(CPUJumpCache *jc, uint32_t hash,
+                                      TranslationBlock *tb, TCGTBCPUState s)
+{
+    return tb &&
+           jc->array[hash].pc == s.pc &&
+           tb->cs_base == s.cs_base &&
+           tb->flags == s.flags &&
+           tb_cflags(tb) == s.cflags;
+}
+
+/*
+ * Insert @tb at @hash, moving the previous entry to the other way of
+ * the set so that two TBs whose PCs collide can both stay cached.
+ */
+static inline void tb_jmp_cache_insert(CPUJumpCache *jc, uint32_t hash,
+                                       vaddr pc, TranslationBlock *tb)
+{
+    TranslationBlock *old = qatomic_read(&jc->array[hash].tb);
+
+    if (old && old != tb) {
+        jc->array[hash ^ 1].pc = jc->array[hash].pc;
+        qatomic_set(&jc->array[hash ^ 1].tb, old);
+    }
+    jc->array[hash].pc = pc;
+    qatomic_set(&jc->array[hash].tb, tb);
+}
+
 /**
  * tb_lookup:
  * @cpu: CPU that will execute the returned translation block
@@ -233,25 +262,28 @@ static inline TranslationBlock *tb_lookup(CPUState *cpu, TCGTBCPUState s)
     /* we should never be trying to look up an INVALID tb */
     tcg_debug_assert(!(s.cflags & CF_INVALID));
 
-    hash = tb_jmp_cache_hash_func(s.pc);
     jc = cpu->tb_jmp_cache;
+    hash = tb_jmp_cache_hash_func(jc, s.pc);
 
     tb = qatomic_read(&jc->array[hash].tb);
-    if (likely(tb &&
-               jc->array[hash].pc == s.pc &&
-               tb->cs_base == s.cs_base &&
-               tb->flags == s.flags &&
-               tb_cflags(tb) == s.cflags)) {
+    if (likely(tb_jmp_cache_match(jc, hash, tb, s))) {
+        tb_jmp_cache_stat_inc(&jc->stats.hits);
+        goto hit;
+    }
+    tb = qatomic_read(&jc->array[hash ^ 1].tb);
+    if (tb_jmp_cache_match(jc, hash ^ 1, tb, s)) {
+        tb_jmp_cache_stat_inc(&jc->stats.hits);
         goto hit;
     }
 
+    tb_jmp_cache_stat_inc(&jc->stats.htable_lookups);
     tb = tb_htable_lookup(cpu, s);
     if (tb == NULL) {
         return NULL;
     }
 
-    jc->array[hash].pc = s.pc;
-    qatomic_set(&jc->array[hash].tb, tb);
+    tb_jmp_cache_stat_inc(&jc->stats.htable_hits);
+    tb_jmp_cache_insert(jc, hash, s.pc, tb);
 
 hit:
     /*
@@ -966,7 +998,6 @@ cpu_exec_loop(CPUState *cpu, SyncClocks *sc)
             tb = tb_lookup(cpu, s);
             if (tb == NULL) {
                 CPUJumpCache *jc;
-                uint32_t h;
 
                 mmap_lock();
                 tb = tb_gen_code(cpu, s);
@@ -976,10 +1007,9 @@ cpu_exec_loop(CPUState *cpu, SyncClocks *sc)
                  * We add the TB in the virtual pc hash table
                  * for the fast lookup
                  */
-                h = tb_jmp_cache_hash_func(s.pc);
                 jc = cpu->tb_jmp_cache;
-                jc->array[h].pc = s.pc;
-                qatomic_set(&jc->array[h].tb, tb);
+                tb_jmp_cache_insert(jc, tb_jmp_cache_hash_func(jc, s.pc),
+                                    s.pc, tb);
             }
 
 #ifndef CONFIG_USER_ONLY
@@ -1067,7 +1097,10 @@ bool tcg_exec_realizefn(CPUState *cpu, Error **errp)
         tcg_target_initialized = true;
     }
 
-    cpu->tb_jmp_cache = g_new0(CPUJumpCache, 1);
+    cpu->tb_jmp_cache = g_malloc0(sizeof(CPUJumpCache) +
+                                  sizeof(cpu->tb_jmp_cache->array[0]) *
+                                  ((size_t)1 << tb_jmp_cache_bits));
+    cpu->tb_jmp_cache->bits = tb_jmp_cache_bits;
     tlb_init(cpu);
 #ifndef CONFIG_USER_ONLY
     tcg_iommu_init_notifier_list(cpu);
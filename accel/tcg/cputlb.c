@@ -123,6 +123,21 @@ static inline uint64_t tlb_addr_write(const CPUTLBEntry *entry)
     return tlb_read_idx(entry, MMU_DATA_STORE);
 }
 
+/* Number of entries in newly created victim tlbs */
+size_t tlb_vtlb_size = CPU_VTLB_SIZE;
+
+static inline size_t tlb_vtlb_n_entries(const CPUTLBDesc *desc)
+{
+    return desc->vtlb_sets * CPU_VTLB_WAYS;
+}
+
+/* Return the index of the first way of the victim tlb set for @page.  */
+static inline size_t tlb_vtlb_set(const CPUTLBDesc *desc, vaddr page)
+{
+    return ((page >> TARGET_PAGE_BITS) & (desc->vtlb_sets - 1)) *
+           CPU_VTLB_WAYS;
+}
+
 /* Find the TLB index corresponding to the mmu_idx + address pair.  */
 static inline uintptr_t tlb_index(CPUState *cpu, uintptr_t mmu_idx,
                                   vaddr addr)
@@ -155,7 +170,7 @@ static void tb_jmp_cache_clear_page(CPUState *cpu, vaddr page_addr)
         return;
     }
 
-    i0 = tb_jmp_cache_hash_page(page_addr);
+    i0 = tb_jmp_cache_hash_page(jc, page_addr);
     for (i = 0; i < TB_JMP_PAGE_SIZE; i++) {
         qatomic_set(&jc->array[i0 + i].tb, NULL);
     }
@@ -276,14 +291,26 @@ static void tlb_mmu_resize_locked(CPUTLBDesc *desc, CPUTLBDescFast *fast,
     }
 }
 
+static void tlb_large_pages_clear(CPUTLBDesc *desc)
+{
+    IntervalTreeNode *n;
+
+    while ((n = interval_tree_iter_first(&desc->large_pages, 0, -1))) {
+        interval_tree_remove(n, &desc->large_pages);
+        g_free(n);
+    }
+    desc->n_large_pages = 0;
+}
+
 static void tlb_mmu_flush_locked(CPUTLBDesc *desc, CPUTLBDescFast *fast)
 {
     desc->n_used_entries = 0;
+    tlb_large_pages_clear(desc);
     desc->large_page_addr = -1;
     desc->large_page_mask = -1;
     desc->vindex = 0;
     memset(fast->table, -1, sizeof_tlb(fast));
-    memset(desc->vtable, -1, sizeof(desc->vtable));
+    memset(desc->vtable, -1, sizeof(CPUTLBEntry) * tlb_vtlb_n_entries(desc));
 }
 
 static void tlb_flush_one_mmuidx_locked(CPUState *cpu, int mmu_idx,
@@ -305,6 +332,9 @@ static void tlb_mmu_init(CPUTLBDesc *desc, CPUTLBDescFast *fast, int64_t now)
     fast->mask = (n_entries - 1) << CPU_TLB_ENTRY_BITS;
     fast->table = g_new(CPUTLBEntry, n_entries);
     desc->fulltlb = g_new(CPUTLBEntryFull, n_entries);
+    desc->vtlb_sets = tlb_vtlb_size / CPU_VTLB_WAYS;
+    desc->vtable = g_new(CPUTLBEntry, tlb_vtlb_n_entries(desc));
+    desc->vfulltlb = g_new(CPUTLBEntryFull, tlb_vtlb_n_entries(desc));
     tlb_mmu_flush_locked(desc, fast);
 }
 
@@ -344,9 +374,32 @@ void tlb_destroy(CPUState *cpu)
 
         g_free(fast->table);
         g_free(desc->fulltlb);
+        g_free(desc->vtable);
+        g_free(desc->vfulltlb);
+        tlb_large_pages_clear(desc);
     }
 }
 
+/*
+ * tlb_flush_is_pending: return true if a flush of all of @idxmap is already
+ * queued on @cpu and has not started yet.
+ *
+ * Such a flush runs after any work queued now, so it also covers requests
+ * for a subset of the same mmu indexes (single pages or ranges).  Once the
+ * queued work has claimed the pending bits they read as zero again, so a
+ * request racing with it is never dropped.
+ */
+static bool tlb_flush_is_pending(CPUState *cpu, MMUIdxMap idxmap)
+{
+    MMUIdxMap pending = qatomic_read(&cpu->neg.tlb.c.pending_flush);
+
+    if ((pending & idxmap) == idxmap) {
+        qatomic_inc(&cpu->neg.tlb.c.coalesced_flush_count);
+        return true;
+    }
+    return false;
+}
+
 /* flush_all_helper: run fn across all cpus
  *
  * If the wait flag is set then the src cpu's helper will be queued as
@@ -355,12 +408,12 @@ void tlb_destroy(CPUState *cpu)
  * again.
  */
 static void flush_all_helper(CPUState *src, run_on_cpu_func fn,
-                             run_on_cpu_data d)
+                             run_on_cpu_data d, MMUIdxMap idxmap)
 {
     CPUState *cpu;
 
     CPU_FOREACH(cpu) {
-        if (cpu != src) {
+        if (cpu != src && !tlb_flush_is_pending(cpu, idxmap)) {
             async_run_on_cpu(cpu, fn, d);
         }
     }
@@ -406,6 +459,32 @@ static void tlb_flush_by_mmuidx_async_work(CPUState *cpu, run_on_cpu_data data)
     }
 }
 
+/*
+ * Run the flushes requested by other cpus since the work item was queued.
+ * Claiming the bits first means that any request arriving afterwards
+ * queues a new work item rather than being merged into this one.
+ */
+static void tlb_flush_pending_async_work(CPUState *cpu, run_on_cpu_data data)
+{
+    MMUIdxMap idxmap = qatomic_xchg(&cpu->neg.tlb.c.pending_flush, 0);
+
+    tlb_flush_by_mmuidx_async_work(cpu, RUN_ON_CPU_HOST_INT(idxmap));
+}
+
+/*
+ * Flush @idxmap on another cpu, merging with a flush that is already
+ * queued there.  Under heavy broadcast invalidation (e.g. Arm TLBI IS)
+ * this bounds the work queued on each cpu to one item.
+ */
+static void tlb_flush_by_mmuidx_queue(CPUState *cpu, MMUIdxMap idxmap)
+{
+    if (qatomic_fetch_or(&cpu->neg.tlb.c.pending_flush, idxmap)) {
+        qatomic_inc(&cpu->neg.tlb.c.coalesced_flush_count);
+        return;
+    }
+    async_run_on_cpu(cpu, tlb_flush_pending_async_work, RUN_ON_CPU_NULL);
+}
+
 void tlb_flush_by_mmuidx(CPUState *cpu, MMUIdxMap idxmap)
 {
     tlb_debug("mmu_idx: 0x%" PRIx16 "\n", idxmap);
@@ -422,12 +501,17 @@ void tlb_flush(CPUState *cpu)
 
 void tlb_flush_by_mmuidx_all_cpus_synced(CPUState *src_cpu, MMUIdxMap idxmap)
 {
-    const run_on_cpu_func fn = tlb_flush_by_mmuidx_async_work;
+    CPUState *dst_cpu;
 
     tlb_debug("mmu_idx: 0x%"PRIx16"\n", idxmap);
 
-    flush_all_helper(src_cpu, fn, RUN_ON_CPU_HOST_INT(idxmap));
-    async_safe_run_on_cpu(src_cpu, fn, RUN_ON_CPU_HOST_INT(idxmap));
+    CPU_FOREACH(dst_cpu) {
+        if (dst_cpu != src_cpu) {
+            tlb_flush_by_mmuidx_queue(dst_cpu, idxmap);
+        }
+    }
+    async_safe_run_on_cpu(src_cpu, tlb_flush_by_mmuidx_async_work,
+                          RUN_ON_CPU_HOST_INT(idxmap));
 }
 
 void tlb_flush_all_cpus_synced(CPUState *src_cpu)
@@ -460,6 +544,22 @@ static inline bool tlb_entry_is_empty(const CPUTLBEntry *te)
     return te->addr_read == -1 && te->addr_write == -1 && te->addr_code == -1;
 }
 
+/*
+ * tlb_entry_page - return the page mapped by a non-empty entry
+ * @te: pointer to CPUTLBEntry
+ */
+static vaddr tlb_entry_page(const CPUTLBEntry *te)
+{
+    for (int i = 0; i < MMU_ACCESS_COUNT; i++) {
+        uint64_t cmp = tlb_read_idx(te, i);
+
+        if (cmp != -1) {
+            return cmp & TARGET_PAGE_MASK;
+        }
+    }
+    return -1;
+}
+
 /* Called with tlb_c.lock held */
 static bool tlb_flush_entry_mask_locked(CPUTLBEntry *tlb_entry,
                                         vaddr page,
@@ -483,10 +583,20 @@ static void tlb_flush_vtlb_page_mask_locked(CPUState *cpu, int mmu_idx,
                                             vaddr mask)
 {
     CPUTLBDesc *d = &cpu->neg.tlb.d[mmu_idx];
-    int k;
+    size_t k, first, last;
 
     assert_cpu_is_self(cpu);
-    for (k = 0; k < CPU_VTLB_SIZE; k++) {
+
+    /* A single page can only be in its own set */
+    if (mask == -1) {
+        first = tlb_vtlb_set(d, page);
+        last = first + CPU_VTLB_WAYS;
+    } else {
+        first = 0;
+        last = tlb_vtlb_n_entries(d);
+    }
+
+    for (k = first; k < last; k++) {
         if (tlb_flush_entry_mask_locked(&d->vtable[k], page, mask)) {
             tlb_n_used_entries_dec(cpu, mmu_idx);
         }
@@ -499,16 +609,74 @@ static inline void tlb_flush_vtlb_page_locked(CPUState *cpu, int mmu_idx,
     tlb_flush_vtlb_page_mask_locked(cpu, mmu_idx, page, -1);
 }
 
-static void tlb_flush_page_locked(CPUState *cpu, int midx, vaddr page)
+/*
+ * Flush the entries for every page of the large page at @start, which
+ * is @size bytes long and naturally aligned.
+ */
+static void tlb_flush_large_page_locked(CPUState *cpu, int midx,
+                                        vaddr start, uint64_t size)
 {
-    vaddr lp_addr = cpu->neg.tlb.d[midx].large_page_addr;
-    vaddr lp_mask = cpu->neg.tlb.d[midx].large_page_mask;
+    CPUTLBDescFast *f = cpu_tlb_fast(cpu, midx);
+    size_t n = tlb_n_entries(f);
+    vaddr mask = ~(vaddr)(size - 1);
+
+    if (size / TARGET_PAGE_SIZE <= n) {
+        for (vaddr i = 0; i < size; i += TARGET_PAGE_SIZE) {
+            if (tlb_flush_entry_locked(tlb_entry(cpu, midx, start + i),
+                                       start + i)) {
+                tlb_n_used_entries_dec(cpu, midx);
+            }
+        }
+    } else {
+        /* Fewer entries in the tlb than pages in the large page */
+        for (size_t i = 0; i < n; i++) {
+            if (tlb_flush_entry_mask_locked(&f->table[i], start, mask)) {
+                tlb_n_used_entries_dec(cpu, midx);
+            }
+        }
+    }
+    tlb_flush_vtlb_page_mask_locked(cpu, midx, start, mask);
+}
+
+/*
+ * Flush the tracked large pages that overlap [@start, @last].
+ * Returns false if the overflow region overlaps too, in which case
+ * the whole tlb needs to be flushed.
+ */
+static bool tlb_flush_large_pages_locked(CPUState *cpu, int midx,
+                                         vaddr start, vaddr last)
+{
+    CPUTLBDesc *d = &cpu->neg.tlb.d[midx];
+    IntervalTreeNode *n;
 
+    /* The overflow region is naturally aligned, so test both ends */
+    if ((start & d->large_page_mask) == d->large_page_addr ||
+        (last & d->large_page_mask) == d->large_page_addr) {
+        return false;
+    }
+
+    while ((n = interval_tree_iter_first(&d->large_pages, start, last))) {
+        tlb_debug("flushing large page midx %d (%016" VADDR_PRIx
+                  "+%016" PRIx64 ")\n", midx, (vaddr)n->start,
+                  n->last - n->start + 1);
+        tlb_flush_large_page_locked(cpu, midx, n->start,
+                                    n->last - n->start + 1);
+        interval_tree_remove(n, &d->large_pages);
+        d->n_large_pages--;
+        g_free(n);
+    }
+    return true;
+}
+
+static void tlb_flush_page_locked(CPUState *cpu, int midx, vaddr page)
+{
     /* Check if we need to flush due to large pages.  */
-    if ((page & lp_mask) == lp_addr) {
+    if (!tlb_flush_large_pages_locked(cpu, midx, page,
+                                      page + TARGET_PAGE_SIZE - 1)) {
         tlb_debug("forcing full flush midx %d (%016"
                   VADDR_PRIx "/%016" VADDR_PRIx ")\n",
-                  midx, lp_addr, lp_mask);
+                  midx, cpu->neg.tlb.d[midx].large_page_addr,
+                  cpu->neg.tlb.d[midx].large_page_mask);
         tlb_flush_one_mmuidx_locked(cpu, midx, get_clock_realtime());
     } else {
         if (tlb_flush_entry_locked(tlb_entry(cpu, midx, page), page)) {
@@ -629,7 +797,7 @@ void tlb_flush_page_by_mmuidx_all_cpus_synced(CPUState *src_cpu,
      */
     if (idxmap < TARGET_PAGE_SIZE) {
         flush_all_helper(src_cpu, tlb_flush_page_by_mmuidx_async_1,
-                         RUN_ON_CPU_TARGET_PTR(addr | idxmap));
+                         RUN_ON_CPU_TARGET_PTR(addr | idxmap), idxmap);
         async_safe_run_on_cpu(src_cpu, tlb_flush_page_by_mmuidx_async_1,
                               RUN_ON_CPU_TARGET_PTR(addr | idxmap));
     } else {
@@ -638,7 +806,7 @@ void tlb_flush_page_by_mmuidx_all_cpus_synced(CPUState *src_cpu,
 
         /* Allocate a separate data block for each destination cpu.  */
         CPU_FOREACH(dst_cpu) {
-            if (dst_cpu != src_cpu) {
+            if (dst_cpu != src_cpu && !tlb_flush_is_pending(dst_cpu, idxmap)) {
                 d = g_new(TLBFlushPageByMMUIdxData, 1);
                 d->addr = addr;
                 d->idxmap = idxmap;
@@ -686,12 +854,8 @@ static void tlb_flush_range_locked(CPUState *cpu, int midx,
         return;
     }
 
-    /*
-     * Check if we need to flush due to large pages.
-     * Because large_page_mask contains all 1's from the msb,
-     * we only need to test the end of the range.
-     */
-    if (((addr + len - 1) & d->large_page_mask) == d->large_page_addr) {
+    /* Check if we need to flush due to large pages.  */
+    if (!tlb_flush_large_pages_locked(cpu, midx, addr, addr + len - 1)) {
         tlb_debug("forcing full flush midx %d ("
                   "%016" VADDR_PRIx "/%016" VADDR_PRIx ")\n",
                   midx, d->large_page_addr, d->large_page_mask);
@@ -831,7 +995,7 @@ void tlb_flush_range_by_mmuidx_all_cpus_synced(CPUState *src_cpu,
 
     /* Allocate a separate data block for each destination cpu.  */
     CPU_FOREACH(dst_cpu) {
-        if (dst_cpu != src_cpu) {
+        if (dst_cpu != src_cpu && !tlb_flush_is_pending(dst_cpu, idxmap)) {
             p = g_memdup(&d, sizeof(d));
             async_run_on_cpu(dst_cpu, tlb_flush_range_by_mmuidx_async_1,
                              RUN_ON_CPU_HOST_PTR(p));
@@ -930,7 +1094,8 @@ void tlb_reset_dirty(CPUState *cpu, uintptr_t start, uintptr_t length)
                                          start, length);
         }
 
-        for (i = 0; i < CPU_VTLB_SIZE; i++) {
+        n = tlb_vtlb_n_entries(desc);
+        for (i = 0; i < n; i++) {
             tlb_reset_dirty_range_locked(&desc->vfulltlb[i], &desc->vtable[i],
                                          start, length);
         }
@@ -962,9 +1127,11 @@ static void tlb_set_dirty(CPUState *cpu, vaddr addr)
     }
 
     for (mmu_idx = 0; mmu_idx < NB_MMU_MODES; mmu_idx++) {
-        int k;
-        for (k = 0; k < CPU_VTLB_SIZE; k++) {
-            tlb_set_dirty1_locked(&cpu->neg.tlb.d[mmu_idx].vtable[k], addr);
+        CPUTLBDesc *desc = &cpu->neg.tlb.d[mmu_idx];
+        size_t k, first = tlb_vtlb_set(desc, addr);
+
+        for (k = first; k < first + CPU_VTLB_WAYS; k++) {
+            tlb_set_dirty1_locked(&desc->vtable[k], addr);
         }
     }
     qemu_spin_unlock(&cpu->neg.tlb.c.lock);
@@ -975,8 +1142,25 @@ static void tlb_set_dirty(CPUState *cpu, vaddr addr)
 static void tlb_add_large_page(CPUState *cpu, int mmu_idx,
                                vaddr addr, uint64_t size)
 {
-    vaddr lp_addr = cpu->neg.tlb.d[mmu_idx].large_page_addr;
+    CPUTLBDesc *d = &cpu->neg.tlb.d[mmu_idx];
+    vaddr lp_addr = d->large_page_addr;
     vaddr lp_mask = ~(size - 1);
+    IntervalTreeNode *n;
+
+    addr &= lp_mask;
+    n = interval_tree_iter_first(&d->large_pages, addr, addr + size - 1);
+    if (n && n->start <= addr && n->last >= addr + size - 1) {
+        /* Already tracked, e.g. another small page of the same large page */
+        return;
+    }
+    if (d->n_large_pages < CPU_TLB_MAX_LARGE_PAGES) {
+        n = g_new0(IntervalTreeNode, 1);
+        n->start = addr;
+        n->last = addr + size - 1;
+        interval_tree_insert(n, &d->large_pages);
+        d->n_large_pages++;
+        return;
+    }
 
     if (lp_addr == (vaddr)-1) {
         /* No previous large page.  */
@@ -1127,7 +1311,8 @@ void tlb_set_page_full(CPUState *cpu, int mmu_idx,
      * different page; otherwise just overwrite the stale data.
      */
     if (!tlb_hit_page_anyprot(te, addr_page) && !tlb_entry_is_empty(te)) {
-        unsigned vidx = desc->vindex++ % CPU_VTLB_SIZE;
+        size_t vidx = tlb_vtlb_set(desc, tlb_entry_page(te)) +
+                      desc->vindex++ % CPU_VTLB_WAYS;
         CPUTLBEntry *tv = &desc->vtable[vidx];
 
         /* Evict the old entry into the victim tlb.  */
@@ -1305,11 +1490,12 @@ static void io_failed(CPUState *cpu, CPUTLBEntryFull *full, vaddr addr,
 static bool victim_tlb_hit(CPUState *cpu, size_t mmu_idx, size_t index,
                            MMUAccessType access_type, vaddr page)
 {
-    size_t vidx;
+    CPUTLBDesc *desc = &cpu->neg.tlb.d[mmu_idx];
+    size_t vidx, first = tlb_vtlb_set(desc, page);
 
     assert_cpu_is_self(cpu);
-    for (vidx = 0; vidx < CPU_VTLB_SIZE; ++vidx) {
-        CPUTLBEntry *vtlb = &cpu->neg.tlb.d[mmu_idx].vtable[vidx];
+    for (vidx = first; vidx < first + CPU_VTLB_WAYS; ++vidx) {
+        CPUTLBEntry *vtlb = &desc->vtable[vidx];
         uint64_t cmp = tlb_read_idx(vtlb, access_type);
 
         if (cmp == page) {
@@ -1326,9 +1512,12 @@ static bool victim_tlb_hit(CPUState *cpu, size_t mmu_idx, size_t index,
             CPUTLBEntryFull *f2 = &cpu->neg.tlb.d[mmu_idx].vfulltlb[vidx];
             CPUTLBEntryFull tmpf;
             tmpf = *f1; *f1 = *f2; *f2 = tmpf;
+            qatomic_set(&desc->victim_hit_count,
+                        desc->victim_hit_count + 1);
             return true;
         }
     }
+    qatomic_set(&desc->fill_count, desc->fill_count + 1);
     return false;
 }
 
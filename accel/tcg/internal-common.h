@@ -55,6 +55,9 @@ TranslationBlock *tb_link_page(TranslationBlock *tb);
 void cpu_restore_state_from_tb(CPUState *cpu, TranslationBlock *tb,
                                uintptr_t host_pc);
 
+/* Number of victim TLB entries for each MMU mode of new CPUs */
+extern size_t tlb_vtlb_size;
+
 /**
  * tlb_init - initialize a CPU's TLB
  * @cpu: CPU whose TLB should be initialized
@@ -11,9 +11,13 @@
 #include "qapi/type-helpers.h"
 #include "qapi/qapi-commands-machine.h"
 #include "monitor/monitor.h"
+#include "system/stats.h"
 #include "system/tcg.h"
+#include "hw/core/cpu.h"
 #include "tcg/tcg.h"
 #include "internal-common.h"
+#include "tb-context.h"
+#include "tb-jmp-cache.h"
 
 HumanReadableText *qmp_x_query_jit(Error **errp)
 {
@@ -29,9 +33,160 @@ HumanReadableText *qmp_x_query_jit(Error **errp)
     return human_readable_text_from_str(buf);
 }
 
+static StatsList *tcg_stats_add(StatsList *list, strList *names,
+                                const char *name, uint64_t value)
+{
+    Stats *stats;
+
+    if (!apply_str_list_filter(name, names)) {
+        return list;
+    }
+
+    stats = g_new0(Stats, 1);
+    stats->name = g_strdup(name);
+    stats->value = g_new0(StatsValue, 1);
+    stats->value->type = QTYPE_QNUM;
+    stats->value->u.scalar = value;
+
+    QAPI_LIST_PREPEND(list, stats);
+    return list;
+}
+
+/* One value for each MMU mode, mmu_idx 0 first */
+static StatsList *tcg_stats_add_tlb(StatsList *list, strList *names,
+                                    const char *name, CPUState *cpu,
+                                    size_t offset)
+{
+    uint64List *values = NULL;
+    Stats *stats;
+    int i;
+
+    if (!apply_str_list_filter(name, names)) {
+        return list;
+    }
+
+    for (i = NB_MMU_MODES - 1; i >= 0; i--) {
+        size_t *counter = (void *)&cpu->neg.tlb.d[i] + offset;
+
+        QAPI_LIST_PREPEND(values, qatomic_read(counter));
+    }
+
+    stats = g_new0(Stats, 1);
+    stats->name = g_strdup(name);
+    stats->value = g_new0(StatsValue, 1);
+    stats->value->type = QTYPE_QLIST;
+    stats->value->u.list = values;
+
+    QAPI_LIST_PREPEND(list, stats);
+    return list;
+}
+
+static void tcg_stats_vcpu(StatsResultList **result, CPUState *cpu,
+                           strList *names)
+{
+    CPUJumpCache *jc = cpu->tb_jmp_cache;
+    CPUJumpCacheStats *st;
+    StatsList *stats_list = NULL;
+
+    if (!jc) {
+        return;
+    }
+
+    st = &jc->stats;
+    stats_list = tcg_stats_add_tlb(stats_list, names, "tlb-fills", cpu,
+                                   offsetof(CPUTLBDesc, fill_count));
+    stats_list = tcg_stats_add_tlb(stats_list, names, "tlb-victim-hits", cpu,
+                                   offsetof(CPUTLBDesc, victim_hit_count));
+    stats_list = tcg_stats_add(stats_list, names, "code-buffer-full",
+                               qatomic_read(&st->buffer_full));
+    stats_list = tcg_stats_add(stats_list, names, "translations",
+                               qatomic_read(&st->translations));
+    stats_list = tcg_stats_add(stats_list, names, "htable-hits",
+                               qatomic_read(&st->htable_hits));
+    stats_list = tcg_stats_add(stats_list, names, "htable-lookups",
+                               qatomic_read(&st->htable_lookups));
+    stats_list = tcg_stats_add(stats_list, names, "jmp-cache-hits",
+                               qatomic_read(&st->hits));
+
+    if (stats_list) {
+        add_stats_entry(result, STATS_PROVIDER_TCG,
+                        cpu->parent_obj.canonical_path, stats_list);
+    }
+}
+
+static void tcg_stats_cb(StatsResultList **result, StatsTarget target,
+                         strList *names, strList *targets, Error **errp)
+{
+    StatsList *stats_list = NULL;
+    CPUState *cpu;
+
+    if (!tcg_enabled()) {
+        return;
+    }
+
+    switch (target) {
+    case STATS_TARGET_VM:
+        stats_list = tcg_stats_add(stats_list, names, "tb-flushes",
+                                   qatomic_read(&tb_ctx.tb_flush_count));
+        stats_list = tcg_stats_add(stats_list, names, "smc-filtered",
+                                   qatomic_read(&tb_ctx.tb_smc_filtered_count));
+        if (stats_list) {
+            add_stats_entry(result, STATS_PROVIDER_TCG, NULL, stats_list);
+        }
+        break;
+    case STATS_TARGET_VCPU:
+        CPU_FOREACH(cpu) {
+            if (!apply_str_list_filter(cpu->parent_obj.canonical_path,
+                                       targets)) {
+                continue;
+            }
+            tcg_stats_vcpu(result, cpu, names);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static StatsSchemaValueList *tcg_schema_add(StatsSchemaValueList *list,
+                                            const char *name)
+{
+    StatsSchemaValue *value = g_new0(StatsSchemaValue, 1);
+
+    value->name = g_strdup(name);
+    value->type = STATS_TYPE_CUMULATIVE;
+    QAPI_LIST_PREPEND(list, value);
+    return list;
+}
+
+static void tcg_stats_schemas_cb(StatsSchemaList **result, Error **errp)
+{
+    StatsSchemaValueList *list = NULL;
+
+    if (!tcg_enabled()) {
+        return;
+    }
+
+    list = tcg_schema_add(list, "tb-flushes");
+    list = tcg_schema_add(list, "smc-filtered");
+    add_stats_schema(result, STATS_PROVIDER_TCG, STATS_TARGET_VM, list);
+
+    list = NULL;
+    list = tcg_schema_add(list, "tlb-fills");
+    list = tcg_schema_add(list, "tlb-victim-hits");
+    list = tcg_schema_add(list, "code-buffer-full");
+    list = tcg_schema_add(list, "translations");
+    list = tcg_schema_add(list, "htable-hits");
+    list = tcg_schema_add(list, "htable-lookups");
+    list = tcg_schema_add(list, "jmp-cache-hits");
+    add_stats_schema(result, STATS_PROVIDER_TCG, STATS_TARGET_VCPU, list);
+}
+
 static void hmp_tcg_register(void)
 {
     monitor_register_hmp_info_hrt("jit", qmp_x_query_jit);
+    add_stats_callbacks(STATS_PROVIDER_TCG, tcg_stats_cb,
+                        tcg_stats_schemas_cb);
 }
 
 type_init(hmp_tcg_register);
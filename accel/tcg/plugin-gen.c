@@ -226,6 +226,31 @@ static void gen_inline_store_u64_cb(struct qemu_plugin_inline_cb *cb)
     tcg_temp_free_ptr(ptr);
 }
 
+/* Append @val to the ring of a trace buffer and bump its count */
+static void gen_inline_record_cb(struct qemu_plugin_inline_cb *cb,
+                                 TCGv_i64 val)
+{
+    TCGv_ptr ptr = gen_plugin_u64_ptr(cb->entry);
+    TCGv_ptr slot = tcg_temp_ebb_new_ptr();
+    TCGv_i64 count = tcg_temp_ebb_new_i64();
+    TCGv_i64 ofs = tcg_temp_ebb_new_i64();
+    size_t n_entries = cb->entry.score->trace_entries;
+
+    tcg_gen_ld_i64(count, ptr, 0);
+    tcg_gen_andi_i64(ofs, count, n_entries - 1);
+    tcg_gen_shli_i64(ofs, ofs, 3);
+    tcg_gen_trunc_i64_ptr(slot, ofs);
+    tcg_gen_add_ptr(slot, slot, ptr);
+    tcg_gen_st_i64(val, slot, sizeof(uint64_t));
+    tcg_gen_addi_i64(count, count, 1);
+    tcg_gen_st_i64(count, ptr, 0);
+
+    tcg_temp_free_i64(ofs);
+    tcg_temp_free_i64(count);
+    tcg_temp_free_ptr(slot);
+    tcg_temp_free_ptr(ptr);
+}
+
 static void gen_mem_cb(struct qemu_plugin_regular_cb *cb,
                        qemu_plugin_meminfo_t meminfo, TCGv_i64 addr)
 {
@@ -264,6 +289,10 @@ static void inject_cb(struct qemu_plugin_dyn_cb *cb)
     case PLUGIN_CB_INLINE_STORE_U64:
         gen_inline_store_u64_cb(&cb->inline_insn);
         break;
+    case PLUGIN_CB_INLINE_RECORD_U64:
+        gen_inline_record_cb(&cb->inline_insn,
+                             tcg_constant_i64(cb->inline_insn.imm));
+        break;
     default:
         g_assert_not_reached();
     }
@@ -281,10 +310,16 @@ static void inject_mem_cb(struct qemu_plugin_dyn_cb *cb,
         break;
     case PLUGIN_CB_INLINE_ADD_U64:
     case PLUGIN_CB_INLINE_STORE_U64:
+    case PLUGIN_CB_INLINE_RECORD_U64:
         if (rw & cb->inline_insn.rw) {
             inject_cb(cb);
         }
         break;
+    case PLUGIN_CB_INLINE_RECORD_VADDR:
+        if (rw & cb->inline_insn.rw) {
+            gen_inline_record_cb(&cb->inline_insn, addr);
+        }
+        break;
     default:
         g_assert_not_reached();
     }
@@ -32,9 +32,14 @@ struct TBContext {
 
     struct qht htable;
 
+    /* A flush has been queued with queue_tb_flush() and not run yet */
+    bool tb_flush_pending;
+
     /* statistics */
     unsigned tb_flush_count;
     unsigned tb_phys_invalidate_count;
+    /* code page writes that missed all translated code on the page */
+    unsigned tb_smc_filtered_count;
 };
 
 extern TBContext tb_ctx;
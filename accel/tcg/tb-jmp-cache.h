@@ -12,22 +12,57 @@
 #include "qemu/rcu.h"
 #include "exec/cpu-common.h"
 
+/* Default size, can be changed with the jmp-cache-size accelerator property */
 #define TB_JMP_CACHE_BITS 12
 #define TB_JMP_CACHE_SIZE (1 << TB_JMP_CACHE_BITS)
 
+#define TB_JMP_CACHE_MIN_BITS 10
+#define TB_JMP_CACHE_MAX_BITS 20
+
+extern unsigned int tb_jmp_cache_bits;
+
+/*
+ * Per-vCPU counters of the TB lookup paths.  They are only written by the
+ * vCPU thread owning the cache and read with qatomic_read() by query-stats.
+ */
+typedef struct CPUJumpCacheStats {
+    size_t hits;               /* found in the jump cache */
+    size_t htable_lookups;     /* jump cache misses, looked up in the QHT */
+    size_t htable_hits;        /* found in the QHT */
+    size_t translations;       /* tb_gen_code() calls */
+    size_t buffer_full;        /* flushes needed because code buffer is full */
+} CPUJumpCacheStats;
+
 /*
  * Invalidated in parallel; all accesses to 'tb' must be atomic.
  * A valid entry is read/written by a single CPU, therefore there is
  * no need for qatomic_rcu_read() and pc is always consistent with a
  * non-NULL value of 'tb'.  Strictly speaking pc is only needed for
  * CF_PCREL, but it's used always for simplicity.
+ *
+ * The cache is two-way set associative: an entry may also be found at
+ * the odd/even neighbour of its hash, where the previous occupant of
+ * a slot is moved when a new TB is inserted.  Stale entries are harmless
+ * because invalidated TBs have CF_INVALID set and never match a lookup.
  */
 typedef struct CPUJumpCache {
     struct rcu_head rcu;
+    unsigned int bits;
+    CPUJumpCacheStats stats;
     struct {
         TranslationBlock *tb;
         vaddr pc;
-    } array[TB_JMP_CACHE_SIZE];
+    } array[];
 } CPUJumpCache;
 
+static inline size_t tb_jmp_cache_size(const CPUJumpCache *jc)
+{
+    return (size_t)1 << jc->bits;
+}
+
+static inline void tb_jmp_cache_stat_inc(size_t *counter)
+{
+    qatomic_set(counter, *counter + 1);
+}
+
 #endif /* ACCEL_TCG_TB_JMP_CACHE_H */
@@ -190,8 +190,26 @@ struct PageDesc {
     QemuSpin lock;
     /* list of TBs intersecting this ram page */
     uintptr_t first_tb;
+    /*
+     * One bit per 1/64th of the page (a 64-byte line for 4k pages) that
+     * may hold translated code.  Bits are only set while TBs are added
+     * and are cleared when the page runs out of TBs, so this is a
+     * superset of the code actually present.
+     */
+    uint64_t code_lines;
 };
 
+#define PAGE_CODE_LINE_BITS  (TARGET_PAGE_BITS - 6)
+
+/* Return the code_lines bits covering [start, last] within one page. */
+static uint64_t page_code_lines(tb_page_addr_t start, tb_page_addr_t last)
+{
+    unsigned first = (start & ~TARGET_PAGE_MASK) >> PAGE_CODE_LINE_BITS;
+    unsigned final = (last & ~TARGET_PAGE_MASK) >> PAGE_CODE_LINE_BITS;
+
+    return MAKE_64BIT_MASK(first, final - first + 1);
+}
+
 void page_table_config_init(void)
 {
     uint32_t v_l1_bits;
@@ -671,6 +689,7 @@ static void tb_remove_all_1(int level, void **lp)
         for (i = 0; i < V_L2_SIZE; ++i) {
             page_lock(&pd[i]);
             pd[i].first_tb = (uintptr_t)NULL;
+            qatomic_set(&pd[i].code_lines, 0);
             page_unlock(&pd[i]);
         }
     } else {
@@ -698,6 +717,7 @@ static void tb_remove_all(void)
 static void tb_page_add(PageDesc *p, TranslationBlock *tb, unsigned int n)
 {
     bool page_already_protected;
+    tb_page_addr_t tb_start, tb_last;
 
     assert_page_locked(p);
 
@@ -705,6 +725,17 @@ static void tb_page_add(PageDesc *p, TranslationBlock *tb, unsigned int n)
     page_already_protected = p->first_tb != 0;
     p->first_tb = (uintptr_t)tb | n;
 
+    tb_start = tb_page_addr0(tb);
+    tb_last = tb_start + tb->size - 1;
+    if (n == 0) {
+        tb_last = MIN(tb_last, tb_start | ~TARGET_PAGE_MASK);
+    } else {
+        tb_start = tb_page_addr1(tb);
+        tb_last = tb_start + (tb_last & ~TARGET_PAGE_MASK);
+    }
+    qatomic_set(&p->code_lines,
+                p->code_lines | page_code_lines(tb_start, tb_last));
+
     /*
      * If some code is already present, then the pages are already
      * protected. So we handle the case where only the first TB is
@@ -740,6 +771,9 @@ static void tb_page_remove(PageDesc *pd, TranslationBlock *tb)
     PAGE_FOR_EACH_TB(unused, unused, pd, tb1, n1) {
         if (tb1 == tb) {
             *pprev = tb1->page_next[n1];
+            if (!pd->first_tb) {
+                qatomic_set(&pd->code_lines, 0);
+            }
             return;
         }
         pprev = &tb1->page_next[n1];
@@ -787,6 +821,7 @@ void tb_flush__exclusive_or_serial(void)
     tcg_region_reset_all();
     /* XXX: flush processor icache at this point if cache flush is expensive */
     qatomic_inc(&tb_ctx.tb_flush_count);
+    qatomic_set(&tb_ctx.tb_flush_pending, false);
     qemu_plugin_flush_cb();
 }
 
@@ -802,6 +837,17 @@ void queue_tb_flush(CPUState *cs)
 {
     if (tcg_enabled()) {
         unsigned tb_flush_count = qatomic_read(&tb_ctx.tb_flush_count);
+
+        /*
+         * When the code buffer fills up, every vCPU that tries to translate
+         * ends up here.  Each queued item costs a stop-the-world exclusive
+         * section even if the flush itself is skipped, so only queue one;
+         * the other vCPUs retry once it has run.
+         */
+        if (qatomic_xchg(&tb_ctx.tb_flush_pending, true)) {
+            trace_tb_flush_coalesced(cs->cpu_index);
+            return;
+        }
         async_safe_run_on_cpu(cs, do_tb_flush,
                               RUN_ON_CPU_HOST_INT(tb_flush_count));
     }
@@ -901,14 +947,16 @@ static void tb_jmp_cache_inval_tb(TranslationBlock *tb)
             tcg_flush_jmp_cache(cpu);
         }
     } else {
-        uint32_t h = tb_jmp_cache_hash_func(tb->pc);
-
         CPU_FOREACH(cpu) {
             CPUJumpCache *jc = cpu->tb_jmp_cache;
+            uint32_t h = tb_jmp_cache_hash_func(jc, tb->pc);
 
             if (qatomic_read(&jc->array[h].tb) == tb) {
                 qatomic_set(&jc->array[h].tb, NULL);
             }
+            if (qatomic_read(&jc->array[h ^ 1].tb) == tb) {
+                qatomic_set(&jc->array[h ^ 1].tb, NULL);
+            }
         }
     }
 }
@@ -1218,7 +1266,20 @@ void tb_invalidate_phys_range_fast(CPUState *cpu, ram_addr_t start,
 
     if (p) {
         ram_addr_t last = start + len - 1;
-        struct page_collection *pages = page_collection_lock(start, last);
+        struct page_collection *pages;
+
+        /*
+         * A write to data sharing a page with code need not take the page
+         * locks nor walk the TB list if it misses every line holding code.
+         * The page stays write-protected, as there is still code on it.
+         */
+        if (!(qatomic_read(&p->code_lines) & page_code_lines(start, last))) {
+            qatomic_set(&tb_ctx.tb_smc_filtered_count,
+                        tb_ctx.tb_smc_filtered_count + 1);
+            return;
+        }
+
+        pages = page_collection_lock(start, last);
 
         tb_invalidate_phys_page_range__locked(cpu, pages, p,
                                               start, last, ra);
@@ -35,9 +35,11 @@
 #include "qapi/qapi-types-common.h"
 #include "qapi/qapi-builtin-visit.h"
 #include "qemu/units.h"
+#include "qemu/host-utils.h"
 #include "qemu/target-info.h"
 #ifndef CONFIG_USER_ONLY
 #include "hw/boards.h"
+#include "hw/core/cpu.h"
 #include "exec/tb-flush.h"
 #include "system/runstate.h"
 #endif
@@ -45,6 +47,7 @@
 #include "accel/accel-cpu-ops.h"
 #include "accel/tcg/cpu-ops.h"
 #include "internal-common.h"
+#include "tb-jmp-cache.h"
 
 
 struct TCGState {
@@ -216,6 +219,68 @@ static void tcg_set_tb_size(Object *obj, Visitor *v,
     s->tb_size = value;
 }
 
+static void tcg_get_jmp_cache_size(Object *obj, Visitor *v,
+                                   const char *name, void *opaque,
+                                   Error **errp)
+{
+    uint32_t value = 1u << tb_jmp_cache_bits;
+
+    visit_type_uint32(v, name, &value, errp);
+}
+
+static void tcg_set_jmp_cache_size(Object *obj, Visitor *v,
+                                   const char *name, void *opaque,
+                                   Error **errp)
+{
+    uint32_t value;
+
+    if (!visit_type_uint32(v, name, &value, errp)) {
+        return;
+    }
+
+    if (!is_power_of_2(value) ||
+        value < (1u << TB_JMP_CACHE_MIN_BITS) ||
+        value > (1u << TB_JMP_CACHE_MAX_BITS)) {
+        error_setg(errp, "jmp-cache-size must be a power of 2 between "
+                   "%u and %u", 1u << TB_JMP_CACHE_MIN_BITS,
+                   1u << TB_JMP_CACHE_MAX_BITS);
+        return;
+    }
+
+    tb_jmp_cache_bits = ctz32(value);
+}
+
+#ifndef CONFIG_USER_ONLY
+static void tcg_get_victim_tlb_size(Object *obj, Visitor *v,
+                                    const char *name, void *opaque,
+                                    Error **errp)
+{
+    uint32_t value = tlb_vtlb_size;
+
+    visit_type_uint32(v, name, &value, errp);
+}
+
+static void tcg_set_victim_tlb_size(Object *obj, Visitor *v,
+                                    const char *name, void *opaque,
+                                    Error **errp)
+{
+    uint32_t value;
+
+    if (!visit_type_uint32(v, name, &value, errp)) {
+        return;
+    }
+
+    if (!is_power_of_2(value) || value < CPU_VTLB_WAYS ||
+        value > CPU_VTLB_MAX_SIZE) {
+        error_setg(errp, "victim-tlb-size must be a power of 2 between "
+                   "%d and %d", CPU_VTLB_WAYS, CPU_VTLB_MAX_SIZE);
+        return;
+    }
+
+    tlb_vtlb_size = value;
+}
+#endif
+
 static bool tcg_get_splitwx(Object *obj, Error **errp)
 {
     TCGState *s = TCG_STATE(obj);
@@ -278,6 +343,20 @@ static void tcg_accel_class_init(ObjectClass *oc, const void *data)
     object_class_property_set_description(oc, "tb-size",
         "TCG translation block cache size");
 
+    object_class_property_add(oc, "jmp-cache-size", "int",
+        tcg_get_jmp_cache_size, tcg_set_jmp_cache_size,
+        NULL, NULL);
+    object_class_property_set_description(oc, "jmp-cache-size",
+        "Number of entries in the per-vCPU TB jump cache");
+
+#ifndef CONFIG_USER_ONLY
+    object_class_property_add(oc, "victim-tlb-size", "int",
+        tcg_get_victim_tlb_size, tcg_set_victim_tlb_size,
+        NULL, NULL);
+    object_class_property_set_description(oc, "victim-tlb-size",
+        "Number of victim TLB entries for each MMU mode");
+#endif
+
     object_class_property_add_bool(oc, "split-wx",
         tcg_get_splitwx, tcg_set_splitwx);
     object_class_property_set_description(oc, "split-wx",
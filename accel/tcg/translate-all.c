@@ -270,6 +270,7 @@ TranslationBlock *tb_gen_code(CPUState *cpu, TCGTBCPUState s)
 
     assert_memory_lock();
     qemu_thread_jit_write();
+    tb_jmp_cache_stat_inc(&cpu->tb_jmp_cache->stats.translations);
 
     phys_pc = get_page_addr_code_hostp(env, s.pc, &host_pc);
 
@@ -289,6 +290,7 @@ TranslationBlock *tb_gen_code(CPUState *cpu, TCGTBCPUState s)
     tb = tcg_tb_alloc(tcg_ctx);
     if (unlikely(!tb)) {
         /* flush must be done */
+        tb_jmp_cache_stat_inc(&cpu->tb_jmp_cache->stats.buffer_full);
         if (cpu_in_serial_context(cpu)) {
             trace_tb_gen_code_buffer_overflow("tcg_tb_alloc");
             tb_flush__exclusive_or_serial();
@@ -634,7 +636,7 @@ void tcg_flush_jmp_cache(CPUState *cpu)
         return;
     }
 
-    for (int i = 0; i < TB_JMP_CACHE_SIZE; i++) {
+    for (size_t i = 0; i < tb_jmp_cache_size(jc); i++) {
         qatomic_set(&jc->array[i].tb, NULL);
     }
 }
@@ -25,6 +25,7 @@
 #include "qemu/osdep.h"
 #include "qemu/bswap.h"
 #include "qemu/audio.h"
+#include "host/cpuinfo.h"
 
 #define AUDIO_CAP "mixeng"
 #include "audio_int.h"
@@ -269,6 +270,22 @@ f_sample *mixeng_clip[2][2][2][3] = {
     }
 };
 
+typedef struct MixengAccel {
+    t_sample *conv_s16_stereo;
+    f_sample *clip_s16_stereo;
+} MixengAccel;
+
+#include "host/mixeng.c.inc"
+
+/* Install the best host-accelerated native s16 stereo conversions. */
+static void __attribute__((constructor)) init_accel(void)
+{
+    const MixengAccel *accel = &accel_table[best_accel()];
+
+    mixeng_conv[1][1][0][1] = accel->conv_s16_stereo;
+    mixeng_clip[1][1][0][1] = accel->clip_s16_stereo;
+}
+
 #ifdef FLOAT_MIXENG
 #define CONV_NATURAL_FLOAT(x) (x)
 #define CLIP_NATURAL_FLOAT(x) (x)
@@ -24,6 +24,8 @@
 #include "qemu/osdep.h"
 #include "system/cryptodev.h"
 #include "qemu/error-report.h"
+#include "qemu/thread.h"
+#include "block/thread-pool.h"
 #include "qapi/error.h"
 #include "standard-headers/linux/virtio_crypto.h"
 #include "crypto/cipher.h"
@@ -45,9 +47,19 @@ typedef struct CryptoDevBackendBuiltinSession {
     uint8_t direction; /* encryption or decryption */
     uint8_t type; /* cipher? hash? aead? */
     QCryptoAkCipher *akcipher;
+    /* Serializes operations, the cipher state holds the IV */
+    QemuMutex lock;
+    /* One reference for the session table, one per operation in flight */
+    unsigned int refcnt;
     QTAILQ_ENTRY(CryptoDevBackendBuiltinSession) next;
 } CryptoDevBackendBuiltinSession;
 
+typedef struct CryptoDevBuiltinTask {
+    CryptoDevBackendBuiltinSession *sess;
+    CryptoDevBackendOpInfo *op_info;
+    int status;
+} CryptoDevBuiltinTask;
+
 /* Max number of symmetric/asymmetric sessions */
 #define MAX_NUM_SESSIONS 256
 
@@ -58,6 +70,8 @@ struct CryptoDevBackendBuiltin {
     CryptoDevBackend parent_obj;
 
     CryptoDevBackendBuiltinSession *sessions[MAX_NUM_SESSIONS];
+    /* Run operations in the thread pool instead of the main loop */
+    bool thread_pool;
 };
 
 static void cryptodev_builtin_init_akcipher(CryptoDevBackend *backend)
@@ -299,6 +313,8 @@ static int cryptodev_builtin_create_cipher_session(
     sess->cipher = cipher;
     sess->direction = sess_info->direction;
     sess->type = sess_info->op_type;
+    qemu_mutex_init(&sess->lock);
+    sess->refcnt = 1;
 
     builtin->sessions[index] = sess;
 
@@ -361,6 +377,8 @@ static int cryptodev_builtin_create_akcipher_session(
 
     sess = g_new0(CryptoDevBackendBuiltinSession, 1);
     sess->akcipher = akcipher;
+    qemu_mutex_init(&sess->lock);
+    sess->refcnt = 1;
 
     builtin->sessions[index] = sess;
 
@@ -417,6 +435,23 @@ static int cryptodev_builtin_create_session(
     return 0;
 }
 
+static void cryptodev_builtin_session_unref(
+           CryptoDevBackendBuiltinSession *session)
+{
+    if (--session->refcnt) {
+        return;
+    }
+
+    if (session->cipher) {
+        qcrypto_cipher_free(session->cipher);
+    } else if (session->akcipher) {
+        qcrypto_akcipher_free(session->akcipher);
+    }
+
+    qemu_mutex_destroy(&session->lock);
+    g_free(session);
+}
+
 static int cryptodev_builtin_close_session(
            CryptoDevBackend *backend,
            uint64_t session_id,
@@ -432,15 +467,10 @@ static int cryptodev_builtin_close_session(
         return -VIRTIO_CRYPTO_INVSESS;
     }
 
+    /* Operations still in the thread pool keep the session alive */
     session = builtin->sessions[session_id];
-    if (session->cipher) {
-        qcrypto_cipher_free(session->cipher);
-    } else if (session->akcipher) {
-        qcrypto_akcipher_free(session->akcipher);
-    }
-
-    g_free(session);
     builtin->sessions[session_id] = NULL;
+    cryptodev_builtin_session_unref(session);
     if (cb) {
         cb(opaque, VIRTIO_CRYPTO_OK);
     }
@@ -540,6 +570,52 @@ static int cryptodev_builtin_asym_operation(
     return VIRTIO_CRYPTO_OK;
 }
 
+static int cryptodev_builtin_session_operation(
+                 CryptoDevBackendBuiltinSession *sess,
+                 CryptoDevBackendOpInfo *op_info)
+{
+    QCryptodevBackendAlgoType algtype = op_info->algtype;
+    int status = -VIRTIO_CRYPTO_ERR;
+    Error *local_error = NULL;
+
+    qemu_mutex_lock(&sess->lock);
+    if (algtype == QCRYPTODEV_BACKEND_ALGO_TYPE_SYM) {
+        status = cryptodev_builtin_sym_operation(sess, op_info->u.sym_op_info,
+                                                 &local_error);
+    } else if (algtype == QCRYPTODEV_BACKEND_ALGO_TYPE_ASYM) {
+        status = cryptodev_builtin_asym_operation(sess, op_info->op_code,
+                                                  op_info->u.asym_op_info,
+                                                  &local_error);
+    }
+    qemu_mutex_unlock(&sess->lock);
+
+    if (local_error) {
+        error_report_err(local_error);
+    }
+    return status;
+}
+
+static int cryptodev_builtin_worker(void *opaque)
+{
+    CryptoDevBuiltinTask *task = opaque;
+
+    task->status = cryptodev_builtin_session_operation(task->sess,
+                                                       task->op_info);
+    return 0;
+}
+
+static void cryptodev_builtin_worker_done(void *opaque, int ret)
+{
+    CryptoDevBuiltinTask *task = opaque;
+    CryptoDevBackendOpInfo *op_info = task->op_info;
+
+    cryptodev_builtin_session_unref(task->sess);
+    if (op_info->cb) {
+        op_info->cb(op_info->opaque, task->status);
+    }
+    g_free(task);
+}
+
 static int cryptodev_builtin_operation(
                  CryptoDevBackend *backend,
                  CryptoDevBackendOpInfo *op_info)
@@ -547,11 +623,8 @@ static int cryptodev_builtin_operation(
     CryptoDevBackendBuiltin *builtin =
                       CRYPTODEV_BACKEND_BUILTIN(backend);
     CryptoDevBackendBuiltinSession *sess;
-    CryptoDevBackendSymOpInfo *sym_op_info;
-    CryptoDevBackendAsymOpInfo *asym_op_info;
-    QCryptodevBackendAlgoType algtype = op_info->algtype;
-    int status = -VIRTIO_CRYPTO_ERR;
-    Error *local_error = NULL;
+    CryptoDevBuiltinTask *task;
+    int status;
 
     if (op_info->session_id >= MAX_NUM_SESSIONS ||
               builtin->sessions[op_info->session_id] == NULL) {
@@ -561,19 +634,22 @@ static int cryptodev_builtin_operation(
     }
 
     sess = builtin->sessions[op_info->session_id];
-    if (algtype == QCRYPTODEV_BACKEND_ALGO_TYPE_SYM) {
-        sym_op_info = op_info->u.sym_op_info;
-        status = cryptodev_builtin_sym_operation(sess, sym_op_info,
-                                                 &local_error);
-    } else if (algtype == QCRYPTODEV_BACKEND_ALGO_TYPE_ASYM) {
-        asym_op_info = op_info->u.asym_op_info;
-        status = cryptodev_builtin_asym_operation(sess, op_info->op_code,
-                                                  asym_op_info, &local_error);
+    if (builtin->thread_pool) {
+        /*
+         * Different sessions run in parallel; the completion callback
+         * runs in the main loop once the worker is done.
+         */
+        task = g_new0(CryptoDevBuiltinTask, 1);
+        task->sess = sess;
+        task->op_info = op_info;
+        task->status = -VIRTIO_CRYPTO_ERR;
+        sess->refcnt++;
+        thread_pool_submit_aio(cryptodev_builtin_worker, task,
+                               cryptodev_builtin_worker_done, task);
+        return 0;
     }
 
-    if (local_error) {
-        error_report_err(local_error);
-    }
+    status = cryptodev_builtin_session_operation(sess, op_info);
     if (op_info->cb) {
         op_info->cb(op_info->opaque, status);
     }
@@ -607,6 +683,17 @@ static void cryptodev_builtin_cleanup(
     cryptodev_backend_set_ready(backend, false);
 }
 
+static bool cryptodev_builtin_get_thread_pool(Object *obj, Error **errp)
+{
+    return CRYPTODEV_BACKEND_BUILTIN(obj)->thread_pool;
+}
+
+static void cryptodev_builtin_set_thread_pool(Object *obj, bool value,
+                                              Error **errp)
+{
+    CRYPTODEV_BACKEND_BUILTIN(obj)->thread_pool = value;
+}
+
 static void
 cryptodev_builtin_class_init(ObjectClass *oc, const void *data)
 {
@@ -617,6 +704,10 @@ cryptodev_builtin_class_init(ObjectClass *oc, const void *data)
     bc->create_session = cryptodev_builtin_create_session;
     bc->close_session = cryptodev_builtin_close_session;
     bc->do_op = cryptodev_builtin_operation;
+
+    object_class_property_add_bool(oc, "thread-pool",
+                                   cryptodev_builtin_get_thread_pool,
+                                   cryptodev_builtin_set_thread_pool);
 }
 
 static const TypeInfo cryptodev_builtin_info = {
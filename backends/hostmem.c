@@ -21,7 +21,12 @@
 #include "qemu/mmap-alloc.h"
 #include "qemu/madvise.h"
 #include "qemu/cutils.h"
+#include "qemu/error-report.h"
+#include "qemu/timer.h"
+#include "qemu/units.h"
+#include "qemu/xxhash.h"
 #include "hw/qdev-core.h"
+#include "trace.h"
 
 #ifdef CONFIG_NUMA
 #include <numaif.h>
@@ -36,6 +41,22 @@ QEMU_BUILD_BUG_ON(HOST_MEM_POLICY_BIND != MPOL_BIND);
 QEMU_BUILD_BUG_ON(HOST_MEM_POLICY_INTERLEAVE != MPOL_INTERLEAVE);
 #endif
 
+/*
+ * Merge scan
+ *
+ * With merge=off, KSM does not look at the backend at all; with merge=on
+ * it scans all of it at a rate that is set host-wide.  For guests started
+ * from the same image, the duplicates are concentrated in the parts of RAM
+ * that hold zeroed or unmodified template pages.  The merge scan looks for
+ * them itself, one chunk per merge-scan-interval, and marks only the
+ * chunks where at least a quarter of the pages are zero or repeat a page
+ * seen earlier in the pass as MADV_MERGEABLE.  KSM then merges them
+ * safely, with copy-on-write.  Pages are never discarded here: the guest
+ * may write to a page between the check and the discard.
+ */
+#define MERGE_SCAN_CHUNK        (2 * MiB)
+#define MERGE_SCAN_MAX_HASHES   (1 << 20)
+
 char *
 host_memory_backend_get_name(HostMemoryBackend *backend)
 {
@@ -187,9 +208,45 @@ static void host_memory_backend_set_merge(Object *obj, bool value, Error **errp)
                      value ? QEMU_MADV_MERGEABLE : QEMU_MADV_UNMERGEABLE);
     }
 
+    /* The whole backend has just been (un)marked */
+    if (backend->merge_scan_hinted) {
+        bitmap_zero(backend->merge_scan_hinted,
+                    DIV_ROUND_UP(memory_region_size(&backend->mr),
+                                 MERGE_SCAN_CHUNK));
+    }
+
     backend->merge = value;
 }
 
+static void host_memory_backend_get_merge_scan_interval(Object *obj,
+    Visitor *v, const char *name, void *opaque, Error **errp)
+{
+    HostMemoryBackend *backend = MEMORY_BACKEND(obj);
+
+    visit_type_uint32(v, name, &backend->merge_scan_interval, errp);
+}
+
+static void host_memory_backend_set_merge_scan_interval(Object *obj,
+    Visitor *v, const char *name, void *opaque, Error **errp)
+{
+    HostMemoryBackend *backend = MEMORY_BACKEND(obj);
+    uint32_t value;
+
+    if (host_memory_backend_mr_inited(backend)) {
+        error_setg(errp, "cannot change property '%s' of %s", name,
+                   object_get_typename(obj));
+        return;
+    }
+    if (!visit_type_uint32(v, name, &value, errp)) {
+        return;
+    }
+    if (value && QEMU_MADV_MERGEABLE == QEMU_MADV_INVALID) {
+        error_setg(errp, "Memory merging is not supported on this host");
+        return;
+    }
+    backend->merge_scan_interval = value;
+}
+
 static bool host_memory_backend_get_dump(Object *obj, Error **errp)
 {
     HostMemoryBackend *backend = MEMORY_BACKEND(obj);
@@ -256,6 +313,28 @@ static void host_memory_backend_set_prealloc(Object *obj, bool value,
     }
 }
 
+static bool host_memory_backend_get_prealloc_background(Object *obj,
+                                                        Error **errp)
+{
+    HostMemoryBackend *backend = MEMORY_BACKEND(obj);
+
+    return backend->prealloc_background;
+}
+
+static void host_memory_backend_set_prealloc_background(Object *obj,
+                                                        bool value,
+                                                        Error **errp)
+{
+    HostMemoryBackend *backend = MEMORY_BACKEND(obj);
+
+    if (host_memory_backend_mr_inited(backend)) {
+        error_setg(errp, "cannot change property 'prealloc-background' of %s",
+                   object_get_typename(obj));
+        return;
+    }
+    backend->prealloc_background = value;
+}
+
 static void host_memory_backend_get_prealloc_threads(Object *obj, Visitor *v,
     const char *name, void *opaque, Error **errp)
 {
@@ -298,6 +377,17 @@ static void host_memory_backend_post_init(Object *obj)
     object_apply_compat_props(obj);
 }
 
+static void host_memory_backend_finalize(Object *obj)
+{
+    HostMemoryBackend *backend = MEMORY_BACKEND(obj);
+
+    timer_free(backend->merge_scan_timer);
+    g_free(backend->merge_scan_hinted);
+    if (backend->merge_scan_hashes) {
+        g_hash_table_destroy(backend->merge_scan_hashes);
+    }
+}
+
 bool host_memory_backend_mr_inited(HostMemoryBackend *backend)
 {
     /*
@@ -329,6 +419,177 @@ size_t host_memory_backend_pagesize(HostMemoryBackend *memdev)
     return pagesize;
 }
 
+#ifdef CONFIG_LINUX
+/*
+ * Parse one /proc/self/numa_maps line and account the pages it reports per
+ * host node if the mapping starts within [start, end).
+ */
+static void host_memory_backend_parse_numa_maps(const char *line,
+                                                uintptr_t start, uintptr_t end,
+                                                uint64_t *node_bytes)
+{
+    g_auto(GStrv) tokens = g_strsplit(line, " ", -1);
+    uint64_t pagesize = qemu_real_host_page_size();
+    uint64_t addr;
+    int i;
+
+    if (!tokens[0] || qemu_strtou64(tokens[0], NULL, 16, &addr) ||
+        addr < start || addr >= end) {
+        return;
+    }
+
+    for (i = 1; tokens[i]; i++) {
+        if (g_str_has_prefix(tokens[i], "kernelpagesize_kB=") &&
+            !qemu_strtou64(tokens[i] + strlen("kernelpagesize_kB="), NULL, 10,
+                           &pagesize)) {
+            pagesize *= KiB;
+        }
+    }
+
+    for (i = 1; tokens[i]; i++) {
+        const char *endptr;
+        uint64_t node, pages;
+
+        if (tokens[i][0] != 'N' ||
+            qemu_strtou64(tokens[i] + 1, &endptr, 10, &node) ||
+            *endptr != '=' || node > MAX_NODES ||
+            qemu_strtou64(endptr + 1, NULL, 10, &pages)) {
+            continue;
+        }
+        node_bytes[node] += pages * pagesize;
+    }
+}
+
+bool host_memory_backend_get_node_usage(HostMemoryBackend *backend,
+                                        uint64_t *node_bytes, Error **errp)
+{
+    g_autofree char *contents = NULL;
+    g_auto(GStrv) lines = NULL;
+    GError *err = NULL;
+    uintptr_t start, end;
+    int i;
+
+    if (!host_memory_backend_mr_inited(backend)) {
+        error_setg(errp, "memory backend is not initialized");
+        return false;
+    }
+    if (!g_file_get_contents("/proc/self/numa_maps", &contents, NULL, &err)) {
+        error_setg(errp, "cannot read /proc/self/numa_maps: %s", err->message);
+        g_error_free(err);
+        return false;
+    }
+
+    memset(node_bytes, 0, sizeof(uint64_t) * (MAX_NODES + 1));
+    start = (uintptr_t)memory_region_get_ram_ptr(&backend->mr);
+    end = start + memory_region_size(&backend->mr);
+    lines = g_strsplit(contents, "\n", -1);
+    for (i = 0; lines[i]; i++) {
+        host_memory_backend_parse_numa_maps(lines[i], start, end, node_bytes);
+    }
+    return true;
+}
+#else
+bool host_memory_backend_get_node_usage(HostMemoryBackend *backend,
+                                        uint64_t *node_bytes, Error **errp)
+{
+    error_setg(errp, "per-node memory usage is not supported on this host");
+    return false;
+}
+#endif /* CONFIG_LINUX */
+
+static uint32_t merge_scan_page_hash(const void *ptr, size_t page_size)
+{
+    const uint64_t *p = ptr;
+    uint64_t v1, v2, v3, v4;
+    uint64_t res;
+    size_t i;
+
+    v1 = QEMU_XXHASH_SEED + XXH_PRIME64_1 + XXH_PRIME64_2;
+    v2 = QEMU_XXHASH_SEED + XXH_PRIME64_2;
+    v3 = QEMU_XXHASH_SEED + 0;
+    v4 = QEMU_XXHASH_SEED - XXH_PRIME64_1;
+    for (i = 0; i < page_size / 8; i += 4) {
+        v1 = XXH64_round(v1, p[i + 0]);
+        v2 = XXH64_round(v2, p[i + 1]);
+        v3 = XXH64_round(v3, p[i + 2]);
+        v4 = XXH64_round(v4, p[i + 3]);
+    }
+    res = XXH64_mergerounds(v1, v2, v3, v4);
+    res += page_size;
+    res = XXH64_avalanche(res);
+    return (uint32_t)res;
+}
+
+static void host_memory_backend_merge_scan(void *opaque)
+{
+    HostMemoryBackend *backend = opaque;
+    uint8_t *ptr = memory_region_get_ram_ptr(&backend->mr);
+    uint64_t size = memory_region_size(&backend->mr);
+    size_t pagesize = qemu_real_host_page_size();
+    uint64_t offset = backend->merge_scan_offset;
+    uint64_t len = MIN(MERGE_SCAN_CHUNK, size - offset);
+    unsigned long chunk = offset / MERGE_SCAN_CHUNK;
+    unsigned int zero = 0, dup = 0;
+    uint64_t i;
+
+    if (!backend->merge && !test_bit(chunk, backend->merge_scan_hinted)) {
+        for (i = 0; i + pagesize <= len; i += pagesize) {
+            const uint8_t *page = ptr + offset + i;
+
+            if (buffer_is_zero(page, pagesize)) {
+                zero++;
+            } else if (!g_hash_table_add(backend->merge_scan_hashes,
+                           GUINT_TO_POINTER(merge_scan_page_hash(page,
+                                                                 pagesize)))) {
+                dup++;
+            }
+        }
+
+        trace_host_memory_backend_merge_scan(offset, zero, dup);
+        if ((zero + dup) * 4 * pagesize >= len) {
+            qemu_madvise(ptr + offset, len, QEMU_MADV_MERGEABLE);
+            set_bit(chunk, backend->merge_scan_hinted);
+        }
+    }
+
+    offset += len;
+    if (offset >= size) {
+        offset = 0;
+        g_hash_table_remove_all(backend->merge_scan_hashes);
+    } else if (g_hash_table_size(backend->merge_scan_hashes) >=
+               MERGE_SCAN_MAX_HASHES) {
+        g_hash_table_remove_all(backend->merge_scan_hashes);
+    }
+    backend->merge_scan_offset = offset;
+
+    timer_mod(backend->merge_scan_timer,
+              qemu_clock_get_ms(QEMU_CLOCK_REALTIME) +
+              backend->merge_scan_interval);
+}
+
+static void host_memory_backend_merge_scan_start(HostMemoryBackend *backend)
+{
+    uint64_t size = memory_region_size(&backend->mr);
+
+    if (qemu_ram_pagesize(backend->mr.ram_block) !=
+        qemu_real_host_page_size()) {
+        warn_report("memory backend '%s': merge-scan-interval is ignored "
+                    "with huge pages",
+                    object_get_canonical_path_component(OBJECT(backend)));
+        return;
+    }
+
+    backend->merge_scan_hinted =
+        bitmap_new(DIV_ROUND_UP(size, MERGE_SCAN_CHUNK));
+    backend->merge_scan_hashes = g_hash_table_new(NULL, NULL);
+    backend->merge_scan_timer =
+        timer_new_ms(QEMU_CLOCK_REALTIME, host_memory_backend_merge_scan,
+                     backend);
+    timer_mod(backend->merge_scan_timer,
+              qemu_clock_get_ms(QEMU_CLOCK_REALTIME) +
+              backend->merge_scan_interval);
+}
+
 static void
 host_memory_backend_memory_complete(UserCreatable *uc, Error **errp)
 {
@@ -360,6 +621,9 @@ host_memory_backend_memory_complete(UserCreatable *uc, Error **errp)
     if (backend->merge) {
         qemu_madvise(ptr, sz, QEMU_MADV_MERGEABLE);
     }
+    if (backend->merge_scan_interval) {
+        host_memory_backend_merge_scan_start(backend);
+    }
     if (!backend->dump) {
         qemu_madvise(ptr, sz, QEMU_MADV_DONTDUMP);
     }
@@ -421,7 +685,17 @@ host_memory_backend_memory_complete(UserCreatable *uc, Error **errp)
      * Preallocate memory after the NUMA policy has been instantiated.
      * This is necessary to guarantee memory is allocated with
      * specified NUMA policy in place.
+     *
+     * In the background, the threads of the prealloc context keep
+     * allocating memory on its NUMA nodes while the guest boots.
      */
+    if (backend->prealloc && backend->prealloc_background) {
+        backend->prealloc_bg_context =
+            qemu_prealloc_mem_background(memory_region_get_fd(&backend->mr),
+                                         ptr, sz, backend->prealloc_threads,
+                                         backend->prealloc_context, errp);
+        return;
+    }
     if (backend->prealloc && !qemu_prealloc_mem(memory_region_get_fd(&backend->mr),
                                                 ptr, sz,
                                                 backend->prealloc_threads,
@@ -434,11 +708,19 @@ host_memory_backend_memory_complete(UserCreatable *uc, Error **errp)
 static bool
 host_memory_backend_can_be_deleted(UserCreatable *uc)
 {
-    if (host_memory_backend_is_mapped(MEMORY_BACKEND(uc))) {
+    HostMemoryBackend *backend = MEMORY_BACKEND(uc);
+
+    if (host_memory_backend_is_mapped(backend)) {
         return false;
-    } else {
-        return true;
     }
+    /* The memory stays mapped until background preallocation is done */
+    if (backend->prealloc_bg_context) {
+        if (!qemu_prealloc_mem_background_done(backend->prealloc_bg_context)) {
+            return false;
+        }
+        backend->prealloc_bg_context = NULL;
+    }
+    return true;
 }
 
 static bool host_memory_backend_get_share(Object *o, Error **errp)
@@ -513,6 +795,13 @@ host_memory_backend_class_init(ObjectClass *oc, const void *data)
         host_memory_backend_set_merge);
     object_class_property_set_description(oc, "merge",
         "Mark memory as mergeable");
+    object_class_property_add(oc, "merge-scan-interval", "int",
+        host_memory_backend_get_merge_scan_interval,
+        host_memory_backend_set_merge_scan_interval,
+        NULL, NULL);
+    object_class_property_set_description(oc, "merge-scan-interval",
+        "Milliseconds between scanning chunks of memory for duplicate "
+        "pages to mark mergeable");
     object_class_property_add_bool(oc, "dump",
         host_memory_backend_get_dump,
         host_memory_backend_set_dump);
@@ -529,6 +818,11 @@ host_memory_backend_class_init(ObjectClass *oc, const void *data)
         NULL, NULL);
     object_class_property_set_description(oc, "prealloc-threads",
         "Number of CPU threads to use for prealloc");
+    object_class_property_add_bool(oc, "prealloc-background",
+        host_memory_backend_get_prealloc_background,
+        host_memory_backend_set_prealloc_background);
+    object_class_property_set_description(oc, "prealloc-background",
+        "Preallocate memory while the guest runs");
     object_class_property_add_link(oc, "prealloc-context",
         TYPE_THREAD_CONTEXT, offsetof(HostMemoryBackend, prealloc_context),
         object_property_allow_set_link, OBJ_PROP_LINK_STRONG);
@@ -586,6 +880,7 @@ static const TypeInfo host_memory_backend_info = {
     .instance_size = sizeof(HostMemoryBackend),
     .instance_init = host_memory_backend_init,
     .instance_post_init = host_memory_backend_post_init,
+    .instance_finalize = host_memory_backend_finalize,
     .interfaces = (const InterfaceInfo[]) {
         { TYPE_USER_CREATABLE },
         { }
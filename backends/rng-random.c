@@ -15,8 +15,13 @@
 #include "system/rng.h"
 #include "qapi/error.h"
 #include "qapi/qmp/qerror.h"
+#include "qapi/visitor.h"
 #include "qemu/main-loop.h"
 #include "qemu/module.h"
+#include "qemu/units.h"
+#include "block/thread-pool.h"
+
+#define RNG_RANDOM_MAX_POOL_SIZE (1 * MiB)
 
 struct RngRandom
 {
@@ -24,8 +29,25 @@ struct RngRandom
 
     int fd;
     char *filename;
+
+    /*
+     * Optional prefetch pool, refilled by a thread pool worker whenever
+     * it drops below half full; bytes are served from its end.
+     */
+    uint32_t pool_size;
+    uint8_t *pool;
+    size_t pool_len;
+    bool refilling;
+    QEMUBH *pool_bh;
 };
 
+typedef struct RngRandomRefill {
+    RngRandom *s;
+    uint8_t *buf;
+    size_t size;
+    ssize_t len;
+} RngRandomRefill;
+
 /**
  * A simple and incomplete backend to request entropy from /dev/random.
  *
@@ -56,10 +78,97 @@ static void entropy_available(void *opaque)
     qemu_set_fd_handler(s->fd, NULL, NULL, NULL);
 }
 
+static void rng_random_pool_refill(RngRandom *s);
+
+static void rng_random_pool_serve(void *opaque)
+{
+    RngRandom *s = RNG_RANDOM(opaque);
+
+    while (!QSIMPLEQ_EMPTY(&s->parent.requests) && s->pool_len) {
+        RngRequest *req = QSIMPLEQ_FIRST(&s->parent.requests);
+        size_t len = MIN(req->size, s->pool_len);
+        uint8_t *src = s->pool + s->pool_len - len;
+
+        memcpy(req->data, src, len);
+        memset(src, 0, len);
+        s->pool_len -= len;
+
+        req->receive_entropy(req->opaque, req->data, len);
+
+        rng_backend_finalize_request(&s->parent, req);
+    }
+
+    rng_random_pool_refill(s);
+
+    /* Out of pooled bytes: wait for the device as without a pool. */
+    if (!QSIMPLEQ_EMPTY(&s->parent.requests)) {
+        qemu_set_fd_handler(s->fd, entropy_available, NULL, s);
+    }
+}
+
+static int rng_random_refill_worker(void *opaque)
+{
+    RngRandomRefill *r = opaque;
+
+    r->len = read(r->s->fd, r->buf, r->size);
+    return 0;
+}
+
+static void rng_random_refill_done(void *opaque, int ret)
+{
+    RngRandomRefill *r = opaque;
+    RngRandom *s = r->s;
+
+    s->refilling = false;
+    if (r->len > 0) {
+        assert(s->pool_len + r->len <= s->pool_size);
+        memcpy(s->pool + s->pool_len, r->buf, r->len);
+        s->pool_len += r->len;
+        if (!QSIMPLEQ_EMPTY(&s->parent.requests)) {
+            qemu_bh_schedule(s->pool_bh);
+        }
+    }
+
+    memset(r->buf, 0, r->size);
+    g_free(r->buf);
+    g_free(r);
+    object_unref(OBJECT(s));
+}
+
+/*
+ * A failed or short read is not retried until the next guest request,
+ * so a non-blocking device that has run dry falls back to the fd handler.
+ */
+static void rng_random_pool_refill(RngRandom *s)
+{
+    RngRandomRefill *r;
+
+    if (s->refilling || s->pool_len >= s->pool_size / 2) {
+        return;
+    }
+
+    r = g_new0(RngRandomRefill, 1);
+    r->s = s;
+    r->size = s->pool_size - s->pool_len;
+    r->buf = g_malloc(r->size);
+    s->refilling = true;
+    object_ref(OBJECT(s));
+    thread_pool_submit_aio(rng_random_refill_worker, r,
+                           rng_random_refill_done, r);
+}
+
 static void rng_random_request_entropy(RngBackend *b, RngRequest *req)
 {
     RngRandom *s = RNG_RANDOM(b);
 
+    if (s->pool) {
+        if (s->pool_len) {
+            qemu_bh_schedule(s->pool_bh);
+            return;
+        }
+        rng_random_pool_refill(s);
+    }
+
     if (QSIMPLEQ_EMPTY(&s->parent.requests)) {
         /* If there are no pending requests yet, we need to
          * install our fd handler. */
@@ -77,6 +186,12 @@ static void rng_random_opened(RngBackend *b, Error **errp)
     } else {
         s->fd = qemu_open(s->filename, O_RDONLY | O_NONBLOCK, errp);
     }
+
+    if (s->fd != -1 && s->pool_size) {
+        s->pool = g_malloc0(s->pool_size);
+        s->pool_bh = qemu_bh_new(rng_random_pool_serve, s);
+        rng_random_pool_refill(s);
+    }
 }
 
 static char *rng_random_get_filename(Object *obj, Error **errp)
@@ -101,6 +216,38 @@ static void rng_random_set_filename(Object *obj, const char *filename,
     s->filename = g_strdup(filename);
 }
 
+static void rng_random_get_pool_size(Object *obj, Visitor *v,
+                                     const char *name, void *opaque,
+                                     Error **errp)
+{
+    RngRandom *s = RNG_RANDOM(obj);
+
+    visit_type_uint32(v, name, &s->pool_size, errp);
+}
+
+static void rng_random_set_pool_size(Object *obj, Visitor *v,
+                                     const char *name, void *opaque,
+                                     Error **errp)
+{
+    RngBackend *b = RNG_BACKEND(obj);
+    RngRandom *s = RNG_RANDOM(obj);
+    uint32_t value;
+
+    if (b->opened) {
+        error_setg(errp, "Property 'pool-size' can no longer be set");
+        return;
+    }
+    if (!visit_type_uint32(v, name, &value, errp)) {
+        return;
+    }
+    if (value > RNG_RANDOM_MAX_POOL_SIZE) {
+        error_setg(errp, "Property 'pool-size' must not exceed %u",
+                   RNG_RANDOM_MAX_POOL_SIZE);
+        return;
+    }
+    s->pool_size = value;
+}
+
 static void rng_random_init(Object *obj)
 {
     RngRandom *s = RNG_RANDOM(obj);
@@ -118,6 +265,11 @@ static void rng_random_finalize(Object *obj)
         qemu_close(s->fd);
     }
 
+    if (s->pool) {
+        qemu_bh_delete(s->pool_bh);
+        memset(s->pool, 0, s->pool_size);
+        g_free(s->pool);
+    }
     g_free(s->filename);
 }
 
@@ -130,7 +282,10 @@ static void rng_random_class_init(ObjectClass *klass, const void *data)
     object_class_property_add_str(klass, "filename",
                                   rng_random_get_filename,
                                   rng_random_set_filename);
-
+    object_class_property_add(klass, "pool-size", "uint32",
+                              rng_random_get_pool_size,
+                              rng_random_set_pool_size,
+                              NULL, NULL);
 }
 
 static const TypeInfo rng_random_info = {
@@ -421,13 +421,15 @@ BlockDriverState *bdrv_new(void)
         QLIST_INIT(&bs->op_blockers[i]);
     }
     qemu_mutex_init(&bs->reqs_lock);
+    for (i = 0; i < BDRV_TRACKED_REQ_SHARDS; i++) {
+        qemu_mutex_init(&bs->tracked_requests[i].lock);
+    }
     qemu_mutex_init(&bs->dirty_bitmap_mutex);
     bs->refcnt = 1;
     bs->aio_context = qemu_get_aio_context();
 
     qemu_co_queue_init(&bs->flush_queue);
 
-    qemu_co_mutex_init(&bs->bsc_modify_lock);
     bs->block_status_cache = g_new0(BdrvBlockStatusCache, 1);
 
     for (i = 0; i < bdrv_drain_all_count; i++) {
@@ -1442,6 +1444,8 @@ static void GRAPH_WRLOCK bdrv_child_cb_attach(BdrvChild *child)
     BlockDriverState *bs = child->opaque;
 
     assert_bdrv_graph_writable();
+    /* Cached extents may refer to the previous child */
+    bdrv_bsc_invalidate_all(bs);
     QLIST_INSERT_HEAD(&bs->children, child, next);
     if (bs->drv->is_filter || (child->role & BDRV_CHILD_FILTERED)) {
         /*
@@ -1483,6 +1487,8 @@ static void GRAPH_WRLOCK bdrv_child_cb_detach(BdrvChild *child)
 {
     BlockDriverState *bs = child->opaque;
 
+    bdrv_bsc_invalidate_all(bs);
+
     if (child->role & BDRV_CHILD_COW) {
         bdrv_backing_detach(child);
     }
@@ -5550,6 +5556,8 @@ int bdrv_replace_child_bs(BdrvChild *child, BlockDriverState *new_bs,
 
 static void bdrv_delete(BlockDriverState *bs)
 {
+    int i;
+
     assert(bdrv_op_blocker_is_empty(bs));
     assert(!bs->refcnt);
     GLOBAL_STATE_CODE();
@@ -5563,6 +5571,9 @@ static void bdrv_delete(BlockDriverState *bs)
     bdrv_close(bs);
 
     qemu_mutex_destroy(&bs->reqs_lock);
+    for (i = 0; i < BDRV_TRACKED_REQ_SHARDS; i++) {
+        qemu_mutex_destroy(&bs->tracked_requests[i].lock);
+    }
 
     g_free(bs);
 }
@@ -5662,6 +5673,10 @@ int coroutine_fn bdrv_co_check(BlockDriverState *bs,
     }
 
     memset(res, 0, sizeof(*res));
+    if (fix) {
+        /* Repairing may change any mapping */
+        bdrv_bsc_invalidate_all(bs);
+    }
     return bs->drv->bdrv_co_check(bs, res, fix);
 }
 
@@ -6917,6 +6932,9 @@ int coroutine_fn bdrv_co_invalidate_cache(BlockDriverState *bs, Error **errp)
     assert(!(bs->open_flags & BDRV_O_INACTIVE));
     assert_bdrv_graph_readable();
 
+    /* Another process may have written to the image meanwhile */
+    bdrv_bsc_invalidate_all(bs);
+
     if (bs->drv->bdrv_co_invalidate_cache) {
         bs->drv->bdrv_co_invalidate_cache(bs, &local_err);
         if (local_err) {
@@ -7817,6 +7835,7 @@ int bdrv_amend_options(BlockDriverState *bs, QemuOpts *opts,
                    bs->drv->format_name);
         return -ENOTSUP;
     }
+    bdrv_bsc_invalidate_all(bs);
     return bs->drv->bdrv_amend_options(bs, opts, status_cb,
                                        cb_opaque, force, errp);
 }
@@ -8278,6 +8297,7 @@ int bdrv_make_empty(BdrvChild *c, Error **errp)
     }
 
     ret = drv->bdrv_make_empty(c->bs);
+    bdrv_bsc_invalidate_all(c->bs);
     if (ret < 0) {
         error_setg_errno(errp, -ret, "Failed to empty %s",
                          c->bs->filename);
@@ -8448,41 +8468,77 @@ BlockDriverState *bdrv_backing_chain_next(BlockDriverState *bs)
     return bdrv_skip_filters(bdrv_cow_bs(bdrv_skip_filters(bs)));
 }
 
-/**
- * Check whether [offset, offset + bytes) overlaps with the cached
- * block-status data region.
+/*
+ * Replace @old by a copy without the entries that overlap
+ * [offset, offset + bytes).  Returns true if @old did not need to be
+ * replaced or could be replaced, false if the cache was changed
+ * concurrently and the caller needs to retry.
  *
- * If so, and @pnum is not NULL, set *pnum to `bsc.data_end - offset`,
- * which is what bdrv_bsc_is_data()'s interface needs.
- * Otherwise, *pnum is not touched.
+ * Called under an RCU read guard.
  */
-static bool bdrv_bsc_range_overlaps_locked(BlockDriverState *bs,
-                                           int64_t offset, int64_t bytes,
-                                           int64_t *pnum)
+static bool bdrv_bsc_try_invalidate_locked(BlockDriverState *bs,
+                                           BdrvBlockStatusCache *old,
+                                           int64_t offset, int64_t bytes)
 {
-    BdrvBlockStatusCache *bsc = qatomic_rcu_read(&bs->block_status_cache);
-    bool overlaps;
+    BdrvBlockStatusCache *new_bsc;
+    int i;
 
-    overlaps =
-        qatomic_read(&bsc->valid) &&
-        ranges_overlap(offset, bytes, bsc->data_start,
-                       bsc->data_end - bsc->data_start);
+    for (i = 0; i < old->nb_entries; i++) {
+        BdrvBlockStatusCacheEntry *e = &old->entries[i];
 
-    if (overlaps && pnum) {
-        *pnum = bsc->data_end - offset;
+        if (ranges_overlap(offset, bytes, e->start, e->end - e->start)) {
+            break;
+        }
+    }
+    if (i == old->nb_entries) {
+        return true;
     }
 
-    return overlaps;
+    new_bsc = g_new0(BdrvBlockStatusCache, 1);
+    for (i = 0; i < old->nb_entries; i++) {
+        BdrvBlockStatusCacheEntry *e = &old->entries[i];
+
+        if (!ranges_overlap(offset, bytes, e->start, e->end - e->start)) {
+            new_bsc->entries[new_bsc->nb_entries++] = *e;
+        }
+    }
+
+    if (qatomic_cmpxchg(&bs->block_status_cache, old, new_bsc) != old) {
+        g_free(new_bsc);
+        return false;
+    }
+
+    g_free_rcu(old, rcu);
+    return true;
 }
 
 /**
  * See block_int.h for this function's documentation.
  */
-bool bdrv_bsc_is_data(BlockDriverState *bs, int64_t offset, int64_t *pnum)
+bool bdrv_bsc_lookup(BlockDriverState *bs, int64_t offset, int *status,
+                     int64_t *pnum, int64_t *map, BlockDriverState **file)
 {
+    BdrvBlockStatusCache *bsc;
+    int i;
+
     IO_CODE();
     RCU_READ_LOCK_GUARD();
-    return bdrv_bsc_range_overlaps_locked(bs, offset, 1, pnum);
+
+    bsc = qatomic_rcu_read(&bs->block_status_cache);
+    for (i = 0; i < bsc->nb_entries; i++) {
+        BdrvBlockStatusCacheEntry *e = &bsc->entries[i];
+
+        if (offset >= e->start && offset < e->end) {
+            qatomic_set(&e->last_hit, qatomic_fetch_inc(&bsc->clock));
+            *status = e->status;
+            *pnum = e->end - offset;
+            *map = e->map + (offset - e->start);
+            *file = e->file;
+            return true;
+        }
+    }
+
+    return false;
 }
 
 /**
@@ -8494,31 +8550,100 @@ void bdrv_bsc_invalidate_range(BlockDriverState *bs,
     IO_CODE();
     RCU_READ_LOCK_GUARD();
 
-    if (bdrv_bsc_range_overlaps_locked(bs, offset, bytes, NULL)) {
-        qatomic_set(&bs->block_status_cache->valid, false);
+    while (!bdrv_bsc_try_invalidate_locked(
+                bs, qatomic_rcu_read(&bs->block_status_cache), offset, bytes))
+    {
+        /* Raced with a concurrent update, retry */
     }
 }
 
 /**
  * See block_int.h for this function's documentation.
  */
-void bdrv_bsc_fill(BlockDriverState *bs, int64_t offset, int64_t bytes)
+void bdrv_bsc_invalidate_all(BlockDriverState *bs)
 {
-    BdrvBlockStatusCache *new_bsc = g_new(BdrvBlockStatusCache, 1);
-    BdrvBlockStatusCache *old_bsc;
+    BdrvBlockStatusCache *new_bsc, *old_bsc;
+
     IO_CODE();
 
-    *new_bsc = (BdrvBlockStatusCache) {
-        .valid = true,
-        .data_start = offset,
-        .data_end = offset + bytes,
-    };
+    /* Nothing to do for closed nodes */
+    if (!qatomic_read(&bs->block_status_cache)) {
+        return;
+    }
+
+    new_bsc = g_new0(BdrvBlockStatusCache, 1);
+    old_bsc = qatomic_xchg(&bs->block_status_cache, new_bsc);
+    g_free_rcu(old_bsc, rcu);
+}
+
+/**
+ * See block_int.h for this function's documentation.
+ */
+void bdrv_bsc_fill(BlockDriverState *bs, int64_t offset, int64_t bytes,
+                   int status, int64_t map, BlockDriverState *file,
+                   unsigned int write_gen)
+{
+    BdrvBlockStatusCache *new_bsc, *old_bsc;
+    BdrvBlockStatusCacheEntry *e;
+    int i, victim = 0;
+
+    IO_CODE();
+
+    if (qatomic_read(&bs->write_gen) != write_gen) {
+        /* A write completed meanwhile, the status may be stale already */
+        return;
+    }
 
-    QEMU_LOCK_GUARD(&bs->bsc_modify_lock);
+    RCU_READ_LOCK_GUARD();
 
     old_bsc = qatomic_rcu_read(&bs->block_status_cache);
-    qatomic_rcu_set(&bs->block_status_cache, new_bsc);
-    if (old_bsc) {
-        g_free_rcu(old_bsc, rcu);
+    new_bsc = g_new0(BdrvBlockStatusCache, 1);
+    new_bsc->clock = qatomic_read(&old_bsc->clock);
+
+    /* Drop entries the new one supersedes */
+    for (i = 0; i < old_bsc->nb_entries; i++) {
+        e = &old_bsc->entries[i];
+        if (!ranges_overlap(offset, bytes, e->start, e->end - e->start)) {
+            new_bsc->entries[new_bsc->nb_entries] = *e;
+            new_bsc->entries[new_bsc->nb_entries].last_hit =
+                qatomic_read(&e->last_hit);
+            new_bsc->nb_entries++;
+        }
+    }
+
+    /* Evict the least recently used entry if the cache is full */
+    if (new_bsc->nb_entries == BDRV_BSC_ENTRIES) {
+        for (i = 1; i < BDRV_BSC_ENTRIES; i++) {
+            if (new_bsc->entries[i].last_hit <
+                new_bsc->entries[victim].last_hit) {
+                victim = i;
+            }
+        }
+    } else {
+        victim = new_bsc->nb_entries++;
+    }
+
+    new_bsc->entries[victim] = (BdrvBlockStatusCacheEntry) {
+        .start = offset,
+        .end = offset + bytes,
+        .status = status,
+        .map = map,
+        .file = file,
+        .last_hit = new_bsc->clock++,
+    };
+
+    if (qatomic_cmpxchg(&bs->block_status_cache, old_bsc, new_bsc) != old_bsc) {
+        /* Lost against a concurrent update, just skip caching this one */
+        g_free(new_bsc);
+        return;
+    }
+    g_free_rcu(old_bsc, rcu);
+
+    /*
+     * A write may have completed between the check above and publishing
+     * the entry, and its invalidation may not have seen the entry yet.
+     */
+    if (qatomic_read(&bs->write_gen) != write_gen) {
+        bdrv_bsc_invalidate_range(bs, offset, bytes);
     }
 }
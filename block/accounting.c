@@ -26,6 +26,7 @@
 #include "qemu/osdep.h"
 #include "block/accounting.h"
 #include "block/block_int.h"
+#include "qemu/host-utils.h"
 #include "qemu/timer.h"
 #include "system/qtest.h"
 #include "qapi/error.h"
@@ -95,13 +96,13 @@ void block_acct_add_interval(BlockAcctStats *stats, unsigned interval_length)
     s = g_new0(BlockAcctTimedStats, 1);
     s->interval_length = interval_length;
     s->stats = stats;
-    qemu_mutex_lock(&stats->lock);
-    QSLIST_INSERT_HEAD(&stats->intervals, s, entries);
-
     for (i = 0; i < BLOCK_MAX_IOTYPE; i++) {
         timed_average_init(&s->latency[i], clock_type,
                            (uint64_t) interval_length * NANOSECONDS_PER_SECOND);
     }
+
+    qemu_mutex_lock(&stats->lock);
+    QSLIST_INSERT_HEAD(&stats->intervals, s, entries);
     qemu_mutex_unlock(&stats->lock);
 }
 
@@ -186,6 +187,7 @@ int block_latency_histogram_set(BlockAcctStats *stats, enum BlockAcctType type,
         prev = entry->value;
     }
 
+    QEMU_LOCK_GUARD(&stats->lock);
     hist->nbins = new_nbins;
     g_free(hist->boundaries);
     hist->boundaries = g_new(uint64_t, hist->nbins - 1);
@@ -205,6 +207,7 @@ void block_latency_histograms_clear(BlockAcctStats *stats)
 {
     int i;
 
+    QEMU_LOCK_GUARD(&stats->lock);
     for (i = 0; i < BLOCK_MAX_IOTYPE; i++) {
         BlockLatencyHistogram *hist = &stats->latency_histogram[i];
         g_free(hist->bins);
@@ -213,12 +216,52 @@ void block_latency_histograms_clear(BlockAcctStats *stats)
     }
 }
 
+static BlockAcctShard *block_acct_shard(BlockAcctStats *stats)
+{
+    return &stats->shards[
+        qemu_get_current_aio_context_shard(BLOCK_ACCT_SHARDS_SHIFT)];
+}
+
+static unsigned block_acct_log_bucket(uint64_t latency_ns)
+{
+    unsigned bits;
+
+    if (latency_ns < (1 << BLOCK_ACCT_LOG_SUB_BITS)) {
+        return latency_ns;
+    }
+
+    bits = 64 - clz64(latency_ns);
+    if (bits > BLOCK_ACCT_LOG_MAX_BITS) {
+        return BLOCK_ACCT_LOG_BUCKETS - 1;
+    }
+
+    /* Top BLOCK_ACCT_LOG_SUB_BITS + 1 bits, the first of which is set */
+    return ((bits - BLOCK_ACCT_LOG_SUB_BITS) << BLOCK_ACCT_LOG_SUB_BITS) +
+        ((latency_ns >> (bits - BLOCK_ACCT_LOG_SUB_BITS - 1)) &
+         ((1 << BLOCK_ACCT_LOG_SUB_BITS) - 1));
+}
+
+/* Returns the smallest latency that is accounted after @bucket */
+static uint64_t block_acct_log_bucket_end(unsigned bucket)
+{
+    unsigned group = bucket >> BLOCK_ACCT_LOG_SUB_BITS;
+    uint64_t sub = bucket & ((1 << BLOCK_ACCT_LOG_SUB_BITS) - 1);
+
+    if (group == 0) {
+        return bucket + 1;
+    }
+    return ((1 << BLOCK_ACCT_LOG_SUB_BITS) + sub + 1) << (group - 1);
+}
+
 static void block_account_one_io(BlockAcctStats *stats, BlockAcctCookie *cookie,
                                  bool failed)
 {
+    BlockAcctShard *shard;
     BlockAcctTimedStats *s;
+    BlockLatencyHistogram *hist;
     int64_t time_ns = qemu_clock_get_ns(clock_type);
     int64_t latency_ns = time_ns - cookie->start_time_ns;
+    bool account_time;
 
     if (qtest_enabled()) {
         latency_ns = qtest_latency_ns;
@@ -230,21 +273,33 @@ static void block_account_one_io(BlockAcctStats *stats, BlockAcctCookie *cookie,
         return;
     }
 
-    WITH_QEMU_LOCK_GUARD(&stats->lock) {
-        if (failed) {
-            stats->failed_ops[cookie->type]++;
-        } else {
-            stats->nr_bytes[cookie->type] += cookie->bytes;
-            stats->nr_ops[cookie->type]++;
-        }
+    shard = block_acct_shard(stats);
+    if (failed) {
+        stat64_add(&shard->failed_ops[cookie->type], 1);
+    } else {
+        stat64_add(&shard->nr_bytes[cookie->type], cookie->bytes);
+        stat64_add(&shard->nr_ops[cookie->type], 1);
+    }
 
-        block_latency_histogram_account(&stats->latency_histogram[cookie->type],
-                                        latency_ns);
+    account_time = !failed || stats->account_failed;
+    if (account_time) {
+        stat64_add(&shard->total_time_ns[cookie->type], latency_ns);
+        stat64_max(&stats->last_access_time_ns, time_ns);
+        stat64_add(&stats->latency_log[cookie->type]
+                                      [block_acct_log_bucket(latency_ns)], 1);
+    }
 
-        if (!failed || stats->account_failed) {
-            stats->total_time_ns[cookie->type] += latency_ns;
-            stats->last_access_time_ns = time_ns;
+    /*
+     * Interval statistics and user-defined histograms are only kept if
+     * they were requested, so only take the lock if there is any.
+     */
+    hist = &stats->latency_histogram[cookie->type];
+    s = qatomic_read(&stats->intervals.slh_first);
+    if ((s && account_time) || qatomic_read(&hist->bins)) {
+        QEMU_LOCK_GUARD(&stats->lock);
 
+        block_latency_histogram_account(hist, latency_ns);
+        if (account_time) {
             QSLIST_FOREACH(s, &stats->intervals, entries) {
                 timed_average_account(&s->latency[cookie->type], latency_ns);
             }
@@ -272,13 +327,12 @@ void block_acct_invalid(BlockAcctStats *stats, enum BlockAcctType type)
      * not.  The reason is that invalid requests are accounted during their
      * submission, therefore there's no actual I/O involved.
      */
-    qemu_mutex_lock(&stats->lock);
-    stats->invalid_ops[type]++;
+    stat64_add(&block_acct_shard(stats)->invalid_ops[type], 1);
 
     if (stats->account_invalid) {
-        stats->last_access_time_ns = qemu_clock_get_ns(clock_type);
+        stat64_max(&stats->last_access_time_ns,
+                   qemu_clock_get_ns(clock_type));
     }
-    qemu_mutex_unlock(&stats->lock);
 }
 
 void block_acct_merge_done(BlockAcctStats *stats, enum BlockAcctType type,
@@ -286,14 +340,70 @@ void block_acct_merge_done(BlockAcctStats *stats, enum BlockAcctType type,
 {
     assert(type < BLOCK_MAX_IOTYPE);
 
-    qemu_mutex_lock(&stats->lock);
-    stats->merged[type] += num_requests;
-    qemu_mutex_unlock(&stats->lock);
+    stat64_add(&block_acct_shard(stats)->merged[type], num_requests);
+}
+
+void block_acct_get_counters(BlockAcctStats *stats, BlockAcctCounters *c)
+{
+    int i, type;
+
+    memset(c, 0, sizeof(*c));
+    for (i = 0; i < BLOCK_ACCT_SHARDS; i++) {
+        BlockAcctShard *shard = &stats->shards[i];
+
+        for (type = 0; type < BLOCK_MAX_IOTYPE; type++) {
+            c->nr_bytes[type] += stat64_get(&shard->nr_bytes[type]);
+            c->nr_ops[type] += stat64_get(&shard->nr_ops[type]);
+            c->invalid_ops[type] += stat64_get(&shard->invalid_ops[type]);
+            c->failed_ops[type] += stat64_get(&shard->failed_ops[type]);
+            c->total_time_ns[type] += stat64_get(&shard->total_time_ns[type]);
+            c->merged[type] += stat64_get(&shard->merged[type]);
+        }
+    }
+}
+
+int64_t block_acct_last_access_time_ns(BlockAcctStats *stats)
+{
+    return stat64_get(&stats->last_access_time_ns);
 }
 
 int64_t block_acct_idle_time_ns(BlockAcctStats *stats)
 {
-    return qemu_clock_get_ns(clock_type) - stats->last_access_time_ns;
+    return qemu_clock_get_ns(clock_type) -
+        block_acct_last_access_time_ns(stats);
+}
+
+/*
+ * Returns an upper bound for the latency of @permille thousandths of the
+ * requests of type @type, or 0 if there was none.
+ */
+uint64_t block_acct_latency_percentile(BlockAcctStats *stats,
+                                       enum BlockAcctType type,
+                                       unsigned permille)
+{
+    uint64_t counts[BLOCK_ACCT_LOG_BUCKETS];
+    uint64_t total = 0, target, sum = 0;
+    unsigned i;
+
+    assert(type < BLOCK_MAX_IOTYPE);
+    assert(permille <= 1000);
+
+    for (i = 0; i < BLOCK_ACCT_LOG_BUCKETS; i++) {
+        counts[i] = stat64_get(&stats->latency_log[type][i]);
+        total += counts[i];
+    }
+    if (!total) {
+        return 0;
+    }
+
+    target = MAX(DIV_ROUND_UP(total * permille, 1000), 1);
+    for (i = 0; i < BLOCK_ACCT_LOG_BUCKETS - 1; i++) {
+        sum += counts[i];
+        if (sum >= target) {
+            break;
+        }
+    }
+    return block_acct_log_bucket_end(i);
 }
 
 double block_acct_queue_depth(BlockAcctTimedStats *stats,
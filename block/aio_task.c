@@ -79,6 +79,16 @@ void coroutine_fn aio_task_pool_wait_slot(AioTaskPool *pool)
     aio_task_pool_wait_one(pool);
 }
 
+void coroutine_fn aio_task_pool_wait_busy(AioTaskPool *pool,
+                                         int max_busy_tasks)
+{
+    assert(max_busy_tasks > 0);
+
+    while (pool->busy_tasks >= MIN(max_busy_tasks, pool->max_busy_tasks)) {
+        aio_task_pool_wait_one(pool);
+    }
+}
+
 void coroutine_fn aio_task_pool_wait_all(AioTaskPool *pool)
 {
     while (pool->busy_tasks > 0) {
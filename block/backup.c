@@ -29,11 +29,24 @@
 
 #include "block/copy-before-write.h"
 
+/*
+ * A range of the source that is copied to its own target through its own
+ * copy-before-write filter.  Bits outside of [offset, offset + bytes) are
+ * never set in the block-copy bitmap of the partition.
+ */
+typedef struct BackupPartition {
+    BlockDriverState *cbw;
+    BlockDriverState *target_bs;
+    BlockCopyState *bcs;
+    BlockCopyCallState *bg_bcs_call;
+    int64_t cluster_size;
+    int64_t offset;
+    int64_t bytes;
+} BackupPartition;
+
 typedef struct BackupBlockJob {
     BlockJob common;
-    BlockDriverState *cbw;
     BlockDriverState *source_bs;
-    BlockDriverState *target_bs;
 
     BdrvDirtyBitmap *sync_bitmap;
 
@@ -42,13 +55,13 @@ typedef struct BackupBlockJob {
     BlockdevOnError on_source_error;
     BlockdevOnError on_target_error;
     uint64_t len;
-    int64_t cluster_size;
+    int64_t cluster_size; /* largest cluster size of all partitions */
     BackupPerf perf;
 
-    BlockCopyState *bcs;
+    BackupPartition *parts;
+    int nb_parts;
 
     bool wait;
-    BlockCopyCallState *bg_bcs_call;
 } BackupBlockJob;
 
 static const BlockJobDriver backup_job_driver;
@@ -76,9 +89,13 @@ static void backup_cleanup_sync_bitmap(BackupBlockJob *job, int ret)
     assert(bm);
 
     if (ret < 0 && job->bitmap_mode == BITMAP_SYNC_MODE_ALWAYS) {
+        int i;
+
         /* If we failed and synced, merge in the bits we didn't copy: */
-        bdrv_dirty_bitmap_merge_internal(bm, block_copy_dirty_bitmap(job->bcs),
-                                         NULL, true);
+        for (i = 0; i < job->nb_parts; i++) {
+            bdrv_dirty_bitmap_merge_internal(
+                bm, block_copy_dirty_bitmap(job->parts[i].bcs), NULL, true);
+        }
     }
 }
 
@@ -98,16 +115,45 @@ static void backup_abort(Job *job)
     }
 }
 
+static void backup_drop_partitions(BackupPartition *parts, int nb_parts)
+{
+    int i;
+
+    for (i = 0; i < nb_parts; i++) {
+        if (parts[i].cbw) {
+            bdrv_cbw_drop(parts[i].cbw);
+        }
+    }
+    g_free(parts);
+}
+
 static void backup_clean(Job *job)
 {
     BackupBlockJob *s = container_of(job, BackupBlockJob, common.job);
     block_job_remove_all_bdrv(&s->common);
-    bdrv_cbw_drop(s->cbw);
+    backup_drop_partitions(s->parts, s->nb_parts);
+    s->parts = NULL;
+    s->nb_parts = 0;
+}
+
+/* Clear the bits of a partition's block-copy bitmap outside of its range */
+static void backup_restrict_bitmap(BackupBlockJob *job, BackupPartition *p)
+{
+    BdrvDirtyBitmap *bcs_bitmap = block_copy_dirty_bitmap(p->bcs);
+    int64_t end = p->offset + p->bytes;
+
+    if (p->offset > 0) {
+        bdrv_reset_dirty_bitmap(bcs_bitmap, 0, p->offset);
+    }
+    if (end < job->len) {
+        bdrv_reset_dirty_bitmap(bcs_bitmap, end, job->len - end);
+    }
 }
 
 void backup_do_checkpoint(BlockJob *job, Error **errp)
 {
     BackupBlockJob *backup_job = container_of(job, BackupBlockJob, common);
+    int i;
 
     assert(block_job_driver(job) == &backup_job_driver);
 
@@ -117,8 +163,12 @@ void backup_do_checkpoint(BlockJob *job, Error **errp)
         return;
     }
 
-    bdrv_set_dirty_bitmap(block_copy_dirty_bitmap(backup_job->bcs), 0,
-                          backup_job->len);
+    for (i = 0; i < backup_job->nb_parts; i++) {
+        BackupPartition *p = &backup_job->parts[i];
+
+        bdrv_set_dirty_bitmap(block_copy_dirty_bitmap(p->bcs), p->offset,
+                              p->bytes);
+    }
 }
 
 static BlockErrorAction backup_error_action(BackupBlockJob *job,
@@ -133,72 +183,138 @@ static BlockErrorAction backup_error_action(BackupBlockJob *job,
     }
 }
 
+static bool backup_calls_finished(BackupBlockJob *job)
+{
+    int i;
+
+    for (i = 0; i < job->nb_parts; i++) {
+        BlockCopyCallState *call = job->parts[i].bg_bcs_call;
+
+        if (call && !block_copy_call_finished(call)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 static void coroutine_fn backup_block_copy_callback(void *opaque)
 {
     BackupBlockJob *s = opaque;
 
     if (s->wait) {
-        s->wait = false;
-        aio_co_wake(s->common.job.co);
+        /* Wake up once the calls of all partitions are done */
+        if (backup_calls_finished(s)) {
+            s->wait = false;
+            aio_co_wake(s->common.job.co);
+        }
     } else {
         job_enter(&s->common.job);
     }
 }
 
+/* Cancel the background block-copy calls and wait for them to finish */
+static void coroutine_fn backup_cancel_calls(BackupBlockJob *job)
+{
+    int i;
+
+    if (backup_calls_finished(job)) {
+        return;
+    }
+
+    for (i = 0; i < job->nb_parts; i++) {
+        BlockCopyCallState *call = job->parts[i].bg_bcs_call;
+
+        if (call && !block_copy_call_finished(call)) {
+            block_copy_call_cancel(call);
+        }
+    }
+
+    job->wait = true;
+    qemu_coroutine_yield();
+    assert(backup_calls_finished(job));
+}
+
+static void backup_free_calls(BackupBlockJob *job)
+{
+    int i;
+
+    for (i = 0; i < job->nb_parts; i++) {
+        block_copy_call_free(job->parts[i].bg_bcs_call);
+        job->parts[i].bg_bcs_call = NULL;
+    }
+}
+
 static int coroutine_fn backup_loop(BackupBlockJob *job)
 {
-    BlockCopyCallState *s = NULL;
+    BlockCopyCallState *failed;
     int ret = 0;
+    bool succeeded;
     bool error_is_read;
     BlockErrorAction act;
+    int i;
 
     while (true) { /* retry loop */
-        job->bg_bcs_call = s = block_copy_async(job->bcs, 0,
-                QEMU_ALIGN_UP(job->len, job->cluster_size),
-                job->perf.max_workers, job->perf.max_chunk,
-                backup_block_copy_callback, job);
+        /* All partitions are copied in parallel */
+        for (i = 0; i < job->nb_parts; i++) {
+            BackupPartition *p = &job->parts[i];
 
-        while (!block_copy_call_finished(s) &&
+            if (!p->bytes) {
+                continue;
+            }
+            p->bg_bcs_call = block_copy_async(p->bcs, p->offset,
+                    QEMU_ALIGN_UP(p->bytes, p->cluster_size),
+                    job->perf.max_workers, job->perf.max_chunk,
+                    backup_block_copy_callback, job);
+        }
+
+        while (!backup_calls_finished(job) &&
                !job_is_cancelled(&job->common.job))
         {
             job_yield(&job->common.job);
         }
 
-        if (!block_copy_call_finished(s)) {
+        if (!backup_calls_finished(job)) {
             assert(job_is_cancelled(&job->common.job));
             /*
              * Note that we can't use job_yield() here, as it doesn't work for
              * cancelled job.
              */
-            block_copy_call_cancel(s);
-            job->wait = true;
-            qemu_coroutine_yield();
-            assert(block_copy_call_finished(s));
+            backup_cancel_calls(job);
             ret = 0;
             goto out;
         }
 
-        if (job_is_cancelled(&job->common.job) ||
-            block_copy_call_succeeded(s))
-        {
+        failed = NULL;
+        succeeded = true;
+        for (i = 0; i < job->nb_parts; i++) {
+            BlockCopyCallState *call = job->parts[i].bg_bcs_call;
+
+            if (!call) {
+                continue;
+            }
+            if (!failed && block_copy_call_failed(call)) {
+                failed = call;
+            }
+            succeeded = succeeded && block_copy_call_succeeded(call);
+        }
+
+        if (job_is_cancelled(&job->common.job) || succeeded) {
             ret = 0;
             goto out;
         }
 
-        if (block_copy_call_cancelled(s)) {
+        if (!failed) {
             /*
-             * Job is not cancelled but only block-copy call. This is possible
+             * Job is not cancelled but only block-copy calls. This is possible
              * after job pause. Now the pause is finished, start new block-copy
              * iteration.
              */
-            block_copy_call_free(s);
+            backup_free_calls(job);
             continue;
         }
 
-        /* The only remaining case is failed block-copy call. */
-        assert(block_copy_call_failed(s));
-
-        ret = block_copy_call_status(s, &error_is_read);
+        /* The remaining case is a failed block-copy call. */
+        ret = block_copy_call_status(failed, &error_is_read);
         act = backup_error_action(job, error_is_read, -ret);
         switch (act) {
         case BLOCK_ERROR_ACTION_REPORT:
@@ -217,33 +333,38 @@ static int coroutine_fn backup_loop(BackupBlockJob *job)
             abort();
         }
 
-        block_copy_call_free(s);
+        backup_free_calls(job);
     }
 
 out:
-    block_copy_call_free(s);
-    job->bg_bcs_call = NULL;
+    backup_free_calls(job);
     return ret;
 }
 
 static void backup_init_bcs_bitmap(BackupBlockJob *job)
 {
-    uint64_t estimate;
-    BdrvDirtyBitmap *bcs_bitmap = block_copy_dirty_bitmap(job->bcs);
-
-    if (job->sync_mode == MIRROR_SYNC_MODE_BITMAP) {
-        bdrv_clear_dirty_bitmap(bcs_bitmap, NULL);
-        bdrv_dirty_bitmap_merge_internal(bcs_bitmap, job->sync_bitmap, NULL,
-                                         true);
-    } else if (job->sync_mode == MIRROR_SYNC_MODE_TOP) {
-        /*
-         * We can't hog the coroutine to initialize this thoroughly.
-         * Set a flag and resume work when we are able to yield safely.
-         */
-        block_copy_set_skip_unallocated(job->bcs, true);
-    }
+    uint64_t estimate = 0;
+    int i;
+
+    for (i = 0; i < job->nb_parts; i++) {
+        BackupPartition *p = &job->parts[i];
+        BdrvDirtyBitmap *bcs_bitmap = block_copy_dirty_bitmap(p->bcs);
+
+        if (job->sync_mode == MIRROR_SYNC_MODE_BITMAP) {
+            bdrv_clear_dirty_bitmap(bcs_bitmap, NULL);
+            bdrv_dirty_bitmap_merge_internal(bcs_bitmap, job->sync_bitmap,
+                                             NULL, true);
+            backup_restrict_bitmap(job, p);
+        } else if (job->sync_mode == MIRROR_SYNC_MODE_TOP) {
+            /*
+             * We can't hog the coroutine to initialize this thoroughly.
+             * Set a flag and resume work when we are able to yield safely.
+             */
+            block_copy_set_skip_unallocated(p->bcs, true);
+        }
 
-    estimate = bdrv_get_dirty_count(bcs_bitmap);
+        estimate += bdrv_get_dirty_count(bcs_bitmap);
+    }
     job_progress_set_remaining(&job->common.job, estimate);
 }
 
@@ -251,14 +372,16 @@ static int coroutine_fn backup_run(Job *job, Error **errp)
 {
     BackupBlockJob *s = container_of(job, BackupBlockJob, common.job);
     int ret;
+    int i;
 
     backup_init_bcs_bitmap(s);
 
-    if (s->sync_mode == MIRROR_SYNC_MODE_TOP) {
-        int64_t offset = 0;
+    for (i = 0; s->sync_mode == MIRROR_SYNC_MODE_TOP && i < s->nb_parts; i++) {
+        BackupPartition *p = &s->parts[i];
+        int64_t offset;
         int64_t count;
 
-        for (offset = 0; offset < s->len; ) {
+        for (offset = p->offset; offset < p->offset + p->bytes; ) {
             if (job_is_cancelled(job)) {
                 return -ECANCELED;
             }
@@ -271,7 +394,7 @@ static int coroutine_fn backup_run(Job *job, Error **errp)
 
             /* rdlock protects the subsequent call to bdrv_is_allocated() */
             bdrv_graph_co_rdlock();
-            ret = block_copy_reset_unallocated(s->bcs, offset, &count);
+            ret = block_copy_reset_unallocated(p->bcs, offset, &count);
             bdrv_graph_co_rdunlock();
             if (ret < 0) {
                 return ret;
@@ -279,13 +402,14 @@ static int coroutine_fn backup_run(Job *job, Error **errp)
 
             offset += count;
         }
-        block_copy_set_skip_unallocated(s->bcs, false);
+        block_copy_set_skip_unallocated(p->bcs, false);
     }
 
     if (s->sync_mode == MIRROR_SYNC_MODE_NONE) {
         /*
-         * All bits are set in bcs bitmap to allow any cluster to be copied.
-         * This does not actually require them to be copied.
+         * All bits of its range are set in the bcs bitmap of each
+         * partition to allow any cluster to be copied.  This does not
+         * actually require them to be copied.
          */
         while (!job_is_cancelled(job)) {
             /*
@@ -305,10 +429,23 @@ static void coroutine_fn backup_pause(Job *job)
 {
     BackupBlockJob *s = container_of(job, BackupBlockJob, common.job);
 
-    if (s->bg_bcs_call && !block_copy_call_finished(s->bg_bcs_call)) {
-        block_copy_call_cancel(s->bg_bcs_call);
-        s->wait = true;
-        qemu_coroutine_yield();
+    backup_cancel_calls(s);
+}
+
+/* The speed limit is shared evenly by all partitions */
+static void backup_set_partition_speed(BackupBlockJob *s, int64_t speed)
+{
+    int i;
+
+    if (speed) {
+        speed = MAX(speed / s->nb_parts, 1);
+    }
+
+    for (i = 0; i < s->nb_parts; i++) {
+        block_copy_set_speed(s->parts[i].bcs, speed);
+        if (s->parts[i].bg_bcs_call) {
+            block_copy_kick(s->parts[i].bg_bcs_call);
+        }
     }
 }
 
@@ -318,21 +455,55 @@ static void backup_set_speed(BlockJob *job, int64_t speed)
 
     /*
      * block_job_set_speed() is called first from block_job_create(), when we
-     * don't yet have s->bcs.
+     * don't yet have any partitions.
      */
-    if (s->bcs) {
-        block_copy_set_speed(s->bcs, speed);
-        if (s->bg_bcs_call) {
-            block_copy_kick(s->bg_bcs_call);
+    if (s->nb_parts) {
+        backup_set_partition_speed(s, speed);
+    }
+}
+
+static void backup_query(BlockJob *job, BlockJobInfo *info)
+{
+    BackupBlockJob *s = container_of(job, BackupBlockJob, common);
+    BlockJobInfoBackup backup = { 0 };
+    int i;
+
+    /* Workers and throughput add up, the latency is the worst one */
+    for (i = 0; i < s->nb_parts; i++) {
+        int64_t chunk, latency_ns;
+        uint64_t throughput;
+        int workers;
+
+        if (!block_copy_get_adaptive_stats(s->parts[i].bcs, &chunk, &workers,
+                                           &throughput, &latency_ns)) {
+            continue;
+        }
+
+        if (!backup.has_chunk_size) {
+            backup.has_chunk_size = true;
+            backup.chunk_size = chunk;
         }
+        backup.has_workers = true;
+        backup.workers += workers;
+        backup.has_throughput = true;
+        backup.throughput += throughput;
+        backup.has_latency_ns = true;
+        backup.latency_ns = MAX(backup.latency_ns, latency_ns);
+    }
+
+    if (backup.has_workers) {
+        info->u.backup = backup;
     }
 }
 
 static bool backup_cancel(Job *job, bool force)
 {
     BackupBlockJob *s = container_of(job, BackupBlockJob, common.job);
+    int i;
 
-    bdrv_cancel_in_flight(s->target_bs);
+    for (i = 0; i < s->nb_parts; i++) {
+        bdrv_cancel_in_flight(s->parts[i].target_bs);
+    }
     return true;
 }
 
@@ -350,10 +521,11 @@ static const BlockJobDriver backup_job_driver = {
         .cancel                 = backup_cancel,
     },
     .set_speed = backup_set_speed,
+    .query = backup_query,
 };
 
 BlockJob *backup_job_create(const char *job_id, BlockDriverState *bs,
-                  BlockDriverState *target, int64_t speed,
+                  BlockDriverState **targets, int nb_targets, int64_t speed,
                   MirrorSyncMode sync_mode, BdrvDirtyBitmap *sync_bitmap,
                   BitmapSyncMode bitmap_mode,
                   bool compress, bool discard_source,
@@ -368,21 +540,30 @@ BlockJob *backup_job_create(const char *job_id, BlockDriverState *bs,
 {
     int64_t len, target_len;
     BackupBlockJob *job = NULL;
-    int64_t cluster_size;
-    BlockDriverState *cbw = NULL;
-    BlockCopyState *bcs = NULL;
+    int64_t cluster_size = 0;
+    int64_t part_size;
+    BackupPartition *parts = NULL;
+    int i, j;
 
     assert(bs);
-    assert(target);
+    assert(nb_targets > 0);
     GLOBAL_STATE_CODE();
 
     /* QMP interface protects us from these cases */
     assert(sync_mode != MIRROR_SYNC_MODE_INCREMENTAL);
     assert(sync_bitmap || sync_mode != MIRROR_SYNC_MODE_BITMAP);
 
-    if (bs == target) {
-        error_setg(errp, "Source and target cannot be the same");
-        return NULL;
+    for (i = 0; i < nb_targets; i++) {
+        if (bs == targets[i]) {
+            error_setg(errp, "Source and target cannot be the same");
+            return NULL;
+        }
+        for (j = 0; j < i; j++) {
+            if (targets[j] == targets[i]) {
+                error_setg(errp, "Backup targets must be different nodes");
+                return NULL;
+            }
+        }
     }
 
     bdrv_graph_rdlock_main_loop();
@@ -392,24 +573,28 @@ BlockJob *backup_job_create(const char *job_id, BlockDriverState *bs,
         goto error_rdlock;
     }
 
-    if (!bdrv_is_inserted(target)) {
-        error_setg(errp, "Device is not inserted: %s",
-                   bdrv_get_device_name(target));
+    if (bdrv_op_is_blocked(bs, BLOCK_OP_TYPE_BACKUP_SOURCE, errp)) {
         goto error_rdlock;
     }
 
-    if (compress && !bdrv_supports_compressed_writes(target)) {
-        error_setg(errp, "Compression is not supported for this drive %s",
-                   bdrv_get_device_name(target));
-        goto error_rdlock;
-    }
+    for (i = 0; i < nb_targets; i++) {
+        BlockDriverState *target = targets[i];
 
-    if (bdrv_op_is_blocked(bs, BLOCK_OP_TYPE_BACKUP_SOURCE, errp)) {
-        goto error_rdlock;
-    }
+        if (!bdrv_is_inserted(target)) {
+            error_setg(errp, "Device is not inserted: %s",
+                       bdrv_get_device_name(target));
+            goto error_rdlock;
+        }
 
-    if (bdrv_op_is_blocked(target, BLOCK_OP_TYPE_BACKUP_TARGET, errp)) {
-        goto error_rdlock;
+        if (compress && !bdrv_supports_compressed_writes(target)) {
+            error_setg(errp, "Compression is not supported for this drive %s",
+                       bdrv_get_device_name(target));
+            goto error_rdlock;
+        }
+
+        if (bdrv_op_is_blocked(target, BLOCK_OP_TYPE_BACKUP_TARGET, errp)) {
+            goto error_rdlock;
+        }
     }
     bdrv_graph_rdunlock_main_loop();
 
@@ -445,26 +630,42 @@ BlockJob *backup_job_create(const char *job_id, BlockDriverState *bs,
         goto error;
     }
 
-    target_len = bdrv_getlength(target);
-    if (target_len < 0) {
-        GRAPH_RDLOCK_GUARD_MAINLOOP();
-        error_setg_errno(errp, -target_len, "Unable to get length for '%s'",
-                         bdrv_get_device_or_node_name(bs));
-        goto error;
-    }
+    for (i = 0; i < nb_targets; i++) {
+        target_len = bdrv_getlength(targets[i]);
+        if (target_len < 0) {
+            GRAPH_RDLOCK_GUARD_MAINLOOP();
+            error_setg_errno(errp, -target_len,
+                             "Unable to get length for '%s'",
+                             bdrv_get_device_or_node_name(targets[i]));
+            goto error;
+        }
 
-    if (target_len != len) {
-        error_setg(errp, "Source and target image have different sizes");
-        goto error;
+        if (target_len != len) {
+            error_setg(errp, "Source and target image have different sizes");
+            goto error;
+        }
     }
 
-    cbw = bdrv_cbw_append(bs, target, filter_node_name, discard_source,
-                          perf->min_cluster_size, &bcs, on_cbw_error, errp);
-    if (!cbw) {
-        goto error;
-    }
+    /*
+     * Every target gets a copy-before-write filter of its own.  Each one is
+     * inserted right above @bs, so the first one ends up on top.
+     */
+    parts = g_new0(BackupPartition, nb_targets);
+    for (i = 0; i < nb_targets; i++) {
+        BackupPartition *p = &parts[i];
+
+        p->target_bs = targets[i];
+        p->cbw = bdrv_cbw_append(bs, targets[i],
+                                 i == 0 ? filter_node_name : NULL,
+                                 discard_source, perf->min_cluster_size,
+                                 &p->bcs, on_cbw_error, errp);
+        if (!p->cbw) {
+            goto error;
+        }
 
-    cluster_size = block_copy_cluster_size(bcs);
+        p->cluster_size = block_copy_cluster_size(p->bcs);
+        cluster_size = MAX(cluster_size, p->cluster_size);
+    }
 
     if (perf->max_chunk && perf->max_chunk < cluster_size) {
         error_setg(errp, "Required max-chunk (%" PRIi64 ") is less than backup "
@@ -473,34 +674,46 @@ BlockJob *backup_job_create(const char *job_id, BlockDriverState *bs,
     }
 
     /* job->len is fixed, so we can't allow resize */
-    job = block_job_create(job_id, &backup_job_driver, txn, cbw,
+    job = block_job_create(job_id, &backup_job_driver, txn, parts[0].cbw,
                            0, BLK_PERM_ALL,
                            speed, creation_flags, cb, opaque, errp);
     if (!job) {
         goto error;
     }
 
-    job->cbw = cbw;
     job->source_bs = bs;
-    job->target_bs = target;
     job->on_source_error = on_source_error;
     job->on_target_error = on_target_error;
     job->sync_mode = sync_mode;
     job->sync_bitmap = sync_bitmap;
     job->bitmap_mode = bitmap_mode;
-    job->bcs = bcs;
+    job->parts = parts;
+    job->nb_parts = nb_targets;
     job->cluster_size = cluster_size;
     job->len = len;
     job->perf = *perf;
 
-    block_copy_set_copy_opts(bcs, perf->use_copy_range, compress);
-    block_copy_set_progress_meter(bcs, &job->common.job.progress);
-    block_copy_set_speed(bcs, speed);
+    /* Split the disk into equally sized ranges, aligned for all targets */
+    part_size = QEMU_ALIGN_UP(DIV_ROUND_UP(len, nb_targets), cluster_size);
+    for (i = 0; i < nb_targets; i++) {
+        BackupPartition *p = &parts[i];
+
+        p->offset = MIN(i * part_size, len);
+        p->bytes = MIN(part_size, len - p->offset);
+        backup_restrict_bitmap(job, p);
+
+        block_copy_set_copy_opts(p->bcs, perf->use_copy_range, compress);
+        block_copy_set_adaptive(p->bcs, perf->adaptive);
+        block_copy_set_progress_meter(p->bcs, &job->common.job.progress);
+    }
+    backup_set_partition_speed(job, speed);
 
     /* Required permissions are taken by copy-before-write filter target */
     bdrv_graph_wrlock_drained();
-    block_job_add_bdrv(&job->common, "target", target, 0, BLK_PERM_ALL,
-                       &error_abort);
+    for (i = 0; i < nb_targets; i++) {
+        block_job_add_bdrv(&job->common, "target", targets[i], 0, BLK_PERM_ALL,
+                           &error_abort);
+    }
     bdrv_graph_wrunlock();
 
     return &job->common;
@@ -509,8 +722,8 @@ BlockJob *backup_job_create(const char *job_id, BlockDriverState *bs,
     if (sync_bitmap) {
         bdrv_reclaim_dirty_bitmap(sync_bitmap, NULL);
     }
-    if (cbw) {
-        bdrv_cbw_drop(cbw);
+    if (parts) {
+        backup_drop_partitions(parts, nb_targets);
     }
 
     return NULL;
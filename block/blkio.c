@@ -18,6 +18,7 @@
 #include "qemu/error-report.h"
 #include "qobject/qdict.h"
 #include "qemu/module.h"
+#include "qemu/option.h"
 #include "system/block-backend.h"
 #include "system/memory.h" /* for ram_block_discard_disable() */
 
@@ -78,8 +79,28 @@ typedef struct {
 
     /* Are madvise(MADV_DONTNEED)-style operations unavailable? */
     bool may_pin_mem_regions;
+
+    /* The value of the "poll-hybrid" option */
+    bool poll_hybrid;
+
+    /* Latency of reads and writes, if poll_hybrid is set */
+    AioHybridPoll hybrid_poll;
 } BDRVBlkioState;
 
+static QemuOptsList blkio_runtime_opts = {
+    .name = "blkio",
+    .head = QTAILQ_HEAD_INITIALIZER(blkio_runtime_opts.head),
+    .desc = {
+        {
+            .name = "poll-hybrid",
+            .type = QEMU_OPT_BOOL,
+            .help = "sleep for half the average request latency before "
+                    "polling for completions (default: off)",
+        },
+        { /* end of list */ }
+    },
+};
+
 /* Called with s->bounce_lock held */
 static int blkio_resize_bounce_pool(BDRVBlkioState *s, int64_t bytes)
 {
@@ -339,6 +360,33 @@ static void blkio_submit_io(BlockDriverState *bs)
     defer_call(blkio_deferred_fn, s);
 }
 
+/*
+ * Submit a read or write and wait for its completion, feeding hybrid
+ * polling.  Completions are processed in the BDS's AioContext, so only
+ * requests submitted there delay polling.
+ */
+static void coroutine_fn blkio_co_submit_rw_and_wait(BlockDriverState *bs)
+{
+    BDRVBlkioState *s = bs->opaque;
+    AioContext *ctx = qemu_get_current_aio_context();
+    int64_t start_ns;
+
+    if (!s->poll_hybrid) {
+        blkio_submit_io(bs);
+        qemu_coroutine_yield();
+        return;
+    }
+
+    start_ns = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+    if (ctx == bdrv_get_aio_context(bs)) {
+        aio_hybrid_poll_submitted(ctx, &s->hybrid_poll);
+    }
+    blkio_submit_io(bs);
+    qemu_coroutine_yield();
+    aio_hybrid_poll_completed(&s->hybrid_poll,
+        qemu_clock_get_ns(QEMU_CLOCK_REALTIME) - start_ns);
+}
+
 static int coroutine_fn
 blkio_co_pdiscard(BlockDriverState *bs, int64_t offset, int64_t bytes)
 {
@@ -384,8 +432,7 @@ blkio_co_preadv(BlockDriverState *bs, int64_t offset, int64_t bytes,
         blkioq_readv(s->blkioq, offset, iov, iovcnt, &cod, 0);
     }
 
-    blkio_submit_io(bs);
-    qemu_coroutine_yield();
+    blkio_co_submit_rw_and_wait(bs);
 
     if (use_bounce_buffer) {
         if (cod.ret == 0) {
@@ -429,8 +476,7 @@ static int coroutine_fn blkio_co_pwritev(BlockDriverState *bs, int64_t offset,
         blkioq_writev(s->blkioq, offset, iov, iovcnt, &cod, blkio_flags);
     }
 
-    blkio_submit_io(bs);
-    qemu_coroutine_yield();
+    blkio_co_submit_rw_and_wait(bs);
 
     if (use_bounce_buffer) {
         blkio_free_bounce_buffer(s, &bounce);
@@ -796,8 +842,14 @@ static int blkio_open(BlockDriverState *bs, QDict *options, int flags,
 {
     const char *blkio_driver = bs->drv->protocol_name;
     BDRVBlkioState *s = bs->opaque;
+    QemuOpts *opts;
     int ret;
 
+    opts = qemu_opts_create(&blkio_runtime_opts, NULL, 0, &error_abort);
+    qemu_opts_absorb_qdict(opts, options, &error_abort);
+    s->poll_hybrid = qemu_opt_get_bool(opts, "poll-hybrid", false);
+    qemu_opts_del(opts);
+
     ret = blkio_create(blkio_driver, &s->blkio);
     if (ret < 0) {
         error_setg_errno(errp, -ret, "blkio_create failed: %s",
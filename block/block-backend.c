@@ -22,6 +22,8 @@
 #include "system/replay.h"
 #include "qapi/error.h"
 #include "qapi/qapi-events-block.h"
+#include "qemu/coroutine-tls.h"
+#include "qemu/defer-call.h"
 #include "qemu/id.h"
 #include "qemu/main-loop.h"
 #include "qemu/option.h"
@@ -33,6 +35,12 @@
 
 #define NOT_DONE 0x7fffffff /* used while emulated sync operation in progress */
 
+/*
+ * Maximum number of read/write requests queued for merging per thread, see
+ * blk_set_merge_requests().  A full queue is submitted right away.
+ */
+#define BLK_MERGE_MAX_QUEUED 64
+
 typedef struct BlockBackendAioNotifier {
     void (*attached_aio_context)(AioContext *new_context, void *opaque);
     void (*detach_aio_context)(void *opaque);
@@ -82,6 +90,7 @@ struct BlockBackend {
     QemuMutex queued_requests_lock; /* protects queued_requests */
     CoQueue queued_requests;
     bool disable_request_queuing; /* atomic */
+    bool merge_requests; /* atomic */
 
     VMChangeStateEntry *vmsh;
     bool force_allow_inactivate;
@@ -1267,6 +1276,18 @@ void blk_set_disable_request_queuing(BlockBackend *blk, bool disable)
     qatomic_set(&blk->disable_request_queuing, disable);
 }
 
+/*
+ * When enabled, blk_aio_preadv() and blk_aio_pwritev() requests issued within
+ * a defer_call_begin()/defer_call_end() section are held until the end of the
+ * section.  Then adjacent requests of the same type are submitted as a single
+ * request.  Requests are never held longer than the section that issued them.
+ */
+void blk_set_merge_requests(BlockBackend *blk, bool enable)
+{
+    IO_CODE();
+    qatomic_set(&blk->merge_requests, enable);
+}
+
 static int coroutine_fn GRAPH_RDLOCK
 blk_check_byte_request(BlockBackend *blk, int64_t offset, int64_t bytes)
 {
@@ -1560,6 +1581,28 @@ static const AIOCBInfo blk_aio_em_aiocb_info = {
     .aiocb_size         = sizeof(BlkAioEmAIOCB),
 };
 
+/* A read or write request waiting in the merge queue */
+typedef struct BlkMergeEntry {
+    BlkAioEmAIOCB *acb;
+    CoroutineEntry *co_entry;
+    unsigned seq; /* keeps the submission order of overlapping requests */
+} BlkMergeEntry;
+
+typedef struct {
+    BlkMergeEntry reqs[BLK_MERGE_MAX_QUEUED];
+    unsigned num_reqs;
+} BlkMergeQueue;
+
+/* Use get_ptr_blk_merge_queue() to fetch this thread-local value */
+QEMU_DEFINE_STATIC_CO_TLS(BlkMergeQueue, blk_merge_queue);
+
+/* Several queued requests submitted as one */
+typedef struct BlkMergedReq {
+    QEMUIOVector qiov;
+    int num_acbs;
+    BlkAioEmAIOCB *acbs[];
+} BlkMergedReq;
+
 static void blk_aio_complete(BlkAioEmAIOCB *acb)
 {
     if (acb->has_returned) {
@@ -1576,14 +1619,12 @@ static void blk_aio_complete_bh(void *opaque)
     blk_aio_complete(acb);
 }
 
-static BlockAIOCB *blk_aio_prwv(BlockBackend *blk, int64_t offset,
-                                int64_t bytes,
-                                void *iobuf, CoroutineEntry co_entry,
-                                BdrvRequestFlags flags,
-                                BlockCompletionFunc *cb, void *opaque)
+static BlkAioEmAIOCB *blk_aio_em_get(BlockBackend *blk, int64_t offset,
+                                     int64_t bytes, void *iobuf,
+                                     BdrvRequestFlags flags,
+                                     BlockCompletionFunc *cb, void *opaque)
 {
     BlkAioEmAIOCB *acb;
-    Coroutine *co;
 
     blk_inc_in_flight(blk);
     acb = blk_aio_get(&blk_aio_em_aiocb_info, blk, cb, opaque);
@@ -1596,7 +1637,14 @@ static BlockAIOCB *blk_aio_prwv(BlockBackend *blk, int64_t offset,
     };
     acb->bytes = bytes;
     acb->has_returned = false;
+    return acb;
+}
+
+static void blk_aio_em_submit(BlkAioEmAIOCB *acb, CoroutineEntry co_entry)
+{
+    Coroutine *co;
 
+    acb->has_returned = false;
     co = qemu_coroutine_create(co_entry, acb);
     aio_co_enter(qemu_get_current_aio_context(), co);
 
@@ -1605,7 +1653,18 @@ static BlockAIOCB *blk_aio_prwv(BlockBackend *blk, int64_t offset,
         replay_bh_schedule_oneshot_event(qemu_get_current_aio_context(),
                                          blk_aio_complete_bh, acb);
     }
+}
+
+static BlockAIOCB *blk_aio_prwv(BlockBackend *blk, int64_t offset,
+                                int64_t bytes,
+                                void *iobuf, CoroutineEntry co_entry,
+                                BdrvRequestFlags flags,
+                                BlockCompletionFunc *cb, void *opaque)
+{
+    BlkAioEmAIOCB *acb = blk_aio_em_get(blk, offset, bytes, iobuf, flags,
+                                        cb, opaque);
 
+    blk_aio_em_submit(acb, co_entry);
     return &acb->common;
 }
 
@@ -1633,6 +1692,145 @@ static void coroutine_fn blk_aio_write_entry(void *opaque)
     blk_aio_complete(acb);
 }
 
+static void blk_merge_complete(void *opaque, int ret)
+{
+    BlkMergedReq *m = opaque;
+    int i;
+
+    for (i = 0; i < m->num_acbs; i++) {
+        m->acbs[i]->rwco.ret = ret;
+        blk_aio_complete(m->acbs[i]);
+    }
+    qemu_iovec_destroy(&m->qiov);
+    g_free(m);
+}
+
+static void blk_merge_submit(BlkMergeEntry *reqs, int num_reqs, int niov)
+{
+    BlkAioEmAIOCB *first = reqs[0].acb;
+    BlockBackend *blk = first->rwco.blk;
+    BlkMergedReq *m;
+    int i;
+
+    if (num_reqs == 1) {
+        blk_aio_em_submit(first, reqs[0].co_entry);
+        return;
+    }
+
+    m = g_malloc(sizeof(*m) + num_reqs * sizeof(m->acbs[0]));
+    m->num_acbs = num_reqs;
+    qemu_iovec_init(&m->qiov, niov);
+    for (i = 0; i < num_reqs; i++) {
+        QEMUIOVector *qiov = reqs[i].acb->rwco.iobuf;
+
+        qemu_iovec_concat(&m->qiov, qiov, 0, qiov->size);
+        reqs[i].acb->has_returned = true;
+        m->acbs[i] = reqs[i].acb;
+    }
+
+    trace_blk_merge_requests(blk, first->rwco.offset, m->qiov.size, num_reqs);
+    block_acct_merge_done(blk_get_stats(blk),
+                          reqs[0].co_entry == blk_aio_read_entry ?
+                          BLOCK_ACCT_READ : BLOCK_ACCT_WRITE,
+                          num_reqs - 1);
+    blk_aio_prwv(blk, first->rwco.offset, m->qiov.size, &m->qiov,
+                 reqs[0].co_entry, first->rwco.flags, blk_merge_complete, m);
+}
+
+static int blk_merge_compare(const void *a, const void *b)
+{
+    const BlkMergeEntry *ea = a, *eb = b;
+    uintptr_t blk_a = (uintptr_t)ea->acb->rwco.blk;
+    uintptr_t blk_b = (uintptr_t)eb->acb->rwco.blk;
+    bool write_a = ea->co_entry == blk_aio_write_entry;
+    bool write_b = eb->co_entry == blk_aio_write_entry;
+
+    if (blk_a != blk_b) {
+        return blk_a < blk_b ? -1 : 1;
+    }
+    if (write_a != write_b) {
+        return write_a ? 1 : -1;
+    }
+    if (ea->acb->rwco.offset != eb->acb->rwco.offset) {
+        return ea->acb->rwco.offset < eb->acb->rwco.offset ? -1 : 1;
+    }
+    return ea->seq < eb->seq ? -1 : 1;
+}
+
+/* Submit the merge queue, combining adjacent requests */
+static void blk_merge_flush(void *opaque)
+{
+    BlkMergeQueue *q = get_ptr_blk_merge_queue();
+    BlkMergeEntry reqs[BLK_MERGE_MAX_QUEUED];
+    unsigned num_reqs = q->num_reqs;
+    unsigned start, i;
+
+    /* Completions may queue new requests, so work on a copy */
+    memcpy(reqs, q->reqs, num_reqs * sizeof(reqs[0]));
+    q->num_reqs = 0;
+
+    qsort(reqs, num_reqs, sizeof(reqs[0]), blk_merge_compare);
+
+    for (start = 0; start < num_reqs; start = i) {
+        BlkAioEmAIOCB *first = reqs[start].acb;
+        BlockBackend *blk = first->rwco.blk;
+        int max_iov = blk_bs(blk) ? blk_get_max_iov(blk) : 0;
+        uint64_t max_bytes = blk_get_max_transfer(blk);
+        int64_t end = first->rwco.offset + first->bytes;
+        int niov = ((QEMUIOVector *)first->rwco.iobuf)->niov;
+
+        for (i = start + 1; i < num_reqs; i++) {
+            BlkAioEmAIOCB *acb = reqs[i].acb;
+            QEMUIOVector *qiov = acb->rwco.iobuf;
+
+            if (acb->rwco.blk != blk ||
+                reqs[i].co_entry != reqs[start].co_entry ||
+                acb->rwco.flags != first->rwco.flags ||
+                acb->rwco.offset != end ||
+                end + acb->bytes - first->rwco.offset > max_bytes ||
+                niov + qiov->niov > max_iov) {
+                break;
+            }
+            end += acb->bytes;
+            niov += qiov->niov;
+        }
+
+        blk_merge_submit(&reqs[start], i - start, niov);
+    }
+}
+
+static BlockAIOCB *blk_aio_rw(BlockBackend *blk, int64_t offset,
+                              QEMUIOVector *qiov, CoroutineEntry co_entry,
+                              BdrvRequestFlags flags,
+                              BlockCompletionFunc *cb, void *opaque)
+{
+    BlkMergeQueue *q;
+    BlkAioEmAIOCB *acb;
+
+    assert((uint64_t)qiov->size <= INT64_MAX);
+    if (!qatomic_read(&blk->merge_requests)) {
+        return blk_aio_prwv(blk, offset, qiov->size, qiov, co_entry, flags,
+                            cb, opaque);
+    }
+
+    q = get_ptr_blk_merge_queue();
+    if (q->num_reqs == BLK_MERGE_MAX_QUEUED) {
+        blk_merge_flush(NULL);
+    }
+
+    acb = blk_aio_em_get(blk, offset, qiov->size, qiov, flags, cb, opaque);
+    q->reqs[q->num_reqs] = (BlkMergeEntry) {
+        .acb = acb,
+        .co_entry = co_entry,
+        .seq = q->num_reqs,
+    };
+    q->num_reqs++;
+
+    /* Runs immediately outside of a defer_call_begin()/defer_call_end() */
+    defer_call(blk_merge_flush, NULL);
+    return &acb->common;
+}
+
 BlockAIOCB *blk_aio_pwrite_zeroes(BlockBackend *blk, int64_t offset,
                                   int64_t bytes, BdrvRequestFlags flags,
                                   BlockCompletionFunc *cb, void *opaque)
@@ -1708,9 +1906,8 @@ BlockAIOCB *blk_aio_preadv(BlockBackend *blk, int64_t offset,
                            BlockCompletionFunc *cb, void *opaque)
 {
     IO_CODE();
-    assert((uint64_t)qiov->size <= INT64_MAX);
-    return blk_aio_prwv(blk, offset, qiov->size, qiov,
-                        blk_aio_read_entry, flags, cb, opaque);
+    return blk_aio_rw(blk, offset, qiov, blk_aio_read_entry, flags,
+                      cb, opaque);
 }
 
 BlockAIOCB *blk_aio_pwritev(BlockBackend *blk, int64_t offset,
@@ -1718,9 +1915,8 @@ BlockAIOCB *blk_aio_pwritev(BlockBackend *blk, int64_t offset,
                             BlockCompletionFunc *cb, void *opaque)
 {
     IO_CODE();
-    assert((uint64_t)qiov->size <= INT64_MAX);
-    return blk_aio_prwv(blk, offset, qiov->size, qiov,
-                        blk_aio_write_entry, flags, cb, opaque);
+    return blk_aio_rw(blk, offset, qiov, blk_aio_write_entry, flags,
+                      cb, opaque);
 }
 
 void blk_aio_cancel(BlockAIOCB *acb)
@@ -2821,6 +3017,25 @@ int coroutine_fn blk_co_copy_range(BlockBackend *blk_in, int64_t off_in,
                               bytes, read_flags, write_flags);
 }
 
+int coroutine_fn blk_co_share_range(BlockBackend *blk, int64_t src_offset,
+                                    int64_t dst_offset, int64_t bytes)
+{
+    int r;
+    IO_CODE();
+    GRAPH_RDLOCK_GUARD();
+
+    r = blk_check_byte_request(blk, src_offset, bytes);
+    if (r) {
+        return r;
+    }
+    r = blk_check_byte_request(blk, dst_offset, bytes);
+    if (r) {
+        return r;
+    }
+
+    return bdrv_co_share_range(blk->root, src_offset, dst_offset, bytes);
+}
+
 const BdrvChild *blk_root(BlockBackend *blk)
 {
     GLOBAL_STATE_CODE();
@@ -35,6 +35,9 @@
 #define BLOCK_COPY_MAX_WORKERS 64
 #define BLOCK_COPY_SLICE_TIME 100000000ULL /* ns */
 #define BLOCK_COPY_CLUSTER_SIZE_DEFAULT (1 << 16)
+#define BLOCK_COPY_ADAPTIVE_MAX_CHUNK (16 * MiB)
+#define BLOCK_COPY_ADAPTIVE_WORKERS_INIT 8
+#define BLOCK_COPY_ADAPTIVE_WINDOW_NS 100000000LL
 
 typedef enum {
     COPY_READ_WRITE_CLUSTER,
@@ -112,6 +115,30 @@ static int64_t task_end(BlockCopyTask *task)
     return task->req.offset + task->req.bytes;
 }
 
+/*
+ * State of the adaptive request sizing, see block_copy_adapt().
+ *
+ * Throughput and average latency of completed requests are sampled over
+ * windows of BLOCK_COPY_ADAPTIVE_WINDOW_NS.  After each window the chunk
+ * size and the number of parallel tasks are adjusted in the spirit of TCP
+ * congestion control: grow while throughput keeps improving, back off
+ * multiplicatively when it drops, and shrink chunks when latency goes up
+ * without any gain in throughput.
+ */
+typedef struct BlockCopyAdaptive {
+    bool enabled;
+    int64_t chunk; /* atomic reads outside of lock */
+    int workers; /* atomic reads outside of lock */
+    uint64_t throughput; /* atomic reads outside of lock */
+    int64_t latency_ns; /* atomic reads outside of lock */
+
+    /* Current sampling window */
+    int64_t window_start_ns;
+    int64_t window_bytes;
+    int64_t window_latency_ns;
+    int window_tasks;
+} BlockCopyAdaptive;
+
 typedef struct BlockCopyState {
     /*
      * BdrvChild objects are not owned or managed by block-copy. They are
@@ -138,6 +165,7 @@ typedef struct BlockCopyState {
     int64_t in_flight_bytes;
     BlockCopyMethod method;
     bool discard_source;
+    BlockCopyAdaptive adaptive;
     BlockReqList reqs;
     QLIST_HEAD(, BlockCopyCallState) calls;
     /*
@@ -165,6 +193,10 @@ typedef struct BlockCopyState {
 /* Called with lock held */
 static int64_t block_copy_chunk_size(BlockCopyState *s)
 {
+    if (s->adaptive.enabled && s->method != COPY_READ_WRITE_CLUSTER) {
+        return MIN(s->adaptive.chunk, s->max_transfer);
+    }
+
     switch (s->method) {
     case COPY_READ_WRITE_CLUSTER:
         return s->cluster_size;
@@ -181,6 +213,77 @@ static int64_t block_copy_chunk_size(BlockCopyState *s)
     }
 }
 
+/*
+ * Account a successfully completed task in the adaptive controller and, once
+ * per sampling window, adjust chunk size and parallelism.
+ *
+ * Called with lock held.
+ */
+static void block_copy_adapt(BlockCopyState *s, int64_t bytes,
+                             int64_t start_ns, int64_t end_ns)
+{
+    BlockCopyAdaptive *a = &s->adaptive;
+    int64_t chunk = a->chunk;
+    int workers = a->workers;
+    uint64_t throughput;
+    int64_t latency_ns;
+    int64_t elapsed;
+
+    /*
+     * Start the window together with its first request, so that idle time
+     * between block_copy() calls does not count as lost throughput.
+     */
+    if (!a->window_tasks) {
+        a->window_start_ns = start_ns;
+    }
+    a->window_bytes += bytes;
+    a->window_latency_ns += end_ns - start_ns;
+    a->window_tasks++;
+
+    elapsed = end_ns - a->window_start_ns;
+    if (elapsed < BLOCK_COPY_ADAPTIVE_WINDOW_NS) {
+        return;
+    }
+
+    throughput = (double)a->window_bytes * NANOSECONDS_PER_SECOND / elapsed;
+    latency_ns = a->window_latency_ns / a->window_tasks;
+
+    if (!a->throughput || throughput > a->throughput + a->throughput / 8) {
+        /* Still gaining: grow the requests first, then parallelism */
+        if (chunk < BLOCK_COPY_ADAPTIVE_MAX_CHUNK) {
+            chunk *= 2;
+        } else {
+            workers++;
+        }
+    } else if (throughput < a->throughput - a->throughput / 8) {
+        /* Throughput dropped: back off */
+        workers /= 2;
+        if (latency_ns > a->latency_ns) {
+            chunk /= 2;
+        }
+    } else if (latency_ns > a->latency_ns * 2) {
+        /* Same throughput at a higher latency: requests only queue up */
+        chunk /= 2;
+    } else {
+        /* Steady: probe for more bandwidth */
+        workers++;
+    }
+
+    chunk = MAX(MIN(chunk, BLOCK_COPY_ADAPTIVE_MAX_CHUNK), s->cluster_size);
+    workers = MAX(MIN(workers, BLOCK_COPY_MAX_WORKERS), 1);
+
+    trace_block_copy_adapt(s, throughput, latency_ns, chunk, workers);
+
+    qatomic_set(&a->chunk, chunk);
+    qatomic_set(&a->workers, workers);
+    qatomic_set(&a->throughput, throughput);
+    qatomic_set(&a->latency_ns, latency_ns);
+
+    a->window_bytes = 0;
+    a->window_latency_ns = 0;
+    a->window_tasks = 0;
+}
+
 /*
  * Search for the first dirty area in offset/bytes range and create task at
  * the beginning of it.
@@ -441,7 +544,7 @@ BlockCopyState *block_copy_state_new(BdrvChild *source, BdrvChild *target,
 
     ratelimit_init(&s->rate_limit);
     qemu_co_mutex_init(&s->lock);
-    QLIST_INIT(&s->reqs);
+    reqlist_init(&s->reqs);
     QLIST_INIT(&s->calls);
 
     return s;
@@ -472,6 +575,9 @@ static coroutine_fn int block_copy_task_run(AioTaskPool *pool,
         return ret;
     }
 
+    if (task->s->adaptive.enabled) {
+        aio_task_pool_wait_busy(pool, qatomic_read(&task->s->adaptive.workers));
+    }
     aio_task_pool_wait_slot(pool);
     if (aio_task_pool_status(pool) < 0) {
         co_put_to_shres(task->s->mem, task->req.bytes);
@@ -584,6 +690,7 @@ static coroutine_fn int block_copy_task_entry(AioTask *task)
     BlockCopyState *s = t->s;
     bool error_is_read = false;
     BlockCopyMethod method = t->method;
+    int64_t start_ns = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
     int ret = -1;
 
     WITH_GRAPH_RDLOCK_GUARD() {
@@ -601,8 +708,15 @@ static coroutine_fn int block_copy_task_entry(AioTask *task)
                 t->call_state->ret = ret;
                 t->call_state->error_is_read = error_is_read;
             }
-        } else if (s->progress) {
-            progress_work_done(s->progress, t->req.bytes);
+        } else {
+            if (s->progress) {
+                progress_work_done(s->progress, t->req.bytes);
+            }
+            /* Zero writes tell nothing about the data path */
+            if (s->adaptive.enabled && t->method != COPY_WRITE_ZEROES) {
+                block_copy_adapt(s, t->req.bytes, start_ns,
+                                 qemu_clock_get_ns(QEMU_CLOCK_REALTIME));
+            }
         }
     }
     co_put_to_shres(s->mem, t->req.bytes);
@@ -1062,6 +1176,31 @@ void block_copy_set_skip_unallocated(BlockCopyState *s, bool skip)
     qatomic_set(&s->skip_unallocated, skip);
 }
 
+/* Only set before running the job, no need for locking. */
+void block_copy_set_adaptive(BlockCopyState *s, bool adaptive)
+{
+    s->adaptive = (BlockCopyAdaptive) {
+        .enabled = adaptive,
+        .chunk = s->cluster_size,
+        .workers = BLOCK_COPY_ADAPTIVE_WORKERS_INIT,
+    };
+}
+
+bool block_copy_get_adaptive_stats(BlockCopyState *s, int64_t *chunk,
+                                   int *workers, uint64_t *throughput,
+                                   int64_t *latency_ns)
+{
+    if (!s->adaptive.enabled) {
+        return false;
+    }
+
+    *chunk = qatomic_read(&s->adaptive.chunk);
+    *workers = qatomic_read(&s->adaptive.workers);
+    *throughput = qatomic_read(&s->adaptive.throughput);
+    *latency_ns = qatomic_read(&s->adaptive.latency_ns);
+    return true;
+}
+
 void block_copy_set_speed(BlockCopyState *s, uint64_t speed)
 {
     ratelimit_set_speed(&s->rate_limit, speed, BLOCK_COPY_SLICE_TIME);
@@ -20,8 +20,10 @@
 
 #include "qemu/osdep.h"
 
+#include "block/aio_task.h"
 #include "block/block_int.h"
 #include "block/qdict.h"
+#include "block/thread-pool.h"
 #include "system/block-backend.h"
 #include "crypto/block.h"
 #include "qapi/opts-visitor.h"
@@ -32,6 +34,7 @@
 #include "qemu/option.h"
 #include "qemu/cutils.h"
 #include "qemu/memalign.h"
+#include "qemu/units.h"
 #include "crypto.h"
 
 typedef struct BlockCrypto BlockCrypto;
@@ -480,6 +483,88 @@ static int block_crypto_reopen_prepare(BDRVReopenState *state,
  */
 #define BLOCK_CRYPTO_MAX_IO_SIZE (1024 * 1024)
 
+/*
+ * Large requests are split into pieces of BLOCK_CRYPTO_TASK_SIZE that are
+ * encrypted/decrypted in parallel in the thread pool.  Smaller requests are
+ * processed in the coroutine, as the thread hop would cost more than it
+ * saves.
+ */
+#define BLOCK_CRYPTO_TASK_SIZE (64 * KiB)
+#define BLOCK_CRYPTO_MAX_WORKERS 8
+
+typedef struct BlockCryptoTask {
+    AioTask task;
+    QCryptoBlock *block;
+    uint64_t offset;
+    uint8_t *buf;
+    size_t len;
+    bool encrypt;
+} BlockCryptoTask;
+
+static int block_crypto_task_crypt(QCryptoBlock *block, uint64_t offset,
+                                   uint8_t *buf, size_t len, bool encrypt)
+{
+    if (encrypt) {
+        return qcrypto_block_encrypt(block, offset, buf, len, NULL);
+    }
+    return qcrypto_block_decrypt(block, offset, buf, len, NULL);
+}
+
+static int block_crypto_task_func(void *opaque)
+{
+    BlockCryptoTask *t = opaque;
+
+    return block_crypto_task_crypt(t->block, t->offset, t->buf, t->len,
+                                   t->encrypt);
+}
+
+static int coroutine_fn block_crypto_task_entry(AioTask *task)
+{
+    BlockCryptoTask *t = container_of(task, BlockCryptoTask, task);
+
+    return thread_pool_submit_co(block_crypto_task_func, t) < 0 ? -EIO : 0;
+}
+
+static int coroutine_fn block_crypto_co_crypt(QCryptoBlock *block,
+                                              uint64_t offset, uint8_t *buf,
+                                              size_t len, bool encrypt)
+{
+    AioTaskPool *pool;
+    int ret;
+
+    if (len <= BLOCK_CRYPTO_TASK_SIZE) {
+        if (block_crypto_task_crypt(block, offset, buf, len, encrypt) < 0) {
+            return -EIO;
+        }
+        return 0;
+    }
+
+    pool = aio_task_pool_new(BLOCK_CRYPTO_MAX_WORKERS);
+    while (len && aio_task_pool_status(pool) == 0) {
+        size_t cur_len = MIN(len, BLOCK_CRYPTO_TASK_SIZE);
+        BlockCryptoTask *t = g_new(BlockCryptoTask, 1);
+
+        *t = (BlockCryptoTask) {
+            .task.func = block_crypto_task_entry,
+            .block = block,
+            .offset = offset,
+            .buf = buf,
+            .len = cur_len,
+            .encrypt = encrypt,
+        };
+        aio_task_pool_start_task(pool, &t->task);
+
+        offset += cur_len;
+        buf += cur_len;
+        len -= cur_len;
+    }
+    aio_task_pool_wait_all(pool);
+    ret = aio_task_pool_status(pool);
+    aio_task_pool_free(pool);
+
+    return ret;
+}
+
 static int coroutine_fn GRAPH_RDLOCK
 block_crypto_co_preadv(BlockDriverState *bs, int64_t offset, int64_t bytes,
                        QEMUIOVector *qiov, BdrvRequestFlags flags)
@@ -522,9 +607,9 @@ block_crypto_co_preadv(BlockDriverState *bs, int64_t offset, int64_t bytes,
             goto cleanup;
         }
 
-        if (qcrypto_block_decrypt(crypto->block, offset + bytes_done,
-                                  cipher_data, cur_bytes, NULL) < 0) {
-            ret = -EIO;
+        ret = block_crypto_co_crypt(crypto->block, offset + bytes_done,
+                                    cipher_data, cur_bytes, false);
+        if (ret < 0) {
             goto cleanup;
         }
 
@@ -579,9 +664,9 @@ block_crypto_co_pwritev(BlockDriverState *bs, int64_t offset, int64_t bytes,
 
         qemu_iovec_to_buf(qiov, bytes_done, cipher_data, cur_bytes);
 
-        if (qcrypto_block_encrypt(crypto->block, offset + bytes_done,
-                                  cipher_data, cur_bytes, NULL) < 0) {
-            ret = -EIO;
+        ret = block_crypto_co_crypt(crypto->block, offset + bytes_done,
+                                    cipher_data, cur_bytes, true);
+        if (ret < 0) {
             goto cleanup;
         }
 
@@ -34,6 +34,7 @@
 #include "crypto/secret.h"
 #include <curl/curl.h>
 #include "qemu/cutils.h"
+#include "qemu/units.h"
 #include "trace.h"
 
 // #define DEBUG_VERBOSE
@@ -48,8 +49,9 @@
                    CURLPROTO_FTP | CURLPROTO_FTPS)
 #endif
 
-#define CURL_NUM_STATES 8
 #define CURL_NUM_ACB    8
+#define CURL_MAX_CONNECTIONS 64
+#define CURL_READAHEAD_MAX (8 * MiB)
 #define CURL_TIMEOUT_MAX 10000
 
 #define CURL_BLOCK_OPT_URL       "url"
@@ -62,10 +64,12 @@
 #define CURL_BLOCK_OPT_PASSWORD_SECRET "password-secret"
 #define CURL_BLOCK_OPT_PROXY_USERNAME "proxy-username"
 #define CURL_BLOCK_OPT_PROXY_PASSWORD_SECRET "proxy-password-secret"
+#define CURL_BLOCK_OPT_CONNECTIONS "connections"
 
 #define CURL_BLOCK_OPT_READAHEAD_DEFAULT (256 * 1024)
 #define CURL_BLOCK_OPT_SSLVERIFY_DEFAULT true
 #define CURL_BLOCK_OPT_TIMEOUT_DEFAULT 5
+#define CURL_BLOCK_OPT_CONNECTIONS_DEFAULT 8
 
 struct BDRVCURLState;
 struct CURLState;
@@ -101,16 +105,22 @@ typedef struct CURLState
     char range[128];
     char errmsg[CURL_ERROR_SIZE];
     char in_use;
+    uint64_t last_used; /* for LRU reuse of orig_buf */
 } CURLState;
 
 typedef struct BDRVCURLState {
     CURLM *multi;
     QEMUTimer timer;
     uint64_t len;
-    CURLState states[CURL_NUM_STATES];
+    CURLState *states;
+    int num_states;
+    uint64_t lru_clock;
     GHashTable *sockets; /* GINT_TO_POINTER(fd) -> socket */
     char *url;
     size_t readahead_size;
+    /* Grows while the guest reads sequentially past the readahead */
+    size_t cur_readahead;
+    uint64_t next_seq_start;
     bool sslverify;
     uint64_t timeout;
     char *cookie;
@@ -266,7 +276,7 @@ curl_find_buf(BDRVCURLState *s, uint64_t start, uint64_t len, CURLAIOCB *acb)
     uint64_t clamped_end = MIN(end, s->len);
     uint64_t clamped_len = clamped_end - start;
 
-    for (i=0; i<CURL_NUM_STATES; i++) {
+    for (i = 0; i < s->num_states; i++) {
         CURLState *state = &s->states[i];
         uint64_t buf_end = (state->buf_start + state->buf_off);
         uint64_t buf_fend = (state->buf_start + state->buf_len);
@@ -284,6 +294,7 @@ curl_find_buf(BDRVCURLState *s, uint64_t start, uint64_t len, CURLAIOCB *acb)
         {
             char *buf = state->orig_buf + (start - state->buf_start);
 
+            state->last_used = ++s->lru_clock;
             qemu_iovec_from_buf(acb->qiov, 0, buf, clamped_len);
             if (clamped_len < len) {
                 qemu_iovec_memset(acb->qiov, clamped_len, 0, len - clamped_len);
@@ -445,19 +456,27 @@ static void curl_multi_timeout_do(void *arg)
     qemu_mutex_unlock(&s->mutex);
 }
 
-/* Called with s->mutex held.  */
+/*
+ * Pick the free state whose readahead buffer was used least recently, so
+ * that the buffers of all states act as an LRU cache.
+ *
+ * Called with s->mutex held.
+ */
 static CURLState *curl_find_state(BDRVCURLState *s)
 {
     CURLState *state = NULL;
     int i;
 
-    for (i = 0; i < CURL_NUM_STATES; i++) {
-        if (!s->states[i].in_use) {
+    for (i = 0; i < s->num_states; i++) {
+        if (!s->states[i].in_use &&
+            (!state || s->states[i].last_used < state->last_used)) {
             state = &s->states[i];
-            state->in_use = 1;
-            break;
         }
     }
+    if (state) {
+        state->in_use = 1;
+        state->last_used = ++s->lru_clock;
+    }
     return state;
 }
 
@@ -492,6 +511,12 @@ static int curl_init_state(BDRVCURLState *s, CURLState *state)
             curl_easy_setopt(state->curl, CURLOPT_FAILONERROR, 1L)) {
             goto err;
         }
+#ifdef CURLPIPE_MULTIPLEX
+        /* Prefer multiplexing over an existing HTTP/2 connection */
+        if (curl_easy_setopt(state->curl, CURLOPT_PIPEWAIT, 1L)) {
+            goto err;
+        }
+#endif
         if (s->username) {
             if (curl_easy_setopt(state->curl, CURLOPT_USERNAME, s->username)) {
                 goto err;
@@ -583,7 +608,7 @@ static void curl_detach_aio_context(BlockDriverState *bs)
 
     WITH_QEMU_LOCK_GUARD(&s->mutex) {
         curl_drop_all_sockets(s->sockets);
-        for (i = 0; i < CURL_NUM_STATES; i++) {
+        for (i = 0; i < s->num_states; i++) {
             if (s->states[i].in_use) {
                 curl_clean_state(&s->states[i]);
             }
@@ -619,6 +644,9 @@ static void curl_attach_aio_context(BlockDriverState *bs,
     curl_multi_setopt(s->multi, CURLMOPT_SOCKETFUNCTION, curl_sock_cb);
     curl_multi_setopt(s->multi, CURLMOPT_TIMERDATA, s);
     curl_multi_setopt(s->multi, CURLMOPT_TIMERFUNCTION, curl_timer_cb);
+#ifdef CURLPIPE_MULTIPLEX
+    curl_multi_setopt(s->multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+#endif
 }
 
 static QemuOptsList runtime_opts = {
@@ -675,6 +703,11 @@ static QemuOptsList runtime_opts = {
             .type = QEMU_OPT_STRING,
             .help = "ID of secret used as password for HTTP proxy auth",
         },
+        {
+            .name = CURL_BLOCK_OPT_CONNECTIONS,
+            .type = QEMU_OPT_NUMBER,
+            .help = "Maximum number of concurrent range requests",
+        },
         { /* end of list */ }
     },
 };
@@ -729,6 +762,15 @@ static int curl_open(BlockDriverState *bs, QDict *options, int flags,
                    s->readahead_size);
         goto out_noclean;
     }
+    s->cur_readahead = s->readahead_size;
+
+    s->num_states = qemu_opt_get_number(opts, CURL_BLOCK_OPT_CONNECTIONS,
+                                        CURL_BLOCK_OPT_CONNECTIONS_DEFAULT);
+    if (s->num_states < 1 || s->num_states > CURL_MAX_CONNECTIONS) {
+        error_setg(errp, "connections must be between 1 and %d",
+                   CURL_MAX_CONNECTIONS);
+        goto out_noclean;
+    }
 
     s->timeout = qemu_opt_get_number(opts, CURL_BLOCK_OPT_TIMEOUT,
                                      CURL_BLOCK_OPT_TIMEOUT_DEFAULT);
@@ -798,6 +840,7 @@ static int curl_open(BlockDriverState *bs, QDict *options, int flags,
     s->aio_context = bdrv_get_aio_context(bs);
     s->url = g_strdup(file);
     s->sockets = g_hash_table_new_full(NULL, NULL, NULL, g_free);
+    s->states = g_new0(CURLState, s->num_states);
     qemu_mutex_lock(&s->mutex);
     state = curl_find_state(s);
     qemu_mutex_unlock(&s->mutex);
@@ -869,6 +912,7 @@ out:
     state->curl = NULL;
 out_noclean:
     qemu_mutex_destroy(&s->mutex);
+    g_free(s->states);
     g_free(s->cookie);
     g_free(s->url);
     g_free(s->username);
@@ -921,10 +965,22 @@ static void coroutine_fn curl_do_preadv(BlockDriverState *bs, CURLAIOCB *acb)
     acb->start = 0;
     acb->end = MIN(acb->bytes, s->len - start);
 
+    /*
+     * A read that starts right where the previous request's readahead
+     * ended is sequential; fetch larger ranges while that goes on.
+     */
+    if (start == s->next_seq_start) {
+        s->cur_readahead = MIN(s->cur_readahead * 2,
+                               MAX(CURL_READAHEAD_MAX, s->readahead_size));
+    } else {
+        s->cur_readahead = s->readahead_size;
+    }
+
     state->buf_off = 0;
     g_free(state->orig_buf);
     state->buf_start = start;
-    state->buf_len = MIN(acb->end + s->readahead_size, s->len - start);
+    state->buf_len = MIN(acb->end + s->cur_readahead, s->len - start);
+    s->next_seq_start = start + state->buf_len;
     end = start + state->buf_len - 1;
     state->orig_buf = g_try_malloc(state->buf_len);
     if (state->buf_len && state->orig_buf == NULL) {
@@ -980,6 +1036,7 @@ static void curl_close(BlockDriverState *bs)
     qemu_mutex_destroy(&s->mutex);
 
     g_hash_table_destroy(s->sockets);
+    g_free(s->states);
     g_free(s->cookie);
     g_free(s->url);
     g_free(s->username);
@@ -997,8 +1054,8 @@ static void curl_refresh_filename(BlockDriverState *bs)
 {
     BDRVCURLState *s = bs->opaque;
 
-    /* "readahead" and "timeout" do not change the guest-visible data,
-     * so ignore them */
+    /* "readahead", "timeout" and "connections" do not change the
+     * guest-visible data, so ignore them */
     if (s->sslverify != CURL_BLOCK_OPT_SSLVERIFY_DEFAULT ||
         s->cookie || s->username || s->password || s->proxyusername ||
         s->proxypassword)
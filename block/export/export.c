@@ -72,6 +72,16 @@ static const BlockExportDriver *blk_exp_find_driver(BlockExportType type)
     return NULL;
 }
 
+static void blk_exp_unref_iothreads(BlockExport *exp)
+{
+    size_t i;
+
+    for (i = 0; i < exp->num_iothreads; i++) {
+        object_unref(OBJECT(exp->iothreads[i]));
+    }
+    g_free(exp->iothreads);
+}
+
 BlockExport *blk_exp_add(BlockExportOptions *export, Error **errp)
 {
     bool fixed_iothread = export->has_fixed_iothread && export->fixed_iothread;
@@ -81,6 +91,9 @@ BlockExport *blk_exp_add(BlockExportOptions *export, Error **errp)
     BlockDriverState *bs;
     BlockBackend *blk = NULL;
     AioContext *ctx;
+    const char *iothread_name;
+    strList *list;
+    size_t i;
     uint64_t perm;
     int ret;
 
@@ -114,16 +127,38 @@ BlockExport *blk_exp_add(BlockExportOptions *export, Error **errp)
         return NULL;
     }
 
+    if (export->iothreads) {
+        if (export->iothread) {
+            error_setg(errp, "iothread and iothreads are mutually exclusive");
+            return NULL;
+        }
+        if (!drv->supports_multithread) {
+            error_setg(errp, "Export type does not support multiple "
+                       "iothreads");
+            return NULL;
+        }
+        for (list = export->iothreads; list; list = list->next) {
+            if (!iothread_by_id(list->value)) {
+                error_setg(errp, "iothread \"%s\" not found", list->value);
+                return NULL;
+            }
+        }
+        /* The block node moves to the first iothread */
+        iothread_name = export->iothreads->value;
+    } else {
+        iothread_name = export->iothread;
+    }
+
     ctx = bdrv_get_aio_context(bs);
 
-    if (export->iothread) {
+    if (iothread_name) {
         IOThread *iothread;
         AioContext *new_ctx;
         Error **set_context_errp;
 
-        iothread = iothread_by_id(export->iothread);
+        iothread = iothread_by_id(iothread_name);
         if (!iothread) {
-            error_setg(errp, "iothread \"%s\" not found", export->iothread);
+            error_setg(errp, "iothread \"%s\" not found", iothread_name);
             goto fail;
         }
 
@@ -195,6 +230,15 @@ BlockExport *blk_exp_add(BlockExportOptions *export, Error **errp)
         .blk        = blk,
     };
 
+    for (list = export->iothreads; list; list = list->next) {
+        exp->num_iothreads++;
+    }
+    exp->iothreads = g_new(IOThread *, exp->num_iothreads);
+    for (list = export->iothreads, i = 0; list; list = list->next, i++) {
+        exp->iothreads[i] = iothread_by_id(list->value);
+        object_ref(OBJECT(exp->iothreads[i]));
+    }
+
     ret = drv->create(exp, export, errp);
     if (ret < 0) {
         goto fail;
@@ -211,6 +255,7 @@ fail:
         blk_unref(blk);
     }
     if (exp) {
+        blk_exp_unref_iothreads(exp);
         g_free(exp->id);
         g_free(exp);
     }
@@ -234,6 +279,7 @@ static void blk_exp_delete_bh(void *opaque)
     blk_set_dev_ops(exp->blk, NULL, NULL);
     blk_unref(exp->blk);
     qapi_event_send_block_export_deleted(exp->id);
+    blk_exp_unref_iothreads(exp);
     g_free(exp->id);
     g_free(exp);
 }
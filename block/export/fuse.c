@@ -29,6 +29,7 @@
 #include "qapi/qapi-commands-block.h"
 #include "qemu/main-loop.h"
 #include "system/block-backend.h"
+#include "system/iothread.h"
 
 #include <fuse.h>
 #include <fuse_lowlevel.h>
@@ -49,7 +50,8 @@ typedef struct FuseExport {
     BlockExport common;
 
     struct fuse_session *fuse_session;
-    struct fuse_buf fuse_buf;
+    /* A receive buffer kept for the next request, or NULL (atomic) */
+    struct fuse_buf *spare_buf;
     unsigned int in_flight; /* atomic */
     bool mounted, fd_handler_set_up;
 
@@ -64,6 +66,11 @@ typedef struct FuseExport {
     gid_t st_gid;
 } FuseExport;
 
+typedef struct FuseRequest {
+    FuseExport *exp;
+    struct fuse_buf *buf;
+} FuseRequest;
+
 static GHashTable *exports;
 static const struct fuse_lowlevel_ops fuse_ops;
 
@@ -79,14 +86,38 @@ static void read_from_fuse_export(void *opaque);
 static bool is_regular_file(const char *path, Error **errp);
 
 
+/**
+ * Install (or with @enable false, remove) the FUSE fd handler in every
+ * AioContext that serves @exp: each of the export's iothreads if the
+ * user gave several, otherwise the export's own context.
+ *
+ * All of them read from the same /dev/fuse fd.  The kernel hands each
+ * request to exactly one reader, and the reply goes back through the
+ * same fd, so no further coordination is needed.
+ */
+static void fuse_export_set_fd_handlers(FuseExport *exp, bool enable)
+{
+    int fd = fuse_session_fd(exp->fuse_session);
+    IOHandler *read_fn = enable ? read_from_fuse_export : NULL;
+    void *opaque = enable ? exp : NULL;
+    size_t i;
+
+    if (!exp->common.num_iothreads) {
+        aio_set_fd_handler(exp->common.ctx, fd, read_fn, NULL, NULL, NULL,
+                           opaque);
+    }
+    for (i = 0; i < exp->common.num_iothreads; i++) {
+        aio_set_fd_handler(iothread_get_aio_context(exp->common.iothreads[i]),
+                           fd, read_fn, NULL, NULL, NULL, opaque);
+    }
+    exp->fd_handler_set_up = enable;
+}
+
 static void fuse_export_drained_begin(void *opaque)
 {
     FuseExport *exp = opaque;
 
-    aio_set_fd_handler(exp->common.ctx,
-                       fuse_session_fd(exp->fuse_session),
-                       NULL, NULL, NULL, NULL, NULL);
-    exp->fd_handler_set_up = false;
+    fuse_export_set_fd_handlers(exp, false);
 }
 
 static void fuse_export_drained_end(void *opaque)
@@ -96,10 +127,7 @@ static void fuse_export_drained_end(void *opaque)
     /* Refresh AioContext in case it changed */
     exp->common.ctx = blk_get_aio_context(exp->common.blk);
 
-    aio_set_fd_handler(exp->common.ctx,
-                       fuse_session_fd(exp->fuse_session),
-                       read_from_fuse_export, NULL, NULL, NULL, exp);
-    exp->fd_handler_set_up = true;
+    fuse_export_set_fd_handlers(exp, true);
 }
 
 static bool fuse_export_drained_poll(void *opaque)
@@ -269,10 +297,17 @@ static int setup_fuse_export(FuseExport *exp, const char *mountpoint,
 
     g_hash_table_insert(exports, g_strdup(mountpoint), NULL);
 
-    aio_set_fd_handler(exp->common.ctx,
-                       fuse_session_fd(exp->fuse_session),
-                       read_from_fuse_export, NULL, NULL, NULL, exp);
-    exp->fd_handler_set_up = true;
+    /*
+     * Requests are received from the fd handler and processed in
+     * coroutines, so a reader must never block, not even when several
+     * iothreads race for the same request.
+     */
+    if (!qemu_set_blocking(fuse_session_fd(exp->fuse_session), false, errp)) {
+        ret = -EIO;
+        goto fail;
+    }
+
+    fuse_export_set_fd_handlers(exp, true);
 
     return 0;
 
@@ -281,6 +316,44 @@ fail:
     return ret;
 }
 
+static void fuse_buf_free(struct fuse_buf *buf)
+{
+    if (buf) {
+        free(buf->mem);
+        g_free(buf);
+    }
+}
+
+/**
+ * Finish a request started by read_from_fuse_export(), keeping its
+ * buffer for the next one unless there already is a spare buffer.
+ */
+static void fuse_request_done(FuseExport *exp, struct fuse_buf *buf)
+{
+    fuse_buf_free(qatomic_xchg(&exp->spare_buf, buf));
+
+    if (qatomic_fetch_dec(&exp->in_flight) == 1) {
+        aio_wait_kick(); /* wake AIO_WAIT_WHILE() */
+    }
+
+    blk_exp_unref(&exp->common);
+}
+
+/**
+ * Process one request.  The fuse_ops handlers run in this coroutine, so
+ * block layer I/O yields instead of blocking the event loop, and other
+ * requests are received and processed in the meantime.
+ */
+static void coroutine_fn co_process_fuse_request(void *opaque)
+{
+    FuseRequest *req = opaque;
+
+    fuse_session_process_buf(req->exp->fuse_session, req->buf);
+
+    fuse_request_done(req->exp, req->buf);
+    g_free(req);
+}
+
 /**
  * Callback to be invoked when the FUSE session FD can be read from.
  * (This is basically the FUSE event loop.)
@@ -288,27 +361,37 @@ fail:
 static void read_from_fuse_export(void *opaque)
 {
     FuseExport *exp = opaque;
+    struct fuse_buf *buf;
+    FuseRequest *req;
+    Coroutine *co;
     int ret;
 
     blk_exp_ref(&exp->common);
 
     qatomic_inc(&exp->in_flight);
 
+    /* Each request needs its own buffer, as write data is used in place */
+    buf = qatomic_xchg(&exp->spare_buf, NULL);
+    if (!buf) {
+        buf = g_new0(struct fuse_buf, 1);
+    }
+
     do {
-        ret = fuse_session_receive_buf(exp->fuse_session, &exp->fuse_buf);
+        ret = fuse_session_receive_buf(exp->fuse_session, buf);
     } while (ret == -EINTR);
     if (ret < 0) {
-        goto out;
-    }
-
-    fuse_session_process_buf(exp->fuse_session, &exp->fuse_buf);
-
-out:
-    if (qatomic_fetch_dec(&exp->in_flight) == 1) {
-        aio_wait_kick(); /* wake AIO_WAIT_WHILE() */
+        /* Including -EAGAIN if another iothread took the request */
+        fuse_request_done(exp, buf);
+        return;
     }
 
-    blk_exp_unref(&exp->common);
+    req = g_new(FuseRequest, 1);
+    *req = (FuseRequest) {
+        .exp = exp,
+        .buf = buf,
+    };
+    co = qemu_coroutine_create(co_process_fuse_request, req);
+    qemu_coroutine_enter(co);
 }
 
 static void fuse_export_shutdown(BlockExport *blk_exp)
@@ -319,10 +402,7 @@ static void fuse_export_shutdown(BlockExport *blk_exp)
         fuse_session_exit(exp->fuse_session);
 
         if (exp->fd_handler_set_up) {
-            aio_set_fd_handler(exp->common.ctx,
-                               fuse_session_fd(exp->fuse_session),
-                               NULL, NULL, NULL, NULL, NULL);
-            exp->fd_handler_set_up = false;
+            fuse_export_set_fd_handlers(exp, false);
         }
     }
 
@@ -347,7 +427,7 @@ static void fuse_export_delete(BlockExport *blk_exp)
         fuse_session_destroy(exp->fuse_session);
     }
 
-    free(exp->fuse_buf.mem);
+    fuse_buf_free(exp->spare_buf);
     g_free(exp->mountpoint);
 }
 
@@ -403,21 +483,24 @@ static void fuse_lookup(fuse_req_t req, fuse_ino_t parent, const char *name)
 /**
  * Let clients get file attributes (i.e., stat() the file).
  */
-static void fuse_getattr(fuse_req_t req, fuse_ino_t inode,
-                         struct fuse_file_info *fi)
+static void coroutine_fn fuse_getattr(fuse_req_t req, fuse_ino_t inode,
+                                      struct fuse_file_info *fi)
 {
     struct stat statbuf;
     int64_t length, allocated_blocks;
     time_t now = time(NULL);
     FuseExport *exp = fuse_req_userdata(req);
 
-    length = blk_getlength(exp->common.blk);
+    length = blk_co_getlength(exp->common.blk);
     if (length < 0) {
         fuse_reply_err(req, -length);
         return;
     }
 
-    allocated_blocks = bdrv_get_allocated_file_size(blk_bs(exp->common.blk));
+    WITH_GRAPH_RDLOCK_GUARD() {
+        allocated_blocks =
+            bdrv_co_get_allocated_file_size(blk_bs(exp->common.blk));
+    }
     if (allocated_blocks <= 0) {
         allocated_blocks = DIV_ROUND_UP(length, 512);
     } else {
@@ -441,8 +524,9 @@ static void fuse_getattr(fuse_req_t req, fuse_ino_t inode,
     fuse_reply_attr(req, &statbuf, 1.);
 }
 
-static int fuse_do_truncate(const FuseExport *exp, int64_t size,
-                            bool req_zero_write, PreallocMode prealloc)
+static int coroutine_fn fuse_do_truncate(const FuseExport *exp, int64_t size,
+                                         bool req_zero_write,
+                                         PreallocMode prealloc)
 {
     uint64_t blk_perm, blk_shared_perm;
     BdrvRequestFlags truncate_flags = 0;
@@ -472,8 +556,8 @@ static int fuse_do_truncate(const FuseExport *exp, int64_t size,
         }
     }
 
-    ret = blk_truncate(exp->common.blk, size, true, prealloc,
-                       truncate_flags, NULL);
+    ret = blk_co_truncate(exp->common.blk, size, true, prealloc,
+                          truncate_flags, NULL);
 
     if (add_resize_perm) {
         /* Must succeed, because we are only giving up the RESIZE permission */
@@ -493,8 +577,9 @@ static int fuse_do_truncate(const FuseExport *exp, int64_t size,
  * without allow_other cannot be given a different UID or GID, and
  * they cannot be given non-owner access.
  */
-static void fuse_setattr(fuse_req_t req, fuse_ino_t inode, struct stat *statbuf,
-                         int to_set, struct fuse_file_info *fi)
+static void coroutine_fn fuse_setattr(fuse_req_t req, fuse_ino_t inode,
+                                      struct stat *statbuf, int to_set,
+                                      struct fuse_file_info *fi)
 {
     FuseExport *exp = fuse_req_userdata(req);
     int supported_attrs;
@@ -573,8 +658,9 @@ static void fuse_open(fuse_req_t req, fuse_ino_t inode,
 /**
  * Handle client reads from the exported image.
  */
-static void fuse_read(fuse_req_t req, fuse_ino_t inode,
-                      size_t size, off_t offset, struct fuse_file_info *fi)
+static void coroutine_fn fuse_read(fuse_req_t req, fuse_ino_t inode,
+                                   size_t size, off_t offset,
+                                   struct fuse_file_info *fi)
 {
     FuseExport *exp = fuse_req_userdata(req);
     int64_t length;
@@ -591,7 +677,7 @@ static void fuse_read(fuse_req_t req, fuse_ino_t inode,
      * Clients will expect short reads at EOF, so we have to limit
      * offset+size to the image length.
      */
-    length = blk_getlength(exp->common.blk);
+    length = blk_co_getlength(exp->common.blk);
     if (length < 0) {
         fuse_reply_err(req, -length);
         return;
@@ -607,7 +693,7 @@ static void fuse_read(fuse_req_t req, fuse_ino_t inode,
         return;
     }
 
-    ret = blk_pread(exp->common.blk, offset, size, buf, 0);
+    ret = blk_co_pread(exp->common.blk, offset, size, buf, 0);
     if (ret >= 0) {
         fuse_reply_buf(req, buf, size);
     } else {
@@ -620,8 +706,9 @@ static void fuse_read(fuse_req_t req, fuse_ino_t inode,
 /**
  * Handle client writes to the exported image.
  */
-static void fuse_write(fuse_req_t req, fuse_ino_t inode, const char *buf,
-                       size_t size, off_t offset, struct fuse_file_info *fi)
+static void coroutine_fn fuse_write(fuse_req_t req, fuse_ino_t inode,
+                                    const char *buf, size_t size, off_t offset,
+                                    struct fuse_file_info *fi)
 {
     FuseExport *exp = fuse_req_userdata(req);
     int64_t length;
@@ -642,7 +729,7 @@ static void fuse_write(fuse_req_t req, fuse_ino_t inode, const char *buf,
      * Clients will expect short writes at EOF, so we have to limit
      * offset+size to the image length.
      */
-    length = blk_getlength(exp->common.blk);
+    length = blk_co_getlength(exp->common.blk);
     if (length < 0) {
         fuse_reply_err(req, -length);
         return;
@@ -660,7 +747,7 @@ static void fuse_write(fuse_req_t req, fuse_ino_t inode, const char *buf,
         }
     }
 
-    ret = blk_pwrite(exp->common.blk, offset, size, buf, 0);
+    ret = blk_co_pwrite(exp->common.blk, offset, size, buf, 0);
     if (ret >= 0) {
         fuse_reply_write(req, size);
     } else {
@@ -671,9 +758,9 @@ static void fuse_write(fuse_req_t req, fuse_ino_t inode, const char *buf,
 /**
  * Let clients perform various fallocate() operations.
  */
-static void fuse_fallocate(fuse_req_t req, fuse_ino_t inode, int mode,
-                           off_t offset, off_t length,
-                           struct fuse_file_info *fi)
+static void coroutine_fn fuse_fallocate(fuse_req_t req, fuse_ino_t inode,
+                                        int mode, off_t offset, off_t length,
+                                        struct fuse_file_info *fi)
 {
     FuseExport *exp = fuse_req_userdata(req);
     int64_t blk_len;
@@ -684,7 +771,7 @@ static void fuse_fallocate(fuse_req_t req, fuse_ino_t inode, int mode,
         return;
     }
 
-    blk_len = blk_getlength(exp->common.blk);
+    blk_len = blk_co_getlength(exp->common.blk);
     if (blk_len < 0) {
         fuse_reply_err(req, -blk_len);
         return;
@@ -725,8 +812,9 @@ static void fuse_fallocate(fuse_req_t req, fuse_ino_t inode, int mode,
         do {
             int size = MIN(length, BDRV_REQUEST_MAX_BYTES);
 
-            ret = blk_pwrite_zeroes(exp->common.blk, offset, size,
-                                    BDRV_REQ_MAY_UNMAP | BDRV_REQ_NO_FALLBACK);
+            ret = blk_co_pwrite_zeroes(exp->common.blk, offset, size,
+                                       BDRV_REQ_MAY_UNMAP |
+                                       BDRV_REQ_NO_FALLBACK);
             if (ret == -ENOTSUP) {
                 /*
                  * fallocate() specifies to return EOPNOTSUPP for unsupported
@@ -755,8 +843,8 @@ static void fuse_fallocate(fuse_req_t req, fuse_ino_t inode, int mode,
         do {
             int size = MIN(length, BDRV_REQUEST_MAX_BYTES);
 
-            ret = blk_pwrite_zeroes(exp->common.blk,
-                                    offset, size, 0);
+            ret = blk_co_pwrite_zeroes(exp->common.blk,
+                                       offset, size, 0);
             offset += size;
             length -= size;
         } while (ret == 0 && length > 0);
@@ -772,13 +860,13 @@ static void fuse_fallocate(fuse_req_t req, fuse_ino_t inode, int mode,
 /**
  * Let clients fsync the exported image.
  */
-static void fuse_fsync(fuse_req_t req, fuse_ino_t inode, int datasync,
-                       struct fuse_file_info *fi)
+static void coroutine_fn fuse_fsync(fuse_req_t req, fuse_ino_t inode,
+                                    int datasync, struct fuse_file_info *fi)
 {
     FuseExport *exp = fuse_req_userdata(req);
     int ret;
 
-    ret = blk_flush(exp->common.blk);
+    ret = blk_co_flush(exp->common.blk);
     fuse_reply_err(req, ret < 0 ? -ret : 0);
 }
 
@@ -786,8 +874,8 @@ static void fuse_fsync(fuse_req_t req, fuse_ino_t inode, int datasync,
  * Called before an FD to the exported image is closed.  (libfuse
  * notes this to be a way to return last-minute errors.)
  */
-static void fuse_flush(fuse_req_t req, fuse_ino_t inode,
-                        struct fuse_file_info *fi)
+static void coroutine_fn fuse_flush(fuse_req_t req, fuse_ino_t inode,
+                                    struct fuse_file_info *fi)
 {
     fuse_fsync(req, inode, 1, fi);
 }
@@ -796,8 +884,9 @@ static void fuse_flush(fuse_req_t req, fuse_ino_t inode,
 /**
  * Let clients inquire allocation status.
  */
-static void fuse_lseek(fuse_req_t req, fuse_ino_t inode, off_t offset,
-                       int whence, struct fuse_file_info *fi)
+static void coroutine_fn fuse_lseek(fuse_req_t req, fuse_ino_t inode,
+                                    off_t offset, int whence,
+                                    struct fuse_file_info *fi)
 {
     FuseExport *exp = fuse_req_userdata(req);
 
@@ -810,8 +899,8 @@ static void fuse_lseek(fuse_req_t req, fuse_ino_t inode, off_t offset,
         int64_t pnum;
         int ret;
 
-        ret = bdrv_block_status_above(blk_bs(exp->common.blk), NULL,
-                                      offset, INT64_MAX, &pnum, NULL, NULL);
+        ret = blk_co_block_status_above(exp->common.blk, NULL,
+                                        offset, INT64_MAX, &pnum, NULL, NULL);
         if (ret < 0) {
             fuse_reply_err(req, -ret);
             return;
@@ -829,7 +918,7 @@ static void fuse_lseek(fuse_req_t req, fuse_ino_t inode, off_t offset,
              * and @blk_len (the client-visible EOF).
              */
 
-            blk_len = blk_getlength(exp->common.blk);
+            blk_len = blk_co_getlength(exp->common.blk);
             if (blk_len < 0) {
                 fuse_reply_err(req, -blk_len);
                 return;
@@ -883,9 +972,10 @@ static const struct fuse_lowlevel_ops fuse_ops = {
 };
 
 const BlockExportDriver blk_exp_fuse = {
-    .type               = BLOCK_EXPORT_TYPE_FUSE,
-    .instance_size      = sizeof(FuseExport),
-    .create             = fuse_export_create,
-    .delete             = fuse_export_delete,
-    .request_shutdown   = fuse_export_shutdown,
+    .type                   = BLOCK_EXPORT_TYPE_FUSE,
+    .instance_size          = sizeof(FuseExport),
+    .supports_multithread   = true,
+    .create                 = fuse_export_create,
+    .delete                 = fuse_export_delete,
+    .request_shutdown       = fuse_export_shutdown,
 };
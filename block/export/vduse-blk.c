@@ -15,6 +15,7 @@
 
 #include "qapi/error.h"
 #include "block/export.h"
+#include "qemu/defer-call.h"
 #include "qemu/error-report.h"
 #include "util/block-helpers.h"
 #include "subprojects/libvduse/libvduse.h"
@@ -33,6 +34,7 @@ typedef struct VduseBlkExport {
     char *recon_file;
     unsigned int inflight; /* atomic */
     bool vqs_started;
+    bool poll;
 } VduseBlkExport;
 
 typedef struct VduseBlkReq {
@@ -59,10 +61,16 @@ static void vduse_blk_inflight_dec(VduseBlkExport *vblk_exp)
     }
 }
 
+static void vduse_blk_notify_deferred_fn(void *opaque)
+{
+    vduse_queue_notify(opaque);
+}
+
 static void vduse_blk_req_complete(VduseBlkReq *req, size_t in_len)
 {
     vduse_queue_push(req->vq, &req->elem, in_len);
-    vduse_queue_notify(req->vq);
+    /* One interrupt for all requests completed in a defer_call() section */
+    defer_call(vduse_blk_notify_deferred_fn, req->vq);
 
     free(req);
 }
@@ -96,6 +104,8 @@ static void vduse_blk_vq_handler(VduseDev *dev, VduseVirtq *vq)
 {
     VduseBlkExport *vblk_exp = vduse_dev_get_priv(dev);
 
+    defer_call_begin();
+
     while (1) {
         VduseBlkReq *req;
 
@@ -111,6 +121,8 @@ static void vduse_blk_vq_handler(VduseDev *dev, VduseVirtq *vq)
         vduse_blk_inflight_inc(vblk_exp);
         qemu_coroutine_enter(co);
     }
+
+    defer_call_end();
 }
 
 static void on_vduse_vq_kick(void *opaque)
@@ -128,18 +140,49 @@ static void on_vduse_vq_kick(void *opaque)
     vduse_blk_vq_handler(dev, vq);
 }
 
+static bool vduse_blk_vq_poll(void *opaque)
+{
+    return !vduse_queue_empty(opaque);
+}
+
+static void vduse_blk_vq_poll_ready(void *opaque)
+{
+    VduseVirtq *vq = opaque;
+
+    vduse_blk_vq_handler(vduse_queue_get_dev(vq), vq);
+}
+
+/* While the AioContext busy-polls the ring, the driver need not kick */
+static void vduse_blk_vq_poll_begin(void *opaque)
+{
+    vduse_queue_set_notification(opaque, false);
+}
+
+static void vduse_blk_vq_poll_end(void *opaque)
+{
+    vduse_queue_set_notification(opaque, true);
+}
+
 static void vduse_blk_enable_queue(VduseDev *dev, VduseVirtq *vq)
 {
     VduseBlkExport *vblk_exp = vduse_dev_get_priv(dev);
+    int fd = vduse_queue_get_fd(vq);
 
     if (!vblk_exp->vqs_started) {
         return; /* vduse_blk_drained_end() will start vqs later */
     }
 
-    aio_set_fd_handler(vblk_exp->export.ctx, vduse_queue_get_fd(vq),
-                       on_vduse_vq_kick, NULL, NULL, NULL, vq);
+    if (vblk_exp->poll) {
+        aio_set_fd_handler(vblk_exp->export.ctx, fd, on_vduse_vq_kick, NULL,
+                           vduse_blk_vq_poll, vduse_blk_vq_poll_ready, vq);
+        aio_set_fd_poll(vblk_exp->export.ctx, fd, vduse_blk_vq_poll_begin,
+                        vduse_blk_vq_poll_end);
+    } else {
+        aio_set_fd_handler(vblk_exp->export.ctx, fd,
+                           on_vduse_vq_kick, NULL, NULL, NULL, vq);
+    }
     /* Make sure we don't miss any kick after reconnecting */
-    eventfd_write(vduse_queue_get_fd(vq), 1);
+    eventfd_write(fd, 1);
 }
 
 static void vduse_blk_disable_queue(VduseDev *dev, VduseVirtq *vq)
@@ -307,6 +350,7 @@ static int vduse_blk_exp_create(BlockExport *exp, BlockExportOptions *opts,
     vblk_exp->handler.logical_block_size = logical_block_size;
     vblk_exp->handler.writable = opts->writable;
     vblk_exp->vqs_started = true;
+    vblk_exp->poll = vblk_opts->has_poll && vblk_opts->poll;
 
     config.capacity =
             cpu_to_le64(blk_getlength(exp->blk) >> VIRTIO_BLK_SECTOR_BITS);
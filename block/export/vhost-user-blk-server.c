@@ -10,6 +10,7 @@
  * later.  See the COPYING file in the top-level directory.
  */
 #include "qemu/osdep.h"
+#include "qemu/defer-call.h"
 #include "qemu/error-report.h"
 #include "block/block.h"
 #include "subprojects/libvhost-user/libvhost-user.h" /* only for the type definitions */
@@ -31,6 +32,12 @@ typedef struct VuBlkReq {
     struct VuVirtq *vq;
 } VuBlkReq;
 
+/* Identifies a virtqueue for deferred notification */
+typedef struct {
+    VuServer *server;
+    int idx;
+} VuBlkQueue;
+
 /* vhost user block device */
 typedef struct {
     BlockExport export;
@@ -38,14 +45,26 @@ typedef struct {
     VirtioBlkHandler handler;
     QIOChannelSocket *sioc;
     struct virtio_blk_config blkcfg;
+    VuBlkQueue *queues;
 } VuBlkExport;
 
+static void vu_blk_notify_deferred_fn(void *opaque)
+{
+    VuBlkQueue *queue = opaque;
+    VuDev *vu_dev = &queue->server->vu_dev;
+
+    vu_queue_notify(vu_dev, vu_get_queue(vu_dev, queue->idx));
+}
+
 static void vu_blk_req_complete(VuBlkReq *req, size_t in_len)
 {
     VuDev *vu_dev = &req->server->vu_dev;
+    VuBlkExport *vexp = container_of(req->server, VuBlkExport, vu_server);
 
     vu_queue_push(vu_dev, req->vq, &req->elem, in_len);
-    vu_queue_notify(vu_dev, req->vq);
+    /* One interrupt for all requests completed in a defer_call() section */
+    defer_call(vu_blk_notify_deferred_fn,
+               &vexp->queues[req->vq - vu_dev->vq]);
 
     free(req);
 }
@@ -84,6 +103,8 @@ static void vu_blk_process_vq(VuDev *vu_dev, int idx)
     VuServer *server = container_of(vu_dev, VuServer, vu_dev);
     VuVirtq *vq = vu_get_queue(vu_dev, idx);
 
+    defer_call_begin();
+
     while (1) {
         VuBlkReq *req;
 
@@ -101,6 +122,8 @@ static void vu_blk_process_vq(VuDev *vu_dev, int idx)
         vhost_user_server_inc_in_flight(server);
         qemu_coroutine_enter(co);
     }
+
+    defer_call_end();
 }
 
 static void vu_blk_queue_set_started(VuDev *vu_dev, int idx, bool started)
@@ -321,6 +344,8 @@ static int vu_blk_exp_create(BlockExport *exp, BlockExportOptions *opts,
     BlockExportOptionsVhostUserBlk *vu_opts = &opts->u.vhost_user_blk;
     uint64_t logical_block_size;
     uint16_t num_queues = VHOST_USER_BLK_NUM_QUEUES_DEFAULT;
+    bool poll = vu_opts->has_poll && vu_opts->poll;
+    int i;
 
     vexp->blkcfg.wce = 0;
 
@@ -348,15 +373,24 @@ static int vu_blk_exp_create(BlockExport *exp, BlockExportOptions *opts,
     vu_blk_initialize_config(blk_bs(exp->blk), &vexp->blkcfg,
                              logical_block_size, num_queues);
 
+    vexp->queues = g_new(VuBlkQueue, num_queues);
+    for (i = 0; i < num_queues; i++) {
+        vexp->queues[i] = (VuBlkQueue) {
+            .server = &vexp->vu_server,
+            .idx    = i,
+        };
+    }
+
     blk_add_aio_context_notifier(exp->blk, blk_aio_attached, blk_aio_detach,
                                  vexp);
 
     blk_set_dev_ops(exp->blk, &vu_blk_dev_ops, vexp);
 
     if (!vhost_user_server_start(&vexp->vu_server, vu_opts->addr, exp->ctx,
-                                 num_queues, &vu_blk_iface, errp)) {
+                                 num_queues, poll, &vu_blk_iface, errp)) {
         blk_remove_aio_context_notifier(exp->blk, blk_aio_attached,
                                         blk_aio_detach, vexp);
+        g_free(vexp->queues);
         g_free(vexp->handler.serial);
         return -EADDRNOTAVAIL;
     }
@@ -370,6 +404,7 @@ static void vu_blk_exp_delete(BlockExport *exp)
 
     blk_remove_aio_context_notifier(exp->blk, blk_aio_attached, blk_aio_detach,
                                     vexp);
+    g_free(vexp->queues);
     g_free(vexp->handler.serial);
 }
 
@@ -183,8 +183,13 @@ typedef struct BDRVRawState {
     bool use_linux_aio:1;
     bool has_laio_fdsync:1;
     bool use_linux_io_uring:1;
+    bool use_io_uring_fixed:1;
+    bool use_io_uring_fallocate:1;
+    bool use_poll_hybrid:1;
     bool use_mpath:1;
     int page_cache_inconsistent; /* errno from fdatasync failure */
+    int io_uring_fixed_file; /* io_uring fixed file slot or -1 */
+    AioHybridPoll hybrid_poll;
     bool has_fallocate;
     bool needs_alignment;
     bool force_alignment;
@@ -585,6 +590,18 @@ static QemuOptsList raw_runtime_opts = {
             .type = QEMU_OPT_NUMBER,
             .help = "AIO max batch size (0 = auto handled by AIO backend, default: 0)",
         },
+        {
+            .name = "io-uring-fixed",
+            .type = QEMU_OPT_BOOL,
+            .help = "register guest RAM and the image file with io_uring "
+                    "(default: off)",
+        },
+        {
+            .name = "poll-hybrid",
+            .type = QEMU_OPT_BOOL,
+            .help = "sleep for half the average request latency before "
+                    "polling for io_uring completions (default: off)",
+        },
         {
             .name = "locking",
             .type = QEMU_OPT_STRING,
@@ -663,6 +680,9 @@ static int raw_open_common(BlockDriverState *bs, QDict *options,
 #ifdef CONFIG_LINUX_IO_URING
     s->use_linux_io_uring = (aio == BLOCKDEV_AIO_OPTIONS_IO_URING);
 #endif
+    s->use_io_uring_fixed = qemu_opt_get_bool(opts, "io-uring-fixed", false);
+    s->use_poll_hybrid = qemu_opt_get_bool(opts, "poll-hybrid", false);
+    s->io_uring_fixed_file = -1;
 
     s->aio_max_batch = qemu_opt_get_number(opts, "aio-max-batch", 0);
 
@@ -773,6 +793,18 @@ static int raw_open_common(BlockDriverState *bs, QDict *options,
 #endif /* !defined(CONFIG_LINUX_IO_URING) */
     }
 
+    if (s->use_io_uring_fixed && !s->use_linux_io_uring) {
+        error_setg(errp, "io-uring-fixed=on requires aio=io_uring");
+        ret = -EINVAL;
+        goto fail;
+    }
+
+    if (s->use_poll_hybrid && !s->use_linux_io_uring) {
+        error_setg(errp, "poll-hybrid=on requires aio=io_uring");
+        ret = -EINVAL;
+        goto fail;
+    }
+
     s->has_discard = true;
     s->has_write_zeroes = true;
 
@@ -790,6 +822,10 @@ static int raw_open_common(BlockDriverState *bs, QDict *options,
             goto fail;
         } else {
             s->has_fallocate = true;
+#ifdef HAVE_IO_URING_PREP_FALLOCATE
+            s->use_io_uring_fallocate = s->use_linux_io_uring &&
+                                        luring_has_fallocate();
+#endif
         }
     } else {
         if (!(S_ISCHR(st.st_mode) || S_ISBLK(st.st_mode))) {
@@ -829,8 +865,6 @@ static int raw_open_common(BlockDriverState *bs, QDict *options,
     bs->supported_write_flags = BDRV_REQ_FUA;
     if (s->use_linux_aio && !laio_has_fua()) {
         bs->supported_write_flags &= ~BDRV_REQ_FUA;
-    } else if (s->use_linux_io_uring && !luring_has_fua()) {
-        bs->supported_write_flags &= ~BDRV_REQ_FUA;
     }
 
     bs->supported_zero_flags = BDRV_REQ_MAY_UNMAP | BDRV_REQ_NO_FALLBACK;
@@ -838,6 +872,16 @@ static int raw_open_common(BlockDriverState *bs, QDict *options,
         /* When extending regular files, we get zeros from the OS */
         bs->supported_truncate_flags = BDRV_REQ_ZERO_WRITE;
     }
+
+#ifdef CONFIG_LINUX_IO_URING
+    if (s->use_io_uring_fixed) {
+        /* Fall back to the plain file descriptor if no slot is available */
+        int fixed_file = luring_register_file(s->fd);
+        if (fixed_file >= 0) {
+            s->io_uring_fixed_file = fixed_file;
+        }
+    }
+#endif
     ret = 0;
 fail:
     if (ret < 0 && s->fd != -1) {
@@ -2509,6 +2553,13 @@ static int coroutine_fn raw_thread_pool_submit(ThreadPoolFunc func, void *arg)
     return thread_pool_submit_co(func, arg);
 }
 
+/* For requests that must not hold up reads and writes, like fsync */
+static int coroutine_fn
+raw_thread_pool_submit_bulk(ThreadPoolFunc func, void *arg)
+{
+    return thread_pool_submit_co_prio(func, arg, THREAD_POOL_PRIO_BULK);
+}
+
 /*
  * Check if all memory in this vector is sector aligned.
  */
@@ -2585,7 +2636,9 @@ raw_co_prw(BlockDriverState *bs, int64_t *offset_ptr, uint64_t bytes,
 #ifdef CONFIG_LINUX_IO_URING
     } else if (s->use_linux_io_uring) {
         assert(qiov->size == bytes);
-        ret = luring_co_submit(bs, s->fd, offset, qiov, type, flags);
+        ret = luring_co_submit(bs, s->fd, s->io_uring_fixed_file, offset, qiov,
+                               type, flags,
+                               s->use_poll_hybrid ? &s->hybrid_poll : NULL);
         goto out;
 #endif
 #ifdef CONFIG_LINUX_AIO
@@ -2681,7 +2734,8 @@ static int coroutine_fn raw_co_flush_to_disk(BlockDriverState *bs)
 
 #ifdef CONFIG_LINUX_IO_URING
     if (s->use_linux_io_uring) {
-        return luring_co_submit(bs, s->fd, 0, NULL, QEMU_AIO_FLUSH, 0);
+        return luring_co_submit(bs, s->fd, s->io_uring_fixed_file, 0, NULL,
+                                QEMU_AIO_FLUSH, 0, NULL);
     }
 #endif
 #ifdef CONFIG_LINUX_AIO
@@ -2689,13 +2743,20 @@ static int coroutine_fn raw_co_flush_to_disk(BlockDriverState *bs)
         return laio_co_submit(s->fd, 0, NULL, QEMU_AIO_FLUSH, 0, 0);
     }
 #endif
-    return raw_thread_pool_submit(handle_aiocb_flush, &acb);
+    return raw_thread_pool_submit_bulk(handle_aiocb_flush, &acb);
 }
 
 static void raw_close(BlockDriverState *bs)
 {
     BDRVRawState *s = bs->opaque;
 
+#ifdef CONFIG_LINUX_IO_URING
+    if (s->io_uring_fixed_file >= 0) {
+        luring_unregister_file(s->io_uring_fixed_file);
+        s->io_uring_fixed_file = -1;
+    }
+#endif
+
     if (s->fd >= 0) {
 #if defined(CONFIG_BLKZONED)
         g_free(bs->wps);
@@ -2728,7 +2789,7 @@ raw_regular_truncate(BlockDriverState *bs, int fd, int64_t offset,
         },
     };
 
-    return raw_thread_pool_submit(handle_aiocb_truncate, &acb);
+    return raw_thread_pool_submit_bulk(handle_aiocb_truncate, &acb);
 }
 
 static int coroutine_fn raw_co_truncate(BlockDriverState *bs, int64_t offset,
@@ -3627,6 +3688,21 @@ raw_co_zone_append(BlockDriverState *bs,
 }
 #endif
 
+#ifdef HAVE_IO_URING_PREP_FALLOCATE
+/*
+ * Run fallocate(2) on a regular file through io_uring rather than waking a
+ * thread pool worker for it.
+ */
+static int coroutine_fn raw_co_uring_fallocate(BlockDriverState *bs, int mode,
+                                               int64_t offset, int64_t bytes)
+{
+    BDRVRawState *s = bs->opaque;
+
+    return translate_err(luring_co_fallocate(bs, s->fd, s->io_uring_fixed_file,
+                                             mode, offset, bytes));
+}
+#endif
+
 static coroutine_fn int
 raw_do_pdiscard(BlockDriverState *bs, int64_t offset, int64_t bytes,
                 bool blkdev)
@@ -3635,6 +3711,22 @@ raw_do_pdiscard(BlockDriverState *bs, int64_t offset, int64_t bytes,
     RawPosixAIOData acb;
     int ret;
 
+#if defined(HAVE_IO_URING_PREP_FALLOCATE) && \
+    defined(CONFIG_FALLOCATE_PUNCH_HOLE)
+    if (s->use_io_uring_fallocate && !blkdev) {
+        ret = -ENOTSUP;
+        if (s->has_discard) {
+            ret = raw_co_uring_fallocate(bs, FALLOC_FL_PUNCH_HOLE |
+                                         FALLOC_FL_KEEP_SIZE, offset, bytes);
+        }
+        if (ret == -ENOTSUP) {
+            s->has_discard = false;
+        }
+        raw_account_discard(s, bytes, ret);
+        return ret;
+    }
+#endif
+
     acb = (RawPosixAIOData) {
         .bs             = bs,
         .aio_fildes     = s->fd,
@@ -3647,7 +3739,7 @@ raw_do_pdiscard(BlockDriverState *bs, int64_t offset, int64_t bytes,
         acb.aio_type |= QEMU_AIO_BLKDEV;
     }
 
-    ret = raw_thread_pool_submit(handle_aiocb_discard, &acb);
+    ret = raw_thread_pool_submit_bulk(handle_aiocb_discard, &acb);
     raw_account_discard(s, bytes, ret);
     return ret;
 }
@@ -3722,6 +3814,38 @@ raw_do_pwrite_zeroes(BlockDriverState *bs, int64_t offset, int64_t bytes,
         handler = handle_aiocb_write_zeroes;
     }
 
+#ifdef HAVE_IO_URING_PREP_FALLOCATE
+    /*
+     * Try the common fallocate() modes through io_uring and leave the
+     * fallbacks of handle_aiocb_write_zeroes() to the thread pool.
+     */
+    if (s->use_io_uring_fallocate && !blkdev) {
+        int ret;
+
+#ifdef CONFIG_FALLOCATE_PUNCH_HOLE
+        if (flags & BDRV_REQ_MAY_UNMAP) {
+            ret = raw_co_uring_fallocate(bs, FALLOC_FL_PUNCH_HOLE |
+                                         FALLOC_FL_KEEP_SIZE, offset, bytes);
+            if (ret != -ENOTSUP && ret != -EINVAL && ret != -EBUSY) {
+                return ret;
+            }
+            handler = handle_aiocb_write_zeroes;
+        }
+#endif
+#ifdef CONFIG_FALLOCATE_ZERO_RANGE
+        if (s->has_write_zeroes) {
+            ret = raw_co_uring_fallocate(bs, FALLOC_FL_ZERO_RANGE,
+                                         offset, bytes);
+            if (ret == -ENOTSUP) {
+                s->has_write_zeroes = false;
+            } else if (ret != -EINVAL) {
+                return ret;
+            }
+        }
+#endif
+    }
+#endif
+
     return raw_thread_pool_submit(handler, &acb);
 }
 
@@ -3892,6 +4016,15 @@ static void raw_set_perm(BlockDriverState *bs, uint64_t perm, uint64_t shared)
     /* For reopen, we have already switched to the new fd (.bdrv_set_perm is
      * called after .bdrv_reopen_commit) */
     if (s->perm_change_fd && s->fd != s->perm_change_fd) {
+#ifdef CONFIG_LINUX_IO_URING
+        if (s->io_uring_fixed_file >= 0 &&
+            luring_update_file(s->io_uring_fixed_file,
+                               s->perm_change_fd) < 0) {
+            /* Keep going with the plain file descriptor */
+            luring_unregister_file(s->io_uring_fixed_file);
+            s->io_uring_fixed_file = -1;
+        }
+#endif
         qemu_close(s->fd);
         s->fd = s->perm_change_fd;
         s->open_flags = s->perm_change_flags;
@@ -3962,6 +4095,28 @@ raw_co_copy_range_to(BlockDriverState *bs,
     return raw_thread_pool_submit(handle_aiocb_copy_range, &acb);
 }
 
+#ifdef CONFIG_LINUX_IO_URING
+static bool raw_register_buf(BlockDriverState *bs, void *host, size_t size,
+                             Error **errp)
+{
+    BDRVRawState *s = bs->opaque;
+
+    if (!s->use_io_uring_fixed) {
+        return true;
+    }
+    return luring_register_buf(host, size, errp);
+}
+
+static void raw_unregister_buf(BlockDriverState *bs, void *host, size_t size)
+{
+    BDRVRawState *s = bs->opaque;
+
+    if (s->use_io_uring_fixed) {
+        luring_unregister_buf(host, size);
+    }
+}
+#endif /* CONFIG_LINUX_IO_URING */
+
 BlockDriver bdrv_file = {
     .format_name = "file",
     .protocol_name = "file",
@@ -3999,6 +4154,10 @@ BlockDriver bdrv_file = {
     .bdrv_check_perm = raw_check_perm,
     .bdrv_set_perm   = raw_set_perm,
     .bdrv_abort_perm_update = raw_abort_perm_update,
+#ifdef CONFIG_LINUX_IO_URING
+    .bdrv_register_buf      = raw_register_buf,
+    .bdrv_unregister_buf    = raw_unregister_buf,
+#endif
     .create_opts = &raw_create_opts,
     .mutable_opts = mutable_opts,
 };
@@ -4457,6 +4616,10 @@ static BlockDriver bdrv_host_device = {
     .bdrv_check_perm = raw_check_perm,
     .bdrv_set_perm   = raw_set_perm,
     .bdrv_abort_perm_update = raw_abort_perm_update,
+#ifdef CONFIG_LINUX_IO_URING
+    .bdrv_register_buf      = raw_register_buf,
+    .bdrv_unregister_buf    = raw_unregister_buf,
+#endif
     .bdrv_probe_blocksizes = hdev_probe_blocksizes,
     .bdrv_probe_geometry = hdev_probe_geometry,
 
@@ -574,6 +574,33 @@ void bdrv_drain_all(void)
     bdrv_drain_all_end();
 }
 
+/*
+ * The interval tree works on inclusive ranges, so zero-length ranges are
+ * widened to one byte.  The tree then returns a superset of the requests
+ * that tracked_request_overlaps() accepts.
+ */
+static uint64_t tracked_request_last(int64_t offset, int64_t bytes)
+{
+    return offset + MAX(bytes, 1) - 1;
+}
+
+/* Called with req->shard->lock held */
+static void tracked_request_index(BdrvTrackedRequest *req)
+{
+    req->node.start = req->overlap_offset;
+    req->node.last = tracked_request_last(req->overlap_offset,
+                                          req->overlap_bytes);
+    interval_tree_insert(&req->node, &req->shard->tree);
+}
+
+static BdrvTrackedRequestShard *tracked_request_shard(BlockDriverState *bs)
+{
+    unsigned i =
+        qemu_get_current_aio_context_shard(BDRV_TRACKED_REQ_SHARDS_SHIFT);
+
+    return &bs->tracked_requests[i];
+}
+
 /**
  * Remove an active request from the tracked requests list
  *
@@ -585,14 +612,16 @@ static void coroutine_fn tracked_request_end(BdrvTrackedRequest *req)
         qatomic_dec(&req->bs->serialising_in_flight);
     }
 
-    qemu_mutex_lock(&req->bs->reqs_lock);
+    qemu_mutex_lock(&req->shard->lock);
     QLIST_REMOVE(req, list);
-    qemu_mutex_unlock(&req->bs->reqs_lock);
+    interval_tree_remove(&req->node, &req->shard->tree);
+    qemu_mutex_unlock(&req->shard->lock);
 
     /*
      * At this point qemu_co_queue_wait(&req->wait_queue, ...) won't be called
      * anymore because the request has been removed from the list, so it's safe
-     * to restart the queue outside reqs_lock to minimize the critical section.
+     * to restart the queue outside the shard lock to minimize the critical
+     * section.
      */
     qemu_co_queue_restart_all(&req->wait_queue);
 }
@@ -617,13 +646,15 @@ static void coroutine_fn tracked_request_begin(BdrvTrackedRequest *req,
         .serialising    = false,
         .overlap_offset = offset,
         .overlap_bytes  = bytes,
+        .shard          = tracked_request_shard(bs),
     };
 
     qemu_co_queue_init(&req->wait_queue);
 
-    qemu_mutex_lock(&bs->reqs_lock);
-    QLIST_INSERT_HEAD(&bs->tracked_requests, req, list);
-    qemu_mutex_unlock(&bs->reqs_lock);
+    qemu_mutex_lock(&req->shard->lock);
+    QLIST_INSERT_HEAD(&req->shard->list, req, list);
+    tracked_request_index(req);
+    qemu_mutex_unlock(&req->shard->lock);
 }
 
 static bool tracked_request_overlaps(BdrvTrackedRequest *req,
@@ -642,13 +673,20 @@ static bool tracked_request_overlaps(BdrvTrackedRequest *req,
     return true;
 }
 
-/* Called with self->bs->reqs_lock held */
+/* Called with self->bs->reqs_lock and shard->lock held */
 static coroutine_fn BdrvTrackedRequest *
-bdrv_find_conflicting_request(BdrvTrackedRequest *self)
+tracked_request_find_conflict(BdrvTrackedRequestShard *shard,
+                              BdrvTrackedRequest *self)
 {
-    BdrvTrackedRequest *req;
+    uint64_t start = self->overlap_offset;
+    uint64_t last = tracked_request_last(self->overlap_offset,
+                                         self->overlap_bytes);
+    IntervalTreeNode *node;
+
+    for (node = interval_tree_iter_first(&shard->tree, start, last);
+         node; node = interval_tree_iter_next(node, start, last)) {
+        BdrvTrackedRequest *req = container_of(node, BdrvTrackedRequest, node);
 
-    QLIST_FOREACH(req, &self->bs->tracked_requests, list) {
         if (req == self || (!req->serialising && !self->serialising)) {
             continue;
         }
@@ -676,15 +714,50 @@ bdrv_find_conflicting_request(BdrvTrackedRequest *self)
     return NULL;
 }
 
+/*
+ * Called with self->bs->reqs_lock held.  If a conflicting request is found,
+ * return it with the lock of its shard held, so that it cannot complete
+ * before the caller has queued itself on it.
+ */
+static coroutine_fn BdrvTrackedRequest *
+bdrv_find_conflicting_request(BdrvTrackedRequest *self)
+{
+    BlockDriverState *bs = self->bs;
+    BdrvTrackedRequest *req;
+    int i;
+
+    for (i = 0; i < BDRV_TRACKED_REQ_SHARDS; i++) {
+        BdrvTrackedRequestShard *shard = &bs->tracked_requests[i];
+
+        qemu_mutex_lock(&shard->lock);
+        req = tracked_request_find_conflict(shard, self);
+        if (req) {
+            return req;
+        }
+        qemu_mutex_unlock(&shard->lock);
+    }
+
+    return NULL;
+}
+
 /* Called with self->bs->reqs_lock held */
 static void coroutine_fn
 bdrv_wait_serialising_requests_locked(BdrvTrackedRequest *self)
 {
+    BdrvTrackedRequestShard *shard;
     BdrvTrackedRequest *req;
 
     while ((req = bdrv_find_conflicting_request(self))) {
+        /*
+         * waiting_for is set before reqs_lock is dropped, so that the
+         * deadlock check of other serialising requests sees it.
+         */
         self->waiting_for = req;
-        qemu_co_queue_wait(&req->wait_queue, &self->bs->reqs_lock);
+        shard = req->shard;
+        qemu_mutex_unlock(&self->bs->reqs_lock);
+        qemu_co_queue_wait(&req->wait_queue, &shard->lock);
+        qemu_mutex_unlock(&shard->lock);
+        qemu_mutex_lock(&self->bs->reqs_lock);
         self->waiting_for = NULL;
     }
 }
@@ -704,8 +777,12 @@ static void tracked_request_set_serialising(BdrvTrackedRequest *req,
         req->serialising = true;
     }
 
+    qemu_mutex_lock(&req->shard->lock);
+    interval_tree_remove(&req->node, &req->shard->tree);
     req->overlap_offset = MIN(req->overlap_offset, overlap_offset);
     req->overlap_bytes = MAX(req->overlap_bytes, overlap_bytes);
+    tracked_request_index(req);
+    qemu_mutex_unlock(&req->shard->lock);
 }
 
 /**
@@ -716,16 +793,19 @@ BdrvTrackedRequest *coroutine_fn bdrv_co_get_self_request(BlockDriverState *bs)
 {
     BdrvTrackedRequest *req;
     Coroutine *self = qemu_coroutine_self();
+    int i;
     IO_CODE();
 
-    qemu_mutex_lock(&bs->reqs_lock);
-    QLIST_FOREACH(req, &bs->tracked_requests, list) {
-        if (req->co == self) {
-            qemu_mutex_unlock(&bs->reqs_lock);
-            return req;
+    for (i = 0; i < BDRV_TRACKED_REQ_SHARDS; i++) {
+        BdrvTrackedRequestShard *shard = &bs->tracked_requests[i];
+
+        QEMU_LOCK_GUARD(&shard->lock);
+        QLIST_FOREACH(req, &shard->list, list) {
+            if (req->co == self) {
+                return req;
+            }
         }
     }
-    qemu_mutex_unlock(&bs->reqs_lock);
 
     return NULL;
 }
@@ -1983,8 +2063,13 @@ bdrv_co_write_req_prepare(BdrvChild *child, int64_t offset, int64_t bytes,
 
         tracked_request_set_serialising(req, bdrv_get_cluster_size(bs));
 
-        if ((flags & BDRV_REQ_NO_WAIT) && bdrv_find_conflicting_request(req)) {
-            return -EBUSY;
+        if (flags & BDRV_REQ_NO_WAIT) {
+            BdrvTrackedRequest *conflict = bdrv_find_conflicting_request(req);
+
+            if (conflict) {
+                qemu_mutex_unlock(&conflict->shard->lock);
+                return -EBUSY;
+            }
         }
 
         bdrv_wait_serialising_requests_locked(req);
@@ -2026,6 +2111,17 @@ bdrv_co_write_req_finish(BdrvChild *child, int64_t offset, int64_t bytes,
 
     qatomic_inc(&bs->write_gen);
 
+    /*
+     * Drop cached block status for format nodes, which may have allocated,
+     * zeroed or remapped the range.  Protocol nodes only cache data
+     * regions, which are invalidated by zero writes and discards directly.
+     */
+    if (req->type == BDRV_TRACKED_TRUNCATE) {
+        bdrv_bsc_invalidate_all(bs);
+    } else if (bs->drv && bs->drv->block_status_cacheable) {
+        bdrv_bsc_invalidate_range(bs, offset, bytes);
+    }
+
     /*
      * Discard cannot extend the image, but in error handling cases, such as
      * when reverting a qcow2 cluster allocation, the discarded range can pass
@@ -2447,66 +2543,71 @@ bdrv_co_do_block_status(BlockDriverState *bs, unsigned int mode,
 
     if (bs->drv->bdrv_co_block_status) {
         /*
-         * Use the block-status cache only for protocol nodes: Format
-         * drivers are generally quick to inquire the status, but protocol
-         * drivers often need to get information from outside of qemu, so
-         * we do not have control over the actual implementation.  There
-         * have been cases where inquiring the status took an unreasonably
-         * long time, and we can do nothing in qemu to fix it.
-         * This is especially problematic for images with large data areas,
-         * because finding the few holes in them and giving them special
-         * treatment does not gain much performance.  Therefore, we try to
-         * cache the last-identified data region.
+         * Protocol drivers often need to get information from outside of
+         * qemu, so we do not have control over the actual implementation.
+         * There have been cases where inquiring the status took an
+         * unreasonably long time, and we can do nothing in qemu to fix it.
+         * Format drivers are quicker, but callers like mirror or
+         * qemu-img convert/map keep asking about the same extents.
+         * Therefore, we cache recently identified extents.
          *
-         * Second, limiting ourselves to protocol nodes allows us to assume
-         * the block status for data regions to be DATA | OFFSET_VALID, and
-         * that the host offset is the same as the guest offset.
+         * For protocol nodes, only data regions are cached, and we assume
+         * their block status to be DATA | OFFSET_VALID, with the host
+         * offset being the same as the guest offset.  External writers may
+         * zero parts of the cached regions without the cache being
+         * invalidated, and so we may report zeroes as data.  This is not
+         * catastrophic, however, because reporting zeroes as data is fine.
+         * The opposite would not be, so zero regions of protocol nodes are
+         * never cached.
          *
-         * Note that it is possible that external writers zero parts of
-         * the cached regions without the cache being invalidated, and so
-         * we may report zeroes as data.  This is not catastrophic,
-         * however, because reporting zeroes as data is fine.
+         * Format drivers that set block_status_cacheable own their
+         * metadata, so any extent they report can be cached until it is
+         * written to (see bdrv_co_write_req_finish()).
          */
-        if (QLIST_EMPTY(&bs->children) &&
-            bdrv_bsc_is_data(bs, aligned_offset, pnum))
+        bool is_protocol = QLIST_EMPTY(&bs->children);
+        bool cacheable = is_protocol || bs->drv->block_status_cacheable;
+        unsigned int write_gen;
+
+        if (cacheable &&
+            bdrv_bsc_lookup(bs, aligned_offset, &ret, pnum, &local_map,
+                            &local_file))
         {
-            ret = BDRV_BLOCK_DATA | BDRV_BLOCK_OFFSET_VALID;
-            local_file = bs;
-            local_map = aligned_offset;
+            trace_bdrv_co_block_status_cache_hit(bs, aligned_offset, *pnum,
+                                                 ret);
         } else {
+            write_gen = qatomic_read(&bs->write_gen);
             ret = bs->drv->bdrv_co_block_status(bs, mode, aligned_offset,
                                                 aligned_bytes, pnum, &local_map,
                                                 &local_file);
 
             /*
-             * Note that checking QLIST_EMPTY(&bs->children) is also done when
-             * the cache is queried above.  Technically, we do not need to check
-             * it here; the worst that can happen is that we fill the cache for
-             * non-protocol nodes, and then it is never used.  However, filling
-             * the cache requires an RCU update, so double check here to avoid
-             * such an update if possible.
-             *
              * Check mode, because we only want to update the cache when we
              * have accurate information about what is zero and what is data.
              */
-            if (mode == BDRV_WANT_PRECISE &&
-                ret == (BDRV_BLOCK_DATA | BDRV_BLOCK_OFFSET_VALID) &&
-                QLIST_EMPTY(&bs->children))
-            {
+            if (mode != BDRV_WANT_PRECISE || ret < 0 || !cacheable) {
+                /* Nothing to cache */
+            } else if (is_protocol) {
+                if (ret == (BDRV_BLOCK_DATA | BDRV_BLOCK_OFFSET_VALID)) {
+                    /*
+                     * When a protocol driver reports BLOCK_OFFSET_VALID, the
+                     * returned local_map value must be the same as the offset
+                     * we have passed (aligned_offset), and local_bs must be
+                     * the node itself.
+                     * Assert this, because the result the cache delivers must
+                     * be the same as the driver would deliver.
+                     */
+                    assert(local_file == bs);
+                    assert(local_map == aligned_offset);
+                    bdrv_bsc_fill(bs, aligned_offset, *pnum, ret, local_map,
+                                  local_file, write_gen);
+                }
+            } else if (!(ret & (BDRV_BLOCK_RAW | BDRV_BLOCK_EOF))) {
                 /*
-                 * When a protocol driver reports BLOCK_OFFSET_VALID, the
-                 * returned local_map value must be the same as the offset we
-                 * have passed (aligned_offset), and local_bs must be the node
-                 * itself.
-                 * Assert this, because we follow this rule when reading from
-                 * the cache (see the `local_file = bs` and
-                 * `local_map = aligned_offset` assignments above), and the
-                 * result the cache delivers must be the same as the driver
-                 * would deliver.
+                 * RAW means the status is defined by the child, and EOF
+                 * changes with the image length.
                  */
-                assert(local_file == bs);
-                assert(local_map == aligned_offset);
-                bdrv_bsc_fill(bs, aligned_offset, *pnum);
+                bdrv_bsc_fill(bs, aligned_offset, *pnum, ret, local_map,
+                              local_file, write_gen);
             }
         }
     } else {
@@ -3570,6 +3671,55 @@ int coroutine_fn bdrv_co_copy_range(BdrvChild *src, int64_t src_offset,
                                    bytes, read_flags, write_flags);
 }
 
+int coroutine_fn bdrv_co_share_range(BdrvChild *child, int64_t src_offset,
+                                     int64_t dst_offset, int64_t bytes)
+{
+    BlockDriverState *bs = child->bs;
+    BdrvTrackedRequest src_req, dst_req;
+    int ret;
+
+    IO_CODE();
+    assert_bdrv_graph_readable();
+
+    if (!bs || !bdrv_co_is_inserted(bs)) {
+        return -ENOMEDIUM;
+    }
+    ret = bdrv_check_request32(src_offset, bytes, NULL, 0);
+    if (ret) {
+        return ret;
+    }
+    ret = bdrv_check_request32(dst_offset, bytes, NULL, 0);
+    if (ret) {
+        return ret;
+    }
+    if (src_offset < dst_offset + bytes && dst_offset < src_offset + bytes) {
+        return -EINVAL;
+    }
+    if (!bs->drv->bdrv_co_share_range) {
+        return -ENOTSUP;
+    }
+
+    bdrv_inc_in_flight(bs);
+
+    /* Neither range may change while the driver rewrites its metadata */
+    tracked_request_begin(&src_req, bs, src_offset, bytes, BDRV_TRACKED_READ);
+    bdrv_make_request_serialising(&src_req, 1);
+    tracked_request_begin(&dst_req, bs, dst_offset, bytes, BDRV_TRACKED_WRITE);
+    bdrv_make_request_serialising(&dst_req, 1);
+
+    ret = bdrv_co_write_req_prepare(child, dst_offset, bytes, &dst_req, 0);
+    if (!ret) {
+        ret = bs->drv->bdrv_co_share_range(bs, src_offset, dst_offset, bytes);
+    }
+    bdrv_co_write_req_finish(child, dst_offset, bytes, &dst_req, ret);
+
+    tracked_request_end(&dst_req);
+    tracked_request_end(&src_req);
+    bdrv_dec_in_flight(bs);
+
+    return ret;
+}
+
 void coroutine_fn bdrv_co_parent_cb_resize(BlockDriverState *bs)
 {
     BdrvChild *c;
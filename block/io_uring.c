@@ -13,10 +13,50 @@
 #include "block/aio.h"
 #include "block/block.h"
 #include "block/raw-aio.h"
+#include "qapi/error.h"
+#include "qemu/bitmap.h"
 #include "qemu/coroutine.h"
+#include "qemu/main-loop.h"
+#include "qemu/rcu.h"
+#include "qemu/units.h"
 #include "system/block-backend.h"
 #include "trace.h"
 
+/* The kernel limits the size of a single fixed buffer */
+#define LURING_FIXED_BUF_MAX_LEN (1 * GiB)
+
+/* A chunk of registered memory that occupies one fixed buffer table slot */
+typedef struct {
+    uint8_t *base;
+    size_t len;
+    unsigned index;
+} LuringFixedBuf;
+
+/*
+ * Sorted by base address so the I/O path can look up the fixed buffer for a
+ * request with a binary search. Replaced as a whole under RCU when memory is
+ * registered or unregistered.
+ */
+typedef struct {
+    struct rcu_head rcu;
+    unsigned nr;
+    LuringFixedBuf bufs[];
+} LuringFixedBufList;
+
+/* A luring_register_buf() region, only accessed with the BQL held */
+typedef struct {
+    void *host;
+    size_t size;
+    unsigned refcnt;
+    unsigned nr_slots;
+    unsigned *slots;
+} LuringRegion;
+
+static LuringFixedBufList *luring_fixed_bufs;
+static GArray *luring_regions;
+static DECLARE_BITMAP(luring_buf_slots, AIO_IO_URING_FIXED_BUFS);
+static DECLARE_BITMAP(luring_file_slots, AIO_IO_URING_FIXED_FILES);
+
 typedef struct {
     Coroutine *co;
     QEMUIOVector *qiov;
@@ -24,7 +64,21 @@ typedef struct {
     ssize_t ret;
     int type;
     int fd;
+    int fixed_file; /* fixed file table slot or -1 */
+    int buf_index; /* fixed buffer table slot or -1 */
     BdrvRequestFlags flags;
+    int mode; /* fallocate() mode for QEMU_AIO_WRITE_ZEROES */
+    uint64_t bytes; /* length for QEMU_AIO_WRITE_ZEROES */
+
+    /*
+     * Without RWF_DSYNC, FUA writes are followed by a linked fdatasync, see
+     * luring_submit().  Both sqes must complete before the request does.
+     */
+    bool fua_flush;
+    unsigned cqes_pending;
+    ssize_t io_ret;
+    int flush_ret;
+    CqeHandler flush_cqe_handler;
 
     /*
      * Buffered reads may require resubmission, see
@@ -41,22 +95,25 @@ static void luring_prep_sqe(struct io_uring_sqe *sqe, void *opaque)
     LuringRequest *req = opaque;
     QEMUIOVector *qiov = req->qiov;
     uint64_t offset = req->offset;
-    int fd = req->fd;
+    int fd = req->fixed_file >= 0 ? req->fixed_file : req->fd;
     BdrvRequestFlags flags = req->flags;
 
     switch (req->type) {
     case QEMU_AIO_WRITE:
     {
-        int luring_flags = (flags & BDRV_REQ_FUA) ? RWF_DSYNC : 0;
-        if (luring_flags != 0 || qiov->niov > 1) {
+        int luring_flags = (flags & BDRV_REQ_FUA) && !req->fua_flush ?
+                           RWF_DSYNC : 0;
+        if (req->buf_index >= 0) {
+            struct iovec *iov = qiov->iov;
+            io_uring_prep_write_fixed(sqe, fd, iov->iov_base, iov->iov_len,
+                                      offset, req->buf_index);
+            sqe->rw_flags = luring_flags;
+        } else if (luring_flags != 0 || qiov->niov > 1) {
 #ifdef HAVE_IO_URING_PREP_WRITEV2
             io_uring_prep_writev2(sqe, fd, qiov->iov,
                                   qiov->niov, offset, luring_flags);
 #else
-            /*
-             * FUA should only be enabled with HAVE_IO_URING_PREP_WRITEV2, see
-             * luring_has_fua().
-             */
+            /* FUA uses a linked fdatasync instead, see luring_submit() */
             assert(luring_flags == 0);
 
             io_uring_prep_writev(sqe, fd, qiov->iov, qiov->niov, offset);
@@ -76,7 +133,13 @@ static void luring_prep_sqe(struct io_uring_sqe *sqe, void *opaque)
         if (req->resubmit_qiov.iov != NULL) {
             qiov = &req->resubmit_qiov;
         }
-        if (qiov->niov > 1) {
+        if (req->buf_index >= 0) {
+            /* A shortened qiov still lies within the fixed buffer */
+            struct iovec *iov = qiov->iov;
+            io_uring_prep_read_fixed(sqe, fd, iov->iov_base, iov->iov_len,
+                                     offset + req->total_read,
+                                     req->buf_index);
+        } else if (qiov->niov > 1) {
             io_uring_prep_readv(sqe, fd, qiov->iov, qiov->niov,
                                 offset + req->total_read);
         } else {
@@ -90,11 +153,77 @@ static void luring_prep_sqe(struct io_uring_sqe *sqe, void *opaque)
     case QEMU_AIO_FLUSH:
         io_uring_prep_fsync(sqe, fd, IORING_FSYNC_DATASYNC);
         break;
+#ifdef HAVE_IO_URING_PREP_FALLOCATE
+    case QEMU_AIO_WRITE_ZEROES:
+        io_uring_prep_fallocate(sqe, fd, req->mode, offset, req->bytes);
+        break;
+#endif
     default:
         fprintf(stderr, "%s: invalid AIO request type, aborting 0x%x.\n",
                         __func__, req->type);
         abort();
     }
+
+    if (req->fixed_file >= 0) {
+        sqe->flags |= IOSQE_FIXED_FILE;
+    }
+}
+
+static void luring_prep_flush_sqe(struct io_uring_sqe *sqe, void *opaque)
+{
+    LuringRequest *req = opaque;
+
+    if (req->fixed_file >= 0) {
+        io_uring_prep_fsync(sqe, req->fixed_file, IORING_FSYNC_DATASYNC);
+        sqe->flags |= IOSQE_FIXED_FILE;
+    } else {
+        io_uring_prep_fsync(sqe, req->fd, IORING_FSYNC_DATASYNC);
+    }
+}
+
+/*
+ * Submit (or resubmit) the request.  A FUA write without RWF_DSYNC support
+ * is chained with an fdatasync so that it completes in a single trip through
+ * the ring instead of the write and flush round trips the block layer would
+ * otherwise emulate it with.
+ */
+static void luring_submit(LuringRequest *req)
+{
+    if (req->fua_flush) {
+        AioSqe sqes[] = {
+            { luring_prep_sqe, req, &req->cqe_handler },
+            { luring_prep_flush_sqe, req, &req->flush_cqe_handler },
+        };
+
+        req->cqes_pending += ARRAY_SIZE(sqes);
+        aio_add_linked_sqes(sqes, ARRAY_SIZE(sqes));
+    } else {
+        req->cqes_pending++;
+        aio_add_sqe(luring_prep_sqe, req, &req->cqe_handler);
+    }
+}
+
+/* Complete the request once no more cqes are expected */
+static void luring_request_done(LuringRequest *req)
+{
+    if (req->cqes_pending > 0) {
+        return;
+    }
+
+    req->ret = req->io_ret;
+    if (req->fua_flush && req->ret == 0) {
+        req->ret = req->flush_ret;
+    }
+    qemu_iovec_destroy(&req->resubmit_qiov);
+
+    /*
+     * If the coroutine is already entered it must be in luring_co_submit() and
+     * will notice req->ret has been filled in when it eventually runs later.
+     * Coroutines cannot be entered recursively so avoid doing that!
+     */
+    if (!qemu_coroutine_entered(req->co)) {
+        aio_co_wake(req->co);
+    }
 }
 
 /**
@@ -123,7 +252,7 @@ static void luring_resubmit_short_read(LuringRequest *req, int nread)
     }
     qemu_iovec_concat(resubmit_qiov, req->qiov, req->total_read, remaining);
 
-    aio_add_sqe(luring_prep_sqe, req, &req->cqe_handler);
+    luring_submit(req);
 }
 
 static void luring_cqe_handler(CqeHandler *cqe_handler)
@@ -132,11 +261,13 @@ static void luring_cqe_handler(CqeHandler *cqe_handler)
     int ret = cqe_handler->cqe.res;
 
     trace_luring_cqe_handler(req, ret);
+    req->cqes_pending--;
 
     if (ret < 0) {
         /*
-         * Only writev/readv/fsync requests on regular files or host block
-         * devices are submitted. Therefore -EAGAIN is not expected but it's
+         * Only writev/readv/fsync/fallocate requests on regular files or host
+         * block devices are submitted. Therefore -EAGAIN is not expected but
+         * it's
          * known to happen sometimes with Linux SCSI. Submit again and hope
          * the request completes successfully.
          *
@@ -149,7 +280,7 @@ static void luring_cqe_handler(CqeHandler *cqe_handler)
          * immediately.
          */
         if (ret == -EINTR || ret == -EAGAIN) {
-            aio_add_sqe(luring_prep_sqe, req, &req->cqe_handler);
+            luring_submit(req);
             return;
         }
     } else if (req->qiov) {
@@ -176,49 +307,370 @@ static void luring_cqe_handler(CqeHandler *cqe_handler)
         }
     }
 
-    req->ret = ret;
-    qemu_iovec_destroy(&req->resubmit_qiov);
+    req->io_ret = ret;
+    luring_request_done(req);
+}
+
+static void luring_flush_cqe_handler(CqeHandler *cqe_handler)
+{
+    LuringRequest *req = container_of(cqe_handler, LuringRequest,
+                                      flush_cqe_handler);
+    int ret = cqe_handler->cqe.res;
+
+    trace_luring_cqe_handler(req, ret);
+    req->cqes_pending--;
+
+    /* The write has completed, so the fdatasync can be retried on its own */
+    if (ret == -EINTR || ret == -EAGAIN) {
+        req->cqes_pending++;
+        aio_add_sqe(luring_prep_flush_sqe, req, &req->flush_cqe_handler);
+        return;
+    }
 
     /*
-     * If the coroutine is already entered it must be in luring_co_submit() and
-     * will notice req->ret has been filled in when it eventually runs later.
-     * Coroutines cannot be entered recursively so avoid doing that!
+     * -ECANCELED means that the write failed or is being resubmitted together
+     * with a new fdatasync
      */
-    if (!qemu_coroutine_entered(req->co)) {
-        aio_co_wake(req->co);
+    if (ret != -ECANCELED) {
+        req->flush_ret = ret;
     }
+    luring_request_done(req);
 }
 
-int coroutine_fn luring_co_submit(BlockDriverState *bs, int fd,
+/* Returns the fixed buffer table slot containing [buf, buf + len) or -1 */
+static int luring_fixed_buf_lookup(void *buf, size_t len)
+{
+    LuringFixedBufList *list;
+    uint8_t *p = buf;
+    unsigned lo = 0;
+    unsigned hi;
+
+    RCU_READ_LOCK_GUARD();
+
+    list = qatomic_rcu_read(&luring_fixed_bufs);
+    if (!list) {
+        return -1;
+    }
+
+    hi = list->nr;
+    while (lo < hi) {
+        unsigned mid = lo + (hi - lo) / 2;
+        LuringFixedBuf *fb = &list->bufs[mid];
+
+        if (p < fb->base) {
+            hi = mid;
+        } else if (p >= fb->base + fb->len) {
+            lo = mid + 1;
+        } else {
+            return len <= fb->base + fb->len - p ? fb->index : -1;
+        }
+    }
+    return -1;
+}
+
+int coroutine_fn luring_co_submit(BlockDriverState *bs, int fd, int fixed_file,
                                   uint64_t offset, QEMUIOVector *qiov,
-                                  int type, BdrvRequestFlags flags)
+                                  int type, BdrvRequestFlags flags,
+                                  AioHybridPoll *hybrid_poll)
 {
+    int64_t start_ns = 0;
     LuringRequest req = {
         .co         = qemu_coroutine_self(),
         .qiov       = qiov,
         .ret        = -EINPROGRESS,
         .type       = type,
         .fd         = fd,
+        .fixed_file = -1,
+        .buf_index  = -1,
         .offset     = offset,
         .flags      = flags,
     };
 
     req.cqe_handler.cb = luring_cqe_handler;
+    req.flush_cqe_handler.cb = luring_flush_cqe_handler;
+#ifndef HAVE_IO_URING_PREP_WRITEV2
+    req.fua_flush = type == QEMU_AIO_WRITE && (flags & BDRV_REQ_FUA);
+#endif
+
+    if (aio_has_io_uring_fixed()) {
+        req.fixed_file = fixed_file;
+
+        if ((flags & BDRV_REQ_REGISTERED_BUF) && qiov && qiov->niov == 1 &&
+            (type == QEMU_AIO_READ || type == QEMU_AIO_WRITE)) {
+            req.buf_index = luring_fixed_buf_lookup(qiov->iov[0].iov_base,
+                                                    qiov->iov[0].iov_len);
+        }
+    }
 
     trace_luring_co_submit(bs, &req, fd, offset, qiov ? qiov->size : 0, type);
-    aio_add_sqe(luring_prep_sqe, &req, &req.cqe_handler);
+    if (hybrid_poll) {
+        start_ns = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+        aio_hybrid_poll_submitted(qemu_get_current_aio_context(), hybrid_poll);
+    }
+    luring_submit(&req);
 
     if (req.ret == -EINPROGRESS) {
         qemu_coroutine_yield();
     }
+    if (hybrid_poll) {
+        aio_hybrid_poll_completed(hybrid_poll,
+            qemu_clock_get_ns(QEMU_CLOCK_REALTIME) - start_ns);
+    }
     return req.ret;
 }
 
-bool luring_has_fua(void)
+#ifdef HAVE_IO_URING_PREP_FALLOCATE
+int coroutine_fn luring_co_fallocate(BlockDriverState *bs, int fd,
+                                     int fixed_file, int mode,
+                                     uint64_t offset, uint64_t bytes)
 {
-#ifdef HAVE_IO_URING_PREP_WRITEV2
+    LuringRequest req = {
+        .co         = qemu_coroutine_self(),
+        .ret        = -EINPROGRESS,
+        .type       = QEMU_AIO_WRITE_ZEROES,
+        .fd         = fd,
+        .fixed_file = aio_has_io_uring_fixed() ? fixed_file : -1,
+        .buf_index  = -1,
+        .offset     = offset,
+        .mode       = mode,
+        .bytes      = bytes,
+    };
+
+    req.cqe_handler.cb = luring_cqe_handler;
+
+    trace_luring_co_submit(bs, &req, fd, offset, bytes, req.type);
+    luring_submit(&req);
+
+    if (req.ret == -EINPROGRESS) {
+        qemu_coroutine_yield();
+    }
+    return req.ret;
+}
+
+bool luring_has_fallocate(void)
+{
+    static int supported = -1;
+
+    if (supported < 0) {
+        struct io_uring_probe *probe = io_uring_get_probe();
+
+        supported = probe &&
+                    io_uring_opcode_supported(probe, IORING_OP_FALLOCATE);
+        if (probe) {
+            io_uring_free_probe(probe);
+        }
+    }
+    return supported;
+}
+#endif
+
+/* Build the lookup list from luring_regions and publish it */
+static void luring_update_fixed_bufs(void)
+{
+    LuringFixedBufList *old = luring_fixed_bufs;
+    LuringFixedBufList *list;
+    unsigned nr = 0;
+    unsigned i, j;
+
+    for (i = 0; i < luring_regions->len; i++) {
+        nr += g_array_index(luring_regions, LuringRegion, i).nr_slots;
+    }
+
+    list = g_malloc(sizeof(*list) + nr * sizeof(list->bufs[0]));
+    list->nr = 0;
+
+    for (i = 0; i < luring_regions->len; i++) {
+        LuringRegion *r = &g_array_index(luring_regions, LuringRegion, i);
+
+        for (j = 0; j < r->nr_slots; j++) {
+            size_t chunk_offset = (size_t)j * LURING_FIXED_BUF_MAX_LEN;
+
+            list->bufs[list->nr++] = (LuringFixedBuf) {
+                .base = (uint8_t *)r->host + chunk_offset,
+                .len = MIN(r->size - chunk_offset, LURING_FIXED_BUF_MAX_LEN),
+                .index = r->slots[j],
+            };
+        }
+    }
+
+    /* Insertion sort, regions are few and this is not a hot path */
+    for (i = 1; i < list->nr; i++) {
+        LuringFixedBuf tmp = list->bufs[i];
+
+        for (j = i; j > 0 && list->bufs[j - 1].base > tmp.base; j--) {
+            list->bufs[j] = list->bufs[j - 1];
+        }
+        list->bufs[j] = tmp;
+    }
+
+    qatomic_rcu_set(&luring_fixed_bufs, list);
+    if (old) {
+        g_free_rcu(old, rcu);
+    }
+}
+
+static LuringRegion *luring_find_region(void *host, size_t size,
+                                        unsigned *index)
+{
+    unsigned i;
+
+    if (!luring_regions) {
+        return NULL;
+    }
+
+    for (i = 0; i < luring_regions->len; i++) {
+        LuringRegion *r = &g_array_index(luring_regions, LuringRegion, i);
+
+        if (r->host == host && r->size == size) {
+            *index = i;
+            return r;
+        }
+    }
+    return NULL;
+}
+
+static void luring_release_slots(unsigned *slots, unsigned nr_slots)
+{
+    unsigned i;
+
+    for (i = 0; i < nr_slots; i++) {
+        aio_io_uring_set_fixed_buf(slots[i], NULL);
+        clear_bit(slots[i], luring_buf_slots);
+    }
+}
+
+bool luring_register_buf(void *host, size_t size, Error **errp)
+{
+    LuringRegion *r;
+    LuringRegion new_region;
+    unsigned index;
+    unsigned i;
+
+    GLOBAL_STATE_CODE();
+
+    if (!aio_has_io_uring_fixed()) {
+        error_setg(errp, "io_uring fixed buffers are not supported by the "
+                         "host kernel");
+        return false;
+    }
+
+    if (!luring_regions) {
+        luring_regions = g_array_new(false, false, sizeof(LuringRegion));
+    }
+
+    r = luring_find_region(host, size, &index);
+    if (r) {
+        r->refcnt++;
+        return true;
+    }
+
+    new_region = (LuringRegion) {
+        .host = host,
+        .size = size,
+        .refcnt = 1,
+        .nr_slots = DIV_ROUND_UP(size, LURING_FIXED_BUF_MAX_LEN),
+    };
+    new_region.slots = g_new(unsigned, new_region.nr_slots);
+
+    for (i = 0; i < new_region.nr_slots; i++) {
+        size_t chunk_offset = (size_t)i * LURING_FIXED_BUF_MAX_LEN;
+        struct iovec iov = {
+            .iov_base = (uint8_t *)host + chunk_offset,
+            .iov_len = MIN(size - chunk_offset, LURING_FIXED_BUF_MAX_LEN),
+        };
+        unsigned slot = find_first_zero_bit(luring_buf_slots,
+                                            AIO_IO_URING_FIXED_BUFS);
+        int ret;
+
+        if (slot >= AIO_IO_URING_FIXED_BUFS) {
+            error_setg(errp, "Out of io_uring fixed buffer slots");
+            goto fail;
+        }
+
+        ret = aio_io_uring_set_fixed_buf(slot, &iov);
+        if (ret < 0) {
+            error_setg_errno(errp, -ret, "Failed to register io_uring fixed "
+                             "buffer (check the locked memory limit)");
+            goto fail;
+        }
+
+        set_bit(slot, luring_buf_slots);
+        new_region.slots[i] = slot;
+    }
+
+    g_array_append_val(luring_regions, new_region);
+    luring_update_fixed_bufs();
+    trace_luring_register_buf(host, size, new_region.nr_slots);
     return true;
-#else
+
+fail:
+    luring_release_slots(new_region.slots, i);
+    g_free(new_region.slots);
     return false;
-#endif
+}
+
+void luring_unregister_buf(void *host, size_t size)
+{
+    LuringRegion *r;
+    LuringRegion old_region;
+    unsigned index;
+
+    GLOBAL_STATE_CODE();
+
+    r = luring_find_region(host, size, &index);
+    if (!r || --r->refcnt > 0) {
+        return;
+    }
+
+    trace_luring_unregister_buf(host, size);
+
+    /* Stop lookups from returning the slots before they are cleared */
+    old_region = *r;
+    g_array_remove_index(luring_regions, index);
+    luring_update_fixed_bufs();
+
+    luring_release_slots(old_region.slots, old_region.nr_slots);
+    g_free(old_region.slots);
+}
+
+int luring_register_file(int fd)
+{
+    unsigned slot;
+    int ret;
+
+    GLOBAL_STATE_CODE();
+
+    if (!aio_has_io_uring_fixed()) {
+        return -ENOTSUP;
+    }
+
+    slot = find_first_zero_bit(luring_file_slots, AIO_IO_URING_FIXED_FILES);
+    if (slot >= AIO_IO_URING_FIXED_FILES) {
+        return -ENOSPC;
+    }
+
+    ret = aio_io_uring_set_fixed_file(slot, fd);
+    if (ret < 0) {
+        return ret;
+    }
+
+    set_bit(slot, luring_file_slots);
+    return slot;
+}
+
+int luring_update_file(int fixed_file, int fd)
+{
+    GLOBAL_STATE_CODE();
+    assert(test_bit(fixed_file, luring_file_slots));
+
+    return aio_io_uring_set_fixed_file(fixed_file, fd);
+}
+
+void luring_unregister_file(int fixed_file)
+{
+    GLOBAL_STATE_CODE();
+    assert(test_bit(fixed_file, luring_file_slots));
+
+    aio_io_uring_set_fixed_file(fixed_file, -1);
+    clear_bit(fixed_file, luring_file_slots);
 }
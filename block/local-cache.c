@@ -0,0 +1,697 @@
+/*
+ * Local cache filter block driver
+ *
+ * Keeps recently read blocks of a slow (typically network) disk in a local
+ * cache image, e.g. a file on an NVMe drive:
+ *
+ *   -blockdev driver=rbd,node-name=disk,...
+ *   -blockdev driver=file,node-name=ssd,filename=/nvme/disk-cache.img
+ *   -blockdev driver=local-cache,node-name=cached,file=disk,cache=ssd
+ *
+ * The cache is write-through: guest writes always reach the filtered node
+ * before they complete, and the cache only ever holds clean copies.  Its
+ * index lives in memory, so the cache image needs no journal, can be dropped
+ * at any time and starts cold when the filter is opened.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+
+#include "qapi/error.h"
+#include "qapi/util.h"
+#include "qemu/module.h"
+#include "qemu/option.h"
+#include "qemu/units.h"
+#include "block/block-io.h"
+#include "block/block_int.h"
+#include "trace.h"
+
+typedef struct LocalCacheEntry {
+    int64_t block;              /* block index in the filtered node */
+    int64_t slot;               /* block index in the cache image */
+    int busy;                   /* requests using the slot */
+    bool valid;                 /* the slot holds the block's data */
+    bool removed;               /* not indexed anymore, free once idle */
+    QTAILQ_ENTRY(LocalCacheEntry) lru;
+} LocalCacheEntry;
+
+typedef struct BDRVLocalCacheState {
+    BdrvChild *cache;
+    int64_t block_size;
+    int64_t nb_slots;
+    LocalCacheAdmission admission;
+
+    QemuMutex lock;             /* protects everything below */
+
+    GHashTable *entries;        /* block index -> LocalCacheEntry */
+    QTAILQ_HEAD(, LocalCacheEntry) lru; /* most recently used first */
+    int64_t *free_slots;
+    int64_t nb_free_slots;
+
+    /* Blocks missed once recently, for admission=adaptive */
+    GHashTable *ghost;
+    int64_t *ghost_ring;
+    int64_t ghost_next;
+
+    int writes_in_flight;
+    bool active;                /* false while inactive for migration */
+
+    BlockStatsSpecificLocalCache stats;
+} BDRVLocalCacheState;
+
+#define LOCAL_CACHE_OPT_CACHE_SIZE "cache-size"
+#define LOCAL_CACHE_OPT_BLOCK_SIZE "block-size"
+#define LOCAL_CACHE_OPT_ADMISSION "admission"
+static QemuOptsList runtime_opts = {
+    .name = "local-cache",
+    .head = QTAILQ_HEAD_INITIALIZER(runtime_opts.head),
+    .desc = {
+        {
+            .name = LOCAL_CACHE_OPT_CACHE_SIZE,
+            .type = QEMU_OPT_SIZE,
+            .help = "how much of the cache image to use, default all of it",
+        },
+        {
+            .name = LOCAL_CACHE_OPT_BLOCK_SIZE,
+            .type = QEMU_OPT_SIZE,
+            .help = "granularity of the cache, default 64K",
+        },
+        {
+            .name = LOCAL_CACHE_OPT_ADMISSION,
+            .type = QEMU_OPT_STRING,
+            .help = "which missed blocks to cache (always, adaptive), "
+                "default adaptive",
+        },
+        { /* end of list */ }
+    },
+};
+
+static void local_cache_free_entry_locked(BDRVLocalCacheState *s,
+                                          LocalCacheEntry *e)
+{
+    s->free_slots[s->nb_free_slots++] = e->slot;
+    s->stats.cached_bytes -= e->valid ? s->block_size : 0;
+    g_free(e);
+}
+
+static void local_cache_remove_locked(BDRVLocalCacheState *s,
+                                      LocalCacheEntry *e)
+{
+    g_hash_table_remove(s->entries, &e->block);
+    QTAILQ_REMOVE(&s->lru, e, lru);
+    e->removed = true;
+    if (!e->busy) {
+        local_cache_free_entry_locked(s, e);
+    }
+}
+
+static void local_cache_invalidate_entry_locked(BDRVLocalCacheState *s,
+                                                LocalCacheEntry *e,
+                                                int64_t offset, int64_t bytes,
+                                                GArray *blocks)
+{
+    if (blocks && e->valid &&
+        e->block * s->block_size >= offset &&
+        (e->block + 1) * s->block_size <= offset + bytes) {
+        g_array_append_val(blocks, e->block);
+    }
+    local_cache_remove_locked(s, e);
+    s->stats.invalidations++;
+}
+
+/* Drop cached blocks in a range, recording fully covered ones in @blocks */
+static void local_cache_invalidate_locked(BDRVLocalCacheState *s,
+                                          int64_t offset, int64_t bytes,
+                                          GArray *blocks)
+{
+    int64_t first = offset / s->block_size;
+    int64_t last = (offset + bytes - 1) / s->block_size;
+    LocalCacheEntry *e, *next;
+    int64_t block;
+
+    if (!bytes) {
+        return;
+    }
+
+    /* Look up each block of small ranges, walk the cache for large ones */
+    if (last - first < g_hash_table_size(s->entries)) {
+        for (block = first; block <= last; block++) {
+            e = g_hash_table_lookup(s->entries, &block);
+            if (e) {
+                local_cache_invalidate_entry_locked(s, e, offset, bytes,
+                                                    blocks);
+            }
+        }
+        return;
+    }
+
+    QTAILQ_FOREACH_SAFE(e, &s->lru, lru, next) {
+        if (e->block >= first && e->block <= last) {
+            local_cache_invalidate_entry_locked(s, e, offset, bytes, blocks);
+        }
+    }
+}
+
+static void local_cache_invalidate_all_locked(BDRVLocalCacheState *s)
+{
+    LocalCacheEntry *e, *next;
+
+    QTAILQ_FOREACH_SAFE(e, &s->lru, lru, next) {
+        local_cache_remove_locked(s, e);
+        s->stats.invalidations++;
+    }
+}
+
+/*
+ * With admission=adaptive, a block is only cached when it is missed a second
+ * time while still remembered in the ghost ring, which holds as many blocks as
+ * the cache.  This keeps one-off sequential scans from flushing the cache.
+ */
+static bool local_cache_admit_locked(BDRVLocalCacheState *s, int64_t block)
+{
+    int64_t *slot;
+    gpointer key;
+
+    if (s->admission == LOCAL_CACHE_ADMISSION_ALWAYS) {
+        return true;
+    }
+
+    if (g_hash_table_remove(s->ghost, &block)) {
+        return true;
+    }
+
+    /* Forget the oldest miss, unless it was admitted and reused since */
+    slot = &s->ghost_ring[s->ghost_next];
+    if (g_hash_table_lookup_extended(s->ghost, slot, &key, NULL) &&
+        key == slot) {
+        g_hash_table_remove(s->ghost, slot);
+    }
+    *slot = block;
+    g_hash_table_add(s->ghost, slot);
+    s->ghost_next = (s->ghost_next + 1) % s->nb_slots;
+    return false;
+}
+
+static LocalCacheEntry *local_cache_alloc_locked(BDRVLocalCacheState *s,
+                                                 int64_t block)
+{
+    LocalCacheEntry *e;
+
+    if (!s->nb_free_slots) {
+        QTAILQ_FOREACH_REVERSE(e, &s->lru, lru) {
+            if (!e->busy) {
+                break;
+            }
+        }
+        if (!e) {
+            return NULL;
+        }
+        local_cache_remove_locked(s, e);
+        s->stats.evictions++;
+    }
+
+    e = g_new0(LocalCacheEntry, 1);
+    e->block = block;
+    e->slot = s->free_slots[--s->nb_free_slots];
+    e->busy = 1;
+    g_hash_table_insert(s->entries, &e->block, e);
+    QTAILQ_INSERT_HEAD(&s->lru, e, lru);
+    return e;
+}
+
+/*
+ * Look up a block for reading.  Returns a valid entry on a hit, an entry to
+ * fill from the filtered node if the missed block is admitted, or NULL.  A
+ * returned entry must be released with local_cache_put().
+ */
+static LocalCacheEntry *local_cache_get(BDRVLocalCacheState *s, int64_t block,
+                                        bool full_block)
+{
+    LocalCacheEntry *e;
+
+    QEMU_LOCK_GUARD(&s->lock);
+
+    e = g_hash_table_lookup(s->entries, &block);
+    if (e && e->valid) {
+        e->busy++;
+        QTAILQ_REMOVE(&s->lru, e, lru);
+        QTAILQ_INSERT_HEAD(&s->lru, e, lru);
+        s->stats.hits++;
+        return e;
+    }
+
+    s->stats.misses++;
+    if (e || !full_block || !s->active ||
+        !local_cache_admit_locked(s, block)) {
+        return NULL;
+    }
+
+    e = local_cache_alloc_locked(s, block);
+    if (e) {
+        s->stats.admissions++;
+    }
+    return e;
+}
+
+/* Release an entry, marking it valid if @ok or dropping it otherwise */
+static void local_cache_put(BDRVLocalCacheState *s, LocalCacheEntry *e,
+                            bool ok)
+{
+    QEMU_LOCK_GUARD(&s->lock);
+
+    e->busy--;
+    if (e->removed) {
+        if (!e->busy) {
+            local_cache_free_entry_locked(s, e);
+        }
+    } else if (!ok) {
+        local_cache_remove_locked(s, e);
+    } else if (!e->valid) {
+        e->valid = true;
+        s->stats.cached_bytes += s->block_size;
+    }
+}
+
+static int coroutine_fn GRAPH_RDLOCK
+local_cache_fill(BlockDriverState *bs, LocalCacheEntry *e, QEMUIOVector *qiov,
+                 size_t qiov_offset)
+{
+    BDRVLocalCacheState *s = bs->opaque;
+
+    trace_local_cache_fill(bs, e->block, e->slot);
+    return bdrv_co_pwritev_part(s->cache, e->slot * s->block_size,
+                                s->block_size, qiov, qiov_offset, 0);
+}
+
+static int coroutine_fn GRAPH_RDLOCK
+local_cache_co_preadv_part(BlockDriverState *bs, int64_t offset,
+                           int64_t bytes, QEMUIOVector *qiov,
+                           size_t qiov_offset, BdrvRequestFlags flags)
+{
+    BDRVLocalCacheState *s = bs->opaque;
+    LocalCacheEntry *next = NULL;
+    int ret;
+
+    while (bytes) {
+        int64_t in_block = offset % s->block_size;
+        int64_t n = MIN(bytes, s->block_size - in_block);
+        LocalCacheEntry *e = next;
+
+        if (!e) {
+            e = local_cache_get(s, offset / s->block_size,
+                                n == s->block_size);
+        }
+        next = NULL;
+
+        if (e && e->valid) {
+            ret = bdrv_co_preadv_part(s->cache,
+                                      e->slot * s->block_size + in_block, n,
+                                      qiov, qiov_offset, 0);
+            local_cache_put(s, e, ret >= 0);
+            if (ret < 0) {
+                /* The cache is only a copy, so go to the source instead */
+                ret = bdrv_co_preadv_part(bs->file, offset, n, qiov,
+                                          qiov_offset, flags);
+            }
+        } else if (e) {
+            ret = bdrv_co_preadv_part(bs->file, offset, n, qiov, qiov_offset,
+                                      flags);
+            local_cache_put(s, e, ret >= 0 &&
+                            local_cache_fill(bs, e, qiov, qiov_offset) >= 0);
+        } else {
+            /* Read the following blocks that won't be cached in one go */
+            while (n < bytes) {
+                int64_t len = MIN(bytes - n, s->block_size);
+
+                next = local_cache_get(s, (offset + n) / s->block_size,
+                                       len == s->block_size);
+                if (next) {
+                    break;
+                }
+                n += len;
+            }
+            ret = bdrv_co_preadv_part(bs->file, offset, n, qiov, qiov_offset,
+                                      flags);
+        }
+
+        if (ret < 0) {
+            if (next) {
+                local_cache_put(s, next, false);
+            }
+            return ret;
+        }
+
+        offset += n;
+        qiov_offset += n;
+        bytes -= n;
+    }
+
+    return 0;
+}
+
+/*
+ * Cached blocks in the range are dropped both before and after a modification
+ * of the filtered node, so that neither a read racing with it nor a read
+ * that started before it can leave stale data behind.
+ */
+static void local_cache_write_begin(BDRVLocalCacheState *s, int64_t offset,
+                                    int64_t bytes, GArray *blocks)
+{
+    QEMU_LOCK_GUARD(&s->lock);
+
+    local_cache_invalidate_locked(s, offset, bytes, blocks);
+    s->writes_in_flight++;
+}
+
+static void local_cache_write_end(BDRVLocalCacheState *s, int64_t offset,
+                                  int64_t bytes)
+{
+    QEMU_LOCK_GUARD(&s->lock);
+
+    local_cache_invalidate_locked(s, offset, bytes, NULL);
+    s->writes_in_flight--;
+}
+
+/*
+ * Write-through: put the new data of blocks that were cached back into the
+ * cache.  Skipped when other writes are in flight, since their order on the
+ * filtered node is unknown.
+ */
+static void coroutine_fn GRAPH_RDLOCK
+local_cache_write_through(BlockDriverState *bs, int64_t offset,
+                          QEMUIOVector *qiov, size_t qiov_offset,
+                          GArray *blocks)
+{
+    BDRVLocalCacheState *s = bs->opaque;
+    guint i;
+
+    for (i = 0; i < blocks->len; i++) {
+        int64_t block = g_array_index(blocks, int64_t, i);
+        LocalCacheEntry *e = NULL;
+
+        WITH_QEMU_LOCK_GUARD(&s->lock) {
+            if (!s->writes_in_flight && s->active &&
+                !g_hash_table_contains(s->entries, &block)) {
+                e = local_cache_alloc_locked(s, block);
+            }
+        }
+        if (e) {
+            size_t off = qiov_offset + block * s->block_size - offset;
+
+            local_cache_put(s, e, local_cache_fill(bs, e, qiov, off) >= 0);
+        }
+    }
+}
+
+static int coroutine_fn GRAPH_RDLOCK
+local_cache_co_pwritev_part(BlockDriverState *bs, int64_t offset,
+                            int64_t bytes, QEMUIOVector *qiov,
+                            size_t qiov_offset, BdrvRequestFlags flags)
+{
+    BDRVLocalCacheState *s = bs->opaque;
+    g_autoptr(GArray) blocks = g_array_new(false, false, sizeof(int64_t));
+    int ret;
+
+    local_cache_write_begin(s, offset, bytes, blocks);
+    ret = bdrv_co_pwritev_part(bs->file, offset, bytes, qiov, qiov_offset,
+                               flags);
+    local_cache_write_end(s, offset, bytes);
+
+    if (ret >= 0 && blocks->len) {
+        local_cache_write_through(bs, offset, qiov, qiov_offset, blocks);
+    }
+    return ret;
+}
+
+static int coroutine_fn GRAPH_RDLOCK
+local_cache_co_pwrite_zeroes(BlockDriverState *bs, int64_t offset,
+                             int64_t bytes, BdrvRequestFlags flags)
+{
+    BDRVLocalCacheState *s = bs->opaque;
+    int ret;
+
+    local_cache_write_begin(s, offset, bytes, NULL);
+    ret = bdrv_co_pwrite_zeroes(bs->file, offset, bytes, flags);
+    local_cache_write_end(s, offset, bytes);
+    return ret;
+}
+
+static int coroutine_fn GRAPH_RDLOCK
+local_cache_co_pdiscard(BlockDriverState *bs, int64_t offset, int64_t bytes)
+{
+    BDRVLocalCacheState *s = bs->opaque;
+    int ret;
+
+    local_cache_write_begin(s, offset, bytes, NULL);
+    ret = bdrv_co_pdiscard(bs->file, offset, bytes);
+    local_cache_write_end(s, offset, bytes);
+    return ret;
+}
+
+static int coroutine_fn GRAPH_RDLOCK
+local_cache_co_truncate(BlockDriverState *bs, int64_t offset, bool exact,
+                        PreallocMode prealloc, BdrvRequestFlags flags,
+                        Error **errp)
+{
+    BDRVLocalCacheState *s = bs->opaque;
+    int ret;
+
+    WITH_QEMU_LOCK_GUARD(&s->lock) {
+        local_cache_invalidate_all_locked(s);
+        s->writes_in_flight++;
+    }
+    ret = bdrv_co_truncate(bs->file, offset, exact, prealloc, flags, errp);
+    WITH_QEMU_LOCK_GUARD(&s->lock) {
+        local_cache_invalidate_all_locked(s);
+        s->writes_in_flight--;
+    }
+    return ret;
+}
+
+static int coroutine_fn GRAPH_RDLOCK local_cache_co_flush(BlockDriverState *bs)
+{
+    /* The cache image holds nothing that is needed after a crash */
+    return bdrv_co_flush(bs->file->bs);
+}
+
+static int64_t coroutine_fn GRAPH_RDLOCK
+local_cache_co_getlength(BlockDriverState *bs)
+{
+    return bdrv_co_getlength(bs->file->bs);
+}
+
+/*
+ * The cache is local to this host, so drop it when another host may take
+ * over the disk and start over cold when we get it back.
+ */
+static int GRAPH_RDLOCK local_cache_inactivate(BlockDriverState *bs)
+{
+    BDRVLocalCacheState *s = bs->opaque;
+
+    QEMU_LOCK_GUARD(&s->lock);
+    local_cache_invalidate_all_locked(s);
+    s->active = false;
+    return 0;
+}
+
+static void coroutine_fn GRAPH_RDLOCK
+local_cache_co_invalidate_cache(BlockDriverState *bs, Error **errp)
+{
+    BDRVLocalCacheState *s = bs->opaque;
+
+    QEMU_LOCK_GUARD(&s->lock);
+    local_cache_invalidate_all_locked(s);
+    s->active = true;
+}
+
+static BlockStatsSpecific *local_cache_get_specific_stats(BlockDriverState *bs)
+{
+    BDRVLocalCacheState *s = bs->opaque;
+    BlockStatsSpecific *stats = g_new(BlockStatsSpecific, 1);
+
+    stats->driver = BLOCKDEV_DRIVER_LOCAL_CACHE;
+    WITH_QEMU_LOCK_GUARD(&s->lock) {
+        stats->u.local_cache = s->stats;
+    }
+    return stats;
+}
+
+static void GRAPH_RDLOCK local_cache_refresh_filename(BlockDriverState *bs)
+{
+    pstrcpy(bs->exact_filename, sizeof(bs->exact_filename),
+            bs->file->bs->filename);
+}
+
+static void GRAPH_RDLOCK
+local_cache_child_perm(BlockDriverState *bs, BdrvChild *c, BdrvChildRole role,
+                       BlockReopenQueue *reopen_queue,
+                       uint64_t perm, uint64_t shared,
+                       uint64_t *nperm, uint64_t *nshared)
+{
+    if (role & BDRV_CHILD_FILTERED) {
+        bdrv_default_perms(bs, c, role, reopen_queue, perm, shared,
+                           nperm, nshared);
+        return;
+    }
+
+    /* The cache image is private to the filter */
+    *nperm = BLK_PERM_CONSISTENT_READ;
+    if (!(bs->open_flags & BDRV_O_INACTIVE)) {
+        *nperm |= BLK_PERM_WRITE;
+    }
+    *nshared = BLK_PERM_CONSISTENT_READ | BLK_PERM_WRITE_UNCHANGED;
+}
+
+static int local_cache_open(BlockDriverState *bs, QDict *options, int flags,
+                            Error **errp)
+{
+    BDRVLocalCacheState *s = bs->opaque;
+    QemuOpts *opts;
+    const char *admission;
+    int64_t cache_len, cache_size;
+    Error *local_err = NULL;
+    int64_t i;
+    int ret;
+
+    GLOBAL_STATE_CODE();
+
+    opts = qemu_opts_create(&runtime_opts, NULL, 0, &error_abort);
+    if (!qemu_opts_absorb_qdict(opts, options, errp)) {
+        ret = -EINVAL;
+        goto out;
+    }
+
+    ret = bdrv_open_file_child(NULL, options, "file", bs, errp);
+    if (ret < 0) {
+        goto out;
+    }
+
+    s->cache = bdrv_open_child(NULL, options, "cache", bs, &child_of_bds,
+                               BDRV_CHILD_DATA, false, errp);
+    if (!s->cache) {
+        ret = -EINVAL;
+        goto out;
+    }
+
+    GRAPH_RDLOCK_GUARD_MAINLOOP();
+
+    s->block_size = qemu_opt_get_size(opts, LOCAL_CACHE_OPT_BLOCK_SIZE,
+                                      64 * KiB);
+    if (s->block_size < BDRV_SECTOR_SIZE || s->block_size > 64 * MiB ||
+        !is_power_of_2(s->block_size)) {
+        error_setg(errp, "block-size must be a power of two between 512 "
+                   "and 64M");
+        ret = -EINVAL;
+        goto out;
+    }
+
+    admission = qemu_opt_get(opts, LOCAL_CACHE_OPT_ADMISSION);
+    s->admission = qapi_enum_parse(&LocalCacheAdmission_lookup, admission,
+                                   LOCAL_CACHE_ADMISSION_ADAPTIVE,
+                                   &local_err);
+    if (local_err) {
+        error_propagate(errp, local_err);
+        ret = -EINVAL;
+        goto out;
+    }
+
+    cache_len = bdrv_getlength(s->cache->bs);
+    if (cache_len < 0) {
+        error_setg_errno(errp, -cache_len, "Failed to get cache image length");
+        ret = cache_len;
+        goto out;
+    }
+    cache_size = qemu_opt_get_size(opts, LOCAL_CACHE_OPT_CACHE_SIZE,
+                                   cache_len);
+    if (cache_size > cache_len) {
+        error_setg(errp, "cache-size exceeds the length of the cache image "
+                   "(%" PRId64 " bytes)", cache_len);
+        ret = -EINVAL;
+        goto out;
+    }
+    s->nb_slots = cache_size / s->block_size;
+    if (!s->nb_slots) {
+        error_setg(errp, "The cache must hold at least one block");
+        ret = -EINVAL;
+        goto out;
+    }
+
+    bs->supported_write_flags = BDRV_REQ_WRITE_UNCHANGED |
+        (BDRV_REQ_FUA & bs->file->bs->supported_write_flags);
+
+    bs->supported_zero_flags = BDRV_REQ_WRITE_UNCHANGED |
+        ((BDRV_REQ_FUA | BDRV_REQ_MAY_UNMAP | BDRV_REQ_NO_FALLBACK) &
+            bs->file->bs->supported_zero_flags);
+
+    qemu_mutex_init(&s->lock);
+    s->entries = g_hash_table_new(g_int64_hash, g_int64_equal);
+    QTAILQ_INIT(&s->lru);
+    s->free_slots = g_new(int64_t, s->nb_slots);
+    for (i = 0; i < s->nb_slots; i++) {
+        s->free_slots[i] = s->nb_slots - 1 - i;
+    }
+    s->nb_free_slots = s->nb_slots;
+    s->ghost = g_hash_table_new(g_int64_hash, g_int64_equal);
+    s->ghost_ring = g_new0(int64_t, s->nb_slots);
+    s->active = !(flags & BDRV_O_INACTIVE);
+    s->stats.size = s->nb_slots * s->block_size;
+    ret = 0;
+
+out:
+    qemu_opts_del(opts);
+    return ret;
+}
+
+static void local_cache_close(BlockDriverState *bs)
+{
+    BDRVLocalCacheState *s = bs->opaque;
+    LocalCacheEntry *e, *next;
+
+    if (!s->entries) {
+        return;
+    }
+
+    QTAILQ_FOREACH_SAFE(e, &s->lru, lru, next) {
+        g_free(e);
+    }
+    g_hash_table_destroy(s->entries);
+    g_hash_table_destroy(s->ghost);
+    g_free(s->ghost_ring);
+    g_free(s->free_slots);
+    qemu_mutex_destroy(&s->lock);
+}
+
+static BlockDriver bdrv_local_cache = {
+    .format_name                        = "local-cache",
+    .instance_size                      = sizeof(BDRVLocalCacheState),
+
+    .bdrv_open                          = local_cache_open,
+    .bdrv_close                         = local_cache_close,
+    .bdrv_child_perm                    = local_cache_child_perm,
+    .bdrv_refresh_filename              = local_cache_refresh_filename,
+
+    .bdrv_co_getlength                  = local_cache_co_getlength,
+
+    .bdrv_co_preadv_part                = local_cache_co_preadv_part,
+    .bdrv_co_pwritev_part               = local_cache_co_pwritev_part,
+    .bdrv_co_pwrite_zeroes              = local_cache_co_pwrite_zeroes,
+    .bdrv_co_pdiscard                   = local_cache_co_pdiscard,
+    .bdrv_co_truncate                   = local_cache_co_truncate,
+    .bdrv_co_flush                      = local_cache_co_flush,
+
+    .bdrv_inactivate                    = local_cache_inactivate,
+    .bdrv_co_invalidate_cache           = local_cache_co_invalidate_cache,
+
+    .bdrv_get_specific_stats            = local_cache_get_specific_stats,
+
+    .is_filter                          = true,
+};
+
+static void bdrv_local_cache_init(void)
+{
+    bdrv_register(&bdrv_local_cache);
+}
+
+block_init(bdrv_local_cache_init);
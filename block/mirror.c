@@ -24,10 +24,15 @@
 #include "qemu/ratelimit.h"
 #include "qemu/bitmap.h"
 #include "qemu/memalign.h"
+#include "qemu/units.h"
 
 #define MAX_IN_FLIGHT 16
 #define MAX_IO_BYTES (1 << 20) /* 1 Mb */
 #define DEFAULT_MIRROR_BUF_SIZE (MAX_IN_FLIGHT * MAX_IO_BYTES)
+/* Offloaded copies use no buffer, so they can be larger */
+#define MAX_COPY_RANGE_BYTES (64 * MiB)
+/* Largest zero or unallocated area handled in one iteration */
+#define MAX_ZERO_AREA_BYTES (1 * GiB)
 
 /* The mirroring buffer is a list of granularity-sized chunks.
  * Free chunks are organized in a list.
@@ -89,6 +94,8 @@ typedef struct MirrorBlockJob {
     bool unmap;
     int target_cluster_size;
     int max_iov;
+    /* Try copy offloading, cleared the first time it fails */
+    bool use_copy_range;
     bool initial_zeroing_ongoing;
     int in_active_write_counter;
     int64_t active_write_bytes_in_flight;
@@ -128,6 +135,7 @@ struct MirrorOp {
 
 typedef enum MirrorMethod {
     MIRROR_METHOD_COPY,
+    MIRROR_METHOD_COPY_RANGE,
     MIRROR_METHOD_ZERO,
     MIRROR_METHOD_DISCARD,
 } MirrorMethod;
@@ -409,6 +417,38 @@ static void coroutine_fn mirror_co_read(void *opaque)
     mirror_read_complete(op, ret);
 }
 
+/*
+ * Copy without going through s->buf, e.g. with copy_file_range() when
+ * source and target are on the same file system.  If offloading is not
+ * possible, the area is marked dirty again and copied normally by a later
+ * iteration.
+ */
+static void coroutine_fn mirror_co_copy_range(void *opaque)
+{
+    MirrorOp *op = opaque;
+    MirrorBlockJob *s = op->s;
+    int ret;
+
+    s->in_flight++;
+    s->bytes_in_flight += op->bytes;
+    *op->bytes_handled = op->bytes;
+    op->is_in_flight = true;
+    trace_mirror_one_iteration(s, op->offset, op->bytes);
+
+    WITH_GRAPH_RDLOCK_GUARD() {
+        ret = bdrv_co_copy_range(s->mirror_top_bs->backing, op->offset,
+                                 blk_root(s->target), op->offset, op->bytes,
+                                 0, 0);
+    }
+    if (ret < 0) {
+        trace_mirror_copy_range_fallback(s, op->offset, op->bytes, ret);
+        s->use_copy_range = false;
+        bdrv_set_dirty_bitmap(s->dirty_bitmap, op->offset, op->bytes);
+        ret = 0;
+    }
+    mirror_iteration_done(op, ret);
+}
+
 static void coroutine_fn mirror_co_zero(void *opaque)
 {
     MirrorOp *op = opaque;
@@ -486,6 +526,13 @@ static unsigned mirror_perform(MirrorBlockJob *s, int64_t offset,
         }
         co = qemu_coroutine_create(mirror_co_read, op);
         break;
+    case MIRROR_METHOD_COPY_RANGE:
+        if (s->zero_bitmap) {
+            bitmap_clear(s->zero_bitmap, offset / s->granularity,
+                         DIV_ROUND_UP(bytes, s->granularity));
+        }
+        co = qemu_coroutine_create(mirror_co_copy_range, op);
+        break;
     case MIRROR_METHOD_ZERO:
         /* s->zero_bitmap handled in mirror_co_zero */
         co = qemu_coroutine_create(mirror_co_zero, op);
@@ -522,8 +569,10 @@ static void coroutine_fn GRAPH_UNLOCKED mirror_iteration(MirrorBlockJob *s)
     BlockDriverState *source;
     MirrorOp *pseudo_op;
     int64_t offset;
-    /* At least the first dirty chunk is mirrored in one iteration. */
-    int nb_chunks = 1;
+    int64_t max_area, area_end, dirty_end;
+    int64_t status_bytes;
+    int64_t nb_chunks, in_flight_chunk;
+    int status;
     bool write_zeroes_ok = bdrv_can_write_zeroes_with_unmap(blk_bs(s->target));
     int max_io_bytes = MAX(s->buf_size / MAX_IN_FLIGHT, MAX_IO_BYTES);
 
@@ -552,29 +601,46 @@ static void coroutine_fn GRAPH_UNLOCKED mirror_iteration(MirrorBlockJob *s)
 
     job_pause_point(&s->common.job);
 
-    /* Find the number of consecutive dirty chunks following the first dirty
-     * one, and wait for in flight requests in them. */
-    bdrv_dirty_bitmap_lock(s->dirty_bitmap);
-    while (nb_chunks * s->granularity < s->buf_size) {
-        int64_t next_dirty;
-        int64_t next_offset = offset + nb_chunks * s->granularity;
-        int64_t next_chunk = next_offset / s->granularity;
-        if (next_offset >= s->bdev_length ||
-            !bdrv_dirty_bitmap_get_locked(s->dirty_bitmap, next_offset)) {
-            break;
-        }
-        if (test_bit(next_chunk, s->in_flight_bitmap)) {
-            break;
-        }
+    /*
+     * Data is mirrored in areas of up to buf_size, but zero or unallocated
+     * areas need no buffer and are cheap to write, so take them in bulk.
+     * This is only a hint for the size of the area, the loop below checks
+     * the block status again after clearing the dirty bits.
+     */
+    max_area = s->buf_size;
+    WITH_GRAPH_RDLOCK_GUARD() {
+        status = bdrv_co_block_status_above(source, NULL, offset,
+                                            MIN(s->bdev_length - offset,
+                                                MAX_ZERO_AREA_BYTES),
+                                            &status_bytes, NULL, NULL);
+    }
+    if (status >= 0 && !(status & BDRV_BLOCK_DATA)) {
+        max_area = MAX(max_area, status_bytes);
+    }
 
-        next_dirty = bdrv_dirty_iter_next(s->dbi);
-        if (next_dirty > next_offset || next_dirty < 0) {
-            /* The bitmap iterator's cache is stale, refresh it */
-            bdrv_set_dirty_iter(s->dbi, next_offset);
-            next_dirty = bdrv_dirty_iter_next(s->dbi);
-        }
-        assert(next_dirty == next_offset);
-        nb_chunks++;
+    /*
+     * Find the extent of consecutive dirty chunks starting at @offset, up
+     * to the first chunk with a request in flight.  At least the first
+     * dirty chunk is mirrored in one iteration.
+     */
+    bdrv_dirty_bitmap_lock(s->dirty_bitmap);
+    area_end = MIN(s->bdev_length, offset + max_area);
+    dirty_end = bdrv_dirty_bitmap_next_zero(s->dirty_bitmap, offset,
+                                            area_end - offset);
+    if (dirty_end < 0) {
+        dirty_end = area_end;
+    }
+    nb_chunks = MAX(DIV_ROUND_UP(dirty_end - offset, s->granularity), 1);
+    in_flight_chunk = find_next_bit(s->in_flight_bitmap,
+                                    offset / s->granularity + nb_chunks,
+                                    offset / s->granularity + 1);
+    nb_chunks = in_flight_chunk - offset / s->granularity;
+
+    /* The bitmap iterator's cache is stale after the reset below */
+    if (offset + nb_chunks * s->granularity < s->bdev_length) {
+        bdrv_set_dirty_iter(s->dbi, offset + nb_chunks * s->granularity);
+    } else {
+        bdrv_set_dirty_iter(s->dbi, 0);
     }
 
     /* Clear dirty bits before querying the block status, because
@@ -617,7 +683,12 @@ static void coroutine_fn GRAPH_UNLOCKED mirror_iteration(MirrorBlockJob *s)
         if (ret < 0) {
             io_bytes = MIN(nb_chunks * s->granularity, max_io_bytes);
         } else if (ret & BDRV_BLOCK_DATA) {
-            io_bytes = MIN(io_bytes, max_io_bytes);
+            if (s->use_copy_range) {
+                mirror_method = MIRROR_METHOD_COPY_RANGE;
+                io_bytes = MIN(io_bytes, MAX_COPY_RANGE_BYTES);
+            } else {
+                io_bytes = MIN(io_bytes, max_io_bytes);
+            }
         }
 
         io_bytes -= io_bytes % s->granularity;
@@ -652,7 +723,8 @@ static void coroutine_fn GRAPH_UNLOCKED mirror_iteration(MirrorBlockJob *s)
         io_bytes = mirror_perform(s, offset, io_bytes, mirror_method,
                                   &io_skipped);
         if (io_skipped ||
-            (mirror_method != MIRROR_METHOD_COPY && write_zeroes_ok)) {
+            ((mirror_method == MIRROR_METHOD_ZERO ||
+              mirror_method == MIRROR_METHOD_DISCARD) && write_zeroes_ok)) {
             io_bytes_acct = 0;
         } else {
             io_bytes_acct = io_bytes;
@@ -1098,6 +1170,8 @@ static int coroutine_fn mirror_run(Job *job, Error **errp)
         s->buf_size = MAX(s->buf_size, s->target_cluster_size);
         s->cow_bitmap = bitmap_new(length);
     }
+    /* Offloaded copies are not aligned to the target's clusters */
+    s->use_copy_range = !s->cow_bitmap;
     s->max_iov = MIN(bs->bl.max_iov, target_bs->bl.max_iov);
     bdrv_graph_co_rdunlock();
 
@@ -1222,7 +1296,9 @@ static int coroutine_fn mirror_run(Job *job, Error **errp)
             /* The two disks are in sync.  Exit and report successful
              * completion.
              */
-            assert(QLIST_EMPTY(&bs->tracked_requests));
+            for (int i = 0; i < BDRV_TRACKED_REQ_SHARDS; i++) {
+                assert(QLIST_EMPTY(&bs->tracked_requests[i].list));
+            }
             need_drain = false;
             break;
         }
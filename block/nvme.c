@@ -146,6 +146,7 @@ struct BDRVNVMeState {
 
 #define NVME_BLOCK_OPT_DEVICE "device"
 #define NVME_BLOCK_OPT_NAMESPACE "namespace"
+#define NVME_BLOCK_OPT_QUEUES "queues"
 
 static void nvme_process_completion_bh(void *opaque);
 
@@ -163,6 +164,11 @@ static QemuOptsList runtime_opts = {
             .type = QEMU_OPT_NUMBER,
             .help = "NVMe namespace",
         },
+        {
+            .name = NVME_BLOCK_OPT_QUEUES,
+            .type = QEMU_OPT_NUMBER,
+            .help = "Number of I/O queue pairs (default: 1)",
+        },
         { /* end of list */ }
     },
 };
@@ -285,7 +291,7 @@ fail:
     return NULL;
 }
 
-/* With q->lock, must be run in the BDS's main AioContext */
+/* With q->lock, may be run in any AioContext */
 static void nvme_kick(NVMeQueuePair *q)
 {
     BDRVNVMeState *s = q->s;
@@ -501,7 +507,10 @@ static void nvme_kick_and_check_completions(void *opaque)
     nvme_process_completion(q);
 }
 
-/* Runs in nvme_submit_command()'s AioContext */
+/*
+ * Runs in nvme_submit_command()'s AioContext.  The doorbell is rung right
+ * away, only completions are left to the BDS's main AioContext.
+ */
 static void nvme_deferred_fn(void *opaque)
 {
     NVMeQueuePair *q = opaque;
@@ -509,6 +518,9 @@ static void nvme_deferred_fn(void *opaque)
     if (qemu_get_current_aio_context() == q->s->aio_context) {
         nvme_kick_and_check_completions(q);
     } else {
+        WITH_QEMU_LOCK_GUARD(&q->lock) {
+            nvme_kick(q);
+        }
         aio_bh_schedule_oneshot(q->s->aio_context,
                                 nvme_kick_and_check_completions, q);
     }
@@ -740,6 +752,42 @@ out_error:
     return false;
 }
 
+/*
+ * Ask for @count I/O queue pairs and return how many the controller
+ * allocated, or 0 if the command failed.
+ */
+static unsigned nvme_set_io_queue_count(BlockDriverState *bs, unsigned count)
+{
+    NvmeCmd cmd = {
+        .opcode = NVME_ADM_CMD_SET_FEATURES,
+        .cdw10 = cpu_to_le32(NVME_NUMBER_OF_QUEUES),
+        .cdw11 = cpu_to_le32(((count - 1) << 16) | (count - 1)),
+    };
+
+    /*
+     * The allocated counts are only returned in the completion entry,
+     * which nvme_admin_cmd_sync() does not expose.  The controller may
+     * allocate fewer queues than requested, in which case creating the
+     * excess ones fails and nvme_init() stops there.
+     */
+    return nvme_admin_cmd_sync(bs, &cmd) ? 0 : count;
+}
+
+/*
+ * Pick the I/O queue pair of the current AioContext, so that iothreads
+ * submitting to the same node do not contend on the lock of one queue.
+ */
+static NVMeQueuePair *nvme_get_io_queue(BDRVNVMeState *s)
+{
+    unsigned n = s->queue_count - INDEX_IO(0);
+
+    assert(n > 0);
+    if (n == 1) {
+        return s->queues[INDEX_IO(0)];
+    }
+    return s->queues[INDEX_IO(qemu_get_current_aio_context_shard(16) % n)];
+}
+
 /* Run as an event notifier in the BDS's main AioContext */
 static bool nvme_poll_cb(void *opaque)
 {
@@ -774,10 +822,11 @@ static void nvme_poll_ready(EventNotifier *e)
 }
 
 static int nvme_init(BlockDriverState *bs, const char *device, int namespace,
-                     Error **errp)
+                     unsigned io_queues, Error **errp)
 {
     BDRVNVMeState *s = bs->opaque;
     NVMeQueuePair *q;
+    unsigned max_io_queues;
     AioContext *aio_context = bdrv_get_aio_context(bs);
     int ret;
     uint64_t cap;
@@ -917,9 +966,25 @@ static int nvme_init(BlockDriverState *bs, const char *device, int namespace,
         goto out;
     }
 
-    /* Set up command queues. */
+    /* Set up command queues, as many as the doorbell mapping covers. */
+    max_io_queues = NVME_DOORBELL_SIZE /
+                    (s->doorbell_scale * sizeof(*s->doorbells)) - 1;
+    io_queues = MIN(io_queues, max_io_queues);
+    if (io_queues > 1) {
+        io_queues = MAX(nvme_set_io_queue_count(bs, io_queues), 1);
+    }
     if (!nvme_add_io_queue(bs, errp)) {
         ret = -EIO;
+        goto out;
+    }
+    while (s->queue_count < INDEX_IO(io_queues)) {
+        Error *local_err = NULL;
+
+        if (!nvme_add_io_queue(bs, &local_err)) {
+            warn_reportf_err(local_err, "Using %u I/O queues instead of %u: ",
+                             s->queue_count - INDEX_IO(0), io_queues);
+            break;
+        }
     }
 out:
     if (regs) {
@@ -1010,6 +1075,7 @@ static int nvme_open(BlockDriverState *bs, QDict *options, int flags,
     const char *device;
     QemuOpts *opts;
     int namespace;
+    uint64_t io_queues;
     int ret;
     BDRVNVMeState *s = bs->opaque;
 
@@ -1025,7 +1091,14 @@ static int nvme_open(BlockDriverState *bs, QDict *options, int flags,
     }
 
     namespace = qemu_opt_get_number(opts, NVME_BLOCK_OPT_NAMESPACE, 1);
-    ret = nvme_init(bs, device, namespace, errp);
+    io_queues = qemu_opt_get_number(opts, NVME_BLOCK_OPT_QUEUES, 1);
+    if (io_queues < 1 || io_queues > UINT16_MAX) {
+        error_setg(errp, "'" NVME_BLOCK_OPT_QUEUES "' must be between 1 "
+                   "and %u", UINT16_MAX);
+        qemu_opts_del(opts);
+        return -EINVAL;
+    }
+    ret = nvme_init(bs, device, namespace, io_queues, errp);
     qemu_opts_del(opts);
     if (ret) {
         goto fail;
@@ -1240,7 +1313,7 @@ static coroutine_fn int nvme_co_prw_aligned(BlockDriverState *bs,
 {
     int r;
     BDRVNVMeState *s = bs->opaque;
-    NVMeQueuePair *ioq = s->queues[INDEX_IO(0)];
+    NVMeQueuePair *ioq = nvme_get_io_queue(s);
     NVMeRequest *req;
 
     uint32_t cdw12 = (((bytes >> s->blkshift) - 1) & 0xFFFF) |
@@ -1359,7 +1432,7 @@ static coroutine_fn int nvme_co_pwritev(BlockDriverState *bs,
 static coroutine_fn int nvme_co_flush(BlockDriverState *bs)
 {
     BDRVNVMeState *s = bs->opaque;
-    NVMeQueuePair *ioq = s->queues[INDEX_IO(0)];
+    NVMeQueuePair *ioq = nvme_get_io_queue(s);
     NVMeRequest *req;
     NvmeCmd cmd = {
         .opcode = NVME_CMD_FLUSH,
@@ -1388,7 +1461,7 @@ static coroutine_fn int nvme_co_pwrite_zeroes(BlockDriverState *bs,
                                               BdrvRequestFlags flags)
 {
     BDRVNVMeState *s = bs->opaque;
-    NVMeQueuePair *ioq = s->queues[INDEX_IO(0)];
+    NVMeQueuePair *ioq = nvme_get_io_queue(s);
     NVMeRequest *req;
     uint32_t cdw12;
 
@@ -1449,7 +1522,7 @@ static int coroutine_fn nvme_co_pdiscard(BlockDriverState *bs,
                                          int64_t bytes)
 {
     BDRVNVMeState *s = bs->opaque;
-    NVMeQueuePair *ioq = s->queues[INDEX_IO(0)];
+    NVMeQueuePair *ioq = nvme_get_io_queue(s);
     NVMeRequest *req;
     QEMU_AUTO_VFREE NvmeDsmRange *buf = NULL;
     QEMUIOVector local_qiov;
@@ -1471,6 +1471,7 @@ static BlockDriver bdrv_parallels = {
     .bdrv_close                 = parallels_close,
     .bdrv_child_perm            = bdrv_default_perms,
     .bdrv_co_block_status       = parallels_co_block_status,
+    .block_status_cacheable     = true,
     .bdrv_co_flush_to_os        = parallels_co_flush_to_os,
     .bdrv_co_readv              = parallels_co_readv,
     .bdrv_co_writev             = parallels_co_writev,
@@ -1201,6 +1201,7 @@ static BlockDriver bdrv_qcow = {
     .bdrv_co_preadv         = qcow_co_preadv,
     .bdrv_co_pwritev        = qcow_co_pwritev,
     .bdrv_co_block_status   = qcow_co_block_status,
+    .block_status_cacheable = true,
 
     .bdrv_make_empty        = qcow_make_empty,
     .bdrv_co_pwritev_compressed = qcow_co_pwritev_compressed,
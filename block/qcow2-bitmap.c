@@ -63,6 +63,9 @@ QEMU_BUILD_BUG_ON(BME_MAX_NAME_SIZE != BDRV_BITMAP_MAX_NAME_SIZE);
 #define BME_TABLE_ENTRY_OFFSET_MASK 0x00fffffffffffe00ULL
 #define BME_TABLE_ENTRY_FLAG_ALL_ONES (1ULL << 0)
 
+/* Bitmap data clusters are read and written in runs of up to this size */
+#define BME_IO_BUF_SIZE (1 * MiB)
+
 typedef struct QEMU_PACKED Qcow2BitmapDirEntry {
     /* header is 8 byte aligned */
     uint64_t bitmap_table_offset;
@@ -294,7 +297,7 @@ load_bitmap_data(BlockDriverState *bs, const uint64_t *bitmap_table,
     uint64_t offset, limit;
     uint64_t bm_size = bdrv_dirty_bitmap_size(bitmap);
     uint8_t *buf = NULL;
-    uint64_t i, tab_size =
+    uint64_t i, j, n, max_clusters, tab_size =
             size_to_clusters(s,
                 bdrv_dirty_bitmap_serialization_size(bitmap, 0, bm_size));
 
@@ -302,29 +305,47 @@ load_bitmap_data(BlockDriverState *bs, const uint64_t *bitmap_table,
         return -EINVAL;
     }
 
-    buf = g_malloc(s->cluster_size);
+    max_clusters = MAX(BME_IO_BUF_SIZE / s->cluster_size, 1);
+    buf = g_malloc(MIN(tab_size, max_clusters) * s->cluster_size);
     limit = bdrv_dirty_bitmap_serialization_coverage(s->cluster_size, bitmap);
-    for (i = 0, offset = 0; i < tab_size; ++i, offset += limit) {
-        uint64_t count = MIN(bm_size - offset, limit);
+    for (i = 0; i < tab_size; i += n) {
         uint64_t entry = bitmap_table[i];
         uint64_t data_offset = entry & BME_TABLE_ENTRY_OFFSET_MASK;
 
         assert(check_table_entry(entry, s->cluster_size) == 0);
 
+        offset = i * limit;
+        n = 1;
         if (data_offset == 0) {
             if (entry & BME_TABLE_ENTRY_FLAG_ALL_ONES) {
-                bdrv_dirty_bitmap_deserialize_ones(bitmap, offset, count,
+                bdrv_dirty_bitmap_deserialize_ones(bitmap, offset,
+                                                   MIN(bm_size - offset, limit),
                                                    false);
             } else {
                 /* No need to deserialize zeros because the dirty bitmap is
                  * already cleared */
             }
-        } else {
-            ret = bdrv_co_pread(bs->file, data_offset, s->cluster_size, buf, 0);
-            if (ret < 0) {
-                goto finish;
-            }
-            bdrv_dirty_bitmap_deserialize_part(bitmap, buf, offset, count,
+            continue;
+        }
+
+        /* Read clusters that are contiguous in the image in one go */
+        while (i + n < tab_size && n < max_clusters &&
+               (bitmap_table[i + n] & BME_TABLE_ENTRY_OFFSET_MASK) ==
+               data_offset + n * s->cluster_size) {
+            assert(check_table_entry(bitmap_table[i + n],
+                                     s->cluster_size) == 0);
+            n++;
+        }
+
+        ret = bdrv_co_pread(bs->file, data_offset, n * s->cluster_size, buf, 0);
+        if (ret < 0) {
+            goto finish;
+        }
+        for (j = 0; j < n; j++, offset += limit) {
+            bdrv_dirty_bitmap_deserialize_part(bitmap,
+                                               buf + j * s->cluster_size,
+                                               offset,
+                                               MIN(bm_size - offset, limit),
                                                false);
         }
     }
@@ -1283,10 +1304,11 @@ store_bitmap_data(BlockDriverState *bs, BdrvDirtyBitmap *bitmap,
     int ret;
     BDRVQcow2State *s = bs->opaque;
     int64_t offset;
-    uint64_t limit;
+    uint64_t limit, max_clusters;
     uint64_t bm_size = bdrv_dirty_bitmap_size(bitmap);
     const char *bm_name = bdrv_dirty_bitmap_name(bitmap);
     uint8_t *buf = NULL;
+    uint64_t *clusters;
     uint64_t *tb;
     uint64_t tb_size =
             size_to_clusters(s,
@@ -1305,66 +1327,89 @@ store_bitmap_data(BlockDriverState *bs, BdrvDirtyBitmap *bitmap,
         return NULL;
     }
 
-    buf = g_malloc(s->cluster_size);
+    max_clusters = MAX(BME_IO_BUF_SIZE / s->cluster_size, 1);
+    buf = g_malloc(MIN(tb_size, max_clusters) * s->cluster_size);
+    clusters = g_new(uint64_t, max_clusters);
     limit = bdrv_dirty_bitmap_serialization_coverage(s->cluster_size, bitmap);
     assert(DIV_ROUND_UP(bm_size, limit) == tb_size);
 
     offset = 0;
-    while ((offset = bdrv_dirty_bitmap_next_dirty(bitmap, offset, INT64_MAX))
-           >= 0)
-    {
-        uint64_t cluster = offset / limit;
-        uint64_t end, write_size;
+    while (offset >= 0) {
+        uint64_t i, n = 0;
         int64_t off;
 
         /*
-         * We found the first dirty offset, but want to write out the
-         * entire cluster of the bitmap that includes that offset,
-         * including any leading zero bits.
+         * Serialize up to max_clusters non-empty clusters of the bitmap
+         * into buf, so that they can be written with a single request.
          */
-        offset = QEMU_ALIGN_DOWN(offset, limit);
-        end = MIN(bm_size, offset + limit);
-        write_size = bdrv_dirty_bitmap_serialization_size(bitmap, offset,
-                                                          end - offset);
-        assert(write_size <= s->cluster_size);
+        while (n < max_clusters &&
+               (offset = bdrv_dirty_bitmap_next_dirty(bitmap, offset,
+                                                      INT64_MAX)) >= 0)
+        {
+            uint64_t end, write_size;
+            uint8_t *cluster_buf = buf + n * s->cluster_size;
+
+            /*
+             * We found the first dirty offset, but want to write out the
+             * entire cluster of the bitmap that includes that offset,
+             * including any leading zero bits.
+             */
+            offset = QEMU_ALIGN_DOWN(offset, limit);
+            end = MIN(bm_size, offset + limit);
+            write_size = bdrv_dirty_bitmap_serialization_size(bitmap, offset,
+                                                              end - offset);
+            assert(write_size <= s->cluster_size);
+
+            bdrv_dirty_bitmap_serialize_part(bitmap, cluster_buf, offset,
+                                             end - offset);
+            if (write_size < s->cluster_size) {
+                memset(cluster_buf + write_size, 0,
+                       s->cluster_size - write_size);
+            }
 
-        off = qcow2_alloc_clusters(bs, s->cluster_size);
+            clusters[n++] = offset / limit;
+            offset = end;
+        }
+
+        if (n == 0) {
+            break;
+        }
+
+        off = qcow2_alloc_clusters(bs, n * s->cluster_size);
         if (off < 0) {
             error_setg_errno(errp, -off,
                              "Failed to allocate clusters for bitmap '%s'",
                              bm_name);
             goto fail;
         }
-        tb[cluster] = off;
-
-        bdrv_dirty_bitmap_serialize_part(bitmap, buf, offset, end - offset);
-        if (write_size < s->cluster_size) {
-            memset(buf + write_size, 0, s->cluster_size - write_size);
+        for (i = 0; i < n; i++) {
+            tb[clusters[i]] = off + i * s->cluster_size;
         }
 
-        ret = qcow2_pre_write_overlap_check(bs, 0, off, s->cluster_size, false);
+        ret = qcow2_pre_write_overlap_check(bs, 0, off, n * s->cluster_size,
+                                            false);
         if (ret < 0) {
             error_setg_errno(errp, -ret, "Qcow2 overlap check failed");
             goto fail;
         }
 
-        ret = bdrv_pwrite(bs->file, off, s->cluster_size, buf, 0);
+        ret = bdrv_pwrite(bs->file, off, n * s->cluster_size, buf, 0);
         if (ret < 0) {
             error_setg_errno(errp, -ret, "Failed to write bitmap '%s' to file",
                              bm_name);
             goto fail;
         }
-
-        offset = end;
     }
 
     *bitmap_table_size = tb_size;
+    g_free(clusters);
     g_free(buf);
 
     return tb;
 
 fail:
     clear_bitmap_table(bs, tb, tb_size);
+    g_free(clusters);
     g_free(buf);
     g_free(tb);
 
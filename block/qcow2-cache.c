@@ -23,8 +23,12 @@
  */
 
 #include "qemu/osdep.h"
+#include "block/aio_task.h"
 #include "block/block-io.h"
 #include "qemu/memalign.h"
+#include "qemu/host-utils.h"
+#include "qemu/queue.h"
+#include "qemu/seqlock.h"
 #include "qcow2.h"
 #include "trace.h"
 
@@ -33,6 +37,19 @@ typedef struct Qcow2CachedTable {
     uint64_t lru_counter;
     int      ref;
     bool     dirty;
+
+    /* Set by lockless hits, gives the table a second chance on eviction */
+    bool     accessed;
+
+    /* Linked into Qcow2Cache.lru while ref == 0 */
+    QTAILQ_ENTRY(Qcow2CachedTable) lru_entry;
+
+    /*
+     * Writers hold s->lock and bump the sequence around any change of
+     * offset or whole-table replacement of the contents, so that
+     * qcow2_cache_read_entries() can look up tables without s->lock.
+     */
+    QemuSeqLock seqlock;
 } Qcow2CachedTable;
 
 struct Qcow2Cache {
@@ -44,6 +61,21 @@ struct Qcow2Cache {
     void                   *table_array;
     uint64_t                lru_counter;
     uint64_t                cache_clean_lru_counter;
+
+    /*
+     * Open addressing hash table (linear probing, backward shift deletion)
+     * mapping the offset of each cached table to its index in entries[], or
+     * -1 for an empty slot. It has at least twice as many slots as there
+     * are entries, so a probe sequence always ends at an empty slot.
+     */
+    int                    *index;
+    unsigned                index_bits;
+
+    /*
+     * Unreferenced entries, least recently used first. Unused entries
+     * (offset == 0) are kept at the head so that they are recycled first.
+     */
+    QTAILQ_HEAD(, Qcow2CachedTable) lru;
 };
 
 static inline void *qcow2_cache_get_table_addr(Qcow2Cache *c, int table)
@@ -59,6 +91,106 @@ static inline int qcow2_cache_get_table_idx(Qcow2Cache *c, void *table)
     return idx;
 }
 
+static inline unsigned qcow2_cache_index_hash(Qcow2Cache *c, uint64_t offset)
+{
+    return ((offset / c->table_size) * 0x9e3779b97f4a7c15ULL) >>
+        (64 - c->index_bits);
+}
+
+static inline unsigned qcow2_cache_index_mask(Qcow2Cache *c)
+{
+    return (1U << c->index_bits) - 1;
+}
+
+static int qcow2_cache_index_lookup(Qcow2Cache *c, uint64_t offset)
+{
+    unsigned mask = qcow2_cache_index_mask(c);
+    unsigned slot = qcow2_cache_index_hash(c, offset);
+    int i;
+
+    while ((i = c->index[slot]) != -1) {
+        if (c->entries[i].offset == offset) {
+            return i;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+/*
+ * Slots are updated with atomic stores because qcow2_cache_read_entries()
+ * probes the index without s->lock. Such a reader may miss an entry that is
+ * being moved by the backward shift, which only costs it a fall back to the
+ * locked path.
+ */
+static void qcow2_cache_index_insert(Qcow2Cache *c, int i)
+{
+    unsigned mask = qcow2_cache_index_mask(c);
+    unsigned slot = qcow2_cache_index_hash(c, c->entries[i].offset);
+
+    assert(c->entries[i].offset != 0);
+
+    while (c->index[slot] != -1) {
+        assert(c->index[slot] != i);
+        slot = (slot + 1) & mask;
+    }
+    qatomic_set(&c->index[slot], i);
+}
+
+static void qcow2_cache_index_remove(Qcow2Cache *c, int i)
+{
+    unsigned mask = qcow2_cache_index_mask(c);
+    unsigned hole = qcow2_cache_index_hash(c, c->entries[i].offset);
+    unsigned slot;
+
+    while (c->index[hole] != i) {
+        assert(c->index[hole] != -1);
+        hole = (hole + 1) & mask;
+    }
+
+    /* Move back later entries of the cluster whose home is at or before hole */
+    slot = hole;
+    for (;;) {
+        unsigned home;
+        int j;
+
+        slot = (slot + 1) & mask;
+        j = c->index[slot];
+        if (j == -1) {
+            break;
+        }
+
+        home = qcow2_cache_index_hash(c, c->entries[j].offset);
+        if (hole <= slot ? (hole < home && home <= slot)
+                         : (hole < home || home <= slot)) {
+            continue;
+        }
+
+        qatomic_set(&c->index[hole], j);
+        hole = slot;
+    }
+    qatomic_set(&c->index[hole], -1);
+}
+
+/* Drop entry @i from the index and mark it unused, s->lock held */
+static void qcow2_cache_entry_evict(Qcow2Cache *c, int i)
+{
+    Qcow2CachedTable *t = &c->entries[i];
+
+    if (t->offset) {
+        qcow2_cache_index_remove(c, i);
+    }
+    t->offset = 0;
+    t->lru_counter = 0;
+    t->accessed = false;
+
+    /* Unused entries are recycled first */
+    if (t->ref == 0) {
+        QTAILQ_REMOVE(&c->lru, t, lru_entry);
+        QTAILQ_INSERT_HEAD(&c->lru, t, lru_entry);
+    }
+}
+
 static inline const char *qcow2_cache_get_name(BDRVQcow2State *s, Qcow2Cache *c)
 {
     if (c == s->refcount_block_cache) {
@@ -106,14 +238,19 @@ void qcow2_cache_clean_unused(Qcow2Cache *c)
 
         /* And count how many we can clean in a row */
         while (i < c->size && can_clean_entry(c, i)) {
-            c->entries[i].offset = 0;
-            c->entries[i].lru_counter = 0;
+            seqlock_write_begin(&c->entries[i].seqlock);
+            qcow2_cache_entry_evict(c, i);
             i++;
             to_clean++;
         }
 
         if (to_clean > 0) {
+            int j;
+
             qcow2_cache_table_release(c, i - to_clean, to_clean);
+            for (j = i - to_clean; j < i; j++) {
+                seqlock_write_end(&c->entries[j].seqlock);
+            }
         }
     }
 
@@ -125,6 +262,7 @@ Qcow2Cache *qcow2_cache_create(BlockDriverState *bs, int num_tables,
 {
     BDRVQcow2State *s = bs->opaque;
     Qcow2Cache *c;
+    size_t index_size;
 
     assert(num_tables > 0);
     assert(is_power_of_2(table_size));
@@ -137,12 +275,23 @@ Qcow2Cache *qcow2_cache_create(BlockDriverState *bs, int num_tables,
     c->entries = g_try_new0(Qcow2CachedTable, num_tables);
     c->table_array = qemu_try_blockalign(bs->file->bs,
                                          (size_t) num_tables * c->table_size);
+    index_size = pow2ceil((uint64_t) num_tables * 2);
+    c->index_bits = ctz64(index_size);
+    c->index = g_try_new(int, index_size);
 
-    if (!c->entries || !c->table_array) {
+    if (!c->entries || !c->table_array || !c->index) {
         qemu_vfree(c->table_array);
         g_free(c->entries);
+        g_free(c->index);
         g_free(c);
-        c = NULL;
+        return NULL;
+    }
+
+    memset(c->index, -1, index_size * sizeof(int));
+    QTAILQ_INIT(&c->lru);
+    for (int i = 0; i < num_tables; i++) {
+        seqlock_init(&c->entries[i].seqlock);
+        QTAILQ_INSERT_TAIL(&c->lru, &c->entries[i], lru_entry);
     }
 
     return c;
@@ -158,6 +307,7 @@ int qcow2_cache_destroy(Qcow2Cache *c)
 
     qemu_vfree(c->table_array);
     g_free(c->entries);
+    g_free(c->index);
     g_free(c);
 
     return 0;
@@ -237,7 +387,72 @@ qcow2_cache_entry_flush(BlockDriverState *bs, Qcow2Cache *c, int i)
     return 0;
 }
 
-int qcow2_cache_write(BlockDriverState *bs, Qcow2Cache *c)
+typedef struct Qcow2CacheFlushTask {
+    AioTask task;
+    BlockDriverState *bs;
+    Qcow2Cache *c;
+    int i;
+} Qcow2CacheFlushTask;
+
+static int coroutine_fn GRAPH_RDLOCK
+qcow2_cache_flush_task_entry(AioTask *task)
+{
+    Qcow2CacheFlushTask *t = container_of(task, Qcow2CacheFlushTask, task);
+
+    return qcow2_cache_entry_flush(t->bs, t->c, t->i);
+}
+
+/*
+ * Write back all dirty entries with up to QCOW2_MAX_WORKERS writes in flight.
+ * Entries are only written once the dependency of the cache has been
+ * satisfied, which the first dirty entry takes care of; all others are
+ * independent of each other.  The caller holds s->lock, so the tables
+ * cannot change while the writes are in flight.
+ */
+static int coroutine_fn GRAPH_RDLOCK
+qcow2_cache_co_write_parallel(BlockDriverState *bs, Qcow2Cache *c)
+{
+    AioTaskPool *pool = aio_task_pool_new(QCOW2_MAX_WORKERS);
+    int result = 0;
+    int ret;
+    int i;
+
+    for (i = 0; i < c->size; i++) {
+        Qcow2CacheFlushTask *t;
+
+        if (!c->entries[i].dirty || !c->entries[i].offset) {
+            continue;
+        }
+
+        if (c->depends || c->depends_on_flush) {
+            ret = qcow2_cache_entry_flush(bs, c, i);
+            if (ret < 0 && result != -ENOSPC) {
+                result = ret;
+            }
+            continue;
+        }
+
+        t = g_new(Qcow2CacheFlushTask, 1);
+        *t = (Qcow2CacheFlushTask) {
+            .task.func = qcow2_cache_flush_task_entry,
+            .bs = bs,
+            .c = c,
+            .i = i,
+        };
+        aio_task_pool_start_task(pool, &t->task);
+    }
+
+    aio_task_pool_wait_all(pool);
+    ret = aio_task_pool_status(pool);
+    if (ret < 0 && result != -ENOSPC) {
+        result = ret;
+    }
+    aio_task_pool_free(pool);
+
+    return result;
+}
+
+int coroutine_mixed_fn qcow2_cache_write(BlockDriverState *bs, Qcow2Cache *c)
 {
     BDRVQcow2State *s = bs->opaque;
     int result = 0;
@@ -246,6 +461,10 @@ int qcow2_cache_write(BlockDriverState *bs, Qcow2Cache *c)
 
     trace_qcow2_cache_flush(qemu_coroutine_self(), c == s->l2_table_cache);
 
+    if (qemu_in_coroutine()) {
+        return qcow2_cache_co_write_parallel(bs, c);
+    }
+
     for (i = 0; i < c->size; i++) {
         ret = qcow2_cache_entry_flush(bs, c, i);
         if (ret < 0 && result != -ENOSPC) {
@@ -309,12 +528,16 @@ int qcow2_cache_empty(BlockDriverState *bs, Qcow2Cache *c)
 
     for (i = 0; i < c->size; i++) {
         assert(c->entries[i].ref == 0);
-        c->entries[i].offset = 0;
-        c->entries[i].lru_counter = 0;
+        seqlock_write_begin(&c->entries[i].seqlock);
+        qcow2_cache_entry_evict(c, i);
     }
 
     qcow2_cache_table_release(c, 0, c->size);
 
+    for (i = 0; i < c->size; i++) {
+        seqlock_write_end(&c->entries[i].seqlock);
+    }
+
     c->lru_counter = 0;
 
     return 0;
@@ -325,11 +548,9 @@ qcow2_cache_do_get(BlockDriverState *bs, Qcow2Cache *c, uint64_t offset,
                    void **table, bool read_from_disk)
 {
     BDRVQcow2State *s = bs->opaque;
-    int i;
+    Qcow2CachedTable *t;
+    int i, n;
     int ret;
-    int lookup_index;
-    uint64_t min_lru_counter = UINT64_MAX;
-    int min_lru_index = -1;
 
     assert(offset != 0);
 
@@ -344,29 +565,28 @@ qcow2_cache_do_get(BlockDriverState *bs, Qcow2Cache *c, uint64_t offset,
     }
 
     /* Check if the table is already cached */
-    i = lookup_index = (offset / c->table_size * 4) % c->size;
-    do {
-        const Qcow2CachedTable *t = &c->entries[i];
-        if (t->offset == offset) {
-            goto found;
-        }
-        if (t->ref == 0 && t->lru_counter < min_lru_counter) {
-            min_lru_counter = t->lru_counter;
-            min_lru_index = i;
-        }
-        if (++i == c->size) {
-            i = 0;
-        }
-    } while (i != lookup_index);
+    i = qcow2_cache_index_lookup(c, offset);
+    if (i >= 0) {
+        goto found;
+    }
 
-    if (min_lru_index == -1) {
+    t = QTAILQ_FIRST(&c->lru);
+    if (!t) {
         /* This can't happen in current synchronous code, but leave the check
          * here as a reminder for whoever starts using AIO with the cache */
         abort();
     }
 
+    /* Tables hit by lockless lookups since they were put get a second chance */
+    for (n = 0; qatomic_read(&t->accessed) && n < c->size; n++) {
+        qatomic_set(&t->accessed, false);
+        QTAILQ_REMOVE(&c->lru, t, lru_entry);
+        QTAILQ_INSERT_TAIL(&c->lru, t, lru_entry);
+        t = QTAILQ_FIRST(&c->lru);
+    }
+
     /* Cache miss: write a table back and replace it */
-    i = min_lru_index;
+    i = t - c->entries;
     trace_qcow2_cache_get_replace_entry(qemu_coroutine_self(),
                                         c == s->l2_table_cache, i);
 
@@ -377,7 +597,14 @@ qcow2_cache_do_get(BlockDriverState *bs, Qcow2Cache *c, uint64_t offset,
 
     trace_qcow2_cache_get_read(qemu_coroutine_self(),
                                c == s->l2_table_cache, i);
-    c->entries[i].offset = 0;
+
+    /*
+     * Lockless readers must not see the old contents under the new offset or
+     * a partially read table, so keep the write section open across the read.
+     * This is fine because s->lock serializes all writers.
+     */
+    seqlock_write_begin(&c->entries[i].seqlock);
+    qcow2_cache_entry_evict(c, i);
     if (read_from_disk) {
         if (c == s->l2_table_cache) {
             BLKDBG_EVENT(bs->file, BLKDBG_L2_LOAD);
@@ -386,15 +613,20 @@ qcow2_cache_do_get(BlockDriverState *bs, Qcow2Cache *c, uint64_t offset,
         ret = bdrv_pread(bs->file, offset, c->table_size,
                          qcow2_cache_get_table_addr(c, i), 0);
         if (ret < 0) {
+            seqlock_write_end(&c->entries[i].seqlock);
             return ret;
         }
     }
 
     c->entries[i].offset = offset;
+    qcow2_cache_index_insert(c, i);
+    seqlock_write_end(&c->entries[i].seqlock);
 
     /* And return the right table */
 found:
-    c->entries[i].ref++;
+    if (c->entries[i].ref++ == 0) {
+        QTAILQ_REMOVE(&c->lru, &c->entries[i], lru_entry);
+    }
     *table = qcow2_cache_get_table_addr(c, i);
 
     trace_qcow2_cache_get_done(qemu_coroutine_self(),
@@ -424,6 +656,8 @@ void qcow2_cache_put(Qcow2Cache *c, void **table)
 
     if (c->entries[i].ref == 0) {
         c->entries[i].lru_counter = ++c->lru_counter;
+        qatomic_set(&c->entries[i].accessed, false);
+        QTAILQ_INSERT_TAIL(&c->lru, &c->entries[i], lru_entry);
     }
 
     assert(c->entries[i].ref >= 0);
@@ -438,14 +672,9 @@ void qcow2_cache_entry_mark_dirty(Qcow2Cache *c, void *table)
 
 void *qcow2_cache_is_table_offset(Qcow2Cache *c, uint64_t offset)
 {
-    int i;
+    int i = qcow2_cache_index_lookup(c, offset);
 
-    for (i = 0; i < c->size; i++) {
-        if (c->entries[i].offset == offset) {
-            return qcow2_cache_get_table_addr(c, i);
-        }
-    }
-    return NULL;
+    return i >= 0 ? qcow2_cache_get_table_addr(c, i) : NULL;
 }
 
 void qcow2_cache_discard(Qcow2Cache *c, void *table)
@@ -454,9 +683,71 @@ void qcow2_cache_discard(Qcow2Cache *c, void *table)
 
     assert(c->entries[i].ref == 0);
 
-    c->entries[i].offset = 0;
-    c->entries[i].lru_counter = 0;
+    seqlock_write_begin(&c->entries[i].seqlock);
+    qcow2_cache_entry_evict(c, i);
     c->entries[i].dirty = false;
 
     qcow2_cache_table_release(c, i, 1);
+    seqlock_write_end(&c->entries[i].seqlock);
+}
+
+/*
+ * Copy the 64-bit words [@first, @first + @n) of the table at image file
+ * offset @offset into @buf without taking s->lock. The words are copied in
+ * their on-disk (big endian) representation.
+ *
+ * Returns false if the table is not cached or is being replaced at the same
+ * time; the caller must then take s->lock and use qcow2_cache_get().
+ *
+ * Words that writers modify in place while holding a reference to the table
+ * are read atomically, so each of them is either the old or the new value.
+ * The table memory itself stays valid because the cache is only destroyed
+ * while the node is drained.
+ */
+bool qcow2_cache_read_entries(Qcow2Cache *c, uint64_t offset, unsigned first,
+                              unsigned n, uint64_t *buf)
+{
+#ifdef CONFIG_ATOMIC64
+    unsigned mask = qcow2_cache_index_mask(c);
+    unsigned slot = qcow2_cache_index_hash(c, offset);
+    unsigned probes;
+    int i;
+
+    assert(first + n <= c->table_size / sizeof(uint64_t));
+
+    for (probes = 0; probes <= mask; probes++) {
+        Qcow2CachedTable *t;
+
+        i = qatomic_read(&c->index[slot]);
+        if (i == -1) {
+            break;
+        }
+
+        t = &c->entries[i];
+        if (qatomic_read__nocheck(&t->offset) == offset) {
+            const uint64_t *table = qcow2_cache_get_table_addr(c, i);
+            unsigned seq = seqlock_read_begin(&t->seqlock);
+            unsigned j;
+
+            if (qatomic_read__nocheck(&t->offset) != offset) {
+                return false;
+            }
+            for (j = 0; j < n; j++) {
+                buf[j] = qatomic_read__nocheck(&table[first + j]);
+            }
+            if (seqlock_read_retry(&t->seqlock, seq)) {
+                return false;
+            }
+
+            /* Keep the table from looking idle to eviction and cleaning */
+            qatomic_set(&t->accessed, true);
+            qatomic_set__nocheck(&t->lru_counter,
+                                 qatomic_read__nocheck(&c->lru_counter));
+            return true;
+        }
+        slot = (slot + 1) & mask;
+    }
+#endif
+
+    return false;
 }
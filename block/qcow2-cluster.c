@@ -30,6 +30,7 @@
 #include "qcow2.h"
 #include "qemu/bswap.h"
 #include "qemu/memalign.h"
+#include "qemu/rcu.h"
 #include "trace.h"
 
 int coroutine_fn qcow2_shrink_l1_table(BlockDriverState *bs,
@@ -83,6 +84,37 @@ fail:
     return ret;
 }
 
+typedef struct Qcow2OldL1Table {
+    struct rcu_head rcu;
+    uint64_t *table;
+} Qcow2OldL1Table;
+
+static void qcow2_old_l1_table_free(Qcow2OldL1Table *old)
+{
+    qemu_vfree(old->table);
+    g_free(old);
+}
+
+/*
+ * Switch to a new in-memory L1 table and free the old one once lockless
+ * readers (see qcow2_get_host_offset_lockless()) are done with it.
+ *
+ * The table is published before the size so that a reader that sees the new
+ * size also sees the new table.
+ */
+void qcow2_replace_l1_table(BDRVQcow2State *s, uint64_t *l1_table,
+                            int l1_size)
+{
+    Qcow2OldL1Table *old = g_new(Qcow2OldL1Table, 1);
+
+    old->table = s->l1_table;
+    qatomic_rcu_set(&s->l1_table, l1_table);
+    smp_wmb();
+    qatomic_set(&s->l1_size, l1_size);
+
+    call_rcu(old, qcow2_old_l1_table_free, rcu);
+}
+
 int qcow2_grow_l1_table(BlockDriverState *bs, uint64_t min_size,
                         bool exact_size)
 {
@@ -177,12 +209,10 @@ int qcow2_grow_l1_table(BlockDriverState *bs, uint64_t min_size,
     if (ret < 0) {
         goto fail;
     }
-    qemu_vfree(s->l1_table);
     old_l1_table_offset = s->l1_table_offset;
     s->l1_table_offset = new_l1_table_offset;
-    s->l1_table = new_l1_table;
     old_l1_size = s->l1_size;
-    s->l1_size = new_l1_size;
+    qcow2_replace_l1_table(s, new_l1_table, new_l1_size);
     qcow2_free_clusters(bs, old_l1_table_offset, old_l1_size * L1E_SIZE,
                         QCOW2_DISCARD_OTHER);
     return 0;
@@ -742,6 +772,126 @@ fail:
     return ret;
 }
 
+/*
+ * Like qcow2_get_host_offset(), but may be called without s->lock. It only
+ * succeeds if the L2 slice is already cached and the lookup needs neither
+ * I/O nor error reporting; otherwise it returns -EAGAIN and the caller must
+ * retry with qcow2_get_host_offset() under s->lock.
+ *
+ * At most QCOW2_LOCKLESS_L2_ENTRIES clusters are looked up at once. Images
+ * with subclusters are not supported because their 128-bit L2 entries
+ * cannot be read atomically.
+ */
+int qcow2_get_host_offset_lockless(BlockDriverState *bs, uint64_t offset,
+                                   unsigned int *bytes, uint64_t *host_offset,
+                                   QCow2SubclusterType *subcluster_type)
+{
+    BDRVQcow2State *s = bs->opaque;
+    uint64_t l2_slice[QCOW2_LOCKLESS_L2_ENTRIES];
+    unsigned int l2_index = 0, l2_slice_index;
+    uint64_t l1_index, l2_offset, l2_entry, *l1_table;
+    int l1_size, sc, start_of_slice;
+    unsigned int offset_in_cluster;
+    uint64_t bytes_available, bytes_needed, nb_clusters;
+    QCow2SubclusterType type;
+
+    if (has_subclusters(s)) {
+        return -EAGAIN;
+    }
+
+    offset_in_cluster = offset_into_cluster(s, offset);
+    bytes_needed = (uint64_t) *bytes + offset_in_cluster;
+
+    l2_slice_index = offset_to_l2_slice_index(s, offset);
+    bytes_available =
+        ((uint64_t) MIN(s->l2_slice_size - l2_slice_index,
+                        QCOW2_LOCKLESS_L2_ENTRIES)) << s->cluster_bits;
+
+    if (bytes_needed > bytes_available) {
+        bytes_needed = bytes_available;
+    }
+
+    *host_offset = 0;
+
+    RCU_READ_LOCK_GUARD();
+
+    /* Paired with smp_wmb() in qcow2_replace_l1_table() */
+    l1_size = qatomic_read(&s->l1_size);
+    smp_rmb();
+    l1_table = qatomic_rcu_read(&s->l1_table);
+
+    l1_index = offset_to_l1_index(s, offset);
+    if (l1_index >= l1_size) {
+        type = QCOW2_SUBCLUSTER_UNALLOCATED_PLAIN;
+        goto out;
+    }
+
+    l2_offset = qatomic_read__nocheck(&l1_table[l1_index]) & L1E_OFFSET_MASK;
+    if (!l2_offset) {
+        type = QCOW2_SUBCLUSTER_UNALLOCATED_PLAIN;
+        goto out;
+    }
+    if (offset_into_cluster(s, l2_offset)) {
+        return -EAGAIN;
+    }
+
+    nb_clusters = size_to_clusters(s, bytes_needed);
+    assert(nb_clusters <= QCOW2_LOCKLESS_L2_ENTRIES);
+
+    start_of_slice = l2_entry_size(s) *
+        (offset_to_l2_index(s, offset) - l2_slice_index);
+    if (!qcow2_cache_read_entries(s->l2_table_cache,
+                                  l2_offset + start_of_slice,
+                                  l2_slice_index, nb_clusters, l2_slice)) {
+        return -EAGAIN;
+    }
+
+    l2_entry = get_l2_entry(s, l2_slice, 0);
+    type = qcow2_get_subcluster_type(bs, l2_entry, 0, 0);
+    if (s->qcow_version < 3 && (type == QCOW2_SUBCLUSTER_ZERO_PLAIN ||
+                                type == QCOW2_SUBCLUSTER_ZERO_ALLOC)) {
+        return -EAGAIN;
+    }
+    switch (type) {
+    case QCOW2_SUBCLUSTER_ZERO_PLAIN:
+    case QCOW2_SUBCLUSTER_UNALLOCATED_PLAIN:
+        break;
+    case QCOW2_SUBCLUSTER_ZERO_ALLOC:
+    case QCOW2_SUBCLUSTER_NORMAL:
+    case QCOW2_SUBCLUSTER_UNALLOCATED_ALLOC: {
+        uint64_t host_cluster_offset = l2_entry & L2E_OFFSET_MASK;
+        *host_offset = host_cluster_offset + offset_in_cluster;
+        if (offset_into_cluster(s, host_cluster_offset) ||
+            (has_data_file(bs) && *host_offset != offset)) {
+            return -EAGAIN;
+        }
+        break;
+    }
+    default:
+        /* Compressed and invalid entries take the slow path */
+        return -EAGAIN;
+    }
+
+    sc = count_contiguous_subclusters(bs, nb_clusters, 0, l2_slice, &l2_index);
+    if (sc < 0) {
+        return -EAGAIN;
+    }
+
+    bytes_available = (int64_t)sc << s->subcluster_bits;
+
+out:
+    if (bytes_available > bytes_needed) {
+        bytes_available = bytes_needed;
+    }
+
+    assert(bytes_available - offset_in_cluster <= UINT_MAX);
+    *bytes = bytes_available - offset_in_cluster;
+
+    *subcluster_type = type;
+
+    return 0;
+}
+
 /*
  * get_cluster_table
  *
@@ -2233,6 +2383,113 @@ fail:
     return ret;
 }
 
+/*
+ * Makes the cluster at guest offset @dst_offset refer to the host cluster of
+ * @src_offset.  The host cluster then has more than one reference, so a write
+ * to either guest cluster copies it first, as for internal snapshots.
+ *
+ * Returns -ENOTSUP if @src_offset is not a fully allocated data cluster.
+ */
+static int coroutine_fn GRAPH_RDLOCK
+share_cluster(BlockDriverState *bs, uint64_t src_offset, uint64_t dst_offset)
+{
+    BDRVQcow2State *s = bs->opaque;
+    uint64_t *l2_slice;
+    uint64_t l2_entry, old_l2_entry, host_offset;
+    uint64_t refcount;
+    int l2_index;
+    int ret;
+
+    ret = get_cluster_table(bs, src_offset, &l2_slice, &l2_index);
+    if (ret < 0) {
+        return ret;
+    }
+
+    l2_entry = get_l2_entry(s, l2_slice, l2_index);
+    if (qcow2_get_cluster_type(bs, l2_entry) != QCOW2_CLUSTER_NORMAL ||
+        (has_subclusters(s) &&
+         get_l2_bitmap(s, l2_slice, l2_index) != QCOW_L2_BITMAP_ALL_ALLOC)) {
+        ret = -ENOTSUP;
+        goto out;
+    }
+    host_offset = l2_entry & L2E_OFFSET_MASK;
+
+    ret = qcow2_get_refcount(bs, host_offset >> s->cluster_bits, &refcount);
+    if (ret < 0) {
+        goto out;
+    }
+    if (refcount >= s->refcount_max) {
+        ret = -ENOTSUP;
+        goto out;
+    }
+
+    ret = qcow2_update_cluster_refcount(bs, host_offset >> s->cluster_bits,
+                                        1, false, QCOW2_DISCARD_NEVER);
+    if (ret < 0) {
+        goto out;
+    }
+
+    /* A crash may leak the new reference, but must not lose it */
+    if (s->use_lazy_refcounts) {
+        qcow2_mark_dirty(bs);
+    }
+    if (qcow2_need_accurate_refcounts(s)) {
+        qcow2_cache_set_dependency(bs, s->l2_table_cache,
+                                   s->refcount_block_cache);
+    }
+
+    if (l2_entry & QCOW_OFLAG_COPIED) {
+        qcow2_cache_entry_mark_dirty(s->l2_table_cache, l2_slice);
+        set_l2_entry(s, l2_slice, l2_index, l2_entry & ~QCOW_OFLAG_COPIED);
+    }
+    qcow2_cache_put(s->l2_table_cache, (void **) &l2_slice);
+
+    ret = get_cluster_table(bs, dst_offset, &l2_slice, &l2_index);
+    if (ret < 0) {
+        return ret;
+    }
+
+    old_l2_entry = get_l2_entry(s, l2_slice, l2_index);
+    qcow2_cache_entry_mark_dirty(s->l2_table_cache, l2_slice);
+    set_l2_entry(s, l2_slice, l2_index, host_offset);
+    if (has_subclusters(s)) {
+        set_l2_bitmap(s, l2_slice, l2_index, QCOW_L2_BITMAP_ALL_ALLOC);
+    }
+    qcow2_cache_put(s->l2_table_cache, (void **) &l2_slice);
+
+    qcow2_free_any_cluster(bs, old_l2_entry, QCOW2_DISCARD_OTHER);
+    return 0;
+
+out:
+    qcow2_cache_put(s->l2_table_cache, (void **) &l2_slice);
+    return ret;
+}
+
+/*
+ * Makes the clusters of [@dst_offset, @dst_offset + @bytes) share the host
+ * clusters of [@src_offset, @src_offset + @bytes).  All must be aligned to
+ * the cluster size.
+ */
+int coroutine_fn qcow2_cluster_share(BlockDriverState *bs, uint64_t src_offset,
+                                     uint64_t dst_offset, uint64_t bytes)
+{
+    BDRVQcow2State *s = bs->opaque;
+    uint64_t done;
+    int ret;
+
+    assert(!has_data_file(bs));
+    assert(QEMU_IS_ALIGNED(src_offset | dst_offset | bytes, s->cluster_size));
+
+    for (done = 0; done < bytes; done += s->cluster_size) {
+        ret = share_cluster(bs, src_offset + done, dst_offset + done);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+
+    return 0;
+}
+
 /*
  * Expands all zero clusters in a specific L1 table (or deallocates them, for
  * non-backed non-pre-allocated zero clusters).
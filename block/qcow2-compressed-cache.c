@@ -0,0 +1,160 @@
+/*
+ * Cache of decompressed clusters for the QCOW2 format
+ *
+ * Guests usually read compressed images in requests much smaller than a
+ * cluster, and without a cache every such request reads and decompresses
+ * the whole cluster again.  This cache keeps the most recently decompressed
+ * clusters around, keyed by their host offset.
+ *
+ * Entries are never invalidated, so the cache may only be used while the
+ * image is opened read-only: compressed clusters are not rewritten in place,
+ * but their host space could be freed and reused by a writer.
+ *
+ * The cache may be accessed from multiple threads with multiqueue, so it is
+ * protected by a mutex.  Lookups copy the data out while holding it, which
+ * is fine for a cluster-sized memcpy.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/iov.h"
+#include "qemu/memalign.h"
+#include "qemu/queue.h"
+#include "qemu/thread.h"
+#include "qcow2.h"
+#include "trace.h"
+
+typedef struct Qcow2CompressedCacheEntry {
+    uint64_t offset;
+    void *data;
+    QTAILQ_ENTRY(Qcow2CompressedCacheEntry) next;
+} Qcow2CompressedCacheEntry;
+
+struct Qcow2CompressedCache {
+    QemuMutex lock;
+    size_t cluster_size;
+    int max_entries;
+    int nb_entries;
+
+    /* Maps host offsets to entries */
+    GHashTable *table;
+
+    /* Least recently used entry first */
+    QTAILQ_HEAD(, Qcow2CompressedCacheEntry) lru;
+
+    uint64_t hits;
+    uint64_t misses;
+};
+
+Qcow2CompressedCache *qcow2_compressed_cache_create(int max_entries,
+                                                   size_t cluster_size)
+{
+    Qcow2CompressedCache *c;
+
+    assert(max_entries > 0);
+
+    c = g_new0(Qcow2CompressedCache, 1);
+    qemu_mutex_init(&c->lock);
+    c->cluster_size = cluster_size;
+    c->max_entries = max_entries;
+    c->table = g_hash_table_new(g_int64_hash, g_int64_equal);
+    QTAILQ_INIT(&c->lru);
+
+    return c;
+}
+
+void qcow2_compressed_cache_destroy(Qcow2CompressedCache *c)
+{
+    Qcow2CompressedCacheEntry *e, *next;
+
+    if (!c) {
+        return;
+    }
+
+    QTAILQ_FOREACH_SAFE(e, &c->lru, next, next) {
+        qemu_vfree(e->data);
+        g_free(e);
+    }
+    g_hash_table_destroy(c->table);
+    qemu_mutex_destroy(&c->lock);
+    g_free(c);
+}
+
+/*
+ * Copy @bytes at @offset_in_cluster of the decompressed cluster stored at
+ * host offset @coffset into @qiov.  Returns false if the cluster is not
+ * cached.
+ */
+bool qcow2_compressed_cache_read(Qcow2CompressedCache *c, uint64_t coffset,
+                                 size_t offset_in_cluster, size_t bytes,
+                                 QEMUIOVector *qiov, size_t qiov_offset)
+{
+    Qcow2CompressedCacheEntry *e;
+
+    assert(offset_in_cluster + bytes <= c->cluster_size);
+
+    QEMU_LOCK_GUARD(&c->lock);
+
+    e = g_hash_table_lookup(c->table, &coffset);
+    if (!e) {
+        c->misses++;
+        return false;
+    }
+
+    c->hits++;
+    QTAILQ_REMOVE(&c->lru, e, next);
+    QTAILQ_INSERT_TAIL(&c->lru, e, next);
+
+    qemu_iovec_from_buf(qiov, qiov_offset, e->data + offset_in_cluster,
+                        bytes);
+    return true;
+}
+
+/*
+ * Add the decompressed cluster @data stored at host offset @coffset,
+ * evicting the least recently used one if the cache is full.
+ */
+void qcow2_compressed_cache_insert(Qcow2CompressedCache *c, uint64_t coffset,
+                                   const void *data)
+{
+    Qcow2CompressedCacheEntry *e;
+
+    QEMU_LOCK_GUARD(&c->lock);
+
+    /* Another request may have decompressed the same cluster meanwhile */
+    if (g_hash_table_contains(c->table, &coffset)) {
+        return;
+    }
+
+    if (c->nb_entries < c->max_entries) {
+        e = g_new0(Qcow2CompressedCacheEntry, 1);
+        e->data = qemu_try_memalign(qemu_real_host_page_size(),
+                                    c->cluster_size);
+        if (!e->data) {
+            g_free(e);
+            return;
+        }
+        c->nb_entries++;
+    } else {
+        e = QTAILQ_FIRST(&c->lru);
+        QTAILQ_REMOVE(&c->lru, e, next);
+        g_hash_table_remove(c->table, &e->offset);
+    }
+
+    e->offset = coffset;
+    memcpy(e->data, data, c->cluster_size);
+    g_hash_table_insert(c->table, &e->offset, e);
+    QTAILQ_INSERT_TAIL(&c->lru, e, next);
+
+    trace_qcow2_compressed_cache_insert(c, coffset);
+}
+
+void qcow2_compressed_cache_get_stats(Qcow2CompressedCache *c,
+                                      uint64_t *hits, uint64_t *misses)
+{
+    QEMU_LOCK_GUARD(&c->lock);
+
+    *hits = c->hits;
+    *misses = c->misses;
+}
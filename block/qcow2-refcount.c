@@ -964,13 +964,65 @@ int qcow2_update_cluster_refcount(BlockDriverState *bs,
 
 
 
+/*
+ * Returns the number of clusters with a refcount of 0 at the start of the
+ * range of @nb_clusters clusters beginning at @cluster_index, or -errno.
+ * The range must not cross a refcount block boundary, so that all of it is
+ * checked with a single refcount block cache lookup.
+ */
+static int64_t GRAPH_RDLOCK
+count_free_clusters(BlockDriverState *bs, uint64_t cluster_index,
+                    uint64_t nb_clusters)
+{
+    BDRVQcow2State *s = bs->opaque;
+    uint64_t refcount_table_index, block_index, i;
+    int64_t refcount_block_offset;
+    void *refcount_block;
+    int ret;
+
+    refcount_table_index = cluster_index >> s->refcount_block_bits;
+    block_index = cluster_index & (s->refcount_block_size - 1);
+    assert(block_index + nb_clusters <= s->refcount_block_size);
+
+    if (refcount_table_index >= s->refcount_table_size) {
+        return nb_clusters;
+    }
+    refcount_block_offset =
+        s->refcount_table[refcount_table_index] & REFT_OFFSET_MASK;
+    if (!refcount_block_offset) {
+        return nb_clusters;
+    }
+
+    if (offset_into_cluster(s, refcount_block_offset)) {
+        qcow2_signal_corruption(bs, true, -1, -1, "Refblock offset %#" PRIx64
+                                " unaligned (reftable index: %#" PRIx64 ")",
+                                refcount_block_offset, refcount_table_index);
+        return -EIO;
+    }
+
+    ret = qcow2_cache_get(bs, s->refcount_block_cache, refcount_block_offset,
+                          &refcount_block);
+    if (ret < 0) {
+        return ret;
+    }
+
+    for (i = 0; i < nb_clusters; i++) {
+        if (s->get_refcount(refcount_block, block_index + i) != 0) {
+            break;
+        }
+    }
+
+    qcow2_cache_put(s->refcount_block_cache, &refcount_block);
+
+    return i;
+}
+
 /* return < 0 if error */
 static int64_t GRAPH_RDLOCK
 alloc_clusters_noref(BlockDriverState *bs, uint64_t size, uint64_t max)
 {
     BDRVQcow2State *s = bs->opaque;
-    uint64_t i, nb_clusters, refcount;
-    int ret;
+    uint64_t i, nb_clusters;
 
     /* We can't allocate clusters if they may still be queued for discard. */
     if (s->cache_discards) {
@@ -979,13 +1031,23 @@ alloc_clusters_noref(BlockDriverState *bs, uint64_t size, uint64_t max)
 
     nb_clusters = size_to_clusters(s, size);
 retry:
-    for(i = 0; i < nb_clusters; i++) {
-        uint64_t next_cluster_index = s->free_cluster_index++;
-        ret = qcow2_get_refcount(bs, next_cluster_index, &refcount);
-
-        if (ret < 0) {
-            return ret;
-        } else if (refcount != 0) {
+    for (i = 0; i < nb_clusters;) {
+        /* Check as many clusters as possible per refcount block */
+        uint64_t block_index =
+            s->free_cluster_index & (s->refcount_block_size - 1);
+        uint64_t n = MIN(nb_clusters - i,
+                         s->refcount_block_size - block_index);
+        int64_t nb_free = count_free_clusters(bs, s->free_cluster_index, n);
+
+        if (nb_free < 0) {
+            return nb_free;
+        }
+
+        s->free_cluster_index += nb_free;
+        i += nb_free;
+        if (nb_free < n) {
+            /* Skip the cluster in use and start over behind it */
+            s->free_cluster_index++;
             goto retry;
         }
     }
@@ -2304,6 +2366,16 @@ calculate_refcounts(BlockDriverState *bs, BdrvCheckResult *res,
         }
     }
 
+    /* compression dictionary */
+    if (s->compression_dict_size) {
+        ret = qcow2_inc_refcounts_imrt(bs, res, refcount_table, nb_clusters,
+                                       s->compression_dict_offset,
+                                       s->compression_dict_size);
+        if (ret < 0) {
+            return ret;
+        }
+    }
+
     /* bitmaps */
     ret = qcow2_check_bitmaps_refcounts(bs, res, refcount_table, nb_clusters);
     if (ret < 0) {
@@ -36,6 +36,9 @@
 #include "qcow2.h"
 #include "block/block-io.h"
 #include "block/thread-pool.h"
+#include "qapi/error.h"
+#include "qemu/notify.h"
+#include "qemu/thread.h"
 #include "crypto.h"
 
 static int coroutine_fn
@@ -45,7 +48,7 @@ qcow2_co_process(BlockDriverState *bs, ThreadPoolFunc *func, void *arg)
     BDRVQcow2State *s = bs->opaque;
 
     qemu_co_mutex_lock(&s->lock);
-    while (s->nb_threads >= QCOW2_MAX_THREADS) {
+    while (s->nb_threads >= s->max_threads) {
         qemu_co_queue_wait(&s->thread_task_queue, &s->lock);
     }
     s->nb_threads++;
@@ -66,13 +69,19 @@ qcow2_co_process(BlockDriverState *bs, ThreadPoolFunc *func, void *arg)
  * Compression
  */
 
+/*
+ * @dict is the image's digested compression dictionary for the method, or
+ * NULL if there is none
+ */
 typedef ssize_t (*Qcow2CompressFunc)(void *dest, size_t dest_size,
-                                     const void *src, size_t src_size);
+                                     const void *src, size_t src_size,
+                                     const void *dict);
 typedef struct Qcow2CompressData {
     void *dest;
     size_t dest_size;
     const void *src;
     size_t src_size;
+    const void *dict;
     ssize_t ret;
 
     Qcow2CompressFunc func;
@@ -91,7 +100,8 @@ typedef struct Qcow2CompressData {
  *          -EIO    on any other error
  */
 static ssize_t qcow2_zlib_compress(void *dest, size_t dest_size,
-                                   const void *src, size_t src_size)
+                                   const void *src, size_t src_size,
+                                   const void *dict)
 {
     ssize_t ret;
     z_stream strm;
@@ -138,7 +148,8 @@ static ssize_t qcow2_zlib_compress(void *dest, size_t dest_size,
  *          -EIO on fail
  */
 static ssize_t qcow2_zlib_decompress(void *dest, size_t dest_size,
-                                     const void *src, size_t src_size)
+                                     const void *src, size_t src_size,
+                                     const void *dict)
 {
     int ret;
     z_stream strm;
@@ -173,6 +184,66 @@ static ssize_t qcow2_zlib_decompress(void *dest, size_t dest_size,
 
 #ifdef CONFIG_ZSTD
 
+/*
+ * Compression contexts are expensive to set up relative to compressing a
+ * single cluster, so each worker thread keeps its own for reuse.
+ */
+static __thread ZSTD_CCtx *qcow2_zstd_cctx;
+static __thread ZSTD_DCtx *qcow2_zstd_dctx;
+static __thread Notifier qcow2_zstd_exit_notifier;
+
+static void qcow2_zstd_thread_exit(Notifier *n, void *value)
+{
+    ZSTD_freeCCtx(qcow2_zstd_cctx);
+    qcow2_zstd_cctx = NULL;
+    ZSTD_freeDCtx(qcow2_zstd_dctx);
+    qcow2_zstd_dctx = NULL;
+}
+
+static void qcow2_zstd_thread_init(void)
+{
+    if (!qcow2_zstd_exit_notifier.notify) {
+        qcow2_zstd_exit_notifier.notify = qcow2_zstd_thread_exit;
+        qemu_thread_atexit_add(&qcow2_zstd_exit_notifier);
+    }
+}
+
+static ZSTD_CCtx *qcow2_zstd_get_cctx(const ZSTD_CDict *cdict)
+{
+    if (!qcow2_zstd_cctx) {
+        qcow2_zstd_thread_init();
+        qcow2_zstd_cctx = ZSTD_createCCtx();
+        if (!qcow2_zstd_cctx) {
+            return NULL;
+        }
+    } else {
+        ZSTD_CCtx_reset(qcow2_zstd_cctx, ZSTD_reset_session_and_parameters);
+    }
+
+    if (ZSTD_isError(ZSTD_CCtx_refCDict(qcow2_zstd_cctx, cdict))) {
+        return NULL;
+    }
+    return qcow2_zstd_cctx;
+}
+
+static ZSTD_DCtx *qcow2_zstd_get_dctx(const ZSTD_DDict *ddict)
+{
+    if (!qcow2_zstd_dctx) {
+        qcow2_zstd_thread_init();
+        qcow2_zstd_dctx = ZSTD_createDCtx();
+        if (!qcow2_zstd_dctx) {
+            return NULL;
+        }
+    } else {
+        ZSTD_DCtx_reset(qcow2_zstd_dctx, ZSTD_reset_session_and_parameters);
+    }
+
+    if (ZSTD_isError(ZSTD_DCtx_refDDict(qcow2_zstd_dctx, ddict))) {
+        return NULL;
+    }
+    return qcow2_zstd_dctx;
+}
+
 /*
  * qcow2_zstd_compress()
  *
@@ -186,7 +257,8 @@ static ssize_t qcow2_zlib_decompress(void *dest, size_t dest_size,
  *          -EIO    on any other error
  */
 static ssize_t qcow2_zstd_compress(void *dest, size_t dest_size,
-                                   const void *src, size_t src_size)
+                                   const void *src, size_t src_size,
+                                   const void *dict)
 {
     ssize_t ret;
     size_t zstd_ret;
@@ -200,7 +272,7 @@ static ssize_t qcow2_zstd_compress(void *dest, size_t dest_size,
         .size = src_size,
         .pos = 0
     };
-    ZSTD_CCtx *cctx = ZSTD_createCCtx();
+    ZSTD_CCtx *cctx = qcow2_zstd_get_cctx(dict);
 
     if (!cctx) {
         return -EIO;
@@ -237,7 +309,6 @@ static ssize_t qcow2_zstd_compress(void *dest, size_t dest_size,
     assert(output.pos <= dest_size);
     ret = output.pos;
 out:
-    ZSTD_freeCCtx(cctx);
     return ret;
 }
 
@@ -254,7 +325,8 @@ out:
  *          -EIO on any error
  */
 static ssize_t qcow2_zstd_decompress(void *dest, size_t dest_size,
-                                     const void *src, size_t src_size)
+                                     const void *src, size_t src_size,
+                                     const void *dict)
 {
     size_t zstd_ret = 0;
     ssize_t ret = 0;
@@ -268,7 +340,7 @@ static ssize_t qcow2_zstd_decompress(void *dest, size_t dest_size,
         .size = src_size,
         .pos = 0
     };
-    ZSTD_DCtx *dctx = ZSTD_createDCtx();
+    ZSTD_DCtx *dctx = qcow2_zstd_get_dctx(dict);
 
     if (!dctx) {
         return -EIO;
@@ -319,31 +391,76 @@ static ssize_t qcow2_zstd_decompress(void *dest, size_t dest_size,
         ret = -EIO;
     }
 
-    ZSTD_freeDCtx(dctx);
     assert(ret == 0 || ret == -EIO);
     return ret;
 }
 #endif
 
+/*
+ * qcow2_compression_dict_init()
+ *
+ * Digest the compression dictionary @dict of @size bytes for use by
+ * qcow2_co_compress() and qcow2_co_decompress().
+ *
+ * Returns: 0 on success
+ *          -errno on failure
+ */
+int qcow2_compression_dict_init(BDRVQcow2State *s, const void *dict,
+                                size_t size, Error **errp)
+{
+#ifdef CONFIG_ZSTD
+    if (s->compression_type != QCOW2_COMPRESSION_TYPE_ZSTD) {
+        error_setg(errp, "A compression dictionary requires the zstd "
+                   "compression type");
+        return -EINVAL;
+    }
+
+    s->zstd_cdict = ZSTD_createCDict(dict, size, ZSTD_CLEVEL_DEFAULT);
+    s->zstd_ddict = ZSTD_createDDict(dict, size);
+    if (!s->zstd_cdict || !s->zstd_ddict) {
+        qcow2_compression_dict_free(s);
+        error_setg(errp, "Could not load the compression dictionary");
+        return -EINVAL;
+    }
+
+    return 0;
+#else
+    error_setg(errp, "Compression dictionaries require zstd support");
+    return -ENOTSUP;
+#endif
+}
+
+void qcow2_compression_dict_free(BDRVQcow2State *s)
+{
+#ifdef CONFIG_ZSTD
+    ZSTD_freeCDict(s->zstd_cdict);
+    ZSTD_freeDDict(s->zstd_ddict);
+#endif
+    s->zstd_cdict = NULL;
+    s->zstd_ddict = NULL;
+}
+
 static int qcow2_compress_pool_func(void *opaque)
 {
     Qcow2CompressData *data = opaque;
 
     data->ret = data->func(data->dest, data->dest_size,
-                           data->src, data->src_size);
+                           data->src, data->src_size, data->dict);
 
     return 0;
 }
 
 static ssize_t coroutine_fn
 qcow2_co_do_compress(BlockDriverState *bs, void *dest, size_t dest_size,
-                     const void *src, size_t src_size, Qcow2CompressFunc func)
+                     const void *src, size_t src_size, Qcow2CompressFunc func,
+                     const void *dict)
 {
     Qcow2CompressData arg = {
         .dest = dest,
         .dest_size = dest_size,
         .src = src,
         .src_size = src_size,
+        .dict = dict,
         .func = func,
     };
 
@@ -370,6 +487,7 @@ qcow2_co_compress(BlockDriverState *bs, void *dest, size_t dest_size,
 {
     BDRVQcow2State *s = bs->opaque;
     Qcow2CompressFunc fn;
+    const void *dict = NULL;
 
     switch (s->compression_type) {
     case QCOW2_COMPRESSION_TYPE_ZLIB:
@@ -379,13 +497,14 @@ qcow2_co_compress(BlockDriverState *bs, void *dest, size_t dest_size,
 #ifdef CONFIG_ZSTD
     case QCOW2_COMPRESSION_TYPE_ZSTD:
         fn = qcow2_zstd_compress;
+        dict = s->zstd_cdict;
         break;
 #endif
     default:
         abort();
     }
 
-    return qcow2_co_do_compress(bs, dest, dest_size, src, src_size, fn);
+    return qcow2_co_do_compress(bs, dest, dest_size, src, src_size, fn, dict);
 }
 
 /*
@@ -407,6 +526,7 @@ qcow2_co_decompress(BlockDriverState *bs, void *dest, size_t dest_size,
 {
     BDRVQcow2State *s = bs->opaque;
     Qcow2CompressFunc fn;
+    const void *dict = NULL;
 
     switch (s->compression_type) {
     case QCOW2_COMPRESSION_TYPE_ZLIB:
@@ -416,13 +536,14 @@ qcow2_co_decompress(BlockDriverState *bs, void *dest, size_t dest_size,
 #ifdef CONFIG_ZSTD
     case QCOW2_COMPRESSION_TYPE_ZSTD:
         fn = qcow2_zstd_decompress;
+        dict = s->zstd_ddict;
         break;
 #endif
     default:
         abort();
     }
 
-    return qcow2_co_do_compress(bs, dest, dest_size, src, src_size, fn);
+    return qcow2_co_do_compress(bs, dest, dest_size, src, src_size, fn, dict);
 }
 
 
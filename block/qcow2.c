@@ -73,6 +73,7 @@ typedef struct {
 #define  QCOW2_EXT_MAGIC_CRYPTO_HEADER 0x0537be77
 #define  QCOW2_EXT_MAGIC_BITMAPS 0x23852875
 #define  QCOW2_EXT_MAGIC_DATA_FILE 0x44415441
+#define  QCOW2_EXT_MAGIC_COMPRESSION_DICT 0x5a444943
 
 static int coroutine_fn
 qcow2_co_preadv_compressed(BlockDriverState *bs,
@@ -432,6 +433,52 @@ qcow2_read_extensions(BlockDriverState *bs, uint64_t start_offset,
             break;
         }
 
+        case QCOW2_EXT_MAGIC_COMPRESSION_DICT:
+        {
+            Qcow2CompressionDictExt dict_ext;
+
+            if (ext.len != sizeof(dict_ext)) {
+                error_setg(errp, "compression_dict_ext: "
+                           "Invalid extension length");
+                return -EINVAL;
+            }
+
+            ret = bdrv_co_pread(bs->file, offset, ext.len, &dict_ext, 0);
+            if (ret < 0) {
+                error_setg_errno(errp, -ret, "compression_dict_ext: "
+                                 "Could not read ext header");
+                return ret;
+            }
+
+            dict_ext.offset = be64_to_cpu(dict_ext.offset);
+            dict_ext.size = be32_to_cpu(dict_ext.size);
+
+            if (dict_ext.reserved32 != 0) {
+                error_setg(errp, "compression_dict_ext: "
+                           "Reserved field is not zero");
+                return -EINVAL;
+            }
+
+            if (offset_into_cluster(s, dict_ext.offset)) {
+                error_setg(errp, "compression_dict_ext: "
+                           "Invalid dictionary offset");
+                return -EINVAL;
+            }
+
+            if (dict_ext.size == 0 ||
+                dict_ext.size > QCOW2_MAX_COMPRESSION_DICT_SIZE) {
+                error_setg(errp, "compression_dict_ext: "
+                           "Dictionary size (%" PRIu32 ") must be between "
+                           "1 and %d", dict_ext.size,
+                           QCOW2_MAX_COMPRESSION_DICT_SIZE);
+                return -EINVAL;
+            }
+
+            s->compression_dict_offset = dict_ext.offset;
+            s->compression_dict_size = dict_ext.size;
+            break;
+        }
+
         default:
             /* unknown magic - save it in case we need to rewrite the header */
             /* If you add a new feature, make sure to also update the fast
@@ -701,6 +748,7 @@ static const char *const mutable_opts[] = {
     QCOW2_OPT_L2_CACHE_ENTRY_SIZE,
     QCOW2_OPT_REFCOUNT_CACHE_SIZE,
     QCOW2_OPT_CACHE_CLEAN_INTERVAL,
+    QCOW2_OPT_COMPRESSED_CACHE_SIZE,
     NULL
 };
 
@@ -817,6 +865,12 @@ static QemuOptsList qcow2_runtime_opts = {
             .type = QEMU_OPT_NUMBER,
             .help = "Clean unused cache entries after this time (in seconds)",
         },
+        {
+            .name = QCOW2_OPT_COMPRESSED_CACHE_SIZE,
+            .type = QEMU_OPT_SIZE,
+            .help = "Maximum decompressed cluster cache size (only used for "
+                    "read-only images)",
+        },
         BLOCK_CRYPTO_OPT_DEF_KEY_SECRET("encrypt.",
             "ID of secret providing qcow2 AES key or LUKS passphrase"),
         { /* end of list */ }
@@ -1045,6 +1099,7 @@ static bool read_cache_sizes(BlockDriverState *bs, QemuOpts *opts,
 typedef struct Qcow2ReopenState {
     Qcow2Cache *l2_table_cache;
     Qcow2Cache *refcount_block_cache;
+    Qcow2CompressedCache *compressed_cache;
     int l2_slice_size; /* Number of entries in a slice of the L2 table */
     bool use_lazy_refcounts;
     int overlap_check;
@@ -1063,6 +1118,7 @@ qcow2_update_options_prepare(BlockDriverState *bs, Qcow2ReopenState *r,
     const char *opt_overlap_check, *opt_overlap_check_template;
     int overlap_check_template = 0;
     uint64_t l2_cache_size, l2_cache_entry_size, refcount_cache_size;
+    uint64_t compressed_cache_size;
     int i;
     const char *encryptfmt;
     QDict *encryptopts = NULL;
@@ -1133,6 +1189,25 @@ qcow2_update_options_prepare(BlockDriverState *bs, Qcow2ReopenState *r,
         goto fail;
     }
 
+    /*
+     * The decompressed cluster cache is never invalidated, so it can only be
+     * used as long as nobody writes to the image
+     */
+    compressed_cache_size =
+        qemu_opt_get_size(opts, QCOW2_OPT_COMPRESSED_CACHE_SIZE,
+                          DEFAULT_COMPRESSED_CACHE_SIZE);
+    compressed_cache_size /= s->cluster_size;
+    if (compressed_cache_size > INT_MAX) {
+        error_setg(errp, "Compressed cluster cache size too big");
+        ret = -EINVAL;
+        goto fail;
+    }
+    if (compressed_cache_size && !(flags & BDRV_O_RDWR)) {
+        r->compressed_cache =
+            qcow2_compressed_cache_create(compressed_cache_size,
+                                          s->cluster_size);
+    }
+
     /* New interval for cache cleanup timer */
     r->cache_clean_interval =
         qemu_opt_get_number(opts, QCOW2_OPT_CACHE_CLEAN_INTERVAL,
@@ -1313,6 +1388,9 @@ static void qcow2_update_options_commit(BlockDriverState *bs,
     s->l2_table_cache = r->l2_table_cache;
     s->refcount_block_cache = r->refcount_block_cache;
 
+    qcow2_compressed_cache_destroy(s->compressed_cache);
+    s->compressed_cache = r->compressed_cache;
+
     s->l2_slice_size = r->l2_slice_size;
 
     s->overlap_check = r->overlap_check;
@@ -1340,6 +1418,7 @@ static void qcow2_update_options_abort(BlockDriverState *bs,
     if (r->refcount_block_cache) {
         qcow2_cache_destroy(r->refcount_block_cache);
     }
+    qcow2_compressed_cache_destroy(r->compressed_cache);
     qapi_free_QCryptoBlockOpenOptions(r->crypto_opts);
 }
 
@@ -1361,6 +1440,110 @@ qcow2_update_options(BlockDriverState *bs, QDict *options, int flags,
     return ret;
 }
 
+/*
+ * Load the compression dictionary referenced by the header extension, which
+ * must be present if and only if the incompatible feature bit is set.
+ */
+static int coroutine_fn GRAPH_RDLOCK
+qcow2_co_load_compression_dict(BlockDriverState *bs, Error **errp)
+{
+    BDRVQcow2State *s = bs->opaque;
+    bool has_dict_bit =
+        s->incompatible_features & QCOW2_INCOMPAT_COMPRESSION_DICT;
+    g_autofree void *dict = NULL;
+    int ret;
+
+    if (has_dict_bit != !!s->compression_dict_size) {
+        error_setg(errp, "qcow2: Compression dictionary incompatible feature "
+                   "bit must be set if and only if there is a compression "
+                   "dictionary header extension");
+        return -EINVAL;
+    }
+
+    if (!s->compression_dict_size) {
+        return 0;
+    }
+
+    dict = g_try_malloc(s->compression_dict_size);
+    if (!dict) {
+        error_setg(errp, "Could not allocate memory for the compression "
+                   "dictionary");
+        return -ENOMEM;
+    }
+
+    ret = bdrv_co_pread(bs->file, s->compression_dict_offset,
+                        s->compression_dict_size, dict, 0);
+    if (ret < 0) {
+        error_setg_errno(errp, -ret, "Could not read compression dictionary");
+        return ret;
+    }
+
+    return qcow2_compression_dict_init(s, dict, s->compression_dict_size,
+                                       errp);
+}
+
+/*
+ * Store @dict in newly allocated clusters and reference it from the header
+ * so that all compressed clusters written from now on use it.
+ */
+static int coroutine_fn GRAPH_RDLOCK
+qcow2_co_store_compression_dict(BlockDriverState *bs, const void *dict,
+                                size_t size, Error **errp)
+{
+    BDRVQcow2State *s = bs->opaque;
+    int64_t offset;
+    int ret;
+
+    assert(!s->compression_dict_size);
+
+    ret = qcow2_compression_dict_init(s, dict, size, errp);
+    if (ret < 0) {
+        return ret;
+    }
+
+    offset = qcow2_alloc_clusters(bs, size);
+    if (offset < 0) {
+        ret = offset;
+        error_setg_errno(errp, -ret, "Could not allocate clusters for the "
+                         "compression dictionary");
+        goto fail;
+    }
+
+    ret = qcow2_pre_write_overlap_check(bs, 0, offset, size, false);
+    if (ret < 0) {
+        error_setg_errno(errp, -ret, "Compression dictionary overlaps with "
+                         "metadata");
+        goto fail_free;
+    }
+
+    ret = bdrv_co_pwrite(bs->file, offset, size, dict, 0);
+    if (ret < 0) {
+        error_setg_errno(errp, -ret, "Could not write compression dictionary");
+        goto fail_free;
+    }
+
+    s->compression_dict_offset = offset;
+    s->compression_dict_size = size;
+    s->incompatible_features |= QCOW2_INCOMPAT_COMPRESSION_DICT;
+
+    ret = qcow2_update_header(bs);
+    if (ret < 0) {
+        error_setg_errno(errp, -ret, "Could not update qcow2 header");
+        s->compression_dict_offset = 0;
+        s->compression_dict_size = 0;
+        s->incompatible_features &= ~QCOW2_INCOMPAT_COMPRESSION_DICT;
+        goto fail_free;
+    }
+
+    return 0;
+
+fail_free:
+    qcow2_free_clusters(bs, offset, size, QCOW2_DISCARD_ALWAYS);
+fail:
+    qcow2_compression_dict_free(s);
+    return ret;
+}
+
 static int validate_compression_type(BDRVQcow2State *s, Error **errp)
 {
     switch (s->compression_type) {
@@ -1719,6 +1902,11 @@ qcow2_do_open(BlockDriverState *bs, QDict *options, int flags,
         goto fail;
     }
 
+    ret = qcow2_co_load_compression_dict(bs, errp);
+    if (ret < 0) {
+        goto fail;
+    }
+
     if (open_data_file && (flags & BDRV_O_NO_IO)) {
         /*
          * Don't open the data file for 'qemu-img info' so that it can be used
@@ -1971,6 +2159,16 @@ qcow2_do_open(BlockDriverState *bs, QDict *options, int flags,
 #endif
 
     qemu_co_queue_init(&s->thread_task_queue);
+    /*
+     * Let compression and encryption scale with the host, e.g. for
+     * qemu-img convert -c -m N.
+     */
+    s->max_threads = MIN(MAX(QCOW2_MAX_THREADS, g_get_num_processors()),
+                         QCOW2_MAX_THREADS_LIMIT);
+
+    qemu_co_mutex_init(&s->compressed_lock);
+    qemu_co_queue_init(&s->compressed_done);
+    QSIMPLEQ_INIT(&s->compressed_writes);
 
     return ret;
 
@@ -1988,6 +2186,7 @@ qcow2_do_open(BlockDriverState *bs, QDict *options, int flags,
     cleanup_unknown_header_ext(bs);
     qcow2_free_snapshots(bs);
     qcow2_refcount_close(bs);
+    qcow2_compression_dict_free(s);
     qemu_vfree(s->l1_table);
     /* else pre-write overlap checks in cache_destroy may crash */
     s->l1_table = NULL;
@@ -1998,6 +2197,8 @@ qcow2_do_open(BlockDriverState *bs, QDict *options, int flags,
     if (s->refcount_block_cache) {
         qcow2_cache_destroy(s->refcount_block_cache);
     }
+    qcow2_compressed_cache_destroy(s->compressed_cache);
+    s->compressed_cache = NULL;
     qcrypto_block_free(s->crypto);
     qapi_free_QCryptoBlockOpenOptions(s->crypto_opts);
     return ret;
@@ -2489,10 +2690,18 @@ qcow2_co_preadv_part(BlockDriverState *bs, int64_t offset, int64_t bytes,
                             QCOW_MAX_CRYPT_CLUSTERS * s->cluster_size);
         }
 
-        qemu_co_mutex_lock(&s->lock);
-        ret = qcow2_get_host_offset(bs, offset, &cur_bytes,
-                                    &host_offset, &type);
-        qemu_co_mutex_unlock(&s->lock);
+        /*
+         * Cached mappings can be resolved without s->lock, which lets reads
+         * from several iothreads proceed in parallel.
+         */
+        ret = qcow2_get_host_offset_lockless(bs, offset, &cur_bytes,
+                                             &host_offset, &type);
+        if (ret == -EAGAIN) {
+            qemu_co_mutex_lock(&s->lock);
+            ret = qcow2_get_host_offset(bs, offset, &cur_bytes,
+                                        &host_offset, &type);
+            qemu_co_mutex_unlock(&s->lock);
+        }
         if (ret < 0) {
             goto out;
         }
@@ -2892,11 +3101,15 @@ qcow2_do_close(BlockDriverState *bs, bool close_data_file)
     cache_clean_timer_del_and_wait(bs);
     qcow2_cache_destroy(s->l2_table_cache);
     qcow2_cache_destroy(s->refcount_block_cache);
+    qcow2_compressed_cache_destroy(s->compressed_cache);
+    s->compressed_cache = NULL;
 
     qcrypto_block_free(s->crypto);
     s->crypto = NULL;
     qapi_free_QCryptoBlockOpenOptions(s->crypto_opts);
 
+    qcow2_compression_dict_free(s);
+
     g_free(s->unknown_header_fields);
     cleanup_unknown_header_ext(bs);
 
@@ -3170,6 +3383,11 @@ int qcow2_update_header(BlockDriverState *bs)
                 .bit  = QCOW2_INCOMPAT_EXTL2_BITNR,
                 .name = "extended L2 entries",
             },
+            {
+                .type = QCOW2_FEAT_TYPE_INCOMPATIBLE,
+                .bit  = QCOW2_INCOMPAT_COMPRESSION_DICT_BITNR,
+                .name = "compression dictionary",
+            },
             {
                 .type = QCOW2_FEAT_TYPE_COMPATIBLE,
                 .bit  = QCOW2_COMPAT_LAZY_REFCOUNTS_BITNR,
@@ -3215,6 +3433,21 @@ int qcow2_update_header(BlockDriverState *bs)
         buflen -= ret;
     }
 
+    /* Compression dictionary extension */
+    if (s->compression_dict_size) {
+        Qcow2CompressionDictExt dict_ext = {
+            .offset = cpu_to_be64(s->compression_dict_offset),
+            .size   = cpu_to_be32(s->compression_dict_size),
+        };
+        ret = header_ext_add(buf, QCOW2_EXT_MAGIC_COMPRESSION_DICT,
+                             &dict_ext, sizeof(dict_ext), buflen);
+        if (ret < 0) {
+            goto fail;
+        }
+        buf += ret;
+        buflen -= ret;
+    }
+
     /* Keep unknown header extensions */
     QLIST_FOREACH(uext, &s->unknown_header_ext, next) {
         ret = header_ext_add(buf, uext->magic, uext->data, uext->len, buflen);
@@ -3612,6 +3845,8 @@ qcow2_co_create(BlockdevCreateOptions *create_options, Error **errp)
     uint64_t *refcount_table;
     int ret;
     uint8_t compression_type = QCOW2_COMPRESSION_TYPE_ZLIB;
+    g_autofree char *compression_dict = NULL;
+    gsize compression_dict_size = 0;
 
     assert(create_options->driver == BLOCKDEV_DRIVER_QCOW2);
     qcow2_opts = &create_options->u.qcow2;
@@ -3790,6 +4025,35 @@ qcow2_co_create(BlockdevCreateOptions *create_options, Error **errp)
         compression_type = qcow2_opts->compression_type;
     }
 
+    if (qcow2_opts->compression_dict) {
+        GError *gerr = NULL;
+
+        if (compression_type != QCOW2_COMPRESSION_TYPE_ZSTD) {
+            error_setg(errp, "A compression dictionary requires "
+                       "compression type zstd");
+            ret = -EINVAL;
+            goto out;
+        }
+
+        if (!g_file_get_contents(qcow2_opts->compression_dict,
+                                 &compression_dict, &compression_dict_size,
+                                 &gerr)) {
+            error_setg(errp, "Could not read compression dictionary: %s",
+                       gerr->message);
+            g_error_free(gerr);
+            ret = -EINVAL;
+            goto out;
+        }
+
+        if (compression_dict_size == 0 ||
+            compression_dict_size > QCOW2_MAX_COMPRESSION_DICT_SIZE) {
+            error_setg(errp, "Compression dictionary size must be between 1 "
+                       "and %d bytes", QCOW2_MAX_COMPRESSION_DICT_SIZE);
+            ret = -EINVAL;
+            goto out;
+        }
+    }
+
     /* Create BlockBackend to write to the image */
     blk = blk_co_new_with_bs(bs, BLK_PERM_WRITE | BLK_PERM_RESIZE, BLK_PERM_ALL,
                              errp);
@@ -3910,6 +4174,16 @@ qcow2_co_create(BlockdevCreateOptions *create_options, Error **errp)
         goto out;
     }
 
+    if (compression_dict) {
+        bdrv_graph_co_rdlock();
+        ret = qcow2_co_store_compression_dict(blk_bs(blk), compression_dict,
+                                              compression_dict_size, errp);
+        bdrv_graph_co_rdunlock();
+        if (ret < 0) {
+            goto out;
+        }
+    }
+
     /* Okay, now that we have a valid image, let's give it the right size */
     ret = blk_co_truncate(blk, qcow2_opts->size, false,
                           qcow2_opts->preallocation, 0, errp);
@@ -4034,6 +4308,7 @@ qcow2_co_create_opts(BlockDriver *drv, const char *filename, QemuOpts *opts,
         { BLOCK_OPT_COMPAT_LEVEL,       "version" },
         { BLOCK_OPT_DATA_FILE_RAW,      "data-file-raw" },
         { BLOCK_OPT_COMPRESSION_TYPE,   "compression-type" },
+        { BLOCK_OPT_COMPRESSION_DICT,   "compression-dict" },
         { NULL, NULL },
     };
 
@@ -4383,6 +4658,32 @@ fail:
     return ret;
 }
 
+static int coroutine_fn GRAPH_RDLOCK
+qcow2_co_share_range(BlockDriverState *bs, int64_t src_offset,
+                     int64_t dst_offset, int64_t bytes)
+{
+    BDRVQcow2State *s = bs->opaque;
+    int ret;
+
+    /*
+     * External data files are not refcounted, and encrypted data depends on
+     * its offset.
+     */
+    if (has_data_file(bs) || bs->encrypted) {
+        return -ENOTSUP;
+    }
+
+    if (!QEMU_IS_ALIGNED(src_offset | dst_offset | bytes, s->cluster_size)) {
+        return -ENOTSUP;
+    }
+
+    qemu_co_mutex_lock(&s->lock);
+    ret = qcow2_cluster_share(bs, src_offset, dst_offset, bytes);
+    qemu_co_mutex_unlock(&s->lock);
+
+    return ret;
+}
+
 static int coroutine_fn GRAPH_RDLOCK
 qcow2_co_truncate(BlockDriverState *bs, int64_t offset, bool exact,
                   PreallocMode prealloc, BdrvRequestFlags flags, Error **errp)
@@ -4760,6 +5061,131 @@ fail:
     return ret;
 }
 
+struct Qcow2CompressedWrite {
+    uint64_t offset;        /* guest offset of the cluster */
+    void *buf;              /* compressed data */
+    size_t len;
+    uint64_t host_offset;
+    int ret;
+    bool done;
+    QSIMPLEQ_ENTRY(Qcow2CompressedWrite) next;
+};
+
+/*
+ * Allocate host space for a batch of compressed clusters with a single
+ * s->lock section, then write every run of contiguously allocated clusters
+ * with one request.
+ */
+static void coroutine_fn GRAPH_RDLOCK
+qcow2_co_write_compressed_batch(BlockDriverState *bs,
+                                Qcow2CompressedWrite **batch, int n)
+{
+    BDRVQcow2State *s = bs->opaque;
+    QEMUIOVector qiov;
+    int i, start;
+
+    qemu_co_mutex_lock(&s->lock);
+    for (i = 0; i < n; i++) {
+        Qcow2CompressedWrite *w = batch[i];
+
+        w->ret = qcow2_alloc_compressed_cluster_offset(bs, w->offset, w->len,
+                                                       &w->host_offset);
+        if (w->ret == 0) {
+            w->ret = qcow2_pre_write_overlap_check(bs, 0, w->host_offset,
+                                                   w->len, true);
+        }
+    }
+    qemu_co_mutex_unlock(&s->lock);
+
+    qemu_iovec_init(&qiov, n);
+    for (start = 0; start < n; start = i) {
+        uint64_t end;
+        int ret;
+
+        if (batch[start]->ret < 0) {
+            i = start + 1;
+            continue;
+        }
+
+        qemu_iovec_reset(&qiov);
+        qemu_iovec_add(&qiov, batch[start]->buf, batch[start]->len);
+        end = batch[start]->host_offset + batch[start]->len;
+        for (i = start + 1; i < n; i++) {
+            if (batch[i]->ret < 0 || batch[i]->host_offset != end) {
+                break;
+            }
+            qemu_iovec_add(&qiov, batch[i]->buf, batch[i]->len);
+            end += batch[i]->len;
+        }
+
+        BLKDBG_CO_EVENT(s->data_file, BLKDBG_WRITE_COMPRESSED);
+        ret = bdrv_co_pwritev(s->data_file, batch[start]->host_offset,
+                              qiov.size, &qiov, 0);
+        if (ret < 0) {
+            for (int j = start; j < i; j++) {
+                batch[j]->ret = ret;
+            }
+        }
+    }
+    qemu_iovec_destroy(&qiov);
+}
+
+/*
+ * Queue a compressed cluster for writing and return once it has been
+ * written. Whoever finds no batch in progress writes all queued clusters
+ * until the queue is empty, so concurrent writers (e.g. the parallel
+ * coroutines of qemu-img convert -m) share allocations and write requests
+ * while their compression keeps running in the thread pool.
+ */
+static int coroutine_fn GRAPH_RDLOCK
+qcow2_co_queue_compressed_write(BlockDriverState *bs, uint64_t offset,
+                                void *buf, size_t len)
+{
+    BDRVQcow2State *s = bs->opaque;
+    Qcow2CompressedWrite w = {
+        .offset = offset,
+        .buf = buf,
+        .len = len,
+    };
+    Qcow2CompressedWrite *batch[QCOW2_MAX_COMPRESSED_BATCH];
+
+    qemu_co_mutex_lock(&s->compressed_lock);
+    QSIMPLEQ_INSERT_TAIL(&s->compressed_writes, &w, next);
+
+    if (s->compressed_writer_active) {
+        while (!w.done) {
+            qemu_co_queue_wait(&s->compressed_done, &s->compressed_lock);
+        }
+        qemu_co_mutex_unlock(&s->compressed_lock);
+        return w.ret;
+    }
+
+    s->compressed_writer_active = true;
+    while (!QSIMPLEQ_EMPTY(&s->compressed_writes)) {
+        int i, n = 0;
+
+        while (n < QCOW2_MAX_COMPRESSED_BATCH &&
+               !QSIMPLEQ_EMPTY(&s->compressed_writes)) {
+            batch[n++] = QSIMPLEQ_FIRST(&s->compressed_writes);
+            QSIMPLEQ_REMOVE_HEAD(&s->compressed_writes, next);
+        }
+        qemu_co_mutex_unlock(&s->compressed_lock);
+
+        qcow2_co_write_compressed_batch(bs, batch, n);
+
+        qemu_co_mutex_lock(&s->compressed_lock);
+        for (i = 0; i < n; i++) {
+            batch[i]->done = true;
+        }
+        qemu_co_queue_restart_all(&s->compressed_done);
+    }
+    s->compressed_writer_active = false;
+    qemu_co_mutex_unlock(&s->compressed_lock);
+
+    assert(w.done);
+    return w.ret;
+}
+
 static int coroutine_fn GRAPH_RDLOCK
 qcow2_co_pwritev_compressed_task(BlockDriverState *bs,
                                  uint64_t offset, uint64_t bytes,
@@ -4769,7 +5195,6 @@ qcow2_co_pwritev_compressed_task(BlockDriverState *bs,
     int ret;
     ssize_t out_len;
     uint8_t *buf, *out_buf;
-    uint64_t cluster_offset;
 
     assert(bytes == s->cluster_size || (bytes < s->cluster_size &&
            (offset + bytes == bs->total_sectors << BDRV_SECTOR_BITS)));
@@ -4797,22 +5222,7 @@ qcow2_co_pwritev_compressed_task(BlockDriverState *bs,
         goto fail;
     }
 
-    qemu_co_mutex_lock(&s->lock);
-    ret = qcow2_alloc_compressed_cluster_offset(bs, offset, out_len,
-                                                &cluster_offset);
-    if (ret < 0) {
-        qemu_co_mutex_unlock(&s->lock);
-        goto fail;
-    }
-
-    ret = qcow2_pre_write_overlap_check(bs, 0, cluster_offset, out_len, true);
-    qemu_co_mutex_unlock(&s->lock);
-    if (ret < 0) {
-        goto fail;
-    }
-
-    BLKDBG_CO_EVENT(s->data_file, BLKDBG_WRITE_COMPRESSED);
-    ret = bdrv_co_pwrite(s->data_file, cluster_offset, out_len, out_buf, 0);
+    ret = qcow2_co_queue_compressed_write(bs, offset, out_buf, out_len);
     if (ret < 0) {
         goto fail;
     }
@@ -4923,6 +5333,13 @@ qcow2_co_preadv_compressed(BlockDriverState *bs,
 
     qcow2_parse_compressed_l2_entry(bs, l2_entry, &coffset, &csize);
 
+    if (s->compressed_cache &&
+        qcow2_compressed_cache_read(s->compressed_cache, coffset,
+                                    offset_in_cluster, bytes,
+                                    qiov, qiov_offset)) {
+        return 0;
+    }
+
     buf = g_try_malloc(csize);
     if (!buf) {
         return -ENOMEM;
@@ -4941,6 +5358,10 @@ qcow2_co_preadv_compressed(BlockDriverState *bs,
         goto fail;
     }
 
+    if (s->compressed_cache) {
+        qcow2_compressed_cache_insert(s->compressed_cache, coffset, out_buf);
+    }
+
     qemu_iovec_from_buf(qiov, qiov_offset, out_buf + offset_in_cluster, bytes);
 
 fail:
@@ -5113,11 +5534,13 @@ static int GRAPH_RDLOCK qcow2_make_empty(BlockDriverState *bs)
     if (s->qcow_version >= 3 && !s->snapshots && !s->nb_bitmaps &&
         3 + l1_clusters <= s->refcount_block_size &&
         s->crypt_method_header != QCOW_CRYPT_LUKS &&
+        !s->compression_dict_size &&
         !has_data_file(bs)) {
         /* The following function only works for qcow2 v3 images (it
          * requires the dirty flag) and only as long as there are no
          * features that reserve extra clusters (such as snapshots,
-         * LUKS header, or persistent bitmaps), because it completely
+         * LUKS header, compression dictionary, or persistent bitmaps),
+         * because it completely
          * empties the image.  Furthermore, the L1 table and three
          * additional clusters (image header, refcount table, one
          * refcount block) have to fit inside one refcount block. It
@@ -5384,6 +5807,8 @@ qcow2_get_specific_info(BlockDriverState *bs, Error **errp)
             .has_data_file_raw  = has_data_file(bs),
             .data_file_raw      = data_file_is_raw(bs),
             .compression_type   = s->compression_type,
+            .has_compression_dict_size = s->compression_dict_size != 0,
+            .compression_dict_size = s->compression_dict_size,
         };
     } else {
         /* if this assertion fails, this probably means a new version was
@@ -5416,6 +5841,26 @@ qcow2_get_specific_info(BlockDriverState *bs, Error **errp)
     return spec_info;
 }
 
+static BlockStatsSpecific *qcow2_get_specific_stats(BlockDriverState *bs)
+{
+    BDRVQcow2State *s = bs->opaque;
+    BlockStatsSpecific *stats;
+    BlockStatsSpecificQcow2 *qcow2_stats;
+
+    if (!s->compressed_cache) {
+        return NULL;
+    }
+
+    stats = g_new(BlockStatsSpecific, 1);
+    qcow2_stats = &stats->u.qcow2;
+    stats->driver = BLOCKDEV_DRIVER_QCOW2;
+    qcow2_compressed_cache_get_stats(s->compressed_cache,
+                                     &qcow2_stats->compressed_cache_hits,
+                                     &qcow2_stats->compressed_cache_misses);
+
+    return stats;
+}
+
 static int coroutine_mixed_fn GRAPH_RDLOCK
 qcow2_has_zero_init(BlockDriverState *bs)
 {
@@ -6202,6 +6647,12 @@ static QemuOptsList qcow2_create_opts = {
             .help = "Compression method used for image cluster "        \
                     "compression",                                      \
             .def_value_str = "zlib"                                     \
+        },                                                              \
+        {                                                               \
+            .name = BLOCK_OPT_COMPRESSION_DICT,                         \
+            .type = QEMU_OPT_STRING,                                    \
+            .help = "File containing a zstd dictionary for image "      \
+                    "cluster compression"                               \
         },
         QCOW_COMMON_OPTIONS,
         { /* end of list */ }
@@ -6244,6 +6695,7 @@ BlockDriver bdrv_qcow2 = {
     .bdrv_co_create                     = qcow2_co_create,
     .bdrv_has_zero_init                 = qcow2_has_zero_init,
     .bdrv_co_block_status               = qcow2_co_block_status,
+    .block_status_cacheable             = true,
 
     .bdrv_co_preadv_part                = qcow2_co_preadv_part,
     .bdrv_co_pwritev_part               = qcow2_co_pwritev_part,
@@ -6253,6 +6705,7 @@ BlockDriver bdrv_qcow2 = {
     .bdrv_co_pdiscard                   = qcow2_co_pdiscard,
     .bdrv_co_copy_range_from            = qcow2_co_copy_range_from,
     .bdrv_co_copy_range_to              = qcow2_co_copy_range_to,
+    .bdrv_co_share_range                = qcow2_co_share_range,
     .bdrv_co_truncate                   = qcow2_co_truncate,
     .bdrv_co_pwritev_compressed_part    = qcow2_co_pwritev_compressed_part,
     .bdrv_make_empty                    = qcow2_make_empty,
@@ -6265,6 +6718,7 @@ BlockDriver bdrv_qcow2 = {
     .bdrv_measure                       = qcow2_measure,
     .bdrv_co_get_info                   = qcow2_co_get_info,
     .bdrv_get_specific_info             = qcow2_get_specific_info,
+    .bdrv_get_specific_stats            = qcow2_get_specific_stats,
 
     .bdrv_co_save_vmstate               = qcow2_co_save_vmstate,
     .bdrv_co_load_vmstate               = qcow2_co_load_vmstate,
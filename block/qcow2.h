@@ -71,6 +71,9 @@
 /* Maximum of parallel sub-request per guest request */
 #define QCOW2_MAX_WORKERS 8
 
+/* Maximum number of L2 entries looked up by one lockless mapping lookup */
+#define QCOW2_LOCKLESS_L2_ENTRIES 64
+
 /* indicate that the refcount of the referenced cluster is exactly one. */
 #define QCOW_OFLAG_COPIED     (1ULL << 63)
 /* indicate that the cluster is compressed (they never have the copied flag) */
@@ -128,6 +131,9 @@
 
 #define DEFAULT_CLUSTER_SIZE 65536
 
+/* Only used for read-only images */
+#define DEFAULT_COMPRESSED_CACHE_SIZE (1 * MiB)
+
 #define QCOW2_OPT_DATA_FILE "data-file"
 #define QCOW2_OPT_LAZY_REFCOUNTS "lazy-refcounts"
 #define QCOW2_OPT_DISCARD_REQUEST "pass-discard-request"
@@ -150,6 +156,7 @@
 #define QCOW2_OPT_L2_CACHE_ENTRY_SIZE "l2-cache-entry-size"
 #define QCOW2_OPT_REFCOUNT_CACHE_SIZE "refcount-cache-size"
 #define QCOW2_OPT_CACHE_CLEAN_INTERVAL "cache-clean-interval"
+#define QCOW2_OPT_COMPRESSED_CACHE_SIZE "compressed-cache-size"
 
 typedef struct QCowHeader {
     uint32_t magic;
@@ -231,6 +238,8 @@ typedef struct QCowSnapshot {
 struct Qcow2Cache;
 typedef struct Qcow2Cache Qcow2Cache;
 
+typedef struct Qcow2CompressedCache Qcow2CompressedCache;
+
 typedef struct Qcow2CryptoHeaderExtension {
     uint64_t offset;
     uint64_t length;
@@ -256,17 +265,21 @@ enum {
     QCOW2_INCOMPAT_DATA_FILE_BITNR  = 2,
     QCOW2_INCOMPAT_COMPRESSION_BITNR = 3,
     QCOW2_INCOMPAT_EXTL2_BITNR      = 4,
+    QCOW2_INCOMPAT_COMPRESSION_DICT_BITNR = 5,
     QCOW2_INCOMPAT_DIRTY            = 1 << QCOW2_INCOMPAT_DIRTY_BITNR,
     QCOW2_INCOMPAT_CORRUPT          = 1 << QCOW2_INCOMPAT_CORRUPT_BITNR,
     QCOW2_INCOMPAT_DATA_FILE        = 1 << QCOW2_INCOMPAT_DATA_FILE_BITNR,
     QCOW2_INCOMPAT_COMPRESSION      = 1 << QCOW2_INCOMPAT_COMPRESSION_BITNR,
     QCOW2_INCOMPAT_EXTL2            = 1 << QCOW2_INCOMPAT_EXTL2_BITNR,
+    QCOW2_INCOMPAT_COMPRESSION_DICT =
+        1 << QCOW2_INCOMPAT_COMPRESSION_DICT_BITNR,
 
     QCOW2_INCOMPAT_MASK             = QCOW2_INCOMPAT_DIRTY
                                     | QCOW2_INCOMPAT_CORRUPT
                                     | QCOW2_INCOMPAT_DATA_FILE
                                     | QCOW2_INCOMPAT_COMPRESSION
-                                    | QCOW2_INCOMPAT_EXTL2,
+                                    | QCOW2_INCOMPAT_EXTL2
+                                    | QCOW2_INCOMPAT_COMPRESSION_DICT,
 };
 
 /* Compatible feature bits */
@@ -322,8 +335,26 @@ typedef struct Qcow2BitmapHeaderExt {
     uint64_t bitmap_directory_offset;
 } QEMU_PACKED Qcow2BitmapHeaderExt;
 
+typedef struct Qcow2CompressionDictExt {
+    uint64_t offset;
+    uint32_t size;
+    uint32_t reserved32;
+} QEMU_PACKED Qcow2CompressionDictExt;
+
+/* Larger dictionaries have diminishing returns for cluster-sized inputs */
+#define QCOW2_MAX_COMPRESSION_DICT_SIZE (1 * MiB)
+
 #define QCOW2_MAX_THREADS 4
 
+/* Upper bound for the thread limit, which otherwise scales with host CPUs */
+#define QCOW2_MAX_THREADS_LIMIT 64
+
+/* Maximum number of compressed clusters written by a single request */
+#define QCOW2_MAX_COMPRESSED_BATCH 64
+
+/* A compressed cluster waiting to be allocated and written, see qcow2.c */
+typedef struct Qcow2CompressedWrite Qcow2CompressedWrite;
+
 typedef struct BDRVQcow2State {
     int cluster_bits;
     int cluster_size;
@@ -345,6 +376,7 @@ typedef struct BDRVQcow2State {
 
     Qcow2Cache *l2_table_cache;
     Qcow2Cache *refcount_block_cache;
+    Qcow2CompressedCache *compressed_cache; /* NULL if disabled */
     /* Non-NULL while the timer is running */
     Coroutine *cache_clean_timer_co;
     unsigned cache_clean_interval;
@@ -413,6 +445,17 @@ typedef struct BDRVQcow2State {
 
     CoQueue thread_task_queue;
     int nb_threads;
+    int max_threads;
+
+    /*
+     * Compressed cluster writes are batched: the first writer to find
+     * compressed_writes empty allocates and writes all entries that queue
+     * up meanwhile, the others wait on compressed_done.
+     */
+    CoMutex compressed_lock;
+    CoQueue compressed_done;
+    QSIMPLEQ_HEAD(, Qcow2CompressedWrite) compressed_writes;
+    bool compressed_writer_active;
 
     BdrvChild *data_file;
 
@@ -425,6 +468,16 @@ typedef struct BDRVQcow2State {
      * is to convert the image with the desired compression type set.
      */
     Qcow2CompressionType compression_type;
+
+    /*
+     * Shared compression dictionary, see the Compression dictionary header
+     * extension. zstd_cdict/zstd_ddict are the digested ZSTD_CDict and
+     * ZSTD_DDict, or NULL if there is no dictionary.
+     */
+    uint64_t compression_dict_offset;
+    uint32_t compression_dict_size;
+    void *zstd_cdict;
+    void *zstd_ddict;
 } BDRVQcow2State;
 
 typedef struct Qcow2COWRegion {
@@ -930,6 +983,8 @@ qcow2_grow_l1_table(BlockDriverState *bs, uint64_t min_size, bool exact_size);
 int coroutine_fn GRAPH_RDLOCK
 qcow2_shrink_l1_table(BlockDriverState *bs, uint64_t max_size);
 
+void qcow2_replace_l1_table(BDRVQcow2State *s, uint64_t *l1_table,
+                            int l1_size);
 int GRAPH_RDLOCK qcow2_write_l1_entry(BlockDriverState *bs, int l1_index);
 int qcow2_encrypt_sectors(BDRVQcow2State *s, int64_t sector_num,
                           uint8_t *buf, int nb_sectors, bool enc, Error **errp);
@@ -939,6 +994,11 @@ qcow2_get_host_offset(BlockDriverState *bs, uint64_t offset,
                       unsigned int *bytes, uint64_t *host_offset,
                       QCow2SubclusterType *subcluster_type);
 
+int GRAPH_RDLOCK
+qcow2_get_host_offset_lockless(BlockDriverState *bs, uint64_t offset,
+                               unsigned int *bytes, uint64_t *host_offset,
+                               QCow2SubclusterType *subcluster_type);
+
 int coroutine_fn GRAPH_RDLOCK
 qcow2_alloc_host_offset(BlockDriverState *bs, uint64_t offset,
                         unsigned int *bytes, uint64_t *host_offset,
@@ -965,6 +1025,10 @@ int coroutine_fn GRAPH_RDLOCK
 qcow2_subcluster_zeroize(BlockDriverState *bs, uint64_t offset, uint64_t bytes,
                          int flags);
 
+int coroutine_fn GRAPH_RDLOCK
+qcow2_cluster_share(BlockDriverState *bs, uint64_t src_offset,
+                    uint64_t dst_offset, uint64_t bytes);
+
 int GRAPH_RDLOCK
 qcow2_expand_zero_clusters(BlockDriverState *bs,
                            BlockDriverAmendStatusCB *status_cb,
@@ -1009,7 +1073,8 @@ int qcow2_cache_destroy(Qcow2Cache *c);
 
 void qcow2_cache_entry_mark_dirty(Qcow2Cache *c, void *table);
 int GRAPH_RDLOCK qcow2_cache_flush(BlockDriverState *bs, Qcow2Cache *c);
-int GRAPH_RDLOCK qcow2_cache_write(BlockDriverState *bs, Qcow2Cache *c);
+int coroutine_mixed_fn GRAPH_RDLOCK
+qcow2_cache_write(BlockDriverState *bs, Qcow2Cache *c);
 int GRAPH_RDLOCK qcow2_cache_set_dependency(BlockDriverState *bs, Qcow2Cache *c,
                                             Qcow2Cache *dependency);
 void qcow2_cache_depends_on_flush(Qcow2Cache *c);
@@ -1028,6 +1093,20 @@ qcow2_cache_get_empty(BlockDriverState *bs, Qcow2Cache *c, uint64_t offset,
 void qcow2_cache_put(Qcow2Cache *c, void **table);
 void *qcow2_cache_is_table_offset(Qcow2Cache *c, uint64_t offset);
 void qcow2_cache_discard(Qcow2Cache *c, void *table);
+bool qcow2_cache_read_entries(Qcow2Cache *c, uint64_t offset, unsigned first,
+                              unsigned n, uint64_t *buf);
+
+/* qcow2-compressed-cache.c functions */
+Qcow2CompressedCache *qcow2_compressed_cache_create(int max_entries,
+                                                   size_t cluster_size);
+void qcow2_compressed_cache_destroy(Qcow2CompressedCache *c);
+bool qcow2_compressed_cache_read(Qcow2CompressedCache *c, uint64_t coffset,
+                                 size_t offset_in_cluster, size_t bytes,
+                                 QEMUIOVector *qiov, size_t qiov_offset);
+void qcow2_compressed_cache_insert(Qcow2CompressedCache *c, uint64_t coffset,
+                                   const void *data);
+void qcow2_compressed_cache_get_stats(Qcow2CompressedCache *c,
+                                      uint64_t *hits, uint64_t *misses);
 
 /* qcow2-bitmap.c functions */
 int coroutine_fn GRAPH_RDLOCK
@@ -1065,6 +1144,10 @@ bool qcow2_supports_persistent_dirty_bitmap(BlockDriverState *bs);
 uint64_t qcow2_get_persistent_dirty_bitmap_size(BlockDriverState *bs,
                                                 uint32_t cluster_size);
 
+int qcow2_compression_dict_init(BDRVQcow2State *s, const void *dict,
+                                size_t size, Error **errp);
+void qcow2_compression_dict_free(BDRVQcow2State *s);
+
 ssize_t coroutine_fn
 qcow2_co_compress(BlockDriverState *bs, void *dest, size_t dest_size,
                   const void *src, size_t src_size);
@@ -1659,6 +1659,7 @@ static BlockDriver bdrv_qed = {
     .bdrv_co_create_opts            = bdrv_qed_co_create_opts,
     .bdrv_has_zero_init             = bdrv_has_zero_init_1,
     .bdrv_co_block_status           = bdrv_qed_co_block_status,
+    .block_status_cacheable         = true,
     .bdrv_co_readv                  = bdrv_qed_co_readv,
     .bdrv_co_writev                 = bdrv_qed_co_writev,
     .bdrv_co_pwrite_zeroes          = bdrv_qed_co_pwrite_zeroes,
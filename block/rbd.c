@@ -18,6 +18,7 @@
 #include "qemu/error-report.h"
 #include "qemu/module.h"
 #include "qemu/option.h"
+#include "qemu/stats64.h"
 #include "block/block-io.h"
 #include "block/block_int.h"
 #include "block/qdict.h"
@@ -87,9 +88,16 @@ typedef enum {
     RBD_AIO_WRITE,
     RBD_AIO_DISCARD,
     RBD_AIO_FLUSH,
-    RBD_AIO_WRITE_ZEROES
+    RBD_AIO_WRITE_ZEROES,
+    RBD_AIO__MAX
 } RBDAIOCmd;
 
+typedef struct RBDOpStats {
+    Stat64 operations;
+    Stat64 failed_operations;
+    Stat64 total_time_ns;
+} RBDOpStats;
+
 typedef struct BDRVRBDState {
     rados_t cluster;
     rados_ioctx_t io_ctx;
@@ -107,6 +115,9 @@ typedef struct BDRVRBDState {
      * probing didn't find any known encryption header either.
      */
     RbdImageEncryptionFormat encryption_format;
+
+    /* Updated from the coroutines of all AioContexts submitting requests */
+    RBDOpStats stats[RBD_AIO__MAX];
 } BDRVRBDState;
 
 typedef struct RBDTask {
@@ -1336,7 +1347,9 @@ static int coroutine_fn qemu_rbd_start_co(BlockDriverState *bs,
 {
     BDRVRBDState *s = bs->opaque;
     RBDTask task = { .co = qemu_coroutine_self() };
+    RBDOpStats *stats = &s->stats[cmd];
     rbd_completion_t c;
+    int64_t start_ns;
     int r;
 
     assert(!qiov || qiov->size == bytes);
@@ -1361,6 +1374,8 @@ static int coroutine_fn qemu_rbd_start_co(BlockDriverState *bs,
         return r;
     }
 
+    stat64_inc(&stats->operations);
+    start_ns = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
     switch (cmd) {
     case RBD_AIO_READ:
         r = rbd_aio_readv(s->image, qiov->iov, qiov->niov, offset, c);
@@ -1395,13 +1410,17 @@ static int coroutine_fn qemu_rbd_start_co(BlockDriverState *bs,
                      " bytes %" PRIu64 " flags %d r %d (%s)", cmd, offset,
                      bytes, flags, r, strerror(-r));
         rbd_aio_release(c);
+        stat64_inc(&stats->failed_operations);
         return r;
     }
 
     /* Expect exactly a single wake from qemu_rbd_finish_bh() */
     qemu_coroutine_yield();
 
+    stat64_add(&stats->total_time_ns,
+               qemu_clock_get_ns(QEMU_CLOCK_REALTIME) - start_ns);
     if (task.ret < 0) {
+        stat64_inc(&stats->failed_operations);
         error_report("rbd request failed: cmd %d offset %" PRIu64 " bytes %"
                      PRIu64 " flags %d task.ret %" PRIi64 " (%s)", cmd, offset,
                      bytes, flags, task.ret, strerror(-task.ret));
@@ -1485,6 +1504,33 @@ static ImageInfoSpecific *qemu_rbd_get_specific_info(BlockDriverState *bs,
     return spec_info;
 }
 
+static RbdOperationStats *qemu_rbd_get_op_stats(BDRVRBDState *s,
+                                                RBDAIOCmd cmd)
+{
+    RbdOperationStats *op_stats = g_new(RbdOperationStats, 1);
+
+    op_stats->operations = stat64_get(&s->stats[cmd].operations);
+    op_stats->failed_operations = stat64_get(&s->stats[cmd].failed_operations);
+    op_stats->total_time_ns = stat64_get(&s->stats[cmd].total_time_ns);
+    return op_stats;
+}
+
+static BlockStatsSpecific *qemu_rbd_get_specific_stats(BlockDriverState *bs)
+{
+    BDRVRBDState *s = bs->opaque;
+    BlockStatsSpecific *stats = g_new(BlockStatsSpecific, 1);
+    BlockStatsSpecificRbd *rbd_stats = &stats->u.rbd;
+
+    stats->driver = BLOCKDEV_DRIVER_RBD;
+    rbd_stats->read = qemu_rbd_get_op_stats(s, RBD_AIO_READ);
+    rbd_stats->write = qemu_rbd_get_op_stats(s, RBD_AIO_WRITE);
+    rbd_stats->discard = qemu_rbd_get_op_stats(s, RBD_AIO_DISCARD);
+    rbd_stats->flush = qemu_rbd_get_op_stats(s, RBD_AIO_FLUSH);
+    rbd_stats->write_zeroes = qemu_rbd_get_op_stats(s, RBD_AIO_WRITE_ZEROES);
+
+    return stats;
+}
+
 /*
  * rbd_diff_iterate2 allows to interrupt the exection by returning a negative
  * value in the callback routine. Choose a value that does not conflict with
@@ -1852,6 +1898,7 @@ static BlockDriver bdrv_rbd = {
     .bdrv_has_zero_init     = bdrv_has_zero_init_1,
     .bdrv_co_get_info       = qemu_rbd_co_get_info,
     .bdrv_get_specific_info = qemu_rbd_get_specific_info,
+    .bdrv_get_specific_stats = qemu_rbd_get_specific_stats,
     .create_opts            = &qemu_rbd_create_opts,
     .bdrv_co_getlength      = qemu_rbd_co_getlength,
     .bdrv_co_truncate       = qemu_rbd_co_truncate,
@@ -580,7 +580,8 @@ static void replication_start(ReplicationState *rs, ReplicationMode mode,
         bdrv_graph_wrunlock();
 
         s->backup_job = backup_job_create(
-                                NULL, s->secondary_disk->bs, s->hidden_disk->bs,
+                                NULL, s->secondary_disk->bs,
+                                &s->hidden_disk->bs, 1,
                                 0, MIRROR_SYNC_MODE_NONE, NULL, 0, false, false,
                                 NULL, &perf,
                                 BLOCKDEV_ON_ERROR_REPORT,
@@ -17,23 +17,49 @@
 
 #include "block/reqlist.h"
 
+void reqlist_init(BlockReqList *reqs)
+{
+    *reqs = (BlockReqList) {};
+}
+
+/*
+ * The tree works on inclusive ranges, widen empty ones to a byte so that it
+ * returns a superset of the requests that ranges_overlap() accepts.
+ */
+static uint64_t reqlist_last(int64_t offset, int64_t bytes)
+{
+    return offset + MAX(bytes, 1) - 1;
+}
+
+static void reqlist_index_req(BlockReq *req)
+{
+    req->node.start = req->offset;
+    req->node.last = reqlist_last(req->offset, req->bytes);
+    interval_tree_insert(&req->node, req->reqs);
+}
+
 void reqlist_init_req(BlockReqList *reqs, BlockReq *req, int64_t offset,
                       int64_t bytes)
 {
     *req = (BlockReq) {
         .offset = offset,
         .bytes = bytes,
+        .reqs = reqs,
     };
     qemu_co_queue_init(&req->wait_queue);
-    QLIST_INSERT_HEAD(reqs, req, list);
+    reqlist_index_req(req);
 }
 
 BlockReq *reqlist_find_conflict(BlockReqList *reqs, int64_t offset,
                                 int64_t bytes)
 {
-    BlockReq *r;
+    uint64_t last = reqlist_last(offset, bytes);
+    IntervalTreeNode *node;
+
+    for (node = interval_tree_iter_first(reqs, offset, last); node;
+         node = interval_tree_iter_next(node, offset, last)) {
+        BlockReq *r = container_of(node, BlockReq, node);
 
-    QLIST_FOREACH(r, reqs, list) {
         if (ranges_overlap(offset, bytes, r->offset, r->bytes)) {
             return r;
         }
@@ -72,12 +98,14 @@ void coroutine_fn reqlist_shrink_req(BlockReq *req, int64_t new_bytes)
 
     assert(new_bytes > 0 && new_bytes < req->bytes);
 
+    interval_tree_remove(&req->node, req->reqs);
     req->bytes = new_bytes;
+    reqlist_index_req(req);
     qemu_co_queue_restart_all(&req->wait_queue);
 }
 
 void coroutine_fn reqlist_remove_req(BlockReq *req)
 {
-    QLIST_REMOVE(req, list);
+    interval_tree_remove(&req->node, req->reqs);
     qemu_co_queue_restart_all(&req->wait_queue);
 }
@@ -255,6 +255,7 @@ int bdrv_snapshot_goto(BlockDriverState *bs,
 
     if (drv->bdrv_snapshot_goto) {
         ret = drv->bdrv_snapshot_goto(bs, snapshot_id);
+        bdrv_bsc_invalidate_all(bs);
         if (ret < 0) {
             error_setg_errno(errp, -ret, "Failed to load snapshot");
         }
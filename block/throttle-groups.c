@@ -35,6 +35,15 @@
 #include "qom/object.h"
 #include "qom/object_interfaces.h"
 
+/*
+ * A request that is not throttled while the group is idle is granted
+ * credit for up to THROTTLE_GROUP_CREDIT_REQS more requests of the same
+ * size, but no more than the average limits allow in
+ * THROTTLE_GROUP_CREDIT_NS.  Slow limits therefore do not get any credit.
+ */
+#define THROTTLE_GROUP_CREDIT_REQS 32
+#define THROTTLE_GROUP_CREDIT_NS (SCALE_MS)
+
 static void throttle_group_obj_init(Object *obj);
 static void throttle_group_obj_complete(UserCreatable *obj, Error **errp);
 static void timer_cb(ThrottleGroupMember *tgm, ThrottleDirection direction);
@@ -350,10 +359,132 @@ static void coroutine_mixed_fn schedule_next_request(ThrottleGroupMember *tgm,
     }
 }
 
+/* Return whether any member of the group is waiting for I/O in @direction.
+ *
+ * This assumes that tg->lock is held.
+ */
+static bool throttle_group_contended(ThrottleGroup *tg,
+                                     ThrottleDirection direction)
+{
+    ThrottleGroupMember *tgm;
+
+    if (tg->any_timer_armed[direction]) {
+        return true;
+    }
+    QLIST_FOREACH(tgm, &tg->head, round_robin) {
+        if (tgm_has_pending_reqs(tgm, direction)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Start an I/O request using the credit of the current AioContext, without
+ * taking the group lock. Return whether there was enough credit.
+ *
+ * @credit: the credit of the current AioContext
+ * @bytes:  the number of bytes for this I/O
+ */
+static bool throttle_group_take_credit(ThrottleGroupCredit *credit,
+                                       int64_t bytes)
+{
+    double units = 1.0;
+    bool ret;
+
+    qemu_spin_lock(&credit->lock);
+    if (credit->op_size && bytes > credit->op_size) {
+        units = (double) bytes / credit->op_size;
+    }
+    ret = credit->units >= units && credit->bytes >= bytes;
+    if (ret) {
+        credit->units -= units;
+        credit->bytes -= bytes;
+    }
+    qemu_spin_unlock(&credit->lock);
+
+    return ret;
+}
+
+/* Account an I/O request that is about to start, and if the group is idle
+ * also account some credit for the following requests of the current
+ * AioContext.
+ *
+ * This assumes that tg->lock is held.
+ *
+ * @tgm:       the current ThrottleGroupMember
+ * @credit:    the credit of the current AioContext
+ * @bytes:     the number of bytes for this I/O
+ * @direction: the ThrottleDirection
+ */
+static void throttle_group_account(ThrottleGroupMember *tgm,
+                                   ThrottleGroupCredit *credit,
+                                   int64_t bytes,
+                                   ThrottleDirection direction)
+{
+    ThrottleState *ts = tgm->throttle_state;
+    ThrottleGroup *tg = container_of(ts, ThrottleGroup, ts);
+    double units = throttle_units(ts, bytes);
+    double grant_units;
+    uint64_t grant_bytes;
+
+    if (!qatomic_read(&tgm->io_limits_disabled) &&
+        !throttle_group_contended(tg, direction)) {
+        throttle_allowance(ts, direction, THROTTLE_GROUP_CREDIT_NS,
+                           &grant_units, &grant_bytes);
+        grant_units = MIN(grant_units, units * THROTTLE_GROUP_CREDIT_REQS);
+        grant_bytes = MIN(grant_bytes,
+                          (uint64_t)bytes * THROTTLE_GROUP_CREDIT_REQS);
+
+        /* Only bother if the credit is enough for one more request */
+        if (grant_units >= 2 * units && grant_bytes >= 2 * (uint64_t)bytes) {
+            qemu_spin_lock(&credit->lock);
+            credit->units = MIN(credit->units + grant_units - units,
+                                grant_units);
+            credit->bytes = MIN(credit->bytes + grant_bytes - bytes,
+                                grant_bytes);
+            credit->op_size = ts->cfg.op_size;
+            qemu_spin_unlock(&credit->lock);
+
+            units = grant_units;
+            bytes = grant_bytes;
+        }
+    }
+
+    throttle_account_units(ts, direction, units, bytes);
+}
+
+/* Drop the credit of all members of a group, e.g. because the
+ * configuration has changed.
+ *
+ * This assumes that tg->lock is held.
+ */
+static void throttle_group_reset_credit(ThrottleGroup *tg)
+{
+    ThrottleGroupMember *tgm;
+    ThrottleDirection dir;
+    int i;
+
+    QLIST_FOREACH(tgm, &tg->head, round_robin) {
+        for (dir = THROTTLE_READ; dir < THROTTLE_MAX; dir++) {
+            for (i = 0; i < THROTTLE_GROUP_CREDIT_SHARDS; i++) {
+                ThrottleGroupCredit *credit = &tgm->credit[dir][i];
+
+                qemu_spin_lock(&credit->lock);
+                credit->units = 0;
+                credit->bytes = 0;
+                qemu_spin_unlock(&credit->lock);
+            }
+        }
+    }
+}
+
 /* Check if an I/O request needs to be throttled, wait and set a timer
  * if necessary, and schedule the next request using a round robin
  * algorithm.
  *
+ * Requests that fit in the credit of the current AioContext are started
+ * right away, unless this member already has throttled requests.
+ *
  * @tgm:       the current ThrottleGroupMember
  * @bytes:     the number of bytes for this I/O
  * @direction: the ThrottleDirection
@@ -365,10 +496,18 @@ void coroutine_fn throttle_group_co_io_limits_intercept(ThrottleGroupMember *tgm
     bool must_wait;
     ThrottleGroupMember *token;
     ThrottleGroup *tg = container_of(tgm->throttle_state, ThrottleGroup, ts);
+    ThrottleGroupCredit *credit;
 
     assert(bytes >= 0);
     assert(direction < THROTTLE_MAX);
 
+    credit = &tgm->credit[direction][
+        qemu_get_current_aio_context_shard(THROTTLE_GROUP_CREDIT_SHARDS_SHIFT)];
+    if (!qatomic_read(&tgm->pending_reqs[direction]) &&
+        throttle_group_take_credit(credit, bytes)) {
+        return;
+    }
+
     qemu_mutex_lock(&tg->lock);
 
     /* First we check if this I/O has to be throttled. */
@@ -377,18 +516,20 @@ void coroutine_fn throttle_group_co_io_limits_intercept(ThrottleGroupMember *tgm
 
     /* Wait if there's a timer set or queued requests of this type */
     if (must_wait || tgm->pending_reqs[direction]) {
-        tgm->pending_reqs[direction]++;
+        qatomic_set(&tgm->pending_reqs[direction],
+                    tgm->pending_reqs[direction] + 1);
         qemu_mutex_unlock(&tg->lock);
         qemu_co_mutex_lock(&tgm->throttled_reqs_lock);
         qemu_co_queue_wait(&tgm->throttled_reqs[direction],
                            &tgm->throttled_reqs_lock);
         qemu_co_mutex_unlock(&tgm->throttled_reqs_lock);
         qemu_mutex_lock(&tg->lock);
-        tgm->pending_reqs[direction]--;
+        qatomic_set(&tgm->pending_reqs[direction],
+                    tgm->pending_reqs[direction] - 1);
     }
 
     /* The I/O will be executed, so do the accounting */
-    throttle_account(tgm->throttle_state, direction, bytes);
+    throttle_group_account(tgm, credit, bytes, direction);
 
     /* Schedule the next request */
     schedule_next_request(tgm, direction);
@@ -478,6 +619,7 @@ void throttle_group_config(ThrottleGroupMember *tgm, ThrottleConfig *cfg)
     ThrottleGroup *tg = container_of(ts, ThrottleGroup, ts);
     qemu_mutex_lock(&tg->lock);
     throttle_config(ts, tg->clock_type, cfg);
+    throttle_group_reset_credit(tg);
     qemu_mutex_unlock(&tg->lock);
 
     throttle_group_restart_tgm(tgm);
@@ -545,6 +687,7 @@ void throttle_group_register_tgm(ThrottleGroupMember *tgm,
                                  AioContext *ctx)
 {
     ThrottleDirection dir;
+    int i;
     ThrottleState *ts = throttle_group_incref(groupname);
     ThrottleGroup *tg = container_of(ts, ThrottleGroup, ts);
 
@@ -559,6 +702,10 @@ void throttle_group_register_tgm(ThrottleGroupMember *tgm,
             tg->tokens[dir] = tgm;
         }
         qemu_co_queue_init(&tgm->throttled_reqs[dir]);
+        for (i = 0; i < THROTTLE_GROUP_CREDIT_SHARDS; i++) {
+            tgm->credit[dir][i] = (ThrottleGroupCredit) { 0 };
+            qemu_spin_init(&tgm->credit[dir][i].lock);
+        }
     }
 
     QLIST_INSERT_HEAD(&tg->head, tgm, round_robin);
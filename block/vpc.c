@@ -1245,6 +1245,7 @@ static BlockDriver bdrv_vpc = {
     .bdrv_co_preadv             = vpc_co_preadv,
     .bdrv_co_pwritev            = vpc_co_pwritev,
     .bdrv_co_block_status       = vpc_co_block_status,
+    .block_status_cacheable     = true,
 
     .bdrv_co_get_info       = vpc_co_get_info,
 
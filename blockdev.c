@@ -1641,7 +1641,7 @@ typedef struct DriveBackupState {
 
 static BlockJob *do_backup_common(BackupCommon *backup,
                                   BlockDriverState *bs,
-                                  BlockDriverState *target_bs,
+                                  BlockDriverState **targets, int nb_targets,
                                   AioContext *aio_context,
                                   JobTxn *txn, Error **errp);
 
@@ -1792,7 +1792,7 @@ static void drive_backup_action(DriveBackup *backup,
     }
 
     state->job = do_backup_common(qapi_DriveBackup_base(backup),
-                                  bs, target_bs, aio_context,
+                                  bs, &target_bs, 1, aio_context,
                                   block_job_txn, errp);
 
 unref:
@@ -1847,9 +1847,12 @@ static void blockdev_backup_action(BlockdevBackup *backup,
 {
     BlockdevBackupState *state = g_new0(BlockdevBackupState, 1);
     BlockDriverState *bs;
-    BlockDriverState *target_bs;
+    g_autofree BlockDriverState **targets = NULL;
+    int nb_targets = 1;
+    strList *e;
     AioContext *aio_context;
     int ret;
+    int i;
 
     tran_add(tran, &blockdev_backup_drv, state);
 
@@ -1858,17 +1861,30 @@ static void blockdev_backup_action(BlockdevBackup *backup,
         return;
     }
 
-    target_bs = bdrv_lookup_bs(backup->target, backup->target, errp);
-    if (!target_bs) {
+    for (e = backup->extra_targets; e; e = e->next) {
+        nb_targets++;
+    }
+    targets = g_new(BlockDriverState *, nb_targets);
+
+    targets[0] = bdrv_lookup_bs(backup->target, backup->target, errp);
+    if (!targets[0]) {
         return;
     }
+    for (e = backup->extra_targets, i = 1; e; e = e->next, i++) {
+        targets[i] = bdrv_lookup_bs(e->value, e->value, errp);
+        if (!targets[i]) {
+            return;
+        }
+    }
 
     /* Honor bdrv_try_change_aio_context() context acquisition requirements. */
     aio_context = bdrv_get_aio_context(bs);
 
-    ret = bdrv_try_change_aio_context(target_bs, aio_context, NULL, errp);
-    if (ret < 0) {
-        return;
+    for (i = 0; i < nb_targets; i++) {
+        ret = bdrv_try_change_aio_context(targets[i], aio_context, NULL, errp);
+        if (ret < 0) {
+            return;
+        }
     }
 
     state->bs = bs;
@@ -1877,7 +1893,7 @@ static void blockdev_backup_action(BlockdevBackup *backup,
     bdrv_drained_begin(state->bs);
 
     state->job = do_backup_common(qapi_BlockdevBackup_base(backup),
-                                  bs, target_bs, aio_context,
+                                  bs, targets, nb_targets, aio_context,
                                   block_job_txn, errp);
 }
 
@@ -2688,7 +2704,7 @@ void qmp_block_commit(const char *job_id, const char *device,
 /* Common QMP interface for drive-backup and blockdev-backup */
 static BlockJob *do_backup_common(BackupCommon *backup,
                                   BlockDriverState *bs,
-                                  BlockDriverState *target_bs,
+                                  BlockDriverState **targets, int nb_targets,
                                   AioContext *aio_context,
                                   JobTxn *txn, Error **errp)
 {
@@ -2730,6 +2746,9 @@ static BlockJob *do_backup_common(BackupCommon *backup,
         if (backup->x_perf->has_min_cluster_size) {
             perf.min_cluster_size = backup->x_perf->min_cluster_size;
         }
+        if (backup->x_perf->has_adaptive) {
+            perf.adaptive = backup->x_perf->adaptive;
+        }
     }
 
     if ((backup->sync == MIRROR_SYNC_MODE_BITMAP) ||
@@ -2805,7 +2824,8 @@ static BlockJob *do_backup_common(BackupCommon *backup,
         on_cbw_error = backup->on_cbw_error;
     }
 
-    job = backup_job_create(backup->job_id, bs, target_bs, backup->speed,
+    job = backup_job_create(backup->job_id, bs, targets, nb_targets,
+                            backup->speed,
                             backup->sync, bmap, backup->bitmap_mode,
                             backup->compress, backup->discard_source,
                             backup->filter_node_name,
@@ -41,6 +41,17 @@ int qemu_chr_fe_write(CharFrontend *c, const uint8_t *buf, int len)
     return qemu_chr_write(s, buf, len, false);
 }
 
+int qemu_chr_fe_writev(CharFrontend *c, const struct iovec *iov, int iovcnt)
+{
+    Chardev *s = c->chr;
+
+    if (!s) {
+        return 0;
+    }
+
+    return qemu_chr_writev(s, iov, iovcnt);
+}
+
 int qemu_chr_fe_write_all(CharFrontend *c, const uint8_t *buf, int len)
 {
     Chardev *s = c->chr;
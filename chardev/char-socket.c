@@ -104,6 +104,32 @@ static void tcp_chr_accept(QIONetListener *listener,
 static int tcp_chr_read_poll(void *opaque);
 static void tcp_chr_disconnect_locked(Chardev *chr);
 
+/* Called with chr_write_lock held.  */
+static int tcp_chr_write_done(Chardev *chr, int ret)
+{
+    SocketChardev *s = SOCKET_CHARDEV(chr);
+
+    /* free the written msgfds in any cases
+     * other than ret < 0 && errno == EAGAIN
+     */
+    if (!(ret < 0 && EAGAIN == errno)
+        && s->write_msgfds_num) {
+        g_free(s->write_msgfds);
+        s->write_msgfds = 0;
+        s->write_msgfds_num = 0;
+    }
+
+    if (ret < 0 && errno != EAGAIN) {
+        if (tcp_chr_read_poll(chr) <= 0) {
+            /* Perform disconnect and return error. */
+            trace_chr_socket_poll_err(chr, chr->label);
+            tcp_chr_disconnect_locked(chr);
+        } /* else let the read handler finish it properly */
+    }
+
+    return ret;
+}
+
 /* Called with chr_write_lock held.  */
 static int tcp_chr_write(Chardev *chr, const uint8_t *buf, int len)
 {
@@ -114,30 +140,36 @@ static int tcp_chr_write(Chardev *chr, const uint8_t *buf, int len)
                                         s->write_msgfds,
                                         s->write_msgfds_num);
 
-        /* free the written msgfds in any cases
-         * other than ret < 0 && errno == EAGAIN
-         */
-        if (!(ret < 0 && EAGAIN == errno)
-            && s->write_msgfds_num) {
-            g_free(s->write_msgfds);
-            s->write_msgfds = 0;
-            s->write_msgfds_num = 0;
-        }
+        return tcp_chr_write_done(chr, ret);
+    } else {
+        /* Indicate an error. */
+        errno = EIO;
+        return -1;
+    }
+}
 
-        if (ret < 0 && errno != EAGAIN) {
-            if (tcp_chr_read_poll(chr) <= 0) {
-                /* Perform disconnect and return error. */
-                trace_chr_socket_poll_err(chr, chr->label);
-                tcp_chr_disconnect_locked(chr);
-            } /* else let the read handler finish it properly */
-        }
+/* Called with chr_write_lock held.  */
+static int tcp_chr_writev(Chardev *chr, const struct iovec *iov, int iovcnt)
+{
+    SocketChardev *s = SOCKET_CHARDEV(chr);
+    ssize_t ret;
 
-        return ret;
-    } else {
+    if (s->state != TCP_CHARDEV_STATE_CONNECTED) {
         /* Indicate an error. */
         errno = EIO;
         return -1;
     }
+
+    ret = qio_channel_writev_full(s->ioc, iov, iovcnt, s->write_msgfds,
+                                  s->write_msgfds_num, 0, NULL);
+    if (ret == QIO_CHANNEL_ERR_BLOCK) {
+        errno = EAGAIN;
+        ret = -1;
+    } else if (ret < 0) {
+        errno = EINVAL;
+        ret = -1;
+    }
+    return tcp_chr_write_done(chr, ret);
 }
 
 static int tcp_chr_read_poll(void *opaque)
@@ -1580,6 +1612,7 @@ static void char_socket_class_init(ObjectClass *oc, const void *data)
     cc->open = qmp_chardev_open_socket;
     cc->chr_wait_connected = tcp_chr_wait_connected;
     cc->chr_write = tcp_chr_write;
+    cc->chr_writev = tcp_chr_writev;
     cc->chr_sync_read = tcp_chr_sync_read;
     cc->chr_disconnect = tcp_chr_disconnect;
     cc->get_msgfds = tcp_get_msgfds;
@@ -28,6 +28,7 @@
 #include "monitor/qmp-helpers.h"
 #include "qemu/config-file.h"
 #include "qemu/error-report.h"
+#include "qemu/iov.h"
 #include "qemu/qemu-print.h"
 #include "chardev/char.h"
 #include "qapi/error.h"
@@ -195,6 +196,46 @@ int qemu_chr_write(Chardev *s, const uint8_t *buf, int len, bool write_all)
     return offset;
 }
 
+/*
+ * Write as much of @iov as the backend accepts without blocking, with a
+ * single call into the backend if it implements chr_writev.
+ */
+int qemu_chr_writev(Chardev *s, const struct iovec *iov, int iovcnt)
+{
+    ChardevClass *cc = CHARDEV_GET_CLASS(s);
+    int done = 0;
+    int res;
+    int i;
+
+    if (!cc->chr_writev || replay_mode != REPLAY_MODE_NONE) {
+        for (i = 0; i < iovcnt; i++) {
+            res = qemu_chr_write(s, iov[i].iov_base, iov[i].iov_len, false);
+            if (res < 0) {
+                return done ? done : res;
+            }
+            done += res;
+            if (res < iov[i].iov_len) {
+                break;
+            }
+        }
+        return done;
+    }
+
+    qemu_mutex_lock(&s->chr_write_lock);
+    res = cc->chr_writev(s, iov, iovcnt);
+    /* as in qemu_chr_write_buffer(), log everything on fatal errors */
+    done = res < 0 ? iov_size(iov, iovcnt) : res;
+    for (i = 0; i < iovcnt && done > 0; i++) {
+        size_t len = MIN(iov[i].iov_len, done);
+
+        qemu_chr_write_log(s, iov[i].iov_base, len);
+        done -= len;
+    }
+    qemu_mutex_unlock(&s->chr_write_lock);
+
+    return res;
+}
+
 int qemu_chr_be_can_write(Chardev *s)
 {
     CharFrontend *fe = s->fe;
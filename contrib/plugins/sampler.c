@@ -0,0 +1,170 @@
+/*
+ * Sampling profiler
+ *
+ * Takes a sample of the PC of each running vCPU at a fixed host time
+ * interval, without instrumenting the translated code, and reports the
+ * most frequently sampled addresses at exit.  With folded=on the report
+ * is in the "folded" format used by perf script based tooling such as
+ * flamegraph.pl, one "symbol count" line per sampled symbol.
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ */
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <glib.h>
+
+#include <qemu-plugin.h>
+
+QEMU_PLUGIN_EXPORT int qemu_plugin_version = QEMU_PLUGIN_VERSION;
+
+typedef struct {
+    uint64_t pc;
+    uint64_t samples;
+    const char *symbol;
+} Sample;
+
+/* Plugins need to take care of their own locking */
+static GMutex lock;
+/* Sampled PC -> Sample */
+static GHashTable *samples;
+/* Block start -> symbol name, as samples are taken at block boundaries */
+static GHashTable *symbols;
+static uint64_t period_ns = 1000000;
+static uint64_t limit = 20;
+static bool folded;
+
+static gint cmp_samples(gconstpointer a, gconstpointer b)
+{
+    const Sample *sa = a;
+    const Sample *sb = b;
+
+    return sa->samples > sb->samples ? -1 : sa->samples < sb->samples;
+}
+
+static void report_folded(GString *report, GList *list)
+{
+    g_autoptr(GHashTable) by_symbol = g_hash_table_new(g_str_hash,
+                                                       g_str_equal);
+    GHashTableIter iter;
+    gpointer key, value;
+
+    for (GList *it = list; it; it = it->next) {
+        Sample *s = it->data;
+        const char *sym = s->symbol ? s->symbol : "[unknown]";
+        uint64_t n = GPOINTER_TO_SIZE(g_hash_table_lookup(by_symbol, sym));
+
+        g_hash_table_insert(by_symbol, (gpointer)sym,
+                            GSIZE_TO_POINTER(n + s->samples));
+    }
+
+    g_hash_table_iter_init(&iter, by_symbol);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        g_string_append_printf(report, "%s %" G_GSIZE_FORMAT "\n",
+                               (const char *)key, GPOINTER_TO_SIZE(value));
+    }
+}
+
+static void plugin_exit(qemu_plugin_id_t id, void *p)
+{
+    g_autoptr(GString) report = g_string_new("");
+    GList *list, *it;
+    uint64_t total = 0;
+    int i;
+
+    g_mutex_lock(&lock);
+    list = g_list_sort(g_hash_table_get_values(samples), cmp_samples);
+
+    if (folded) {
+        report_folded(report, list);
+    } else {
+        for (it = list; it; it = it->next) {
+            total += ((Sample *)it->data)->samples;
+        }
+        g_string_append_printf(report, "%" PRIu64 " samples\n", total);
+        g_string_append(report, "pc, samples, symbol\n");
+        for (i = 0, it = list; i < limit && it; i++, it = it->next) {
+            Sample *s = it->data;
+
+            g_string_append_printf(report, "0x%016" PRIx64 ", %" PRIu64
+                                   ", %s\n", s->pc, s->samples,
+                                   s->symbol ? s->symbol : "");
+        }
+    }
+    g_list_free(list);
+    g_mutex_unlock(&lock);
+
+    qemu_plugin_outs(report->str);
+}
+
+static void vcpu_sample(unsigned int vcpu_index, uint64_t pc, void *udata)
+{
+    Sample *s;
+
+    g_mutex_lock(&lock);
+    s = g_hash_table_lookup(samples, &pc);
+    if (!s) {
+        s = g_new0(Sample, 1);
+        s->pc = pc;
+        s->symbol = g_hash_table_lookup(symbols, &pc);
+        g_hash_table_insert(samples, &s->pc, s);
+    }
+    s->samples++;
+    g_mutex_unlock(&lock);
+}
+
+static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
+{
+    struct qemu_plugin_insn *insn = qemu_plugin_tb_get_insn(tb, 0);
+    const char *sym = qemu_plugin_insn_symbol(insn);
+    uint64_t *pc;
+
+    if (!sym) {
+        return;
+    }
+
+    g_mutex_lock(&lock);
+    pc = g_new(uint64_t, 1);
+    *pc = qemu_plugin_tb_vaddr(tb);
+    g_hash_table_replace(symbols, pc, (gpointer)sym);
+    g_mutex_unlock(&lock);
+}
+
+QEMU_PLUGIN_EXPORT
+int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
+                        int argc, char **argv)
+{
+    for (int i = 0; i < argc; i++) {
+        char *opt = argv[i];
+        g_auto(GStrv) tokens = g_strsplit(opt, "=", 2);
+
+        if (g_strcmp0(tokens[0], "period") == 0) {
+            period_ns = g_ascii_strtoull(tokens[1], NULL, 10);
+            if (!period_ns) {
+                fprintf(stderr, "period must be a positive number of ns\n");
+                return -1;
+            }
+        } else if (g_strcmp0(tokens[0], "limit") == 0) {
+            limit = g_ascii_strtoull(tokens[1], NULL, 10);
+        } else if (g_strcmp0(tokens[0], "folded") == 0) {
+            if (!qemu_plugin_bool_parse(tokens[0], tokens[1], &folded)) {
+                fprintf(stderr, "boolean argument parsing failed: %s\n", opt);
+                return -1;
+            }
+        } else {
+            fprintf(stderr, "option parsing failed: %s\n", opt);
+            return -1;
+        }
+    }
+
+    samples = g_hash_table_new_full(g_int64_hash, g_int64_equal,
+                                    NULL, g_free);
+    symbols = g_hash_table_new_full(g_int64_hash, g_int64_equal,
+                                    g_free, NULL);
+
+    qemu_plugin_register_vcpu_tb_trans_cb(id, vcpu_tb_trans);
+    qemu_plugin_register_vcpu_sample_cb(id, period_ns, vcpu_sample, NULL);
+    qemu_plugin_register_atexit_cb(id, plugin_exit, NULL);
+    return 0;
+}
@@ -27,7 +27,6 @@
 QemuMutex qemu_cpu_list_lock;
 static QemuCond exclusive_cond;
 static QemuCond exclusive_resume;
-static QemuCond qemu_work_cond;
 
 /* >= 1 if a thread is inside start_exclusive/end_exclusive.  Written
  * under qemu_cpu_list_lock, read with atomic operations.
@@ -43,7 +42,6 @@ void qemu_init_cpu_list(void)
     qemu_mutex_init(&qemu_cpu_list_lock);
     qemu_cond_init(&exclusive_cond);
     qemu_cond_init(&exclusive_resume);
-    qemu_cond_init(&qemu_work_cond);
 }
 
 void cpu_list_lock(void)
@@ -124,46 +122,89 @@ CPUState *qemu_get_cpu(int index)
 __thread CPUState *current_cpu;
 
 struct qemu_work_item {
-    QSIMPLEQ_ENTRY(qemu_work_item) node;
+    QSLIST_ENTRY(qemu_work_item) node;
     run_on_cpu_func func;
     run_on_cpu_data data;
     bool free, exclusive, done;
+    QemuEvent *done_event;      /* set with @done unless @free */
 };
 
+/*
+ * Signalled when a do_run_on_cpu() work item of this thread is done.  It
+ * lives as long as the thread, so the vCPU thread can still set it after
+ * the waiter has returned.
+ */
+static __thread QemuEvent run_on_cpu_event;
+static __thread bool run_on_cpu_event_initialized;
+
+/*
+ * cpu->work_list is a lock-free multiple-producer, single-consumer stack:
+ * any thread pushes with cmpxchg, and the thread that runs @cpu takes all
+ * items at once.
+ */
 static void queue_work_on_cpu(CPUState *cpu, struct qemu_work_item *wi)
 {
-    qemu_mutex_lock(&cpu->work_mutex);
-    QSIMPLEQ_INSERT_TAIL(&cpu->work_list, wi, node);
     wi->done = false;
-    qemu_mutex_unlock(&cpu->work_mutex);
+    QSLIST_INSERT_HEAD_ATOMIC(&cpu->work_list, wi, node);
 
     /* exit the inner loop and reach qemu_process_cpu_events_common().  */
     cpu_exit(cpu);
 }
 
+/* Take all queued items of @cpu in the order they were queued */
+static struct qemu_work_item *take_queued_cpu_work(CPUState *cpu)
+{
+    QSLIST_HEAD(, qemu_work_item) batch;
+    struct qemu_work_item *wi, *first = NULL;
+
+    QSLIST_MOVE_ATOMIC(&batch, &cpu->work_list);
+
+    /* The stack returns the newest item first */
+    while (!QSLIST_EMPTY(&batch)) {
+        wi = QSLIST_FIRST(&batch);
+        QSLIST_REMOVE_HEAD(&batch, node);
+        wi->node.sle_next = first;
+        first = wi;
+    }
+    return first;
+}
+
 void do_run_on_cpu(CPUState *cpu, run_on_cpu_func func, run_on_cpu_data data,
                    QemuMutex *mutex)
 {
     struct qemu_work_item wi;
+    CPUState *self_cpu = current_cpu;
 
     if (qemu_cpu_is_self(cpu)) {
         func(cpu, data);
         return;
     }
 
+    if (!run_on_cpu_event_initialized) {
+        qemu_event_init(&run_on_cpu_event, false);
+        run_on_cpu_event_initialized = true;
+    }
+
     wi.func = func;
     wi.data = data;
-    wi.done = false;
     wi.free = false;
     wi.exclusive = false;
+    wi.done_event = &run_on_cpu_event;
 
+    qemu_event_reset(&run_on_cpu_event);
     queue_work_on_cpu(cpu, &wi);
-    while (!qatomic_load_acquire(&wi.done)) {
-        CPUState *self_cpu = current_cpu;
 
-        qemu_cond_wait(&qemu_work_cond, mutex);
-        current_cpu = self_cpu;
+    /*
+     * Wait for this item only, instead of being woken up together with every
+     * other thread waiting for any vCPU.
+     */
+    qemu_mutex_unlock(mutex);
+    while (!qatomic_load_acquire(&wi.done)) {
+        qemu_event_wait(&run_on_cpu_event);
+        qemu_event_reset(&run_on_cpu_event);
     }
+    qemu_mutex_lock(mutex);
+    current_cpu = self_cpu;
 }
 
 void async_run_on_cpu(CPUState *cpu, run_on_cpu_func func, run_on_cpu_data data)
@@ -340,52 +381,56 @@ void async_safe_run_on_cpu(CPUState *cpu, run_on_cpu_func func,
 
 void free_queued_cpu_work(CPUState *cpu)
 {
-    while (!QSIMPLEQ_EMPTY(&cpu->work_list)) {
-        struct qemu_work_item *wi = QSIMPLEQ_FIRST(&cpu->work_list);
-        QSIMPLEQ_REMOVE_HEAD(&cpu->work_list, node);
+    struct qemu_work_item *wi, *next;
+
+    for (wi = take_queued_cpu_work(cpu); wi; wi = next) {
+        next = QSLIST_NEXT(wi, node);
         if (wi->free) {
             g_free(wi);
         }
     }
 }
 
-void process_queued_cpu_work(CPUState *cpu)
+static void process_cpu_work_item(CPUState *cpu, struct qemu_work_item *wi)
 {
-    struct qemu_work_item *wi;
+    if (wi->exclusive) {
+        /* Running work items outside the BQL avoids the following deadlock:
+         * 1) start_exclusive() is called with the BQL taken while another
+         * CPU is running; 2) cpu_exec in the other CPU tries to takes the
+         * BQL, so it goes to sleep; start_exclusive() is sleeping too, so
+         * neither CPU can proceed.
+         */
+        bql_unlock();
+        start_exclusive();
+        wi->func(cpu, wi->data);
+        end_exclusive();
+        bql_lock();
+    } else {
+        wi->func(cpu, wi->data);
+    }
 
-    qemu_mutex_lock(&cpu->work_mutex);
-    if (QSIMPLEQ_EMPTY(&cpu->work_list)) {
-        qemu_mutex_unlock(&cpu->work_mutex);
-        return;
+    if (wi->free) {
+        g_free(wi);
+    } else {
+        /* @wi is gone once @done is set, the event is not */
+        QemuEvent *done_event = wi->done_event;
+
+        qatomic_store_release(&wi->done, true);
+        qemu_event_set(done_event);
     }
-    while (!QSIMPLEQ_EMPTY(&cpu->work_list)) {
-        wi = QSIMPLEQ_FIRST(&cpu->work_list);
-        QSIMPLEQ_REMOVE_HEAD(&cpu->work_list, node);
-        qemu_mutex_unlock(&cpu->work_mutex);
-        if (wi->exclusive) {
-            /* Running work items outside the BQL avoids the following deadlock:
-             * 1) start_exclusive() is called with the BQL taken while another
-             * CPU is running; 2) cpu_exec in the other CPU tries to takes the
-             * BQL, so it goes to sleep; start_exclusive() is sleeping too, so
-             * neither CPU can proceed.
-             */
-            bql_unlock();
-            start_exclusive();
-            wi->func(cpu, wi->data);
-            end_exclusive();
-            bql_lock();
-        } else {
-            wi->func(cpu, wi->data);
-        }
-        qemu_mutex_lock(&cpu->work_mutex);
-        if (wi->free) {
-            g_free(wi);
-        } else {
-            qatomic_store_release(&wi->done, true);
+}
+
+void process_queued_cpu_work(CPUState *cpu)
+{
+    struct qemu_work_item *wi, *next;
+
+    /* Items queued while a batch runs are picked up by the next one */
+    while ((wi = take_queued_cpu_work(cpu))) {
+        for (; wi; wi = next) {
+            next = QSLIST_NEXT(wi, node);
+            process_cpu_work_item(cpu, wi);
         }
     }
-    qemu_mutex_unlock(&cpu->work_mutex);
-    qemu_cond_broadcast(&qemu_work_cond);
 }
 
 /* Add a breakpoint.  */
@@ -31,6 +31,7 @@
 #include "hw/core/cpu.h"
 #include "win_dump.h"
 #include "qemu/range.h"
+#include "qemu/units.h"
 
 #include <zlib.h>
 #ifdef CONFIG_LZO
@@ -527,27 +528,57 @@ static void write_data(DumpState *s, void *buf, int length, Error **errp)
     }
 }
 
-/* write the memory to vmcore. 1 page per I/O. */
+/* Largest amount of guest memory written to the vmcore with one I/O */
+#define DUMP_MAX_WRITE_SIZE (1 * MiB)
+
+/* skip @length bytes of zeroes in the (sparse) vmcore */
+static void skip_data(DumpState *s, int64_t length, Error **errp)
+{
+    if (lseek(s->fd, length, SEEK_CUR) == (off_t) -1) {
+        error_setg_errno(errp, errno, "dump: failed to save memory");
+    } else {
+        s->written_size += length;
+    }
+}
+
+/*
+ * Write the memory to vmcore. Runs of pages are written with one I/O; if
+ * the output is sparse, zero pages are skipped instead of written. The
+ * last page is always written so that the file has its full size.
+ */
 static void write_memory(DumpState *s, GuestPhysBlock *block, ram_addr_t start,
                          int64_t size, Error **errp)
 {
     ERRP_GUARD();
-    int64_t i;
-
-    for (i = 0; i < size / s->dump_info.page_size; i++) {
-        write_data(s, block->host_addr + start + i * s->dump_info.page_size,
-                   s->dump_info.page_size, errp);
-        if (*errp) {
-            return;
+    uint8_t *buf = block->host_addr + start;
+    int64_t page_size = s->dump_info.page_size;
+    int64_t pos = 0;
+
+    while (pos < size) {
+        int64_t len = MIN(page_size, size - pos);
+        bool zero = s->sparse && pos + len < size &&
+                    buffer_is_zero(buf + pos, len);
+        int64_t run = len;
+
+        /* extend the run with following pages of the same kind */
+        while (pos + run < size && run < DUMP_MAX_WRITE_SIZE) {
+            len = MIN(page_size, size - pos - run);
+            if ((s->sparse && pos + run + len < size &&
+                 buffer_is_zero(buf + pos + run, len)) != zero) {
+                break;
+            }
+            run += len;
         }
-    }
 
-    if ((size % s->dump_info.page_size) != 0) {
-        write_data(s, block->host_addr + start + i * s->dump_info.page_size,
-                   size % s->dump_info.page_size, errp);
+        if (zero) {
+            skip_data(s, run, errp);
+        } else {
+            write_data(s, buf + pos, run, errp);
+        }
         if (*errp) {
             return;
         }
+        pos += run;
     }
 }
 
@@ -1785,6 +1816,7 @@ static void dump_init(DumpState *s, int fd, bool has_format,
     ERRP_GUARD();
     VMCoreInfoState *vmci = vmcoreinfo_find();
     CPUState *cpu;
+    struct stat st;
     int nr_cpus;
     int ret;
 
@@ -1815,6 +1847,9 @@ static void dump_init(DumpState *s, int fd, bool has_format,
     }
 
     s->fd = fd;
+    /* zero pages can be left as holes if nothing follows in the file */
+    s->sparse = !fstat(fd, &st) && S_ISREG(st.st_mode) &&
+                lseek(fd, 0, SEEK_CUR) >= st.st_size;
     if (has_filter && !length) {
         error_setg(errp, "parameter 'length' expects a non-zero size");
         goto cleanup;
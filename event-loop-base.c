@@ -75,6 +75,26 @@ static void event_loop_base_set_param(Object *obj, Visitor *v,
     }
 }
 
+static bool event_loop_base_get_handler_stats(Object *obj, Error **errp)
+{
+    EventLoopBase *base = EVENT_LOOP_BASE(obj);
+
+    return base->handler_stats;
+}
+
+static void event_loop_base_set_handler_stats(Object *obj, bool value,
+                                              Error **errp)
+{
+    EventLoopBaseClass *bc = EVENT_LOOP_BASE_GET_CLASS(obj);
+    EventLoopBase *base = EVENT_LOOP_BASE(obj);
+
+    base->handler_stats = value;
+
+    if (bc->update_params) {
+        bc->update_params(base, errp);
+    }
+}
+
 static void event_loop_base_complete(UserCreatable *uc, Error **errp)
 {
     EventLoopBaseClass *bc = EVENT_LOOP_BASE_GET_CLASS(uc);
@@ -116,6 +136,9 @@ static void event_loop_base_class_init(ObjectClass *klass,
                               event_loop_base_get_param,
                               event_loop_base_set_param,
                               NULL, &thread_pool_max_info);
+    object_class_property_add_bool(klass, "handler-stats",
+                                   event_loop_base_get_handler_stats,
+                                   event_loop_base_set_handler_stats);
 }
 
 static const TypeInfo event_loop_base_info = {
@@ -2905,6 +2905,23 @@ float32 float64_to_float32(float64 a, float_status *s)
 {
     FloatParts64 p;
 
+    if (likely(can_use_fpu(s))) {
+        union_float64 ua;
+        union_float32 ur;
+
+        ua.s = a;
+        float64_input_flush1(&ua.s, s);
+        if (likely(float64_is_zero_or_normal(ua.s))) {
+            ur.h = ua.h;
+            /* Leave overflow and possible underflow to softfloat.  */
+            if (likely(!f32_is_inf(ur) &&
+                       (fabsf(ur.h) > FLT_MIN || float64_is_zero(ua.s)))) {
+                return ur.s;
+            }
+        }
+        a = ua.s;
+    }
+
     float64_unpack_canonical(&p, a, s);
     parts_float_to_float(&p, s);
     return float32_round_pack_canonical(&p, s);
@@ -3128,6 +3145,32 @@ int8_t float16_to_int8_scalbn(float16 a, FloatRoundMode rmode, int scale,
     return parts_float_to_sint(&p, rmode, scale, INT8_MIN, INT8_MAX, s);
 }
 
+/*
+ * Host fast path for float to integer conversion without scaling, for
+ * zero or normal inputs of magnitude below @limit.  The result needs no
+ * flags if it is exact, whatever the rounding mode.  Truncation is what
+ * the host does as well, so it can also be used when rounding to zero if
+ * the inexact flag is already set.
+ */
+static inline bool hard_float_to_int(double d, double limit,
+                                     FloatRoundMode rmode,
+                                     const float_status *s, int64_t *ret)
+{
+    int64_t r;
+
+    if (QEMU_NO_HARDFLOAT || !(fabs(d) < limit)) {
+        return false;
+    }
+    r = (int64_t)d;
+    if (likely((double)r == d) ||
+        (rmode == float_round_to_zero &&
+         (s->float_exception_flags & float_flag_inexact))) {
+        *ret = r;
+        return true;
+    }
+    return false;
+}
+
 int16_t float16_to_int16_scalbn(float16 a, FloatRoundMode rmode, int scale,
                                 float_status *s)
 {
@@ -3168,6 +3211,15 @@ int32_t float32_to_int32_scalbn(float32 a, FloatRoundMode rmode, int scale,
                                 float_status *s)
 {
     FloatParts64 p;
+    int64_t r;
+
+    if (likely(scale == 0 && float32_is_zero_or_normal(a))) {
+        union_float32 ua = { .s = a };
+
+        if (hard_float_to_int(ua.h, 0x1p31, rmode, s, &r)) {
+            return r;
+        }
+    }
 
     float32_unpack_canonical(&p, a, s);
     return parts_float_to_sint(&p, rmode, scale, INT32_MIN, INT32_MAX, s);
@@ -3177,6 +3229,15 @@ int64_t float32_to_int64_scalbn(float32 a, FloatRoundMode rmode, int scale,
                                 float_status *s)
 {
     FloatParts64 p;
+    int64_t r;
+
+    if (likely(scale == 0 && float32_is_zero_or_normal(a))) {
+        union_float32 ua = { .s = a };
+
+        if (hard_float_to_int(ua.h, 0x1p63, rmode, s, &r)) {
+            return r;
+        }
+    }
 
     float32_unpack_canonical(&p, a, s);
     return parts_float_to_sint(&p, rmode, scale, INT64_MIN, INT64_MAX, s);
@@ -3195,6 +3256,15 @@ int32_t float64_to_int32_scalbn(float64 a, FloatRoundMode rmode, int scale,
                                 float_status *s)
 {
     FloatParts64 p;
+    int64_t r;
+
+    if (likely(scale == 0 && float64_is_zero_or_normal(a))) {
+        union_float64 ua = { .s = a };
+
+        if (hard_float_to_int(ua.h, 0x1p31, rmode, s, &r)) {
+            return r;
+        }
+    }
 
     float64_unpack_canonical(&p, a, s);
     return parts_float_to_sint(&p, rmode, scale, INT32_MIN, INT32_MAX, s);
@@ -3204,6 +3274,15 @@ int64_t float64_to_int64_scalbn(float64 a, FloatRoundMode rmode, int scale,
                                 float_status *s)
 {
     FloatParts64 p;
+    int64_t r;
+
+    if (likely(scale == 0 && float64_is_zero_or_normal(a))) {
+        union_float64 ua = { .s = a };
+
+        if (hard_float_to_int(ua.h, 0x1p63, rmode, s, &r)) {
+            return r;
+        }
+    }
 
     float64_unpack_canonical(&p, a, s);
     return parts_float_to_sint(&p, rmode, scale, INT64_MIN, INT64_MAX, s);
@@ -78,6 +78,10 @@ typedef struct ExtendedOps {
  * Disables certain performance warnings from being logged on host side.
  */
 #define V9FS_NO_PERF_WARN           0x00000800
+/*
+ * Cache file attributes for a short time (cache=loose)
+ */
+#define V9FS_CACHE_LOOSE            0x00001000
 
 #define V9FS_SEC_MASK               0x0000003C
 
@@ -152,6 +156,15 @@ struct FileOperations {
                       const struct iovec *, int, off_t);
     ssize_t (*pwritev)(FsContext *, V9fsFidOpenState *,
                        const struct iovec *, int, off_t);
+    /*
+     * Optional variants of preadv/pwritev that run in the 9p coroutine
+     * without a worker thread.  They return a negative errno; -ENOTSUP
+     * makes the caller fall back to preadv/pwritev.
+     */
+    ssize_t coroutine_fn (*co_preadv)(FsContext *, V9fsFidOpenState *,
+                                      const struct iovec *, int, off_t);
+    ssize_t coroutine_fn (*co_pwritev)(FsContext *, V9fsFidOpenState *,
+                                       const struct iovec *, int, off_t);
     int (*mkdir)(FsContext *, V9fsPath *, const char *, FsCred *);
     int (*fstat)(FsContext *, int, V9fsFidOpenState *, struct stat *);
     int (*rename)(FsContext *, const char *, const char *);
@@ -59,6 +59,7 @@ static FsDriverTable FsDrivers[] = {
             "fmode",
             "dmode",
             "multidevs",
+            "cache",
             "throttling.bps-total",
             "throttling.bps-read",
             "throttling.bps-write",
@@ -114,6 +115,7 @@ int qemu_fsdev_add(QemuOpts *opts, Error **errp)
     const char *fsdev_id = qemu_opts_id(opts);
     const char *fsdriver = qemu_opt_get(opts, "fsdriver");
     const char *writeout = qemu_opt_get(opts, "writeout");
+    const char *cache = qemu_opt_get(opts, "cache");
     bool ro = qemu_opt_get_bool(opts, "readonly", 0);
 
     if (!fsdev_id) {
@@ -149,6 +151,18 @@ int qemu_fsdev_add(QemuOpts *opts, Error **errp)
             fsle->fse.export_flags |= V9FS_IMMEDIATE_WRITEOUT;
         }
     }
+    if (cache) {
+        if (!strcmp(cache, "loose")) {
+            fsle->fse.export_flags |= V9FS_CACHE_LOOSE;
+        } else if (strcmp(cache, "none")) {
+            error_setg(errp, "invalid cache property '%s'", cache);
+            error_append_hint(errp, "Valid options are: cache="
+                              "[none|loose]\n");
+            g_free(fsle->fse.fsdev_id);
+            g_free(fsle);
+            return -1;
+        }
+    }
     if (ro) {
         fsle->fse.export_flags |= V9FS_RDONLY;
     } else {
@@ -80,13 +80,19 @@ void gdb_init_gdbserver_state(void)
 /* writes 2*len+1 bytes in buf */
 void gdb_memtohex(GString *buf, const uint8_t *mem, int len)
 {
-    int i, c;
-    for(i = 0; i < len; i++) {
-        c = mem[i];
-        g_string_append_c(buf, tohex(c >> 4));
-        g_string_append_c(buf, tohex(c & 0xf));
+    static const char hexchars[] = "0123456789abcdef";
+    gsize start = buf->len;
+    char *p;
+    int i;
+
+    /* Grow the string once instead of appending byte by byte */
+    g_string_set_size(buf, start + 2 * len + 1);
+    p = buf->str + start;
+    for (i = 0; i < len; i++) {
+        *p++ = hexchars[mem[i] >> 4];
+        *p++ = hexchars[mem[i] & 0xf];
     }
-    g_string_append_c(buf, '\0');
+    *p = '\0';
 }
 
 void gdb_hextomem(GByteArray *mem, const char *buf, int len)
@@ -184,20 +190,25 @@ void gdb_put_strbuf(void)
 /* Encode data using the encoding for 'x' packets.  */
 void gdb_memtox(GString *buf, const char *mem, int len)
 {
+    const char *end = mem + len;
+    const char *run = mem;
     char c;
 
-    while (len--) {
-        c = *(mem++);
+    /* Copy runs of bytes that need no escaping in one go */
+    for (; mem < end; mem++) {
+        c = *mem;
         switch (c) {
         case '#': case '$': case '*': case '}':
+            g_string_append_len(buf, run, mem - run);
             g_string_append_c(buf, '}');
             g_string_append_c(buf, c ^ 0x20);
+            run = mem + 1;
             break;
         default:
-            g_string_append_c(buf, c);
             break;
         }
     }
+    g_string_append_len(buf, run, mem - run);
 }
 
 static uint32_t gdb_get_cpu_pid(CPUState *cpu)
@@ -1307,6 +1318,39 @@ static void handle_read_mem(GArray *params, void *user_ctx)
     gdb_put_strbuf();
 }
 
+static void handle_read_mem_binary(GArray *params, void *user_ctx)
+{
+    uint64_t len;
+
+    if (params->len != 2) {
+        gdb_put_packet("E22");
+        return;
+    }
+
+    /*
+     * Escaping may double the size of the data; the reply is allowed to
+     * be shorter than requested, and gdb asks again for the rest.
+     */
+    len = MIN(gdb_get_cmd_param(params, 1)->val_ull,
+              (MAX_PACKET_LENGTH - 1) / 2);
+    g_byte_array_set_size(gdbserver_state.mem_buf, len);
+
+    if (gdb_target_memory_rw_debug(gdbserver_state.g_cpu,
+                                   gdb_get_cmd_param(params, 0)->val_ull,
+                                   gdbserver_state.mem_buf->data,
+                                   gdbserver_state.mem_buf->len, false)) {
+        gdb_put_packet("E14");
+        return;
+    }
+
+    g_string_assign(gdbserver_state.str_buf, "b");
+    gdb_memtox(gdbserver_state.str_buf,
+               (const char *)gdbserver_state.mem_buf->data,
+               gdbserver_state.mem_buf->len);
+    gdb_put_packet_binary(gdbserver_state.str_buf->str,
+                          gdbserver_state.str_buf->len, true);
+}
+
 static void handle_write_all_regs(GArray *params, void *user_ctx)
 {
     int reg_id;
@@ -1705,6 +1749,7 @@ static void handle_query_supported(GArray *params, void *user_ctx)
     }
 
     g_string_append(gdbserver_state.str_buf, ";vContSupported+;multiprocess+");
+    g_string_append(gdbserver_state.str_buf, ";binary-upload+");
 
     if (extra_query_flags) {
         int extras = g_strv_length(extra_query_flags);
@@ -2195,6 +2240,17 @@ static int gdb_handle_packet(const char *line_buf)
             cmd_parser = &read_mem_cmd_desc;
         }
         break;
+    case 'x':
+        {
+            static const GdbCmdParseEntry read_mem_binary_cmd_desc = {
+                .handler = handle_read_mem_binary,
+                .cmd = "x",
+                .cmd_startswith = true,
+                .schema = "L,L0"
+            };
+            cmd_parser = &read_mem_binary_cmd_desc;
+        }
+        break;
     case 'M':
         {
             static const GdbCmdParseEntry write_mem_cmd_desc = {
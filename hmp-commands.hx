@@ -626,17 +626,19 @@ SRST
 ERST
     {
         .name       = "sync-profile",
-        .args_type  = "op:s?",
-        .params     = "[on|off|reset]",
+        .args_type  = "op:s?,period:i?",
+        .params     = "[on|off|reset] [period]",
         .help       = "enable, disable or reset synchronization profiling. "
                       "With no arguments, prints whether profiling is on or off.",
         .cmd        = hmp_sync_profile,
     },
 
 SRST
-``sync-profile [on|off|reset]``
+``sync-profile [on|off|reset] [period]``
   Enable, disable or reset synchronization profiling. With no arguments, prints
-  whether profiling is on or off.
+  whether profiling is on or off. With ``on``, *period* makes QEMU profile
+  only one in *period* lock acquisitions and condition variable waits in
+  each thread, which lowers the overhead enough to leave profiling enabled.
 ERST
 
     {
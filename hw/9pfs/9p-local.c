@@ -31,6 +31,7 @@
 #include "qemu/cutils.h"
 #include "qemu/error-report.h"
 #include "qemu/option.h"
+#include "qemu/coroutine.h"
 #include <libgen.h>
 #ifdef CONFIG_LINUX
 #include <linux/fs.h>
@@ -633,6 +634,99 @@ static ssize_t local_pwritev(FsContext *ctx, V9fsFidOpenState *fs,
     return ret;
 }
 
+#ifdef CONFIG_LINUX_IO_URING
+typedef struct {
+    CqeHandler cqe_handler;
+    Coroutine *co;
+    int fd;
+    const struct iovec *iov;
+    int iovcnt;
+    off_t offset;
+    bool write;
+    ssize_t ret;
+} LocalUringRequest;
+
+static void local_uring_prep_sqe(struct io_uring_sqe *sqe, void *opaque)
+{
+    LocalUringRequest *req = opaque;
+
+    if (req->write) {
+        io_uring_prep_writev(sqe, req->fd, req->iov, req->iovcnt, req->offset);
+    } else {
+        io_uring_prep_readv(sqe, req->fd, req->iov, req->iovcnt, req->offset);
+    }
+}
+
+static void local_uring_cqe_handler(CqeHandler *cqe_handler)
+{
+    LocalUringRequest *req = container_of(cqe_handler, LocalUringRequest,
+                                          cqe_handler);
+
+    if (cqe_handler->cqe.res == -EINTR || cqe_handler->cqe.res == -EAGAIN) {
+        aio_add_sqe(local_uring_prep_sqe, req, &req->cqe_handler);
+        return;
+    }
+
+    req->ret = cqe_handler->cqe.res;
+
+    /* See luring_cqe_handler() */
+    if (!qemu_coroutine_entered(req->co)) {
+        aio_co_wake(req->co);
+    }
+}
+
+/*
+ * Submit the read or write to the AioContext's io_uring and yield, instead
+ * of bouncing the coroutine to a worker thread and back.
+ */
+static ssize_t coroutine_fn local_uring_rw(V9fsFidOpenState *fs,
+                                           const struct iovec *iov,
+                                           int iovcnt, off_t offset,
+                                           bool write)
+{
+    LocalUringRequest req = {
+        .co = qemu_coroutine_self(),
+        .fd = fs->fd,
+        .iov = iov,
+        .iovcnt = iovcnt,
+        .offset = offset,
+        .write = write,
+        .ret = -EINPROGRESS,
+    };
+
+    if (!aio_has_io_uring()) {
+        return -ENOTSUP;
+    }
+
+    req.cqe_handler.cb = local_uring_cqe_handler;
+    aio_add_sqe(local_uring_prep_sqe, &req, &req.cqe_handler);
+    if (req.ret == -EINPROGRESS) {
+        qemu_coroutine_yield();
+    }
+    return req.ret;
+}
+
+static ssize_t coroutine_fn local_co_preadv(FsContext *ctx,
+                                            V9fsFidOpenState *fs,
+                                            const struct iovec *iov,
+                                            int iovcnt, off_t offset)
+{
+    return local_uring_rw(fs, iov, iovcnt, offset, false);
+}
+
+static ssize_t coroutine_fn local_co_pwritev(FsContext *ctx,
+                                             V9fsFidOpenState *fs,
+                                             const struct iovec *iov,
+                                             int iovcnt, off_t offset)
+{
+    /* writeout=immediate needs sync_file_range(), see local_pwritev() */
+    if (ctx->export_flags & V9FS_IMMEDIATE_WRITEOUT) {
+        return -ENOTSUP;
+    }
+    return local_uring_rw(fs, iov, iovcnt, offset, true);
+}
+#endif /* CONFIG_LINUX_IO_URING */
+
 static int local_chmod(FsContext *fs_ctx, V9fsPath *fs_path, FsCred *credp)
 {
     char *dirpath = g_path_get_dirname(fs_path->data);
@@ -1611,6 +1705,10 @@ FileOperations local_ops = {
     .seekdir = local_seekdir,
     .preadv = local_preadv,
     .pwritev = local_pwritev,
+#ifdef CONFIG_LINUX_IO_URING
+    .co_preadv = local_co_preadv,
+    .co_pwritev = local_co_pwritev,
+#endif
     .chmod = local_chmod,
     .mknod = local_mknod,
     .mkdir = local_mkdir,
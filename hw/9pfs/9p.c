@@ -596,6 +596,78 @@ static int coroutine_fn v9fs_mark_fids_unreclaim(V9fsPDU *pdu, V9fsPath *path)
     return err;
 }
 
+/*
+ * With cache=loose, lstat() results are reused for up to
+ * V9FS_ATTR_CACHE_TTL_MS.  Changes made through this server invalidate
+ * them right away, changes made directly on the host only after the TTL.
+ */
+#define V9FS_ATTR_CACHE_TTL_MS  1000
+#define V9FS_ATTR_CACHE_MAX     65536
+
+typedef struct {
+    struct stat st;
+    int64_t expire_ns;
+} V9fsAttrCacheEntry;
+
+bool v9fs_attr_cache_lookup(V9fsState *s, V9fsPath *path, struct stat *stbuf)
+{
+    V9fsAttrCacheEntry *e;
+
+    if (!s->attr_cache || !path->data) {
+        return false;
+    }
+    e = g_hash_table_lookup(s->attr_cache, path->data);
+    if (!e) {
+        return false;
+    }
+    if (qemu_clock_get_ns(QEMU_CLOCK_REALTIME) >= e->expire_ns) {
+        g_hash_table_remove(s->attr_cache, path->data);
+        return false;
+    }
+    *stbuf = e->st;
+    return true;
+}
+
+/*
+ * @gen is s->attr_cache_gen from before the lstat() started; the result is
+ * dropped if the path may have changed in the meantime.
+ */
+void v9fs_attr_cache_insert(V9fsState *s, V9fsPath *path,
+                            const struct stat *stbuf, uint64_t gen)
+{
+    V9fsAttrCacheEntry *e;
+
+    if (!s->attr_cache || !path->data || gen != s->attr_cache_gen) {
+        return;
+    }
+    if (g_hash_table_size(s->attr_cache) >= V9FS_ATTR_CACHE_MAX) {
+        g_hash_table_remove_all(s->attr_cache);
+    }
+    e = g_new(V9fsAttrCacheEntry, 1);
+    e->st = *stbuf;
+    e->expire_ns = qemu_clock_get_ns(QEMU_CLOCK_REALTIME) +
+                   V9FS_ATTR_CACHE_TTL_MS * SCALE_MS;
+    g_hash_table_replace(s->attr_cache, g_strdup(path->data), e);
+}
+
+/*
+ * Drop the cached attributes of @path, or of every path if @path is NULL.
+ * Operations that change the namespace use NULL, since they also change
+ * the parent directory and, for renames, every path below the old name.
+ */
+void v9fs_attr_cache_invalidate(V9fsState *s, V9fsPath *path)
+{
+    if (!s->attr_cache) {
+        return;
+    }
+    s->attr_cache_gen++;
+    if (path && path->data) {
+        g_hash_table_remove(s->attr_cache, path->data);
+    } else {
+        g_hash_table_remove_all(s->attr_cache);
+    }
+}
+
 static void coroutine_fn virtfs_reset(V9fsPDU *pdu)
 {
     V9fsState *s = pdu->s;
@@ -607,6 +679,8 @@ static void coroutine_fn virtfs_reset(V9fsPDU *pdu)
      */
     g_autoptr(GList) fids = g_hash_table_get_values(s->fids);
 
+    v9fs_attr_cache_invalidate(s, NULL);
+
     /* ... remove from the table, taking over ownership. */
     g_hash_table_steal_all(s->fids);
 
@@ -4332,6 +4406,10 @@ int v9fs_device_realize_common(V9fsState *s, const V9fsTransport *t,
 
     s->fids = g_hash_table_new(NULL, NULL);
     qemu_co_rwlock_init(&s->rename_lock);
+    if (s->ctx.export_flags & V9FS_CACHE_LOOSE) {
+        s->attr_cache = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                              g_free, g_free);
+    }
 
     if (s->ops->init(&s->ctx, errp) < 0) {
         error_prepend(errp, "cannot initialize fsdev '%s': ",
@@ -4396,6 +4474,10 @@ void v9fs_device_unrealize_common(V9fsState *s)
         g_hash_table_destroy(s->fids);
         s->fids = NULL;
     }
+    if (s->attr_cache) {
+        g_hash_table_destroy(s->attr_cache);
+        s->attr_cache = NULL;
+    }
     g_free(s->tag);
     qp_table_destroy(&s->qpd_table);
     qp_table_destroy(&s->qpp_table);
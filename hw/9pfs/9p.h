@@ -363,6 +363,9 @@ struct V9fsState {
     uint16_t qp_affix_next;
     uint64_t qp_fullpath_next;
     bool reclaiming;
+    /* lstat() results of cache=loose exports, path string -> entry */
+    GHashTable *attr_cache;
+    uint64_t attr_cache_gen; /* bumped by every invalidation */
 };
 
 /* 9p2000.L open flags */
@@ -459,6 +462,10 @@ void v9fs_path_free(V9fsPath *path);
 void G_GNUC_PRINTF(2, 3) v9fs_path_sprintf(V9fsPath *path, const char *fmt,
                                            ...);
 void v9fs_path_copy(V9fsPath *dst, const V9fsPath *src);
+bool v9fs_attr_cache_lookup(V9fsState *s, V9fsPath *path, struct stat *stbuf);
+void v9fs_attr_cache_insert(V9fsState *s, V9fsPath *path,
+                            const struct stat *stbuf, uint64_t gen);
+void v9fs_attr_cache_invalidate(V9fsState *s, V9fsPath *path);
 size_t v9fs_readdir_response_size(V9fsString *name);
 int v9fs_name_to_path(V9fsState *s, V9fsPath *dirpath,
                       const char *name, V9fsPath *path);
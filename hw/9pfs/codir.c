@@ -307,6 +307,7 @@ int coroutine_fn v9fs_co_mkdir(V9fsPDU *pdu, V9fsFidState *fidp,
                 v9fs_path_free(&path);
             }
         });
+    v9fs_attr_cache_invalidate(s, NULL);
     v9fs_path_unlock(s);
     return err;
 }
@@ -51,11 +51,16 @@ int coroutine_fn v9fs_co_lstat(V9fsPDU *pdu, V9fsPath *path, struct stat *stbuf)
 {
     int err;
     V9fsState *s = pdu->s;
+    uint64_t gen = s->attr_cache_gen;
 
     if (v9fs_request_cancelled(pdu)) {
         return -EINTR;
     }
     v9fs_path_read_lock(s);
+    if (v9fs_attr_cache_lookup(s, path, stbuf)) {
+        v9fs_path_unlock(s);
+        return 0;
+    }
     v9fs_co_run_in_worker(
         {
             err = s->ops->lstat(&s->ctx, path, stbuf);
@@ -63,6 +68,9 @@ int coroutine_fn v9fs_co_lstat(V9fsPDU *pdu, V9fsPath *path, struct stat *stbuf)
                 err = -errno;
             }
         });
+    if (!err) {
+        v9fs_attr_cache_insert(s, path, stbuf, gen);
+    }
     v9fs_path_unlock(s);
     return err;
 }
@@ -118,6 +126,9 @@ int coroutine_fn v9fs_co_open(V9fsPDU *pdu, V9fsFidState *fidp, int flags)
                 err = 0;
             }
         });
+    if (flags & O_TRUNC) {
+        v9fs_attr_cache_invalidate(s, &fidp->path);
+    }
     v9fs_path_unlock(s);
     if (!err) {
         total_open_fd++;
@@ -173,6 +184,7 @@ int coroutine_fn v9fs_co_open2(V9fsPDU *pdu, V9fsFidState *fidp,
                 v9fs_path_free(&path);
             }
         });
+    v9fs_attr_cache_invalidate(s, NULL);
     v9fs_path_unlock(s);
     if (!err) {
         total_open_fd++;
@@ -244,6 +256,7 @@ int coroutine_fn v9fs_co_link(V9fsPDU *pdu, V9fsFidState *oldfid,
                 err = -errno;
             }
         });
+    v9fs_attr_cache_invalidate(s, NULL);
     v9fs_path_unlock(s);
     return err;
 }
@@ -258,6 +271,13 @@ int coroutine_fn v9fs_co_pwritev(V9fsPDU *pdu, V9fsFidState *fidp,
         return -EINTR;
     }
     fsdev_co_throttle_request(s->ctx.fst, THROTTLE_WRITE, iov, iovcnt);
+    if (s->ops->co_pwritev) {
+        err = s->ops->co_pwritev(&s->ctx, &fidp->fs, iov, iovcnt, offset);
+        if (err != -ENOTSUP) {
+            v9fs_attr_cache_invalidate(s, &fidp->path);
+            return err;
+        }
+    }
     v9fs_co_run_in_worker(
         {
             err = s->ops->pwritev(&s->ctx, &fidp->fs, iov, iovcnt, offset);
@@ -265,6 +285,7 @@ int coroutine_fn v9fs_co_pwritev(V9fsPDU *pdu, V9fsFidState *fidp,
                 err = -errno;
             }
         });
+    v9fs_attr_cache_invalidate(s, &fidp->path);
     return err;
 }
 
@@ -278,6 +299,12 @@ int coroutine_fn v9fs_co_preadv(V9fsPDU *pdu, V9fsFidState *fidp,
         return -EINTR;
     }
     fsdev_co_throttle_request(s->ctx.fst, THROTTLE_READ, iov, iovcnt);
+    if (s->ops->co_preadv) {
+        err = s->ops->co_preadv(&s->ctx, &fidp->fs, iov, iovcnt, offset);
+        if (err != -ENOTSUP) {
+            return err;
+        }
+    }
     v9fs_co_run_in_worker(
         {
             err = s->ops->preadv(&s->ctx, &fidp->fs, iov, iovcnt, offset);
@@ -114,6 +114,7 @@ int coroutine_fn v9fs_co_chmod(V9fsPDU *pdu, V9fsPath *path, mode_t mode)
                 err = -errno;
             }
         });
+    v9fs_attr_cache_invalidate(s, path);
     v9fs_path_unlock(s);
     return err;
 }
@@ -135,6 +136,7 @@ int coroutine_fn v9fs_co_utimensat(V9fsPDU *pdu, V9fsPath *path,
                 err = -errno;
             }
         });
+    v9fs_attr_cache_invalidate(s, path);
     v9fs_path_unlock(s);
     return err;
 }
@@ -155,6 +157,7 @@ int coroutine_fn v9fs_co_futimens(V9fsPDU *pdu, V9fsFidState *fidp,
                 err = -errno;
             }
         });
+    v9fs_attr_cache_invalidate(s, &fidp->path);
     return err;
 }
 
@@ -179,6 +182,7 @@ int coroutine_fn v9fs_co_chown(V9fsPDU *pdu, V9fsPath *path, uid_t uid,
                 err = -errno;
             }
         });
+    v9fs_attr_cache_invalidate(s, path);
     v9fs_path_unlock(s);
     return err;
 }
@@ -199,6 +203,7 @@ int coroutine_fn v9fs_co_truncate(V9fsPDU *pdu, V9fsPath *path, off_t size)
                 err = -errno;
             }
         });
+    v9fs_attr_cache_invalidate(s, path);
     v9fs_path_unlock(s);
     return err;
 }
@@ -218,6 +223,7 @@ int coroutine_fn v9fs_co_ftruncate(V9fsPDU *pdu, V9fsFidState *fidp, off_t size)
                 err = -errno;
             }
         });
+    v9fs_attr_cache_invalidate(s, &fidp->path);
     return err;
 }
 
@@ -256,6 +262,7 @@ int coroutine_fn v9fs_co_mknod(V9fsPDU *pdu, V9fsFidState *fidp,
                 v9fs_path_free(&path);
             }
         });
+    v9fs_attr_cache_invalidate(s, NULL);
     v9fs_path_unlock(s);
     return err;
 }
@@ -277,6 +284,7 @@ int coroutine_fn v9fs_co_remove(V9fsPDU *pdu, V9fsPath *path)
                 err = -errno;
             }
         });
+    v9fs_attr_cache_invalidate(s, NULL);
     v9fs_path_unlock(s);
     return err;
 }
@@ -298,6 +306,7 @@ int coroutine_fn v9fs_co_unlinkat(V9fsPDU *pdu, V9fsPath *path,
                 err = -errno;
             }
         });
+    v9fs_attr_cache_invalidate(s, NULL);
     v9fs_path_unlock(s);
     return err;
 }
@@ -319,6 +328,7 @@ int coroutine_fn v9fs_co_rename(V9fsPDU *pdu, V9fsPath *oldpath,
                 err = -errno;
             }
         });
+    v9fs_attr_cache_invalidate(s, NULL);
     return err;
 }
 
@@ -340,6 +350,7 @@ int coroutine_fn v9fs_co_renameat(V9fsPDU *pdu, V9fsPath *olddirpath,
                 err = -errno;
             }
         });
+    v9fs_attr_cache_invalidate(s, NULL);
     return err;
 }
 
@@ -378,6 +389,7 @@ int coroutine_fn v9fs_co_symlink(V9fsPDU *pdu, V9fsFidState *dfidp,
                 v9fs_path_free(&path);
             }
         });
+    v9fs_attr_cache_invalidate(s, NULL);
     v9fs_path_unlock(s);
     return err;
 }
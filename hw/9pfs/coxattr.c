@@ -87,6 +87,7 @@ int coroutine_fn v9fs_co_lsetxattr(V9fsPDU *pdu, V9fsPath *path,
                 err = -errno;
             }
         });
+    v9fs_attr_cache_invalidate(s, path);
     v9fs_path_unlock(s);
     return err;
 }
@@ -108,6 +109,7 @@ int coroutine_fn v9fs_co_lremovexattr(V9fsPDU *pdu, V9fsPath *path,
                 err = -errno;
             }
         });
+    v9fs_attr_cache_invalidate(s, path);
     v9fs_path_unlock(s);
     return err;
 }
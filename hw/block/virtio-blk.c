@@ -14,10 +14,13 @@
 #include "qemu/osdep.h"
 #include "qemu/defer-call.h"
 #include "qapi/error.h"
+#include "qapi/visitor.h"
 #include "qemu/iov.h"
 #include "qemu/module.h"
 #include "qemu/error-report.h"
 #include "qemu/main-loop.h"
+#include "qemu/stats64.h"
+#include "qemu/timer.h"
 #include "block/block_int.h"
 #include "trace.h"
 #include "hw/block/block.h"
@@ -37,6 +40,8 @@
 #include "hw/virtio/virtio-access.h"
 #include "hw/virtio/virtio-blk-common.h"
 #include "qemu/coroutine.h"
+#include "qemu/host-utils.h"
+#include "system/stats.h"
 
 static void virtio_blk_ioeventfd_attach(VirtIOBlock *s);
 
@@ -49,6 +54,160 @@ static void virtio_blk_init_request(VirtIOBlock *s, VirtQueue *vq,
     req->in_len = 0;
     req->next = NULL;
     req->mr_next = NULL;
+    req->pop_ns = 0;
+}
+
+static void virtio_blk_latency_add(Stat64 *hist, int64_t start_ns,
+                                   int64_t end_ns)
+{
+    uint64_t us = (end_ns - start_ns) / SCALE_US;
+    int bucket = us ? 64 - clz64(us) : 0;
+
+    stat64_inc(&hist[MIN(bucket, VIRTIO_BLK_LATENCY_BUCKETS - 1)]);
+}
+
+/*
+ * Interrupt coalescing
+ *
+ * When irq-coalesce-usecs is non-zero, completions are not signalled to the
+ * guest one by one. Instead each virtqueue accumulates completed requests
+ * until one of the following happens:
+ *
+ * - the batch reaches max_frames completions,
+ * - the device has no more requests in flight on the virtqueue, or
+ * - irq-coalesce-usecs have passed since the first pending completion.
+ *
+ * max_frames adapts to the observed completion rate in the same spirit as
+ * adjust_polling_time() in util/aio-posix.c: it doubles (up to
+ * irq-coalesce-max-frames) each time a batch fills up before the timer
+ * fires, and halves each time the timer has to flush a partial batch.
+ * Shallow queues therefore converge on the immediate notification path
+ * while deep queues have their interrupt rate divided by the batch factor.
+ */
+struct VirtIOBlockIrqCoalesce {
+    VirtIOBlock *s;
+    VirtQueue *vq;
+    QEMUTimer *timer;
+    unsigned int pending;       /* completions not yet notified */
+    unsigned int max_frames;    /* current, auto-tuned batch limit */
+
+    /* The achieved batch factor is completions / notifies */
+    Stat64 completions;
+    Stat64 notifies;
+};
+
+static void virtio_blk_irq_coalesce_flush(VirtIOBlockIrqCoalesce *c)
+{
+    VirtIODevice *vdev = VIRTIO_DEVICE(c->s);
+
+    timer_del(c->timer);
+    if (!c->pending) {
+        return;
+    }
+
+    trace_virtio_blk_irq_coalesce_flush(vdev, c->vq, c->pending,
+                                        c->max_frames);
+    c->pending = 0;
+    stat64_add(&c->notifies, 1);
+    virtio_notify(vdev, c->vq);
+}
+
+/* Context: vq AioContext */
+static void virtio_blk_irq_coalesce_timer_cb(void *opaque)
+{
+    VirtIOBlockIrqCoalesce *c = opaque;
+
+    /* Completions arrive slower than the batch fills, shrink it */
+    c->max_frames = MAX(c->max_frames / 2, 1);
+    virtio_blk_irq_coalesce_flush(c);
+}
+
+/* Context: vq AioContext */
+static void virtio_blk_irq_coalesce(VirtIOBlockIrqCoalesce *c)
+{
+    VirtIOBlock *s = c->s;
+
+    c->pending++;
+    stat64_add(&c->completions, 1);
+
+    if (c->pending >= c->max_frames) {
+        /* The batch filled up before the deadline, let it grow */
+        c->max_frames = MIN(c->max_frames * 2,
+                            s->conf.irq_coalesce_max_frames);
+        virtio_blk_irq_coalesce_flush(c);
+    } else if (virtio_queue_get_inuse(c->vq) == 0) {
+        /* Nothing else in flight, waiting would only add latency */
+        virtio_blk_irq_coalesce_flush(c);
+    } else if (c->pending == 1) {
+        timer_mod(c->timer, qemu_clock_get_ns(QEMU_CLOCK_REALTIME) +
+                  (int64_t)s->conf.irq_coalesce_usecs * SCALE_US);
+    }
+}
+
+/* Context: BH in vq AioContext */
+static void virtio_blk_irq_coalesce_flush_bh(void *opaque)
+{
+    virtio_blk_irq_coalesce_flush(opaque);
+}
+
+/*
+ * Deliver any interrupts held back by coalescing. The flush runs in each vq's
+ * AioContext so it is serialized against completions on that virtqueue.
+ *
+ * Context: BQL held
+ */
+static void virtio_blk_irq_coalesce_flush_all(VirtIOBlock *s)
+{
+    if (!s->irq_coalesce) {
+        return;
+    }
+
+    for (uint16_t i = 0; i < s->conf.num_queues; i++) {
+        aio_wait_bh_oneshot(s->vq_aio_context[i],
+                            virtio_blk_irq_coalesce_flush_bh,
+                            &s->irq_coalesce[i]);
+    }
+}
+
+/* Context: BQL held */
+static void virtio_blk_irq_coalesce_init(VirtIOBlock *s)
+{
+    VirtIODevice *vdev = VIRTIO_DEVICE(s);
+    VirtIOBlkConf *conf = &s->conf;
+
+    if (!conf->irq_coalesce_usecs) {
+        return;
+    }
+
+    if (!conf->irq_coalesce_max_frames) {
+        conf->irq_coalesce_max_frames = conf->queue_size;
+    }
+
+    s->irq_coalesce = g_new0(VirtIOBlockIrqCoalesce, conf->num_queues);
+    for (uint16_t i = 0; i < conf->num_queues; i++) {
+        VirtIOBlockIrqCoalesce *c = &s->irq_coalesce[i];
+
+        c->s = s;
+        c->vq = virtio_get_queue(vdev, i);
+        c->max_frames = conf->irq_coalesce_max_frames;
+        c->timer = aio_timer_new(s->vq_aio_context[i], QEMU_CLOCK_REALTIME,
+                                 SCALE_NS, virtio_blk_irq_coalesce_timer_cb,
+                                 c);
+    }
+}
+
+/* Context: BQL held */
+static void virtio_blk_irq_coalesce_cleanup(VirtIOBlock *s)
+{
+    if (!s->irq_coalesce) {
+        return;
+    }
+
+    for (uint16_t i = 0; i < s->conf.num_queues; i++) {
+        timer_free(s->irq_coalesce[i].timer);
+    }
+    g_free(s->irq_coalesce);
+    s->irq_coalesce = NULL;
 }
 
 void virtio_blk_req_complete(VirtIOBlockReq *req, unsigned char status)
@@ -62,7 +221,22 @@ void virtio_blk_req_complete(VirtIOBlockReq *req, unsigned char status)
     iov_discard_undo(&req->inhdr_undo);
     iov_discard_undo(&req->outhdr_undo);
     virtqueue_push(req->vq, &req->elem, req->in_len);
-    virtio_notify(vdev, req->vq);
+
+    /*
+     * The coalescing timers live in the vq AioContexts, which only process
+     * the virtqueues while ioeventfd is started.
+     */
+    if (s->irq_coalesce && s->ioeventfd_started) {
+        uint16_t idx = virtio_get_queue_index(req->vq);
+
+        virtio_blk_irq_coalesce(&s->irq_coalesce[idx]);
+    } else {
+        virtio_notify(vdev, req->vq);
+    }
+
+    if (req->pop_ns) {
+        virtio_blk_latency_add(s->latency->total_us, req->pop_ns, get_clock());
+    }
 }
 
 static int virtio_blk_handle_rw_error(VirtIOBlockReq *req, int error,
@@ -85,7 +259,7 @@ static int virtio_blk_handle_rw_error(VirtIOBlockReq *req, int error,
         if (acct_failed) {
             block_acct_failed(blk_get_stats(s->blk), &req->acct);
         }
-        g_free(req);
+        virtqueue_element_free(req);
     }
 
     blk_error_action(s->blk, action, is_read, error);
@@ -97,12 +271,18 @@ static void virtio_blk_rw_complete(void *opaque, int ret)
     VirtIOBlockReq *next = opaque;
     VirtIOBlock *s = next->dev;
     VirtIODevice *vdev = VIRTIO_DEVICE(s);
+    int64_t now = next->pop_ns ? get_clock() : 0;
 
     while (next) {
         VirtIOBlockReq *req = next;
         next = req->mr_next;
         trace_virtio_blk_rw_complete(vdev, req, ret);
 
+        if (req->pop_ns) {
+            virtio_blk_latency_add(s->latency->backend_us, req->submit_ns,
+                                   now);
+        }
+
         if (req->qiov.nalloc != -1) {
             /* If nalloc is != -1 req->qiov is a local copy of the original
              * external iovec. It was allocated in submit_requests to be
@@ -128,7 +308,7 @@ static void virtio_blk_rw_complete(void *opaque, int ret)
 
         virtio_blk_req_complete(req, VIRTIO_BLK_S_OK);
         block_acct_done(blk_get_stats(s->blk), &req->acct);
-        g_free(req);
+        virtqueue_element_free(req);
     }
 }
 
@@ -143,7 +323,7 @@ static void virtio_blk_flush_complete(void *opaque, int ret)
 
     virtio_blk_req_complete(req, VIRTIO_BLK_S_OK);
     block_acct_done(blk_get_stats(s->blk), &req->acct);
-    g_free(req);
+    virtqueue_element_free(req);
 }
 
 static void virtio_blk_discard_write_zeroes_complete(void *opaque, int ret)
@@ -161,17 +341,7 @@ static void virtio_blk_discard_write_zeroes_complete(void *opaque, int ret)
     if (is_write_zeroes) {
         block_acct_done(blk_get_stats(s->blk), &req->acct);
     }
-    g_free(req);
-}
-
-static VirtIOBlockReq *virtio_blk_get_request(VirtIOBlock *s, VirtQueue *vq)
-{
-    VirtIOBlockReq *req = virtqueue_pop(vq, sizeof(VirtIOBlockReq));
-
-    if (req) {
-        virtio_blk_init_request(s, vq, req);
-    }
-    return req;
+    virtqueue_element_free(req);
 }
 
 static void virtio_blk_handle_scsi(VirtIOBlockReq *req)
@@ -206,7 +376,7 @@ static void virtio_blk_handle_scsi(VirtIOBlockReq *req)
 
 fail:
     virtio_blk_req_complete(req, status);
-    g_free(req);
+    virtqueue_element_free(req);
 }
 
 static inline void submit_requests(VirtIOBlock *s, MultiReqBuffer *mrb,
@@ -251,6 +421,21 @@ static inline void submit_requests(VirtIOBlock *s, MultiReqBuffer *mrb,
         flags |= BDRV_REQ_REGISTERED_BUF;
     }
 
+    if (s->latency) {
+        int64_t now = get_clock();
+        int i;
+
+        for (i = start; i < start + num_reqs; i++) {
+            VirtIOBlockReq *req = mrb->reqs[i];
+
+            if (req->pop_ns) {
+                req->submit_ns = now;
+                virtio_blk_latency_add(s->latency->submit_us, req->pop_ns,
+                                       now);
+            }
+        }
+    }
+
     if (is_write) {
         blk_aio_pwritev(blk, sector_num << BDRV_SECTOR_BITS, qiov,
                         flags, virtio_blk_rw_complete,
@@ -604,7 +789,7 @@ static void virtio_blk_zone_report_complete(void *opaque, int ret)
 
 out:
     virtio_blk_req_complete(req, err_status);
-    g_free(req);
+    virtqueue_element_free(req);
     g_free(data->zone_report_data.zones);
     g_free(data);
 }
@@ -653,7 +838,7 @@ static void virtio_blk_handle_zone_report(VirtIOBlockReq *req,
     return;
 out:
     virtio_blk_req_complete(req, err_status);
-    g_free(req);
+    virtqueue_element_free(req);
 }
 
 static void virtio_blk_zone_mgmt_complete(void *opaque, int ret)
@@ -669,7 +854,7 @@ static void virtio_blk_zone_mgmt_complete(void *opaque, int ret)
     }
 
     virtio_blk_req_complete(req, err_status);
-    g_free(req);
+    virtqueue_element_free(req);
 }
 
 static int virtio_blk_handle_zone_mgmt(VirtIOBlockReq *req, BlockZoneOp op)
@@ -711,7 +896,7 @@ static int virtio_blk_handle_zone_mgmt(VirtIOBlockReq *req, BlockZoneOp op)
     return 0;
 out:
     virtio_blk_req_complete(req, err_status);
-    g_free(req);
+    virtqueue_element_free(req);
     return err_status;
 }
 
@@ -742,7 +927,7 @@ static void virtio_blk_zone_append_complete(void *opaque, int ret)
 
 out:
     virtio_blk_req_complete(req, err_status);
-    g_free(req);
+    virtqueue_element_free(req);
     g_free(data);
 }
 
@@ -780,7 +965,7 @@ static int virtio_blk_handle_zone_append(VirtIOBlockReq *req,
 
 out:
     virtio_blk_req_complete(req, err_status);
-    g_free(req);
+    virtqueue_element_free(req);
     return err_status;
 }
 
@@ -847,7 +1032,7 @@ static int virtio_blk_handle_request(VirtIOBlockReq *req, MultiReqBuffer *mrb)
             virtio_blk_req_complete(req, VIRTIO_BLK_S_IOERR);
             block_acct_invalid(blk_get_stats(s->blk),
                                is_write ? BLOCK_ACCT_WRITE : BLOCK_ACCT_READ);
-            g_free(req);
+            virtqueue_element_free(req);
             return 0;
         }
 
@@ -903,7 +1088,7 @@ static int virtio_blk_handle_request(VirtIOBlockReq *req, MultiReqBuffer *mrb)
                               VIRTIO_BLK_ID_BYTES));
         iov_from_buf(in_iov, in_num, 0, serial, size);
         virtio_blk_req_complete(req, VIRTIO_BLK_S_OK);
-        g_free(req);
+        virtqueue_element_free(req);
         break;
     }
     case VIRTIO_BLK_T_ZONE_APPEND & ~VIRTIO_BLK_T_OUT:
@@ -935,7 +1120,7 @@ static int virtio_blk_handle_request(VirtIOBlockReq *req, MultiReqBuffer *mrb)
         if (unlikely(!(type & VIRTIO_BLK_T_OUT) ||
                      out_len > sizeof(dwz_hdr))) {
             virtio_blk_req_complete(req, VIRTIO_BLK_S_UNSUPP);
-            g_free(req);
+            virtqueue_element_free(req);
             return 0;
         }
 
@@ -952,7 +1137,7 @@ static int virtio_blk_handle_request(VirtIOBlockReq *req, MultiReqBuffer *mrb)
                                                             is_write_zeroes);
         if (err_status != VIRTIO_BLK_S_OK) {
             virtio_blk_req_complete(req, err_status);
-            g_free(req);
+            virtqueue_element_free(req);
         }
 
         break;
@@ -967,18 +1152,22 @@ static int virtio_blk_handle_request(VirtIOBlockReq *req, MultiReqBuffer *mrb)
         if (!vbk->handle_unknown_request ||
             !vbk->handle_unknown_request(req, mrb, type)) {
             virtio_blk_req_complete(req, VIRTIO_BLK_S_UNSUPP);
-            g_free(req);
+            virtqueue_element_free(req);
         }
     }
     }
     return 0;
 }
 
+/* Number of requests popped from the virtqueue at once */
+#define VIRTIO_BLK_POP_BATCH 16
+
 void virtio_blk_handle_vq(VirtIOBlock *s, VirtQueue *vq)
 {
-    VirtIOBlockReq *req;
+    VirtIOBlockReq *reqs[VIRTIO_BLK_POP_BATCH];
     MultiReqBuffer mrb = {};
     bool suppress_notifications = virtio_queue_get_notification(vq);
+    unsigned int i, n;
 
     defer_call_begin();
 
@@ -987,10 +1176,23 @@ void virtio_blk_handle_vq(VirtIOBlock *s, VirtQueue *vq)
             virtio_queue_set_notification(vq, 0);
         }
 
-        while ((req = virtio_blk_get_request(s, vq))) {
-            if (virtio_blk_handle_request(req, &mrb)) {
-                virtqueue_detach_element(req->vq, &req->elem, 0);
-                g_free(req);
+        while ((n = virtqueue_pop_batch(vq, sizeof(VirtIOBlockReq),
+                                        (void **)reqs, ARRAY_SIZE(reqs)))) {
+            int64_t pop_ns = s->latency ? get_clock() : 0;
+
+            for (i = 0; i < n; i++) {
+                virtio_blk_init_request(s, vq, reqs[i]);
+                reqs[i]->pop_ns = pop_ns;
+                if (virtio_blk_handle_request(reqs[i], &mrb)) {
+                    break;
+                }
+            }
+            if (i < n) {
+                /* The device is broken, drop the rest of the batch */
+                for (; i < n; i++) {
+                    virtqueue_detach_element(vq, &reqs[i]->elem, 0);
+                    virtqueue_element_free(reqs[i]);
+                }
                 break;
             }
         }
@@ -1040,7 +1242,7 @@ static void virtio_blk_dma_restart_bh(void *opaque)
             while (req) {
                 next = req->next;
                 virtqueue_detach_element(req->vq, &req->elem, 0);
-                g_free(req);
+                virtqueue_element_free(req);
                 req = next;
             }
             break;
@@ -1065,6 +1267,8 @@ static void virtio_blk_dma_restart_cb(void *opaque, bool running,
     VirtIOBlockReq *rq = NULL;
 
     if (!running) {
+        /* Don't let the guest state be saved with interrupts held back */
+        virtio_blk_irq_coalesce_flush_all(s);
         return;
     }
 
@@ -1123,7 +1327,15 @@ static void virtio_blk_reset(VirtIODevice *vdev)
             /* No other threads can access req->vq here */
             virtqueue_detach_element(req->vq, &req->elem, 0);
 
-            g_free(req);
+            virtqueue_element_free(req);
+        }
+    }
+
+    if (s->irq_coalesce) {
+        for (uint16_t i = 0; i < s->conf.num_queues; i++) {
+            timer_del(s->irq_coalesce[i].timer);
+            s->irq_coalesce[i].pending = 0;
+            s->irq_coalesce[i].max_frames = s->conf.irq_coalesce_max_frames;
         }
     }
 
@@ -1674,6 +1886,9 @@ static void virtio_blk_stop_ioeventfd(VirtIODevice *vdev)
     /* Wait for virtio_blk_dma_restart_bh() and in flight I/O to complete */
     blk_drain(s->conf.conf.blk);
 
+    /* Notify the guest while the guest notifiers are still set up */
+    virtio_blk_irq_coalesce_flush_all(s);
+
     /*
      * Try to switch bs back to the QEMU main loop. If other users keep the
      * BlockBackend in the iothread, that's ok
@@ -1754,6 +1969,13 @@ static void virtio_blk_device_realize(DeviceState *dev, Error **errp)
         return;
     }
 
+    if (conf->irq_coalesce_max_frames > conf->queue_size) {
+        error_setg(errp, "irq-coalesce-max-frames property (%" PRIu32 ") "
+                   "must not exceed queue-size (%" PRIu16 ")",
+                   conf->irq_coalesce_max_frames, conf->queue_size);
+        return;
+    }
+
     if (virtio_has_feature(s->host_features, VIRTIO_BLK_F_WRITE_ZEROES) &&
         (!conf->max_write_zeroes_sectors ||
          conf->max_write_zeroes_sectors > BDRV_REQUEST_MAX_SECTORS)) {
@@ -1775,7 +1997,11 @@ static void virtio_blk_device_realize(DeviceState *dev, Error **errp)
     s->sector_mask = (s->conf.conf.logical_block_size / BDRV_SECTOR_SIZE) - 1;
 
     for (i = 0; i < conf->num_queues; i++) {
-        virtio_add_queue(vdev, conf->queue_size, virtio_blk_handle_output);
+        VirtQueue *vq = virtio_add_queue(vdev, conf->queue_size,
+                                         virtio_blk_handle_output);
+
+        /* The driver reads the status byte, not the used length */
+        virtio_queue_set_in_order_batch(vq, true);
     }
     qemu_coroutine_inc_pool_size(conf->num_queues * conf->queue_size / 2);
 
@@ -1794,6 +2020,12 @@ static void virtio_blk_device_realize(DeviceState *dev, Error **errp)
         return;
     }
 
+    virtio_blk_irq_coalesce_init(s);
+
+    if (conf->latency_stats) {
+        s->latency = g_new0(VirtIOBlockLatency, 1);
+    }
+
     /*
      * This must be after virtio_init() so virtio_blk_dma_restart_cb() gets
      * called after ->start_ioeventfd() has already set blk's AioContext.
@@ -1821,6 +2053,9 @@ static void virtio_blk_device_unrealize(DeviceState *dev)
 
     blk_drain(s->blk);
     del_boot_device_lchs(dev, "/disk@0,0");
+    virtio_blk_irq_coalesce_cleanup(s);
+    g_free(s->latency);
+    s->latency = NULL;
     virtio_blk_vq_aio_context_cleanup(s);
     for (i = 0; i < conf->num_queues; i++) {
         virtio_del_queue(vdev, i);
@@ -1881,8 +2116,125 @@ static const Property virtio_blk_properties[] = {
                        conf.max_write_zeroes_sectors, BDRV_REQUEST_MAX_SECTORS),
     DEFINE_PROP_BOOL("x-enable-wce-if-config-wce", VirtIOBlock,
                      conf.x_enable_wce_if_config_wce, true),
+    DEFINE_PROP_UINT32("irq-coalesce-usecs", VirtIOBlock,
+                       conf.irq_coalesce_usecs, 0),
+    DEFINE_PROP_UINT32("irq-coalesce-max-frames", VirtIOBlock,
+                       conf.irq_coalesce_max_frames, 0),
+    DEFINE_PROP_BOOL("latency-stats", VirtIOBlock, conf.latency_stats, false),
 };
 
+static void virtio_blk_get_irq_coalesce_stat(Object *obj, Visitor *v,
+                                             const char *name, void *opaque,
+                                             Error **errp)
+{
+    VirtIOBlock *s = VIRTIO_BLK(obj);
+    size_t offset = (uintptr_t)opaque;
+    uint64_t value = 0;
+
+    if (s->irq_coalesce) {
+        for (uint16_t i = 0; i < s->conf.num_queues; i++) {
+            value += stat64_get((Stat64 *)((char *)&s->irq_coalesce[i] +
+                                           offset));
+        }
+    }
+
+    visit_type_uint64(v, name, &value, errp);
+}
+
+static void virtio_blk_stats_hist_add(StatsList **list, strList *names,
+                                      const char *name, Stat64 *hist)
+{
+    uint64List *buckets = NULL;
+    Stats *stats;
+    int i;
+
+    if (!apply_str_list_filter(name, names)) {
+        return;
+    }
+
+    for (i = VIRTIO_BLK_LATENCY_BUCKETS - 1; i >= 0; i--) {
+        QAPI_LIST_PREPEND(buckets, stat64_get(&hist[i]));
+    }
+    stats = g_new0(Stats, 1);
+    stats->name = g_strdup(name);
+    stats->value = g_new0(StatsValue, 1);
+    stats->value->type = QTYPE_QLIST;
+    stats->value->u.list = buckets;
+    QAPI_LIST_PREPEND(*list, stats);
+}
+
+typedef struct {
+    StatsResultList **result;
+    strList *names;
+} VirtIOBlockStatsArgs;
+
+static int virtio_blk_stats_one(Object *obj, void *opaque)
+{
+    VirtIOBlockStatsArgs *args = opaque;
+    VirtIOBlock *s = (VirtIOBlock *)object_dynamic_cast(obj, TYPE_VIRTIO_BLK);
+    StatsList *stats_list = NULL;
+
+    if (!s || !s->latency) {
+        return 0;
+    }
+
+    virtio_blk_stats_hist_add(&stats_list, args->names, "submit-latency",
+                              s->latency->submit_us);
+    virtio_blk_stats_hist_add(&stats_list, args->names, "backend-latency",
+                              s->latency->backend_us);
+    virtio_blk_stats_hist_add(&stats_list, args->names, "total-latency",
+                              s->latency->total_us);
+
+    if (stats_list) {
+        g_autofree char *path = object_get_canonical_path(obj);
+        add_stats_entry(args->result, STATS_PROVIDER_VIRTIO_BLK, path,
+                        stats_list);
+    }
+    return 0;
+}
+
+static void virtio_blk_stats_cb(StatsResultList **result, StatsTarget target,
+                                strList *names, strList *targets,
+                                Error **errp)
+{
+    VirtIOBlockStatsArgs args = {
+        .result = result,
+        .names = names,
+    };
+
+    if (target != STATS_TARGET_DEVICE) {
+        return;
+    }
+
+    object_child_foreach_recursive(object_get_root(), virtio_blk_stats_one,
+                                   &args);
+}
+
+static void virtio_blk_stats_schemas_cb(StatsSchemaList **result,
+                                        Error **errp)
+{
+    static const char *const names[] = {
+        "total-latency", "backend-latency", "submit-latency",
+    };
+    StatsSchemaValueList *list = NULL;
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(names); i++) {
+        StatsSchemaValue *value = g_new0(StatsSchemaValue, 1);
+
+        value->name = g_strdup(names[i]);
+        value->type = STATS_TYPE_LOG2_HISTOGRAM;
+        value->has_unit = true;
+        value->unit = STATS_UNIT_SECONDS;
+        value->has_base = true;
+        value->base = 10;
+        value->exponent = -6;
+        QAPI_LIST_PREPEND(list, value);
+    }
+    add_stats_schema(result, STATS_PROVIDER_VIRTIO_BLK, STATS_TARGET_DEVICE,
+                     list);
+}
+
 static void virtio_blk_class_init(ObjectClass *klass, const void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
@@ -1902,6 +2254,16 @@ static void virtio_blk_class_init(ObjectClass *klass, const void *data)
     vdc->load = virtio_blk_load_device;
     vdc->start_ioeventfd = virtio_blk_start_ioeventfd;
     vdc->stop_ioeventfd = virtio_blk_stop_ioeventfd;
+
+    object_class_property_add(klass, "x-irq-coalesce-completions", "uint64",
+        virtio_blk_get_irq_coalesce_stat, NULL, NULL,
+        (void *)offsetof(VirtIOBlockIrqCoalesce, completions));
+    object_class_property_add(klass, "x-irq-coalesce-notifies", "uint64",
+        virtio_blk_get_irq_coalesce_stat, NULL, NULL,
+        (void *)offsetof(VirtIOBlockIrqCoalesce, notifies));
+
+    add_stats_callbacks(STATS_PROVIDER_VIRTIO_BLK, virtio_blk_stats_cb,
+                        virtio_blk_stats_schemas_cb);
 }
 
 static const TypeInfo virtio_blk_info = {
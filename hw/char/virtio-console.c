@@ -13,6 +13,7 @@
 #include "qemu/osdep.h"
 #include "chardev/char-fe.h"
 #include "qemu/error-report.h"
+#include "qemu/iov.h"
 #include "qemu/module.h"
 #include "trace.h"
 #include "hw/qdev-properties.h"
@@ -48,20 +49,10 @@ static gboolean chr_write_unblocked(void *do_not_use, GIOCondition cond,
     return G_SOURCE_REMOVE;
 }
 
-/* Callback function that's called when the guest sends us data */
-static ssize_t flush_buf(VirtIOSerialPort *port,
-                         const uint8_t *buf, ssize_t len)
+/* Handle the result of writing @len bytes of guest data to the chardev */
+static ssize_t flush_done(VirtIOSerialPort *port, ssize_t len, ssize_t ret)
 {
     VirtConsole *vcon = VIRTIO_CONSOLE(port);
-    ssize_t ret;
-
-    if (!qemu_chr_fe_backend_connected(&vcon->chr)) {
-        /* If there's no backend, we can just say we consumed all data. */
-        return len;
-    }
-
-    ret = qemu_chr_fe_write(&vcon->chr, buf, len);
-    trace_virtio_console_flush_buf(port->id, len, ret);
 
     if (ret < len) {
         VirtIOSerialPortClass *k = VIRTIO_SERIAL_PORT_GET_CLASS(port);
@@ -107,6 +98,43 @@ static ssize_t flush_buf(VirtIOSerialPort *port,
     return ret;
 }
 
+/* Callback function that's called when the guest sends us data */
+static ssize_t flush_buf(VirtIOSerialPort *port,
+                         const uint8_t *buf, ssize_t len)
+{
+    VirtConsole *vcon = VIRTIO_CONSOLE(port);
+    ssize_t ret;
+
+    if (!qemu_chr_fe_backend_connected(&vcon->chr)) {
+        /* If there's no backend, we can just say we consumed all data. */
+        return len;
+    }
+
+    ret = qemu_chr_fe_write(&vcon->chr, buf, len);
+    trace_virtio_console_flush_buf(port->id, len, ret);
+
+    return flush_done(port, len, ret);
+}
+
+/* Same as flush_buf, for the data of several queued buffers */
+static ssize_t flush_iov(VirtIOSerialPort *port,
+                         const struct iovec *iov, int iovcnt)
+{
+    VirtConsole *vcon = VIRTIO_CONSOLE(port);
+    ssize_t len = iov_size(iov, iovcnt);
+    ssize_t ret;
+
+    if (!qemu_chr_fe_backend_connected(&vcon->chr)) {
+        /* If there's no backend, we can just say we consumed all data. */
+        return len;
+    }
+
+    ret = qemu_chr_fe_writev(&vcon->chr, iov, iovcnt);
+    trace_virtio_console_flush_buf(port->id, len, ret);
+
+    return flush_done(port, len, ret);
+}
+
 /* Callback function that's called when the guest opens/closes the port */
 static void set_guest_connected(VirtIOSerialPort *port, int guest_connected)
 {
@@ -286,6 +314,7 @@ static void virtserialport_class_init(ObjectClass *klass, const void *data)
     k->realize = virtconsole_realize;
     k->unrealize = virtconsole_unrealize;
     k->have_data = flush_buf;
+    k->have_data_iov = flush_iov;
     k->set_guest_connected = set_guest_connected;
     k->enable_backend = virtconsole_enable_backend;
     k->guest_writable = guest_writable;
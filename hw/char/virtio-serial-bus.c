@@ -157,6 +157,128 @@ static void discard_throttle_data(VirtIOSerialPort *port)
     }
 }
 
+/* Maximum number of queued buffers handed to have_data_iov at once */
+#define VIRTIO_SERIAL_FLUSH_BATCH 64
+
+/* Append the data of @elem from out_sg[@idx] + @offset on to *@iov */
+static unsigned int flush_add_iov(struct iovec **iov, unsigned int niov,
+                                  VirtQueueElement *elem, unsigned int idx,
+                                  uint64_t offset)
+{
+    *iov = g_renew(struct iovec, *iov, niov + elem->out_num - idx);
+    for (; idx < elem->out_num; idx++) {
+        if (elem->out_sg[idx].iov_len > offset) {
+            (*iov)[niov].iov_base = elem->out_sg[idx].iov_base + offset;
+            (*iov)[niov].iov_len = elem->out_sg[idx].iov_len - offset;
+            niov++;
+        }
+        offset = 0;
+    }
+    return niov;
+}
+
+/* Skip @len bytes of the partially consumed port->elem */
+static void flush_advance(VirtIOSerialPort *port, size_t len)
+{
+    while (len) {
+        size_t avail = port->elem->out_sg[port->iov_idx].iov_len -
+                       port->iov_offset;
+
+        if (len < avail) {
+            port->iov_offset += len;
+            return;
+        }
+        len -= avail;
+        port->iov_idx++;
+        port->iov_offset = 0;
+    }
+}
+
+/*
+ * Flush the queued data of several buffers with a single have_data_iov
+ * call, so that the backend can write it with a single syscall.
+ */
+static void do_flush_queued_data_iov(VirtIOSerialPort *port, VirtQueue *vq,
+                                     VirtIODevice *vdev)
+{
+    VirtIOSerialPortClass *vsc = VIRTIO_SERIAL_PORT_GET_CLASS(port);
+    VirtQueueElement *elems[VIRTIO_SERIAL_FLUSH_BATCH];
+    g_autofree struct iovec *iov = NULL;
+
+    while (!port->throttled) {
+        unsigned int nelems = 0, niov, i;
+        size_t done;
+
+        /* Pop an elem only if we haven't left off a previous one mid-way */
+        if (!port->elem) {
+            port->elem = virtqueue_pop(vq, sizeof(VirtQueueElement));
+            if (!port->elem) {
+                break;
+            }
+            port->iov_idx = 0;
+            port->iov_offset = 0;
+        }
+        elems[nelems++] = port->elem;
+        niov = flush_add_iov(&iov, 0, port->elem, port->iov_idx,
+                             port->iov_offset);
+        while (nelems < VIRTIO_SERIAL_FLUSH_BATCH) {
+            VirtQueueElement *elem = virtqueue_pop(vq,
+                                                   sizeof(VirtQueueElement));
+            if (!elem) {
+                break;
+            }
+            elems[nelems++] = elem;
+            niov = flush_add_iov(&iov, niov, elem, 0, 0);
+        }
+
+        done = MAX(vsc->have_data_iov(port, iov, niov), 0);
+        if (!port->elem) {
+            /* We got disconnected; drop the other buffers like port->elem */
+            for (i = 1; i < nelems; i++) {
+                virtqueue_detach_element(vq, elems[i], 0);
+                g_free(elems[i]);
+            }
+            return;
+        }
+
+        port->elem = NULL;
+        for (i = 0; i < nelems; i++) {
+            size_t len;
+
+            if (!port->throttled) {
+                /* All data was consumed */
+                virtqueue_push(vq, elems[i], 0);
+                g_free(elems[i]);
+                continue;
+            }
+
+            if (i > 0) {
+                port->iov_idx = 0;
+                port->iov_offset = 0;
+            }
+            len = iov_size(elems[i]->out_sg + port->iov_idx,
+                           elems[i]->out_num - port->iov_idx) -
+                  port->iov_offset;
+            if (done >= len) {
+                done -= len;
+                virtqueue_push(vq, elems[i], 0);
+                g_free(elems[i]);
+                continue;
+            }
+
+            /* Resume from this buffer when unthrottled */
+            port->elem = elems[i];
+            flush_advance(port, done);
+            while (--nelems > i) {
+                virtqueue_unpop(vq, elems[nelems], 0);
+                g_free(elems[nelems]);
+            }
+            break;
+        }
+    }
+    virtio_notify(vdev, vq);
+}
+
 static void do_flush_queued_data(VirtIOSerialPort *port, VirtQueue *vq,
                                  VirtIODevice *vdev)
 {
@@ -166,6 +288,10 @@ static void do_flush_queued_data(VirtIOSerialPort *port, VirtQueue *vq,
     assert(virtio_queue_ready(vq));
 
     vsc = VIRTIO_SERIAL_PORT_GET_CLASS(port);
+    if (vsc->have_data_iov) {
+        do_flush_queued_data_iov(port, vq, vdev);
+        return;
+    }
 
     while (!port->throttled) {
         unsigned int i;
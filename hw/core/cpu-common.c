@@ -319,9 +319,8 @@ static void cpu_common_initfn(Object *obj)
     cpu->halt_cond = g_new0(QemuCond, 1);
     qemu_cond_init(cpu->halt_cond);
 
-    qemu_mutex_init(&cpu->work_mutex);
     qemu_lockcnt_init(&cpu->in_ioctl_lock);
-    QSIMPLEQ_INIT(&cpu->work_list);
+    QSLIST_INIT(&cpu->work_list);
     QTAILQ_INIT(&cpu->breakpoints);
     QTAILQ_INIT(&cpu->watchpoints);
 
@@ -355,7 +354,6 @@ static void cpu_common_finalize(Object *obj)
         g_array_free(cpu->gdb_regs, TRUE);
     }
     qemu_lockcnt_destroy(&cpu->in_ioctl_lock);
-    qemu_mutex_destroy(&cpu->work_mutex);
     qemu_cond_destroy(cpu->halt_cond);
     g_free(cpu->halt_cond);
     g_free(cpu->thread);
@@ -136,6 +136,11 @@ void hmp_info_memdev(Monitor *mon, const QDict *qdict)
                        HostMemPolicy_str(m->value->policy));
         visit_complete(v, &str);
         monitor_printf(mon, "  host nodes: %s\n", str);
+        for (MemdevNodeUsageList *u = m->value->host_node_usage; u;
+             u = u->next) {
+            monitor_printf(mon, "  host node %" PRIu16 " resident: %" PRIu64
+                           "\n", u->value->node, u->value->size);
+        }
 
         g_free(str);
         visit_free(v);
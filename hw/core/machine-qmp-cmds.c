@@ -194,6 +194,30 @@ void qmp_set_numa_node(NumaOptions *cmd, Error **errp)
     set_numa_options(MACHINE(qdev_get_machine()), cmd, errp);
 }
 
+static void query_memdev_node_usage(HostMemoryBackend *backend, Memdev *m)
+{
+    g_autofree uint64_t *node_bytes = g_new(uint64_t, MAX_NODES + 1);
+    MemdevNodeUsageList **tail = &m->host_node_usage;
+    int node;
+
+    if (!host_memory_backend_mr_inited(backend) ||
+        !host_memory_backend_get_node_usage(backend, node_bytes, NULL)) {
+        return;
+    }
+
+    for (node = 0; node <= MAX_NODES; node++) {
+        MemdevNodeUsage *usage;
+
+        if (!node_bytes[node]) {
+            continue;
+        }
+        usage = g_new0(MemdevNodeUsage, 1);
+        usage->node = node;
+        usage->size = node_bytes[node];
+        QAPI_LIST_APPEND(tail, usage);
+    }
+}
+
 static int query_memdev(Object *obj, void *opaque)
 {
     Error *err = NULL;
@@ -227,6 +251,7 @@ static int query_memdev(Object *obj, void *opaque)
         visit_type_uint16List(v, NULL, &m->host_nodes, &error_abort);
         visit_free(v);
         qobject_unref(host_nodes);
+        query_memdev_node_usage(MEMORY_BACKEND(obj), m);
 
         QAPI_LIST_PREPEND(*list, m);
     }
@@ -32,6 +32,7 @@
 #include "qapi/visitor.h"
 #include "qemu/error-report.h"
 #include "qemu/option.h"
+#include "qemu/timer.h"
 #include "hw/irq.h"
 #include "hw/qdev-properties.h"
 #include "hw/boards.h"
@@ -520,10 +521,20 @@ static void device_set_realized(Object *obj, bool value, Error **errp)
         }
 
         if (dc->realize) {
+            int64_t start = 0;
+
+            if (trace_event_get_state_backends(TRACE_QDEV_REALIZE)) {
+                start = get_clock();
+            }
             dc->realize(dev, &local_err);
             if (local_err != NULL) {
                 goto fail;
             }
+            if (start) {
+                trace_qdev_realize(dev, object_get_typename(obj),
+                                   dev->id ?: "",
+                                   (get_clock() - start) / SCALE_US);
+            }
         }
 
         DEVICE_LISTENER_CALL(realize, Forward, dev);
@@ -882,10 +893,24 @@ bool phase_check(MachineInitPhase phase)
     return machine_phase >= phase;
 }
 
+/* Startup timing reference for the machine_phase_advance trace point */
+static int64_t startup_ns, phase_ns;
+
+static void __attribute__((__constructor__)) phase_timing_init(void)
+{
+    startup_ns = phase_ns = get_clock();
+}
+
 void phase_advance(MachineInitPhase phase)
 {
+    int64_t now = get_clock();
+
     assert(machine_phase == phase - 1);
     machine_phase = phase;
+
+    trace_machine_phase_advance(phase, (now - phase_ns) / SCALE_US,
+                                (now - startup_ns) / SCALE_US);
+    phase_ns = now;
 }
 
 static const TypeInfo device_type_info = {
@@ -22,6 +22,22 @@
  * THE SOFTWARE.
  */
 
+/*
+ * Return a direct pointer to the @len bytes of video memory at @addr,
+ * or NULL if they wrap around its end.  Scanline converters use it to
+ * avoid masking every access when the whole line is contiguous.
+ */
+static inline const uint8_t *vga_line_ptr(VGACommonState *vga,
+                                          uint32_t addr, uint32_t len)
+{
+    uint32_t offset = addr & vga->vbe_size_mask;
+
+    if (len > vga->vbe_size_mask + 1 - offset) {
+        return NULL;
+    }
+    return vga->vram_ptr + offset;
+}
+
 static inline uint8_t vga_read_byte(VGACommonState *vga, uint32_t addr)
 {
     return vga->vram_ptr[addr & vga->vbe_size_mask];
@@ -303,6 +303,7 @@ static void *vga_draw_line8(VGACommonState *vga, uint8_t *d,
                             uint32_t addr, int width, int hpel)
 {
     uint32_t *palette;
+    const uint8_t *s;
     int x;
 
     palette = vga->last_palette;
@@ -311,6 +312,14 @@ static void *vga_draw_line8(VGACommonState *vga, uint8_t *d,
         width += 8;
         d = vga->panning_buf;
     }
+    width &= ~7;
+    s = vga_line_ptr(vga, addr, width);
+    if (s) {
+        for (x = 0; x < width; x++) {
+            ((uint32_t *)d)[x] = palette[s[x]];
+        }
+        return hpel ? vga->panning_buf + 4 * hpel : NULL;
+    }
     width >>= 3;
     for(x = 0; x < width; x++) {
         ((uint32_t *)d)[0] = palette[vga_read_byte(vga, addr + 0)];
@@ -333,9 +342,21 @@ static void *vga_draw_line8(VGACommonState *vga, uint8_t *d,
 static void *vga_draw_line15_le(VGACommonState *vga, uint8_t *d,
                                 uint32_t addr, int width, int hpel)
 {
+    const uint8_t *s = vga_line_ptr(vga, addr, width * 2);
     int w;
     uint32_t v, r, g, b;
 
+    if (s && !(addr & 1)) {
+        for (w = 0; w < width; w++) {
+            v = lduw_le_p(s + w * 2);
+            r = (v >> 7) & 0xf8;
+            g = (v >> 2) & 0xf8;
+            b = (v << 3) & 0xf8;
+            ((uint32_t *)d)[w] = rgb_to_pixel32(r, g, b);
+        }
+        return NULL;
+    }
+
     w = width;
     do {
         v = vga_read_word_le(vga, addr);
@@ -352,9 +373,21 @@ static void *vga_draw_line15_le(VGACommonState *vga, uint8_t *d,
 static void *vga_draw_line15_be(VGACommonState *vga, uint8_t *d,
                                 uint32_t addr, int width, int hpel)
 {
+    const uint8_t *s = vga_line_ptr(vga, addr, width * 2);
     int w;
     uint32_t v, r, g, b;
 
+    if (s && !(addr & 1)) {
+        for (w = 0; w < width; w++) {
+            v = lduw_be_p(s + w * 2);
+            r = (v >> 7) & 0xf8;
+            g = (v >> 2) & 0xf8;
+            b = (v << 3) & 0xf8;
+            ((uint32_t *)d)[w] = rgb_to_pixel32(r, g, b);
+        }
+        return NULL;
+    }
+
     w = width;
     do {
         v = vga_read_word_be(vga, addr);
@@ -374,9 +407,21 @@ static void *vga_draw_line15_be(VGACommonState *vga, uint8_t *d,
 static void *vga_draw_line16_le(VGACommonState *vga, uint8_t *d,
                                 uint32_t addr, int width, int hpel)
 {
+    const uint8_t *s = vga_line_ptr(vga, addr, width * 2);
     int w;
     uint32_t v, r, g, b;
 
+    if (s && !(addr & 1)) {
+        for (w = 0; w < width; w++) {
+            v = lduw_le_p(s + w * 2);
+            r = (v >> 8) & 0xf8;
+            g = (v >> 3) & 0xfc;
+            b = (v << 3) & 0xf8;
+            ((uint32_t *)d)[w] = rgb_to_pixel32(r, g, b);
+        }
+        return NULL;
+    }
+
     w = width;
     do {
         v = vga_read_word_le(vga, addr);
@@ -393,9 +438,21 @@ static void *vga_draw_line16_le(VGACommonState *vga, uint8_t *d,
 static void *vga_draw_line16_be(VGACommonState *vga, uint8_t *d,
                                 uint32_t addr, int width, int hpel)
 {
+    const uint8_t *s = vga_line_ptr(vga, addr, width * 2);
     int w;
     uint32_t v, r, g, b;
 
+    if (s && !(addr & 1)) {
+        for (w = 0; w < width; w++) {
+            v = lduw_be_p(s + w * 2);
+            r = (v >> 8) & 0xf8;
+            g = (v >> 3) & 0xfc;
+            b = (v << 3) & 0xf8;
+            ((uint32_t *)d)[w] = rgb_to_pixel32(r, g, b);
+        }
+        return NULL;
+    }
+
     w = width;
     do {
         v = vga_read_word_be(vga, addr);
@@ -415,9 +472,17 @@ static void *vga_draw_line16_be(VGACommonState *vga, uint8_t *d,
 static void *vga_draw_line24_le(VGACommonState *vga, uint8_t *d,
                                 uint32_t addr, int width, int hpel)
 {
+    const uint8_t *s = vga_line_ptr(vga, addr, width * 3);
     int w;
     uint32_t r, g, b;
 
+    if (s) {
+        for (w = 0; w < width; w++, s += 3) {
+            ((uint32_t *)d)[w] = rgb_to_pixel32(s[2], s[1], s[0]);
+        }
+        return NULL;
+    }
+
     w = width;
     do {
         b = vga_read_byte(vga, addr + 0);
@@ -433,9 +498,17 @@ static void *vga_draw_line24_le(VGACommonState *vga, uint8_t *d,
 static void *vga_draw_line24_be(VGACommonState *vga, uint8_t *d,
                                 uint32_t addr, int width, int hpel)
 {
+    const uint8_t *s = vga_line_ptr(vga, addr, width * 3);
     int w;
     uint32_t r, g, b;
 
+    if (s) {
+        for (w = 0; w < width; w++, s += 3) {
+            ((uint32_t *)d)[w] = rgb_to_pixel32(s[0], s[1], s[2]);
+        }
+        return NULL;
+    }
+
     w = width;
     do {
         r = vga_read_byte(vga, addr + 0);
@@ -454,9 +527,17 @@ static void *vga_draw_line24_be(VGACommonState *vga, uint8_t *d,
 static void *vga_draw_line32_le(VGACommonState *vga, uint8_t *d,
                                 uint32_t addr, int width, int hpel)
 {
+    const uint8_t *s = vga_line_ptr(vga, addr, width * 4);
     int w;
     uint32_t r, g, b;
 
+    if (s) {
+        for (w = 0; w < width; w++, s += 4) {
+            ((uint32_t *)d)[w] = rgb_to_pixel32(s[2], s[1], s[0]);
+        }
+        return NULL;
+    }
+
     w = width;
     do {
         b = vga_read_byte(vga, addr + 0);
@@ -472,9 +553,17 @@ static void *vga_draw_line32_le(VGACommonState *vga, uint8_t *d,
 static void *vga_draw_line32_be(VGACommonState *vga, uint8_t *d,
                                 uint32_t addr, int width, int hpel)
 {
+    const uint8_t *s = vga_line_ptr(vga, addr, width * 4);
     int w;
     uint32_t r, g, b;
 
+    if (s) {
+        for (w = 0; w < width; w++, s += 4) {
+            ((uint32_t *)d)[w] = rgb_to_pixel32(s[1], s[2], s[3]);
+        }
+        return NULL;
+    }
+
     w = width;
     do {
         r = vga_read_byte(vga, addr + 1);
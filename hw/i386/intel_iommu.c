@@ -87,12 +87,23 @@ struct vtd_iotlb_key {
 static void vtd_address_space_refresh_all(IntelIOMMUState *s);
 static void vtd_address_space_unmap(VTDAddressSpace *as, IOMMUNotifier *n);
 
+/*
+ * Drop the lockless translation cache of all address spaces.  Must be
+ * called whenever the IOTLB, the context cache or the PASID cache lose
+ * entries.  Must be called with IOMMU lock held.
+ */
+static void vtd_iotlb_cache_flush(IntelIOMMUState *s)
+{
+    qatomic_inc(&s->iotlb_gen);
+}
+
 static void vtd_pasid_cache_reset_locked(IntelIOMMUState *s)
 {
     VTDAddressSpace *vtd_as;
     GHashTableIter as_it;
 
     trace_vtd_pasid_cache_reset();
+    vtd_iotlb_cache_flush(s);
 
     g_hash_table_iter_init(&as_it, s->vtd_address_spaces);
     while (g_hash_table_iter_next(&as_it, NULL, (void **)&vtd_as)) {
@@ -374,6 +385,7 @@ static void vtd_reset_context_cache_locked(IntelIOMMUState *s)
         vtd_as->context_cache_entry.context_cache_gen = 0;
     }
     s->context_cache_gen = 1;
+    vtd_iotlb_cache_flush(s);
 }
 
 /* Must be called with IOMMU lock held. */
@@ -381,6 +393,7 @@ static void vtd_reset_iotlb_locked(IntelIOMMUState *s)
 {
     assert(s->iotlb);
     g_hash_table_remove_all(s->iotlb);
+    vtd_iotlb_cache_flush(s);
 }
 
 static void vtd_reset_iotlb(IntelIOMMUState *s)
@@ -427,6 +440,51 @@ out:
     return entry;
 }
 
+/*
+ * Look up the last translation of @vtd_as, without taking the IOMMU lock.
+ * Returns true and fills @entry if it covers @addr and no cache has been
+ * invalidated since it was recorded.
+ */
+static bool vtd_iotlb_cache_lookup(VTDAddressSpace *vtd_as, hwaddr addr,
+                                   bool is_write, IOMMUTLBEntry *entry)
+{
+    IntelIOMMUState *s = vtd_as->iommu_state;
+    VTDIOTLBCache *cache;
+
+    RCU_READ_LOCK_GUARD();
+    cache = qatomic_rcu_read(&vtd_as->iotlb_cache);
+    if (!cache || cache->gen != qatomic_read(&s->iotlb_gen) ||
+        (addr & ~cache->addr_mask) != cache->iova) {
+        return false;
+    }
+
+    entry->iova = cache->iova;
+    entry->translated_addr = cache->translated_addr;
+    entry->addr_mask = cache->addr_mask;
+    entry->perm = is_write ? cache->access_flags :
+                             (cache->access_flags & ~IOMMU_WO);
+    return true;
+}
+
+/* Must be called with IOMMU lock held */
+static void vtd_iotlb_cache_update(VTDAddressSpace *vtd_as,
+                                   IOMMUTLBEntry *entry, uint8_t access_flags)
+{
+    VTDIOTLBCache *old = vtd_as->iotlb_cache;
+    VTDIOTLBCache *cache = g_new(VTDIOTLBCache, 1);
+
+    cache->gen = vtd_as->iommu_state->iotlb_gen;
+    cache->iova = entry->iova;
+    cache->translated_addr = entry->translated_addr;
+    cache->addr_mask = entry->addr_mask;
+    cache->access_flags = access_flags;
+
+    qatomic_rcu_set(&vtd_as->iotlb_cache, cache);
+    if (old) {
+        g_free_rcu(old, rcu);
+    }
+}
+
 /* Must be with IOMMU lock held */
 static void vtd_update_iotlb(IntelIOMMUState *s, uint16_t source_id,
                              uint16_t domain_id, hwaddr addr, uint64_t pte,
@@ -2120,6 +2178,10 @@ static bool vtd_do_iommu_translate(VTDAddressSpace *vtd_as, PCIBus *bus,
      */
     assert(!vtd_is_interrupt_addr(addr));
 
+    if (vtd_iotlb_cache_lookup(vtd_as, addr, is_write, entry)) {
+        return true;
+    }
+
     vtd_iommu_lock(s);
 
     cc_entry = &vtd_as->context_cache_entry;
@@ -2258,11 +2320,12 @@ static bool vtd_do_iommu_translate(VTDAddressSpace *vtd_as, PCIBus *bus,
     vtd_update_iotlb(s, source_id, vtd_get_domain_id(s, &ce, pasid),
                      addr, pte, access_flags, level, pasid, pgtt);
 out:
-    vtd_iommu_unlock(s);
     entry->iova = addr & page_mask;
     entry->translated_addr = vtd_get_pte_addr(pte, s->aw_bits) & page_mask;
     entry->addr_mask = ~page_mask;
     entry->perm = (is_write ? access_flags : (access_flags & (~IOMMU_WO)));
+    vtd_iotlb_cache_update(vtd_as, entry, access_flags);
+    vtd_iommu_unlock(s);
     return true;
 
 error:
@@ -2327,6 +2390,7 @@ static void vtd_context_global_invalidate(IntelIOMMUState *s)
     if (s->context_cache_gen == VTD_CONTEXT_CACHE_GEN_MAX) {
         vtd_reset_context_cache_locked(s);
     }
+    vtd_iotlb_cache_flush(s);
     vtd_iommu_unlock(s);
     vtd_address_space_refresh_all(s);
     /*
@@ -2382,6 +2446,7 @@ static void vtd_context_device_invalidate(IntelIOMMUState *s,
                                          VTD_PCI_FUNC(vtd_as->devfn));
             vtd_iommu_lock(s);
             vtd_as->context_cache_entry.context_cache_gen = 0;
+            vtd_iotlb_cache_flush(s);
             vtd_iommu_unlock(s);
             /*
              * Do switch address space when needed, in case if the
@@ -2448,6 +2513,7 @@ static void vtd_iotlb_domain_invalidate(IntelIOMMUState *s, uint16_t domain_id)
     vtd_iommu_lock(s);
     g_hash_table_foreach_remove(s->iotlb, vtd_hash_remove_by_domain,
                                 &domain_id);
+    vtd_iotlb_cache_flush(s);
     vtd_iommu_unlock(s);
 
     QLIST_FOREACH(vtd_as, &s->vtd_as_with_notifiers, next) {
@@ -2541,6 +2607,7 @@ static void vtd_iotlb_page_invalidate(IntelIOMMUState *s, uint16_t domain_id,
     info.mask = ~((1 << am) - 1);
     vtd_iommu_lock(s);
     g_hash_table_foreach_remove(s->iotlb, vtd_hash_remove_by_page, &info);
+    vtd_iotlb_cache_flush(s);
     vtd_iommu_unlock(s);
     vtd_iotlb_page_invalidate_notify(s, domain_id, addr, am, PCI_NO_PASID);
 }
@@ -2778,26 +2845,44 @@ static void vtd_handle_iotlb_write(IntelIOMMUState *s)
 }
 
 /* Fetch an Invalidation Descriptor from the Invalidation Queue */
-static bool vtd_get_inv_desc(IntelIOMMUState *s,
-                             VTDInvDesc *inv_desc)
+/*
+ * Read up to @max descriptors starting at the queue head, stopping at the
+ * tail or at the end of the queue.  Software may not modify descriptors
+ * between head and tail, so they can be read ahead of processing.
+ *
+ * Returns the number of descriptors read, or 0 on error.
+ */
+static int vtd_get_inv_descs(IntelIOMMUState *s, VTDInvDesc *inv_desc,
+                             int max)
 {
-    dma_addr_t base_addr = s->iq;
-    uint32_t offset = s->iq_head;
+    uint64_t buf[VTD_INV_DESC_BATCH * 4];
     uint32_t dw = s->iq_dw ? 32 : 16;
-    dma_addr_t addr = base_addr + offset * dw;
+    dma_addr_t addr = s->iq + s->iq_head * dw;
+    uint32_t end = s->iq_tail > s->iq_head ? s->iq_tail : s->iq_size;
+    int n = MIN(max, end - s->iq_head);
+    int i;
 
+    assert(n <= VTD_INV_DESC_BATCH);
     if (dma_memory_read(&address_space_memory, addr,
-                        inv_desc, dw, MEMTXATTRS_UNSPECIFIED)) {
+                        buf, n * dw, MEMTXATTRS_UNSPECIFIED)) {
         error_report_once("Read INV DESC failed.");
-        return false;
+        return 0;
     }
-    inv_desc->lo = le64_to_cpu(inv_desc->lo);
-    inv_desc->hi = le64_to_cpu(inv_desc->hi);
-    if (dw == 32) {
-        inv_desc->val[2] = le64_to_cpu(inv_desc->val[2]);
-        inv_desc->val[3] = le64_to_cpu(inv_desc->val[3]);
+    for (i = 0; i < n; i++) {
+        uint64_t *val = &buf[i * (dw / 8)];
+
+        inv_desc[i].lo = le64_to_cpu(val[0]);
+        inv_desc[i].hi = le64_to_cpu(val[1]);
+        if (dw == 32) {
+            inv_desc[i].val[2] = le64_to_cpu(val[2]);
+            inv_desc[i].val[3] = le64_to_cpu(val[3]);
+        } else {
+            inv_desc[i].val[2] = 0;
+            inv_desc[i].val[3] = 0;
+        }
     }
-    return true;
+    trace_vtd_inv_qi_batch(s->iq_head, n);
+    return n;
 }
 
 static bool vtd_inv_desc_reserved_check(IntelIOMMUState *s,
@@ -2989,6 +3074,7 @@ static void vtd_piotlb_pasid_invalidate(IntelIOMMUState *s,
     vtd_iommu_lock(s);
     g_hash_table_foreach_remove(s->iotlb, vtd_hash_remove_by_pasid,
                                 &info);
+    vtd_iotlb_cache_flush(s);
     vtd_iommu_unlock(s);
 
     QLIST_FOREACH(vtd_as, &s->vtd_as_with_notifiers, next) {
@@ -3022,6 +3108,7 @@ static void vtd_piotlb_page_invalidate(IntelIOMMUState *s, uint16_t domain_id,
     vtd_iommu_lock(s);
     g_hash_table_foreach_remove(s->iotlb,
                                 vtd_hash_remove_by_page_piotlb, &info);
+    vtd_iotlb_cache_flush(s);
     vtd_iommu_unlock(s);
 
     vtd_iotlb_page_invalidate_notify(s, domain_id, addr, am, pasid);
@@ -3166,6 +3253,7 @@ static void vtd_pasid_cache_sync(IntelIOMMUState *s, VTDPASIDCacheInfo *pc_info)
     vtd_iommu_lock(s);
     g_hash_table_foreach(s->vtd_address_spaces, vtd_pasid_cache_sync_locked,
                          pc_info);
+    vtd_iotlb_cache_flush(s);
     vtd_iommu_unlock(s);
 }
 
@@ -3400,89 +3488,84 @@ done:
     return true;
 }
 
-static bool vtd_process_inv_desc(IntelIOMMUState *s)
+static bool vtd_process_inv_desc(IntelIOMMUState *s, VTDInvDesc *inv_desc)
 {
-    VTDInvDesc inv_desc;
     uint8_t desc_type;
 
     trace_vtd_inv_qi_head(s->iq_head);
-    if (!vtd_get_inv_desc(s, &inv_desc)) {
-        s->iq_last_desc_type = VTD_INV_DESC_NONE;
-        return false;
-    }
 
-    desc_type = VTD_INV_DESC_TYPE(inv_desc.lo);
+    desc_type = VTD_INV_DESC_TYPE(inv_desc->lo);
     /* FIXME: should update at first or at last? */
     s->iq_last_desc_type = desc_type;
 
     switch (desc_type) {
     case VTD_INV_DESC_CC:
-        trace_vtd_inv_desc("context-cache", inv_desc.hi, inv_desc.lo);
-        if (!vtd_process_context_cache_desc(s, &inv_desc)) {
+        trace_vtd_inv_desc("context-cache", inv_desc->hi, inv_desc->lo);
+        if (!vtd_process_context_cache_desc(s, inv_desc)) {
             return false;
         }
         break;
 
     case VTD_INV_DESC_IOTLB:
-        trace_vtd_inv_desc("iotlb", inv_desc.hi, inv_desc.lo);
-        if (!vtd_process_iotlb_desc(s, &inv_desc)) {
+        trace_vtd_inv_desc("iotlb", inv_desc->hi, inv_desc->lo);
+        if (!vtd_process_iotlb_desc(s, inv_desc)) {
             return false;
         }
         break;
 
     case VTD_INV_DESC_PC:
-        trace_vtd_inv_desc("pasid-cache", inv_desc.val[1], inv_desc.val[0]);
-        if (!vtd_process_pasid_desc(s, &inv_desc)) {
+        trace_vtd_inv_desc("pasid-cache", inv_desc->val[1], inv_desc->val[0]);
+        if (!vtd_process_pasid_desc(s, inv_desc)) {
             return false;
         }
         break;
 
     case VTD_INV_DESC_PIOTLB:
-        trace_vtd_inv_desc("p-iotlb", inv_desc.val[1], inv_desc.val[0]);
-        if (!vtd_process_piotlb_desc(s, &inv_desc)) {
+        trace_vtd_inv_desc("p-iotlb", inv_desc->val[1], inv_desc->val[0]);
+        if (!vtd_process_piotlb_desc(s, inv_desc)) {
             return false;
         }
         break;
 
     case VTD_INV_DESC_WAIT:
-        trace_vtd_inv_desc("wait", inv_desc.hi, inv_desc.lo);
-        if (!vtd_process_wait_desc(s, &inv_desc)) {
+        trace_vtd_inv_desc("wait", inv_desc->hi, inv_desc->lo);
+        if (!vtd_process_wait_desc(s, inv_desc)) {
             return false;
         }
         break;
 
     case VTD_INV_DESC_IEC:
-        trace_vtd_inv_desc("iec", inv_desc.hi, inv_desc.lo);
-        if (!vtd_process_inv_iec_desc(s, &inv_desc)) {
+        trace_vtd_inv_desc("iec", inv_desc->hi, inv_desc->lo);
+        if (!vtd_process_inv_iec_desc(s, inv_desc)) {
             return false;
         }
         break;
 
     case VTD_INV_DESC_DEV_PIOTLB:
-        trace_vtd_inv_desc("device-piotlb", inv_desc.hi, inv_desc.lo);
-        if (!vtd_process_device_piotlb_desc(s, &inv_desc)) {
+        trace_vtd_inv_desc("device-piotlb", inv_desc->hi, inv_desc->lo);
+        if (!vtd_process_device_piotlb_desc(s, inv_desc)) {
             return false;
         }
         break;
 
     case VTD_INV_DESC_DEVICE:
-        trace_vtd_inv_desc("device", inv_desc.hi, inv_desc.lo);
-        if (!vtd_process_device_iotlb_desc(s, &inv_desc)) {
+        trace_vtd_inv_desc("device", inv_desc->hi, inv_desc->lo);
+        if (!vtd_process_device_iotlb_desc(s, inv_desc)) {
             return false;
         }
         break;
 
     case VTD_INV_DESC_PGRESP:
-        trace_vtd_inv_desc("page group response", inv_desc.hi, inv_desc.lo);
-        if (!vtd_process_page_group_response_desc(s, &inv_desc)) {
+        trace_vtd_inv_desc("page group response", inv_desc->hi, inv_desc->lo);
+        if (!vtd_process_page_group_response_desc(s, inv_desc)) {
             return false;
         }
         break;
 
     default:
         error_report_once("%s: invalid inv desc: hi=%"PRIx64", lo=%"PRIx64
-                          " (unknown type)", __func__, inv_desc.hi,
-                          inv_desc.lo);
+                          " (unknown type)", __func__, inv_desc->hi,
+                          inv_desc->lo);
         return false;
     }
     s->iq_head++;
@@ -3495,7 +3578,9 @@ static bool vtd_process_inv_desc(IntelIOMMUState *s)
 /* Try to fetch and process more Invalidation Descriptors */
 static void vtd_fetch_inv_desc(IntelIOMMUState *s)
 {
+    VTDInvDesc inv_desc[VTD_INV_DESC_BATCH];
     int qi_shift;
+    int i, n;
 
     /* Refer to 10.4.23 of VT-d spec 3.0 */
     qi_shift = s->iq_dw ? VTD_IQH_QH_SHIFT_5 : VTD_IQH_QH_SHIFT_4;
@@ -3511,15 +3596,23 @@ static void vtd_fetch_inv_desc(IntelIOMMUState *s)
         return;
     }
     while (s->iq_head != s->iq_tail) {
-        if (!vtd_process_inv_desc(s)) {
-            /* Invalidation Queue Errors */
+        n = vtd_get_inv_descs(s, inv_desc, ARRAY_SIZE(inv_desc));
+        if (!n) {
+            s->iq_last_desc_type = VTD_INV_DESC_NONE;
             vtd_handle_inv_queue_error(s);
-            break;
+            return;
+        }
+        for (i = 0; i < n; i++) {
+            if (!vtd_process_inv_desc(s, &inv_desc[i])) {
+                /* Invalidation Queue Errors */
+                vtd_handle_inv_queue_error(s);
+                return;
+            }
+            /* Must update the IQH_REG in time */
+            vtd_set_quad_raw(s, DMAR_IQH_REG,
+                             (((uint64_t)(s->iq_head)) << qi_shift) &
+                             VTD_IQH_QH_MASK);
         }
-        /* Must update the IQH_REG in time */
-        vtd_set_quad_raw(s, DMAR_IQH_REG,
-                         (((uint64_t)(s->iq_head)) << qi_shift) &
-                         VTD_IQH_QH_MASK);
     }
 }
 
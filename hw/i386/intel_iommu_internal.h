@@ -410,6 +410,9 @@ typedef union VTDPRDesc VTDPRDesc;
 #define VTD_INV_DESC_PGRESP             0x9 /* Page Group Response Desc */
 #define VTD_INV_DESC_NONE               0   /* Not an Invalidate Descriptor */
 
+/* Number of descriptors read from the invalidation queue at once */
+#define VTD_INV_DESC_BATCH              16
+
 /* Masks for Invalidation Wait Descriptor*/
 #define VTD_INV_DESC_WAIT_SW            (1ULL << 5)
 #define VTD_INV_DESC_WAIT_IF            (1ULL << 4)
@@ -32,6 +32,7 @@
 #include "qemu/error-report.h"
 #include "qemu/event_notifier.h"
 #include "qemu/module.h"
+#include "qemu/timer.h"
 #include "qom/object_interfaces.h"
 #include "chardev/char-fe.h"
 #include "system/hostmem.h"
@@ -83,6 +84,10 @@ typedef struct MSIVector {
     PCIDevice *pdev;
     int virq;
     bool unmasked;
+    /* interrupt moderation, see irq-moderation-us */
+    QEMUTimer *mod_timer;
+    int64_t mod_last_ns;        /* when the last interrupt was sent */
+    bool mod_pending;           /* an interrupt is held until the timer */
 } MSIVector;
 
 struct IVShmemState {
@@ -110,6 +115,7 @@ struct IVShmemState {
     Peer *peers;
     int nb_peers;               /* space in @peers[] */
     uint32_t vectors;
+    uint32_t irq_moderation_us;
     MSIVector *msi_vectors;
     uint64_t msg_buf;           /* buffer for receiving server messages */
     int msg_buffered_bytes;     /* #bytes in @msg_buf */
@@ -250,6 +256,41 @@ static const MemoryRegionOps ivshmem_mmio_ops = {
     },
 };
 
+/*
+ * irqfd bypasses QEMU on the interrupt path, so it cannot be used
+ * together with interrupt moderation.
+ */
+static bool ivshmem_use_irqfd(IVShmemState *s)
+{
+    return kvm_msi_via_irqfd_enabled() && !s->irq_moderation_us;
+}
+
+static void ivshmem_vector_deliver(IVShmemState *s, int vector)
+{
+    PCIDevice *pdev = PCI_DEVICE(s);
+
+    IVSHMEM_DPRINTF("interrupt on vector %p %d\n", pdev, vector);
+    if (ivshmem_has_feature(s, IVSHMEM_MSI)) {
+        if (msix_enabled(pdev)) {
+            msix_notify(pdev, vector);
+        }
+    } else {
+        ivshmem_IntrStatus_write(s, 1);
+    }
+}
+
+static void ivshmem_vector_mod_timer(void *opaque)
+{
+    MSIVector *entry = opaque;
+    IVShmemState *s = IVSHMEM_COMMON(entry->pdev);
+
+    if (entry->mod_pending) {
+        entry->mod_pending = false;
+        entry->mod_last_ns = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+        ivshmem_vector_deliver(s, entry - s->msi_vectors);
+    }
+}
+
 static void ivshmem_vector_notify(void *opaque)
 {
     MSIVector *entry = opaque;
@@ -257,19 +298,32 @@ static void ivshmem_vector_notify(void *opaque)
     IVShmemState *s = IVSHMEM_COMMON(pdev);
     int vector = entry - s->msi_vectors;
     EventNotifier *n = &s->peers[s->vm_id].eventfds[vector];
+    int64_t now;
 
     if (!event_notifier_test_and_clear(n)) {
         return;
     }
 
-    IVSHMEM_DPRINTF("interrupt on vector %p %d\n", pdev, vector);
-    if (ivshmem_has_feature(s, IVSHMEM_MSI)) {
-        if (msix_enabled(pdev)) {
-            msix_notify(pdev, vector);
+    if (s->irq_moderation_us) {
+        /*
+         * At most one interrupt per vector and window: doorbells that
+         * arrive within the window are folded into a single interrupt
+         * at its end.
+         */
+        if (entry->mod_pending) {
+            return;
         }
-    } else {
-        ivshmem_IntrStatus_write(s, 1);
+        now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+        if (now - entry->mod_last_ns < s->irq_moderation_us * SCALE_US) {
+            entry->mod_pending = true;
+            timer_mod(entry->mod_timer,
+                      entry->mod_last_ns + s->irq_moderation_us * SCALE_US);
+            return;
+        }
+        entry->mod_last_ns = now;
     }
+
+    ivshmem_vector_deliver(s, vector);
 }
 
 static int ivshmem_vector_unmask(PCIDevice *dev, unsigned vector,
@@ -445,7 +499,7 @@ static void ivshmem_add_kvm_msi_virq(IVShmemState *s, int vector,
 static void setup_interrupt(IVShmemState *s, int vector, Error **errp)
 {
     EventNotifier *n = &s->peers[s->vm_id].eventfds[vector];
-    bool with_irqfd = kvm_msi_via_irqfd_enabled() &&
+    bool with_irqfd = ivshmem_use_irqfd(s) &&
         ivshmem_has_feature(s, IVSHMEM_MSI);
     PCIDevice *pdev = PCI_DEVICE(s);
     Error *err = NULL;
@@ -731,6 +785,17 @@ static void ivshmem_reset(DeviceState *d)
 
     ivshmem_disable_irqfd(s);
 
+    if (s->msi_vectors) {
+        int i;
+
+        for (i = 0; i < s->vectors; i++) {
+            if (s->msi_vectors[i].mod_timer) {
+                timer_del(s->msi_vectors[i].mod_timer);
+            }
+            s->msi_vectors[i].mod_pending = false;
+        }
+    }
+
     s->intrstatus = 0;
     s->intrmask = 0;
     if (ivshmem_has_feature(s, IVSHMEM_MSI)) {
@@ -740,9 +805,19 @@ static void ivshmem_reset(DeviceState *d)
 
 static int ivshmem_setup_interrupts(IVShmemState *s, Error **errp)
 {
+    int i;
+
     /* allocate QEMU callback data for receiving interrupts */
     s->msi_vectors = g_new0(MSIVector, s->vectors);
 
+    if (s->irq_moderation_us) {
+        for (i = 0; i < s->vectors; i++) {
+            s->msi_vectors[i].mod_timer =
+                timer_new_ns(QEMU_CLOCK_VIRTUAL, ivshmem_vector_mod_timer,
+                             &s->msi_vectors[i]);
+        }
+    }
+
     if (ivshmem_has_feature(s, IVSHMEM_MSI)) {
         if (msix_init_exclusive_bar(PCI_DEVICE(s), s->vectors, 1, errp)) {
             return -1;
@@ -833,7 +908,7 @@ static void ivshmem_write_config(PCIDevice *pdev, uint32_t address,
     pci_default_write_config(pdev, address, val, len);
     is_enabled = msix_enabled(pdev);
 
-    if (kvm_msi_via_irqfd_enabled()) {
+    if (ivshmem_use_irqfd(s)) {
         if (!was_enabled && is_enabled) {
             ivshmem_enable_irqfd(s);
         } else if (was_enabled && !is_enabled) {
@@ -966,6 +1041,11 @@ static void ivshmem_exit(PCIDevice *dev)
         msix_uninit_exclusive_bar(dev);
     }
 
+    if (s->msi_vectors) {
+        for (i = 0; i < s->vectors; i++) {
+            timer_free(s->msi_vectors[i].mod_timer);
+        }
+    }
     g_free(s->msi_vectors);
 }
 
@@ -984,10 +1064,25 @@ static int ivshmem_pre_load(void *opaque)
 static int ivshmem_post_load(void *opaque, int version_id)
 {
     IVShmemState *s = opaque;
+    int i;
 
     if (ivshmem_has_feature(s, IVSHMEM_MSI)) {
         ivshmem_msix_vector_use(s);
     }
+
+    /*
+     * A held interrupt is not migrated; raise a spurious one on every
+     * watched vector instead, the guest re-checks its rings anyway.
+     */
+    if (s->irq_moderation_us && s->msi_vectors) {
+        for (i = 0; i < s->vectors; i++) {
+            if (s->msi_vectors[i].pdev) {
+                s->msi_vectors[i].mod_pending = true;
+                timer_mod(s->msi_vectors[i].mod_timer,
+                          qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) + 1);
+            }
+        }
+    }
     return 0;
 }
 
@@ -1091,6 +1186,8 @@ static const VMStateDescription ivshmem_doorbell_vmsd = {
 static const Property ivshmem_doorbell_properties[] = {
     DEFINE_PROP_CHR("chardev", IVShmemState, server_chr),
     DEFINE_PROP_UINT32("vectors", IVShmemState, vectors, 1),
+    DEFINE_PROP_UINT32("irq-moderation-us", IVShmemState, irq_moderation_us,
+                       0),
     DEFINE_PROP_BIT("ioeventfd", IVShmemState, features, IVSHMEM_IOEVENTFD,
                     true),
     DEFINE_PROP_ON_OFF_AUTO("master", IVShmemState, master, ON_OFF_AUTO_OFF),
@@ -65,6 +65,7 @@ union e1000_rx_desc_union {
 typedef struct IGBTxPktVmdqCallbackContext {
     IGBCore *core;
     NetClientState *nc;
+    bool external_tx;
 } IGBTxPktVmdqCallbackContext;
 
 typedef struct L2Header {
@@ -506,8 +507,9 @@ static void igb_tx_pkt_vmdq_callback(void *opaque,
 
     igb_receive_internal(context->core, virt_iov, virt_iovcnt, true,
                          &external_tx);
+    context->external_tx |= external_tx;
 
-    if (external_tx) {
+    if (external_tx && context->nc) {
         if (context->core->has_vnet) {
             qemu_sendv_packet(context->nc, virt_iov, virt_iovcnt);
         } else {
@@ -534,6 +536,24 @@ static bool igb_tx_pkt_switch(IGBCore *core, struct igb_tx *tx,
 
     context.core = core;
     context.nc = nc;
+    context.external_tx = false;
+
+    /*
+     * Other functions receive a TSO packet as segments, but there is no need
+     * to segment it for the backend too if it accepts virtio-net headers.
+     */
+    if (core->has_vnet &&
+        net_tx_pkt_get_vhdr(tx->tx_pkt)->gso_type != VIRTIO_NET_HDR_GSO_NONE) {
+        context.nc = NULL;
+        if (!net_tx_pkt_send_custom(tx->tx_pkt, false,
+                                    igb_tx_pkt_vmdq_callback, &context)) {
+            return false;
+        }
+        if (!context.external_tx) {
+            return true;
+        }
+        goto send_out;
+    }
 
     return net_tx_pkt_send_custom(tx->tx_pkt, false,
                                   igb_tx_pkt_vmdq_callback, &context);
@@ -1588,34 +1608,60 @@ igb_write_rx_descr(IGBCore *core,
     }
 }
 
-static inline void
-igb_pci_dma_write_rx_desc(IGBCore *core, PCIDevice *dev, dma_addr_t addr,
-                          union e1000_rx_desc_union *desc, dma_addr_t len)
-{
-    if (igb_rx_use_legacy_descriptor(core)) {
-        struct e1000_rx_desc *d = &desc->legacy;
-        size_t offset = offsetof(struct e1000_rx_desc, status);
-        uint8_t status = d->status;
+/* Maximum number of RX descriptors fetched and written back in one DMA */
+#define IGB_RX_DESC_BATCH 16
 
-        d->status &= ~E1000_RXD_STAT_DD;
-        pci_dma_write(dev, addr, desc, len);
+QEMU_BUILD_BUG_ON(sizeof(struct e1000_rx_desc) !=
+                  sizeof(union e1000_rx_desc_union));
+QEMU_BUILD_BUG_ON(sizeof(union e1000_adv_rx_desc) !=
+                  sizeof(union e1000_rx_desc_union));
 
-        if (status & E1000_RXD_STAT_DD) {
-            d->status = status;
-            pci_dma_write(dev, addr + offset, &status, sizeof(status));
+/*
+ * Write back @count consecutive descriptors starting at @addr. They are all
+ * written with DD clear first, then DD is set in ring order, so the guest
+ * never sees DD on a descriptor before its contents.
+ */
+static void
+igb_pci_dma_write_rx_descs(IGBCore *core, PCIDevice *dev, dma_addr_t addr,
+                           union e1000_rx_desc_union *descs, uint32_t count)
+{
+    bool legacy = igb_rx_use_legacy_descriptor(core);
+    size_t offset = legacy ?
+        offsetof(struct e1000_rx_desc, status) :
+        offsetof(union e1000_adv_rx_desc, wb.upper.status_error);
+    bool dd[IGB_RX_DESC_BATCH];
+    uint32_t i;
+
+    assert(count <= IGB_RX_DESC_BATCH);
+
+    for (i = 0; i < count; i++) {
+        if (legacy) {
+            dd[i] = descs[i].legacy.status & E1000_RXD_STAT_DD;
+            descs[i].legacy.status &= ~E1000_RXD_STAT_DD;
+        } else {
+            dd[i] = descs[i].adv.wb.upper.status_error & E1000_RXD_STAT_DD;
+            descs[i].adv.wb.upper.status_error &= ~E1000_RXD_STAT_DD;
         }
-    } else {
-        union e1000_adv_rx_desc *d = &desc->adv;
-        size_t offset =
-            offsetof(union e1000_adv_rx_desc, wb.upper.status_error);
-        uint32_t status = d->wb.upper.status_error;
+    }
+
+    pci_dma_write(dev, addr, descs, count * sizeof(descs[0]));
 
-        d->wb.upper.status_error &= ~E1000_RXD_STAT_DD;
-        pci_dma_write(dev, addr, desc, len);
+    for (i = 0; i < count; i++) {
+        dma_addr_t status_addr = addr + i * sizeof(descs[0]) + offset;
 
-        if (status & E1000_RXD_STAT_DD) {
-            d->wb.upper.status_error = status;
-            pci_dma_write(dev, addr + offset, &status, sizeof(status));
+        if (!dd[i]) {
+            continue;
+        }
+
+        if (legacy) {
+            descs[i].legacy.status |= E1000_RXD_STAT_DD;
+            pci_dma_write(dev, status_addr, &descs[i].legacy.status,
+                          sizeof(descs[i].legacy.status));
+        } else {
+            descs[i].adv.wb.upper.status_error |= E1000_RXD_STAT_DD;
+            pci_dma_write(dev, status_addr,
+                          &descs[i].adv.wb.upper.status_error,
+                          sizeof(descs[i].adv.wb.upper.status_error));
         }
     }
 }
@@ -1897,9 +1943,10 @@ igb_write_packet_to_guest(IGBCore *core, struct NetRxPkt *pkt,
 {
     PCIDevice *d;
     dma_addr_t base;
-    union e1000_rx_desc_union desc;
+    union e1000_rx_desc_union descs[IGB_RX_DESC_BATCH];
     const E1000ERingInfo *rxi;
     size_t rx_desc_len;
+    uint32_t ring_len;
 
     IGBPacketRxDMAState pdma_st = {0};
     pdma_st.is_first = true;
@@ -1918,34 +1965,55 @@ igb_write_packet_to_guest(IGBCore *core, struct NetRxPkt *pkt,
 
     pdma_st.do_ps = igb_do_ps(core, rxi, pkt, &pdma_st);
 
+    ring_len = core->mac[rxi->dlen] / E1000_RING_DESC_LEN;
+
     do {
-        memset(&pdma_st.bastate, 0, sizeof(IGBBAState));
-        bool is_last = false;
+        uint32_t count, i;
 
         if (igb_ring_empty(core, rxi)) {
             return;
         }
 
+        /*
+         * Fetch as many descriptors as the rest of the packet may need in one
+         * go, without wrapping around the end of the ring.
+         */
+        count = DIV_ROUND_UP(pdma_st.total_size - pdma_st.desc_offset,
+                             MAX(pdma_st.rx_desc_packet_buf_size, 1));
+        count = MIN(count, igb_ring_free_descr_num(core, rxi));
+        count = MIN(count, ring_len - core->mac[rxi->dh]);
+        count = MIN(MAX(count, 1), IGB_RX_DESC_BATCH);
+
         base = igb_ring_head_descr(core, rxi);
-        pci_dma_read(d, base, &desc, rx_desc_len);
-        trace_e1000e_rx_descr(rxi->idx, base, rx_desc_len);
+        pci_dma_read(d, base, descs, count * rx_desc_len);
 
-        igb_read_rx_descr(core, &desc, &pdma_st, rxi);
+        for (i = 0;
+             i < count && pdma_st.desc_offset < pdma_st.total_size;
+             i++) {
+            bool is_last = false;
+
+            memset(&pdma_st.bastate, 0, sizeof(IGBBAState));
+            trace_e1000e_rx_descr(rxi->idx, base + i * rx_desc_len,
+                                  rx_desc_len);
+
+            igb_read_rx_descr(core, &descs[i], &pdma_st, rxi);
+
+            igb_write_to_rx_buffers(core, pkt, d, &pdma_st);
+            pdma_st.desc_offset += pdma_st.desc_size;
+            if (pdma_st.desc_offset >= pdma_st.total_size) {
+                is_last = true;
+            }
 
-        igb_write_to_rx_buffers(core, pkt, d, &pdma_st);
-        pdma_st.desc_offset += pdma_st.desc_size;
-        if (pdma_st.desc_offset >= pdma_st.total_size) {
-            is_last = true;
+            igb_write_rx_descr(core, &descs[i],
+                               is_last ? pkt : NULL,
+                               rss_info,
+                               etqf, ts,
+                               &pdma_st,
+                               rxi);
         }
 
-        igb_write_rx_descr(core, &desc,
-                           is_last ? pkt : NULL,
-                           rss_info,
-                           etqf, ts,
-                           &pdma_st,
-                           rxi);
-        igb_pci_dma_write_rx_desc(core, d, base, &desc, rx_desc_len);
-        igb_ring_advance(core, rxi, rx_desc_len / E1000_MIN_RX_DESC_LEN);
+        igb_pci_dma_write_rx_descs(core, d, base, descs, i);
+        igb_ring_advance(core, rxi, i * rx_desc_len / E1000_MIN_RX_DESC_LEN);
     } while (pdma_st.desc_offset < pdma_st.total_size);
 
     igb_update_rx_stats(core, rxi, pdma_st.size, pdma_st.total_size);
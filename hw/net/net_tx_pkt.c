@@ -51,6 +51,9 @@ struct NetTxPkt {
         uint8_t octets[ETH_MAX_IP_DGRAM_LEN];
     } l3_hdr;
 
+    /* TCP header of the segment being built by software segmentation */
+    uint8_t l4_hdr[ETH_MAX_TCP_HDR_LEN];
+
     uint32_t payload_len;
 
     uint32_t payload_frags;
@@ -602,7 +605,8 @@ static bool net_tx_pkt_tcp_fragment_init(struct NetTxPkt *pkt,
     }
 
     l4->iov_len = pkt->virt_hdr.hdr_len - pkt->hdr_len;
-    l4->iov_base = g_malloc(l4->iov_len);
+    l4->iov_base = pkt->l4_hdr;
+    assert(l4->iov_len <= sizeof(pkt->l4_hdr));
 
     *src_idx = NET_TX_PKT_PL_START_FRAG;
     while (pkt->vec[*src_idx].iov_len < l4->iov_len - bytes_read) {
@@ -613,7 +617,6 @@ static bool net_tx_pkt_tcp_fragment_init(struct NetTxPkt *pkt,
 
         (*src_idx)++;
         if (*src_idx >= pkt->payload_frags + NET_TX_PKT_PL_START_FRAG) {
-            g_free(l4->iov_base);
             return false;
         }
     }
@@ -632,11 +635,6 @@ static bool net_tx_pkt_tcp_fragment_init(struct NetTxPkt *pkt,
     return true;
 }
 
-static void net_tx_pkt_tcp_fragment_deinit(struct iovec *fragment)
-{
-    g_free(fragment[NET_TX_PKT_PL_START_FRAG].iov_base);
-}
-
 static void net_tx_pkt_tcp_fragment_fix(struct NetTxPkt *pkt,
                                         struct iovec *fragment,
                                         size_t fragment_len,
@@ -734,6 +732,20 @@ static bool net_tx_pkt_do_sw_fragmentation(struct NetTxPkt *pkt,
                  VIRTIO_NET_HDR_F_DATA_VALID : 0
     };
 
+    /*
+     * Segments share the L3 header of the packet, which is patched in place
+     * for each of them.  All the fields touched are in the fixed part of
+     * the header, so only that needs to be saved.
+     */
+    union {
+        struct ip_header ip;
+        struct ip6_header ip6;
+    } l3_saved;
+    size_t l3_saved_len = MIN(sizeof(l3_saved),
+                              pkt->vec[NET_TX_PKT_L3HDR_FRAG].iov_len);
+
+    memcpy(&l3_saved, &pkt->l3_hdr, l3_saved_len);
+
     /* Copy headers */
     fragment[NET_TX_PKT_VHDR_FRAG].iov_base = &virt_hdr;
     fragment[NET_TX_PKT_VHDR_FRAG].iov_len = sizeof(virt_hdr);
@@ -798,10 +810,8 @@ static bool net_tx_pkt_do_sw_fragmentation(struct NetTxPkt *pkt,
         fragment_offset += fragment_len;
     }
 
-    if (gso_type == VIRTIO_NET_HDR_GSO_TCPV4 ||
-        gso_type == VIRTIO_NET_HDR_GSO_TCPV6) {
-        net_tx_pkt_tcp_fragment_deinit(fragment);
-    }
+    /* Leave the packet as it was, so that it can be sent again */
+    memcpy(&pkt->l3_hdr, &l3_saved, l3_saved_len);
 
     return true;
 }
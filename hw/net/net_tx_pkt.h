@@ -192,6 +192,11 @@ bool net_tx_pkt_send(struct NetTxPkt *pkt, NetClientState *nc);
 /**
  * Send packet with a custom function.
  *
+ * When software segmentation is needed, only the headers are copied for each
+ * segment; the payload is still referenced from the original fragments.  The
+ * packet headers are left unchanged, so the same packet may be sent again,
+ * e.g. once segmented and once with offloads.
+ *
  * @pkt:            packet
  * @offload:        whether the callback implements offloading
  * @callback:       a function to be called back for each transformed packet
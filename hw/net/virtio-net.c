@@ -13,6 +13,7 @@
 
 #include "qemu/osdep.h"
 #include "qemu/atomic.h"
+#include "qemu/defer-call.h"
 #include "qemu/iov.h"
 #include "qemu/log.h"
 #include "qemu/main-loop.h"
@@ -23,6 +24,7 @@
 #include "net/tap.h"
 #include "qemu/error-report.h"
 #include "qemu/timer.h"
+#include "qemu/xxhash.h"
 #include "qemu/option.h"
 #include "qemu/option_int.h"
 #include "qemu/config-file.h"
@@ -59,6 +61,9 @@
 #define VIRTIO_NET_RX_QUEUE_MIN_SIZE VIRTIO_NET_RX_QUEUE_DEFAULT_SIZE
 #define VIRTIO_NET_TX_QUEUE_MIN_SIZE VIRTIO_NET_TX_QUEUE_DEFAULT_SIZE
 
+/* Packets popped and handed to the peer at once by virtio_net_flush_tx() */
+#define VIRTIO_NET_TX_BATCH 32
+
 #define VIRTIO_NET_IP4_ADDR_SIZE   8        /* ipv4 saddr + daddr */
 
 #define VIRTIO_NET_TCP_FLAG         0x3F
@@ -955,9 +960,15 @@ static void virtio_net_set_features(VirtIODevice *vdev,
                                                   VIRTIO_NET_F_HASH_REPORT),
                                virtio_has_tunnel_hdr(features));
 
-    n->rsc4_enabled = virtio_has_feature_ex(features, VIRTIO_NET_F_RSC_EXT) &&
+    n->rsc4_enabled = (virtio_has_feature_ex(features, VIRTIO_NET_F_RSC_EXT) ||
+                       (n->gro &&
+                        virtio_has_feature_ex(features,
+                                              VIRTIO_NET_F_GUEST_CSUM))) &&
         virtio_has_feature_ex(features, VIRTIO_NET_F_GUEST_TSO4);
-    n->rsc6_enabled = virtio_has_feature_ex(features, VIRTIO_NET_F_RSC_EXT) &&
+    n->rsc6_enabled = (virtio_has_feature_ex(features, VIRTIO_NET_F_RSC_EXT) ||
+                       (n->gro &&
+                        virtio_has_feature_ex(features,
+                                              VIRTIO_NET_F_GUEST_CSUM))) &&
         virtio_has_feature_ex(features, VIRTIO_NET_F_GUEST_TSO6);
     n->rss_data.redirect = virtio_has_feature_ex(features, VIRTIO_NET_F_RSS);
 
@@ -1061,9 +1072,15 @@ static int virtio_net_handle_offloads(VirtIONet *n, uint8_t cmd,
             return VIRTIO_NET_ERR;
         }
 
-        n->rsc4_enabled = virtio_has_feature(offloads, VIRTIO_NET_F_RSC_EXT) &&
+        n->rsc4_enabled = (virtio_has_feature(offloads, VIRTIO_NET_F_RSC_EXT) ||
+                           (n->gro &&
+                            virtio_has_feature(offloads,
+                                               VIRTIO_NET_F_GUEST_CSUM))) &&
             virtio_has_feature(offloads, VIRTIO_NET_F_GUEST_TSO4);
-        n->rsc6_enabled = virtio_has_feature(offloads, VIRTIO_NET_F_RSC_EXT) &&
+        n->rsc6_enabled = (virtio_has_feature(offloads, VIRTIO_NET_F_RSC_EXT) ||
+                           (n->gro &&
+                            virtio_has_feature(offloads,
+                                               VIRTIO_NET_F_GUEST_CSUM))) &&
             virtio_has_feature(offloads, VIRTIO_NET_F_GUEST_TSO6);
         virtio_clear_feature(&offloads, VIRTIO_NET_F_RSC_EXT);
 
@@ -1278,8 +1295,10 @@ static void virtio_net_commit_rss_config(VirtIONet *n)
     }
 
     if (n->rss_data.enabled) {
-        n->rss_data.enabled_software_rss = n->rss_data.populate_hash;
-        if (n->rss_data.populate_hash) {
+        /* The flow table is only consulted by software RSS */
+        n->rss_data.enabled_software_rss = n->rss_data.populate_hash ||
+                                           n->rss_data.flow_table;
+        if (n->rss_data.enabled_software_rss) {
             virtio_net_detach_ebpf_rss(n);
         } else if (!virtio_net_attach_ebpf_rss(n)) {
             if (get_vhost_net(qemu_get_queue(n->nic)->peer)) {
@@ -1846,6 +1865,76 @@ static uint8_t virtio_net_get_hash_type(bool hasip4,
     return 0xff;
 }
 
+/*
+ * Compute a hash of the TCP or UDP flow of a packet that is the same for
+ * both directions, so that received packets can be matched with the flows
+ * that the guest transmits.
+ */
+static bool virtio_net_rss_flow_hash(const struct iovec *iov, size_t iovcnt,
+                                     size_t hdr_len, uint32_t *hash)
+{
+    bool hasip4, hasip6;
+    size_t l3hdr_off, l4hdr_off, l5hdr_off;
+    eth_ip6_hdr_info ip6hdr_info;
+    eth_ip4_hdr_info ip4hdr_info;
+    eth_l4_hdr_info l4hdr_info;
+    uint64_t addrs;
+    uint32_t ports;
+
+    eth_get_protocols(iov, iovcnt, hdr_len, &hasip4, &hasip6,
+                      &l3hdr_off, &l4hdr_off, &l5hdr_off,
+                      &ip6hdr_info, &ip4hdr_info, &l4hdr_info);
+
+    switch (l4hdr_info.proto) {
+    case ETH_L4_HDR_PROTO_TCP:
+        ports = l4hdr_info.hdr.tcp.th_sport ^ l4hdr_info.hdr.tcp.th_dport;
+        break;
+    case ETH_L4_HDR_PROTO_UDP:
+        ports = l4hdr_info.hdr.udp.uh_sport ^ l4hdr_info.hdr.udp.uh_dport;
+        break;
+    default:
+        return false;
+    }
+
+    if (hasip4 && !ip4hdr_info.fragment) {
+        addrs = ip4hdr_info.ip4_hdr.ip_src ^ ip4hdr_info.ip4_hdr.ip_dst;
+    } else if (hasip6 && !ip6hdr_info.fragment) {
+        const uint8_t *src = (void *)&ip6hdr_info.ip6_hdr.ip6_src;
+        const uint8_t *dst = (void *)&ip6hdr_info.ip6_hdr.ip6_dst;
+
+        addrs = ldq_he_p(src) ^ ldq_he_p(src + 8) ^
+                ldq_he_p(dst) ^ ldq_he_p(dst + 8);
+    } else {
+        return false;
+    }
+
+    *hash = qemu_xxhash5(addrs, ports, l4hdr_info.proto);
+    return true;
+}
+
+/*
+ * Remember the queue on which the guest transmits a flow.  Received packets
+ * of the flow are then steered to the same queue, which is usually serviced
+ * by the vCPU that runs the application, similar to accelerated RFS.
+ */
+static void virtio_net_rss_flow_learn(VirtIONet *n, VirtQueueElement *elem,
+                                      unsigned int queue_index)
+{
+    VirtioNetRssFlow *flow;
+    uint32_t hash;
+
+    if (!n->rss_data.flow_table || !n->rss_data.enabled ||
+        !n->rss_data.redirect ||
+        !virtio_net_rss_flow_hash(elem->out_sg, elem->out_num,
+                                  n->guest_hdr_len, &hash)) {
+        return;
+    }
+
+    flow = &n->rss_data.flow_table[hash & (n->rss_data.flow_table_size - 1)];
+    flow->hash = hash;
+    flow->queue = queue_index;
+}
+
 static int virtio_net_process_rss(NetClientState *nc, const uint8_t *buf,
                                   size_t size,
                                   struct virtio_net_hdr_v1_hash *hdr)
@@ -1854,7 +1943,7 @@ static int virtio_net_process_rss(NetClientState *nc, const uint8_t *buf,
     unsigned int index = nc->queue_index, new_index = index;
     struct NetRxPkt *pkt = n->rx_pkt;
     uint8_t net_hash_type;
-    uint32_t hash;
+    uint32_t hash, flow_hash;
     bool hasip4, hasip6;
     EthL4HdrProto l4hdr_proto;
     static const uint8_t reports[NetPktRssIpV6UdpEx + 1] = {
@@ -1895,11 +1984,42 @@ static int virtio_net_process_rss(NetClientState *nc, const uint8_t *buf,
     if (n->rss_data.redirect) {
         new_index = hash & (n->rss_data.indirections_len - 1);
         new_index = n->rss_data.indirections_table[new_index];
+
+        if (n->rss_data.flow_table &&
+            virtio_net_rss_flow_hash(&iov, 1, n->host_hdr_len, &flow_hash)) {
+            VirtioNetRssFlow *flow = &n->rss_data.flow_table[
+                flow_hash & (n->rss_data.flow_table_size - 1)];
+
+            if (flow->hash == flow_hash &&
+                flow->queue < n->curr_queue_pairs) {
+                new_index = flow->queue;
+            }
+        }
     }
 
     return (index == new_index) ? -1 : new_index;
 }
 
+/*
+ * Publish the buffers of all packets received since the last flush with a
+ * single used index update and notification.  Deferred to the end of the
+ * backend's receive burst, or called right away outside of one.
+ */
+static void virtio_net_rx_flush(void *opaque)
+{
+    VirtIONetQueue *q = opaque;
+
+    if (!q->rx_pending) {
+        return;
+    }
+
+    WITH_RCU_READ_LOCK_GUARD() {
+        virtqueue_flush(q->rx_vq, q->rx_pending);
+    }
+    q->rx_pending = 0;
+    virtio_notify(VIRTIO_DEVICE(q->n), q->rx_vq);
+}
+
 static ssize_t virtio_net_receive_rcu(NetClientState *nc, const uint8_t *buf,
                                       size_t size)
 {
@@ -2033,12 +2153,12 @@ static ssize_t virtio_net_receive_rcu(NetClientState *nc, const uint8_t *buf,
 
     for (j = 0; j < i; j++) {
         /* signal other side */
-        virtqueue_fill(q->rx_vq, elems[j], lens[j], j);
+        virtqueue_fill(q->rx_vq, elems[j], lens[j], q->rx_pending + j);
         g_free(elems[j]);
     }
 
-    virtqueue_flush(q->rx_vq, i);
-    virtio_notify(vdev, q->rx_vq);
+    q->rx_pending += i;
+    defer_call(virtio_net_rx_flush, q);
 
     return size;
 
@@ -2110,6 +2230,39 @@ static void virtio_net_rsc_extract_unit6(VirtioNetRscChain *chain,
     unit->payload = read_unit_ip_len(unit) - unit->tcp_hdrlen;
 }
 
+/*
+ * Turn a coalesced segment into a GSO packet for guests that do not know
+ * about RSC, as if the host's GRO had merged the segments.  The TCP
+ * checksum is left for the guest to complete.
+ */
+static void virtio_net_gro_finish_seg(VirtioNetRscChain *chain,
+                                      VirtioNetRscSeg *seg,
+                                      struct virtio_net_hdr_v1 *h)
+{
+    VirtIODevice *vdev = VIRTIO_DEVICE(chain->n);
+    VirtioNetRscUnit *unit = &seg->unit;
+    uint8_t *l2 = (uint8_t *)seg->buf + chain->n->guest_hdr_len;
+    uint16_t l4_off = (uint8_t *)unit->tcp - l2;
+    uint16_t l4_len = unit->tcp_hdrlen + unit->payload;
+    uint32_t sum, cso;
+
+    if (chain->proto == ETH_P_IP) {
+        eth_fix_ip4_checksum(unit->ip, l4_off - sizeof(struct eth_header));
+        sum = eth_calc_ip4_pseudo_hdr_csum(unit->ip, l4_len, &cso);
+    } else {
+        sum = eth_calc_ip6_pseudo_hdr_csum(unit->ip, l4_len, IPPROTO_TCP,
+                                           &cso);
+    }
+    unit->tcp->th_sum = cpu_to_be16(~net_checksum_finish(sum));
+
+    h->flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+    h->gso_type = chain->gso_type;
+    virtio_stw_p(vdev, &h->hdr_len, l4_off + unit->tcp_hdrlen);
+    virtio_stw_p(vdev, &h->gso_size, seg->mss);
+    virtio_stw_p(vdev, &h->csum_start, l4_off);
+    virtio_stw_p(vdev, &h->csum_offset, offsetof(struct tcp_header, th_sum));
+}
+
 static size_t virtio_net_rsc_drain_seg(VirtioNetRscChain *chain,
                                        VirtioNetRscSeg *seg)
 {
@@ -2117,17 +2270,25 @@ static size_t virtio_net_rsc_drain_seg(VirtioNetRscChain *chain,
     struct virtio_net_hdr_v1 *h;
 
     h = (struct virtio_net_hdr_v1 *)seg->buf;
-    h->flags = 0;
-    h->gso_type = VIRTIO_NET_HDR_GSO_NONE;
-
-    if (seg->is_coalesced) {
-        h->rsc.segments = seg->packets;
-        h->rsc.dup_acks = seg->dup_ack;
-        h->flags = VIRTIO_NET_HDR_F_RSC_INFO;
-        if (chain->proto == ETH_P_IP) {
-            h->gso_type = VIRTIO_NET_HDR_GSO_TCPV4;
-        } else {
-            h->gso_type = VIRTIO_NET_HDR_GSO_TCPV6;
+    if (!virtio_vdev_has_feature(VIRTIO_DEVICE(chain->n),
+                                 VIRTIO_NET_F_RSC_EXT)) {
+        /* GRO: packets that were not merged keep the header they came with */
+        if (seg->is_coalesced) {
+            virtio_net_gro_finish_seg(chain, seg, h);
+        }
+    } else {
+        h->flags = 0;
+        h->gso_type = VIRTIO_NET_HDR_GSO_NONE;
+
+        if (seg->is_coalesced) {
+            h->rsc.segments = seg->packets;
+            h->rsc.dup_acks = seg->dup_ack;
+            h->flags = VIRTIO_NET_HDR_F_RSC_INFO;
+            if (chain->proto == ETH_P_IP) {
+                h->gso_type = VIRTIO_NET_HDR_GSO_TCPV4;
+            } else {
+                h->gso_type = VIRTIO_NET_HDR_GSO_TCPV6;
+            }
         }
     }
 
@@ -2207,6 +2368,7 @@ static void virtio_net_rsc_cache_buf(VirtioNetRscChain *chain,
     default:
         g_assert_not_reached();
     }
+    seg->mss = seg->unit.payload;
 }
 
 static int32_t virtio_net_rsc_handle_ack(VirtioNetRscChain *chain,
@@ -2293,6 +2455,7 @@ coalesce:
 
         /* update field in ip header */
         write_unit_ip_len(o_unit, o_ip_len + n_unit->payload);
+        seg->mss = MAX(seg->mss, n_unit->payload);
 
         /* Bring 'PUSH' big, the whql test guide says 'PUSH' can be coalesced
            for windows guest, while this may change the behavior for linux
@@ -2652,6 +2815,12 @@ static ssize_t virtio_net_rsc_receive(NetClientState *nc,
         return virtio_net_do_receive(nc, buf, size);
     }
 
+    /* Packets that the host already passes as GSO are not merged by GRO */
+    if (!virtio_vdev_has_feature(VIRTIO_DEVICE(n), VIRTIO_NET_F_RSC_EXT) &&
+        ((struct virtio_net_hdr *)buf)->gso_type != VIRTIO_NET_HDR_GSO_NONE) {
+        return virtio_net_do_receive(nc, buf, size);
+    }
+
     eth = (struct eth_header *)(buf + n->guest_hdr_len);
     proto = htons(eth->h_proto);
 
@@ -2712,6 +2881,81 @@ static void virtio_net_tx_complete(NetClientState *nc, ssize_t len)
     }
 }
 
+/*
+ * Fast path of virtio_net_flush_tx() for when the guest's buffers can be
+ * passed to the peer as they are: pop several packets at once, hand them
+ * to the peer in one call and complete them with a single used ring update.
+ */
+static int32_t virtio_net_flush_tx_batch(VirtIONetQueue *q)
+{
+    VirtIONet *n = q->n;
+    VirtIODevice *vdev = VIRTIO_DEVICE(n);
+    NetClientState *nc =
+        qemu_get_subqueue(n->nic, vq2q(virtio_get_queue_index(q->tx_vq)));
+    VirtQueueElement *elems[VIRTIO_NET_TX_BATCH];
+    const struct iovec *iovs[VIRTIO_NET_TX_BATCH];
+    int iovcnts[VIRTIO_NET_TX_BATCH];
+    int32_t num_packets = 0;
+
+    while (num_packets < n->tx_burst) {
+        unsigned int i, count;
+        int sent;
+
+        count = virtqueue_pop_batch(q->tx_vq, sizeof(VirtQueueElement),
+                                    (void **)elems,
+                                    MIN(VIRTIO_NET_TX_BATCH,
+                                        n->tx_burst - num_packets));
+        if (!count) {
+            break;
+        }
+
+        for (i = 0; i < count; i++) {
+            if (elems[i]->out_num < 1) {
+                virtio_error(vdev, "virtio-net header not in first element");
+                for (i = 0; i < count; i++) {
+                    virtqueue_detach_element(q->tx_vq, elems[i], 0);
+                    g_free(elems[i]);
+                }
+                return -EINVAL;
+            }
+            virtio_net_rss_flow_learn(n, elems[i], nc->queue_index);
+            iovs[i] = elems[i]->out_sg;
+            iovcnts[i] = elems[i]->out_num;
+        }
+
+        sent = qemu_sendv_packet_batch(nc, iovs, iovcnts, count,
+                                       virtio_net_tx_complete);
+
+        for (i = 0; i < sent; i++) {
+            virtqueue_fill(q->tx_vq, elems[i], 0, i);
+        }
+        if (sent) {
+            virtqueue_flush(q->tx_vq, sent);
+            virtio_notify(vdev, q->tx_vq);
+        }
+        for (i = 0; i < sent; i++) {
+            g_free(elems[i]);
+        }
+        num_packets += sent;
+
+        if (sent < count) {
+            /*
+             * elems[sent] was queued by the peer, give back the ones after
+             * it so that they are popped again after virtio_net_tx_complete.
+             */
+            for (i = count - 1; i > sent; i--) {
+                virtqueue_unpop(q->tx_vq, elems[i], 0);
+                g_free(elems[i]);
+            }
+            virtio_queue_set_notification(q->tx_vq, 0);
+            q->async_tx.elem = elems[sent];
+            return -EBUSY;
+        }
+    }
+
+    return num_packets;
+}
+
 /* TX */
 static int32_t virtio_net_flush_tx(VirtIONetQueue *q)
 {
@@ -2729,6 +2973,10 @@ static int32_t virtio_net_flush_tx(VirtIONetQueue *q)
         return num_packets;
     }
 
+    if (!n->needs_vnet_hdr_swap && n->host_hdr_len == n->guest_hdr_len) {
+        return virtio_net_flush_tx_batch(q);
+    }
+
     for (;;) {
         ssize_t ret;
         unsigned int out_num;
@@ -2747,6 +2995,8 @@ static int32_t virtio_net_flush_tx(VirtIONetQueue *q)
             goto detach;
         }
 
+        virtio_net_rss_flow_learn(n, elem, queue_index);
+
         if (n->needs_vnet_hdr_swap) {
             if (iov_to_buf(out_sg, out_num, 0, &vhdr, sizeof(vhdr)) <
                 sizeof(vhdr)) {
@@ -2993,6 +3243,9 @@ static void virtio_net_add_queue(VirtIONet *n, int index)
                                                   &DEVICE(vdev)->mem_reentrancy_guard);
     }
 
+    /* Transmitted buffers are always completed with a used length of 0 */
+    virtio_queue_set_in_order_batch(n->vqs[index].tx_vq, true);
+
     n->vqs[index].tx_waiting = 0;
     n->vqs[index].n = n;
 }
@@ -3925,6 +4178,13 @@ static void virtio_net_device_realize(DeviceState *dev, Error **errp)
         return;
     }
 
+    if (n->rss_data.flow_table_size &&
+        !is_power_of_2(n->rss_data.flow_table_size)) {
+        error_setg(errp, "'rss_flow_table' must be a power of 2");
+        virtio_cleanup(vdev);
+        return;
+    }
+
     if (n->net_conf.tx_queue_size < VIRTIO_NET_TX_QUEUE_MIN_SIZE ||
         n->net_conf.tx_queue_size > virtio_net_max_tx_queue_size(n) ||
         !is_power_of_2(n->net_conf.tx_queue_size)) {
@@ -4033,6 +4293,11 @@ static void virtio_net_device_realize(DeviceState *dev, Error **errp)
 
     net_rx_pkt_init(&n->rx_pkt);
 
+    if (n->rss_data.flow_table_size) {
+        n->rss_data.flow_table = g_new0(VirtioNetRssFlow,
+                                        n->rss_data.flow_table_size);
+    }
+
     if (qemu_get_vnet_hash_supported_types(qemu_get_queue(n->nic)->peer,
                                            &n->rss_data.peer_hash_types)) {
         n->rss_data.peer_hash_available = true;
@@ -4086,6 +4351,7 @@ static void virtio_net_device_unrealize(DeviceState *dev)
     qemu_del_nic(n->nic);
     virtio_net_rsc_cleanup(n);
     g_free(n->rss_data.indirections_table);
+    g_free(n->rss_data.flow_table);
     net_rx_pkt_uninit(n->rx_pkt);
     virtio_cleanup(vdev);
 }
@@ -4123,6 +4389,10 @@ static void virtio_net_reset(VirtIODevice *vdev)
     }
 
     virtio_net_disable_rss(n);
+    if (n->rss_data.flow_table) {
+        memset(n->rss_data.flow_table, 0,
+               n->rss_data.flow_table_size * sizeof(VirtioNetRssFlow));
+    }
 }
 
 static void virtio_net_instance_init(Object *obj)
@@ -4233,10 +4503,13 @@ static const Property virtio_net_properties[] = {
                     VIRTIO_NET_F_HASH_REPORT, false),
     DEFINE_PROP_ARRAY("ebpf-rss-fds", VirtIONet, nr_ebpf_rss_fds,
                       ebpf_rss_fds, qdev_prop_string, char*),
+    DEFINE_PROP_UINT32("rss_flow_table", VirtIONet, rss_data.flow_table_size,
+                       0),
     DEFINE_PROP_BIT64("guest_rsc_ext", VirtIONet, host_features,
                     VIRTIO_NET_F_RSC_EXT, false),
     DEFINE_PROP_UINT32("rsc_interval", VirtIONet, rsc_timeout,
                        VIRTIO_NET_RSC_DEFAULT_INTERVAL),
+    DEFINE_PROP_BOOL("guest_gro", VirtIONet, gro, false),
     DEFINE_NIC_PROPERTIES(VirtIONet, nic_conf),
     DEFINE_PROP_UINT32("x-txtimer", VirtIONet, net_conf.txtimer,
                        TX_TIMER_INTERVAL),
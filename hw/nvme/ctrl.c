@@ -195,6 +195,7 @@
 
 #include "qemu/osdep.h"
 #include "qemu/cutils.h"
+#include "qemu/defer-call.h"
 #include "qemu/error-report.h"
 #include "qemu/log.h"
 #include "qemu/units.h"
@@ -1495,17 +1496,28 @@ static void nvme_update_cq_head(NvmeCQueue *cq)
     trace_pci_nvme_update_cq_head(cq->cqid, cq->head);
 }
 
+/*
+ * Completion entries that are written to the guest with a single DMA.  Each
+ * entry carries its own phase tag, so the host may make them visible in any
+ * order.
+ */
+#define NVME_CQE_BATCH 32
+
 static void nvme_post_cqes(void *opaque)
 {
     NvmeCQueue *cq = opaque;
     NvmeCtrl *n = cq->ctrl;
-    NvmeRequest *req, *next;
+    NvmeRequest *reqs[NVME_CQE_BATCH];
+    NvmeCqe cqes[NVME_CQE_BATCH];
+    NvmeRequest *req;
     bool pending = cq->head != cq->tail;
     int ret;
 
-    QTAILQ_FOREACH_SAFE(req, &cq->req_list, entry, next) {
-        NvmeSQueue *sq;
+    while (!QTAILQ_EMPTY(&cq->req_list)) {
+        uint32_t tail = cq->tail;
         hwaddr addr;
+        int count = 0;
+        int i;
 
         if (n->dbbuf_enabled) {
             nvme_update_cq_eventidx(cq);
@@ -1513,16 +1525,37 @@ static void nvme_post_cqes(void *opaque)
         }
 
         if (nvme_cq_full(cq)) {
+            if (cq->db_coalesced) {
+                /*
+                 * The head doorbell that frees the queue may be sitting in
+                 * the coalesced MMIO ring; stop coalescing it so that the
+                 * next one exits, and flush the ring.
+                 */
+                cq->db_coalesced = false;
+                qemu_bh_schedule(n->db_coalesce_bh);
+            }
             break;
         }
 
-        sq = req->sq;
-        req->cqe.status = cpu_to_le16((req->status << 1) | cq->phase);
-        req->cqe.sq_id = cpu_to_le16(sq->sqid);
-        req->cqe.sq_head = cpu_to_le16(sq->head);
+        /* Stop at the end of the ring, where the phase tag flips */
+        QTAILQ_FOREACH(req, &cq->req_list, entry) {
+            NvmeSQueue *sq = req->sq;
+
+            req->cqe.status = cpu_to_le16((req->status << 1) | cq->phase);
+            req->cqe.sq_id = cpu_to_le16(sq->sqid);
+            req->cqe.sq_head = cpu_to_le16(sq->head);
+            reqs[count] = req;
+            cqes[count++] = req->cqe;
+
+            if (count == NVME_CQE_BATCH || ++tail >= cq->size ||
+                (tail + 1) % cq->size == cq->head) {
+                break;
+            }
+        }
+
         addr = cq->dma_addr + (cq->tail << NVME_CQES);
-        ret = pci_dma_write(PCI_DEVICE(n), addr, (void *)&req->cqe,
-                            sizeof(req->cqe));
+        ret = pci_dma_write(PCI_DEVICE(n), addr, (void *)cqes,
+                            count * sizeof(NvmeCqe));
         if (ret) {
             trace_pci_nvme_err_addr_write(addr);
             trace_pci_nvme_err_cfs();
@@ -1530,16 +1563,22 @@ static void nvme_post_cqes(void *opaque)
             break;
         }
 
-        QTAILQ_REMOVE(&cq->req_list, req, entry);
+        for (i = 0; i < count; i++) {
+            NvmeSQueue *sq;
 
-        nvme_inc_cq_tail(cq);
-        nvme_sg_unmap(&req->sg);
+            req = reqs[i];
+            sq = req->sq;
+            QTAILQ_REMOVE(&cq->req_list, req, entry);
 
-        if (QTAILQ_EMPTY(&sq->req_list) && !nvme_sq_empty(sq)) {
-            qemu_bh_schedule(sq->bh);
-        }
+            nvme_inc_cq_tail(cq);
+            nvme_sg_unmap(&req->sg);
 
-        QTAILQ_INSERT_TAIL(&sq->req_list, req, entry);
+            if (QTAILQ_EMPTY(&sq->req_list) && !nvme_sq_empty(sq)) {
+                qemu_bh_schedule(sq->bh);
+            }
+
+            QTAILQ_INSERT_TAIL(&sq->req_list, req, entry);
+        }
     }
     if (cq->tail != cq->head) {
         if (cq->irq_enabled && !pending) {
@@ -4758,6 +4797,9 @@ static int nvme_init_cq_ioeventfd(NvmeCQueue *cq)
     event_notifier_set_handler(&cq->notifier, nvme_cq_notifier);
     memory_region_add_eventfd(&n->iomem,
                               0x1000 + offset, 4, false, 0, &cq->notifier);
+    if (cq->db_coalesced) {
+        qemu_bh_schedule(n->db_coalesce_bh);
+    }
 
     return 0;
 }
@@ -5504,6 +5546,37 @@ static uint16_t nvme_get_log(NvmeCtrl *n, NvmeRequest *req)
     }
 }
 
+/*
+ * Completion queue head doorbells of I/O queues can be coalesced: with KVM
+ * the writes are then appended to the coalesced MMIO ring instead of
+ * exiting to QEMU, and are replayed on the next exit.  The head only has
+ * to be current when a queue is full, and any other access to the BAR,
+ * such as a submission queue doorbell, flushes the ring first.
+ *
+ * Changing the ranges flushes the ring, which dispatches to the BAR and
+ * would be rejected by the reentrancy guard of the queue bottom halves,
+ * so this is done from a bottom half of its own.
+ */
+static void nvme_update_db_coalescing(void *opaque)
+{
+    NvmeCtrl *n = opaque;
+    int i;
+
+    memory_region_clear_coalescing(&n->iomem);
+
+    for (i = 1; i <= n->params.max_ioqpairs; i++) {
+        NvmeCQueue *cq = n->cq[i];
+
+        if (cq && cq->db_coalesced && !cq->ioeventfd_enabled) {
+            memory_region_add_coalescing(&n->iomem,
+                                         0x1000 + (i << 3) + (1 << 2), 4);
+        }
+    }
+
+    /* Replay writes that raced with the removal of their range */
+    qemu_flush_coalesced_mmio_buffer();
+}
+
 static void nvme_free_cq(NvmeCQueue *cq, NvmeCtrl *n)
 {
     PCIDevice *pci = PCI_DEVICE(n);
@@ -5511,6 +5584,9 @@ static void nvme_free_cq(NvmeCQueue *cq, NvmeCtrl *n)
 
     n->cq[cq->cqid] = NULL;
     qemu_bh_delete(cq->bh);
+    if (cq->db_coalesced) {
+        qemu_bh_schedule(n->db_coalesce_bh);
+    }
     if (cq->ioeventfd_enabled) {
         memory_region_del_eventfd(&n->iomem,
                                   0x1000 + offset, 4, false, 0, &cq->notifier);
@@ -5585,6 +5661,15 @@ static void nvme_init_cq(NvmeCQueue *cq, NvmeCtrl *n, uint64_t dma_addr,
     n->cq[cqid] = cq;
     cq->bh = qemu_bh_new_guarded(nvme_post_cqes, cq,
                                  &DEVICE(cq->ctrl)->mem_reentrancy_guard);
+
+    /*
+     * A stale head keeps a pin-based interrupt asserted, so only coalesce
+     * the doorbells of queues that use MSI-X.
+     */
+    if (n->params.coalesce_cq_db && cqid != 0 && msix_enabled(pci)) {
+        cq->db_coalesced = true;
+        qemu_bh_schedule(n->db_coalesce_bh);
+    }
 }
 
 static uint16_t nvme_create_cq(NvmeCtrl *n, NvmeRequest *req)
@@ -7783,6 +7868,9 @@ static void nvme_process_sq(void *opaque)
         nvme_update_sq_tail(sq);
     }
 
+    /* let the block layer merge and batch the commands of this pass */
+    defer_call_begin();
+
     while (!(nvme_sq_empty(sq) || QTAILQ_EMPTY(&sq->req_list))) {
         NvmeAtomic *atomic;
         bool cmd_is_atomic;
@@ -7805,6 +7893,7 @@ static void nvme_process_sq(void *opaque)
             switch (ret) {
             case NVME_ATOMIC_NO_START:
                 qemu_bh_schedule(sq->bh);
+                defer_call_end();
                 return;
             case NVME_ATOMIC_START_ATOMIC:
                 cmd_is_atomic = true;
@@ -7839,6 +7928,8 @@ static void nvme_process_sq(void *opaque)
             nvme_update_sq_tail(sq);
         }
     }
+
+    defer_call_end();
 }
 
 static void nvme_update_msixcap_ts(PCIDevice *pci_dev, uint32_t table_size)
@@ -8732,6 +8823,7 @@ static void nvme_init_state(NvmeCtrl *n)
     n->starttime_ms = qemu_clock_get_ms(QEMU_CLOCK_VIRTUAL);
     n->aer_reqs = g_new0(NvmeRequest *, n->params.aerl + 1);
     QTAILQ_INIT(&n->aer_queue);
+    n->db_coalesce_bh = qemu_bh_new(nvme_update_db_coalescing, n);
 
     n->nr_sec_ctrls = max_vfs;
     for (i = 0; i < max_vfs; i++) {
@@ -9328,6 +9420,8 @@ static void nvme_exit(PCIDevice *pci_dev)
 
     nvme_subsys_unregister_ctrl(n->subsys, n);
 
+    qemu_bh_delete(n->db_coalesce_bh);
+    memory_region_clear_coalescing(&n->iomem);
     g_free(n->cq);
     g_free(n->sq);
     g_free(n->aer_reqs);
@@ -9381,6 +9475,8 @@ static const Property nvme_props[] = {
     DEFINE_PROP_BOOL("use-intel-id", NvmeCtrl, params.use_intel_id, false),
     DEFINE_PROP_BOOL("legacy-cmb", NvmeCtrl, params.legacy_cmb, false),
     DEFINE_PROP_BOOL("ioeventfd", NvmeCtrl, params.ioeventfd, false),
+    DEFINE_PROP_BOOL("coalesce-cq-doorbells", NvmeCtrl, params.coalesce_cq_db,
+                     false),
     DEFINE_PROP_BOOL("dbcs", NvmeCtrl, params.dbcs, true),
     DEFINE_PROP_UINT8("zoned.zasl", NvmeCtrl, params.zasl, 0),
     DEFINE_PROP_BOOL("zoned.auto_transition", NvmeCtrl,
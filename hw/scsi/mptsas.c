@@ -407,6 +407,7 @@ static void mptsas_process_scsi_task_mgmt(MPTSASState *s, MPIMsgSCSITaskMgmt *re
     MPIMsgSCSITaskMgmtReply *reply_async;
     int status, count;
     SCSIDevice *sdev;
+    SCSIRequestShard *shard;
     SCSIRequest *r, *next;
     BusChild *kid;
 
@@ -438,9 +439,15 @@ static void mptsas_process_scsi_task_mgmt(MPTSASState *s, MPIMsgSCSITaskMgmt *re
             goto out;
         }
 
-        QTAILQ_FOREACH_SAFE(r, &sdev->requests, next, next) {
-            MPTSASRequest *cmd_req = r->hba_private;
-            if (cmd_req && cmd_req->scsi_io.MsgContext == req->TaskMsgContext) {
+        SCSI_DEVICE_FOREACH_SHARD(sdev, shard) {
+            QTAILQ_FOREACH_SAFE(r, &shard->requests, next, next) {
+                MPTSASRequest *cmd_req = r->hba_private;
+                if (cmd_req &&
+                    cmd_req->scsi_io.MsgContext == req->TaskMsgContext) {
+                    break;
+                }
+            }
+            if (r) {
                 break;
             }
         }
@@ -489,16 +496,18 @@ static void mptsas_process_scsi_task_mgmt(MPTSASState *s, MPIMsgSCSITaskMgmt *re
         reply_async->IOCLogInfo = INT_MAX;
 
         count = 0;
-        QTAILQ_FOREACH_SAFE(r, &sdev->requests, next, next) {
-            if (r->hba_private) {
-                MPTSASCancelNotifier *notifier;
-
-                count++;
-                notifier = g_new(MPTSASCancelNotifier, 1);
-                notifier->s = s;
-                notifier->reply = reply_async;
-                notifier->notifier.notify = mptsas_cancel_notify;
-                scsi_req_cancel_async(r, &notifier->notifier);
+        SCSI_DEVICE_FOREACH_SHARD(sdev, shard) {
+            QTAILQ_FOREACH_SAFE(r, &shard->requests, next, next) {
+                if (r->hba_private) {
+                    MPTSASCancelNotifier *notifier;
+
+                    count++;
+                    notifier = g_new(MPTSASCancelNotifier, 1);
+                    notifier->s = s;
+                    notifier->reply = reply_async;
+                    notifier->notifier.notify = mptsas_cancel_notify;
+                    scsi_req_cancel_async(r, &notifier->notifier);
+                }
             }
         }
 
@@ -94,6 +94,7 @@ static void scsi_device_for_each_req_sync(SCSIDevice *s,
                                           void (*fn)(SCSIRequest *, void *),
                                           void *opaque)
 {
+    SCSIRequestShard *shard;
     SCSIRequest *req;
     SCSIRequest *next_req;
 
@@ -105,9 +106,11 @@ static void scsi_device_for_each_req_sync(SCSIDevice *s,
      * threads can be accessing the requests list, but take the lock for
      * consistency.
      */
-    WITH_QEMU_LOCK_GUARD(&s->requests_lock) {
-        QTAILQ_FOREACH_SAFE(req, &s->requests, next, next_req) {
-            fn(req, opaque);
+    SCSI_DEVICE_FOREACH_SHARD(s, shard) {
+        WITH_QEMU_LOCK_GUARD(&shard->lock) {
+            QTAILQ_FOREACH_SAFE(req, &shard->requests, next, next_req) {
+                fn(req, opaque);
+            }
         }
     }
 }
@@ -123,20 +126,23 @@ static void scsi_device_for_each_req_async_bh(void *opaque)
     g_autofree SCSIDeviceForEachReqAsyncData *data = opaque;
     SCSIDevice *s = data->s;
     g_autoptr(GList) reqs = NULL;
+    AioContext *ctx = qemu_get_current_aio_context();
+    SCSIRequestShard *shard;
 
     /*
      * Build a list of requests in this AioContext so fn() can be invoked later
-     * outside requests_lock.
+     * outside the shard locks.
      */
-    WITH_QEMU_LOCK_GUARD(&s->requests_lock) {
-        AioContext *ctx = qemu_get_current_aio_context();
-        SCSIRequest *req;
-        SCSIRequest *next;
-
-        QTAILQ_FOREACH_SAFE(req, &s->requests, next, next) {
-            if (req->ctx == ctx) {
-                scsi_req_ref(req); /* dropped after calling fn() */
-                reqs = g_list_prepend(reqs, req);
+    SCSI_DEVICE_FOREACH_SHARD(s, shard) {
+        WITH_QEMU_LOCK_GUARD(&shard->lock) {
+            SCSIRequest *req;
+            SCSIRequest *next;
+
+            QTAILQ_FOREACH_SAFE(req, &shard->requests, next, next) {
+                if (req->ctx == ctx) {
+                    scsi_req_ref(req); /* dropped after calling fn() */
+                    reqs = g_list_prepend(reqs, req);
+                }
             }
         }
     }
@@ -194,10 +200,14 @@ static void scsi_device_for_each_req_async(SCSIDevice *s,
 
     /* The set of AioContexts where the requests are being processed */
     g_autoptr(GHashTable) aio_contexts = g_hash_table_new(NULL, NULL);
-    WITH_QEMU_LOCK_GUARD(&s->requests_lock) {
-        SCSIRequest *req;
-        QTAILQ_FOREACH(req, &s->requests, next) {
-            g_hash_table_add(aio_contexts, req->ctx);
+    SCSIRequestShard *shard;
+
+    SCSI_DEVICE_FOREACH_SHARD(s, shard) {
+        WITH_QEMU_LOCK_GUARD(&shard->lock) {
+            SCSIRequest *req;
+            QTAILQ_FOREACH(req, &shard->requests, next) {
+                g_hash_table_add(aio_contexts, req->ctx);
+            }
         }
     }
 
@@ -364,6 +374,7 @@ static void scsi_qdev_realize(DeviceState *qdev, Error **errp)
 {
     SCSIDevice *dev = SCSI_DEVICE(qdev);
     SCSIBus *bus = DO_UPCAST(SCSIBus, qbus, dev->qdev.parent_bus);
+    SCSIRequestShard *shard;
     bool is_free;
     Error *local_err = NULL;
 
@@ -392,8 +403,10 @@ static void scsi_qdev_realize(DeviceState *qdev, Error **errp)
         dev->lun = lun;
     }
 
-    qemu_mutex_init(&dev->requests_lock);
-    QTAILQ_INIT(&dev->requests);
+    SCSI_DEVICE_FOREACH_SHARD(dev, shard) {
+        qemu_mutex_init(&shard->lock);
+        QTAILQ_INIT(&shard->requests);
+    }
     scsi_device_realize(dev, &local_err);
     if (local_err) {
         error_propagate(errp, local_err);
@@ -406,6 +419,7 @@ static void scsi_qdev_realize(DeviceState *qdev, Error **errp)
 static void scsi_qdev_unrealize(DeviceState *qdev)
 {
     SCSIDevice *dev = SCSI_DEVICE(qdev);
+    SCSIRequestShard *shard;
 
     if (dev->vmsentry) {
         qemu_del_vm_change_state_handler(dev->vmsentry);
@@ -413,7 +427,9 @@ static void scsi_qdev_unrealize(DeviceState *qdev)
 
     scsi_device_purge_requests(dev, SENSE_CODE(NO_SENSE));
 
-    qemu_mutex_destroy(&dev->requests_lock);
+    SCSI_DEVICE_FOREACH_SHARD(dev, shard) {
+        qemu_mutex_destroy(&shard->lock);
+    }
 
     scsi_device_unrealize(dev);
 
@@ -998,8 +1014,22 @@ void scsi_req_build_sense(SCSIRequest *req, SCSISense sense)
     req->sense_len = scsi_build_sense(req->sense, sense);
 }
 
+/* Pick the request shard of the current thread, assigned round-robin */
+static unsigned scsi_request_shard(void)
+{
+    static unsigned next_shard;
+    static __thread int shard = -1;
+
+    if (shard < 0) {
+        shard = qatomic_fetch_inc(&next_shard) % SCSI_REQUEST_SHARDS;
+    }
+    return shard;
+}
+
 static void scsi_req_enqueue_internal(SCSIRequest *req)
 {
+    SCSIRequestShard *shard;
+
     assert(!req->enqueued);
     scsi_req_ref(req);
     if (req->bus->info->get_sg_list) {
@@ -1007,10 +1037,17 @@ static void scsi_req_enqueue_internal(SCSIRequest *req)
     } else {
         req->sg = NULL;
     }
+    if (req->sg && req->bus->info->get_iov) {
+        req->iov = req->bus->info->get_iov(req);
+    } else {
+        req->iov = NULL;
+    }
     req->enqueued = true;
+    req->shard = scsi_request_shard();
 
-    WITH_QEMU_LOCK_GUARD(&req->dev->requests_lock) {
-        QTAILQ_INSERT_TAIL(&req->dev->requests, req, next);
+    shard = &req->dev->requests[req->shard];
+    WITH_QEMU_LOCK_GUARD(&shard->lock) {
+        QTAILQ_INSERT_TAIL(&shard->requests, req, next);
     }
 }
 
@@ -1031,8 +1068,10 @@ static void scsi_req_dequeue(SCSIRequest *req)
     trace_scsi_req_dequeue(req->dev->id, req->lun, req->tag);
     req->retry = false;
     if (req->enqueued) {
-        WITH_QEMU_LOCK_GUARD(&req->dev->requests_lock) {
-            QTAILQ_REMOVE(&req->dev->requests, req, next);
+        SCSIRequestShard *shard = &req->dev->requests[req->shard];
+
+        WITH_QEMU_LOCK_GUARD(&shard->lock) {
+            QTAILQ_REMOVE(&shard->requests, req, next);
         }
         req->enqueued = false;
         scsi_req_unref(req);
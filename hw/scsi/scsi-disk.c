@@ -474,7 +474,14 @@ static void scsi_do_read(SCSIDiskReq *r, int ret)
     /* The request is used as the AIO opaque value, so add a ref.  */
     scsi_req_ref(&r->req);
 
-    if (r->req.sg) {
+    if (r->req.iov) {
+        /* The HBA has mapped the buffers already, skip the DMA helpers */
+        block_acct_start(blk_get_stats(s->qdev.conf.blk), &r->acct,
+                         r->req.iov->size, BLOCK_ACCT_READ);
+        r->req.residual -= r->req.iov->size;
+        r->req.aiocb = sdc->dma_readv(r->sector << BDRV_SECTOR_BITS,
+                                      r->req.iov, scsi_dma_complete, r, r);
+    } else if (r->req.sg) {
         dma_acct_start(s->qdev.conf.blk, &r->acct, r->req.sg, BLOCK_ACCT_READ);
         r->req.residual -= r->req.sg->size;
         r->req.aiocb = dma_blk_io(r->req.sg, r->sector << BDRV_SECTOR_BITS,
@@ -632,7 +639,13 @@ static void scsi_write_data(SCSIRequest *req)
         return;
     }
 
-    if (r->req.sg) {
+    if (r->req.iov) {
+        block_acct_start(blk_get_stats(s->qdev.conf.blk), &r->acct,
+                         r->req.iov->size, BLOCK_ACCT_WRITE);
+        r->req.residual -= r->req.iov->size;
+        r->req.aiocb = sdc->dma_writev(r->sector << BDRV_SECTOR_BITS,
+                                       r->req.iov, scsi_dma_complete, r, r);
+    } else if (r->req.sg) {
         dma_acct_start(s->qdev.conf.blk, &r->acct, r->req.sg, BLOCK_ACCT_WRITE);
         r->req.residual -= r->req.sg->size;
         r->req.aiocb = dma_blk_io(r->req.sg, r->sector << BDRV_SECTOR_BITS,
@@ -43,6 +43,7 @@ typedef struct VirtIOSCSIReq {
     VirtIOSCSI *dev;
     VirtQueue *vq;
     QEMUSGList qsgl;
+    QEMUIOVector data_iov; /* host mapping of qsgl */
     QEMUIOVector resp_iov;
 
     /* Used for two-stage request submission and TMFs deferred to BH */
@@ -92,6 +93,7 @@ static void virtio_scsi_init_req(VirtIOSCSI *s, VirtQueue *vq, VirtIOSCSIReq *re
     req->vq = vq;
     req->dev = s;
     qemu_sglist_init(&req->qsgl, DEVICE(s), 8, vdev->dma_as);
+    qemu_iovec_init(&req->data_iov, 8);
     qemu_iovec_init(&req->resp_iov, 1);
     memset((uint8_t *)req + zero_skip, 0, sizeof(*req) - zero_skip);
 }
@@ -99,8 +101,9 @@ static void virtio_scsi_init_req(VirtIOSCSI *s, VirtQueue *vq, VirtIOSCSIReq *re
 static void virtio_scsi_free_req(VirtIOSCSIReq *req)
 {
     qemu_iovec_destroy(&req->resp_iov);
+    qemu_iovec_destroy(&req->data_iov);
     qemu_sglist_destroy(&req->qsgl);
-    g_free(req);
+    virtqueue_element_free(req);
 }
 
 static void virtio_scsi_complete_req(VirtIOSCSIReq *req, QemuMutex *vq_lock)
@@ -220,8 +223,12 @@ static int virtio_scsi_parse_req(VirtIOSCSIReq *req,
 
     if (out_size) {
         req->mode = SCSI_XFER_TO_DEV;
+        qemu_iovec_concat_iov(&req->data_iov, req->elem.out_sg,
+                              req->elem.out_num, req_size, out_size);
     } else if (in_size) {
         req->mode = SCSI_XFER_FROM_DEV;
+        qemu_iovec_concat_iov(&req->data_iov, req->elem.in_sg,
+                              req->elem.in_num, resp_size, in_size);
     }
 
     return 0;
@@ -337,6 +344,7 @@ static void virtio_scsi_do_tmf_aio_context(void *opaque)
     VirtIOSCSIReq *tmf = opaque;
     VirtIOSCSI *s = tmf->dev;
     SCSIDevice *d = virtio_scsi_device_get(s, tmf->req.tmf.lun);
+    SCSIRequestShard *shard;
     SCSIRequest *r;
     bool match_tag;
     g_autoptr(GList) reqs = NULL;
@@ -364,24 +372,27 @@ static void virtio_scsi_do_tmf_aio_context(void *opaque)
         g_assert_not_reached();
     }
 
-    WITH_QEMU_LOCK_GUARD(&d->requests_lock) {
-        QTAILQ_FOREACH(r, &d->requests, next) {
-            VirtIOSCSIReq *cmd_req = r->hba_private;
-            assert(cmd_req); /* request has hba_private while enqueued */
+    SCSI_DEVICE_FOREACH_SHARD(d, shard) {
+        WITH_QEMU_LOCK_GUARD(&shard->lock) {
+            QTAILQ_FOREACH(r, &shard->requests, next) {
+                VirtIOSCSIReq *cmd_req = r->hba_private;
+                assert(cmd_req); /* request has hba_private while enqueued */
 
-            if (r->ctx != ctx) {
-                continue;
-            }
-            if (match_tag && cmd_req->req.cmd.tag != tmf->req.tmf.tag) {
-                continue;
+                if (r->ctx != ctx) {
+                    continue;
+                }
+                if (match_tag && cmd_req->req.cmd.tag != tmf->req.tmf.tag) {
+                    continue;
+                }
+                /*
+                 * Cannot cancel directly, because scsi_req_dequeue() would
+                 * deadlock when attempting to acquire the shard lock a second
+                 * time. Taking a reference here is paired with an unref after
+                 * cancelling below.
+                 */
+                scsi_req_ref(r);
+                reqs = g_list_prepend(reqs, r);
             }
-            /*
-             * Cannot cancel directly, because scsi_req_dequeue() would deadlock
-             * when attempting to acquire the request_lock a second time. Taking
-             * a reference here is paired with an unref after cancelling below.
-             */
-            scsi_req_ref(r);
-            reqs = g_list_prepend(reqs, r);
         }
     }
 
@@ -442,18 +453,22 @@ static void virtio_scsi_defer_tmf_to_aio_context(VirtIOSCSIReq *tmf,
 static AioContext *find_aio_context_for_tmf_tag(SCSIDevice *d,
                                                 VirtIOSCSIReq *tmf)
 {
-    WITH_QEMU_LOCK_GUARD(&d->requests_lock) {
-        SCSIRequest *r;
-        SCSIRequest *next;
+    SCSIRequestShard *shard;
 
-        QTAILQ_FOREACH_SAFE(r, &d->requests, next, next) {
-            VirtIOSCSIReq *cmd_req = r->hba_private;
+    SCSI_DEVICE_FOREACH_SHARD(d, shard) {
+        WITH_QEMU_LOCK_GUARD(&shard->lock) {
+            SCSIRequest *r;
+            SCSIRequest *next;
 
-            /* hba_private is non-NULL while the request is enqueued */
-            assert(cmd_req);
+            QTAILQ_FOREACH_SAFE(r, &shard->requests, next, next) {
+                VirtIOSCSIReq *cmd_req = r->hba_private;
 
-            if (cmd_req->req.cmd.tag == tmf->req.tmf.tag) {
-                return r->ctx;
+                /* hba_private is non-NULL while the request is enqueued */
+                assert(cmd_req);
+
+                if (cmd_req->req.cmd.tag == tmf->req.tmf.tag) {
+                    return r->ctx;
+                }
             }
         }
     }
@@ -466,6 +481,7 @@ static AioContext *find_aio_context_for_tmf_tag(SCSIDevice *d,
 static int virtio_scsi_do_tmf(VirtIOSCSI *s, VirtIOSCSIReq *req)
 {
     SCSIDevice *d = virtio_scsi_device_get(s, req->req.tmf.lun);
+    SCSIRequestShard *shard;
     SCSIRequest *r, *next;
     AioContext *ctx;
     int ret = 0;
@@ -508,18 +524,21 @@ static int virtio_scsi_do_tmf(VirtIOSCSI *s, VirtIOSCSIReq *req)
             goto incorrect_lun;
         }
 
-        WITH_QEMU_LOCK_GUARD(&d->requests_lock) {
-            QTAILQ_FOREACH(r, &d->requests, next) {
-                VirtIOSCSIReq *cmd_req = r->hba_private;
-                assert(cmd_req); /* request has hba_private while enqueued */
-
-                if (cmd_req->req.cmd.tag == req->req.tmf.tag) {
-                    /*
-                     * "If the specified command is present in the task set,
-                     * then return a service response set to FUNCTION
-                     * SUCCEEDED".
-                     */
-                    req->resp.tmf.response = VIRTIO_SCSI_S_FUNCTION_SUCCEEDED;
+        SCSI_DEVICE_FOREACH_SHARD(d, shard) {
+            WITH_QEMU_LOCK_GUARD(&shard->lock) {
+                QTAILQ_FOREACH(r, &shard->requests, next) {
+                    VirtIOSCSIReq *cmd_req = r->hba_private;
+                    assert(cmd_req); /* has hba_private while enqueued */
+
+                    if (cmd_req->req.cmd.tag == req->req.tmf.tag) {
+                        /*
+                         * "If the specified command is present in the task
+                         * set, then return a service response set to FUNCTION
+                         * SUCCEEDED".
+                         */
+                        req->resp.tmf.response =
+                            VIRTIO_SCSI_S_FUNCTION_SUCCEEDED;
+                    }
                 }
             }
         }
@@ -591,17 +610,19 @@ static int virtio_scsi_do_tmf(VirtIOSCSI *s, VirtIOSCSIReq *req)
             goto incorrect_lun;
         }
 
-        WITH_QEMU_LOCK_GUARD(&d->requests_lock) {
-            QTAILQ_FOREACH_SAFE(r, &d->requests, next, next) {
-                /* Request has hba_private while enqueued */
-                assert(r->hba_private);
+        SCSI_DEVICE_FOREACH_SHARD(d, shard) {
+            WITH_QEMU_LOCK_GUARD(&shard->lock) {
+                QTAILQ_FOREACH_SAFE(r, &shard->requests, next, next) {
+                    /* Request has hba_private while enqueued */
+                    assert(r->hba_private);
 
-                /*
-                 * "If there is any command present in the task set, then
-                 * return a service response set to FUNCTION SUCCEEDED".
-                 */
-                req->resp.tmf.response = VIRTIO_SCSI_S_FUNCTION_SUCCEEDED;
-                break;
+                    /*
+                     * "If there is any command present in the task set, then
+                     * return a service response set to FUNCTION SUCCEEDED".
+                     */
+                    req->resp.tmf.response = VIRTIO_SCSI_S_FUNCTION_SUCCEEDED;
+                    break;
+                }
             }
         }
         break;
@@ -829,6 +850,17 @@ static QEMUSGList *virtio_scsi_get_sg_list(SCSIRequest *r)
     return &req->qsgl;
 }
 
+static QEMUIOVector *virtio_scsi_get_iov(SCSIRequest *r)
+{
+    VirtIOSCSIReq *req = r->hba_private;
+
+    /* dma_blk_io() only transfers whole sectors, keep using it otherwise */
+    if (!QEMU_IS_ALIGNED(req->data_iov.size, BDRV_SECTOR_SIZE)) {
+        return NULL;
+    }
+    return &req->data_iov;
+}
+
 static void virtio_scsi_request_cancelled(SCSIRequest *r)
 {
     VirtIOSCSIReq *req = r->hba_private;
@@ -1272,6 +1304,7 @@ static struct SCSIBusInfo virtio_scsi_scsi_info = {
     .change = virtio_scsi_change,
     .parse_cdb = virtio_scsi_parse_cdb,
     .get_sg_list = virtio_scsi_get_sg_list,
+    .get_iov = virtio_scsi_get_iov,
     .save_request = virtio_scsi_save_request,
     .load_request = virtio_scsi_load_request,
     .drained_begin = virtio_scsi_drained_begin,
@@ -143,10 +143,84 @@ static bool iommufd_hwpt_dirty_tracking(VFIOIOASHwpt *hwpt)
     return hwpt && hwpt->hwpt_flags & IOMMU_HWPT_ALLOC_DIRTY_TRACKING;
 }
 
+/*
+ * Ranges larger than this are split, and the dirty bitmap of the chunks
+ * is read in parallel.  Reading the bitmap walks the IO page tables,
+ * which is slow for the large ranges of big guests.  The size must be a
+ * multiple of 64 host pages so that each chunk starts on a bitmap word.
+ */
+#define IOMMUFD_DIRTY_CHUNK_SIZE (1 * GiB)
+#define IOMMUFD_DIRTY_THREADS_MAX 8
+
+typedef struct IOMMUFDDirtyQuery {
+    IOMMUFDBackend *be;
+    uint32_t hwpt_id;
+    hwaddr iova;
+    hwaddr size;
+    uint64_t *data;
+    Error *err;
+} IOMMUFDDirtyQuery;
+
+static int iommufd_query_dirty_chunk(void *opaque)
+{
+    IOMMUFDDirtyQuery *query = opaque;
+
+    if (!iommufd_backend_get_dirty_bitmap(query->be, query->hwpt_id,
+                                          query->iova, query->size,
+                                          qemu_real_host_page_size(),
+                                          query->data, &query->err)) {
+        return -EINVAL;
+    }
+    return 0;
+}
+
+static bool iommufd_query_dirty_parallel(VFIOIOMMUFDContainer *container,
+                                         uint32_t hwpt_id, uint64_t *data,
+                                         hwaddr iova, hwaddr size,
+                                         Error **errp)
+{
+    unsigned long page_size = qemu_real_host_page_size();
+    size_t chunk_words = IOMMUFD_DIRTY_CHUNK_SIZE / page_size / 64;
+    int n = DIV_ROUND_UP(size, IOMMUFD_DIRTY_CHUNK_SIZE);
+    g_autofree IOMMUFDDirtyQuery *queries = g_new0(IOMMUFDDirtyQuery, n);
+    bool ret = true;
+    int i;
+
+    trace_iommufd_query_dirty_parallel(hwpt_id, iova, size, n);
+
+    thread_pool_set_max_threads(container->dirty_pool,
+                                MIN(n, IOMMUFD_DIRTY_THREADS_MAX));
+    for (i = 0; i < n; i++) {
+        hwaddr offset = (hwaddr)i * IOMMUFD_DIRTY_CHUNK_SIZE;
+
+        queries[i].be = container->be;
+        queries[i].hwpt_id = hwpt_id;
+        queries[i].iova = iova + offset;
+        queries[i].size = MIN(size - offset, IOMMUFD_DIRTY_CHUNK_SIZE);
+        queries[i].data = data + i * chunk_words;
+        thread_pool_submit(container->dirty_pool, iommufd_query_dirty_chunk,
+                           &queries[i], NULL);
+    }
+    thread_pool_wait(container->dirty_pool);
+
+    for (i = 0; i < n; i++) {
+        if (!queries[i].err) {
+            continue;
+        }
+        if (ret) {
+            error_propagate(errp, queries[i].err);
+            ret = false;
+        } else {
+            error_free(queries[i].err);
+        }
+    }
+    return ret;
+}
+
 static int iommufd_set_dirty_page_tracking(const VFIOContainer *bcontainer,
                                            bool start, Error **errp)
 {
-    const VFIOIOMMUFDContainer *container = VFIO_IOMMU_IOMMUFD(bcontainer);
+    VFIOIOMMUFDContainer *container = VFIO_IOMMU_IOMMUFD(bcontainer);
     VFIOIOASHwpt *hwpt;
 
     QLIST_FOREACH(hwpt, &container->hwpt_list, next) {
@@ -160,6 +234,13 @@ static int iommufd_set_dirty_page_tracking(const VFIOContainer *bcontainer,
         }
     }
 
+    if (start && !container->dirty_pool) {
+        container->dirty_pool = thread_pool_new();
+    } else if (!start && container->dirty_pool) {
+        thread_pool_free(container->dirty_pool);
+        container->dirty_pool = NULL;
+    }
+
     return 0;
 
 err:
@@ -186,6 +267,19 @@ static int iommufd_query_dirty_bitmap(const VFIOContainer *bcontainer,
             continue;
         }
 
+        /*
+         * The hwpts share the bitmap and the kernel does not set its bits
+         * atomically, so only the chunks of one hwpt are read in parallel.
+         */
+        if (container->dirty_pool && size > IOMMUFD_DIRTY_CHUNK_SIZE) {
+            if (!iommufd_query_dirty_parallel(container, hwpt->hwpt_id,
+                                              (uint64_t *)vbmap->bitmap,
+                                              iova, size, errp)) {
+                return -EINVAL;
+            }
+            continue;
+        }
+
         if (!iommufd_backend_get_dirty_bitmap(container->be, hwpt->hwpt_id,
                                               iova, size, page_size,
                                               (uint64_t *)vbmap->bitmap,
@@ -453,6 +547,10 @@ static void iommufd_cdev_container_destroy(VFIOIOMMUFDContainer *container)
     }
     vfio_iommufd_cpr_unregister_container(container);
     vfio_listener_unregister(bcontainer);
+    if (container->dirty_pool) {
+        thread_pool_free(container->dirty_pool);
+        container->dirty_pool = NULL;
+    }
     iommufd_backend_free_id(container->be, container->ioas_id);
     object_unref(container);
 }
@@ -10,6 +10,7 @@
 #define HW_VFIO_VFIO_IOMMUFD_H
 
 #include "hw/vfio/vfio-container.h"
+#include "block/thread-pool.h"
 
 typedef struct VFIODevice VFIODevice;
 
@@ -28,6 +29,8 @@ struct VFIOIOMMUFDContainer {
     IOMMUFDBackend *be;
     uint32_t ioas_id;
     QLIST_HEAD(, VFIOIOASHwpt) hwpt_list;
+    /* Queries the dirty bitmap of large ranges, while tracking is started */
+    ThreadPool *dirty_pool;
 };
 
 OBJECT_DECLARE_SIMPLE_TYPE(VFIOIOMMUFDContainer, VFIO_IOMMU_IOMMUFD);
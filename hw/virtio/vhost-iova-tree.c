@@ -134,12 +134,15 @@ void vhost_iova_tree_remove(VhostIOVATree *iova_tree, DMAMap map)
  * @tree: The VhostIOVATree
  * @map: The map with the guest memory address
  *
+ * The GPA->IOVA tree is keyed by guest address and its ranges never overlap,
+ * so this is a tree lookup rather than a walk over every mapping.
+ *
  * Returns the stored GPA->IOVA mapping, or NULL if not found.
  */
 const DMAMap *vhost_iova_tree_find_gpa(const VhostIOVATree *tree,
                                        const DMAMap *map)
 {
-    return iova_tree_find_iova(tree->gpa_iova_map, map);
+    return iova_tree_find(tree->gpa_iova_map, map);
 }
 
 /**
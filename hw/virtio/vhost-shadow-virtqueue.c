@@ -88,6 +88,12 @@ static bool vhost_svq_translate_addr(const VhostShadowVirtqueue *svq,
         return true;
     }
 
+    /*
+     * The descriptors of a chain usually land in the same RAM region, so
+     * reuse the last GPA map found before searching the tree again.
+     */
+    const DMAMap *last_gpa_map = NULL;
+
     for (size_t i = 0; i < num; ++i) {
         Int128 needle_last, map_last;
         size_t off;
@@ -96,12 +102,22 @@ static bool vhost_svq_translate_addr(const VhostShadowVirtqueue *svq,
 
         /* Check if the descriptor is backed by guest memory  */
         if (gpas) {
-            /* Search the GPA->IOVA tree */
+            /*
+             * Search the GPA->IOVA tree for the map containing the first
+             * byte; the end of the buffer is checked against it below.
+             */
             needle = (DMAMap) {
                 .translated_addr = gpas[i],
-                .size = iovec[i].iov_len,
             };
-            map = vhost_iova_tree_find_gpa(svq->iova_tree, &needle);
+            if (last_gpa_map &&
+                gpas[i] >= last_gpa_map->translated_addr &&
+                gpas[i] - last_gpa_map->translated_addr <=
+                last_gpa_map->size) {
+                map = last_gpa_map;
+            } else {
+                map = vhost_iova_tree_find_gpa(svq->iova_tree, &needle);
+                last_gpa_map = map;
+            }
         } else {
             /* Search the IOVA->HVA tree */
             needle = (DMAMap) {
@@ -240,6 +256,11 @@ static void vhost_svq_kick(VhostShadowVirtqueue *svq)
 {
     bool needs_kick;
 
+    if (svq->kicked_avail_idx == svq->shadow_avail_idx) {
+        /* Nothing made available since the last check */
+        return;
+    }
+
     /*
      * We need to expose the available array entries before checking the used
      * flags
@@ -249,11 +270,13 @@ static void vhost_svq_kick(VhostShadowVirtqueue *svq)
     if (virtio_vdev_has_feature(svq->vdev, VIRTIO_RING_F_EVENT_IDX)) {
         uint16_t avail_event = le16_to_cpu(
                 *(uint16_t *)(&svq->vring.used->ring[svq->vring.num]));
-        needs_kick = vring_need_event(avail_event, svq->shadow_avail_idx, svq->shadow_avail_idx - 1);
+        needs_kick = vring_need_event(avail_event, svq->shadow_avail_idx,
+                                      svq->kicked_avail_idx);
     } else {
         needs_kick =
                 !(svq->vring.used->flags & cpu_to_le16(VRING_USED_F_NO_NOTIFY));
     }
+    svq->kicked_avail_idx = svq->shadow_avail_idx;
 
     if (!needs_kick) {
         return;
@@ -262,15 +285,15 @@ static void vhost_svq_kick(VhostShadowVirtqueue *svq)
     event_notifier_set(&svq->hdev_kick);
 }
 
-/**
- * Add an element to a SVQ.
- *
- * Return -EINVAL if element is invalid, -ENOSPC if dev queue is full
+/*
+ * Add an element to a SVQ without notifying the device, so several elements
+ * can be exposed with a single kick.
  */
-int vhost_svq_add(VhostShadowVirtqueue *svq, const struct iovec *out_sg,
-                  size_t out_num, const hwaddr *out_addr,
-                  const struct iovec *in_sg, size_t in_num,
-                  const hwaddr *in_addr, VirtQueueElement *elem)
+static int vhost_svq_add_no_kick(VhostShadowVirtqueue *svq,
+                                 const struct iovec *out_sg, size_t out_num,
+                                 const hwaddr *out_addr,
+                                 const struct iovec *in_sg, size_t in_num,
+                                 const hwaddr *in_addr, VirtQueueElement *elem)
 {
     unsigned qemu_head;
     unsigned ndescs = in_num + out_num;
@@ -289,16 +312,38 @@ int vhost_svq_add(VhostShadowVirtqueue *svq, const struct iovec *out_sg,
     svq->num_free -= ndescs;
     svq->desc_state[qemu_head].elem = elem;
     svq->desc_state[qemu_head].ndescs = ndescs;
-    vhost_svq_kick(svq);
     return 0;
 }
 
-/* Convenience wrapper to add a guest's element to SVQ */
+/**
+ * Add an element to a SVQ.
+ *
+ * Return -EINVAL if element is invalid, -ENOSPC if dev queue is full
+ */
+int vhost_svq_add(VhostShadowVirtqueue *svq, const struct iovec *out_sg,
+                  size_t out_num, const hwaddr *out_addr,
+                  const struct iovec *in_sg, size_t in_num,
+                  const hwaddr *in_addr, VirtQueueElement *elem)
+{
+    int r = vhost_svq_add_no_kick(svq, out_sg, out_num, out_addr, in_sg,
+                                  in_num, in_addr, elem);
+
+    if (r == 0) {
+        vhost_svq_kick(svq);
+    }
+    return r;
+}
+
+/*
+ * Convenience wrapper to add a guest's element to SVQ. The caller must kick
+ * the device once it is done adding elements.
+ */
 static int vhost_svq_add_element(VhostShadowVirtqueue *svq,
                                  VirtQueueElement *elem)
 {
-    return vhost_svq_add(svq, elem->out_sg, elem->out_num, elem->out_addr,
-                         elem->in_sg, elem->in_num, elem->in_addr, elem);
+    return vhost_svq_add_no_kick(svq, elem->out_sg, elem->out_num,
+                                 elem->out_addr, elem->in_sg, elem->in_num,
+                                 elem->in_addr, elem);
 }
 
 /**
@@ -359,12 +404,15 @@ static void vhost_handle_guest_kick(VhostShadowVirtqueue *svq)
                 }
 
                 /* VQ is full or broken, just return and ignore kicks */
+                vhost_svq_kick(svq);
                 return;
             }
             /* elem belongs to SVQ or external caller now */
             elem = NULL;
         }
 
+        /* Notify the device once for the whole batch */
+        vhost_svq_kick(svq);
         virtio_queue_set_notification(svq->vq, true);
     } while (!virtio_queue_empty(svq->vq));
 }
@@ -687,6 +735,7 @@ void vhost_svq_start(VhostShadowVirtqueue *svq, VirtIODevice *vdev,
     event_notifier_set_handler(&svq->hdev_call, vhost_svq_handle_call);
     svq->next_guest_avail_elem = NULL;
     svq->shadow_avail_idx = 0;
+    svq->kicked_avail_idx = 0;
     svq->shadow_used_idx = 0;
     svq->last_used_idx = 0;
     svq->vdev = vdev;
@@ -99,6 +99,9 @@ typedef struct VhostShadowVirtqueue {
     /* Next head to expose to the device */
     uint16_t shadow_avail_idx;
 
+    /* Avail idx at the time of the last device notification check */
+    uint16_t kicked_avail_idx;
+
     /* Next free descriptor */
     uint16_t free_head;
 
@@ -664,17 +664,18 @@ static int send_remove_regions(struct vhost_dev *dev,
     struct vhost_user *u = dev->opaque;
     struct vhost_memory_region *shadow_reg;
     int i, fd, shadow_reg_idx, ret;
+    int nr_replies = 0;
     ram_addr_t offset;
     VhostUserMemoryRegion region_buffer;
 
     /*
-     * The regions in remove_reg appear in the same order they do in the
-     * shadow table. Therefore we can minimize memory copies by iterating
-     * through remove_reg backwards.
+     * Send all the removals before waiting for any reply, so that a
+     * topology change costs one round trip rather than one per region.
+     * The backend handles messages in order, and nothing is unmapped
+     * before every reply has been collected below.
      */
     for (i = nr_rem_reg - 1; i >= 0; i--) {
         shadow_reg = remove_reg[i].region;
-        shadow_reg_idx = remove_reg[i].reg_idx;
 
         vhost_user_get_mr_data(shadow_reg->userspace_addr, &offset, &fd);
 
@@ -687,14 +688,26 @@ static int send_remove_regions(struct vhost_dev *dev,
             if (ret < 0) {
                 return ret;
             }
+            nr_replies++;
+        }
+    }
 
-            if (reply_supported) {
-                ret = process_message_reply(dev, msg);
-                if (ret) {
-                    return ret;
-                }
+    if (reply_supported) {
+        for (i = 0; i < nr_replies; i++) {
+            ret = process_message_reply(dev, msg);
+            if (ret) {
+                return ret;
             }
         }
+    }
+
+    /*
+     * The regions in remove_reg appear in the same order they do in the
+     * shadow table. Therefore we can minimize memory copies by iterating
+     * through remove_reg backwards.
+     */
+    for (i = nr_rem_reg - 1; i >= 0; i--) {
+        shadow_reg_idx = remove_reg[i].reg_idx;
 
         /*
          * At this point we know the backend has unmapped the region. It is now
@@ -717,6 +730,7 @@ static int send_add_regions(struct vhost_dev *dev,
 {
     struct vhost_user *u = dev->opaque;
     int i, fd, ret, reg_idx, reg_fd_idx;
+    int nr_replies = 0;
     struct vhost_memory_region *reg;
     MemoryRegion *mr;
     ram_addr_t offset;
@@ -793,16 +807,27 @@ static int send_add_regions(struct vhost_dev *dev,
                                  dev->mem->regions[reg_idx].guest_phys_addr);
                     return -EPROTO;
                 }
-            } else if (reply_supported) {
-                ret = process_message_reply(dev, msg);
-                if (ret) {
-                    return ret;
-                }
+            } else {
+                /* replies are collected after the last region is sent */
+                nr_replies++;
             }
         } else if (track_ramblocks) {
             u->region_rb_offset[reg_idx] = 0;
             u->region_rb[reg_idx] = NULL;
         }
+    }
+
+    if (reply_supported) {
+        for (i = 0; i < nr_replies; i++) {
+            ret = process_message_reply(dev, msg);
+            if (ret) {
+                return ret;
+            }
+        }
+    }
+
+    for (i = 0; i < nr_add_reg; i++) {
+        reg = add_reg[i].region;
 
         /*
          * At this point, we know the backend has mapped in the new
@@ -1011,6 +1036,7 @@ static int vhost_user_set_mem_table(struct vhost_dev *dev,
     bool config_mem_slots =
         virtio_has_feature(dev->protocol_features,
                            VHOST_USER_PROTOCOL_F_CONFIGURE_MEM_SLOTS);
+    int64_t start = get_clock();
     int ret;
 
     if (do_postcopy) {
@@ -1032,9 +1058,6 @@ static int vhost_user_set_mem_table(struct vhost_dev *dev,
 
     if (config_mem_slots) {
         ret = vhost_user_add_remove_regions(dev, &msg, reply_supported, false);
-        if (ret < 0) {
-            return ret;
-        }
     } else {
         ret = vhost_user_fill_set_mem_table_msg(u, dev, &msg, fds, &fd_num,
                                                 false);
@@ -1043,16 +1066,14 @@ static int vhost_user_set_mem_table(struct vhost_dev *dev,
         }
 
         ret = vhost_user_write(dev, &msg, fds, fd_num);
-        if (ret < 0) {
-            return ret;
-        }
-
-        if (reply_supported) {
-            return process_message_reply(dev, &msg);
+        if (ret >= 0 && reply_supported) {
+            ret = process_message_reply(dev, &msg);
         }
     }
 
-    return 0;
+    trace_vhost_user_set_mem_table(dev, mem->nregions, config_mem_slots,
+                                   (get_clock() - start) / SCALE_US);
+    return ret < 0 ? ret : 0;
 }
 
 static int vhost_user_set_vring_endian(struct vhost_dev *dev,
@@ -163,7 +163,12 @@ static void vhost_vdpa_listener_begin_batch(VhostVDPAShared *s)
     }
 }
 
-static void vhost_vdpa_iotlb_batch_begin_once(VhostVDPAShared *s)
+/*
+ * Open an IOTLB batch if the device supports it and none is open yet. Devices
+ * that program their translations as a whole apply every update sent until
+ * vhost_vdpa_iotlb_batch_end() at once, instead of once per message.
+ */
+void vhost_vdpa_iotlb_batch_begin_once(VhostVDPAShared *s)
 {
     if (s->backend_cap & (0x1ULL << VHOST_BACKEND_F_IOTLB_BATCH) &&
         !s->iotlb_batch_begin_sent) {
@@ -173,9 +178,8 @@ static void vhost_vdpa_iotlb_batch_begin_once(VhostVDPAShared *s)
     s->iotlb_batch_begin_sent = true;
 }
 
-static void vhost_vdpa_listener_commit(MemoryListener *listener)
+void vhost_vdpa_iotlb_batch_end(VhostVDPAShared *s)
 {
-    VhostVDPAShared *s = container_of(listener, VhostVDPAShared, listener);
     struct vhost_msg_v2 msg = {};
     int fd = s->device_fd;
 
@@ -199,6 +203,13 @@ static void vhost_vdpa_listener_commit(MemoryListener *listener)
     s->iotlb_batch_begin_sent = false;
 }
 
+static void vhost_vdpa_listener_commit(MemoryListener *listener)
+{
+    VhostVDPAShared *s = container_of(listener, VhostVDPAShared, listener);
+
+    vhost_vdpa_iotlb_batch_end(s);
+}
+
 static void vhost_vdpa_iommu_map_notify(IOMMUNotifier *n, IOMMUTLBEntry *iotlb)
 {
     struct vdpa_iommu *iommu = container_of(n, struct vdpa_iommu, n);
@@ -1275,6 +1286,8 @@ static bool vhost_vdpa_svqs_start(struct vhost_dev *dev)
         return true;
     }
 
+    /* Send all the ring maps to the device in a single batch */
+    vhost_vdpa_iotlb_batch_begin_once(v->shared);
     for (i = 0; i < v->shadow_vqs->len; ++i) {
         VirtQueue *vq = virtio_get_queue(dev->vdev, dev->vq_index + i);
         VhostShadowVirtqueue *svq = g_ptr_array_index(v->shadow_vqs, i);
@@ -1301,6 +1314,7 @@ static bool vhost_vdpa_svqs_start(struct vhost_dev *dev)
         }
     }
 
+    vhost_vdpa_iotlb_batch_end(v->shared);
     return true;
 
 err_set_addr:
@@ -1316,6 +1330,7 @@ err:
         vhost_vdpa_svq_unmap_rings(dev, svq);
         vhost_svq_stop(svq);
     }
+    vhost_vdpa_iotlb_batch_end(v->shared);
 
     return false;
 }
@@ -1328,6 +1343,7 @@ static void vhost_vdpa_svqs_stop(struct vhost_dev *dev)
         return;
     }
 
+    vhost_vdpa_iotlb_batch_begin_once(v->shared);
     for (unsigned i = 0; i < v->shadow_vqs->len; ++i) {
         VhostShadowVirtqueue *svq = g_ptr_array_index(v->shadow_vqs, i);
 
@@ -1337,6 +1353,7 @@ static void vhost_vdpa_svqs_stop(struct vhost_dev *dev)
         event_notifier_cleanup(&svq->hdev_kick);
         event_notifier_cleanup(&svq->hdev_call);
     }
+    vhost_vdpa_iotlb_batch_end(v->shared);
 }
 
 static void vhost_vdpa_suspend(struct vhost_dev *dev)
@@ -338,13 +338,50 @@ static void balloon_stats_set_poll_interval(Object *obj, Visitor *v,
     balloon_stats_change_timer(s, 0);
 }
 
+/* Reported elements completed at once, and so with a single notification */
+#define VIRTIO_BALLOON_REPORT_BATCH 64
+
+typedef struct VirtIOBalloonDiscard {
+    RAMBlock *rb;
+    ram_addr_t offset;
+    size_t size;
+} VirtIOBalloonDiscard;
+
+static void virtio_balloon_discard_flush(VirtIOBalloonDiscard *d)
+{
+    if (d->rb) {
+        ram_block_discard_range(d->rb, d->offset, d->size);
+        d->rb = NULL;
+    }
+}
+
+/*
+ * The guest reports free pages in chunks of a few MiB that are often
+ * adjacent; merge them so that each contiguous range costs one discard.
+ */
+static void virtio_balloon_discard_add(VirtIOBalloonDiscard *d, RAMBlock *rb,
+                                       ram_addr_t offset, size_t size)
+{
+    if (d->rb == rb && d->offset + d->size == offset) {
+        d->size += size;
+        return;
+    }
+    virtio_balloon_discard_flush(d);
+    d->rb = rb;
+    d->offset = offset;
+    d->size = size;
+}
+
 static void virtio_balloon_handle_report(VirtIODevice *vdev, VirtQueue *vq)
 {
     VirtIOBalloon *dev = VIRTIO_BALLOON(vdev);
+    VirtQueueElement *batch[VIRTIO_BALLOON_REPORT_BATCH];
+    VirtIOBalloonDiscard discard = {};
     VirtQueueElement *elem;
+    unsigned int i, n = 0;
 
-    while ((elem = virtqueue_pop(vq, sizeof(VirtQueueElement)))) {
-        unsigned int i;
+    do {
+        elem = virtqueue_pop(vq, sizeof(VirtQueueElement));
 
         /*
          * When we discard the page it has the effect of removing the page
@@ -353,50 +390,61 @@ static void virtio_balloon_handle_report(VirtIODevice *vdev, VirtQueue *vq)
          * accessible by another device or process, or if the guest is
          * expecting it to retain a non-zero value.
          */
-        if (virtio_balloon_inhibited() || dev->poison_val) {
-            goto skip_element;
-        }
+        if (elem && !virtio_balloon_inhibited() && !dev->poison_val) {
+            for (i = 0; i < elem->in_num; i++) {
+                void *addr = elem->in_sg[i].iov_base;
+                size_t size = elem->in_sg[i].iov_len;
+                ram_addr_t ram_offset;
+                RAMBlock *rb;
+
+                /*
+                 * There is no need to check the memory section to see if
+                 * it is ram/readonly/romd like there is for handle_output
+                 * below. If the region is not meant to be written to then
+                 * address_space_map will have allocated a bounce buffer
+                 * and it will be freed in address_space_unmap and trigger
+                 * and unassigned_mem_write before failing to copy over the
+                 * buffer. If more than one bad descriptor is provided it
+                 * will return NULL after the first bounce buffer and fail
+                 * to map any resources.
+                 */
+                rb = qemu_ram_block_from_host(addr, false, &ram_offset);
+                if (!rb) {
+                    trace_virtio_balloon_bad_addr(elem->in_addr[i]);
+                    continue;
+                }
 
-        for (i = 0; i < elem->in_num; i++) {
-            void *addr = elem->in_sg[i].iov_base;
-            size_t size = elem->in_sg[i].iov_len;
-            ram_addr_t ram_offset;
-            RAMBlock *rb;
+                /*
+                 * For now we will simply ignore unaligned memory regions, or
+                 * regions that overrun the end of the RAMBlock.
+                 */
+                if (!QEMU_IS_ALIGNED(ram_offset | size,
+                                     qemu_ram_pagesize(rb)) ||
+                    (ram_offset + size) > qemu_ram_get_used_length(rb)) {
+                    continue;
+                }
 
-            /*
-             * There is no need to check the memory section to see if
-             * it is ram/readonly/romd like there is for handle_output
-             * below. If the region is not meant to be written to then
-             * address_space_map will have allocated a bounce buffer
-             * and it will be freed in address_space_unmap and trigger
-             * and unassigned_mem_write before failing to copy over the
-             * buffer. If more than one bad descriptor is provided it
-             * will return NULL after the first bounce buffer and fail
-             * to map any resources.
-             */
-            rb = qemu_ram_block_from_host(addr, false, &ram_offset);
-            if (!rb) {
-                trace_virtio_balloon_bad_addr(elem->in_addr[i]);
-                continue;
+                virtio_balloon_discard_add(&discard, rb, ram_offset, size);
             }
+        }
+        if (elem) {
+            batch[n++] = elem;
+        }
 
-            /*
-             * For now we will simply ignore unaligned memory regions, or
-             * regions that overrun the end of the RAMBlock.
-             */
-            if (!QEMU_IS_ALIGNED(ram_offset | size, qemu_ram_pagesize(rb)) ||
-                (ram_offset + size) > qemu_ram_get_used_length(rb)) {
-                continue;
+        /*
+         * The guest may reuse the pages as soon as an element is returned,
+         * so discard everything collected before completing the batch.
+         */
+        if (n && (!elem || n == VIRTIO_BALLOON_REPORT_BATCH)) {
+            virtio_balloon_discard_flush(&discard);
+            for (i = 0; i < n; i++) {
+                virtqueue_push(vq, batch[i], 0);
+                g_free(batch[i]);
             }
-
-            ram_block_discard_range(rb, ram_offset, size);
+            virtio_notify(vdev, vq);
+            n = 0;
         }
-
-skip_element:
-        virtqueue_push(vq, elem, 0);
-        virtio_notify(vdev, vq);
-        g_free(elem);
-    }
+    } while (elem);
 }
 
 static void virtio_balloon_handle_output(VirtIODevice *vdev, VirtQueue *vq)
@@ -14,6 +14,7 @@
 #include "qemu/osdep.h"
 #include "qemu/iov.h"
 #include "qemu/main-loop.h"
+#include "block/aio-wait.h"
 #include "qemu/module.h"
 #include "qapi/error.h"
 #include "qemu/error-report.h"
@@ -497,6 +498,7 @@ static void virtio_crypto_free_request(VirtIOCryptoReq *req)
     }
 
     g_free(req->in_iov);
+    req->vcrypto->inflight--;
     g_free(req);
 }
 
@@ -591,6 +593,7 @@ virtio_crypto_get_request(VirtIOCrypto *s, VirtQueue *vq)
 
     if (req) {
         virtio_crypto_init_request(s, vq, req);
+        s->inflight++;
     }
     return req;
 }
@@ -992,9 +995,20 @@ static uint64_t virtio_crypto_get_features(VirtIODevice *vdev,
     return features;
 }
 
+/*
+ * Backends may complete requests asynchronously (thread pool, lkcf
+ * workers); wait for them before the virtqueues go away under them.
+ */
+static void virtio_crypto_drain(VirtIOCrypto *vcrypto)
+{
+    AIO_WAIT_WHILE(NULL, vcrypto->inflight > 0);
+}
+
 static void virtio_crypto_reset(VirtIODevice *vdev)
 {
     VirtIOCrypto *vcrypto = VIRTIO_CRYPTO(vdev);
+
+    virtio_crypto_drain(vcrypto);
     /* multiqueue is disabled by default */
     vcrypto->curr_queues = 1;
     if (!cryptodev_backend_is_ready(vcrypto->cryptodev)) {
@@ -1103,6 +1117,7 @@ static void virtio_crypto_device_unrealize(DeviceState *dev)
     VirtIOCryptoQueue *q;
     int i, max_queues;
 
+    virtio_crypto_drain(vcrypto);
     max_queues = vcrypto->multiqueue ? vcrypto->max_queues : 1;
     for (i = 0; i < max_queues; i++) {
         virtio_delete_queue(vcrypto->vqs[i].dataq);
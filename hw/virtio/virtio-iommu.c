@@ -79,6 +79,16 @@ static inline uint16_t virtio_iommu_get_bdf(IOMMUDevice *dev)
     return PCI_BUILD_BDF(pci_bus_num(dev->bus), dev->devfn);
 }
 
+/*
+ * Drop the translation cache of all endpoints.  Must be called, with the
+ * mutex held, whenever a mapping is removed or the domain, bypass state or
+ * reserved regions of an endpoint change.
+ */
+static void virtio_iommu_cache_flush(VirtIOIOMMU *s)
+{
+    qatomic_inc(&s->cache_gen);
+}
+
 static bool virtio_iommu_device_bypassed(IOMMUDevice *sdev)
 {
     uint32_t sid;
@@ -313,6 +323,7 @@ static void virtio_iommu_detach_endpoint_from_domain(VirtIOIOMMUEndpoint *ep)
                    ep->iommu_mr);
     QLIST_REMOVE(ep, next);
     ep->domain = NULL;
+    virtio_iommu_cache_flush(sdev->viommu);
     virtio_iommu_switch_address_space(sdev);
 }
 
@@ -511,6 +522,7 @@ static int rebuild_resv_regions(IOMMUDevice *sdev)
     /* free the existing list and rebuild it from scratch */
     g_list_free_full(sdev->resv_regions, g_free);
     sdev->resv_regions = NULL;
+    virtio_iommu_cache_flush(sdev->viommu);
 
     /* First add host reserved regions if any, all tagged as RESERVED */
     for (l = sdev->host_resv_ranges; l; l = l->next) {
@@ -752,6 +764,7 @@ static int virtio_iommu_attach(VirtIOIOMMU *s,
 
     ep->domain = domain;
     sdev = container_of(ep->iommu_mr, IOMMUDevice, iommu_mr);
+    virtio_iommu_cache_flush(s);
     virtio_iommu_switch_address_space(sdev);
 
     /* Replay domain mappings on the associated memory region */
@@ -881,6 +894,7 @@ static int virtio_iommu_unmap(VirtIOIOMMU *s,
                                           current_high);
             }
             g_tree_remove(domain->mappings, iter_key);
+            virtio_iommu_cache_flush(s);
             trace_virtio_iommu_unmap_done(domain_id, current_low, current_high);
         } else {
             ret = VIRTIO_IOMMU_S_RANGE;
@@ -1002,15 +1016,20 @@ static void virtio_iommu_handle_command(VirtIODevice *vdev, VirtQueue *vq)
     VirtQueueElement *elem;
     unsigned int iov_cnt;
     struct iovec *iov;
+    bool notify = false;
     void *buf = NULL;
     size_t sz;
 
+    /*
+     * Guests queue many MAP and UNMAP requests at once when they set up or
+     * tear down DMA, so only notify them when the queue has been drained.
+     */
     for (;;) {
         size_t output_size = sizeof(tail);
 
         elem = virtqueue_pop(vq, sizeof(VirtQueueElement));
         if (!elem) {
-            return;
+            break;
         }
 
         if (iov_size(elem->in_sg, elem->in_num) < sizeof(tail) ||
@@ -1086,11 +1105,15 @@ out:
         assert(sz == output_size);
 
         virtqueue_push(vq, elem, sz);
-        virtio_notify(vdev, vq);
+        notify = true;
         g_free(elem);
         g_free(buf);
         buf = NULL;
     }
+
+    if (notify) {
+        virtio_notify(vdev, vq);
+    }
 }
 
 static void virtio_iommu_report_fault(VirtIOIOMMU *viommu, uint8_t reason,
@@ -1135,6 +1158,56 @@ static void virtio_iommu_report_fault(VirtIOIOMMU *viommu, uint8_t reason,
 
 }
 
+/*
+ * Translate @addr with the last mapping used by @sdev, if it covers @addr
+ * with the requested permissions.  Anything else, including faults, goes
+ * through the slow path.
+ */
+static bool virtio_iommu_cache_lookup(IOMMUDevice *sdev, hwaddr addr,
+                                      IOMMUAccessFlags flag,
+                                      IOMMUTLBEntry *entry)
+{
+    VirtIOIOMMU *s = sdev->viommu;
+    IOMMUTranslationCache *cache;
+    uint32_t perm = 0;
+
+    perm |= (flag & IOMMU_RO) ? VIRTIO_IOMMU_MAP_F_READ : 0;
+    perm |= (flag & IOMMU_WO) ? VIRTIO_IOMMU_MAP_F_WRITE : 0;
+
+    RCU_READ_LOCK_GUARD();
+    cache = qatomic_rcu_read(&sdev->cache);
+    if (!cache || cache->gen != qatomic_read(&s->cache_gen) ||
+        addr < cache->low || addr > cache->high ||
+        (cache->flags & perm) != perm) {
+        return false;
+    }
+
+    entry->translated_addr = addr - cache->low + cache->phys_addr;
+    entry->perm = flag;
+    return true;
+}
+
+/* Must be called with the mutex held */
+static void virtio_iommu_cache_update(IOMMUDevice *sdev,
+                                      VirtIOIOMMUInterval *interval,
+                                      VirtIOIOMMUMapping *mapping)
+{
+    VirtIOIOMMU *s = sdev->viommu;
+    IOMMUTranslationCache *old = sdev->cache;
+    IOMMUTranslationCache *cache = g_new(IOMMUTranslationCache, 1);
+
+    cache->gen = s->cache_gen;
+    cache->low = interval->low;
+    cache->high = interval->high;
+    cache->phys_addr = mapping->phys_addr;
+    cache->flags = mapping->flags;
+
+    qatomic_rcu_set(&sdev->cache, cache);
+    if (old) {
+        g_free_rcu(old, rcu);
+    }
+}
+
 static IOMMUTLBEntry virtio_iommu_translate(IOMMUMemoryRegion *mr, hwaddr addr,
                                             IOMMUAccessFlags flag,
                                             int iommu_idx)
@@ -1168,6 +1241,11 @@ static IOMMUTLBEntry virtio_iommu_translate(IOMMUMemoryRegion *mr, hwaddr addr,
     sid = virtio_iommu_get_bdf(sdev);
 
     trace_virtio_iommu_translate(mr->parent_obj.name, sid, addr, flag);
+    if (virtio_iommu_cache_lookup(sdev, addr, flag, &entry)) {
+        trace_virtio_iommu_translate_out(addr, entry.translated_addr, sid);
+        return entry;
+    }
+
     qemu_rec_mutex_lock(&s->mutex);
 
     ep = g_tree_lookup(s->endpoints, GUINT_TO_POINTER(sid));
@@ -1255,6 +1333,19 @@ static IOMMUTLBEntry virtio_iommu_translate(IOMMUMemoryRegion *mr, hwaddr addr,
     entry.perm = flag;
     trace_virtio_iommu_translate_out(addr, entry.translated_addr, sid);
 
+    /* Reserved regions are checked above, only cache mappings clear of them */
+    for (l = sdev->resv_regions; l; l = l->next) {
+        ReservedRegion *reg = l->data;
+
+        if (range_lob(&reg->range) <= mapping_key->high &&
+            range_upb(&reg->range) >= mapping_key->low) {
+            break;
+        }
+    }
+    if (!l) {
+        virtio_iommu_cache_update(sdev, mapping_key, mapping_value);
+    }
+
 unlock:
     qemu_rec_mutex_unlock(&s->mutex);
     return entry;
@@ -1300,6 +1391,9 @@ static void virtio_iommu_set_config(VirtIODevice *vdev,
             return;
         }
         dev_config->bypass = in_config->bypass;
+        qemu_rec_mutex_lock(&dev->mutex);
+        virtio_iommu_cache_flush(dev);
+        qemu_rec_mutex_unlock(&dev->mutex);
         virtio_iommu_switch_address_space_all(dev);
     }
 
@@ -1393,6 +1487,7 @@ static void virtio_iommu_system_reset(void *opaque)
      * system reset
      */
     s->config.bypass = s->boot_bypass;
+    virtio_iommu_cache_flush(s);
     virtio_iommu_switch_address_space_all(s);
 
 }
@@ -1510,6 +1605,7 @@ static void virtio_iommu_device_reset_exit(Object *obj, ResetType type)
 
     trace_virtio_iommu_device_reset_exit();
 
+    virtio_iommu_cache_flush(s);
     if (s->domains) {
         g_tree_destroy(s->domains);
     }
@@ -1621,6 +1717,7 @@ static int iommu_post_load(void *opaque, int version_id)
     VirtIOIOMMU *s = opaque;
 
     g_tree_foreach(s->domains, reconstruct_endpoints, s);
+    virtio_iommu_cache_flush(s);
 
     /*
      * Memory regions are dynamically turned on/off depending on
@@ -651,17 +651,19 @@ static int virtio_mem_set_block_state(VirtIOMEM *vmem, uint64_t start_gpa,
     return 0;
 }
 
-static int virtio_mem_state_change_request(VirtIOMEM *vmem, uint64_t gpa,
-                                           uint16_t nb_blocks, bool plug)
+/*
+ * Check whether a plug/unplug request can be processed, assuming @plugged_size
+ * bytes are plugged. Returns VIRTIO_MEM_RESP_ACK if the request is acceptable.
+ */
+static uint16_t virtio_mem_check_state_change(const VirtIOMEM *vmem,
+                                              uint64_t gpa, uint64_t size,
+                                              uint64_t plugged_size, bool plug)
 {
-    const uint64_t size = nb_blocks * vmem->block_size;
-    int ret;
-
     if (!virtio_mem_valid_range(vmem, gpa, size)) {
         return VIRTIO_MEM_RESP_ERROR;
     }
 
-    if (plug && (vmem->size + size > vmem->requested_size)) {
+    if (plug && (plugged_size + size > vmem->requested_size)) {
         return VIRTIO_MEM_RESP_NACK;
     }
 
@@ -670,6 +672,20 @@ static int virtio_mem_state_change_request(VirtIOMEM *vmem, uint64_t gpa,
         (!plug && !virtio_mem_is_range_plugged(vmem, gpa, size))) {
         return VIRTIO_MEM_RESP_ERROR;
     }
+    return VIRTIO_MEM_RESP_ACK;
+}
+
+static int virtio_mem_state_change_request(VirtIOMEM *vmem, uint64_t gpa,
+                                           uint16_t nb_blocks, bool plug)
+{
+    const uint64_t size = nb_blocks * vmem->block_size;
+    uint16_t type;
+    int ret;
+
+    type = virtio_mem_check_state_change(vmem, gpa, size, vmem->size, plug);
+    if (type != VIRTIO_MEM_RESP_ACK) {
+        return type;
+    }
 
     ret = virtio_mem_set_block_state(vmem, gpa, size, plug);
     if (ret) {
@@ -684,30 +700,6 @@ static int virtio_mem_state_change_request(VirtIOMEM *vmem, uint64_t gpa,
     return VIRTIO_MEM_RESP_ACK;
 }
 
-static void virtio_mem_plug_request(VirtIOMEM *vmem, VirtQueueElement *elem,
-                                    struct virtio_mem_req *req)
-{
-    const uint64_t gpa = le64_to_cpu(req->u.plug.addr);
-    const uint16_t nb_blocks = le16_to_cpu(req->u.plug.nb_blocks);
-    uint16_t type;
-
-    trace_virtio_mem_plug_request(gpa, nb_blocks);
-    type = virtio_mem_state_change_request(vmem, gpa, nb_blocks, true);
-    virtio_mem_send_response_simple(vmem, elem, type);
-}
-
-static void virtio_mem_unplug_request(VirtIOMEM *vmem, VirtQueueElement *elem,
-                                      struct virtio_mem_req *req)
-{
-    const uint64_t gpa = le64_to_cpu(req->u.unplug.addr);
-    const uint16_t nb_blocks = le16_to_cpu(req->u.unplug.nb_blocks);
-    uint16_t type;
-
-    trace_virtio_mem_unplug_request(gpa, nb_blocks);
-    type = virtio_mem_state_change_request(vmem, gpa, nb_blocks, false);
-    virtio_mem_send_response_simple(vmem, elem, type);
-}
-
 static void virtio_mem_resize_usable_region(VirtIOMEM *vmem,
                                             uint64_t requested_size,
                                             bool can_shrink)
@@ -797,10 +789,139 @@ static void virtio_mem_state_request(VirtIOMEM *vmem, VirtQueueElement *elem,
     virtio_mem_send_response(vmem, elem, &resp);
 }
 
+/*
+ * Guests usually plug/unplug a large range using many requests for
+ * consecutive ranges. Collect such requests while draining the virtqueue, so
+ * the memory backend and RamDiscardListeners (e.g., VFIO) see a single
+ * discard/notification for the whole range.
+ */
+#define VIRTIO_MEM_REQ_BATCH 64
+
+typedef struct VirtIOMEMReqBatch {
+    VirtQueueElement *elems[VIRTIO_MEM_REQ_BATCH];
+    unsigned int nb_elems;
+    bool plug;
+    uint64_t gpa;
+    uint64_t size;
+} VirtIOMEMReqBatch;
+
+static void virtio_mem_flush_req_batch(VirtIOMEM *vmem,
+                                       VirtIOMEMReqBatch *batch)
+{
+    VirtIODevice *vdev = VIRTIO_DEVICE(vmem);
+    struct virtio_mem_resp resp = {
+        .type = cpu_to_le16(VIRTIO_MEM_RESP_ACK),
+    };
+    unsigned int i;
+
+    if (!batch->nb_elems) {
+        return;
+    }
+
+    trace_virtio_mem_flush_req_batch(batch->gpa, batch->size, batch->nb_elems,
+                                     batch->plug);
+    if (virtio_mem_set_block_state(vmem, batch->gpa, batch->size,
+                                   batch->plug)) {
+        resp.type = cpu_to_le16(VIRTIO_MEM_RESP_BUSY);
+    } else {
+        if (batch->plug) {
+            vmem->size += batch->size;
+        } else {
+            vmem->size -= batch->size;
+        }
+        notifier_list_notify(&vmem->size_change_notifiers, &vmem->size);
+    }
+
+    for (i = 0; i < batch->nb_elems; i++) {
+        trace_virtio_mem_send_response(le16_to_cpu(resp.type));
+        iov_from_buf(batch->elems[i]->in_sg, batch->elems[i]->in_num, 0,
+                     &resp, sizeof(resp));
+        virtqueue_push(vmem->vq, batch->elems[i], sizeof(resp));
+        g_free(batch->elems[i]);
+    }
+    virtio_notify(vdev, vmem->vq);
+    batch->nb_elems = 0;
+}
+
+/*
+ * Try adding a plug/unplug request to the batch, flushing the batch first if
+ * the request cannot extend it. Returns false if the request cannot be
+ * batched and has to be processed on its own.
+ */
+static bool virtio_mem_batch_request(VirtIOMEM *vmem, VirtIOMEMReqBatch *batch,
+                                     VirtQueueElement *elem, uint64_t gpa,
+                                     uint16_t nb_blocks, bool plug)
+{
+    const uint64_t size = nb_blocks * vmem->block_size;
+    uint64_t plugged_size;
+
+    if (batch->nb_elems && (batch->plug != plug ||
+                            batch->gpa + batch->size != gpa ||
+                            batch->nb_elems == VIRTIO_MEM_REQ_BATCH)) {
+        virtio_mem_flush_req_batch(vmem, batch);
+    }
+
+    plugged_size = vmem->size;
+    if (batch->nb_elems) {
+        plugged_size += plug ? batch->size : -batch->size;
+    }
+    if (virtio_mem_check_state_change(vmem, gpa, size, plugged_size, plug) !=
+        VIRTIO_MEM_RESP_ACK) {
+        virtio_mem_flush_req_batch(vmem, batch);
+        return false;
+    }
+
+    if (!batch->nb_elems) {
+        batch->plug = plug;
+        batch->gpa = gpa;
+        batch->size = 0;
+    }
+    batch->elems[batch->nb_elems++] = elem;
+    batch->size += size;
+    return true;
+}
+
+/* Returns true if the request was added to @batch. */
+static bool virtio_mem_plug_request(VirtIOMEM *vmem, VirtIOMEMReqBatch *batch,
+                                    VirtQueueElement *elem,
+                                    struct virtio_mem_req *req)
+{
+    const uint64_t gpa = le64_to_cpu(req->u.plug.addr);
+    const uint16_t nb_blocks = le16_to_cpu(req->u.plug.nb_blocks);
+    uint16_t type;
+
+    trace_virtio_mem_plug_request(gpa, nb_blocks);
+    if (virtio_mem_batch_request(vmem, batch, elem, gpa, nb_blocks, true)) {
+        return true;
+    }
+    type = virtio_mem_state_change_request(vmem, gpa, nb_blocks, true);
+    virtio_mem_send_response_simple(vmem, elem, type);
+    return false;
+}
+
+/* Returns true if the request was added to @batch. */
+static bool virtio_mem_unplug_request(VirtIOMEM *vmem, VirtIOMEMReqBatch *batch,
+                                      VirtQueueElement *elem,
+                                      struct virtio_mem_req *req)
+{
+    const uint64_t gpa = le64_to_cpu(req->u.unplug.addr);
+    const uint16_t nb_blocks = le16_to_cpu(req->u.unplug.nb_blocks);
+    uint16_t type;
+
+    trace_virtio_mem_unplug_request(gpa, nb_blocks);
+    if (virtio_mem_batch_request(vmem, batch, elem, gpa, nb_blocks, false)) {
+        return true;
+    }
+    type = virtio_mem_state_change_request(vmem, gpa, nb_blocks, false);
+    virtio_mem_send_response_simple(vmem, elem, type);
+    return false;
+}
+
 static void virtio_mem_handle_request(VirtIODevice *vdev, VirtQueue *vq)
 {
     const int len = sizeof(struct virtio_mem_req);
     VirtIOMEM *vmem = VIRTIO_MEM(vdev);
+    VirtIOMEMReqBatch batch = {};
     VirtQueueElement *elem;
     struct virtio_mem_req req;
     uint16_t type;
@@ -808,10 +929,12 @@ static void virtio_mem_handle_request(VirtIODevice *vdev, VirtQueue *vq)
     while (true) {
         elem = virtqueue_pop(vq, sizeof(VirtQueueElement));
         if (!elem) {
+            virtio_mem_flush_req_batch(vmem, &batch);
             return;
         }
 
         if (iov_to_buf(elem->out_sg, elem->out_num, 0, &req, len) < len) {
+            virtio_mem_flush_req_batch(vmem, &batch);
             virtio_error(vdev, "virtio-mem protocol violation: invalid request"
                          " size: %d", len);
             virtqueue_detach_element(vq, elem, 0);
@@ -821,6 +944,7 @@ static void virtio_mem_handle_request(VirtIODevice *vdev, VirtQueue *vq)
 
         if (iov_size(elem->in_sg, elem->in_num) <
             sizeof(struct virtio_mem_resp)) {
+            virtio_mem_flush_req_batch(vmem, &batch);
             virtio_error(vdev, "virtio-mem protocol violation: not enough space"
                          " for response: %zu",
                          iov_size(elem->in_sg, elem->in_num));
@@ -830,12 +954,21 @@ static void virtio_mem_handle_request(VirtIODevice *vdev, VirtQueue *vq)
         }
 
         type = le16_to_cpu(req.type);
+        if (type != VIRTIO_MEM_REQ_PLUG && type != VIRTIO_MEM_REQ_UNPLUG) {
+            virtio_mem_flush_req_batch(vmem, &batch);
+        }
+
         switch (type) {
         case VIRTIO_MEM_REQ_PLUG:
-            virtio_mem_plug_request(vmem, elem, &req);
+            if (virtio_mem_plug_request(vmem, &batch, elem, &req)) {
+                /* The batch owns the element now. */
+                continue;
+            }
             break;
         case VIRTIO_MEM_REQ_UNPLUG:
-            virtio_mem_unplug_request(vmem, elem, &req);
+            if (virtio_mem_unplug_request(vmem, &batch, elem, &req)) {
+                continue;
+            }
             break;
         case VIRTIO_MEM_REQ_UNPLUG_ALL:
             virtio_mem_unplug_all_request(vmem, elem);
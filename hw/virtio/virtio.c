@@ -20,6 +20,7 @@
 #include "qemu/log.h"
 #include "qemu/main-loop.h"
 #include "qemu/module.h"
+#include "qemu/slab.h"
 #include "qemu/target-info.h"
 #include "qom/object_interfaces.h"
 #include "hw/core/cpu.h"
@@ -144,6 +145,9 @@ struct VirtQueue
     /* Notification enabled? */
     bool notification;
 
+    /* Write one used entry per in-order batch, see virtqueue_ordered_flush */
+    bool in_order_batch;
+
     uint16_t queue_index;
 
     unsigned int inuse;
@@ -581,6 +585,11 @@ bool virtio_queue_get_notification(VirtQueue *vq)
     return vq->notification;
 }
 
+void virtio_queue_set_in_order_batch(VirtQueue *vq, bool enable)
+{
+    vq->in_order_batch = enable;
+}
+
 void virtio_queue_set_notification(VirtQueue *vq, int enable)
 {
     vq->notification = enable;
@@ -764,6 +773,11 @@ int virtio_queue_empty(VirtQueue *vq)
     }
 }
 
+unsigned int virtio_queue_get_inuse(VirtQueue *vq)
+{
+    return vq->inuse;
+}
+
 static bool virtio_queue_split_poll(VirtQueue *vq, unsigned shadow_idx)
 {
     if (unlikely(!vq->vring.avail)) {
@@ -1086,7 +1100,8 @@ static void virtqueue_packed_flush(VirtQueue *vq, unsigned int count)
     /*
      * For indirect element's 'ndescs' is 1.
      * For all other elemment's 'ndescs' is the
-     * number of descriptors chained by NEXT (as set in virtqueue_packed_pop).
+     * number of descriptors chained by NEXT (as set in
+     * virtqueue_packed_pop_head).
      * So When the 'elem' be filled into the descriptor ring,
      * The 'idx' of this 'elem' shall be
      * the value of 'vq->used_idx' plus the 'ndescs'.
@@ -1107,9 +1122,18 @@ static void virtqueue_packed_flush(VirtQueue *vq, unsigned int count)
     }
 }
 
+/*
+ * Publish the run of filled elements that starts at used_idx.  With
+ * in_order_batch, only one used entry is written for the whole run, at
+ * the first position and with the id of the last buffer, as permitted by
+ * VIRTIO_F_IN_ORDER; the driver then takes the other buffers as used too.
+ * Their used length is not reported, so devices only enable this on
+ * queues where the driver ignores it.
+ */
 static void virtqueue_ordered_flush(VirtQueue *vq)
 {
     unsigned int i = vq->used_idx % vq->vring.num;
+    unsigned int last = i;
     unsigned int ndescs = 0;
     uint16_t old = vq->used_idx;
     uint16_t new;
@@ -1137,7 +1161,9 @@ static void virtqueue_ordered_flush(VirtQueue *vq)
          * First entry for packed VQs is written last so the guest
          * doesn't see invalid descriptors.
          */
-        if (packed && i != vq->used_idx) {
+        if (vq->in_order_batch) {
+            /* written once below */
+        } else if (packed && i != vq->used_idx) {
             virtqueue_packed_fill_desc(vq, &vq->used_elems[i], ndescs, false);
         } else if (!packed) {
             uelem.id = vq->used_elems[i].index;
@@ -1146,6 +1172,7 @@ static void virtqueue_ordered_flush(VirtQueue *vq)
         }
 
         vq->used_elems[i].in_order_filled = false;
+        last = i;
         ndescs += vq->used_elems[i].ndescs;
         i += vq->used_elems[i].ndescs;
         if (i >= vq->vring.num) {
@@ -1154,7 +1181,9 @@ static void virtqueue_ordered_flush(VirtQueue *vq)
     }
 
     if (packed) {
-        virtqueue_packed_fill_desc(vq, &vq->used_elems[vq->used_idx], 0, true);
+        virtqueue_packed_fill_desc(vq, &vq->used_elems[vq->in_order_batch ?
+                                                       last : vq->used_idx],
+                                   0, true);
         vq->used_idx += ndescs;
         if (vq->used_idx >= vq->vring.num) {
             vq->used_idx -= vq->vring.num;
@@ -1162,6 +1191,12 @@ static void virtqueue_ordered_flush(VirtQueue *vq)
             vq->signalled_used_valid = false;
         }
     } else {
+        if (vq->in_order_batch) {
+            uelem.id = vq->used_elems[last].index;
+            uelem.len = vq->used_elems[last].len;
+            vring_used_write(vq, &uelem, old % vq->vring.num);
+        }
+
         /* Make sure buffer is written before we update index. */
         smp_wmb();
         new = old + ndescs;
@@ -1690,8 +1725,9 @@ static void *virtqueue_alloc_element(size_t sz, unsigned out_num, unsigned in_nu
     size_t out_sg_end = out_sg_ofs + out_num * sizeof(elem->out_sg[0]);
 
     assert(sz >= sizeof(VirtQueueElement));
-    elem = g_malloc(out_sg_end);
+    elem = qemu_slab_alloc(out_sg_end);
     trace_virtqueue_alloc_element(elem, sz, in_num, out_num);
+    elem->alloc_size = out_sg_end;
     elem->out_num = out_num;
     elem->in_num = in_num;
     elem->in_addr = (void *)elem + in_addr_ofs;
@@ -1701,10 +1737,31 @@ static void *virtqueue_alloc_element(size_t sz, unsigned out_num, unsigned in_nu
     return elem;
 }
 
-static void *virtqueue_split_pop(VirtQueue *vq, size_t sz)
+/*
+ * Called within rcu_read_lock() after virtqueue_split_pop_batch() has checked
+ * that a head is available and that @caches covers the descriptor ring.
+ */
+/*
+ * virtqueue_element_free:
+ * @elem: A #VirtQueueElement (or a struct embedding it at offset 0) returned
+ *        by virtqueue_pop() or qemu_get_virtqueue_element()
+ *
+ * Releases @elem so that its memory can be reused for later elements.  It is
+ * also correct, but slower, to release elements with g_free().
+ */
+void virtqueue_element_free(void *elem)
+{
+    VirtQueueElement *e = elem;
+
+    if (e) {
+        qemu_slab_free(e, e->alloc_size);
+    }
+}
+
+static void *virtqueue_split_pop_head(VirtQueue *vq, size_t sz,
+                                      VRingMemoryRegionCaches *caches)
 {
     unsigned int i, head, max, idx;
-    VRingMemoryRegionCaches *caches;
     MemoryRegionCache indirect_desc_cache;
     MemoryRegionCache *desc_cache;
     int64_t len;
@@ -1718,14 +1775,6 @@ static void *virtqueue_split_pop(VirtQueue *vq, size_t sz)
 
     address_space_cache_init_empty(&indirect_desc_cache);
 
-    RCU_READ_LOCK_GUARD();
-    if (virtio_queue_empty_rcu(vq)) {
-        goto done;
-    }
-    /* Needed after virtio_queue_empty(), see comment in
-     * virtqueue_num_heads(). */
-    smp_rmb();
-
     /* When we start there are none of either input nor output. */
     out_num = in_num = elem_entries = 0;
 
@@ -1740,23 +1789,8 @@ static void *virtqueue_split_pop(VirtQueue *vq, size_t sz)
         goto done;
     }
 
-    if (virtio_vdev_has_feature(vdev, VIRTIO_RING_F_EVENT_IDX)) {
-        vring_set_avail_event(vq, vq->last_avail_idx);
-    }
-
     i = head;
 
-    caches = vring_get_region_caches(vq);
-    if (!caches) {
-        virtio_error(vdev, "Region caches not initialized");
-        goto done;
-    }
-
-    if (caches->desc.len < max * sizeof(VRingDesc)) {
-        virtio_error(vdev, "Cannot map descriptor ring");
-        goto done;
-    }
-
     desc_cache = &caches->desc;
     vring_split_desc_read(vdev, &desc, desc_cache, i);
     if (desc.flags & VRING_DESC_F_INDIRECT) {
@@ -1848,10 +1882,64 @@ err_undo_map:
     goto done;
 }
 
-static void *virtqueue_packed_pop(VirtQueue *vq, size_t sz)
+static unsigned int virtqueue_split_pop_batch(VirtQueue *vq, size_t sz,
+                                              void **elems, unsigned int n)
 {
-    unsigned int i, max;
     VRingMemoryRegionCaches *caches;
+    VirtIODevice *vdev = vq->vdev;
+    uint16_t start_idx = vq->last_avail_idx;
+    unsigned int count = 0;
+    int num_heads;
+
+    RCU_READ_LOCK_GUARD();
+    if (virtio_queue_empty_rcu(vq)) {
+        return 0;
+    }
+
+    /* Also issues the read barrier needed after virtio_queue_empty_rcu() */
+    num_heads = virtqueue_num_heads(vq, vq->last_avail_idx);
+    if (num_heads <= 0) {
+        return 0;
+    }
+
+    caches = vring_get_region_caches(vq);
+    if (!caches) {
+        virtio_error(vdev, "Region caches not initialized");
+        return 0;
+    }
+
+    if (caches->desc.len < vq->vring.num * sizeof(VRingDesc)) {
+        virtio_error(vdev, "Cannot map descriptor ring");
+        return 0;
+    }
+
+    n = MIN(n, num_heads);
+    while (count < n) {
+        void *elem = virtqueue_split_pop_head(vq, sz, caches);
+
+        if (!elem) {
+            break;
+        }
+        elems[count++] = elem;
+    }
+
+    /* A single avail event update covers the whole batch */
+    if (vq->last_avail_idx != start_idx &&
+        virtio_vdev_has_feature(vdev, VIRTIO_RING_F_EVENT_IDX)) {
+        vring_set_avail_event(vq, vq->last_avail_idx);
+    }
+
+    return count;
+}
+
+/*
+ * Called within rcu_read_lock() after virtqueue_packed_pop_batch() has checked
+ * that a descriptor is available and that @caches covers the descriptor ring.
+ */
+static void *virtqueue_packed_pop_head(VirtQueue *vq, size_t sz,
+                                       VRingMemoryRegionCaches *caches)
+{
+    unsigned int i, max;
     MemoryRegionCache indirect_desc_cache;
     MemoryRegionCache *desc_cache;
     int64_t len;
@@ -1866,11 +1954,6 @@ static void *virtqueue_packed_pop(VirtQueue *vq, size_t sz)
 
     address_space_cache_init_empty(&indirect_desc_cache);
 
-    RCU_READ_LOCK_GUARD();
-    if (virtio_queue_packed_empty_rcu(vq)) {
-        goto done;
-    }
-
     /* When we start there are none of either input nor output. */
     out_num = in_num = elem_entries = 0;
 
@@ -1883,17 +1966,6 @@ static void *virtqueue_packed_pop(VirtQueue *vq, size_t sz)
 
     i = vq->last_avail_idx;
 
-    caches = vring_get_region_caches(vq);
-    if (!caches) {
-        virtio_error(vdev, "Region caches not initialized");
-        goto done;
-    }
-
-    if (caches->desc.len < max * sizeof(VRingDesc)) {
-        virtio_error(vdev, "Cannot map descriptor ring");
-        goto done;
-    }
-
     desc_cache = &caches->desc;
     vring_packed_desc_read(vdev, &desc, desc_cache, i, true);
     id = desc.id;
@@ -1998,19 +2070,77 @@ err_undo_map:
     goto done;
 }
 
-void *virtqueue_pop(VirtQueue *vq, size_t sz)
+static unsigned int virtqueue_packed_pop_batch(VirtQueue *vq, size_t sz,
+                                               void **elems, unsigned int n)
 {
-    if (virtio_device_disabled(vq->vdev)) {
-        return NULL;
+    VRingMemoryRegionCaches *caches;
+    VirtIODevice *vdev = vq->vdev;
+    unsigned int count = 0;
+
+    RCU_READ_LOCK_GUARD();
+    if (virtio_queue_packed_empty_rcu(vq)) {
+        return 0;
+    }
+
+    caches = vring_get_region_caches(vq);
+    if (!caches) {
+        virtio_error(vdev, "Region caches not initialized");
+        return 0;
+    }
+
+    if (caches->desc.len < vq->vring.num * sizeof(VRingDesc)) {
+        virtio_error(vdev, "Cannot map descriptor ring");
+        return 0;
+    }
+
+    /* Each descriptor carries its own availability, check it every time */
+    do {
+        void *elem = virtqueue_packed_pop_head(vq, sz, caches);
+
+        if (!elem) {
+            break;
+        }
+        elems[count++] = elem;
+    } while (count < n && !virtio_queue_packed_empty_rcu(vq));
+
+    return count;
+}
+
+/*
+ * virtqueue_pop_batch:
+ * @vq: The #VirtQueue
+ * @sz: The size of each element, at least sizeof(VirtQueueElement)
+ * @elems: Array that receives the popped elements
+ * @n: Maximum number of elements to pop
+ *
+ * Like virtqueue_pop(), but pops up to @n elements with a single lookup of
+ * the vring caches, one avail index read and, for split rings, one avail
+ * event update.  Devices that process requests in a loop should prefer this.
+ *
+ * Returns: the number of elements stored in @elems
+ */
+unsigned int virtqueue_pop_batch(VirtQueue *vq, size_t sz, void **elems,
+                                 unsigned int n)
+{
+    if (virtio_device_disabled(vq->vdev) || !n) {
+        return 0;
     }
 
     if (virtio_vdev_has_feature(vq->vdev, VIRTIO_F_RING_PACKED)) {
-        return virtqueue_packed_pop(vq, sz);
+        return virtqueue_packed_pop_batch(vq, sz, elems, n);
     } else {
-        return virtqueue_split_pop(vq, sz);
+        return virtqueue_split_pop_batch(vq, sz, elems, n);
     }
 }
 
+void *virtqueue_pop(VirtQueue *vq, size_t sz)
+{
+    void *elem = NULL;
+
+    virtqueue_pop_batch(vq, sz, &elem, 1);
+    return elem;
+}
+
 static unsigned int virtqueue_packed_drop_all(VirtQueue *vq)
 {
     VRingMemoryRegionCaches *caches;
@@ -2553,6 +2683,7 @@ void virtio_delete_queue(VirtQueue *vq)
     vq->vring.num = 0;
     vq->vring.num_default = 0;
     vq->handle_output = NULL;
+    vq->in_order_batch = false;
     g_free(vq->used_elems);
     vq->used_elems = NULL;
     virtio_virtqueue_reset_region_cache(vq);
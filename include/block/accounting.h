@@ -27,6 +27,7 @@
 
 #include "qemu/timed-average.h"
 #include "qemu/thread.h"
+#include "qemu/stats64.h"
 #include "qapi/qapi-types-common.h"
 
 typedef struct BlockAcctTimedStats BlockAcctTimedStats;
@@ -79,19 +80,57 @@ typedef struct BlockLatencyHistogram {
     uint64_t *bins;
 } BlockLatencyHistogram;
 
-struct BlockAcctStats {
-    QemuMutex lock;
+/*
+ * Log-linear latency histogram: values below 2^BLOCK_ACCT_LOG_SUB_BITS
+ * nanoseconds have a bucket each, then every power of two is split in
+ * 2^BLOCK_ACCT_LOG_SUB_BITS buckets, up to 2^BLOCK_ACCT_LOG_MAX_BITS
+ * nanoseconds (about 18 minutes).  The relative error of a bucket is at
+ * most 1/2^BLOCK_ACCT_LOG_SUB_BITS.
+ */
+#define BLOCK_ACCT_LOG_SUB_BITS 3
+#define BLOCK_ACCT_LOG_MAX_BITS 40
+#define BLOCK_ACCT_LOG_BUCKETS \
+    ((BLOCK_ACCT_LOG_MAX_BITS - BLOCK_ACCT_LOG_SUB_BITS + 1) << \
+     BLOCK_ACCT_LOG_SUB_BITS)
+
+/*
+ * Counters are split by the AioContext that completes the request, so
+ * that iothreads do not bounce the same cache lines.  They are summed by
+ * block_acct_get_counters().
+ */
+#define BLOCK_ACCT_SHARDS_SHIFT 3
+#define BLOCK_ACCT_SHARDS (1 << BLOCK_ACCT_SHARDS_SHIFT)
+
+typedef struct BlockAcctCounters {
     uint64_t nr_bytes[BLOCK_MAX_IOTYPE];
     uint64_t nr_ops[BLOCK_MAX_IOTYPE];
     uint64_t invalid_ops[BLOCK_MAX_IOTYPE];
     uint64_t failed_ops[BLOCK_MAX_IOTYPE];
     uint64_t total_time_ns[BLOCK_MAX_IOTYPE];
     uint64_t merged[BLOCK_MAX_IOTYPE];
-    int64_t last_access_time_ns;
+} BlockAcctCounters;
+
+typedef struct BlockAcctShard {
+    Stat64 nr_bytes[BLOCK_MAX_IOTYPE];
+    Stat64 nr_ops[BLOCK_MAX_IOTYPE];
+    Stat64 invalid_ops[BLOCK_MAX_IOTYPE];
+    Stat64 failed_ops[BLOCK_MAX_IOTYPE];
+    Stat64 total_time_ns[BLOCK_MAX_IOTYPE];
+    Stat64 merged[BLOCK_MAX_IOTYPE];
+} QEMU_ALIGNED(64) BlockAcctShard;
+
+struct BlockAcctStats {
+    BlockAcctShard shards[BLOCK_ACCT_SHARDS];
+    Stat64 last_access_time_ns;
+    Stat64 latency_log[BLOCK_MAX_IOTYPE][BLOCK_ACCT_LOG_BUCKETS];
+
+    /* Protects the optional statistics below */
+    QemuMutex lock;
     QSLIST_HEAD(, BlockAcctTimedStats) intervals;
+    BlockLatencyHistogram latency_histogram[BLOCK_MAX_IOTYPE];
+
     bool account_invalid;
     bool account_failed;
-    BlockLatencyHistogram latency_histogram[BLOCK_MAX_IOTYPE];
 };
 
 typedef struct BlockAcctCookie {
@@ -115,7 +154,12 @@ void block_acct_failed(BlockAcctStats *stats, BlockAcctCookie *cookie);
 void block_acct_invalid(BlockAcctStats *stats, enum BlockAcctType type);
 void block_acct_merge_done(BlockAcctStats *stats, enum BlockAcctType type,
                            int num_requests);
+void block_acct_get_counters(BlockAcctStats *stats, BlockAcctCounters *c);
+int64_t block_acct_last_access_time_ns(BlockAcctStats *stats);
 int64_t block_acct_idle_time_ns(BlockAcctStats *stats);
+uint64_t block_acct_latency_percentile(BlockAcctStats *stats,
+                                       enum BlockAcctType type,
+                                       unsigned permille);
 double block_acct_queue_depth(BlockAcctTimedStats *stats,
                               enum BlockAcctType type);
 int block_latency_histogram_set(BlockAcctStats *stats, enum BlockAcctType type,
@@ -21,6 +21,7 @@
 #include "qemu/queue.h"
 #include "qemu/event_notifier.h"
 #include "qemu/lockcnt.h"
+#include "qemu/stats64.h"
 #include "qemu/thread.h"
 #include "qemu/timer.h"
 #include "block/graph-lock.h"
@@ -80,8 +81,40 @@ struct CqeHandler {
 };
 
 typedef QSIMPLEQ_HEAD(, CqeHandler) CqeHandlerSimpleQ;
+
+/* One sqe of a chain passed to aio_add_linked_sqes() */
+typedef struct {
+    void (*prep_sqe)(struct io_uring_sqe *sqe, void *opaque);
+    void *opaque;
+    CqeHandler *cqe_handler;
+} AioSqe;
+
+/* io_uring statistics, updated by the AioContext's home thread */
+typedef struct {
+    Stat64 sq_full;     /* times no free sqe was available */
+    Stat64 cq_overflow; /* times the cq ring was found to have overflowed */
+    Stat64 wait;        /* number of fdmon_io_uring_wait() calls */
+} AioIoUringStats;
 #endif /* CONFIG_LINUX_IO_URING */
 
+/* Buckets of the event loop iteration latency histogram, in microseconds */
+#define AIO_LOOP_HIST_BUCKETS 24
+
+/*
+ * Event loop run-time accounting, updated by the AioContext's home thread
+ * while enabled with aio_context_set_handler_stats().  The time spent in a
+ * nested aio_poll() is also accounted to the handler that called it.
+ */
+typedef struct {
+    Stat64 iterations;      /* aio_poll()/aio_dispatch() rounds */
+    Stat64 loop_us[AIO_LOOP_HIST_BUCKETS]; /* log2 histogram of rounds */
+    Stat64 bh_runs;         /* bottom half callbacks */
+    Stat64 bh_ns;
+    Stat64 fd_runs;         /* fd and poll_ready handler callbacks */
+    Stat64 fd_ns;
+    Stat64 handler_max_ns;  /* longest single callback */
+} AioHandlerStats;
+
 /* Callbacks for file descriptor monitoring implementations */
 typedef struct {
     /*
@@ -198,6 +231,16 @@ typedef struct {
     void (*add_sqe)(AioContext *ctx,
                     void (*prep_sqe)(struct io_uring_sqe *sqe, void *opaque),
                     void *opaque, CqeHandler *cqe_handler);
+
+    /**
+     * add_linked_sqes: Add a chain of io_uring sqes for submission.
+     * @sqes: the sqes in the order they must be executed
+     * @nr: number of elements in @sqes
+     *
+     * Like add_sqe(), but each sqe only starts after the previous one in
+     * @sqes completed successfully.
+     */
+    void (*add_linked_sqes)(AioContext *ctx, const AioSqe *sqes, unsigned nr);
 #endif /* CONFIG_LINUX_IO_URING */
 } FDMonOps;
 
@@ -220,6 +263,11 @@ typedef struct AioPolledEvent {
     int64_t ns;        /* current polling time in nanoseconds */
 } AioPolledEvent;
 
+/* Hybrid polling state of an I/O source, see aio_hybrid_poll_submitted() */
+typedef struct AioHybridPoll {
+    int64_t latency_ns; /* moving average of the request latency */
+} AioHybridPoll;
+
 struct AioContext {
     GSource source;
 
@@ -317,6 +365,16 @@ struct AioContext {
 
     /* Pending callback state for cqe handlers */
     CqeHandlerSimpleQ cqe_handler_ready_list;
+
+    /* Does the ring have the fixed buffer and file tables? */
+    bool io_uring_fixed;
+    QLIST_ENTRY(AioContext) io_uring_fixed_next; /* see fdmon-io_uring.c */
+
+    /* Is the ring in SQPOLL mode? */
+    bool io_uring_sqpoll;
+    QLIST_ENTRY(AioContext) io_uring_sqpoll_next; /* see fdmon-io_uring.c */
+
+    AioIoUringStats io_uring_stats;
 #endif /* CONFIG_LINUX_IO_URING */
 
     /* TimerLists for calling timers - one per clock type.  Has its own
@@ -335,6 +393,10 @@ struct AioContext {
     /* AIO engine parameters */
     int64_t aio_max_batch;  /* maximum number of requests in a batch */
 
+    /* Run-time accounting, see aio_context_set_handler_stats() */
+    bool handler_stats_enabled;
+    AioHandlerStats handler_stats;
+
     /*
      * List of handlers participating in userspace polling.  Protected by
      * ctx->list_lock.  Iterated and modified mostly by the event loop thread
@@ -346,6 +408,12 @@ struct AioContext {
     /* Are we in polling mode or monitoring file descriptors? */
     bool poll_started;
 
+    /*
+     * Sleep instead of polling until this QEMU_CLOCK_REALTIME time, or 0.
+     * Only accessed from the event loop thread.
+     */
+    int64_t poll_hybrid_deadline;
+
     /* epoll(7) state used when built with CONFIG_EPOLL */
     int epollfd;
 
@@ -572,6 +640,19 @@ void aio_set_fd_handler(AioContext *ctx,
                         IOHandler *io_poll_ready,
                         void *opaque);
 
+/*
+ * Set polling begin/end callbacks for a file descriptor that has already been
+ * registered with aio_set_fd_handler() including an io_poll() callback.  Do
+ * nothing if the file descriptor is not registered.  The callbacks receive
+ * the opaque pointer of the handler.
+ *
+ * As with aio_set_event_notifier_poll(), io_poll_begin() is not necessarily
+ * always followed by io_poll_end().
+ */
+void aio_set_fd_poll(AioContext *ctx, int fd,
+                     IOHandler *io_poll_begin,
+                     IOHandler *io_poll_end);
+
 /* Register an event notifier and associated callbacks.  Behaves very similarly
  * to event_notifier_set_handler.  Unlike event_notifier_set_handler, these callbacks
  * will be invoked when using aio_poll().
@@ -785,6 +866,22 @@ void aio_co_enter(AioContext *ctx, Coroutine *co);
  */
 AioContext *qemu_get_current_aio_context(void);
 
+/**
+ * qemu_get_current_aio_context_shard:
+ * @shift: log2 of the number of shards, greater than zero
+ *
+ * Return an index between 0 and (1 << @shift) - 1 derived from the
+ * current AioContext, for data that is split among the threads using it
+ * to avoid lock contention.  Different AioContexts may get the same index.
+ */
+static inline unsigned qemu_get_current_aio_context_shard(unsigned shift)
+{
+    uint64_t ctx = (uintptr_t)qemu_get_current_aio_context();
+
+    /* AioContexts are large heap objects, so mix the whole address */
+    return (ctx * 0x9e3779b97f4a7c15ULL) >> (64 - shift);
+}
+
 void qemu_set_current_aio_context(AioContext *ctx);
 
 /**
@@ -819,6 +916,31 @@ void aio_context_set_poll_params(AioContext *ctx, int64_t max_ns,
                                  int64_t grow, int64_t shrink,
                                  Error **errp);
 
+/**
+ * aio_hybrid_poll_submitted:
+ * @ctx: the AioContext that processes the completion
+ * @hp: the hybrid polling state of the I/O source
+ *
+ * Tell @ctx that a request was submitted that is not expected to complete
+ * before half of the average latency recorded in @hp.  Until then
+ * aio_poll() waits for file descriptors, bottom halves and timers instead
+ * of busy polling, and only starts polling afterwards.  This saves CPU time
+ * when the device latency is much longer than the polling time.
+ *
+ * Must be called from @ctx's home thread.
+ */
+void aio_hybrid_poll_submitted(AioContext *ctx, AioHybridPoll *hp);
+
+/**
+ * aio_hybrid_poll_completed:
+ * @hp: the hybrid polling state of the I/O source
+ * @latency_ns: the time between submission and completion of a request
+ *
+ * Add a completed request to the average latency in @hp.  May be called
+ * from any thread.
+ */
+void aio_hybrid_poll_completed(AioHybridPoll *hp, int64_t latency_ns);
+
 /**
  * aio_context_set_aio_params:
  * @ctx: the aio context
@@ -827,6 +949,65 @@ void aio_context_set_poll_params(AioContext *ctx, int64_t max_ns,
  */
 void aio_context_set_aio_params(AioContext *ctx, int64_t max_batch);
 
+/**
+ * aio_context_set_handler_stats:
+ * @ctx: the aio context
+ * @enabled: whether to time callbacks and event loop iterations
+ *
+ * Timing costs two clock reads per callback, so it is off by default.
+ */
+void aio_context_set_handler_stats(AioContext *ctx, bool enabled);
+
+/**
+ * aio_handler_stats_begin:
+ * @ctx: the aio context
+ *
+ * Returns: the start time of a callback or iteration, or 0 if @ctx does not
+ * account run time.
+ */
+static inline int64_t aio_handler_stats_begin(AioContext *ctx)
+{
+    return qatomic_read(&ctx->handler_stats_enabled) ? get_clock() : 0;
+}
+
+/**
+ * aio_handler_stats_end:
+ * @ctx: the aio context
+ * @start: the return value of aio_handler_stats_begin()
+ * @runs: the callback counter to increment
+ * @total_ns: the run-time counter to add to
+ *
+ * Returns: the run time of the callback in nanoseconds
+ */
+int64_t aio_handler_stats_end(AioContext *ctx, int64_t start, Stat64 *runs,
+                              Stat64 *total_ns);
+
+/**
+ * aio_loop_stats_end:
+ * @ctx: the aio context
+ * @start: the return value of aio_handler_stats_begin()
+ *
+ * Account an event loop iteration in the latency histogram.
+ */
+void aio_loop_stats_end(AioContext *ctx, int64_t start);
+
+/**
+ * aio_context_set_io_uring_sqpoll:
+ * @ctx: the aio context
+ * @idle_ms: how long the kernel submission thread keeps polling without work
+ *           before it goes to sleep, 0 means that the kernel default is used
+ *
+ * Switch the AioContext's io_uring to SQPOLL mode so that submitting sqes
+ * does not require a syscall. The kernel submission thread is shared by all
+ * AioContexts in SQPOLL mode.
+ *
+ * Must be called right after aio_context_new() before the AioContext is used.
+ *
+ * Returns: true on success, false on failure
+ */
+bool aio_context_set_io_uring_sqpoll(AioContext *ctx, uint32_t idle_ms,
+                                     Error **errp);
+
 /**
  * aio_context_set_thread_pool_params:
  * @ctx: the aio context
@@ -869,6 +1050,72 @@ static inline bool aio_has_io_uring(void)
  */
 void aio_add_sqe(void (*prep_sqe)(struct io_uring_sqe *sqe, void *opaque),
                  void *opaque, CqeHandler *cqe_handler);
+
+/**
+ * aio_add_linked_sqes: Add a chain of io_uring sqes for submission.
+ * @sqes: the sqes in the order they must be executed
+ * @nr: number of elements in @sqes
+ *
+ * Like aio_add_sqe(), but each sqe only starts after the previous one in
+ * @sqes completed successfully.  If one fails, the following ones complete
+ * with -ECANCELED.  This saves a round trip through the event loop for
+ * dependent requests, e.g. a write followed by fdatasync(2).
+ *
+ * Every sqe still has its own CqeHandler.  The order in which they are invoked
+ * is unspecified.
+ *
+ * This function must be called only when aio_has_io_uring() returns true.
+ */
+void aio_add_linked_sqes(const AioSqe *sqes, unsigned nr);
+
+/* Number of slots in the io_uring fixed buffer and fixed file tables */
+#define AIO_IO_URING_FIXED_BUFS  1024
+#define AIO_IO_URING_FIXED_FILES 256
+
+/**
+ * aio_has_io_uring_fixed: Return whether fixed buffers and files can be used.
+ *
+ * Returns true if the current AioContext's io_uring has the fixed buffer and
+ * fixed file tables that are maintained by aio_io_uring_set_fixed_buf() and
+ * aio_io_uring_set_fixed_file().
+ */
+static inline bool aio_has_io_uring_fixed(void)
+{
+    AioContext *ctx = qemu_get_current_aio_context();
+    return ctx->io_uring_fixed;
+}
+
+/**
+ * aio_io_uring_set_fixed_buf: Update a slot in the fixed buffer table.
+ * @index: slot number less than AIO_IO_URING_FIXED_BUFS
+ * @iov: the buffer to register or NULL to clear the slot
+ *
+ * The slot is updated in the io_uring of every AioContext so that sqes
+ * submitted from any thread can use IORING_OP_READ_FIXED and
+ * IORING_OP_WRITE_FIXED with this buffer index. Buffers are limited to 1 GiB
+ * by the kernel.
+ *
+ * The caller is responsible for slot allocation. Must be called with the BQL
+ * held.
+ *
+ * Returns: 0 on success, -errno on failure
+ */
+int aio_io_uring_set_fixed_buf(unsigned index, const struct iovec *iov);
+
+/**
+ * aio_io_uring_set_fixed_file: Update a slot in the fixed file table.
+ * @index: slot number less than AIO_IO_URING_FIXED_FILES
+ * @fd: the file descriptor to register or -1 to clear the slot
+ *
+ * The slot is updated in the io_uring of every AioContext so that sqes
+ * submitted from any thread can use IOSQE_FIXED_FILE with this index.
+ *
+ * The caller is responsible for slot allocation. Must be called with the BQL
+ * held.
+ *
+ * Returns: 0 on success, -errno on failure
+ */
+int aio_io_uring_set_fixed_file(unsigned index, int fd);
 #endif /* CONFIG_LINUX_IO_URING */
 
 #endif
@@ -44,6 +44,9 @@ int aio_task_pool_status(AioTaskPool *pool);
 void coroutine_fn aio_task_pool_start_task(AioTaskPool *pool, AioTask *task);
 
 void coroutine_fn aio_task_pool_wait_slot(AioTaskPool *pool);
+/* Wait until fewer than @max_busy_tasks tasks are running */
+void coroutine_fn aio_task_pool_wait_busy(AioTaskPool *pool,
+                                         int max_busy_tasks);
 void coroutine_fn aio_task_pool_wait_one(AioTaskPool *pool);
 void coroutine_fn aio_task_pool_wait_all(AioTaskPool *pool);
 
@@ -83,6 +83,21 @@ bool block_copy_call_cancelled(BlockCopyCallState *call_state);
 int block_copy_call_status(BlockCopyCallState *call_state, bool *error_is_read);
 
 void block_copy_set_speed(BlockCopyState *s, uint64_t speed);
+
+/*
+ * Let block-copy adjust the request length and the number of parallel
+ * requests to the throughput and latency it observes.  The max_chunk and
+ * max_workers limits of each call still apply.
+ */
+void block_copy_set_adaptive(BlockCopyState *s, bool adaptive);
+
+/*
+ * Get the current state of adaptive request sizing.  Returns false if it
+ * is not enabled.
+ */
+bool block_copy_get_adaptive_stats(BlockCopyState *s, int64_t *chunk,
+                                   int *workers, uint64_t *throughput,
+                                   int64_t *latency_ns);
 void block_copy_kick(BlockCopyCallState *call_state);
 
 /*
@@ -330,6 +330,22 @@ bdrv_co_copy_range(BdrvChild *src, int64_t src_offset,
                    int64_t bytes, BdrvRequestFlags read_flags,
                    BdrvRequestFlags write_flags);
 
+/**
+ * bdrv_co_share_range:
+ *
+ * Make [@dst_offset, @dst_offset + @bytes) in @child read the same data as
+ * [@src_offset, @src_offset + @bytes) by sharing the underlying storage
+ * instead of copying it.  The ranges must not overlap.  A later write to
+ * either range does not affect the other one.
+ *
+ * Returns: 0 if succeeded; -ENOTSUP if the driver cannot share the ranges,
+ * in which case the caller should write the data itself; other negative
+ * error codes on failure.
+ **/
+int coroutine_fn GRAPH_RDLOCK
+bdrv_co_share_range(BdrvChild *child, int64_t src_offset, int64_t dst_offset,
+                    int64_t bytes);
+
 /*
  * "I/O or GS" API functions. These functions can run without
  * the BQL, but only in one specific iothread/main loop.
@@ -28,6 +28,7 @@
 #include "block/block-common.h"
 #include "block/block-global-state.h"
 #include "block/snapshot.h"
+#include "qemu/interval-tree.h"
 #include "qemu/iov.h"
 #include "qemu/rcu.h"
 #include "qemu/stats64.h"
@@ -56,6 +57,7 @@
 #define BLOCK_OPT_DATA_FILE         "data_file"
 #define BLOCK_OPT_DATA_FILE_RAW     "data_file_raw"
 #define BLOCK_OPT_COMPRESSION_TYPE  "compression_type"
+#define BLOCK_OPT_COMPRESSION_DICT  "compression_dict"
 #define BLOCK_OPT_EXTL2             "extended_l2"
 
 #define BLOCK_PROBE_BUF_SIZE        512
@@ -83,13 +85,31 @@ typedef struct BdrvTrackedRequest {
     int64_t overlap_offset;
     int64_t overlap_bytes;
 
+    struct BdrvTrackedRequestShard *shard;
     QLIST_ENTRY(BdrvTrackedRequest) list;
+    IntervalTreeNode node; /* overlap range in shard->tree */
     Coroutine *co; /* owner, used for deadlock detection */
     CoQueue wait_queue; /* coroutines blocked on this request */
 
+    /* Protected by bs->reqs_lock */
     struct BdrvTrackedRequest *waiting_for;
 } BdrvTrackedRequest;
 
+/*
+ * Tracked requests of a node are split by the AioContext that submits them,
+ * so that iothreads submitting to the same node in multiqueue mode do not
+ * contend on a single lock.  Only serialising requests, and requests issued
+ * while one is in flight, need to look at all shards.
+ */
+#define BDRV_TRACKED_REQ_SHARDS_SHIFT 3
+#define BDRV_TRACKED_REQ_SHARDS (1 << BDRV_TRACKED_REQ_SHARDS_SHIFT)
+
+typedef struct BdrvTrackedRequestShard {
+    QemuMutex lock;
+    QLIST_HEAD(, BdrvTrackedRequest) list;
+    IntervalTreeRoot tree;
+} BdrvTrackedRequestShard;
+
 
 struct BlockDriver {
     /*
@@ -163,6 +183,18 @@ struct BlockDriver {
      */
     bool supports_backing;
 
+    /*
+     * Set to true if the result of .bdrv_co_block_status only ever changes
+     * through write, discard and truncate requests on this very node (or
+     * through operations like snapshot switching or image repair, which
+     * drop the cache explicitly).  Such results are cached by the block
+     * layer, including zero and unallocated extents.
+     *
+     * Must not be set for drivers that derive the status from their
+     * children, since those may be written independently.
+     */
+    bool block_status_cacheable;
+
     /*
      * Drivers setting this field must be able to work with just a plain
      * filename with '<protocol_name>:' as a prefix, and no other options.
@@ -617,6 +649,17 @@ struct BlockDriver {
         BdrvChild *dst, int64_t dst_offset, int64_t bytes,
         BdrvRequestFlags read_flags, BdrvRequestFlags write_flags);
 
+    /*
+     * Make [dst_offset, dst_offset + bytes) refer to the data of
+     * [src_offset, src_offset + bytes) in the same image without copying it.
+     * Return -ENOTSUP if the ranges cannot be shared.
+     *
+     * See the comment of bdrv_co_share_range for the semantics.
+     */
+    int coroutine_fn GRAPH_RDLOCK_PTR (*bdrv_co_share_range)(
+        BlockDriverState *bs, int64_t src_offset, int64_t dst_offset,
+        int64_t bytes);
+
     /*
      * Building block for bdrv_block_status[_above] and
      * bdrv_is_allocated[_above].  The driver should answer only
@@ -1083,22 +1126,48 @@ struct BdrvChild {
     QLIST_ENTRY(BdrvChild GRAPH_RDLOCK_PTR) next_parent;
 };
 
+#define BDRV_BSC_ENTRIES 16
+
+/*
+ * One extent in the block-status cache.
+ *
+ * @start, @end: The extent [start, end) has the same status throughout
+ * @status: Block-status flags as returned by bdrv_co_block_status()
+ * @map: Offset in @file that corresponds to @start
+ *       (if @status has BDRV_BLOCK_OFFSET_VALID)
+ * @file: Node @map refers to
+ * @last_hit: Value of the cache clock at the last lookup that hit this
+ *            extent (accessed with atomic functions)
+ */
+typedef struct BdrvBlockStatusCacheEntry {
+    int64_t start;
+    int64_t end;
+    int status;
+    int64_t map;
+    BlockDriverState *file;
+    unsigned int last_hit;
+} BdrvBlockStatusCacheEntry;
+
 /*
- * Allows bdrv_co_block_status() to cache one data region for a
- * protocol node.
+ * Allows bdrv_co_block_status() to cache up to BDRV_BSC_ENTRIES extents
+ * per node.  Protocol nodes only cache data extents; format drivers that
+ * set BlockDriver.block_status_cacheable also cache zero and unallocated
+ * extents.
+ *
+ * The cache is copy-on-write: readers only dereference it under an RCU
+ * read guard, and updates replace the whole object with
+ * qatomic_cmpxchg().
  *
- * @valid: Whether the cache is valid (should be accessed with atomic
- *         functions so this can be reset by RCU readers)
- * @data_start: Offset where we know (or strongly assume) is data
- * @data_end: Offset where the data region ends (which is not necessarily
- *            the start of a zeroed region)
+ * @nb_entries: Number of valid elements in @entries, which do not overlap
+ * @clock: Incremented on every cache hit, to find the least recently used
+ *         extent on eviction (accessed with atomic functions)
  */
 typedef struct BdrvBlockStatusCache {
     struct rcu_head rcu;
 
-    bool valid;
-    int64_t data_start;
-    int64_t data_end;
+    int nb_entries;
+    unsigned int clock;
+    BdrvBlockStatusCacheEntry entries[BDRV_BSC_ENTRIES];
 } BdrvBlockStatusCache;
 
 struct BlockDriverState {
@@ -1270,9 +1339,12 @@ struct BlockDriverState {
 
     unsigned int write_gen;               /* Current data generation */
 
-    /* Protected by reqs_lock.  */
+    /*
+     * Protected by reqs_lock.  Conflict checks take reqs_lock first, then
+     * the locks of the tracked_requests shards one at a time.
+     */
     QemuMutex reqs_lock;
-    QLIST_HEAD(, BdrvTrackedRequest) tracked_requests;
+    BdrvTrackedRequestShard tracked_requests[BDRV_TRACKED_REQ_SHARDS];
     CoQueue flush_queue;                  /* Serializing flush queue */
     bool active_flush_req;                /* Flush request in flight? */
 
@@ -1282,8 +1354,6 @@ struct BlockDriverState {
     /* BdrvChild links to this node may never be frozen */
     bool never_freeze;
 
-    /* Lock for block-status cache RCU writers */
-    CoMutex bsc_modify_lock;
     /* Always non-NULL, but must only be dereferenced under an RCU read guard */
     BdrvBlockStatusCache *block_status_cache;
 
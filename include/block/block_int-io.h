@@ -166,30 +166,40 @@ bdrv_primary_bs(BlockDriverState *bs)
 }
 
 /**
- * Check whether the given offset is in the cached block-status data
- * region.
+ * Look up @offset in the block-status cache of @bs.
  *
- * If it is, and @pnum is not NULL, *pnum is set to
- * `bsc.data_end - offset`, i.e. how many bytes, starting from
- * @offset, are data (according to the cache).
- * Otherwise, *pnum is not touched.
+ * On a hit, return true and set *status to the cached block-status flags,
+ * *pnum to the number of bytes starting at @offset that share this status,
+ * and *map and *file as bdrv_co_block_status() would.
+ * Otherwise, return false and leave the output parameters untouched.
  */
-bool bdrv_bsc_is_data(BlockDriverState *bs, int64_t offset, int64_t *pnum);
+bool bdrv_bsc_lookup(BlockDriverState *bs, int64_t offset, int *status,
+                     int64_t *pnum, int64_t *map, BlockDriverState **file);
 
 /**
- * If [offset, offset + bytes) overlaps with the currently cached
- * block-status region, invalidate the cache.
+ * Drop all cached extents that overlap [offset, offset + bytes).
  *
- * (To be used by I/O paths that cause data regions to be zero or
- * holes.)
+ * (To be used by I/O paths that change the block status of a range.)
  */
 void bdrv_bsc_invalidate_range(BlockDriverState *bs,
                                int64_t offset, int64_t bytes);
 
 /**
- * Mark the range [offset, offset + bytes) as a data region.
+ * Drop all cached extents of @bs.
  */
-void bdrv_bsc_fill(BlockDriverState *bs, int64_t offset, int64_t bytes);
+void bdrv_bsc_invalidate_all(BlockDriverState *bs);
+
+/**
+ * Cache [offset, offset + bytes) as an extent with the given status,
+ * mapped to @map in @file.
+ *
+ * @write_gen is the value of bs->write_gen before the status was queried.
+ * If a write has completed since, the status may be stale and the extent
+ * is not cached.
+ */
+void bdrv_bsc_fill(BlockDriverState *bs, int64_t offset, int64_t bytes,
+                   int status, int64_t map, BlockDriverState *file,
+                   unsigned int write_gen);
 
 /*
  * Notify all parents that the size of the child changed.
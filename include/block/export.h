@@ -32,6 +32,12 @@ typedef struct BlockExportDriver {
     /* True if the export type supports running on an inactive node */
     bool supports_inactive;
 
+    /*
+     * True if the export type can serve requests from all iothreads listed
+     * in BlockExport.iothreads rather than only from BlockExport.ctx
+     */
+    bool supports_multithread;
+
     /* Creates and starts a new block export */
     int (*create)(BlockExport *, BlockExportOptions *, Error **);
 
@@ -79,6 +85,15 @@ struct BlockExport {
     /* The block device to export */
     BlockBackend *blk;
 
+    /*
+     * The iothreads that the export spreads its work across if the user
+     * gave the iothreads option, each holding a reference.  ctx is the
+     * AioContext of the first one unless the block node could not be
+     * moved there.
+     */
+    struct IOThread **iothreads;
+    size_t num_iothreads;
+
     /* List entry for block_exports */
     QLIST_ENTRY(BlockExport) next;
 };
@@ -91,6 +91,7 @@ typedef struct NBDRequest {
     uint16_t type;  /* NBD_CMD_* */
     NBDMode mode;   /* Determines which network representation to use */
     NBDMetaContexts *contexts; /* Used by NBD_CMD_BLOCK_STATUS */
+    bool zero_copy; /* Server: payload was sent with MSG_ZEROCOPY */
 } NBDRequest;
 
 typedef struct NBDSimpleReply {
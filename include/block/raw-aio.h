@@ -74,16 +74,44 @@ static inline bool laio_has_fua(void)
 #endif
 /* io_uring.c - Linux io_uring implementation */
 #ifdef CONFIG_LINUX_IO_URING
-/* luring_co_submit: submit I/O requests in the thread's current AioContext. */
-int coroutine_fn luring_co_submit(BlockDriverState *bs, int fd, uint64_t offset,
-                                  QEMUIOVector *qiov, int type,
-                                  BdrvRequestFlags flags);
-bool luring_has_fua(void);
-#else
-static inline bool luring_has_fua(void)
-{
-    return false;
-}
+/*
+ * luring_co_submit: submit I/O requests in the thread's current AioContext.
+ * @fixed_file is a slot returned by luring_register_file() or -1.
+ * @hybrid_poll, if not NULL, learns the request latency for hybrid polling.
+ */
+int coroutine_fn luring_co_submit(BlockDriverState *bs, int fd, int fixed_file,
+                                  uint64_t offset, QEMUIOVector *qiov,
+                                  int type, BdrvRequestFlags flags,
+                                  AioHybridPoll *hybrid_poll);
+
+#ifdef HAVE_IO_URING_PREP_FALLOCATE
+/*
+ * luring_co_fallocate: fallocate(2) with @mode in the thread's current
+ * AioContext.  Returns -errno like the system call.  Only use this if
+ * luring_has_fallocate() returns true.
+ */
+int coroutine_fn luring_co_fallocate(BlockDriverState *bs, int fd,
+                                     int fixed_file, int mode,
+                                     uint64_t offset, uint64_t bytes);
+bool luring_has_fallocate(void);
+#endif
+
+/*
+ * Register long-lived memory, typically guest RAM, as io_uring fixed buffers.
+ * Requests with BDRV_REQ_REGISTERED_BUF whose single iovec lies within such
+ * memory are submitted as IORING_OP_READ_FIXED/IORING_OP_WRITE_FIXED.
+ * Registrations are reference counted. Called with the BQL held.
+ */
+bool luring_register_buf(void *host, size_t size, Error **errp);
+void luring_unregister_buf(void *host, size_t size);
+
+/*
+ * Register a file descriptor as an io_uring fixed file. Returns the slot to
+ * pass to luring_co_submit() or -errno. Called with the BQL held.
+ */
+int luring_register_file(int fd);
+int luring_update_file(int fixed_file, int fd);
+void luring_unregister_file(int fixed_file);
 #endif
 
 #ifdef _WIN32
@@ -16,6 +16,7 @@
 #define REQLIST_H
 
 #include "qemu/coroutine.h"
+#include "qemu/interval-tree.h"
 
 /*
  * The API is not thread-safe and shouldn't be. The struct is public to be part
@@ -23,15 +24,20 @@
  * block/block-copy.c for example.
  */
 
+/* Requests are indexed by range, so that conflicts are found in O(log n) */
+typedef IntervalTreeRoot BlockReqList;
+
 typedef struct BlockReq {
     int64_t offset;
     int64_t bytes;
 
     CoQueue wait_queue; /* coroutines blocked on this req */
-    QLIST_ENTRY(BlockReq) list;
+    BlockReqList *reqs;
+    IntervalTreeNode node;
 } BlockReq;
 
-typedef QLIST_HEAD(, BlockReq) BlockReqList;
+/* Initialize an empty list */
+void reqlist_init(BlockReqList *reqs);
 
 /*
  * Initialize new request and add it to the list. Caller must be sure that
@@ -26,6 +26,23 @@ typedef int ThreadPoolFunc(void *opaque);
 
 typedef struct ThreadPoolAio ThreadPoolAio;
 
+/*
+ * Requests of normal priority are always picked up first.  Bulk requests
+ * (e.g. fsync, discard) only ever occupy up to half of the worker threads,
+ * so that they cannot starve latency-sensitive reads and writes.
+ */
+typedef enum ThreadPoolPrio {
+    THREAD_POOL_PRIO_NORMAL,
+    THREAD_POOL_PRIO_BULK,
+    THREAD_POOL_PRIO__MAX,
+} ThreadPoolPrio;
+
+typedef struct ThreadPoolStats {
+    uint64_t requests;      /* requests picked up by a worker */
+    uint64_t wait_ns;       /* total time requests spent in the queue */
+    uint64_t queued;        /* requests currently waiting for a worker */
+} ThreadPoolStats;
+
 ThreadPoolAio *thread_pool_new_aio(struct AioContext *ctx);
 void thread_pool_free_aio(ThreadPoolAio *pool);
 
@@ -35,8 +52,14 @@ void thread_pool_free_aio(ThreadPoolAio *pool);
  */
 BlockAIOCB *thread_pool_submit_aio(ThreadPoolFunc *func, void *arg,
                                    BlockCompletionFunc *cb, void *opaque);
+BlockAIOCB *thread_pool_submit_aio_prio(ThreadPoolFunc *func, void *arg,
+                                        ThreadPoolPrio prio,
+                                        BlockCompletionFunc *cb, void *opaque);
 int coroutine_fn thread_pool_submit_co(ThreadPoolFunc *func, void *arg);
+int coroutine_fn thread_pool_submit_co_prio(ThreadPoolFunc *func, void *arg,
+                                            ThreadPoolPrio prio);
 void thread_pool_update_params(ThreadPoolAio *pool, struct AioContext *ctx);
+void thread_pool_get_stats(ThreadPoolAio *pool, ThreadPoolStats *stats);
 
 /* ------------------------------------------- */
 /* Generic thread pool types and methods below */
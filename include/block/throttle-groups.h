@@ -26,9 +26,26 @@
 #define THROTTLE_GROUPS_H
 
 #include "qemu/coroutine.h"
+#include "qemu/thread.h"
 #include "qemu/throttle.h"
 #include "qom/object.h"
 
+/*
+ * I/O that a ThrottleGroupMember has already accounted in the group but
+ * not submitted yet.  Requests that fit in it are started without taking
+ * the group lock.
+ */
+typedef struct ThrottleGroupCredit {
+    QemuSpin lock;
+    double units;
+    uint64_t bytes;
+    uint64_t op_size; /* cfg.op_size when the credit was granted */
+} ThrottleGroupCredit;
+
+/* One credit per direction for each of this many AioContext shards */
+#define THROTTLE_GROUP_CREDIT_SHARDS_SHIFT 2
+#define THROTTLE_GROUP_CREDIT_SHARDS (1 << THROTTLE_GROUP_CREDIT_SHARDS_SHIFT)
+
 /* The ThrottleGroupMember structure indicates membership in a ThrottleGroup
  * and holds related data.
  */
@@ -57,6 +74,7 @@ typedef struct ThrottleGroupMember {
     unsigned       pending_reqs[THROTTLE_MAX];
     QLIST_ENTRY(ThrottleGroupMember) round_robin;
 
+    ThrottleGroupCredit credit[THROTTLE_MAX][THROTTLE_GROUP_CREDIT_SHARDS];
 } ThrottleGroupMember;
 
 #define TYPE_THROTTLE_GROUP "throttle-group"
@@ -246,6 +246,20 @@ int qemu_chr_fe_write(CharFrontend *c, const uint8_t *buf, int len);
  */
 int qemu_chr_fe_write_all(CharFrontend *c, const uint8_t *buf, int len);
 
+/**
+ * qemu_chr_fe_writev:
+ * @iov: the data
+ * @iovcnt: the number of elements in @iov
+ *
+ * Like @qemu_chr_fe_write, but gathers the data from @iov.  Backends that
+ * support it write all buffers with a single call, e.g. one sendmsg().
+ * This function is thread-safe.
+ *
+ * Returns: the number of bytes consumed (0 if no associated Chardev)
+ *          or -1 on error.
+ */
+int qemu_chr_fe_writev(CharFrontend *c, const struct iovec *iov, int iovcnt);
+
 /**
  * qemu_chr_fe_read_all:
  * @buf: the data buffer
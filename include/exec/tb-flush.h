@@ -29,7 +29,8 @@ void tb_flush__exclusive_or_serial(void);
  *
  * Flush all translation blocks the next time @cs processes the work queue.
  * This should generally be followed by cpu_loop_exit(), so that the work
- * queue is processed promptly.
+ * queue is processed promptly.  Nothing is queued if a flush is already
+ * pending on any vCPU.
  */
 void queue_tb_flush(CPUState *cs);
 
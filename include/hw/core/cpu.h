@@ -31,6 +31,7 @@
 #include "qapi/qapi-types-machine.h"
 #include "qapi/qapi-types-run-state.h"
 #include "qemu/bitmap.h"
+#include "qemu/interval-tree.h"
 #include "qemu/rcu_queue.h"
 #include "qemu/queue.h"
 #include "qemu/lockcnt.h"
@@ -204,8 +205,17 @@ struct CPUClass {
 #define NB_MMU_MODES 22
 typedef uint32_t MMUIdxMap;
 
-/* Use a fully associative victim tlb of 8 entries. */
+/*
+ * The victim tlb is set associative with 8 ways.  By default it has a
+ * single set, i.e. it is fully associative; the number of entries can be
+ * changed with the victim-tlb-size property of the TCG accelerator.
+ */
 #define CPU_VTLB_SIZE 8
+#define CPU_VTLB_WAYS 8
+#define CPU_VTLB_MAX_SIZE 4096
+
+/* Number of large pages tracked individually for each MMU mode. */
+#define CPU_TLB_MAX_LARGE_PAGES 64
 
 /*
  * The full TLB entry, which is not accessed by generated TCG code,
@@ -275,11 +285,18 @@ struct CPUTLBEntryFull {
  * the TCG fast path.
  */
 typedef struct CPUTLBDesc {
+    /*
+     * The large pages allocated into the tlb.  When a page within one
+     * of them is flushed, the entries for the whole large page are
+     * flushed.  The tree holds at most CPU_TLB_MAX_LARGE_PAGES nodes.
+     */
+    IntervalTreeRoot large_pages;
+    size_t n_large_pages;
     /*
      * Describe a region covering all of the large pages allocated
-     * into the tlb.  When any page within this region is flushed,
-     * we must flush the entire tlb.  The region is matched if
-     * (addr & large_page_mask) == large_page_addr.
+     * into the tlb once the tree is full.  When any page within this
+     * region is flushed, we must flush the entire tlb.  The region is
+     * matched if (addr & large_page_mask) == large_page_addr.
      */
     vaddr large_page_addr;
     vaddr large_page_mask;
@@ -288,12 +305,21 @@ typedef struct CPUTLBDesc {
     /* maximum number of entries observed in the window */
     size_t window_max_entries;
     size_t n_used_entries;
-    /* The next index to use in the tlb victim table.  */
+    /* The next way to use in the tlb victim table.  */
     size_t vindex;
+    /* The number of sets of CPU_VTLB_WAYS entries in the victim table.  */
+    size_t vtlb_sets;
     /* The tlb victim table, in two parts.  */
-    CPUTLBEntry vtable[CPU_VTLB_SIZE];
-    CPUTLBEntryFull vfulltlb[CPU_VTLB_SIZE];
+    CPUTLBEntry *vtable;
+    CPUTLBEntryFull *vfulltlb;
     CPUTLBEntryFull *fulltlb;
+    /*
+     * Statistics, read and written atomically like the ones in
+     * CPUTLBCommon: lookups that missed the fast path and were found in
+     * the victim tlb, and lookups that had to call tlb_fill.
+     */
+    size_t victim_hit_count;
+    size_t fill_count;
 } CPUTLBDesc;
 
 /*
@@ -308,6 +334,13 @@ typedef struct CPUTLBCommon {
      * Protected by tlb_c.lock.
      */
     MMUIdxMap dirty;
+    /*
+     * Within pending_flush, for each bit N, another cpu has requested a
+     * flush of mmu_idx N and the work item that performs it has not run
+     * yet.  Further requests covered by these bits are merged into it
+     * instead of queuing more work.  Read and written atomically.
+     */
+    uint32_t pending_flush;
     /*
      * Statistics.  These are not lock protected, but are read and
      * written atomically.  This allows the monitor to print a snapshot
@@ -316,6 +349,7 @@ typedef struct CPUTLBCommon {
     size_t full_flush_count;
     size_t part_flush_count;
     size_t elide_flush_count;
+    size_t coalesced_flush_count;
 } CPUTLBCommon;
 
 /*
@@ -455,8 +489,8 @@ struct qemu_work_item;
  * @accel: Pointer to accelerator specific state.
  * @vcpu_dirty: Hardware accelerator is not synchronized with QEMU state
  * @kvm_fd: vCPU file descriptor for KVM.
- * @work_mutex: Lock to prevent multiple access to @work_list.
- * @work_list: List of pending asynchronous work.
+ * @work_list: Lock-free stack of pending asynchronous work, see
+ *             queue_work_on_cpu().
  * @plugin_state: per-CPU plugin state
  * @ignore_memory_transaction_failures: Cached copy of the MachineState
  *    flag of the same name: allows the board to suppress calling of the
@@ -465,6 +499,8 @@ struct qemu_work_item;
  *    ring is enabled.
  * @kvm_fetch_index: Keeps the index that we last fetched from the per-vCPU
  *    dirty ring structure.
+ * @dirty_ring_full_exits: Number of times this vCPU exited to userspace
+ *    because its KVM dirty ring was full.
  *
  * @neg_align: The CPUState is the common part of a concrete ArchCPU
  * which is allocated when an individual CPU instance is created. As
@@ -512,8 +548,7 @@ struct CPUState {
     uint64_t random_seed;
     sigjmp_buf jmp_env;
 
-    QemuMutex work_mutex;
-    QSIMPLEQ_HEAD(, qemu_work_item) work_list;
+    QSLIST_HEAD(, qemu_work_item) work_list;
 
     struct CPUAddressSpace *cpu_ases;
     int num_ases;
@@ -547,6 +582,7 @@ struct CPUState {
     struct kvm_dirty_gfn *kvm_dirty_gfns;
     uint32_t kvm_fetch_index;
     uint64_t dirty_pages;
+    uint64_t dirty_ring_full_exits;
     int kvm_vcpu_stats_fd;
 
     /* Use by accel-block: CPU is executing an ioctl() */
@@ -24,6 +24,7 @@
 
 #include "hw/i386/x86-iommu.h"
 #include "qemu/iova-tree.h"
+#include "qemu/rcu.h"
 #include "qom/object.h"
 
 #define TYPE_INTEL_IOMMU_DEVICE "intel-iommu"
@@ -100,6 +101,20 @@ typedef struct VTDPASIDCacheEntry {
     bool valid;
 } VTDPASIDCacheEntry;
 
+/*
+ * Last translation of a VTDAddressSpace, looked up without taking the
+ * IOMMU lock.  It is only valid while @gen matches the iotlb_gen of the
+ * IOMMU, which is bumped whenever any cache is invalidated.
+ */
+typedef struct VTDIOTLBCache {
+    struct rcu_head rcu;
+    uint32_t gen;
+    hwaddr iova;
+    hwaddr translated_addr;
+    hwaddr addr_mask;
+    uint8_t access_flags;
+} VTDIOTLBCache;
+
 struct VTDAddressSpace {
     PCIBus *bus;
     uint8_t devfn;
@@ -113,6 +128,7 @@ struct VTDAddressSpace {
     IntelIOMMUState *iommu_state;
     VTDContextCacheEntry context_cache_entry;
     VTDPASIDCacheEntry pasid_cache_entry;
+    VTDIOTLBCache *iotlb_cache;  /* RCU protected */
     QLIST_ENTRY(VTDAddressSpace) next;
     /* Superset of notifier flags that this address space has */
     IOMMUNotifierFlag notifier_flags;
@@ -296,6 +312,7 @@ struct IntelIOMMUState {
 
     uint32_t context_cache_gen;     /* Should be in [1,MAX] */
     GHashTable *iotlb;              /* IOTLB */
+    uint32_t iotlb_gen;             /* Generation of VTDIOTLBCache entries */
 
     GHashTable *vtd_address_spaces;             /* VTD address spaces */
     VTDAddressSpace *vtd_as_cache[VTD_PCI_BUS_MAX]; /* VTD address space cache */
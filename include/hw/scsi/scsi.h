@@ -51,11 +51,30 @@ struct SCSIRequest {
     bool              dma_started;
     BlockAIOCB        *aiocb;
     QEMUSGList        *sg;
+    QEMUIOVector      *iov;
 
-    /* Protected by SCSIDevice->requests_lock */
+    /* Protected by SCSIDevice->requests[shard].lock */
+    unsigned          shard;
     QTAILQ_ENTRY(SCSIRequest) next;
 };
 
+/*
+ * Enqueued requests are spread over several lists, each with its own lock,
+ * so that iothreads submitting to the same device do not share a lock.
+ * Each thread keeps using the same shard.
+ */
+#define SCSI_REQUEST_SHARDS 16
+
+typedef struct SCSIRequestShard {
+    QemuMutex lock; /* protects the requests list */
+    QTAILQ_HEAD(, SCSIRequest) requests;
+} SCSIRequestShard;
+
+/* Iterate over the request shards of a SCSIDevice */
+#define SCSI_DEVICE_FOREACH_SHARD(d, shard) \
+    for ((shard) = &(d)->requests[0];       \
+         (shard) < &(d)->requests[SCSI_REQUEST_SHARDS]; (shard)++)
+
 #define TYPE_SCSI_DEVICE "scsi-device"
 OBJECT_DECLARE_TYPE(SCSIDevice, SCSIDeviceClass, SCSI_DEVICE)
 
@@ -81,8 +100,7 @@ struct SCSIDevice
     uint8_t sense[SCSI_SENSE_BUF_SIZE];
     uint32_t sense_len;
 
-    QemuMutex requests_lock; /* protects the requests list */
-    QTAILQ_HEAD(, SCSIRequest) requests;
+    SCSIRequestShard requests[SCSI_REQUEST_SHARDS];
 
     uint32_t channel;
     uint32_t lun;
@@ -137,6 +155,12 @@ struct SCSIBusInfo {
     void (*cancel)(SCSIRequest *req);
     void (*change)(SCSIBus *bus, SCSIDevice *dev, SCSISense sense);
     QEMUSGList *(*get_sg_list)(SCSIRequest *req);
+    /*
+     * Optional: the same data buffers as get_sg_list(), already mapped into
+     * host memory, or NULL.  Lets disks submit READ and WRITE commands to
+     * the block layer without going through dma_blk_io().
+     */
+    QEMUIOVector *(*get_iov)(SCSIRequest *req);
 
     void (*save_request)(QEMUFile *f, SCSIRequest *req);
     void *(*load_request)(QEMUFile *f, SCSIRequest *req);
@@ -102,6 +102,8 @@ int vhost_vdpa_dma_map(VhostVDPAShared *s, uint32_t asid, hwaddr iova,
                        hwaddr size, void *vaddr, bool readonly);
 int vhost_vdpa_dma_unmap(VhostVDPAShared *s, uint32_t asid, hwaddr iova,
                          hwaddr size);
+void vhost_vdpa_iotlb_batch_begin_once(VhostVDPAShared *s);
+void vhost_vdpa_iotlb_batch_end(VhostVDPAShared *s);
 
 typedef struct vdpa_iommu {
     VhostVDPAShared *dev_shared;
@@ -21,6 +21,7 @@
 #include "system/block-backend.h"
 #include "system/block-ram-registrar.h"
 #include "qom/object.h"
+#include "qemu/stats64.h"
 #include "qapi/qapi-types-virtio.h"
 
 #define TYPE_VIRTIO_BLK "virtio-blk-device"
@@ -48,9 +49,30 @@ struct VirtIOBlkConf
     uint32_t max_discard_sectors;
     uint32_t max_write_zeroes_sectors;
     bool x_enable_wce_if_config_wce;
+    uint32_t irq_coalesce_usecs;
+    uint32_t irq_coalesce_max_frames;
+    bool latency_stats;
 };
 
+/* Buckets of the request latency histograms, log2 of microseconds */
+#define VIRTIO_BLK_LATENCY_BUCKETS 24
+
+/*
+ * Where requests spend their time, for query-stats.  The stages split the
+ * time from virtqueue_pop() to virtqueue_push() of reads and writes:
+ * @submit_us until the request is passed to the BlockBackend (parsing and
+ * merging), and @backend_us until the block layer completes it.
+ * @total_us covers all requests, including the used ring update and
+ * notification.
+ */
+typedef struct VirtIOBlockLatency {
+    Stat64 submit_us[VIRTIO_BLK_LATENCY_BUCKETS];
+    Stat64 backend_us[VIRTIO_BLK_LATENCY_BUCKETS];
+    Stat64 total_us[VIRTIO_BLK_LATENCY_BUCKETS];
+} VirtIOBlockLatency;
+
 struct VirtIOBlockReq;
+typedef struct VirtIOBlockIrqCoalesce VirtIOBlockIrqCoalesce;
 struct VirtIOBlock {
     VirtIODevice parent_obj;
     BlockBackend *blk;
@@ -71,6 +93,16 @@ struct VirtIOBlock {
      */
     AioContext **vq_aio_context;
 
+    /*
+     * Per-virtqueue interrupt coalescing state, NULL when
+     * irq-coalesce-usecs is 0. Each element is only accessed from the
+     * corresponding vq_aio_context[] while ioeventfd is started.
+     */
+    VirtIOBlockIrqCoalesce *irq_coalesce;
+
+    /* Request latency histograms, NULL unless latency-stats is on */
+    VirtIOBlockLatency *latency;
+
     uint64_t host_features;
     size_t config_size;
     BlockRAMRegistrar blk_ram_registrar;
@@ -90,6 +122,8 @@ typedef struct VirtIOBlockReq {
     struct VirtIOBlockReq *next;
     struct VirtIOBlockReq *mr_next;
     BlockAcctCookie acct;
+    int64_t pop_ns;             /* 0 if latency is not measured */
+    int64_t submit_ns;
 } VirtIOBlockReq;
 
 #define VIRTIO_BLK_MAX_MERGE_REQS 32
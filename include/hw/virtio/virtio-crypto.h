@@ -96,6 +96,8 @@ struct VirtIOCrypto {
     uint32_t curr_queues;
     size_t config_size;
     uint8_t vhost_started;
+    /* dataq requests popped but not yet completed by the backend */
+    unsigned int inflight;
 };
 
 #endif /* QEMU_VIRTIO_CRYPTO_H */
@@ -33,6 +33,19 @@ OBJECT_DECLARE_SIMPLE_TYPE(VirtIOIOMMU, VIRTIO_IOMMU)
 
 #define TYPE_VIRTIO_IOMMU_MEMORY_REGION "virtio-iommu-memory-region"
 
+/*
+ * Last mapping used by an endpoint, looked up without taking the mutex.
+ * It is only valid while @gen matches the @cache_gen of the IOMMU.
+ */
+typedef struct IOMMUTranslationCache {
+    struct rcu_head rcu;
+    uint32_t gen;
+    uint64_t low;
+    uint64_t high;
+    uint64_t phys_addr;
+    uint32_t flags;
+} IOMMUTranslationCache;
+
 typedef struct IOMMUDevice {
     void         *viommu;
     PCIBus       *bus;
@@ -43,6 +56,7 @@ typedef struct IOMMUDevice {
     MemoryRegion bypass_mr;     /* The alias of shared memory MR */
     GList *resv_regions;
     GList *host_resv_ranges;
+    IOMMUTranslationCache *cache; /* RCU protected */
 } IOMMUDevice;
 
 typedef struct IOMMUPciBus {
@@ -65,6 +79,7 @@ struct VirtIOIOMMU {
     GTree *domains;
     QemuRecMutex mutex;
     GTree *endpoints;
+    uint32_t cache_gen;
     bool boot_bypass;
     Notifier machine_done;
     bool granule_frozen;
@@ -116,6 +116,7 @@ typedef struct VirtioNetRscSeg {
     uint16_t packets;
     uint16_t dup_ack;
     bool is_coalesced;      /* need recall ipv4 header checksum, mark here */
+    uint16_t mss;           /* largest payload of the coalesced packets */
     VirtioNetRscUnit unit;
     NetClientState *nc;
 } VirtioNetRscSeg;
@@ -139,6 +140,12 @@ typedef struct VirtioNetRscChain {
 #define VIRTIO_NET_RSS_MAX_KEY_SIZE     40
 #define VIRTIO_NET_RSS_MAX_TABLE_LEN    128
 
+/* Queue that last transmitted a flow, see virtio_net_rss_flow_learn() */
+typedef struct VirtioNetRssFlow {
+    uint32_t hash;
+    uint16_t queue;
+} VirtioNetRssFlow;
+
 typedef struct VirtioNetRssData {
     bool    enabled;
     bool    enabled_software_rss;
@@ -153,6 +160,8 @@ typedef struct VirtioNetRssData {
     uint16_t indirections_len;
     uint16_t *indirections_table;
     uint16_t default_queue;
+    uint32_t flow_table_size;
+    VirtioNetRssFlow *flow_table;
 } VirtioNetRssData;
 
 typedef struct VirtIONetQueue {
@@ -164,6 +173,8 @@ typedef struct VirtIONetQueue {
     struct {
         VirtQueueElement *elem;
     } async_tx;
+    /* received buffers filled but not flushed yet, see defer_call() */
+    unsigned int rx_pending;
     struct VirtIONet *n;
 } VirtIONetQueue;
 
@@ -186,6 +197,8 @@ struct VirtIONet {
     uint32_t rsc_timeout;
     uint8_t rsc4_enabled;
     uint8_t rsc6_enabled;
+    /* Coalesce RX segments for guests without VIRTIO_NET_F_RSC_EXT */
+    bool gro;
     uint8_t has_ufo;
     uint32_t mergeable_rx_bufs;
     uint8_t promisc;
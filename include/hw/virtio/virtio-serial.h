@@ -81,6 +81,13 @@ struct VirtIOSerialPortClass {
      */
     ssize_t (*have_data)(VirtIOSerialPort *port, const uint8_t *buf,
                          ssize_t len);
+    /*
+     * Optional: like have_data, but hands over the data of several
+     * queued buffers at once.  If throttling is not enabled on return,
+     * all of the data is considered consumed.
+     */
+    ssize_t (*have_data_iov)(VirtIOSerialPort *port, const struct iovec *iov,
+                             int iovcnt);
 };
 
 /*
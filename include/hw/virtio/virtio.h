@@ -72,6 +72,8 @@ typedef struct VirtQueueElement
     unsigned int in_num;
     /* Element has been processed (VIRTIO_F_IN_ORDER) */
     bool in_order_filled;
+    /* Allocation size, for virtqueue_element_free() */
+    size_t alloc_size;
     hwaddr *in_addr;
     hwaddr *out_addr;
     struct iovec *in_sg;
@@ -279,7 +281,10 @@ void virtqueue_fill(VirtQueue *vq, const VirtQueueElement *elem,
                     unsigned int len, unsigned int idx);
 
 void virtqueue_map(VirtIODevice *vdev, VirtQueueElement *elem);
+void virtqueue_element_free(void *elem);
 void *virtqueue_pop(VirtQueue *vq, size_t sz);
+unsigned int virtqueue_pop_batch(VirtQueue *vq, size_t sz, void **elems,
+                                 unsigned int n);
 unsigned int virtqueue_drop_all(VirtQueue *vq);
 void *qemu_get_virtqueue_element(VirtIODevice *vdev, QEMUFile *f, size_t sz);
 void qemu_put_virtqueue_element(VirtIODevice *vdev, QEMUFile *f,
@@ -321,9 +326,23 @@ void virtio_notify_config(VirtIODevice *vdev);
 bool virtio_queue_get_notification(VirtQueue *vq);
 void virtio_queue_set_notification(VirtQueue *vq, int enable);
 
+/**
+ * virtio_queue_set_in_order_batch:
+ * @vq: the virtqueue
+ * @enable: whether to batch used entries
+ *
+ * When VIRTIO_F_IN_ORDER is negotiated, publish each run of buffers that
+ * completes together with a single used ring entry or used descriptor.
+ * The used length is then only reported for the last buffer of a run, so
+ * only enable this on queues whose driver does not need it.
+ */
+void virtio_queue_set_in_order_batch(VirtQueue *vq, bool enable);
+
 int virtio_queue_ready(VirtQueue *vq);
 
 int virtio_queue_empty(VirtQueue *vq);
+/* Number of descriptors popped by the device and not yet pushed back */
+unsigned int virtio_queue_get_inuse(VirtQueue *vq);
 
 /**
  * Enable notification and check whether guest has added some
@@ -281,4 +281,38 @@ int qio_channel_socket_set_send_buffer(QIOChannelSocket *ioc,
                                        size_t size,
                                        Error **errp);
 
+/**
+ * qio_channel_socket_set_zero_copy:
+ * @ioc: the socket channel object
+ * @errp: pointer to a NULL-initialized error object
+ *
+ * Enable MSG_ZEROCOPY transmission on a connected socket, such
+ * as one returned by qio_channel_socket_accept().  On success
+ * the channel gains QIO_CHANNEL_FEATURE_WRITE_ZERO_COPY.
+ *
+ * Returns: 0 on success, or -1 if the host or the socket
+ * family does not support it.
+ */
+int qio_channel_socket_set_zero_copy(QIOChannelSocket *ioc,
+                                     Error **errp);
+
+/**
+ * qio_channel_socket_zero_copy_completed:
+ * @ioc: the socket channel object
+ * @errp: pointer to a NULL-initialized error object
+ *
+ * Collect the zero copy completion notifications that the
+ * kernel has queued so far, without blocking.  Buffers passed
+ * to writes with QIO_CHANNEL_WRITE_FLAG_ZERO_COPY may be reused
+ * once the returned count reaches the value that
+ * @ioc->zero_copy_queued had right after the write.  This lets
+ * a caller that cannot block in qio_channel_flush() release
+ * buffers incrementally.
+ *
+ * Returns: the number of completed zero copy writes, or -1 on
+ * error.
+ */
+ssize_t qio_channel_socket_zero_copy_completed(QIOChannelSocket *ioc,
+                                               Error **errp);
+
 #endif /* QIO_CHANNEL_SOCKET_H */
@@ -240,6 +240,7 @@ struct tcp_hdr {
     (sizeof(struct eth_header) + 2 * sizeof(struct vlan_header))
 
 #define ETH_MAX_IP4_HDR_LEN   (60)
+#define ETH_MAX_TCP_HDR_LEN   (60)
 #define ETH_MAX_IP_DGRAM_LEN  (0xFFFF)
 
 #define IP_FRAG_UNIT_SIZE     (8)
@@ -61,6 +61,13 @@ typedef int (NetLoad)(NetClientState *);
 typedef void (NetStop)(NetClientState *);
 typedef ssize_t (NetReceive)(NetClientState *, const uint8_t *, size_t);
 typedef ssize_t (NetReceiveIOV)(NetClientState *, const struct iovec *, int);
+/*
+ * Receive up to @count packets at once.  Returns the number of packets that
+ * were consumed (sent or dropped), starting from the first one; the caller
+ * falls back to the per-packet path for the rest.
+ */
+typedef int (NetReceiveBatch)(NetClientState *, const struct iovec **iovs,
+                              const int *iovcnts, int count);
 typedef void (NetCleanup) (NetClientState *);
 typedef void (LinkStatusChanged)(NetClientState *);
 typedef void (NetClientDestructor)(NetClientState *);
@@ -88,6 +95,7 @@ typedef struct NetClientInfo {
     size_t size;
     NetReceive *receive;
     NetReceiveIOV *receive_iov;
+    NetReceiveBatch *receive_batch;
     NetCanReceive *can_receive;
     NetStart *start;
     NetLoad *load;
@@ -188,6 +196,9 @@ ssize_t qemu_sendv_packet(NetClientState *nc, const struct iovec *iov,
                           int iovcnt);
 ssize_t qemu_sendv_packet_async(NetClientState *nc, const struct iovec *iov,
                                 int iovcnt, NetPacketSent *sent_cb);
+int qemu_sendv_packet_batch(NetClientState *nc, const struct iovec **iovs,
+                            const int *iovcnts, int count,
+                            NetPacketSent *sent_cb);
 ssize_t qemu_send_packet(NetClientState *nc, const uint8_t *buf, int size);
 ssize_t qemu_receive_packet(NetClientState *nc, const uint8_t *buf, int size);
 ssize_t qemu_send_packet_raw(NetClientState *nc, const uint8_t *buf, int size);
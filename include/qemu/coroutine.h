@@ -284,6 +284,19 @@ void qemu_coroutine_inc_pool_size(unsigned int additional_pool_size);
  */
 void qemu_coroutine_dec_pool_size(unsigned int additional_pool_size);
 
+typedef struct CoroutinePoolStats {
+    uint64_t created;           /* allocated because the pool was empty */
+    uint64_t deleted;           /* freed because the pool was full */
+    uint64_t refills;           /* batches moved from global to local pools */
+    uint64_t stacks_released;   /* stacks handed back to the host */
+    uint64_t global_pool_size;  /* coroutines currently in the global pool */
+} CoroutinePoolStats;
+
+/**
+ * Get statistics about coroutine creation and the coroutine pool
+ */
+void qemu_coroutine_get_pool_stats(CoroutinePoolStats *stats);
+
 /**
  * Sends a (part of) iovec down a socket, yielding when the socket is full, or
  * Receives data into a (part of) iovec from a socket,
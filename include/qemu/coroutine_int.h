@@ -35,6 +35,12 @@ extern __thread void *__safestack_unsafe_stack_ptr;
 
 #define COROUTINE_STACK_SIZE (1 << 20)
 
+/*
+ * Part of the top of the stack that a terminated coroutine still uses for
+ * the frames of its trampoline, which it resumes in when it is reused
+ */
+#define COROUTINE_STACK_KEEP (64 * 1024)
+
 typedef enum {
     COROUTINE_YIELD = 1,
     COROUTINE_TERMINATE = 2,
@@ -71,6 +77,8 @@ struct Coroutine {
 
 Coroutine *qemu_coroutine_new(void);
 void qemu_coroutine_delete(Coroutine *co);
+/* Let the host reclaim the unused stack memory of a terminated coroutine */
+void qemu_coroutine_release_stack(Coroutine *co);
 CoroutineAction qemu_coroutine_switch(Coroutine *from, Coroutine *to,
                                       CoroutineAction action);
 
@@ -104,6 +104,20 @@ int hbitmap_granularity(const HBitmap *hb);
  */
 uint64_t hbitmap_count(const HBitmap *hb);
 
+/**
+ * hbitmap_count_range:
+ * @hb: HBitmap to operate on.
+ * @start: First bit of the range.
+ * @count: Number of bits in the range.
+ *
+ * Return the number of bits set in the range [@start, @start + @count).
+ * As in hbitmap_count, each group of 2^granularity bits that intersects
+ * the range counts as a whole.  Only the nonzero words are visited, so
+ * this is cheap for sparse bitmaps.
+ */
+uint64_t hbitmap_count_range(const HBitmap *hb, uint64_t start,
+                             uint64_t count);
+
 /**
  * hbitmap_set:
  * @hb: HBitmap to operate on.
@@ -368,6 +368,14 @@ bool qemu_in_main_thread(void);
 #define bql_lock() bql_lock_impl(__FILE__, __LINE__)
 void bql_lock_impl(const char *file, int line);
 
+/**
+ * bql_trylock: Try to lock the Big QEMU Lock (BQL) without blocking.
+ *
+ * Returns true if the lock was taken, false if another thread holds it.
+ */
+#define bql_trylock() bql_trylock_impl(__FILE__, __LINE__)
+bool bql_trylock_impl(const char *file, int line);
+
 /**
  * bql_unlock: Unlock the Big QEMU Lock (BQL).
  *
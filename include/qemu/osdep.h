@@ -718,6 +718,7 @@ unsigned long qemu_getauxval(unsigned long type);
 void qemu_set_tty_echo(int fd, bool echo);
 
 typedef struct ThreadContext ThreadContext;
+typedef struct MemsetContext MemsetContext;
 
 /**
  * qemu_prealloc_mem:
@@ -753,6 +754,37 @@ bool qemu_prealloc_mem(int fd, char *area, size_t sz, int max_threads,
  */
 bool qemu_finish_async_prealloc_mem(Error **errp);
 
+/**
+ * qemu_prealloc_mem_background:
+ * @fd: the fd mapped into the area, -1 for anonymous memory
+ * @area: start address of the are to preallocate
+ * @sz: the size of the area to preallocate
+ * @max_threads: maximum number of threads to use
+ * @tc: prealloc context threads pointer, NULL if not in use
+ * @errp: returns an error if this function fails
+ *
+ * Start preallocating the area like qemu_prealloc_mem(), and return without
+ * waiting for the preallocation to finish.  The area may be used meanwhile,
+ * pages that are accessed before being preallocated are allocated on the
+ * first access as usual.  A failure to preallocate is reported as a warning
+ * only.  Requires MADV_POPULATE_WRITE.
+ *
+ * Return: the context to pass to qemu_prealloc_mem_background_done(), or
+ * NULL setting @errp with error.
+ */
+MemsetContext *qemu_prealloc_mem_background(int fd, char *area, size_t sz,
+                                            int max_threads, ThreadContext *tc,
+                                            Error **errp);
+
+/**
+ * qemu_prealloc_mem_background_done:
+ * @context: the context returned by qemu_prealloc_mem_background()
+ *
+ * Return: true if the background preallocation finished, in which case
+ * @context is freed.
+ */
+bool qemu_prealloc_mem_background_done(MemsetContext *context);
+
 /**
  * qemu_get_pid_name:
  * @pid: pid of a process
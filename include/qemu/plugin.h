@@ -60,6 +60,7 @@ union qemu_plugin_cb_sig {
     qemu_plugin_vcpu_simple_cb_t     vcpu_simple;
     qemu_plugin_vcpu_udata_cb_t      vcpu_udata;
     qemu_plugin_vcpu_discon_cb_t     vcpu_discon;
+    qemu_plugin_vcpu_sample_cb_t     vcpu_sample;
     qemu_plugin_vcpu_tb_trans_cb_t   vcpu_tb_trans;
     qemu_plugin_vcpu_mem_cb_t        vcpu_mem;
     qemu_plugin_vcpu_syscall_cb_t    vcpu_syscall;
@@ -73,6 +74,8 @@ enum plugin_dyn_cb_type {
     PLUGIN_CB_MEM_REGULAR,
     PLUGIN_CB_INLINE_ADD_U64,
     PLUGIN_CB_INLINE_STORE_U64,
+    PLUGIN_CB_INLINE_RECORD_U64,
+    PLUGIN_CB_INLINE_RECORD_VADDR,
 };
 
 struct qemu_plugin_regular_cb {
@@ -123,9 +126,14 @@ struct qemu_plugin_insn {
     bool mem_helper;
 };
 
-/* A scoreboard is an array of values, indexed by vcpu_index */
+/*
+ * A scoreboard is an array of values, indexed by vcpu_index.  For a trace
+ * buffer, each element is a count of records followed by a ring of
+ * trace_entries records (a power of two); trace_entries is 0 otherwise.
+ */
 struct qemu_plugin_scoreboard {
     GArray *data;
+    size_t trace_entries;
     QLIST_ENTRY(qemu_plugin_scoreboard) entry;
 };
 
@@ -143,9 +151,11 @@ struct qemu_plugin_tb {
 /**
  * struct CPUPluginState - per-CPU state for plugins
  * @event_mask: plugin event bitmap. Modified only via async work.
+ * @sample_pending: a sample has been queued but not taken yet.
  */
 struct CPUPluginState {
     DECLARE_BITMAP(event_mask, QEMU_PLUGIN_EV_MAX);
+    bool sample_pending;
 };
 
 /**
@@ -72,11 +72,16 @@ typedef uint64_t qemu_plugin_id_t;
  * - added qemu_plugin_write_memory_hwaddr
  * - added qemu_plugin_write_register
  * - added qemu_plugin_translate_vaddr
+ *
+ * version 6:
+ * - added qemu_plugin_trace_buffer_new and qemu_plugin_trace_buffer_get
+ * - added QEMU_PLUGIN_INLINE_RECORD_U64 and QEMU_PLUGIN_INLINE_RECORD_VADDR
+ * - added qemu_plugin_register_vcpu_sample_cb
  */
 
 extern QEMU_PLUGIN_EXPORT int qemu_plugin_version;
 
-#define QEMU_PLUGIN_VERSION 5
+#define QEMU_PLUGIN_VERSION 6
 
 /**
  * struct qemu_info_t - system information for plugins
@@ -205,6 +210,15 @@ typedef void (*qemu_plugin_vcpu_discon_cb_t)(qemu_plugin_id_t id,
                                              enum qemu_plugin_discon_type type,
                                              uint64_t from_pc, uint64_t to_pc);
 
+/**
+ * typedef qemu_plugin_vcpu_sample_cb_t - vcpu sampling callback
+ * @vcpu_index: the sampled vcpu
+ * @pc: the PC of the next instruction to be executed by the vcpu
+ * @userdata: any plugin data passed at registration
+ */
+typedef void (*qemu_plugin_vcpu_sample_cb_t)(unsigned int vcpu_index,
+                                             uint64_t pc, void *userdata);
+
 /**
  * qemu_plugin_uninstall() - Uninstall a plugin
  * @id: this plugin's opaque ID
@@ -281,6 +295,28 @@ QEMU_PLUGIN_API
 void qemu_plugin_register_vcpu_resume_cb(qemu_plugin_id_t id,
                                          qemu_plugin_vcpu_simple_cb_t cb);
 
+/**
+ * qemu_plugin_register_vcpu_sample_cb() - register a sampling callback
+ * @id: plugin ID
+ * @period_ns: host time between two samples of a vCPU, in nanoseconds
+ * @cb: callback function
+ * @userdata: any plugin data to pass to the @cb
+ *
+ * The @cb function is called from each running vCPU about every
+ * @period_ns nanoseconds of host time, at the next translation block
+ * boundary, with the PC the vCPU will resume execution at.  Halted vCPUs
+ * are not sampled.  Unlike instrumenting every block, this adds no code
+ * to the translated blocks.
+ *
+ * All plugins share one sampling thread, so if several periods are
+ * requested the shortest one is used for all of them.
+ */
+QEMU_PLUGIN_API
+void qemu_plugin_register_vcpu_sample_cb(qemu_plugin_id_t id,
+                                         uint64_t period_ns,
+                                         qemu_plugin_vcpu_sample_cb_t cb,
+                                         void *userdata);
+
 /**
  * qemu_plugin_register_vcpu_discon_cb() - register a discontinuity callback
  * @id: plugin ID
@@ -450,11 +486,20 @@ void qemu_plugin_register_vcpu_tb_exec_cond_cb(struct qemu_plugin_tb *tb,
  *
  * @QEMU_PLUGIN_INLINE_ADD_U64: add an immediate value uint64_t
  * @QEMU_PLUGIN_INLINE_STORE_U64: store an immediate value uint64_t
+ * @QEMU_PLUGIN_INLINE_RECORD_U64: append an immediate value uint64_t to a
+ * trace buffer
+ * @QEMU_PLUGIN_INLINE_RECORD_VADDR: append the virtual address of a memory
+ * access to a trace buffer (memory inline ops only)
+ *
+ * The RECORD ops take as entry the count of a trace buffer (see
+ * qemu_plugin_trace_buffer_new) and ignore @imm for RECORD_VADDR.
  */
 
 enum qemu_plugin_op {
     QEMU_PLUGIN_INLINE_ADD_U64,
     QEMU_PLUGIN_INLINE_STORE_U64,
+    QEMU_PLUGIN_INLINE_RECORD_U64,
+    QEMU_PLUGIN_INLINE_RECORD_VADDR,
 };
 
 /**
@@ -1169,6 +1214,37 @@ QEMU_PLUGIN_API
 void *qemu_plugin_scoreboard_find(struct qemu_plugin_scoreboard *score,
                                   unsigned int vcpu_index);
 
+/**
+ * qemu_plugin_trace_buffer_new() - alloc a new per-vcpu trace buffer
+ *
+ * @n_entries: number of records kept for each vcpu, rounded up to a
+ * power of two
+ *
+ * A trace buffer is a scoreboard whose entries hold a count of records
+ * followed by a ring of the last @n_entries records.  Records are
+ * appended by the QEMU_PLUGIN_INLINE_RECORD_* inline ops, without
+ * calling into the plugin; use qemu_plugin_scoreboard_u64() on the
+ * trace buffer for the count, e.g. with a conditional callback that
+ * drains the buffer when it fills up.  The buffer must be freed using
+ * qemu_plugin_scoreboard_free.
+ */
+QEMU_PLUGIN_API
+struct qemu_plugin_scoreboard *qemu_plugin_trace_buffer_new(size_t n_entries);
+
+/**
+ * qemu_plugin_trace_buffer_get() - read a record of a trace buffer
+ * @buf: trace buffer to query
+ * @vcpu_index: entry index
+ * @seq: sequence number of the record, starting at 0
+ *
+ * Returns record number @seq of @vcpu_index.  Only the last @n_entries
+ * records, i.e. those with @seq >= count - @n_entries, are still in the
+ * buffer; older ones have been overwritten.
+ */
+QEMU_PLUGIN_API
+uint64_t qemu_plugin_trace_buffer_get(struct qemu_plugin_scoreboard *buf,
+                                      unsigned int vcpu_index, uint64_t seq);
+
 /* Macros to define a qemu_plugin_u64 */
 #define qemu_plugin_scoreboard_u64(score) \
     (qemu_plugin_u64) {score, 0}
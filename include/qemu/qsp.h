@@ -19,9 +19,26 @@ enum QSPSortBy {
 void qsp_report(size_t max, enum QSPSortBy sort_by,
                 bool callsite_coalesce);
 
+/*
+ * Called for each call site, coalescing all objects operated on at the call
+ * site, by decreasing total wait time. @call_site is "file:line".
+ */
+typedef void QSPCallSiteFunc(void *opaque, const char *call_site,
+                             const char *type, uint64_t wait_ns,
+                             uint64_t n_acqs);
+
+void qsp_foreach_call_site(size_t max, QSPCallSiteFunc *func, void *opaque);
+
 bool qsp_is_enabled(void);
 void qsp_enable(void);
 void qsp_disable(void);
 void qsp_reset(void);
 
+/*
+ * Profile only one in @period operations in each thread, weighting them so
+ * that reports estimate the totals. A period of 1 profiles every operation.
+ */
+void qsp_set_sample_period(unsigned int period);
+unsigned int qsp_get_sample_period(void);
+
 #endif /* QEMU_QSP_H */
@@ -195,4 +195,18 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC(RCUReadAuto, rcu_read_auto_unlock)
 void rcu_add_force_rcu_notifier(Notifier *n);
 void rcu_remove_force_rcu_notifier(Notifier *n);
 
+typedef struct RCUStats {
+    uint64_t grace_periods;         /* completed synchronize_rcu() calls */
+    uint64_t forced_grace_periods;  /* ... that had to kick readers */
+    uint64_t callbacks;             /* call_rcu() callbacks run */
+    uint64_t callback_backlog_peak; /* largest batch handled at once */
+    uint64_t callbacks_pending;     /* callbacks waiting for a grace period */
+} RCUStats;
+
+/**
+ * rcu_get_stats:
+ * @stats: filled in with grace period and call_rcu() statistics
+ */
+void rcu_get_stats(RCUStats *stats);
+
 #endif /* QEMU_RCU_H */
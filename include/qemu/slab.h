@@ -0,0 +1,35 @@
+/*
+ * Per-thread free lists for frequently allocated objects
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#ifndef QEMU_SLAB_H
+#define QEMU_SLAB_H
+
+/*
+ * Objects are rounded up to a power-of-two size class and recycled through
+ * small per-thread free lists, so that hot paths (e.g. one allocation per
+ * I/O request in an IOThread) avoid the global allocator.
+ *
+ * Every object is a separate g_malloc() allocation, so it is also valid to
+ * release it with g_free(); it just is not recycled in that case.  The size
+ * passed to qemu_slab_free() must be the one passed to qemu_slab_alloc().
+ * Objects may be freed from a different thread than the one that allocated
+ * them.
+ */
+
+void *qemu_slab_alloc(size_t size);
+void qemu_slab_free(void *ptr, size_t size);
+
+/*
+ * qemu_slab_get_stats:
+ * @hits: number of allocations served from a free list
+ * @misses: number of allocations that had to use g_malloc()
+ *
+ * Sums the counters of all threads, including threads that have exited.
+ */
+void qemu_slab_get_stats(uint64_t *hits, uint64_t *misses);
+
+#endif
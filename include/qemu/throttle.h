@@ -156,8 +156,16 @@ bool throttle_schedule_timer(ThrottleState *ts,
                              ThrottleTimers *tt,
                              ThrottleDirection direction);
 
+double throttle_units(ThrottleState *ts, uint64_t size);
+
 void throttle_account(ThrottleState *ts, ThrottleDirection direction,
                       uint64_t size);
+
+void throttle_account_units(ThrottleState *ts, ThrottleDirection direction,
+                            double units, uint64_t size);
+
+void throttle_allowance(ThrottleState *ts, ThrottleDirection direction,
+                        int64_t ns, double *units, uint64_t *size);
 void throttle_limits_to_config(ThrottleLimits *arg, ThrottleConfig *cfg,
                                Error **errp);
 void throttle_config_to_limits(ThrottleConfig *cfg, ThrottleLimits *var);
@@ -86,7 +86,11 @@ struct QEMUTimer {
     QEMUTimerList *timer_list;
     QEMUTimerCB *cb;
     void *opaque;
+    /* pairing heap links: first child, next sibling, previous sibling/parent */
+    QEMUTimer *child;
     QEMUTimer *next;
+    QEMUTimer *prev;
+    uint64_t seq;               /* orders timers with the same expire_time */
     int attributes;
     int scale;
 };
@@ -24,6 +24,7 @@ typedef struct VuFdWatch {
     int fd; /*kick fd*/
     void *pvt;
     vu_watch_cb cb;
+    VuVirtq *vq; /* polled virtqueue, or NULL if only kicks are monitored */
     QTAILQ_ENTRY(VuFdWatch) next;
 } VuFdWatch;
 
@@ -38,6 +39,7 @@ typedef struct {
     QEMUBH *restart_listener_bh;
     AioContext *ctx;
     int max_queues;
+    bool poll_queues; /* busy-poll virtqueues while the AioContext polls */
     const VuDevIface *vu_iface;
 
     unsigned int in_flight; /* atomic */
@@ -58,6 +60,7 @@ bool vhost_user_server_start(VuServer *server,
                              SocketAddress *unix_socket,
                              AioContext *ctx,
                              uint16_t max_queues,
+                             bool poll_queues,
                              const VuDevIface *vu_iface,
                              Error **errp);
 
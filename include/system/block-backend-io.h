@@ -30,6 +30,7 @@ BlockDriverState *blk_bs(BlockBackend *blk);
 void blk_set_allow_write_beyond_eof(BlockBackend *blk, bool allow);
 void blk_set_allow_aio_context_change(BlockBackend *blk, bool allow);
 void blk_set_disable_request_queuing(BlockBackend *blk, bool disable);
+void blk_set_merge_requests(BlockBackend *blk, bool enable);
 bool blk_iostatus_is_enabled(const BlockBackend *blk);
 
 /*
@@ -123,6 +124,8 @@ int coroutine_fn blk_co_copy_range(BlockBackend *blk_in, int64_t off_in,
                                    BlockBackend *blk_out, int64_t off_out,
                                    int64_t bytes, BdrvRequestFlags read_flags,
                                    BdrvRequestFlags write_flags);
+int coroutine_fn blk_co_share_range(BlockBackend *blk, int64_t src_offset,
+                                    int64_t dst_offset, int64_t bytes);
 
 int coroutine_fn blk_co_block_status_above(BlockBackend *blk,
                                            BlockDriverState *base,
@@ -158,6 +158,7 @@ typedef struct DumpState {
     bool resume;
     bool detached;
     bool kdump_raw;
+    bool sparse;                  /* zero pages can be skipped with lseek() */
     hwaddr memory_offset;
     int fd;
 
@@ -36,5 +36,8 @@ struct EventLoopBase {
     /* AioContext thread pool parameters */
     int64_t thread_pool_min;
     int64_t thread_pool_max;
+
+    /* Account callback and iteration run time for query-stats */
+    bool handler_stats;
 };
 #endif
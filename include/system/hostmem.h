@@ -67,6 +67,10 @@ struct HostMemoryBackendClass {
  * @size: amount of memory backend provides
  * @mr: MemoryRegion representing host memory belonging to backend
  * @prealloc_threads: number of threads to be used for preallocatining RAM
+ * @prealloc_background: preallocate RAM while the guest runs
+ * @prealloc_bg_context: background preallocation that may still be running
+ * @merge_scan_interval: milliseconds between two chunks of the merge scan
+ * @merge_scan_hinted: chunks that the merge scan marked mergeable
  */
 struct HostMemoryBackend {
     /* private */
@@ -76,9 +80,15 @@ struct HostMemoryBackend {
     uint64_t size;
     bool merge, dump, use_canonical_path;
     bool prealloc, is_mapped, share, reserve;
-    bool guest_memfd, aligned;
+    bool guest_memfd, aligned, prealloc_background;
     uint32_t prealloc_threads;
     ThreadContext *prealloc_context;
+    MemsetContext *prealloc_bg_context;
+    uint32_t merge_scan_interval;
+    QEMUTimer *merge_scan_timer;
+    uint64_t merge_scan_offset;
+    unsigned long *merge_scan_hinted;
+    GHashTable *merge_scan_hashes;
     DECLARE_BITMAP(host_nodes, MAX_NODES + 1);
     HostMemPolicy policy;
 
@@ -92,6 +102,19 @@ void host_memory_backend_set_mapped(HostMemoryBackend *backend, bool mapped);
 bool host_memory_backend_is_mapped(HostMemoryBackend *backend);
 size_t host_memory_backend_pagesize(HostMemoryBackend *memdev);
 char *host_memory_backend_get_name(HostMemoryBackend *backend);
+/**
+ * host_memory_backend_get_node_usage:
+ * @backend: the memory backend
+ * @node_bytes: array of MAX_NODES + 1 entries, indexed by host node
+ * @errp: pointer to Error*, to store an error if it happens.
+ *
+ * Fill @node_bytes with the amount of the backend's memory that is currently
+ * resident on each host NUMA node, as reported by the kernel.
+ *
+ * Returns: true on success, false on error.
+ */
+bool host_memory_backend_get_node_usage(HostMemoryBackend *backend,
+                                        uint64_t *node_bytes, Error **errp);
 
 long qemu_minrampagesize(void);
 long qemu_maxrampagesize(void);
@@ -38,6 +38,13 @@ struct IOThread {
     int64_t poll_max_ns;
     int64_t poll_grow;
     int64_t poll_shrink;
+
+    /* io_uring SQPOLL mode, only settable before the iothread is created */
+    bool io_uring_sqpoll;
+    int64_t io_uring_sqpoll_idle;
+
+    /* creates the thread, only settable before the iothread is created */
+    ThreadContext *thread_context;
 };
 typedef struct IOThread IOThread;
 
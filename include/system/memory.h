@@ -26,6 +26,7 @@
 #include "qemu/notify.h"
 #include "qom/object.h"
 #include "qemu/rcu.h"
+#include "qemu/stats64.h"
 
 #define RAM_ADDR_INVALID (~(ram_addr_t)0)
 
@@ -867,6 +868,14 @@ struct MemoryRegion {
 
     /* For devices designed to perform re-entrant IO into their own IO MRs */
     bool disable_reentrancy_guard;
+
+    /* Accesses dispatched to the ops, reported by query-stats */
+    Stat64 dispatch_reads;
+    Stat64 dispatch_writes;
+    /* Accesses that had to take the BQL, and how long they waited for it */
+    Stat64 bql_acquisitions;
+    Stat64 bql_contended;
+    Stat64 bql_wait_ns;
 };
 
 struct IOMMUMemoryRegion {
@@ -2349,6 +2358,9 @@ void memory_region_clear_flush_coalesced(MemoryRegion *mr);
  * locking during I/O themselves: either by doing fine grained locking or
  * by providing lock-free I/O schemes.
  *
+ * The "bql-acquisitions" and "bql-contended" statistics of the memory
+ * provider in query-stats show which regions are worth converting.
+ *
  * @mr: the memory region to be updated.
  */
 void memory_region_enable_lockless_io(MemoryRegion *mr);
@@ -82,6 +82,18 @@ void *qemu_alloc_stack(size_t *sz);
  */
 void qemu_free_stack(void *stack, size_t sz);
 
+/**
+ * qemu_release_stack:
+ * @stack: stack allocated via qemu_alloc_stack()
+ * @sz: size of stack in bytes
+ * @keep: number of bytes at the top of the stack that are still in use
+ *
+ * Tell the host that the contents of the stack below the topmost @keep
+ * bytes are no longer needed, so that it can reclaim the memory.  The stack
+ * remains usable; released pages read back as zeroes once reclaimed.
+ */
+void qemu_release_stack(void *stack, size_t sz, size_t keep);
+
 /* POSIX and Mingw32 differ in the name of the stdio lock functions.  */
 
 static inline void qemu_flockfile(FILE *f)
@@ -89,6 +89,12 @@ struct RAMBlock {
      * could not have been valid on the source.
      */
     ram_addr_t postcopy_length;
+    /*
+     * Second shared mapping of the RAM block file, used on the destination
+     * with the postcopy-hugetlb-minor capability to write the received
+     * pages into the page cache before mapping them with UFFDIO_CONTINUE.
+     */
+    uint8_t *postcopy_alias;
 };
 
 struct RamBlockAttributes {
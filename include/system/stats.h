@@ -25,11 +25,22 @@ void add_stats_callbacks(StatsProvider provider,
                          StatRetrieveFunc *stats_fn,
                          SchemaRetrieveFunc *schemas_fn);
 
+/*
+ * Like add_stats_callbacks(), for providers whose @stats_fn does not need
+ * the BQL.  These providers can also be queried with out-of-band execution
+ * of query-stats, which runs in the monitor I/O thread.
+ */
+void add_oob_stats_callbacks(StatsProvider provider,
+                             StatRetrieveFunc *stats_fn,
+                             SchemaRetrieveFunc *schemas_fn);
+
 /*
  * Helper routines for adding stats entries to the results lists.
  */
 void add_stats_entry(StatsResultList **, StatsProvider, const char *id,
                      StatsList *stats_list);
+void add_stats_call_site_entry(StatsResultList **, StatsProvider,
+                               const char *call_site, StatsList *stats_list);
 void add_stats_schema(StatsSchemaList **, StatsProvider, StatsTarget,
                       StatsSchemaValueList *);
 
@@ -54,4 +54,31 @@ static inline bool qemu_rect_intersect(const QemuRect *a, const QemuRect *b,
     return true;
 }
 
+/*
+ * Set @res to the bounding box of @a and @b.  An empty rectangle does
+ * not contribute, so a zero-initialized rectangle can be used to start
+ * accumulating damage.
+ */
+static inline void qemu_rect_union(const QemuRect *a, const QemuRect *b,
+                                   QemuRect *res)
+{
+    int16_t x1, x2, y1, y2;
+
+    if (!a->width || !a->height) {
+        *res = *b;
+        return;
+    }
+    if (!b->width || !b->height) {
+        *res = *a;
+        return;
+    }
+
+    x1 = MIN(a->x, b->x);
+    y1 = MIN(a->y, b->y);
+    x2 = MAX(a->x + a->width, b->x + b->width);
+    y2 = MAX(a->y + a->height, b->y + b->height);
+
+    qemu_rect_init(res, x1, y1, x2 - x1, y2 - y1);
+}
+
 #endif
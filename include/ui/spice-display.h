@@ -26,6 +26,7 @@
 #include "qemu/thread.h"
 #include "ui/qemu-pixman.h"
 #include "ui/console.h"
+#include "ui/rect.h"
 
 #if defined(CONFIG_OPENGL) && defined(CONFIG_GBM)
 #  define HAVE_SPICE_GL 1
@@ -122,6 +123,7 @@ struct SimpleSpiceDisplay {
     QEMUTimer *gl_unblock_timer;
     QemuGLShader *gls;
     int gl_updates;
+    QemuRect gl_damage;
     bool have_scanout;
     bool have_surface;
 
@@ -98,6 +98,38 @@ int qio_channel_socket_set_send_buffer(QIOChannelSocket *ioc,
     return 0;
 }
 
+int qio_channel_socket_set_zero_copy(QIOChannelSocket *ioc,
+                                     Error **errp)
+{
+#ifdef QEMU_MSG_ZEROCOPY
+    int v = 1;
+
+    if (setsockopt(ioc->fd, SOL_SOCKET, SO_ZEROCOPY, &v, sizeof(v)) < 0) {
+        error_setg_errno(errp, errno, "Unable to enable zero copy on socket");
+        return -1;
+    }
+
+    /* Zero copy available on host */
+    qio_channel_set_feature(QIO_CHANNEL(ioc),
+                            QIO_CHANNEL_FEATURE_WRITE_ZERO_COPY);
+    return 0;
+#else
+    error_setg(errp, "Zero copy not supported on this host");
+    return -1;
+#endif
+}
+
+ssize_t qio_channel_socket_zero_copy_completed(QIOChannelSocket *ioc,
+                                               Error **errp)
+{
+#ifdef QEMU_MSG_ZEROCOPY
+    if (qio_channel_socket_flush_internal(QIO_CHANNEL(ioc), false, errp) < 0) {
+        return -1;
+    }
+#endif
+    return ioc->zero_copy_sent;
+}
+
 static int
 qio_channel_socket_set_fd(QIOChannelSocket *sioc,
                           int fd,
@@ -183,15 +215,7 @@ int qio_channel_socket_connect_sync(QIOChannelSocket *ioc,
         return -1;
     }
 
-#ifdef QEMU_MSG_ZEROCOPY
-    int ret, v = 1;
-    ret = setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &v, sizeof(v));
-    if (ret == 0) {
-        /* Zero copy available on host */
-        qio_channel_set_feature(QIO_CHANNEL(ioc),
-                                QIO_CHANNEL_FEATURE_WRITE_ZERO_COPY);
-    }
-#endif
+    qio_channel_socket_set_zero_copy(ioc, NULL);
 
     qio_channel_set_feature(QIO_CHANNEL(ioc),
                             QIO_CHANNEL_FEATURE_READ_MSG_PEEK);
@@ -24,6 +24,7 @@
 #include "qemu/error-report.h"
 #include "qemu/rcu.h"
 #include "qemu/main-loop.h"
+#include "qemu/thread-context.h"
 
 
 #ifdef CONFIG_POSIX
@@ -171,6 +172,7 @@ static void iothread_set_aio_context_params(EventLoopBase *base, Error **errp)
 
     aio_context_set_aio_params(iothread->ctx,
                                iothread->parent_obj.aio_max_batch);
+    aio_context_set_handler_stats(iothread->ctx, base->handler_stats);
 
     aio_context_set_thread_pool_params(iothread->ctx, base->thread_pool_min,
                                        base->thread_pool_max, errp);
@@ -190,6 +192,15 @@ static void iothread_init(EventLoopBase *base, Error **errp)
         return;
     }
 
+    if (iothread->io_uring_sqpoll &&
+        !aio_context_set_io_uring_sqpoll(iothread->ctx,
+                                         iothread->io_uring_sqpoll_idle,
+                                         errp)) {
+        aio_context_unref(iothread->ctx);
+        iothread->ctx = NULL;
+        return;
+    }
+
     thread_name = g_strdup_printf("IO %s",
                         object_get_canonical_path_component(OBJECT(base)));
 
@@ -207,11 +218,20 @@ static void iothread_init(EventLoopBase *base, Error **errp)
         return;
     }
 
-    /* This assumes we are called from a thread with useful CPU affinity for us
-     * to inherit.
+    /*
+     * Without a thread context, this assumes we are called from a thread
+     * with useful CPU affinity for us to inherit.  Thread pool workers
+     * are spawned by the iothread and inherit its affinity in turn.
      */
-    qemu_thread_create(&iothread->thread, thread_name, iothread_run,
-                       iothread, QEMU_THREAD_JOINABLE);
+    if (iothread->thread_context) {
+        thread_context_create_thread(iothread->thread_context,
+                                     &iothread->thread, thread_name,
+                                     iothread_run, iothread,
+                                     QEMU_THREAD_JOINABLE);
+    } else {
+        qemu_thread_create(&iothread->thread, thread_name, iothread_run,
+                           iothread, QEMU_THREAD_JOINABLE);
+    }
 
     /* Wait for initialization to complete */
     while (iothread->thread_id == -1) {
@@ -233,6 +253,9 @@ static IOThreadParamInfo poll_grow_info = {
 static IOThreadParamInfo poll_shrink_info = {
     "poll-shrink", offsetof(IOThread, poll_shrink),
 };
+static IOThreadParamInfo io_uring_sqpoll_idle_info = {
+    "io-uring-sqpoll-idle", offsetof(IOThread, io_uring_sqpoll_idle),
+};
 
 static void iothread_get_param(Object *obj, Visitor *v,
         const char *name, IOThreadParamInfo *info, Error **errp)
@@ -292,6 +315,61 @@ static void iothread_set_poll_param(Object *obj, Visitor *v,
     }
 }
 
+static void iothread_set_io_uring_sqpoll_idle(Object *obj, Visitor *v,
+        const char *name, void *opaque, Error **errp)
+{
+    IOThread *iothread = IOTHREAD(obj);
+    IOThreadParamInfo *info = opaque;
+
+    if (iothread->ctx) {
+        error_setg(errp, "%s cannot be changed after the iothread has been "
+                   "created", info->name);
+        return;
+    }
+
+    if (!iothread_set_param(obj, v, name, info, errp)) {
+        return;
+    }
+
+    if (iothread->io_uring_sqpoll_idle > UINT32_MAX) {
+        error_setg(errp, "%s value must be in range [0, %" PRIu32 "]",
+                   info->name, UINT32_MAX);
+        iothread->io_uring_sqpoll_idle = 0;
+    }
+}
+
+static bool iothread_get_io_uring_sqpoll(Object *obj, Error **errp)
+{
+    IOThread *iothread = IOTHREAD(obj);
+
+    return iothread->io_uring_sqpoll;
+}
+
+static void iothread_set_io_uring_sqpoll(Object *obj, bool value,
+                                         Error **errp)
+{
+    IOThread *iothread = IOTHREAD(obj);
+
+    if (iothread->ctx) {
+        error_setg(errp, "io-uring-sqpoll cannot be changed after the "
+                   "iothread has been created");
+        return;
+    }
+
+    iothread->io_uring_sqpoll = value;
+}
+
+static void iothread_check_thread_context(const Object *obj, const char *name,
+                                          Object *val, Error **errp)
+{
+    const IOThread *iothread = IOTHREAD(obj);
+
+    if (iothread->ctx) {
+        error_setg(errp, "thread-context cannot be changed after the "
+                   "iothread has been created");
+    }
+}
+
 static void iothread_class_init(ObjectClass *klass, const void *class_data)
 {
     EventLoopBaseClass *bc = EVENT_LOOP_BASE_CLASS(klass);
@@ -311,6 +389,18 @@ static void iothread_class_init(ObjectClass *klass, const void *class_data)
                               iothread_get_poll_param,
                               iothread_set_poll_param,
                               NULL, &poll_shrink_info);
+    object_class_property_add_bool(klass, "io-uring-sqpoll",
+                                   iothread_get_io_uring_sqpoll,
+                                   iothread_set_io_uring_sqpoll);
+    object_class_property_add(klass, "io-uring-sqpoll-idle", "int",
+                              iothread_get_poll_param,
+                              iothread_set_io_uring_sqpoll_idle,
+                              NULL, &io_uring_sqpoll_idle_info);
+    object_class_property_add_link(klass, "thread-context",
+        TYPE_THREAD_CONTEXT, offsetof(IOThread, thread_context),
+        iothread_check_thread_context, OBJ_PROP_LINK_STRONG);
+    object_class_property_set_description(klass, "thread-context",
+        "Context to use for creating the iothread");
 }
 
 static const TypeInfo iothread_info = {
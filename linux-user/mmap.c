@@ -1245,7 +1245,23 @@ abi_long target_madvise(abi_ulong start, abi_ulong len_in, int advice)
      * success, which is broken but some userspace programs fail to work
      * otherwise. Completely implementing such emulation is quite complicated
      * though.
+     *
+     * Multithreaded runtimes issue a steady stream of pure hints (e.g.
+     * MADV_FREE, MADV_HUGEPAGE); return early for those, instead of
+     * serializing against concurrent mmap/munmap/mprotect on mmap_lock
+     * for nothing.
      */
+    switch (advice) {
+    case MADV_DONTDUMP:
+    case MADV_DODUMP:
+    case MADV_WIPEONFORK:
+    case MADV_KEEPONFORK:
+    case MADV_DONTNEED:
+        break;
+    default:
+        return ret;
+    }
+
     mmap_lock();
     switch (advice) {
     case MADV_DONTDUMP:
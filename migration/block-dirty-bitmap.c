@@ -420,6 +420,25 @@ static void send_bitmap_complete(QEMUFile *f, DBMSaveState *s,
     send_bitmap_header(f, s, dbms, DIRTY_BITMAP_MIG_FLAG_COMPLETE);
 }
 
+static void send_bitmap_zeroes(QEMUFile *f, DBMSaveState *s,
+                               SaveBitmapState *dbms,
+                               uint64_t start_sector, uint32_t nr_sectors)
+{
+    uint32_t flags = DIRTY_BITMAP_MIG_FLAG_BITS | DIRTY_BITMAP_MIG_FLAG_ZEROES;
+
+    trace_send_bitmap_bits(flags, start_sector, nr_sectors, 0);
+
+    send_bitmap_header(f, s, dbms, flags);
+
+    qemu_put_be64(f, start_sector);
+    qemu_put_be32(f, nr_sectors);
+
+    /* if a block is zero we need to flush here since the network
+     * bandwidth is now a lot higher than the storage device bandwidth.
+     * thus if we queue zero blocks we slow down the migration. */
+    qemu_fflush(f);
+}
+
 static void send_bitmap_bits(QEMUFile *f, DBMSaveState *s,
                              SaveBitmapState *dbms,
                              uint64_t start_sector, uint32_t nr_sectors)
@@ -440,8 +459,8 @@ static void send_bitmap_bits(QEMUFile *f, DBMSaveState *s,
 
     if (buffer_is_zero(buf, buf_size)) {
         g_free(buf);
-        buf = NULL;
-        flags |= DIRTY_BITMAP_MIG_FLAG_ZEROES;
+        send_bitmap_zeroes(f, s, dbms, start_sector, nr_sectors);
+        return;
     }
 
     trace_send_bitmap_bits(flags, start_sector, nr_sectors, buf_size);
@@ -450,16 +469,8 @@ static void send_bitmap_bits(QEMUFile *f, DBMSaveState *s,
 
     qemu_put_be64(f, start_sector);
     qemu_put_be32(f, nr_sectors);
-
-    /* if a block is zero we need to flush here since the network
-     * bandwidth is now a lot higher than the storage device bandwidth.
-     * thus if we queue zero blocks we slow down the migration. */
-    if (flags & DIRTY_BITMAP_MIG_FLAG_ZEROES) {
-        qemu_fflush(f);
-    } else {
-        qemu_put_be64(f, buf_size);
-        qemu_put_buffer(f, buf, buf_size);
-    }
+    qemu_put_be64(f, buf_size);
+    qemu_put_buffer(f, buf, buf_size);
 
     g_free(buf);
 }
@@ -687,14 +698,43 @@ fail:
     return -1;
 }
 
+/*
+ * Return the number of sectors from dbms->cur_sector up to the next chunk
+ * that has dirty bits, capped so that it fits in the nr_sectors field.
+ */
+static uint64_t bulk_phase_clean_sectors(SaveBitmapState *dbms)
+{
+    int64_t next_dirty;
+    uint64_t end;
+
+    next_dirty = bdrv_dirty_bitmap_next_dirty(dbms->bitmap,
+                                              dbms->cur_sector <<
+                                              BDRV_SECTOR_BITS, INT64_MAX);
+    if (next_dirty < 0) {
+        end = dbms->total_sectors;
+    } else {
+        end = QEMU_ALIGN_DOWN(next_dirty >> BDRV_SECTOR_BITS,
+                              dbms->sectors_per_chunk);
+    }
+
+    return MIN(end - dbms->cur_sector,
+               QEMU_ALIGN_DOWN(UINT32_MAX, dbms->sectors_per_chunk));
+}
+
 /* Called with no lock taken.  */
 static void bulk_phase_send_chunk(QEMUFile *f, DBMSaveState *s,
                                   SaveBitmapState *dbms)
 {
-    uint32_t nr_sectors = MIN(dbms->total_sectors - dbms->cur_sector,
-                             dbms->sectors_per_chunk);
+    uint32_t nr_sectors = bulk_phase_clean_sectors(dbms);
 
-    send_bitmap_bits(f, s, dbms, dbms->cur_sector, nr_sectors);
+    if (nr_sectors) {
+        /* Send a run of clean chunks as a single ZEROES chunk */
+        send_bitmap_zeroes(f, s, dbms, dbms->cur_sector, nr_sectors);
+    } else {
+        nr_sectors = MIN(dbms->total_sectors - dbms->cur_sector,
+                         dbms->sectors_per_chunk);
+        send_bitmap_bits(f, s, dbms, dbms->cur_sector, nr_sectors);
+    }
 
     dbms->cur_sector += nr_sectors;
     if (dbms->cur_sector >= dbms->total_sectors) {
@@ -0,0 +1,453 @@
+/*
+ * Lazy loading of RAM from a mapped-ram migration file
+ *
+ * With mapped-ram, every page of a RAM block has a fixed place in the
+ * migration file, so there is no need to read all of them before the
+ * guest starts.  Instead, the blocks are registered with userfaultfd and
+ * a fault thread reads each page from the file the first time it is
+ * accessed, while a pool of threads prefetches the rest in the background.
+ * Once every page of the file has been placed, the blocks are unregistered
+ * and the remaining (zero) pages are left to the kernel.
+ *
+ * A page may be faulted in and prefetched at the same time; whoever sets
+ * its bit in the per-block done bitmap first places it, and UFFDIO_COPY
+ * wakes up every thread waiting on it.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/bitops.h"
+#include "qemu/error-report.h"
+#include "qemu/event_notifier.h"
+#include "qemu/main-loop.h"
+#include "qemu/thread.h"
+#include "qemu/units.h"
+#include "qapi/error.h"
+#include "block/aio.h"
+#include "block/thread-pool.h"
+#include "exec/target_page.h"
+#include "io/channel-file.h"
+#include "system/memory.h"
+#include "system/runstate.h"
+#include "mapped-ram-lazy.h"
+#include "options.h"
+#include "ram.h"
+#include "trace.h"
+
+#if defined(__linux__)
+#include <poll.h>
+#include "qemu/userfaultfd.h"
+
+/* Smallest amount of RAM prefetched by one work item */
+#define MAPPED_RAM_LAZY_CHUNK (64 * MiB)
+
+typedef struct MappedRamLazyBlock {
+    RAMBlock *block;
+    /* Target pages present in the file */
+    unsigned long *file_bmap;
+    /* Host pages placed, or being placed, in the block */
+    unsigned long *done_bmap;
+    long num_pages;
+    size_t page_size;
+} MappedRamLazyBlock;
+
+typedef struct MappedRamLazyState {
+    /* Private copy of the migration file, which is closed after loading */
+    QIOChannel *ioc;
+    int uffd;
+    QemuThread fault_thread;
+    /* Set when the prefetch is over */
+    EventNotifier done;
+    ThreadPool *prefetch_pool;
+    GPtrArray *blocks;
+    /* Prefetch work items left, plus one until all of them are submitted */
+    int pending;
+    bool failed;
+} MappedRamLazyState;
+
+typedef struct MappedRamLazyWork {
+    MappedRamLazyState *s;
+    MappedRamLazyBlock *lb;
+    ram_addr_t start;
+    ram_addr_t end;
+} MappedRamLazyWork;
+
+static MappedRamLazyState *mapped_ram_lazy;
+
+static bool lazy_test_and_set_done(MappedRamLazyBlock *lb, long nr)
+{
+    unsigned long mask = BIT_MASK(nr);
+    unsigned long *p = lb->done_bmap + BIT_WORD(nr);
+
+    return qatomic_fetch_or(p, mask) & mask;
+}
+
+/*
+ * Place the host page at @offset of @lb, using @buf as a bounce buffer of
+ * the host page size.  Does nothing if the page was already placed.
+ */
+static int lazy_place_page(MappedRamLazyState *s, MappedRamLazyBlock *lb,
+                           ram_addr_t offset, uint8_t *buf, Error **errp)
+{
+    RAMBlock *block = lb->block;
+    long first = offset >> TARGET_PAGE_BITS;
+    long last = first + (lb->page_size >> TARGET_PAGE_BITS);
+    void *host = block->host + offset;
+    ram_addr_t off;
+    int ret;
+
+    if (lazy_test_and_set_done(lb, offset / lb->page_size)) {
+        return 0;
+    }
+
+    if (find_next_bit(lb->file_bmap, last, first) >= last) {
+        /* Huge pages cannot be filled with UFFDIO_ZEROPAGE */
+        if (lb->page_size == qemu_real_host_page_size()) {
+            ret = uffd_zero_page(s->uffd, host, lb->page_size, false);
+            goto placed;
+        }
+        memset(buf, 0, lb->page_size);
+    } else if (find_next_zero_bit(lb->file_bmap, last, first) >= last) {
+        if (qio_channel_pread(s->ioc, buf, lb->page_size,
+                              block->pages_offset + offset,
+                              errp) != lb->page_size) {
+            goto err;
+        }
+    } else {
+        for (off = 0; off < lb->page_size; off += TARGET_PAGE_SIZE) {
+            if (!test_bit(first + (off >> TARGET_PAGE_BITS), lb->file_bmap)) {
+                memset(buf + off, 0, TARGET_PAGE_SIZE);
+            } else if (qio_channel_pread(s->ioc, buf + off, TARGET_PAGE_SIZE,
+                                         block->pages_offset + offset + off,
+                                         errp) != TARGET_PAGE_SIZE) {
+                goto err;
+            }
+        }
+    }
+
+    ret = uffd_copy_page(s->uffd, host, buf, lb->page_size, false);
+placed:
+    if (ret) {
+        error_setg_errno(errp, -ret, "failed to place page " RAM_ADDR_FMT
+                         " of ramblock %s", offset, block->idstr);
+    }
+    return ret;
+
+err:
+    error_prepend(errp, "(%s) failed to read page " RAM_ADDR_FMT
+                  " from file offset %" PRIx64 ": ", block->idstr, offset,
+                  block->pages_offset + offset);
+    return -EIO;
+}
+
+static MappedRamLazyBlock *lazy_find_block(MappedRamLazyState *s,
+                                           uint8_t *host)
+{
+    for (int i = 0; i < s->blocks->len; i++) {
+        MappedRamLazyBlock *lb = g_ptr_array_index(s->blocks, i);
+        RAMBlock *block = lb->block;
+
+        if (host >= block->host && host < block->host + block->used_length) {
+            return lb;
+        }
+    }
+    return NULL;
+}
+
+static void lazy_unregister_blocks(MappedRamLazyState *s)
+{
+    for (int i = 0; i < s->blocks->len; i++) {
+        MappedRamLazyBlock *lb = g_ptr_array_index(s->blocks, i);
+
+        uffd_unregister_memory(s->uffd, lb->block->host,
+                               lb->block->used_length);
+    }
+}
+
+static void mapped_ram_lazy_cleanup_bh(void *opaque)
+{
+    MappedRamLazyState *s = opaque;
+
+    qemu_thread_join(&s->fault_thread);
+    thread_pool_free(s->prefetch_pool);
+    uffd_close_fd(s->uffd);
+    event_notifier_cleanup(&s->done);
+    object_unref(OBJECT(s->ioc));
+    g_ptr_array_free(s->blocks, true);
+    g_free(s);
+    mapped_ram_lazy = NULL;
+}
+
+static void *mapped_ram_lazy_fault_thread(void *opaque)
+{
+    MappedRamLazyState *s = opaque;
+    Error *local_err = NULL;
+    struct pollfd pfd[2] = {
+        { .fd = s->uffd, .events = POLLIN },
+        { .fd = event_notifier_get_fd(&s->done), .events = POLLIN },
+    };
+    uint8_t *buf;
+    size_t buf_size = 0;
+
+    for (int i = 0; i < s->blocks->len; i++) {
+        MappedRamLazyBlock *lb = g_ptr_array_index(s->blocks, i);
+
+        buf_size = MAX(buf_size, lb->page_size);
+    }
+    buf = qemu_memalign(qemu_real_host_page_size(), buf_size);
+
+    while (true) {
+        struct uffd_msg msg;
+        MappedRamLazyBlock *lb;
+        uint8_t *host;
+
+        if (poll(pfd, ARRAY_SIZE(pfd), -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error_report("%s: userfault poll: %s", __func__, strerror(errno));
+            break;
+        }
+
+        /* Serve the faults first, the prefetch never waits for them */
+        if (pfd[0].revents) {
+            if (uffd_read_events(s->uffd, &msg, 1) != 1 ||
+                msg.event != UFFD_EVENT_PAGEFAULT) {
+                continue;
+            }
+
+            host = (uint8_t *)(uintptr_t)msg.arg.pagefault.address;
+            lb = lazy_find_block(s, host);
+            if (!lb) {
+                error_report("%s: unexpected fault at %p", __func__, host);
+                break;
+            }
+
+            host = QEMU_ALIGN_PTR_DOWN(host, lb->page_size);
+            trace_mapped_ram_lazy_fault(lb->block->idstr,
+                                        host - lb->block->host);
+            if (lazy_place_page(s, lb, host - lb->block->host, buf,
+                                &local_err)) {
+                error_report_err(local_err);
+                break;
+            }
+            continue;
+        }
+
+        if (pfd[1].revents) {
+            event_notifier_test_and_clear(&s->done);
+            if (qatomic_read(&s->failed)) {
+                /* Keep serving faults; they may still succeed */
+                continue;
+            }
+            lazy_unregister_blocks(s);
+            trace_mapped_ram_lazy_done();
+            aio_bh_schedule_oneshot(qemu_get_aio_context(),
+                                    mapped_ram_lazy_cleanup_bh, s);
+            break;
+        }
+    }
+
+    qemu_vfree(buf);
+    return NULL;
+}
+
+static int mapped_ram_lazy_prefetch(void *opaque)
+{
+    MappedRamLazyWork *work = opaque;
+    MappedRamLazyState *s = work->s;
+    MappedRamLazyBlock *lb = work->lb;
+    uint8_t *buf = qemu_memalign(qemu_real_host_page_size(), lb->page_size);
+    Error *local_err = NULL;
+    ram_addr_t offset;
+
+    for (offset = work->start; offset < work->end; offset += lb->page_size) {
+        long first = offset >> TARGET_PAGE_BITS;
+        long last = first + (lb->page_size >> TARGET_PAGE_BITS);
+
+        /* Pages that are not in the file are zero once unregistered */
+        if (test_bit(offset / lb->page_size, lb->done_bmap) ||
+            find_next_bit(lb->file_bmap, last, first) >= last) {
+            continue;
+        }
+
+        if (lazy_place_page(s, lb, offset, buf, &local_err)) {
+            error_report_err(local_err);
+            qatomic_set(&s->failed, true);
+            break;
+        }
+    }
+
+    qemu_vfree(buf);
+    if (qatomic_dec_fetch(&s->pending) == 0) {
+        event_notifier_set(&s->done);
+    }
+    return 0;
+}
+
+static void mapped_ram_lazy_block_free(gpointer opaque)
+{
+    MappedRamLazyBlock *lb = opaque;
+
+    g_free(lb->file_bmap);
+    g_free(lb->done_bmap);
+    g_free(lb);
+}
+
+static MappedRamLazyState *mapped_ram_lazy_init(QEMUFile *f)
+{
+    QIOChannel *ioc = qemu_file_get_ioc(f);
+    MappedRamLazyState *s;
+    int fd;
+
+    if (!object_dynamic_cast(OBJECT(ioc), TYPE_QIO_CHANNEL_FILE)) {
+        return NULL;
+    }
+
+    fd = qemu_dup(QIO_CHANNEL_FILE(ioc)->fd);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    s = g_new0(MappedRamLazyState, 1);
+    s->uffd = uffd_create_fd(0, true);
+    if (s->uffd < 0) {
+        goto err_close;
+    }
+    if (event_notifier_init(&s->done, false) < 0) {
+        uffd_close_fd(s->uffd);
+        goto err_close;
+    }
+    s->ioc = QIO_CHANNEL(qio_channel_file_new_fd(fd));
+    s->blocks = g_ptr_array_new_with_free_func(mapped_ram_lazy_block_free);
+    s->pending = 1;
+    return s;
+
+err_close:
+    close(fd);
+    g_free(s);
+    return NULL;
+}
+
+bool mapped_ram_lazy_available(void)
+{
+    uint64_t features;
+
+    return uffd_query_features(&features) == 0;
+}
+
+bool mapped_ram_lazy_add_block(QEMUFile *f, RAMBlock *block,
+                               unsigned long *bitmap, long num_pages)
+{
+    MappedRamLazyState *s = mapped_ram_lazy;
+    size_t page_size = qemu_ram_pagesize(block);
+    MappedRamLazyBlock *lb;
+    uint64_t ioctls;
+
+    /*
+     * Only RAM that the guest has never used can be loaded lazily, and
+     * the fault thread does not expect new blocks once it is started.
+     */
+    if (!migrate_mapped_ram_lazy() || !runstate_check(RUN_STATE_INMIGRATE) ||
+        ram_block_discard_is_disabled() || (s && s->prefetch_pool)) {
+        return false;
+    }
+
+    if (!s) {
+        s = mapped_ram_lazy = mapped_ram_lazy_init(f);
+        if (!s) {
+            warn_report("mapped-ram-lazy: cannot use userfaultfd, "
+                        "loading all RAM now");
+            return false;
+        }
+    }
+
+    /* The whole block must fault, whatever the guest memory backend did */
+    if (ram_discard_range(block->idstr, 0, block->used_length) ||
+        uffd_register_memory(s->uffd, block->host, block->used_length,
+                             UFFDIO_REGISTER_MODE_MISSING, &ioctls)) {
+        warn_report("mapped-ram-lazy: cannot register ramblock %s, "
+                    "loading it now", block->idstr);
+        return false;
+    }
+
+    if (!(ioctls & BIT(_UFFDIO_COPY))) {
+        uffd_unregister_memory(s->uffd, block->host, block->used_length);
+        warn_report("mapped-ram-lazy: ramblock %s does not support "
+                    "UFFDIO_COPY, loading it now", block->idstr);
+        return false;
+    }
+
+    lb = g_new0(MappedRamLazyBlock, 1);
+    lb->block = block;
+    lb->file_bmap = bitmap;
+    lb->num_pages = num_pages;
+    lb->page_size = page_size;
+    lb->done_bmap = bitmap_new(DIV_ROUND_UP(block->used_length, page_size));
+    g_ptr_array_add(s->blocks, lb);
+
+    trace_mapped_ram_lazy_add_block(block->idstr, num_pages);
+    return true;
+}
+
+void mapped_ram_lazy_start(void)
+{
+    MappedRamLazyState *s = mapped_ram_lazy;
+    int threads = migrate_multifd() ? migrate_multifd_channels() : 1;
+
+    if (!s || s->prefetch_pool) {
+        return;
+    }
+
+    qemu_thread_create(&s->fault_thread, "mapped-ram-fault",
+                       mapped_ram_lazy_fault_thread, s, QEMU_THREAD_JOINABLE);
+
+    s->prefetch_pool = thread_pool_new();
+    thread_pool_set_max_threads(s->prefetch_pool, threads);
+
+    for (int i = 0; i < s->blocks->len; i++) {
+        MappedRamLazyBlock *lb = g_ptr_array_index(s->blocks, i);
+        ram_addr_t length = lb->num_pages << TARGET_PAGE_BITS;
+        ram_addr_t chunk = QEMU_ALIGN_UP(MAX(length / threads,
+                                             MAPPED_RAM_LAZY_CHUNK),
+                                         lb->page_size);
+
+        for (ram_addr_t start = 0; start < length; start += chunk) {
+            MappedRamLazyWork *work = g_new(MappedRamLazyWork, 1);
+
+            work->s = s;
+            work->lb = lb;
+            work->start = start;
+            work->end = MIN(start + chunk, length);
+            qatomic_inc(&s->pending);
+            thread_pool_submit(s->prefetch_pool, mapped_ram_lazy_prefetch,
+                               work, g_free);
+        }
+    }
+
+    trace_mapped_ram_lazy_start(s->blocks->len, threads);
+    if (qatomic_dec_fetch(&s->pending) == 0) {
+        event_notifier_set(&s->done);
+    }
+}
+
+#else
+
+bool mapped_ram_lazy_available(void)
+{
+    return false;
+}
+
+bool mapped_ram_lazy_add_block(QEMUFile *f, RAMBlock *block,
+                               unsigned long *bitmap, long num_pages)
+{
+    return false;
+}
+
+void mapped_ram_lazy_start(void)
+{
+}
+
+#endif /* defined(__linux__) */
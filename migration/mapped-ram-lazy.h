@@ -0,0 +1,34 @@
+/*
+ * Lazy loading of RAM from a mapped-ram migration file
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#ifndef QEMU_MIGRATION_MAPPED_RAM_LAZY_H
+#define QEMU_MIGRATION_MAPPED_RAM_LAZY_H
+
+#include "system/ramblock.h"
+#include "qemu-file.h"
+
+bool mapped_ram_lazy_available(void);
+
+/*
+ * mapped_ram_lazy_add_block: Load @block on demand instead of reading it.
+ *
+ * @f: the incoming migration file
+ * @block: the RAM block
+ * @bitmap: the pages of @block present in the file, ownership is taken
+ *          on success
+ * @num_pages: number of target pages in @bitmap
+ *
+ * Returns true if the pages of @block will be read when first accessed
+ * or by the prefetch threads, false if the caller must read them now.
+ */
+bool mapped_ram_lazy_add_block(QEMUFile *f, RAMBlock *block,
+                               unsigned long *bitmap, long num_pages);
+
+/* Start prefetching the blocks added so far */
+void mapped_ram_lazy_start(void);
+
+#endif
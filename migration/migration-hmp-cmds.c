@@ -130,6 +130,26 @@ static void migration_dump_blocktime(Monitor *mon, MigrationInfo *info)
             count++;
         }
     }
+
+    if (info->has_postcopy_vcpu_latency_dist) {
+        PostcopyLatencyDistList *dist = info->postcopy_vcpu_latency_dist;
+        int cpu = 0;
+
+        monitor_printf(mon, "Postcopy vCPU Latency Distribution:\n");
+
+        /* One line per vCPU, bucket counts in the order shown above */
+        for (; dist; dist = dist->next, cpu++) {
+            uint64List *item = dist->value->buckets;
+            const char *sep = "";
+
+            monitor_printf(mon, "  vCPU %d: [", cpu);
+            for (; item; item = item->next) {
+                monitor_printf(mon, "%s%"PRIu64, sep, item->value);
+                sep = ", ";
+            }
+            monitor_printf(mon, "]\n");
+        }
+    }
 }
 
 void hmp_info_migrate(Monitor *mon, const QDict *qdict)
@@ -176,6 +196,19 @@ void hmp_info_migrate(Monitor *mon, const QDict *qdict)
             }
             monitor_printf(mon, "\n");
         }
+
+        if (info->switchover_model) {
+            MigrationSwitchoverModel *model = info->switchover_model;
+            g_autofree char *str_bw = size_to_str(model->bandwidth);
+            g_autofree char *str_dirty = size_to_str(model->dirty_rate);
+            g_autofree char *str_pending = size_to_str(model->pending_size);
+
+            monitor_printf(mon, "Switchover model: 	bandwidth=%s/s, "
+                           "dirty=%s/s, pending=%s, sync=%" PRIu64 " us, "
+                           "predicted_down=%" PRIu64 " ms\n",
+                           str_bw, str_dirty, str_pending, model->sync_time,
+                           model->predicted_downtime);
+        }
     }
 
     if (info->has_socket_address) {
@@ -231,6 +264,12 @@ void hmp_info_migrate(Monitor *mon, const QDict *qdict)
 
         monitor_printf(mon, "  Others: \t\tdirty_syncs=%" PRIu64,
                        info->ram->dirty_sync_count);
+        if (info->ram->dirty_sync_time) {
+            monitor_printf(mon, ", dirty_sync_time=%" PRIu64 " us"
+                           ", last=%" PRIu64 " us",
+                           info->ram->dirty_sync_time,
+                           info->ram->dirty_sync_last_time);
+        }
         if (info->ram->postcopy_requests) {
             monitor_printf(mon, ", postcopy_req=%" PRIu64,
                            info->ram->postcopy_requests);
@@ -269,6 +308,20 @@ void hmp_info_migrate(Monitor *mon, const QDict *qdict)
                        info->xbzrle_cache->overflow);
     }
 
+    if (info->multifd_compression) {
+        MultiFDCompressionStats *c = info->multifd_compression;
+
+        monitor_printf(mon, "Multifd compression: method=%s"
+                       ", pages=%" PRIu64
+                       ", raw_pages=%" PRIu64 "\n"
+                       "  compressed=%" PRIu64
+                       ", compression_rate=%0.2f"
+                       ", time=%" PRIu64 " us\n",
+                       MultiFDCompression_str(c->method),
+                       c->pages, c->raw_pages, c->compressed_bytes,
+                       c->compression_rate, c->compression_time);
+    }
+
     if (info->has_cpu_throttle_percentage) {
         monitor_printf(mon, "CPU Throttle (%%): %" PRIu64 "\n",
                        info->cpu_throttle_percentage);
@@ -450,6 +503,31 @@ void hmp_info_migrate_parameters(Monitor *mon, const QDict *qdict)
                            params->direct_io ? "on" : "off");
         }
 
+        assert(params->has_dirty_sync_threads);
+        monitor_printf(mon, "%s: %u\n",
+            MigrationParameter_str(MIGRATION_PARAMETER_DIRTY_SYNC_THREADS),
+            params->dirty_sync_threads);
+
+        assert(params->has_multifd_raw_entropy);
+        monitor_printf(mon, "%s: %u\n",
+            MigrationParameter_str(MIGRATION_PARAMETER_MULTIFD_RAW_ENTROPY),
+            params->multifd_raw_entropy);
+
+        assert(params->has_postcopy_fault_threads);
+        monitor_printf(mon, "%s: %u\n",
+            MigrationParameter_str(MIGRATION_PARAMETER_POSTCOPY_FAULT_THREADS),
+            params->postcopy_fault_threads);
+
+        assert(params->has_vcpu_dirty_limit_auto);
+        monitor_printf(mon, "%s: %s\n",
+            MigrationParameter_str(MIGRATION_PARAMETER_VCPU_DIRTY_LIMIT_AUTO),
+            params->vcpu_dirty_limit_auto ? "on" : "off");
+
+        assert(params->has_predictive_switchover);
+        monitor_printf(mon, "%s: %s\n",
+            MigrationParameter_str(MIGRATION_PARAMETER_PREDICTIVE_SWITCHOVER),
+            params->predictive_switchover ? "on" : "off");
+
         assert(params->has_cpr_exec_command);
         monitor_print_cpr_exec_command(mon, params->cpr_exec_command);
     }
@@ -733,6 +811,26 @@ void hmp_migrate_set_parameter(Monitor *mon, const QDict *qdict)
         p->has_direct_io = true;
         visit_type_bool(v, param, &p->direct_io, &err);
         break;
+    case MIGRATION_PARAMETER_DIRTY_SYNC_THREADS:
+        p->has_dirty_sync_threads = true;
+        visit_type_uint8(v, param, &p->dirty_sync_threads, &err);
+        break;
+    case MIGRATION_PARAMETER_MULTIFD_RAW_ENTROPY:
+        p->has_multifd_raw_entropy = true;
+        visit_type_uint8(v, param, &p->multifd_raw_entropy, &err);
+        break;
+    case MIGRATION_PARAMETER_POSTCOPY_FAULT_THREADS:
+        p->has_postcopy_fault_threads = true;
+        visit_type_uint8(v, param, &p->postcopy_fault_threads, &err);
+        break;
+    case MIGRATION_PARAMETER_VCPU_DIRTY_LIMIT_AUTO:
+        p->has_vcpu_dirty_limit_auto = true;
+        visit_type_bool(v, param, &p->vcpu_dirty_limit_auto, &err);
+        break;
+    case MIGRATION_PARAMETER_PREDICTIVE_SWITCHOVER:
+        p->has_predictive_switchover = true;
+        visit_type_bool(v, param, &p->predictive_switchover, &err);
+        break;
     case MIGRATION_PARAMETER_CPR_EXEC_COMMAND: {
         /*
          * NOTE: g_autofree will only auto g_free() the strv array when
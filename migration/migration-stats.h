@@ -50,11 +50,20 @@ typedef struct {
      * Number of times we have synchronized guest bitmaps.
      */
     Stat64 dirty_sync_count;
+    /*
+     * Time spent in the last synchronization of guest bitmaps, in
+     * microseconds.
+     */
+    Stat64 dirty_sync_last_time;
     /*
      * Number of times zero copy failed to send any page using zero
      * copy.
      */
     Stat64 dirty_sync_missed_zero_copy;
+    /*
+     * Total time spent synchronizing guest bitmaps, in microseconds.
+     */
+    Stat64 dirty_sync_time;
     /*
      * Number of bytes sent at migration completion stage while the
      * guest is stopped.
@@ -64,6 +73,25 @@ typedef struct {
      * Number of bytes sent through multifd channels.
      */
     Stat64 multifd_bytes;
+    /*
+     * Number of bytes sent for the pages passed to the multifd
+     * compression method.
+     */
+    Stat64 multifd_compress_bytes;
+    /*
+     * Number of pages passed to the multifd compression method.
+     */
+    Stat64 multifd_compress_pages;
+    /*
+     * Number of pages the multifd compression method sent uncompressed
+     * because of their entropy.
+     */
+    Stat64 multifd_compress_raw_pages;
+    /*
+     * Time spent by the multifd channels preparing compressed packets,
+     * in microseconds.
+     */
+    Stat64 multifd_compress_time;
     /*
      * Number of pages transferred that were not full of zeros.
      */
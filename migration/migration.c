@@ -511,14 +511,13 @@ static void migrate_generate_event(MigrationStatus new_state)
  * Send a message on the return channel back to the source
  * of the migration.
  */
-static int migrate_send_rp_message(MigrationIncomingState *mis,
-                                   enum mig_rp_message_type message_type,
-                                   uint16_t len, void *data)
+static int migrate_send_rp_message_locked(MigrationIncomingState *mis,
+                                          enum mig_rp_message_type message_type,
+                                          uint16_t len, void *data)
 {
     int ret = 0;
 
     trace_migrate_send_rp_message((int)message_type, len);
-    QEMU_LOCK_GUARD(&mis->rp_mutex);
 
     /*
      * It's possible that the file handle got lost due to network
@@ -535,6 +534,15 @@ static int migrate_send_rp_message(MigrationIncomingState *mis,
     return qemu_fflush(mis->to_src_file);
 }
 
+static int migrate_send_rp_message(MigrationIncomingState *mis,
+                                   enum mig_rp_message_type message_type,
+                                   uint16_t len, void *data)
+{
+    QEMU_LOCK_GUARD(&mis->rp_mutex);
+
+    return migrate_send_rp_message_locked(mis, message_type, len, data);
+}
+
 /* Request one page from the source VM at the given start address.
  *   rb: the RAMBlock to request the page in
  *   Start: Address offset within the RB
@@ -554,10 +562,12 @@ int migrate_send_rp_message_req_pages(MigrationIncomingState *mis,
     *(uint32_t *)(bufc + 8) = cpu_to_be32((uint32_t)len);
 
     /*
-     * We maintain the last ramblock that we requested for page.  Note that we
-     * don't need locking because this function will only be called within the
-     * postcopy ram fault thread.
+     * We maintain the last ramblock that we requested for page.  The fault
+     * threads can request pages concurrently, so hold rp_mutex until the
+     * message is sent to keep the ramblock name in sync with the stream.
      */
+    QEMU_LOCK_GUARD(&mis->rp_mutex);
+
     if (rb != mis->last_rb) {
         mis->last_rb = rb;
 
@@ -574,7 +584,7 @@ int migrate_send_rp_message_req_pages(MigrationIncomingState *mis,
         msg_type = MIG_RP_MSG_REQ_PAGES;
     }
 
-    return migrate_send_rp_message(mis, msg_type, msglen, bufc);
+    return migrate_send_rp_message_locked(mis, msg_type, msglen, bufc);
 }
 
 int migrate_send_rp_req_pages(MigrationIncomingState *mis,
@@ -1258,6 +1268,12 @@ static void populate_time_info(MigrationInfo *info, MigrationState *s)
     } else {
         info->has_expected_downtime = true;
         info->expected_downtime = s->expected_downtime;
+        info->switchover_model = g_new0(MigrationSwitchoverModel, 1);
+        info->switchover_model->bandwidth = s->bandwidth_avg * 1000;
+        info->switchover_model->dirty_rate = s->dirty_rate_avg * 1000;
+        info->switchover_model->pending_size = s->pending_size;
+        info->switchover_model->sync_time = s->pending_exact_time;
+        info->switchover_model->predicted_downtime = s->expected_downtime;
     }
 }
 
@@ -1276,6 +1292,9 @@ static void populate_ram_info(MigrationInfo *info, MigrationState *s)
         stat64_get(&mig_stats.dirty_sync_count);
     info->ram->dirty_sync_missed_zero_copy =
         stat64_get(&mig_stats.dirty_sync_missed_zero_copy);
+    info->ram->dirty_sync_time = stat64_get(&mig_stats.dirty_sync_time);
+    info->ram->dirty_sync_last_time =
+        stat64_get(&mig_stats.dirty_sync_last_time);
     info->ram->postcopy_requests =
         stat64_get(&mig_stats.postcopy_requests);
     info->ram->page_size = page_size;
@@ -1296,6 +1315,22 @@ static void populate_ram_info(MigrationInfo *info, MigrationState *s)
         info->xbzrle_cache->overflow = xbzrle_counters.overflow;
     }
 
+    if (migrate_multifd() &&
+        migrate_multifd_compression() != MULTIFD_COMPRESSION_NONE) {
+        MultiFDCompressionStats *stats;
+        uint64_t bytes = stat64_get(&mig_stats.multifd_compress_bytes);
+
+        stats = info->multifd_compression = g_malloc0(sizeof(*stats));
+        stats->method = migrate_multifd_compression();
+        stats->pages = stat64_get(&mig_stats.multifd_compress_pages);
+        stats->raw_pages = stat64_get(&mig_stats.multifd_compress_raw_pages);
+        stats->compressed_bytes = bytes;
+        stats->compression_rate = bytes ?
+            (double)stats->pages * page_size / bytes : 0;
+        stats->compression_time =
+            stat64_get(&mig_stats.multifd_compress_time);
+    }
+
     if (cpu_throttle_active()) {
         info->has_cpu_throttle_percentage = true;
         info->cpu_throttle_percentage = cpu_throttle_get_percentage();
@@ -1813,6 +1848,10 @@ int migrate_init(MigrationState *s, Error **errp)
     s->pages_per_second = 0.0;
     s->downtime = 0;
     s->expected_downtime = 0;
+    s->bandwidth_avg = 0;
+    s->dirty_rate_avg = 0;
+    s->pending_size = 0;
+    s->pending_exact_time = 0;
     s->setup_time = 0;
     s->start_postcopy = false;
     s->migration_thread_running = false;
@@ -3393,6 +3432,9 @@ static void migration_update_counters(MigrationState *s,
     /* Expected bandwidth when switching over to destination QEMU */
     double expected_bw_per_ms;
     double bandwidth;
+    /* Bytes dirtied per ms, and dirtied while computing pending data */
+    double dirty_rate;
+    uint64_t sync_dirty_bytes = 0;
 
     if (current_time < s->iteration_start_time + BUFFER_DELAY) {
         return;
@@ -3403,6 +3445,21 @@ static void migration_update_counters(MigrationState *s,
     transferred = current_bytes - s->iteration_initial_bytes;
     time_spent = current_time - s->iteration_start_time;
     bandwidth = (double)transferred / time_spent;
+    dirty_rate = (double)stat64_get(&mig_stats.dirty_pages_rate) *
+                 qemu_target_page_size() / 1000;
+
+    /*
+     * Keep an exponential moving average of the bandwidth and the dirty
+     * rate, so that one fast iteration or one where the guest was
+     * mostly idle does not trigger the switchover too early.
+     */
+    if (!s->bandwidth_avg) {
+        s->bandwidth_avg = bandwidth;
+        s->dirty_rate_avg = dirty_rate;
+    } else {
+        s->bandwidth_avg = (s->bandwidth_avg * 3 + bandwidth) / 4;
+        s->dirty_rate_avg = (s->dirty_rate_avg * 3 + dirty_rate) / 4;
+    }
 
     if (switchover_bw) {
         /*
@@ -3410,12 +3467,22 @@ static void migration_update_counters(MigrationState *s,
          * user so that can be more accurate than what we estimated.
          */
         expected_bw_per_ms = switchover_bw / 1000;
+    } else if (migrate_predictive_switchover()) {
+        /*
+         * Plan for the worst of the last iteration and the average, and
+         * for the memory dirtied between the last bitmap sync and the
+         * stop of the guest, which is sent during the downtime too.
+         */
+        expected_bw_per_ms = MIN(bandwidth, s->bandwidth_avg);
+        sync_dirty_bytes = MAX(dirty_rate, s->dirty_rate_avg) *
+                           s->pending_exact_time / 1000;
     } else {
         /* If the user doesn't specify bandwidth, we use the estimated */
         expected_bw_per_ms = bandwidth;
     }
 
     s->threshold_size = expected_bw_per_ms * migrate_downtime_limit();
+    s->threshold_size -= MIN(s->threshold_size, sync_dirty_bytes);
 
     s->mbps = (((double) transferred * 8.0) /
                ((double) time_spent / 1000.0)) / 1000.0 / 1000.0;
@@ -3432,7 +3499,8 @@ static void migration_update_counters(MigrationState *s,
     if (stat64_get(&mig_stats.dirty_pages_rate) &&
         transferred > 10000) {
         s->expected_downtime =
-            stat64_get(&mig_stats.dirty_bytes_last_sync) / expected_bw_per_ms;
+            (stat64_get(&mig_stats.dirty_bytes_last_sync) + sync_dirty_bytes) /
+            expected_bw_per_ms;
     }
 
     migration_rate_reset();
@@ -3511,11 +3579,16 @@ static MigIterateState migration_iteration_run(MigrationState *s)
          * during postcopy phase.
          */
         if (pending_size < s->threshold_size) {
+            int64_t start = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
+
             qemu_savevm_state_pending_exact(&must_precopy, &can_postcopy);
             pending_size = must_precopy + can_postcopy;
+            s->pending_exact_time = qemu_clock_get_us(QEMU_CLOCK_REALTIME) -
+                                    start;
             trace_migrate_pending_exact(pending_size, must_precopy,
                                         can_postcopy);
         }
+        s->pending_size = pending_size;
 
         /* Should we switch to postcopy now? */
         if (must_precopy <= s->threshold_size &&
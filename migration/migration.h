@@ -39,6 +39,7 @@
 #define  MIGRATION_THREAD_DST_COLO          "mig/dst/colo"
 #define  MIGRATION_THREAD_DST_MULTIFD       "mig/dst/recv_%d"
 #define  MIGRATION_THREAD_DST_FAULT         "mig/dst/fault"
+#define  MIGRATION_THREAD_DST_FAULT_WORKER  "mig/dst/fault_%d"
 #define  MIGRATION_THREAD_DST_LISTEN        "mig/dst/listen"
 #define  MIGRATION_THREAD_DST_PREEMPT       "mig/dst/preempt"
 
@@ -113,7 +114,13 @@ struct MigrationIncomingState {
     size_t         largest_page_size;
     bool           have_fault_thread;
     QemuThread     fault_thread;
-    /* Set this when we want the fault thread to quit */
+    /*
+     * Extra threads reading userfaultfd faults next to fault_thread, only
+     * fault_thread handles the shared memory faults of remote processes.
+     */
+    QemuThread     *fault_workers;
+    int            fault_workers_num;
+    /* Set this when we want the fault threads to quit */
     bool           fault_thread_quit;
 
     bool           have_listen_thread;
@@ -121,11 +128,14 @@ struct MigrationIncomingState {
 
     /* For the kernel to send us notifications */
     int       userfault_fd;
-    /* To notify the fault_thread to wake, e.g., when need to quit */
+    /*
+     * To notify the fault threads to wake, e.g., when need to quit.  It is
+     * a semaphore eventfd, each notification wakes every fault thread.
+     */
     int       userfault_event_fd;
     QEMUFile *to_src_file;
     QemuMutex rp_mutex;    /* We send replies from multiple threads */
-    /* RAMBlock of last request sent to source */
+    /* RAMBlock of last request sent to source, protected by rp_mutex */
     RAMBlock *last_rb;
     /*
      * Number of postcopy channels including the default precopy channel, so
@@ -359,6 +369,15 @@ struct MigrationState {
     int64_t downtime_start;
     int64_t downtime;
     int64_t expected_downtime;
+    /*
+     * Inputs of the downtime model: average bandwidth and dirty rate
+     * (bytes/ms), pending data and time spent computing it exactly (us)
+     * at the last iteration
+     */
+    double bandwidth_avg;
+    double dirty_rate_avg;
+    uint64_t pending_size;
+    int64_t pending_exact_time;
     bool capabilities[MIGRATION_CAPABILITY__MAX];
     int64_t setup_time;
 
@@ -0,0 +1,158 @@
+/*
+ * Multifd detection of incompressible pages
+ *
+ * Pages of encrypted or already compressed data do not shrink when they
+ * are compressed again, so the zlib and zstd methods can send them as
+ * they are.  Such pages are recognized by the Shannon entropy of a sample
+ * of their bytes, and are moved to the end of the normal pages of the
+ * packet; the packet header tells the destination how many of them there
+ * are.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include <math.h>
+#include "system/ramblock.h"
+#include "qapi/error.h"
+#include "migration.h"
+#include "multifd.h"
+#include "options.h"
+
+/* Number of bytes sampled from each page */
+#define MULTIFD_ENTROPY_SAMPLES 256
+
+/* c * log2(c) for each possible count of a byte value in the sample */
+static float entropy_clog2c[MULTIFD_ENTROPY_SAMPLES + 1];
+
+static void __attribute__((constructor)) multifd_entropy_init(void)
+{
+    for (int c = 1; c <= MULTIFD_ENTROPY_SAMPLES; c++) {
+        entropy_clog2c[c] = c * log2f(c);
+    }
+}
+
+/*
+ * Estimate the entropy of a page, as a percentage of 8 bits per byte.
+ * The page is split in MULTIFD_ENTROPY_SAMPLES slices and one byte is
+ * taken from each, at an offset that varies among slices so that arrays
+ * of structs do not always yield the same field.
+ */
+static unsigned int multifd_page_entropy(const uint8_t *page, size_t size)
+{
+    uint16_t count[256] = { 0 };
+    size_t stride = size / MULTIFD_ENTROPY_SAMPLES;
+    float sum = 0;
+    float bits;
+    int i;
+
+    for (i = 0; i < MULTIFD_ENTROPY_SAMPLES; i++) {
+        count[page[i * stride + (i * 7) % stride]]++;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(count); i++) {
+        sum += entropy_clog2c[count[i]];
+    }
+
+    /* H = log2(N) - sum(c * log2(c)) / N */
+    bits = log2f(MULTIFD_ENTROPY_SAMPLES) - sum / MULTIFD_ENTROPY_SAMPLES;
+    return bits * 100 / 8;
+}
+
+static void swap_page_offset(ram_addr_t *pages_offset, int a, int b)
+{
+    ram_addr_t temp;
+
+    if (a == b) {
+        return;
+    }
+
+    temp = pages_offset[a];
+    pages_offset[a] = pages_offset[b];
+    pages_offset[b] = temp;
+}
+
+/**
+ * multifd_send_raw_page_detect: Find the normal pages that are not worth
+ * compressing.
+ *
+ * Must be called after zero page detection.  Sorts the pages that should
+ * be compressed before the others in p->pages->offset, and updates
+ * p->pages->raw_num.
+ *
+ * @param p A pointer to the send params.
+ */
+void multifd_send_raw_page_detect(MultiFDSendParams *p)
+{
+    MultiFDPages_t *pages = &p->data->u.ram;
+    unsigned int threshold = migrate_multifd_raw_entropy();
+    uint32_t page_size = multifd_ram_page_size();
+    RAMBlock *rb = pages->block;
+    int i = 0;
+    int j = pages->normal_num - 1;
+
+    if (!threshold) {
+        pages->raw_num = 0;
+        return;
+    }
+
+    while (i <= j) {
+        uint8_t *page = rb->host + pages->offset[i];
+
+        if (multifd_page_entropy(page, page_size) < threshold) {
+            i++;
+            continue;
+        }
+
+        swap_page_offset(pages->offset, i, j);
+        j--;
+    }
+
+    pages->raw_num = pages->normal_num - i;
+}
+
+/**
+ * multifd_send_prepare_raw_iovs: Add the pages that are not compressed
+ * to the packet, after the compressed data.
+ *
+ * @param p A pointer to the send params.
+ */
+void multifd_send_prepare_raw_iovs(MultiFDSendParams *p)
+{
+    MultiFDPages_t *pages = &p->data->u.ram;
+    uint32_t page_size = multifd_ram_page_size();
+
+    for (int i = pages->normal_num - pages->raw_num; i < pages->normal_num;
+         i++) {
+        p->iov[p->iovs_num].iov_base = pages->block->host + pages->offset[i];
+        p->iov[p->iovs_num].iov_len = page_size;
+        p->iovs_num++;
+    }
+
+    p->next_packet_size += pages->raw_num * page_size;
+}
+
+/**
+ * multifd_recv_raw_pages: Receive the pages that were not compressed.
+ *
+ * Must be called after the compressed data has been read.
+ *
+ * @param p A pointer to the recv params.
+ * @param errp Pointer to the error.
+ */
+int multifd_recv_raw_pages(MultiFDRecvParams *p, Error **errp)
+{
+    uint32_t first = p->normal_num - p->raw_num;
+
+    if (!p->raw_num) {
+        return 0;
+    }
+
+    for (int i = 0; i < p->raw_num; i++) {
+        p->iov[i].iov_base = p->host + p->normal[first + i];
+        p->iov[i].iov_len = multifd_ram_page_size();
+        ramblock_recv_bitmap_set_offset(p->block, p->normal[first + i]);
+    }
+    return qio_channel_readv_all(p->c, p->iov, p->raw_num, errp);
+}
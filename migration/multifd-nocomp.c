@@ -197,6 +197,7 @@ static void multifd_pages_reset(MultiFDPages_t *pages)
      */
     pages->num = 0;
     pages->normal_num = 0;
+    pages->raw_num = 0;
     pages->block = NULL;
 }
 
@@ -209,6 +210,7 @@ void multifd_ram_fill_packet(MultiFDSendParams *p)
     packet->pages_alloc = cpu_to_be32(multifd_ram_page_count());
     packet->normal_pages = cpu_to_be32(pages->normal_num);
     packet->zero_pages = cpu_to_be32(zero_num);
+    packet->raw_pages = cpu_to_be32(pages->raw_num);
 
     if (pages->block) {
         pstrcpy(packet->ramblock, sizeof(packet->ramblock),
@@ -256,6 +258,14 @@ int multifd_ram_unfill_packet(MultiFDRecvParams *p, Error **errp)
         return -1;
     }
 
+    p->raw_num = be32_to_cpu(packet->raw_pages);
+    if (p->raw_num > p->normal_num) {
+        error_setg(errp,
+                   "multifd: received packet with %u raw pages, expected maximum %u",
+                   p->raw_num, p->normal_num);
+        return -1;
+    }
+
     if (p->normal_num == 0 && p->zero_num == 0) {
         return 0;
     }
@@ -0,0 +1,361 @@
+/*
+ * Multifd XBZRLE compression implementation
+ *
+ * Pages are sent as XBZRLE deltas against the copy of the page that was
+ * sent last, which the destination still has in guest RAM.  The copies are
+ * kept in a page cache shared by all the channels, because consecutive
+ * versions of a page are usually sent through different channels.
+ *
+ * The cache is direct mapped, so an address always lives in the same slot;
+ * the slots are protected by a small array of locks hashed the same way.
+ * A page is queued at most once per dirty bitmap round, and the rounds are
+ * separated by a multifd sync, so two channels never work on the same page
+ * at the same time and the destination applies the deltas in order.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/bswap.h"
+#include "qemu/thread.h"
+#include "system/ramblock.h"
+#include "exec/target_page.h"
+#include "qapi/error.h"
+#include "migration.h"
+#include "migration-stats.h"
+#include "options.h"
+#include "page_cache.h"
+#include "xbzrle.h"
+#include "multifd.h"
+#include "trace.h"
+
+/* Number of locks protecting the shared cache, a power of two */
+#define XBZRLE_CACHE_LOCKS 64
+
+typedef struct {
+    PageCache *cache;
+    /* Number of locks in use, at most the number of cache slots */
+    unsigned int nr_locks;
+    QemuMutex lock[XBZRLE_CACHE_LOCKS];
+    uint8_t *zero_page;
+    /* Number of send channels set up */
+    int users;
+} MultiFDXbzrleCache;
+
+static MultiFDXbzrleCache xbzrle_cache;
+
+/*
+ * Every packet starts with the length of each normal page, as a big endian
+ * 32-bit value, followed by the data of the pages:
+ *
+ * - 0: the page did not change since it was sent last, there is no data
+ * - the page size: the page is sent as is
+ * - anything else: the length of the XBZRLE delta
+ */
+struct xbzrle_data {
+    /* lengths of the pages */
+    uint32_t *lens;
+    /* deltas and raw pages */
+    uint8_t *buf;
+    /* size of buf */
+    uint32_t buf_len;
+    /* copy of the page being encoded */
+    uint8_t *page;
+};
+
+static QemuMutex *xbzrle_cache_lock(ram_addr_t addr)
+{
+    MultiFDXbzrleCache *c = &xbzrle_cache;
+
+    return &c->lock[(addr / multifd_ram_page_size()) & (c->nr_locks - 1)];
+}
+
+static bool multifd_xbzrle_cache_get(Error **errp)
+{
+    MultiFDXbzrleCache *c = &xbzrle_cache;
+    uint64_t size = migrate_xbzrle_cache_size();
+    int i;
+
+    if (c->users) {
+        c->users++;
+        return true;
+    }
+
+    c->cache = cache_init(size, multifd_ram_page_size(), errp);
+    if (!c->cache) {
+        return false;
+    }
+    c->nr_locks = MIN(size / multifd_ram_page_size(), XBZRLE_CACHE_LOCKS);
+    for (i = 0; i < c->nr_locks; i++) {
+        qemu_mutex_init(&c->lock[i]);
+    }
+    c->zero_page = g_malloc0(multifd_ram_page_size());
+    c->users = 1;
+    return true;
+}
+
+static void multifd_xbzrle_cache_put(void)
+{
+    MultiFDXbzrleCache *c = &xbzrle_cache;
+    int i;
+
+    assert(c->users > 0);
+    if (--c->users) {
+        return;
+    }
+
+    for (i = 0; i < c->nr_locks; i++) {
+        qemu_mutex_destroy(&c->lock[i]);
+    }
+    g_clear_pointer(&c->cache, cache_fini);
+    g_clear_pointer(&c->zero_page, g_free);
+}
+
+/* Multifd XBZRLE compression */
+
+static int multifd_xbzrle_send_setup(MultiFDSendParams *p, Error **errp)
+{
+    struct xbzrle_data *x;
+    uint32_t page_count = multifd_ram_page_count();
+
+    if (!multifd_xbzrle_cache_get(errp)) {
+        error_prepend(errp, "multifd %u: ", p->id);
+        return -1;
+    }
+
+    x = g_new0(struct xbzrle_data, 1);
+    x->lens = g_new(uint32_t, page_count);
+    x->buf_len = page_count * multifd_ram_page_size();
+    x->buf = g_malloc(x->buf_len);
+    x->page = g_malloc(multifd_ram_page_size());
+    p->compress_data = x;
+
+    /* Needs 3 IOVs: packet header, page lengths and page data */
+    p->iov = g_new0(struct iovec, 3);
+
+    return 0;
+}
+
+static void multifd_xbzrle_send_cleanup(MultiFDSendParams *p, Error **errp)
+{
+    struct xbzrle_data *x = p->compress_data;
+
+    if (x) {
+        g_free(x->lens);
+        g_free(x->buf);
+        g_free(x->page);
+        g_free(x);
+        p->compress_data = NULL;
+        multifd_xbzrle_cache_put();
+    }
+
+    g_free(p->iov);
+    p->iov = NULL;
+}
+
+/*
+ * Encode the page at @offset of @block into @dst, which has room for a
+ * whole page.  Returns the length stored for it in the packet.
+ */
+static uint32_t multifd_xbzrle_encode_page(struct xbzrle_data *x,
+                                           RAMBlock *block, ram_addr_t offset,
+                                           uint8_t *dst, uint64_t generation)
+{
+    MultiFDXbzrleCache *c = &xbzrle_cache;
+    ram_addr_t addr = block->offset + offset;
+    uint32_t page_size = multifd_ram_page_size();
+    int len = -1;
+
+    /*
+     * The guest may be changing the page concurrently: take a copy so that
+     * the cache holds exactly what the destination will have.
+     */
+    memcpy(x->page, block->host + offset, page_size);
+
+    QEMU_LOCK_GUARD(xbzrle_cache_lock(addr));
+
+    if (cache_is_cached(c->cache, addr, generation)) {
+        /* One byte less than a page, so that a delta never looks raw */
+        len = xbzrle_encode_buffer(get_cached_data(c->cache, addr), x->page,
+                                   page_size, dst, page_size - 1);
+    }
+    if (len < 0) {
+        memcpy(dst, x->page, page_size);
+        len = page_size;
+    }
+
+    /*
+     * Failing to insert only means that another recently used page keeps
+     * the slot, in which case this page is not cached at all.
+     */
+    cache_insert(c->cache, addr, x->page, generation);
+    return len;
+}
+
+static void multifd_xbzrle_cache_zero_pages(MultiFDPages_t *pages,
+                                            uint64_t generation)
+{
+    MultiFDXbzrleCache *c = &xbzrle_cache;
+    uint32_t i;
+
+    /* The destination clears zero pages, the cache has to follow */
+    for (i = pages->normal_num; i < pages->num; i++) {
+        ram_addr_t addr = pages->block->offset + pages->offset[i];
+
+        WITH_QEMU_LOCK_GUARD(xbzrle_cache_lock(addr)) {
+            cache_insert(c->cache, addr, c->zero_page, generation);
+        }
+    }
+}
+
+static int multifd_xbzrle_send_prepare(MultiFDSendParams *p, Error **errp)
+{
+    MultiFDPages_t *pages = &p->data->u.ram;
+    struct xbzrle_data *x = p->compress_data;
+    uint64_t generation = stat64_get(&mig_stats.dirty_sync_count);
+    uint32_t out_size = 0;
+    uint32_t deltas = 0;
+    bool has_normal;
+    uint32_t i;
+
+    has_normal = multifd_send_prepare_common(p);
+    multifd_xbzrle_cache_zero_pages(pages, generation);
+    if (!has_normal) {
+        goto out;
+    }
+
+    for (i = 0; i < pages->normal_num; i++) {
+        uint32_t len = multifd_xbzrle_encode_page(x, pages->block,
+                                                  pages->offset[i],
+                                                  x->buf + out_size,
+                                                  generation);
+
+        if (len != multifd_ram_page_size()) {
+            deltas++;
+        }
+        x->lens[i] = cpu_to_be32(len);
+        out_size += len;
+    }
+
+    p->iov[p->iovs_num].iov_base = x->lens;
+    p->iov[p->iovs_num].iov_len = pages->normal_num * sizeof(uint32_t);
+    p->iovs_num++;
+    if (out_size) {
+        p->iov[p->iovs_num].iov_base = x->buf;
+        p->iov[p->iovs_num].iov_len = out_size;
+        p->iovs_num++;
+    }
+    p->next_packet_size = pages->normal_num * sizeof(uint32_t) + out_size;
+    trace_multifd_xbzrle_send(p->id, pages->normal_num, deltas, out_size);
+
+out:
+    p->flags |= MULTIFD_FLAG_XBZRLE;
+    multifd_send_fill_packet(p);
+    return 0;
+}
+
+static int multifd_xbzrle_recv_setup(MultiFDRecvParams *p, Error **errp)
+{
+    struct xbzrle_data *x = g_new0(struct xbzrle_data, 1);
+    uint32_t page_count = multifd_ram_page_count();
+
+    x->buf_len = page_count * (sizeof(uint32_t) + multifd_ram_page_size());
+    x->buf = g_malloc(x->buf_len);
+    p->compress_data = x;
+    return 0;
+}
+
+static void multifd_xbzrle_recv_cleanup(MultiFDRecvParams *p)
+{
+    struct xbzrle_data *x = p->compress_data;
+
+    g_free(x->buf);
+    g_free(p->compress_data);
+    p->compress_data = NULL;
+}
+
+static int multifd_xbzrle_recv(MultiFDRecvParams *p, Error **errp)
+{
+    struct xbzrle_data *x = p->compress_data;
+    uint32_t in_size = p->next_packet_size;
+    uint32_t page_size = multifd_ram_page_size();
+    uint32_t flags = p->flags & MULTIFD_FLAG_COMPRESSION_MASK;
+    uint32_t hdr_size = p->normal_num * sizeof(uint32_t);
+    uint8_t *data;
+    uint32_t i;
+    int ret;
+
+    if (flags != MULTIFD_FLAG_XBZRLE) {
+        error_setg(errp, "multifd %u: flags received %x flags expected %x",
+                   p->id, flags, MULTIFD_FLAG_XBZRLE);
+        return -1;
+    }
+
+    multifd_recv_zero_page_process(p);
+
+    if (!p->normal_num) {
+        assert(in_size == 0);
+        return 0;
+    }
+
+    if (in_size < hdr_size || in_size > x->buf_len) {
+        error_setg(errp, "multifd %u: received packet size %u is invalid",
+                   p->id, in_size);
+        return -1;
+    }
+
+    ret = qio_channel_read_all(p->c, (void *)x->buf, in_size, errp);
+    if (ret != 0) {
+        return ret;
+    }
+
+    data = x->buf + hdr_size;
+    in_size -= hdr_size;
+
+    for (i = 0; i < p->normal_num; i++) {
+        uint32_t len = ldl_be_p(x->buf + i * sizeof(uint32_t));
+        uint8_t *host = p->host + p->normal[i];
+
+        ramblock_recv_bitmap_set_offset(p->block, p->normal[i]);
+        if (len > in_size || len > page_size) {
+            error_setg(errp, "multifd %u: page length %u is invalid",
+                       p->id, len);
+            return -1;
+        }
+
+        if (len == page_size) {
+            memcpy(host, data, page_size);
+        } else if (len && xbzrle_decode_buffer(data, len, host,
+                                               page_size) < 0) {
+            error_setg(errp, "multifd %u: failed to decode XBZRLE page",
+                       p->id);
+            return -1;
+        }
+        data += len;
+        in_size -= len;
+    }
+
+    if (in_size) {
+        error_setg(errp, "multifd %u: %u bytes left at the end of packet",
+                   p->id, in_size);
+        return -1;
+    }
+
+    return 0;
+}
+
+static const MultiFDMethods multifd_xbzrle_ops = {
+    .send_setup = multifd_xbzrle_send_setup,
+    .send_cleanup = multifd_xbzrle_send_cleanup,
+    .send_prepare = multifd_xbzrle_send_prepare,
+    .recv_setup = multifd_xbzrle_recv_setup,
+    .recv_cleanup = multifd_xbzrle_recv_cleanup,
+    .recv = multifd_xbzrle_recv
+};
+
+static void multifd_xbzrle_register(void)
+{
+    multifd_register_ops(MULTIFD_COMPRESSION_XBZRLE, &multifd_xbzrle_ops);
+}
+
+migration_init(multifd_xbzrle_register);
@@ -19,6 +19,20 @@
 #include "options.h"
 #include "ram.h"
 
+/*
+ * Longest run of contiguous pages tested with a single buffer_is_zero()
+ * call.  Mostly empty guests have long runs of zero pages, and scanning
+ * them at once keeps the vector loop of buffer_is_zero() going instead
+ * of restarting it for every page.
+ */
+#define MULTIFD_ZERO_RUN_MAX 16
+
+/*
+ * Shortest range of pages that had been received and are now zero that
+ * the destination discards instead of clearing.
+ */
+#define MULTIFD_ZERO_DISCARD_MIN (64 * KiB)
+
 static bool multifd_zero_page_enabled(void)
 {
     return migrate_zero_page_detection() == ZERO_PAGE_DETECTION_MULTIFD;
@@ -49,6 +63,8 @@ void multifd_send_zero_page_detect(MultiFDSendParams *p)
 {
     MultiFDPages_t *pages = &p->data->u.ram;
     RAMBlock *rb = pages->block;
+    uint32_t page_size = multifd_ram_page_size();
+    int single = 0;
     int i = 0;
     int j = pages->num - 1;
 
@@ -63,15 +79,44 @@ void multifd_send_zero_page_detect(MultiFDSendParams *p)
      */
     while (i <= j) {
         uint64_t offset = pages->offset[i];
+        int run = 1;
 
-        if (!buffer_is_zero(rb->host + offset, multifd_ram_page_size())) {
+        /*
+         * Look for pages that follow this one in memory and are likely
+         * to be zero too, and test them all at once.  If any of them is
+         * not zero, do not try again before they have all been sorted so
+         * that no page is scanned more than twice.
+         */
+        if (single) {
+            single--;
+        } else {
+            while (run < MULTIFD_ZERO_RUN_MAX && i + run <= j &&
+                   pages->offset[i + run] == offset + run * page_size &&
+                   buffer_is_zero_sample3((char *)rb->host + offset +
+                                          run * page_size, page_size)) {
+                run++;
+            }
+            if (run > 1 &&
+                !buffer_is_zero(rb->host + offset, run * page_size)) {
+                single = run - 1;
+                run = 1;
+            }
+        }
+
+        if (run == 1 && !buffer_is_zero(rb->host + offset, page_size)) {
             i++;
             continue;
         }
 
-        swap_page_offset(pages->offset, i, j);
-        ram_release_page(rb->idstr, offset);
-        j--;
+        /*
+         * Move the run to the end, last page first, so that it stays in
+         * ascending order for the destination.
+         */
+        for (int k = run - 1; k >= 0; k--) {
+            swap_page_offset(pages->offset, i + k, j);
+            ram_release_page(rb->idstr, offset + k * page_size);
+            j--;
+        }
     }
 
     pages->normal_num = i;
@@ -81,8 +126,51 @@ out:
     stat64_add(&mig_stats.zero_pages, pages->num - pages->normal_num);
 }
 
+/*
+ * Pages that the guest may not have touched do not need to be cleared:
+ * a fresh page is zero already.  Reading it, rather than writing it, is
+ * enough to map it, and for anonymous memory does not allocate it.
+ */
+static void multifd_recv_zero_page_touch(void *page, size_t size)
+{
+    if (!buffer_is_zero(page, size)) {
+        memset(page, 0, size);
+    }
+}
+
+/*
+ * Whether zero pages of @block that were received before can be given
+ * back to the host instead of being cleared.  Postcopy relies on the
+ * pages marked as received being present, and discarding anonymous
+ * memory has only the expected result for private mappings.
+ */
+static bool multifd_recv_zero_page_can_discard(RAMBlock *block)
+{
+    return !migrate_postcopy_ram() && block->fd < 0 &&
+           !qemu_ram_is_shared(block) && !ram_block_discard_is_disabled();
+}
+
+/* Clear @length bytes at @offset of @block, which were received before */
+static void multifd_recv_zero_page_clear(RAMBlock *block, bool discard,
+                                         ram_addr_t offset, size_t length)
+{
+    size_t align = qemu_ram_pagesize(block);
+
+    if (discard && length >= MULTIFD_ZERO_DISCARD_MIN &&
+        QEMU_IS_ALIGNED(offset | length, align) &&
+        !ram_block_discard_range(block, offset, length)) {
+        return;
+    }
+    memset(block->host + offset, 0, length);
+}
+
 void multifd_recv_zero_page_process(MultiFDRecvParams *p)
 {
+    uint32_t page_size = multifd_ram_page_size();
+    bool discard = multifd_recv_zero_page_can_discard(p->block);
+    ram_addr_t start = 0;
+    size_t length = 0;
+
     for (int i = 0; i < p->zero_num; i++) {
         void *page = p->host + p->zero[i];
         bool received =
@@ -99,14 +187,32 @@ void multifd_recv_zero_page_process(MultiFDRecvParams *p)
          * 'receivedmap' says the zero page is already received. Thus the
          * thread accessing that page may hang.
          *
-         * When postcopy is enabled, always write the zero page as and when
+         * When postcopy is enabled, always map the zero page as and when
          * it is migrated.
          */
-        if (migrate_postcopy_ram() || received) {
-            memset(page, 0, multifd_ram_page_size());
-        }
-        if (!received) {
+        if (received) {
+            /*
+             * The source sends contiguous zero pages in ascending order,
+             * clear them together.
+             */
+            if (length && p->zero[i] == start + length) {
+                length += page_size;
+                continue;
+            }
+            if (length) {
+                multifd_recv_zero_page_clear(p->block, discard, start, length);
+            }
+            start = p->zero[i];
+            length = page_size;
+        } else {
+            if (migrate_postcopy_ram()) {
+                multifd_recv_zero_page_touch(page, page_size);
+            }
             ramblock_recv_bitmap_set_offset(p->block, p->zero[i]);
         }
     }
+
+    if (length) {
+        multifd_recv_zero_page_clear(p->block, discard, start, length);
+    }
 }
@@ -48,9 +48,7 @@ static int multifd_zlib_send_setup(MultiFDSendParams *p, Error **errp)
         goto err_free_z;
     }
     /* This is the maximum size of the compressed buffer */
-    z->zbuff_len = compressBound(MULTIFD_PACKET_SIZE);
-    z->zbuff = g_try_malloc(z->zbuff_len);
-    if (!z->zbuff) {
+    if (!multifd_send_bufs_alloc(p, compressBound(MULTIFD_PACKET_SIZE))) {
         err_msg = "out of memory for zbuff";
         goto err_deflate_end;
     }
@@ -61,13 +59,16 @@ static int multifd_zlib_send_setup(MultiFDSendParams *p, Error **errp)
     }
     p->compress_data = z;
 
-    /* Needs 2 IOVs, one for packet header and one for compressed data */
-    p->iov = g_new0(struct iovec, 2);
+    /*
+     * Needs 2 IOVs, one for packet header and one for compressed data,
+     * plus one for each page that is not compressed
+     */
+    p->iov = g_new0(struct iovec, 2 + multifd_ram_page_count());
 
     return 0;
 
 err_free_zbuff:
-    g_free(z->zbuff);
+    multifd_send_bufs_free(p);
 err_deflate_end:
     deflateEnd(zs);
 err_free_z:
@@ -81,8 +82,7 @@ static void multifd_zlib_send_cleanup(MultiFDSendParams *p, Error **errp)
     struct zlib_data *z = p->compress_data;
 
     deflateEnd(&z->zs);
-    g_free(z->zbuff);
-    z->zbuff = NULL;
+    multifd_send_bufs_free(p);
     g_free(z->buf);
     z->buf = NULL;
     g_free(p->compress_data);
@@ -99,6 +99,8 @@ static int multifd_zlib_send_prepare(MultiFDSendParams *p, Error **errp)
     z_stream *zs = &z->zs;
     uint32_t out_size = 0;
     uint32_t page_size = multifd_ram_page_size();
+    uint32_t compress_num;
+    uint8_t *zbuff;
     int ret;
     uint32_t i;
 
@@ -106,11 +108,19 @@ static int multifd_zlib_send_prepare(MultiFDSendParams *p, Error **errp)
         goto out;
     }
 
-    for (i = 0; i < pages->normal_num; i++) {
-        uint32_t available = z->zbuff_len - out_size;
+    multifd_send_raw_page_detect(p);
+    compress_num = pages->normal_num - pages->raw_num;
+
+    zbuff = multifd_send_buf_get(p, errp);
+    if (!zbuff) {
+        return -1;
+    }
+
+    for (i = 0; i < compress_num; i++) {
+        uint32_t available = p->buf_len - out_size;
         int flush = Z_NO_FLUSH;
 
-        if (i == pages->normal_num - 1) {
+        if (i == compress_num - 1) {
             flush = Z_SYNC_FLUSH;
         }
 
@@ -124,7 +134,7 @@ static int multifd_zlib_send_prepare(MultiFDSendParams *p, Error **errp)
         zs->next_in = z->buf;
 
         zs->avail_out = available;
-        zs->next_out = z->zbuff + out_size;
+        zs->next_out = zbuff + out_size;
 
         /*
          * Welcome to deflate semantics
@@ -149,10 +159,13 @@ static int multifd_zlib_send_prepare(MultiFDSendParams *p, Error **errp)
         }
         out_size += available - zs->avail_out;
     }
-    p->iov[p->iovs_num].iov_base = z->zbuff;
-    p->iov[p->iovs_num].iov_len = out_size;
-    p->iovs_num++;
+    if (out_size) {
+        p->iov[p->iovs_num].iov_base = zbuff;
+        p->iov[p->iovs_num].iov_len = out_size;
+        p->iovs_num++;
+    }
     p->next_packet_size = out_size;
+    multifd_send_prepare_raw_iovs(p);
 
 out:
     p->flags |= MULTIFD_FLAG_ZLIB;
@@ -183,6 +196,8 @@ static int multifd_zlib_recv_setup(MultiFDRecvParams *p, Error **errp)
         error_setg(errp, "multifd %u: out of memory for zbuff", p->id);
         return -1;
     }
+    /* For the pages that are not compressed */
+    p->iov = g_new0(struct iovec, multifd_ram_page_count());
     return 0;
 }
 
@@ -195,6 +210,8 @@ static void multifd_zlib_recv_cleanup(MultiFDRecvParams *p)
     z->zbuff = NULL;
     g_free(p->compress_data);
     p->compress_data = NULL;
+    g_free(p->iov);
+    p->iov = NULL;
 }
 
 static int multifd_zlib_recv(MultiFDRecvParams *p, Error **errp)
@@ -205,7 +222,8 @@ static int multifd_zlib_recv(MultiFDRecvParams *p, Error **errp)
     /* we measure the change of total_out */
     uint32_t out_size = zs->total_out;
     uint32_t page_size = multifd_ram_page_size();
-    uint32_t expected_size = p->normal_num * page_size;
+    uint32_t compress_num = p->normal_num - p->raw_num;
+    uint32_t expected_size = compress_num * page_size;
     uint32_t flags = p->flags & MULTIFD_FLAG_COMPRESSION_MASK;
     int ret;
     int i;
@@ -223,21 +241,30 @@ static int multifd_zlib_recv(MultiFDRecvParams *p, Error **errp)
         return 0;
     }
 
-    ret = qio_channel_read_all(p->c, (void *)z->zbuff, in_size, errp);
+    if (in_size < p->raw_num * page_size) {
+        error_setg(errp, "multifd %u: packet size %u too small for "
+                   "%u raw pages", p->id, in_size, p->raw_num);
+        return -1;
+    }
+    in_size -= p->raw_num * page_size;
+
+    if (in_size) {
+        ret = qio_channel_read_all(p->c, (void *)z->zbuff, in_size, errp);
 
-    if (ret != 0) {
-        return ret;
+        if (ret != 0) {
+            return ret;
+        }
     }
 
     zs->avail_in = in_size;
     zs->next_in = z->zbuff;
 
-    for (i = 0; i < p->normal_num; i++) {
+    for (i = 0; i < compress_num; i++) {
         int flush = Z_NO_FLUSH;
         unsigned long start = zs->total_out;
 
         ramblock_recv_bitmap_set_offset(p->block, p->normal[i]);
-        if (i == p->normal_num - 1) {
+        if (i == compress_num - 1) {
             flush = Z_SYNC_FLUSH;
         }
 
@@ -274,7 +301,7 @@ static int multifd_zlib_recv(MultiFDRecvParams *p, Error **errp)
         return -1;
     }
 
-    return 0;
+    return multifd_recv_raw_pages(p, errp);
 }
 
 static const MultiFDMethods multifd_zlib_ops = {
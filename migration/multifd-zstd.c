@@ -58,9 +58,7 @@ static int multifd_zstd_send_setup(MultiFDSendParams *p, Error **errp)
         return -1;
     }
     /* This is the maximum size of the compressed buffer */
-    z->zbuff_len = ZSTD_compressBound(MULTIFD_PACKET_SIZE);
-    z->zbuff = g_try_malloc(z->zbuff_len);
-    if (!z->zbuff) {
+    if (!multifd_send_bufs_alloc(p, ZSTD_compressBound(MULTIFD_PACKET_SIZE))) {
         ZSTD_freeCStream(z->zcs);
         g_free(z);
         error_setg(errp, "multifd %u: out of memory for zbuff", p->id);
@@ -68,8 +66,11 @@ static int multifd_zstd_send_setup(MultiFDSendParams *p, Error **errp)
     }
     p->compress_data = z;
 
-    /* Needs 2 IOVs, one for packet header and one for compressed data */
-    p->iov = g_new0(struct iovec, 2);
+    /*
+     * Needs 2 IOVs, one for packet header and one for compressed data,
+     * plus one for each page that is not compressed
+     */
+    p->iov = g_new0(struct iovec, 2 + multifd_ram_page_count());
     return 0;
 }
 
@@ -79,8 +80,7 @@ static void multifd_zstd_send_cleanup(MultiFDSendParams *p, Error **errp)
 
     ZSTD_freeCStream(z->zcs);
     z->zcs = NULL;
-    g_free(z->zbuff);
-    z->zbuff = NULL;
+    multifd_send_bufs_free(p);
     g_free(p->compress_data);
     p->compress_data = NULL;
 
@@ -92,6 +92,7 @@ static int multifd_zstd_send_prepare(MultiFDSendParams *p, Error **errp)
 {
     MultiFDPages_t *pages = &p->data->u.ram;
     struct zstd_data *z = p->compress_data;
+    uint32_t compress_num;
     int ret;
     uint32_t i;
 
@@ -99,14 +100,20 @@ static int multifd_zstd_send_prepare(MultiFDSendParams *p, Error **errp)
         goto out;
     }
 
-    z->out.dst = z->zbuff;
-    z->out.size = z->zbuff_len;
+    multifd_send_raw_page_detect(p);
+    compress_num = pages->normal_num - pages->raw_num;
+
+    z->out.dst = multifd_send_buf_get(p, errp);
+    if (!z->out.dst) {
+        return -1;
+    }
+    z->out.size = p->buf_len;
     z->out.pos = 0;
 
-    for (i = 0; i < pages->normal_num; i++) {
+    for (i = 0; i < compress_num; i++) {
         ZSTD_EndDirective flush = ZSTD_e_continue;
 
-        if (i == pages->normal_num - 1) {
+        if (i == compress_num - 1) {
             flush = ZSTD_e_flush;
         }
         z->in.src = pages->block->host + pages->offset[i];
@@ -136,10 +143,13 @@ static int multifd_zstd_send_prepare(MultiFDSendParams *p, Error **errp)
             return -1;
         }
     }
-    p->iov[p->iovs_num].iov_base = z->zbuff;
-    p->iov[p->iovs_num].iov_len = z->out.pos;
-    p->iovs_num++;
+    if (z->out.pos) {
+        p->iov[p->iovs_num].iov_base = z->out.dst;
+        p->iov[p->iovs_num].iov_len = z->out.pos;
+        p->iovs_num++;
+    }
     p->next_packet_size = z->out.pos;
+    multifd_send_prepare_raw_iovs(p);
 
 out:
     p->flags |= MULTIFD_FLAG_ZSTD;
@@ -178,6 +188,8 @@ static int multifd_zstd_recv_setup(MultiFDRecvParams *p, Error **errp)
         error_setg(errp, "multifd %u: out of memory for zbuff", p->id);
         return -1;
     }
+    /* For the pages that are not compressed */
+    p->iov = g_new0(struct iovec, multifd_ram_page_count());
     return 0;
 }
 
@@ -191,6 +203,8 @@ static void multifd_zstd_recv_cleanup(MultiFDRecvParams *p)
     z->zbuff = NULL;
     g_free(p->compress_data);
     p->compress_data = NULL;
+    g_free(p->iov);
+    p->iov = NULL;
 }
 
 static int multifd_zstd_recv(MultiFDRecvParams *p, Error **errp)
@@ -198,7 +212,8 @@ static int multifd_zstd_recv(MultiFDRecvParams *p, Error **errp)
     uint32_t in_size = p->next_packet_size;
     uint32_t out_size = 0;
     uint32_t page_size = multifd_ram_page_size();
-    uint32_t expected_size = p->normal_num * page_size;
+    uint32_t compress_num = p->normal_num - p->raw_num;
+    uint32_t expected_size = compress_num * page_size;
     uint32_t flags = p->flags & MULTIFD_FLAG_COMPRESSION_MASK;
     struct zstd_data *z = p->compress_data;
     int ret;
@@ -217,17 +232,26 @@ static int multifd_zstd_recv(MultiFDRecvParams *p, Error **errp)
         return 0;
     }
 
-    ret = qio_channel_read_all(p->c, (void *)z->zbuff, in_size, errp);
+    if (in_size < p->raw_num * page_size) {
+        error_setg(errp, "multifd %u: packet size %u too small for "
+                   "%u raw pages", p->id, in_size, p->raw_num);
+        return -1;
+    }
+    in_size -= p->raw_num * page_size;
+
+    if (in_size) {
+        ret = qio_channel_read_all(p->c, (void *)z->zbuff, in_size, errp);
 
-    if (ret != 0) {
-        return ret;
+        if (ret != 0) {
+            return ret;
+        }
     }
 
     z->in.src = z->zbuff;
     z->in.size = in_size;
     z->in.pos = 0;
 
-    for (i = 0; i < p->normal_num; i++) {
+    for (i = 0; i < compress_num; i++) {
         ramblock_recv_bitmap_set_offset(p->block, p->normal[i]);
         z->out.dst = p->host + p->normal[i];
         z->out.size = page_size;
@@ -262,7 +286,7 @@ static int multifd_zstd_recv(MultiFDRecvParams *p, Error **errp)
                    p->id, out_size, expected_size);
         return -1;
     }
-    return 0;
+    return multifd_recv_raw_pages(p, errp);
 }
 
 static const MultiFDMethods multifd_zstd_ops = {
@@ -14,6 +14,7 @@
 #include "qemu/cutils.h"
 #include "qemu/iov.h"
 #include "qemu/rcu.h"
+#include "qemu/timer.h"
 #include "exec/target_page.h"
 #include "system/system.h"
 #include "system/ramblock.h"
@@ -612,6 +613,86 @@ static int multifd_zero_copy_flush(QIOChannel *c)
     return ret;
 }
 
+/*
+ * Number of output buffers of the compression methods with zero copy
+ * send.  The kernel reads them after the write returned, so each is
+ * reused only after the channel was flushed, once every this many
+ * packets.
+ */
+#define MULTIFD_SEND_ZERO_COPY_BUFS 8
+
+/**
+ * multifd_send_bufs_alloc: Allocate the output buffers of a compression
+ * method.
+ *
+ * Returns false if out of memory.
+ *
+ * @param p A pointer to the send params.
+ * @param len The size of each buffer.
+ */
+bool multifd_send_bufs_alloc(MultiFDSendParams *p, size_t len)
+{
+    p->bufs_num = migrate_zero_copy_send() ? MULTIFD_SEND_ZERO_COPY_BUFS : 1;
+    p->bufs_next = 0;
+    p->buf_len = len;
+    p->bufs = g_new0(uint8_t *, p->bufs_num);
+
+    for (int i = 0; i < p->bufs_num; i++) {
+        p->bufs[i] = g_try_malloc(len);
+        if (!p->bufs[i]) {
+            multifd_send_bufs_free(p);
+            return false;
+        }
+    }
+
+    if (migrate_zero_copy_send()) {
+        p->write_flags |= QIO_CHANNEL_WRITE_FLAG_ZERO_COPY;
+    }
+    return true;
+}
+
+void multifd_send_bufs_free(MultiFDSendParams *p)
+{
+    for (int i = 0; i < p->bufs_num; i++) {
+        g_free(p->bufs[i]);
+    }
+    g_free(p->bufs);
+    p->bufs = NULL;
+    p->bufs_num = 0;
+}
+
+/**
+ * multifd_send_buf_get: Return the output buffer of a compression method
+ * for the next packet.
+ *
+ * Returns NULL if the channel could not be flushed.
+ *
+ * @param p A pointer to the send params.
+ * @param errp Pointer to the error.
+ */
+uint8_t *multifd_send_buf_get(MultiFDSendParams *p, Error **errp)
+{
+    uint8_t *buf = p->bufs[p->bufs_next];
+
+    if (p->bufs_num == 1) {
+        return buf;
+    }
+
+    /* Wait until the kernel stops reading all the buffers to reuse them */
+    if (p->bufs_next == p->bufs_num - 1) {
+        int ret = qio_channel_flush(p->c, errp);
+
+        if (ret < 0) {
+            return NULL;
+        }
+        if (ret == 1) {
+            stat64_add(&mig_stats.dirty_sync_missed_zero_copy, 1);
+        }
+    }
+    p->bufs_next = (p->bufs_next + 1) % p->bufs_num;
+    return buf;
+}
+
 int multifd_send_sync_main(MultiFDSyncReq req)
 {
     int i;
@@ -658,6 +739,17 @@ int multifd_send_sync_main(MultiFDSyncReq req)
     return 0;
 }
 
+static void multifd_send_compress_stats(MultiFDSendParams *p, int64_t start)
+{
+    MultiFDPages_t *pages = &p->data->u.ram;
+
+    stat64_add(&mig_stats.multifd_compress_pages, pages->normal_num);
+    stat64_add(&mig_stats.multifd_compress_raw_pages, pages->raw_num);
+    stat64_add(&mig_stats.multifd_compress_bytes, p->next_packet_size);
+    stat64_add(&mig_stats.multifd_compress_time,
+               qemu_clock_get_us(QEMU_CLOCK_REALTIME) - start);
+}
+
 static void *multifd_send_thread(void *opaque)
 {
     MultiFDSendParams *p = opaque;
@@ -665,6 +757,7 @@ static void *multifd_send_thread(void *opaque)
     Error *local_err = NULL;
     int ret = 0;
     bool use_packets = multifd_use_packets();
+    bool compress = migrate_multifd_compression() != MULTIFD_COMPRESSION_NONE;
 
     thread = migration_threads_add(p->name, qemu_get_thread_id());
 
@@ -694,6 +787,8 @@ static void *multifd_send_thread(void *opaque)
             bool is_device_state = multifd_payload_device_state(p->data);
             size_t total_size;
             int write_flags_masked = 0;
+            struct iovec *iov;
+            uint32_t iovs_num;
 
             p->flags = 0;
             p->iovs_num = 0;
@@ -705,10 +800,16 @@ static void *multifd_send_thread(void *opaque)
                 /* Device state packets cannot be sent via zerocopy */
                 write_flags_masked |= QIO_CHANNEL_WRITE_FLAG_ZERO_COPY;
             } else {
+                int64_t start = compress ?
+                    qemu_clock_get_us(QEMU_CLOCK_REALTIME) : 0;
+
                 ret = multifd_send_state->ops->send_prepare(p, &local_err);
                 if (ret != 0) {
                     break;
                 }
+                if (compress) {
+                    multifd_send_compress_stats(p, start);
+                }
             }
 
             /*
@@ -717,14 +818,32 @@ static void *multifd_send_thread(void *opaque)
              * being sent.
              */
             total_size = iov_size(p->iov, p->iovs_num);
+            iov = p->iov;
+            iovs_num = p->iovs_num;
+
+            /*
+             * The packet header is reused by the next packet, send it
+             * first without zerocopy.  The compressed data is in one of
+             * the buffers of multifd_send_buf_get().
+             */
+            if (compress && !is_device_state &&
+                (p->write_flags & QIO_CHANNEL_WRITE_FLAG_ZERO_COPY)) {
+                ret = qio_channel_write_all(p->c, iov->iov_base,
+                                            iov->iov_len, &local_err);
+                if (ret != 0) {
+                    break;
+                }
+                iov++;
+                iovs_num--;
+            }
 
             if (migrate_mapped_ram()) {
                 assert(!is_device_state);
 
-                ret = file_write_ramblock_iov(p->c, p->iov, p->iovs_num,
+                ret = file_write_ramblock_iov(p->c, iov, iovs_num,
                                               &p->data->u.ram, &local_err);
-            } else {
-                ret = qio_channel_writev_full_all(p->c, p->iov, p->iovs_num,
+            } else if (iovs_num) {
+                ret = qio_channel_writev_full_all(p->c, iov, iovs_num,
                                                   NULL, 0,
                                                   p->write_flags & ~write_flags_masked,
                                                   &local_err);
@@ -66,6 +66,8 @@ MultiFDRecvData *multifd_get_recv_data(void);
 #define MULTIFD_FLAG_QPL (4 << 1)
 #define MULTIFD_FLAG_UADK (8 << 1)
 #define MULTIFD_FLAG_QATZIP (16 << 1)
+/* The bits are not one-hot: methods are compared against the whole mask */
+#define MULTIFD_FLAG_XBZRLE (3 << 1)
 
 /*
  * If set it means that this packet contains device state
@@ -94,7 +96,8 @@ typedef struct {
     uint64_t packet_num;
     /* zero pages */
     uint32_t zero_pages;
-    uint32_t unused32[1];    /* Reserved for future use */
+    /* trailing normal pages sent uncompressed by a compression method */
+    uint32_t raw_pages;
     uint64_t unused64[3];    /* Reserved for future use */
     char ramblock[256];
     /*
@@ -120,6 +123,8 @@ typedef struct {
     uint32_t num;
     /* number of normal pages */
     uint32_t normal_num;
+    /* number of normal pages, at the end, that are not compressed */
+    uint32_t raw_num;
     /*
      * Pointer to the ramblock.  NOTE: it's caller's responsibility to make
      * sure the pointer is always valid!
@@ -234,6 +239,11 @@ typedef struct {
     uint32_t iovs_num;
     /* used for compression methods */
     void *compress_data;
+    /* output buffers of compression methods, see multifd_send_buf_get() */
+    uint8_t **bufs;
+    uint32_t bufs_num;
+    uint32_t bufs_next;
+    size_t buf_len;
 }  MultiFDSendParams;
 
 typedef struct {
@@ -287,6 +297,8 @@ typedef struct {
     ram_addr_t *normal;
     /* num of non zero pages */
     uint32_t normal_num;
+    /* num of non zero pages, at the end, that are not compressed */
+    uint32_t raw_num;
     /* Pages that are zero */
     ram_addr_t *zero;
     /* num of zero pages */
@@ -379,8 +391,14 @@ typedef struct {
 void multifd_register_ops(int method, const MultiFDMethods *ops);
 void multifd_send_fill_packet(MultiFDSendParams *p);
 bool multifd_send_prepare_common(MultiFDSendParams *p);
+bool multifd_send_bufs_alloc(MultiFDSendParams *p, size_t len);
+void multifd_send_bufs_free(MultiFDSendParams *p);
+uint8_t *multifd_send_buf_get(MultiFDSendParams *p, Error **errp);
 void multifd_send_zero_page_detect(MultiFDSendParams *p);
 void multifd_recv_zero_page_process(MultiFDRecvParams *p);
+void multifd_send_raw_page_detect(MultiFDSendParams *p);
+void multifd_send_prepare_raw_iovs(MultiFDSendParams *p);
+int multifd_recv_raw_pages(MultiFDRecvParams *p, Error **errp);
 
 void multifd_channel_connect(MultiFDSendParams *p, QIOChannel *ioc);
 bool multifd_send(MultiFDSendData **send_data);
@@ -24,8 +24,10 @@
 #include "migration/colo.h"
 #include "migration/cpr.h"
 #include "migration/misc.h"
+#include "mapped-ram-lazy.h"
 #include "migration.h"
 #include "migration-stats.h"
+#include "postcopy-ram.h"
 #include "qemu-file.h"
 #include "ram.h"
 #include "options.h"
@@ -86,6 +88,11 @@
 #define DEFAULT_MIGRATE_VCPU_DIRTY_LIMIT_PERIOD     1000    /* milliseconds */
 #define DEFAULT_MIGRATE_VCPU_DIRTY_LIMIT            1       /* MB/s */
 
+/* Synchronize the dirty bitmap in the migration thread by default */
+#define DEFAULT_MIGRATE_DIRTY_SYNC_THREADS 1
+#define MAX_MIGRATE_DIRTY_SYNC_THREADS 64
+#define DEFAULT_MIGRATE_POSTCOPY_FAULT_THREADS 1
+
 const Property migration_properties[] = {
     DEFINE_PROP_BOOL("store-global-state", MigrationState,
                      store_global_state, true),
@@ -177,6 +184,18 @@ const Property migration_properties[] = {
     DEFINE_PROP_ZERO_PAGE_DETECTION("zero-page-detection", MigrationState,
                        parameters.zero_page_detection,
                        ZERO_PAGE_DETECTION_MULTIFD),
+    DEFINE_PROP_UINT8("dirty-sync-threads", MigrationState,
+                      parameters.dirty_sync_threads,
+                      DEFAULT_MIGRATE_DIRTY_SYNC_THREADS),
+    DEFINE_PROP_UINT8("multifd-raw-entropy", MigrationState,
+                      parameters.multifd_raw_entropy, 0),
+    DEFINE_PROP_UINT8("postcopy-fault-threads", MigrationState,
+                      parameters.postcopy_fault_threads,
+                      DEFAULT_MIGRATE_POSTCOPY_FAULT_THREADS),
+    DEFINE_PROP_BOOL("vcpu-dirty-limit-auto", MigrationState,
+                     parameters.vcpu_dirty_limit_auto, false),
+    DEFINE_PROP_BOOL("predictive-switchover", MigrationState,
+                     parameters.predictive_switchover, false),
 
     /* Migration capabilities */
     DEFINE_PROP_MIG_CAP("x-xbzrle", MIGRATION_CAPABILITY_XBZRLE),
@@ -203,6 +222,12 @@ const Property migration_properties[] = {
                         MIGRATION_CAPABILITY_SWITCHOVER_ACK),
     DEFINE_PROP_MIG_CAP("x-dirty-limit", MIGRATION_CAPABILITY_DIRTY_LIMIT),
     DEFINE_PROP_MIG_CAP("mapped-ram", MIGRATION_CAPABILITY_MAPPED_RAM),
+    DEFINE_PROP_MIG_CAP("mapped-ram-lazy",
+                        MIGRATION_CAPABILITY_MAPPED_RAM_LAZY),
+    DEFINE_PROP_MIG_CAP("mapped-ram-mmap",
+                        MIGRATION_CAPABILITY_MAPPED_RAM_MMAP),
+    DEFINE_PROP_MIG_CAP("postcopy-hugetlb-minor",
+                        MIGRATION_CAPABILITY_POSTCOPY_HUGETLB_MINOR),
 };
 const size_t migration_properties_count = ARRAY_SIZE(migration_properties);
 
@@ -262,6 +287,20 @@ bool migrate_mapped_ram(void)
     return s->capabilities[MIGRATION_CAPABILITY_MAPPED_RAM];
 }
 
+bool migrate_mapped_ram_lazy(void)
+{
+    MigrationState *s = migrate_get_current();
+
+    return s->capabilities[MIGRATION_CAPABILITY_MAPPED_RAM_LAZY];
+}
+
+bool migrate_mapped_ram_mmap(void)
+{
+    MigrationState *s = migrate_get_current();
+
+    return s->capabilities[MIGRATION_CAPABILITY_MAPPED_RAM_MMAP];
+}
+
 bool migrate_ignore_shared(void)
 {
     MigrationState *s = migrate_get_current();
@@ -297,6 +336,13 @@ bool migrate_postcopy_blocktime(void)
     return s->capabilities[MIGRATION_CAPABILITY_POSTCOPY_BLOCKTIME];
 }
 
+bool migrate_postcopy_hugetlb_minor(void)
+{
+    MigrationState *s = migrate_get_current();
+
+    return s->capabilities[MIGRATION_CAPABILITY_POSTCOPY_HUGETLB_MINOR];
+}
+
 bool migrate_postcopy_preempt(void)
 {
     MigrationState *s = migrate_get_current();
@@ -451,6 +497,14 @@ INITIALIZE_MIGRATE_CAPS_SET(check_caps_savevm,
                             MIGRATION_CAPABILITY_MULTIFD,
 );
 
+/* Compression methods that can send their output with zero copy */
+static bool multifd_compression_zero_copy(MultiFDCompression method)
+{
+    return method == MULTIFD_COMPRESSION_NONE ||
+           method == MULTIFD_COMPRESSION_ZLIB ||
+           method == MULTIFD_COMPRESSION_ZSTD;
+}
+
 static bool migrate_incoming_started(void)
 {
     return !!migration_incoming_get_current()->transport_data;
@@ -576,10 +630,11 @@ bool migrate_caps_check(bool *old_caps, bool *new_caps, Error **errp)
     if (new_caps[MIGRATION_CAPABILITY_ZERO_COPY_SEND] &&
         (!new_caps[MIGRATION_CAPABILITY_MULTIFD] ||
          new_caps[MIGRATION_CAPABILITY_XBZRLE] ||
-         migrate_multifd_compression() ||
+         !multifd_compression_zero_copy(migrate_multifd_compression()) ||
          migrate_tls())) {
         error_setg(errp,
-                   "Zero copy only available for non-compressed non-TLS multifd migration");
+                   "Zero copy only available for non-TLS multifd migration "
+                   "without compression or with zlib or zstd compression");
         return false;
     }
 #else
@@ -652,6 +707,47 @@ bool migrate_caps_check(bool *old_caps, bool *new_caps, Error **errp)
         }
     }
 
+    if (new_caps[MIGRATION_CAPABILITY_MAPPED_RAM_LAZY]) {
+        if (!new_caps[MIGRATION_CAPABILITY_MAPPED_RAM]) {
+            error_setg(errp, "Capability 'mapped-ram-lazy' requires "
+                       "capability 'mapped-ram'");
+            return false;
+        }
+
+        if (!mapped_ram_lazy_available()) {
+            error_setg(errp, "Lazy mapped-ram loading is not supported by "
+                       "host kernel");
+            return false;
+        }
+    }
+
+    if (new_caps[MIGRATION_CAPABILITY_MAPPED_RAM_MMAP]) {
+#ifndef __linux__
+        error_setg(errp, "Capability 'mapped-ram-mmap' is only supported "
+                   "on Linux");
+        return false;
+#endif
+        if (!new_caps[MIGRATION_CAPABILITY_MAPPED_RAM]) {
+            error_setg(errp, "Capability 'mapped-ram-mmap' requires "
+                       "capability 'mapped-ram'");
+            return false;
+        }
+    }
+
+    if (new_caps[MIGRATION_CAPABILITY_POSTCOPY_HUGETLB_MINOR]) {
+        if (!new_caps[MIGRATION_CAPABILITY_POSTCOPY_RAM]) {
+            error_setg(errp, "Capability 'postcopy-hugetlb-minor' requires "
+                       "capability 'postcopy-ram'");
+            return false;
+        }
+
+        if (!postcopy_ram_minor_supported()) {
+            error_setg(errp, "Userfault minor faults on hugetlbfs are not "
+                       "supported by host kernel");
+            return false;
+        }
+    }
+
     /*
      * On destination side, check the cases that capability is being set
      * after incoming thread has started.
@@ -851,6 +947,41 @@ int migrate_multifd_zstd_level(void)
     return s->parameters.multifd_zstd_level;
 }
 
+uint8_t migrate_dirty_sync_threads(void)
+{
+    MigrationState *s = migrate_get_current();
+
+    return s->parameters.dirty_sync_threads;
+}
+
+uint8_t migrate_multifd_raw_entropy(void)
+{
+    MigrationState *s = migrate_get_current();
+
+    return s->parameters.multifd_raw_entropy;
+}
+
+uint8_t migrate_postcopy_fault_threads(void)
+{
+    MigrationState *s = migrate_get_current();
+
+    return s->parameters.postcopy_fault_threads;
+}
+
+bool migrate_vcpu_dirty_limit_auto(void)
+{
+    MigrationState *s = migrate_get_current();
+
+    return s->parameters.vcpu_dirty_limit_auto;
+}
+
+bool migrate_predictive_switchover(void)
+{
+    MigrationState *s = migrate_get_current();
+
+    return s->parameters.predictive_switchover;
+}
+
 uint8_t migrate_throttle_trigger_threshold(void)
 {
     MigrationState *s = migrate_get_current();
@@ -985,6 +1116,16 @@ MigrationParameters *qmp_query_migrate_parameters(Error **errp)
     params->zero_page_detection = s->parameters.zero_page_detection;
     params->has_direct_io = true;
     params->direct_io = s->parameters.direct_io;
+    params->has_dirty_sync_threads = true;
+    params->dirty_sync_threads = s->parameters.dirty_sync_threads;
+    params->has_multifd_raw_entropy = true;
+    params->multifd_raw_entropy = s->parameters.multifd_raw_entropy;
+    params->has_postcopy_fault_threads = true;
+    params->postcopy_fault_threads = s->parameters.postcopy_fault_threads;
+    params->has_vcpu_dirty_limit_auto = true;
+    params->vcpu_dirty_limit_auto = s->parameters.vcpu_dirty_limit_auto;
+    params->has_predictive_switchover = true;
+    params->predictive_switchover = s->parameters.predictive_switchover;
     params->has_cpr_exec_command = true;
     params->cpr_exec_command = QAPI_CLONE(strList,
                                           s->parameters.cpr_exec_command);
@@ -1022,6 +1163,11 @@ void migrate_params_init(MigrationParameters *params)
     params->has_mode = true;
     params->has_zero_page_detection = true;
     params->has_direct_io = true;
+    params->has_dirty_sync_threads = true;
+    params->has_multifd_raw_entropy = true;
+    params->has_postcopy_fault_threads = true;
+    params->has_vcpu_dirty_limit_auto = true;
+    params->has_predictive_switchover = true;
     params->has_cpr_exec_command = true;
 }
 
@@ -1173,10 +1319,12 @@ bool migrate_params_check(MigrationParameters *params, Error **errp)
 
 #ifdef CONFIG_LINUX
     if (migrate_zero_copy_send() &&
-        ((params->has_multifd_compression && params->multifd_compression) ||
+        ((params->has_multifd_compression &&
+          !multifd_compression_zero_copy(params->multifd_compression)) ||
          (params->tls_creds && *params->tls_creds))) {
         error_setg(errp,
-                   "Zero copy only available for non-compressed non-TLS multifd migration");
+                   "Zero copy only available for non-TLS multifd migration "
+                   "without compression or with zlib or zstd compression");
         return false;
     }
 #endif
@@ -1188,6 +1336,15 @@ bool migrate_params_check(MigrationParameters *params, Error **errp)
         return false;
     }
 
+    if (params->has_multifd_compression &&
+        params->multifd_compression == MULTIFD_COMPRESSION_XBZRLE &&
+        params->has_zero_page_detection &&
+        params->zero_page_detection == ZERO_PAGE_DETECTION_LEGACY) {
+        error_setg(errp, "Multifd xbzrle compression is not compatible "
+                   "with legacy zero page detection");
+        return false;
+    }
+
     if (params->has_x_vcpu_dirty_limit_period &&
         (params->x_vcpu_dirty_limit_period < 1 ||
          params->x_vcpu_dirty_limit_period > 1000)) {
@@ -1209,6 +1366,31 @@ bool migrate_params_check(MigrationParameters *params, Error **errp)
         return false;
     }
 
+    if (params->has_dirty_sync_threads &&
+        (params->dirty_sync_threads < 1 ||
+         params->dirty_sync_threads > MAX_MIGRATE_DIRTY_SYNC_THREADS)) {
+        error_setg(errp, QERR_INVALID_PARAMETER_VALUE,
+                   "dirty_sync_threads",
+                   "a value between 1 and 64");
+        return false;
+    }
+
+    if (params->has_multifd_raw_entropy &&
+        params->multifd_raw_entropy > 100) {
+        error_setg(errp, QERR_INVALID_PARAMETER_VALUE,
+                   "multifd_raw_entropy",
+                   "a value between 0 and 100");
+        return false;
+    }
+
+    if (params->has_postcopy_fault_threads &&
+        params->postcopy_fault_threads < 1) {
+        error_setg(errp, QERR_INVALID_PARAMETER_VALUE,
+                   "postcopy_fault_threads",
+                   "a value between 1 and 255");
+        return false;
+    }
+
     return true;
 }
 
@@ -1328,6 +1510,26 @@ static void migrate_params_test_apply(MigrateSetParameters *params,
         dest->direct_io = params->direct_io;
     }
 
+    if (params->has_dirty_sync_threads) {
+        dest->dirty_sync_threads = params->dirty_sync_threads;
+    }
+
+    if (params->has_multifd_raw_entropy) {
+        dest->multifd_raw_entropy = params->multifd_raw_entropy;
+    }
+
+    if (params->has_postcopy_fault_threads) {
+        dest->postcopy_fault_threads = params->postcopy_fault_threads;
+    }
+
+    if (params->has_vcpu_dirty_limit_auto) {
+        dest->vcpu_dirty_limit_auto = params->vcpu_dirty_limit_auto;
+    }
+
+    if (params->has_predictive_switchover) {
+        dest->predictive_switchover = params->predictive_switchover;
+    }
+
     if (params->has_cpr_exec_command) {
         dest->cpr_exec_command = params->cpr_exec_command;
     }
@@ -1464,6 +1666,26 @@ static void migrate_params_apply(MigrateSetParameters *params, Error **errp)
         s->parameters.direct_io = params->direct_io;
     }
 
+    if (params->has_dirty_sync_threads) {
+        s->parameters.dirty_sync_threads = params->dirty_sync_threads;
+    }
+
+    if (params->has_multifd_raw_entropy) {
+        s->parameters.multifd_raw_entropy = params->multifd_raw_entropy;
+    }
+
+    if (params->has_postcopy_fault_threads) {
+        s->parameters.postcopy_fault_threads = params->postcopy_fault_threads;
+    }
+
+    if (params->has_vcpu_dirty_limit_auto) {
+        s->parameters.vcpu_dirty_limit_auto = params->vcpu_dirty_limit_auto;
+    }
+
+    if (params->has_predictive_switchover) {
+        s->parameters.predictive_switchover = params->predictive_switchover;
+    }
+
     if (params->has_cpr_exec_command) {
         qapi_free_strList(s->parameters.cpr_exec_command);
         s->parameters.cpr_exec_command =
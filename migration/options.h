@@ -30,11 +30,14 @@ bool migrate_colo(void);
 bool migrate_dirty_bitmaps(void);
 bool migrate_events(void);
 bool migrate_mapped_ram(void);
+bool migrate_mapped_ram_lazy(void);
+bool migrate_mapped_ram_mmap(void);
 bool migrate_ignore_shared(void);
 bool migrate_late_block_activate(void);
 bool migrate_multifd(void);
 bool migrate_pause_before_switchover(void);
 bool migrate_postcopy_blocktime(void);
+bool migrate_postcopy_hugetlb_minor(void);
 bool migrate_postcopy_preempt(void);
 bool migrate_rdma_pin_all(void);
 bool migrate_release_ram(void);
@@ -71,6 +74,7 @@ uint8_t migrate_cpu_throttle_increment(void);
 uint8_t migrate_cpu_throttle_initial(void);
 bool migrate_cpu_throttle_tailslow(void);
 bool migrate_direct_io(void);
+uint8_t migrate_dirty_sync_threads(void);
 uint64_t migrate_downtime_limit(void);
 uint8_t migrate_max_cpu_throttle(void);
 uint64_t migrate_max_bandwidth(void);
@@ -81,6 +85,10 @@ MultiFDCompression migrate_multifd_compression(void);
 int migrate_multifd_zlib_level(void);
 int migrate_multifd_qatzip_level(void);
 int migrate_multifd_zstd_level(void);
+uint8_t migrate_multifd_raw_entropy(void);
+uint8_t migrate_postcopy_fault_threads(void);
+bool migrate_vcpu_dirty_limit_auto(void);
+bool migrate_predictive_switchover(void);
 uint8_t migrate_throttle_trigger_threshold(void);
 const char *migrate_tls_authz(void);
 const char *migrate_tls_creds(void);
@@ -189,6 +189,11 @@ typedef struct PostcopyBlocktimeContext {
      * bucket window [2^N us, 2^(N+1) us).
      */
     uint64_t latency_buckets[BLOCKTIME_LATENCY_BUCKET_N];
+    /*
+     * Same as latency_buckets but per vCPU, BLOCKTIME_LATENCY_BUCKET_N
+     * entries for each vCPU in turn.
+     */
+    uint64_t *vcpu_latency_buckets;
     /* total blocktime when all vCPUs are stopped */
     uint64_t total_blocktime;
     /* point in time when last page fault was initiated */
@@ -251,6 +256,7 @@ static void destroy_blocktime_context(struct PostcopyBlocktimeContext *ctx)
     g_free(ctx->vcpu_blocktime_total);
     g_free(ctx->vcpu_faults_count);
     g_free(ctx->vcpu_faults_current);
+    g_free(ctx->vcpu_latency_buckets);
     g_free(ctx);
 }
 
@@ -303,6 +309,8 @@ static struct PostcopyBlocktimeContext *blocktime_context_new(void)
     ctx->vcpu_blocktime_total = g_new0(uint64_t, smp_cpus);
     ctx->vcpu_faults_count = g_new0(uint64_t, smp_cpus);
     ctx->vcpu_faults_current = g_new0(uint8_t, smp_cpus);
+    ctx->vcpu_latency_buckets = g_new0(uint64_t,
+                                       smp_cpus * BLOCKTIME_LATENCY_BUCKET_N);
     ctx->tid_to_vcpu_hash = blocktime_init_tid_to_vcpu_hash();
 
     /*
@@ -338,7 +346,8 @@ void fill_destination_postcopy_migration_info(MigrationInfo *info)
     uint32List *list_blocktime = NULL;
     uint64List *list_latency = NULL;
     uint64List *latency_buckets = NULL;
-    int i;
+    PostcopyLatencyDistList *list_latency_dist = NULL;
+    int i, j;
 
     if (!bc) {
         return;
@@ -346,6 +355,7 @@ void fill_destination_postcopy_migration_info(MigrationInfo *info)
 
     for (i = ms->smp.cpus - 1; i >= 0; i--) {
         uint64_t latency, total, count;
+        PostcopyLatencyDist *dist;
 
         /* Convert ns -> ms */
         QAPI_LIST_PREPEND(list_blocktime,
@@ -365,6 +375,13 @@ void fill_destination_postcopy_migration_info(MigrationInfo *info)
         }
 
         QAPI_LIST_PREPEND(list_latency, latency);
+
+        dist = g_new0(PostcopyLatencyDist, 1);
+        for (j = BLOCKTIME_LATENCY_BUCKET_N - 1; j >= 0; j--) {
+            QAPI_LIST_PREPEND(dist->buckets,
+                bc->vcpu_latency_buckets[i * BLOCKTIME_LATENCY_BUCKET_N + j]);
+        }
+        QAPI_LIST_PREPEND(list_latency_dist, dist);
     }
 
     for (i = BLOCKTIME_LATENCY_BUCKET_N - 1; i >= 0; i--) {
@@ -388,6 +405,8 @@ void fill_destination_postcopy_migration_info(MigrationInfo *info)
     info->postcopy_vcpu_latency = list_latency;
     info->has_postcopy_latency_dist = true;
     info->postcopy_latency_dist = latency_buckets;
+    info->has_postcopy_vcpu_latency_dist = true;
+    info->postcopy_vcpu_latency_dist = list_latency_dist;
 }
 
 static uint64_t get_postcopy_total_blocktime(void)
@@ -504,6 +523,15 @@ static bool ufd_check_and_apply(int ufd, MigrationIncomingState *mis,
     }
 #endif
 
+    if (migrate_postcopy_hugetlb_minor()) {
+        if (!(supported_features & UFFD_FEATURE_MINOR_HUGETLBFS)) {
+            error_setg(errp, "Userfault on this host does not support minor "
+                       "faults on huge pages");
+            return false;
+        }
+        asked_features |= UFFD_FEATURE_MINOR_HUGETLBFS;
+    }
+
     /*
      * request features, even if asked_features is 0, due to
      * kernel expects UFFD_API before UFFDIO_REGISTER, per
@@ -529,6 +557,16 @@ static bool ufd_check_and_apply(int ufd, MigrationIncomingState *mis,
     return true;
 }
 
+bool postcopy_ram_minor_supported(void)
+{
+    uint64_t features;
+
+    if (uffd_query_features(&features)) {
+        return false;
+    }
+    return features & UFFD_FEATURE_MINOR_HUGETLBFS;
+}
+
 /* Callback from postcopy_ram_supported_by_host block iterator.
  */
 static int test_ramblock_postcopiable(RAMBlock *rb, Error **errp)
@@ -744,6 +782,11 @@ static int cleanup_range(RAMBlock *rb, void *opaque)
         return -1;
     }
 
+    if (rb->postcopy_alias) {
+        munmap(rb->postcopy_alias, length);
+        rb->postcopy_alias = NULL;
+    }
+
     return 0;
 }
 
@@ -827,11 +870,16 @@ int postcopy_ram_incoming_cleanup(MigrationIncomingState *mis)
     if (mis->have_fault_thread) {
         Error *local_err = NULL;
 
-        /* Let the fault thread quit */
+        /* Let the fault threads quit */
         qatomic_set(&mis->fault_thread_quit, 1);
         postcopy_fault_thread_notify(mis);
         trace_postcopy_ram_incoming_cleanup_join();
         qemu_thread_join(&mis->fault_thread);
+        for (int i = 0; i < mis->fault_workers_num; i++) {
+            qemu_thread_join(&mis->fault_workers[i]);
+        }
+        g_clear_pointer(&mis->fault_workers, g_free);
+        mis->fault_workers_num = 0;
 
         if (postcopy_notify(POSTCOPY_NOTIFY_INBOUND_END, &local_err)) {
             error_report_err(local_err);
@@ -913,14 +961,36 @@ int postcopy_ram_prepare_discard(MigrationIncomingState *mis)
  *   opaque: MigrationIncomingState pointer
  * Returns 0 on success
  */
+/*
+ * Whether the pages of @rb are written through its alias mapping and mapped
+ * with UFFDIO_CONTINUE.  Only shared hugetlbfs files have a page cache that
+ * userfaultfd minor faults can use.  Faults of shared memory clients are
+ * trapped with their own userfaultfd in missing mode, which would not stop
+ * them from reading a partially written page.
+ */
+static bool ram_block_use_minor(MigrationIncomingState *mis, RAMBlock *rb)
+{
+    return migrate_postcopy_hugetlb_minor() && qemu_ram_is_shared(rb) &&
+           rb->fd >= 0 && qemu_fd_getfs(rb->fd) == QEMU_FS_TYPE_HUGETLBFS &&
+           !mis->postcopy_remote_fds->len;
+}
+
 static int ram_block_enable_notify(RAMBlock *rb, void *opaque)
 {
     MigrationIncomingState *mis = opaque;
     struct uffdio_register reg_struct;
+    bool minor = ram_block_use_minor(mis, rb);
 
     reg_struct.range.start = (uintptr_t)qemu_ram_get_host_addr(rb);
     reg_struct.range.len = rb->postcopy_length;
     reg_struct.mode = UFFDIO_REGISTER_MODE_MISSING;
+    if (minor) {
+        /*
+         * Pages written through the alias are in the page cache before they
+         * are complete, keep the guest from mapping them on its own.
+         */
+        reg_struct.mode |= UFFDIO_REGISTER_MODE_MINOR;
+    }
 
     /* Now tell our userfault_fd that it's responsible for this area */
     if (ioctl(mis->userfault_fd, UFFDIO_REGISTER, &reg_struct)) {
@@ -931,6 +1001,25 @@ static int ram_block_enable_notify(RAMBlock *rb, void *opaque)
         error_report("%s userfault: Region doesn't support COPY", __func__);
         return -1;
     }
+    if (minor) {
+        void *alias;
+
+        if (!(reg_struct.ioctls & (1ULL << _UFFDIO_CONTINUE))) {
+            error_report("%s userfault: Region doesn't support CONTINUE",
+                         __func__);
+            return -1;
+        }
+
+        alias = mmap(NULL, rb->postcopy_length, PROT_READ | PROT_WRITE,
+                     MAP_SHARED, rb->fd, rb->fd_offset);
+        if (alias == MAP_FAILED) {
+            error_report("%s: Failed to map %s alias: %s", __func__,
+                         qemu_ram_get_idstr(rb), strerror(errno));
+            return -1;
+        }
+        rb->postcopy_alias = alias;
+        trace_postcopy_ram_block_minor(qemu_ram_get_idstr(rb), alias);
+    }
     if (reg_struct.ioctls & (1ULL << _UFFDIO_ZEROPAGE)) {
         qemu_ram_set_uf_zeroable(rb);
     }
@@ -1124,7 +1213,7 @@ void mark_postcopy_blocktime_begin(uintptr_t addr, uint32_t ptid,
 }
 
 static void blocktime_latency_account(PostcopyBlocktimeContext *ctx,
-                                      uint64_t time_us)
+                                      int cpu, uint64_t time_us)
 {
     /*
      * Convert time (in us) to bucket index it belongs.  Take extra caution
@@ -1140,6 +1229,9 @@ static void blocktime_latency_account(PostcopyBlocktimeContext *ctx,
     }
 
     ctx->latency_buckets[index]++;
+    if (cpu >= 0) {
+        ctx->vcpu_latency_buckets[cpu * BLOCKTIME_LATENCY_BUCKET_N + index]++;
+    }
 }
 
 typedef struct {
@@ -1165,7 +1257,7 @@ static void blocktime_cpu_list_iter_fn(gpointer data, gpointer user_data)
     time_passed = iter->current - entry->fault_time;
 
     /* Latency buckets are in microseconds */
-    blocktime_latency_account(ctx, time_passed / SCALE_US);
+    blocktime_latency_account(ctx, cpu, time_passed / SCALE_US);
 
     if (cpu >= 0) {
         /*
@@ -1269,6 +1361,137 @@ static void postcopy_pause_fault_thread(MigrationIncomingState *mis)
     trace_postcopy_pause_fault_thread_continued();
 }
 
+/*
+ * Consume a wakeup of the fault threads.  Returns true if they must quit.
+ */
+static bool postcopy_fault_thread_woken(MigrationIncomingState *mis)
+{
+    uint64_t tmp64 = 0;
+
+    /*
+     * Consume the signal.  Each fault thread takes one count of the
+     * semaphore, another one may have been faster to take ours.
+     */
+    if (read(mis->userfault_event_fd, &tmp64, 8) != 8 && errno != EAGAIN) {
+        /* Nothing obviously nicer than posting this error. */
+        error_report("%s: read() failed", __func__);
+    }
+
+    if (qatomic_read(&mis->fault_thread_quit)) {
+        trace_postcopy_ram_fault_thread_quit();
+        return true;
+    }
+    return false;
+}
+
+/*
+ * Read a fault from the userfaultfd and request the page from the source.
+ * Returns 0 on success or if another fault thread got the fault first,
+ * -1 if the fault threads cannot continue.
+ */
+static int postcopy_ram_fault_read(MigrationIncomingState *mis)
+{
+    struct uffd_msg msg;
+    ram_addr_t rb_offset;
+    RAMBlock *rb;
+    int ret;
+
+    ret = read(mis->userfault_fd, &msg, sizeof(msg));
+    if (ret != sizeof(msg)) {
+        if (errno == EAGAIN) {
+            /*
+             * if a wake up happens on the other thread just after
+             * the poll, there is nothing to read.
+             */
+            return 0;
+        }
+        if (ret < 0) {
+            error_report("%s: Failed to read full userfault "
+                         "message: %s",
+                         __func__, strerror(errno));
+        } else {
+            error_report("%s: Read %d bytes from userfaultfd "
+                         "expected %zd",
+                         __func__, ret, sizeof(msg));
+            /* Lost alignment, don't know what we'd read next */
+        }
+        return -1;
+    }
+    if (msg.event != UFFD_EVENT_PAGEFAULT) {
+        error_report("%s: Read unexpected event %ud from userfaultfd",
+                     __func__, msg.event);
+        return 0; /* It's not a page fault, shouldn't happen */
+    }
+
+    rb = qemu_ram_block_from_host(
+             (void *)(uintptr_t)msg.arg.pagefault.address,
+             true, &rb_offset);
+    if (!rb) {
+        error_report("postcopy_ram_fault_thread: Fault outside guest: %"
+                     PRIx64, (uint64_t)msg.arg.pagefault.address);
+        return -1;
+    }
+
+    rb_offset = ROUND_DOWN(rb_offset, qemu_ram_pagesize(rb));
+    trace_postcopy_ram_fault_thread_request(msg.arg.pagefault.address,
+                                            qemu_ram_get_idstr(rb),
+                                            rb_offset,
+                                            msg.arg.pagefault.feat.ptid);
+retry:
+    /*
+     * Send the request to the source - we want to request one
+     * of our host page sizes (which is >= TPS)
+     */
+    ret = postcopy_request_page(mis, rb, rb_offset,
+                                msg.arg.pagefault.address,
+                                msg.arg.pagefault.feat.ptid);
+    if (ret) {
+        /* May be network failure, try to wait for recovery */
+        postcopy_pause_fault_thread(mis);
+        goto retry;
+    }
+    return 0;
+}
+
+/*
+ * Extra fault thread, only reading the faults of the userfaultfd so that
+ * many vCPUs faulting at the same time do not wait for each other.
+ */
+static void *postcopy_ram_fault_worker(void *opaque)
+{
+    MigrationIncomingState *mis = opaque;
+    struct pollfd pfd[2] = {
+        { .fd = mis->userfault_fd, .events = POLLIN },
+        { .fd = mis->userfault_event_fd, .events = POLLIN },
+    };
+
+    trace_postcopy_ram_fault_worker_entry();
+    rcu_register_thread();
+    qemu_event_set(&mis->thread_sync_event);
+
+    while (true) {
+        if (poll(pfd, ARRAY_SIZE(pfd), -1 /* Wait forever */) == -1) {
+            error_report("%s: userfault poll: %s", __func__, strerror(errno));
+            break;
+        }
+
+        if (!mis->to_src_file) {
+            postcopy_pause_fault_thread(mis);
+        }
+
+        if (pfd[1].revents && postcopy_fault_thread_woken(mis)) {
+            break;
+        }
+
+        if (pfd[0].revents && postcopy_ram_fault_read(mis)) {
+            break;
+        }
+    }
+    rcu_unregister_thread();
+    trace_postcopy_ram_fault_worker_exit();
+    return NULL;
+}
+
 /*
  * Handle faults detected by the USERFAULT markings
  */
@@ -1278,7 +1501,6 @@ static void *postcopy_ram_fault_thread(void *opaque)
     struct uffd_msg msg;
     int ret;
     size_t index;
-    RAMBlock *rb = NULL;
 
     trace_postcopy_ram_fault_thread_entry();
     rcu_register_thread();
@@ -1305,7 +1527,6 @@ static void *postcopy_ram_fault_thread(void *opaque)
     }
 
     while (true) {
-        ram_addr_t rb_offset;
         int poll_result;
 
         /*
@@ -1330,76 +1551,16 @@ static void *postcopy_ram_fault_thread(void *opaque)
         }
 
         if (pfd[1].revents) {
-            uint64_t tmp64 = 0;
-
-            /* Consume the signal */
-            if (read(mis->userfault_event_fd, &tmp64, 8) != 8) {
-                /* Nothing obviously nicer than posting this error. */
-                error_report("%s: read() failed", __func__);
-            }
-
-            if (qatomic_read(&mis->fault_thread_quit)) {
-                trace_postcopy_ram_fault_thread_quit();
+            if (postcopy_fault_thread_woken(mis)) {
                 break;
             }
         }
 
         if (pfd[0].revents) {
             poll_result--;
-            ret = read(mis->userfault_fd, &msg, sizeof(msg));
-            if (ret != sizeof(msg)) {
-                if (errno == EAGAIN) {
-                    /*
-                     * if a wake up happens on the other thread just after
-                     * the poll, there is nothing to read.
-                     */
-                    continue;
-                }
-                if (ret < 0) {
-                    error_report("%s: Failed to read full userfault "
-                                 "message: %s",
-                                 __func__, strerror(errno));
-                    break;
-                } else {
-                    error_report("%s: Read %d bytes from userfaultfd "
-                                 "expected %zd",
-                                 __func__, ret, sizeof(msg));
-                    break; /* Lost alignment, don't know what we'd read next */
-                }
-            }
-            if (msg.event != UFFD_EVENT_PAGEFAULT) {
-                error_report("%s: Read unexpected event %ud from userfaultfd",
-                             __func__, msg.event);
-                continue; /* It's not a page fault, shouldn't happen */
-            }
-
-            rb = qemu_ram_block_from_host(
-                     (void *)(uintptr_t)msg.arg.pagefault.address,
-                     true, &rb_offset);
-            if (!rb) {
-                error_report("postcopy_ram_fault_thread: Fault outside guest: %"
-                             PRIx64, (uint64_t)msg.arg.pagefault.address);
+            if (postcopy_ram_fault_read(mis)) {
                 break;
             }
-
-            rb_offset = ROUND_DOWN(rb_offset, qemu_ram_pagesize(rb));
-            trace_postcopy_ram_fault_thread_request(msg.arg.pagefault.address,
-                                                qemu_ram_get_idstr(rb),
-                                                rb_offset,
-                                                msg.arg.pagefault.feat.ptid);
-retry:
-            /*
-             * Send the request to the source - we want to request one
-             * of our host page sizes (which is >= TPS)
-             */
-            ret = postcopy_request_page(mis, rb, rb_offset,
-                                        msg.arg.pagefault.address,
-                                        msg.arg.pagefault.feat.ptid);
-            if (ret) {
-                /* May be network failure, try to wait for recovery */
-                postcopy_pause_fault_thread(mis);
-                goto retry;
-            }
         }
 
         /* Now handle any requests from external processes on shared memory */
@@ -1542,8 +1703,9 @@ int postcopy_ram_incoming_setup(MigrationIncomingState *mis)
         mis->blocktime_ctx = blocktime_context_new();
     }
 
-    /* Now an eventfd we use to tell the fault-thread to quit */
-    mis->userfault_event_fd = eventfd(0, EFD_CLOEXEC);
+    /* Now an eventfd we use to tell the fault threads to quit */
+    mis->userfault_event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK |
+                                         EFD_SEMAPHORE);
     if (mis->userfault_event_fd == -1) {
         error_report("%s: Opening userfault_event_fd: %s", __func__,
                      strerror(errno));
@@ -1554,6 +1716,16 @@ int postcopy_ram_incoming_setup(MigrationIncomingState *mis)
     postcopy_thread_create(mis, &mis->fault_thread,
                            MIGRATION_THREAD_DST_FAULT,
                            postcopy_ram_fault_thread, QEMU_THREAD_JOINABLE);
+    mis->fault_workers_num = migrate_postcopy_fault_threads() - 1;
+    mis->fault_workers = g_new0(QemuThread, mis->fault_workers_num);
+    for (int i = 0; i < mis->fault_workers_num; i++) {
+        g_autofree char *name =
+            g_strdup_printf(MIGRATION_THREAD_DST_FAULT_WORKER, i + 1);
+
+        postcopy_thread_create(mis, &mis->fault_workers[i], name,
+                               postcopy_ram_fault_worker,
+                               QEMU_THREAD_JOINABLE);
+    }
     mis->have_fault_thread = true;
 
     /* Mark so that we get notified of accesses to unwritten areas */
@@ -1583,6 +1755,38 @@ int postcopy_ram_incoming_setup(MigrationIncomingState *mis)
     return 0;
 }
 
+/* Account for a host page that was placed by one of the UFFDIO ioctls */
+static void postcopy_page_placed(MigrationIncomingState *mis, void *host_addr,
+                                 uint64_t pagesize, RAMBlock *rb)
+{
+    qemu_mutex_lock(&mis->page_request_mutex);
+    ramblock_recv_bitmap_set_range(rb, host_addr,
+                                   pagesize / qemu_target_page_size());
+    /*
+     * If this page resolves a page fault for a previous recorded faulted
+     * address, take a special note to maintain the requested page list.
+     */
+    if (g_tree_lookup(mis->page_requested, host_addr)) {
+        g_tree_remove(mis->page_requested, host_addr);
+        int left_pages = qatomic_dec_fetch(&mis->page_requested_count);
+
+        trace_postcopy_page_req_del(host_addr, mis->page_requested_count);
+        /* Order the update of count and read of preempt status */
+        smp_mb();
+        if (mis->preempt_thread_status == PREEMPT_THREAD_QUIT &&
+            left_pages == 0) {
+            /*
+             * This probably means the main thread is waiting for us.
+             * Notify that we've finished receiving the last requested
+             * page.
+             */
+            qemu_cond_signal(&mis->page_request_cond);
+        }
+    }
+    mark_postcopy_blocktime_end((uintptr_t)host_addr);
+    qemu_mutex_unlock(&mis->page_request_mutex);
+}
+
 static int qemu_ufd_copy_ioctl(MigrationIncomingState *mis, void *host_addr,
                                void *from_addr, uint64_t pagesize, RAMBlock *rb)
 {
@@ -1596,32 +1800,7 @@ static int qemu_ufd_copy_ioctl(MigrationIncomingState *mis, void *host_addr,
         ret = uffd_zero_page(userfault_fd, host_addr, pagesize, false);
     }
     if (!ret) {
-        qemu_mutex_lock(&mis->page_request_mutex);
-        ramblock_recv_bitmap_set_range(rb, host_addr,
-                                       pagesize / qemu_target_page_size());
-        /*
-         * If this page resolves a page fault for a previous recorded faulted
-         * address, take a special note to maintain the requested page list.
-         */
-        if (g_tree_lookup(mis->page_requested, host_addr)) {
-            g_tree_remove(mis->page_requested, host_addr);
-            int left_pages = qatomic_dec_fetch(&mis->page_requested_count);
-
-            trace_postcopy_page_req_del(host_addr, mis->page_requested_count);
-            /* Order the update of count and read of preempt status */
-            smp_mb();
-            if (mis->preempt_thread_status == PREEMPT_THREAD_QUIT &&
-                left_pages == 0) {
-                /*
-                 * This probably means the main thread is waiting for us.
-                 * Notify that we've finished receiving the last requested
-                 * page.
-                 */
-                qemu_cond_signal(&mis->page_request_cond);
-            }
-        }
-        mark_postcopy_blocktime_end((uintptr_t)host_addr);
-        qemu_mutex_unlock(&mis->page_request_mutex);
+        postcopy_page_placed(mis, host_addr, pagesize, rb);
     }
     return ret;
 }
@@ -1694,12 +1873,38 @@ int postcopy_place_page_zero(MigrationIncomingState *mis, void *host,
     }
 }
 
+/*
+ * Map a host page written through the alias mapping atomically
+ * returns 0 on success
+ */
+int postcopy_place_page_minor(MigrationIncomingState *mis, void *host,
+                              RAMBlock *rb)
+{
+    size_t pagesize = qemu_ram_pagesize(rb);
+    int e;
+
+    e = uffd_continue_page(mis->userfault_fd, host, pagesize, false);
+    if (e) {
+        return e;
+    }
+    postcopy_page_placed(mis, host, pagesize, rb);
+
+    trace_postcopy_place_page_minor(host);
+    return postcopy_notify_shared_wake(rb,
+                                       qemu_ram_block_host_offset(rb, host));
+}
+
 #else
 /* No target OS support, stubs just fail */
 void fill_destination_postcopy_migration_info(MigrationInfo *info)
 {
 }
 
+bool postcopy_ram_minor_supported(void)
+{
+    return false;
+}
+
 bool postcopy_ram_supported_by_host(MigrationIncomingState *mis, Error **errp)
 {
     error_report("%s: No OS support", __func__);
@@ -1745,6 +1950,12 @@ int postcopy_place_page_zero(MigrationIncomingState *mis, void *host,
     g_assert_not_reached();
 }
 
+int postcopy_place_page_minor(MigrationIncomingState *mis, void *host,
+                              RAMBlock *rb)
+{
+    g_assert_not_reached();
+}
+
 int postcopy_wake_shared(struct PostCopyFD *pcfd,
                          uint64_t client_addr,
                          RAMBlock *rb)
@@ -1772,11 +1983,12 @@ void postcopy_temp_page_reset(PostcopyTmpPage *tmp_page)
 
 void postcopy_fault_thread_notify(MigrationIncomingState *mis)
 {
-    uint64_t tmp64 = 1;
+    uint64_t tmp64 = 1 + mis->fault_workers_num;
 
     /*
-     * Wakeup the fault_thread.  It's an eventfd that should currently
-     * be at 0, we're going to increment it to 1
+     * Wakeup the fault threads.  It's a semaphore eventfd that should
+     * currently be at 0, we're going to increment it by one for each
+     * fault thread
      */
     if (write(mis->userfault_event_fd, &tmp64, 8) != 8) {
         /* Not much we can do here, but may as well report it */
@@ -1785,6 +1997,13 @@ void postcopy_fault_thread_notify(MigrationIncomingState *mis)
     }
 }
 
+void postcopy_fault_thread_resume(MigrationIncomingState *mis)
+{
+    for (int i = 0; i <= mis->fault_workers_num; i++) {
+        qemu_sem_post(&mis->postcopy_pause_sem_fault);
+    }
+}
+
 /**
  * postcopy_discard_send_init: Called at the start of each RAMBlock before
  *   asking to discard individual ranges.
@@ -19,6 +19,9 @@
 bool postcopy_ram_supported_by_host(MigrationIncomingState *mis,
                                     Error **errp);
 
+/* Return true if the host supports userfault minor faults on hugetlbfs */
+bool postcopy_ram_minor_supported(void);
+
 /*
  * Make all of RAM sensitive to accesses to areas that haven't yet been written
  * and wire up anything necessary to deal with it.
@@ -81,6 +84,14 @@ int postcopy_place_page(MigrationIncomingState *mis, void *host, void *from,
 int postcopy_place_page_zero(MigrationIncomingState *mis, void *host,
                              RAMBlock *rb);
 
+/*
+ * Map the host page at (host) once its content has been written at the
+ * same offset of rb->postcopy_alias
+ * returns 0 on success
+ */
+int postcopy_place_page_minor(MigrationIncomingState *mis, void *host,
+                              RAMBlock *rb);
+
 /* The current postcopy state is read/set by postcopy_state_get/set
  * which update it atomically.
  * The state is updated as postcopy messages are received, and
@@ -108,6 +119,8 @@ PostcopyState postcopy_state_get(void);
 PostcopyState postcopy_state_set(PostcopyState new_state);
 
 void postcopy_fault_thread_notify(MigrationIncomingState *mis);
+/* Release the fault threads paused while the return path was broken */
+void postcopy_fault_thread_resume(MigrationIncomingState *mis);
 
 /*
  * To be called once at the start before any device initialisation
@@ -28,6 +28,7 @@
 
 #include "qemu/osdep.h"
 #include "qemu/cutils.h"
+#include "qemu/units.h"
 #include "qemu/bitops.h"
 #include "qemu/bitmap.h"
 #include "qemu/madvise.h"
@@ -58,11 +59,14 @@
 #include "savevm.h"
 #include "qemu/iov.h"
 #include "multifd.h"
+#include "mapped-ram-lazy.h"
 #include "system/runstate.h"
 #include "rdma.h"
 #include "options.h"
 #include "system/dirtylimit.h"
 #include "system/kvm.h"
+#include "block/thread-pool.h"
+#include "io/channel-file.h"
 
 #include "hw/boards.h" /* for machine_dump_guest_core() */
 
@@ -435,6 +439,10 @@ struct RAMState {
      * Protected by @bitmap_mutex.
      */
     PageLocationHint page_hint;
+
+    /* Threads synchronizing the dirty bitmap, see dirty-sync-threads */
+    ThreadPool *dirty_sync_pool;
+    int dirty_sync_threads;
 };
 typedef struct RAMState RAMState;
 
@@ -937,62 +945,100 @@ bool ramblock_page_is_discarded(RAMBlock *rb, ram_addr_t start)
     return false;
 }
 
+/* Size of the range covered by one word of the dirty bitmap */
+static ram_addr_t dirty_bitmap_word_size(void)
+{
+    return (ram_addr_t)BITS_PER_LONG << TARGET_PAGE_BITS;
+}
+
+/* Is the range aligned to whole words of the global dirty bitmap? */
+static bool physical_memory_dirty_range_aligned(RAMBlock *rb,
+                                                ram_addr_t start,
+                                                ram_addr_t length)
+{
+    return !((start + rb->offset) & (dirty_bitmap_word_size() - 1)) &&
+           !(length & (dirty_bitmap_word_size() - 1));
+}
+
+/*
+ * Move the dirty bits of a word aligned range from the global dirty bitmap
+ * to rb->bmap, returning the number of newly dirty pages.  Distinct ranges
+ * touch distinct words, so they can be synchronized concurrently.
+ *
+ * Called with RCU critical section
+ */
+static uint64_t physical_memory_sync_dirty_words(RAMBlock *rb,
+                                                 ram_addr_t start,
+                                                 ram_addr_t length)
+{
+    unsigned long word = BIT_WORD((start + rb->offset) >> TARGET_PAGE_BITS);
+    uint64_t num_dirty = 0;
+    unsigned long *dest = rb->bmap;
+    int k;
+    int nr = BITS_TO_LONGS(length >> TARGET_PAGE_BITS);
+    unsigned long * const *src;
+    unsigned long idx = (word * BITS_PER_LONG) / DIRTY_MEMORY_BLOCK_SIZE;
+    unsigned long offset = BIT_WORD((word * BITS_PER_LONG) %
+                                    DIRTY_MEMORY_BLOCK_SIZE);
+    unsigned long page = BIT_WORD(start >> TARGET_PAGE_BITS);
+
+    src = qatomic_rcu_read(
+            &ram_list.dirty_memory[DIRTY_MEMORY_MIGRATION])->blocks;
+
+    for (k = page; k < page + nr; k++) {
+        if (src[idx][offset]) {
+            unsigned long bits = qatomic_xchg(&src[idx][offset], 0);
+            unsigned long new_dirty;
+            new_dirty = ~dest[k];
+            dest[k] |= bits;
+            new_dirty &= bits;
+            num_dirty += ctpopl(new_dirty);
+        }
+
+        if (++offset >= BITS_TO_LONGS(DIRTY_MEMORY_BLOCK_SIZE)) {
+            offset = 0;
+            idx++;
+        }
+    }
+
+    return num_dirty;
+}
+
+/* Called with RCU critical section, after physical_memory_sync_dirty_words */
+static void physical_memory_sync_dirty_done(RAMBlock *rb, ram_addr_t start,
+                                            ram_addr_t length,
+                                            uint64_t num_dirty)
+{
+    if (num_dirty) {
+        physical_memory_dirty_bits_cleared(start, length);
+    }
+
+    if (rb->clear_bmap) {
+        /*
+         * Postpone the dirty bitmap clear to the point before we
+         * really send the pages, also we will split the clear
+         * dirty procedure into smaller chunks.
+         */
+        clear_bmap_set(rb, start >> TARGET_PAGE_BITS,
+                       length >> TARGET_PAGE_BITS);
+    } else {
+        /* Slow path - still do that in a huge chunk */
+        memory_region_clear_dirty_bitmap(rb->mr, start, length);
+    }
+}
+
 /* Called with RCU critical section */
 static uint64_t physical_memory_sync_dirty_bitmap(RAMBlock *rb,
                                                   ram_addr_t start,
                                                   ram_addr_t length)
 {
     ram_addr_t addr;
-    unsigned long word = BIT_WORD((start + rb->offset) >> TARGET_PAGE_BITS);
     uint64_t num_dirty = 0;
     unsigned long *dest = rb->bmap;
 
-    /* start address and length is aligned at the start of a word? */
-    if (((word * BITS_PER_LONG) << TARGET_PAGE_BITS) ==
-         (start + rb->offset) &&
-        !(length & ((BITS_PER_LONG << TARGET_PAGE_BITS) - 1))) {
-        int k;
-        int nr = BITS_TO_LONGS(length >> TARGET_PAGE_BITS);
-        unsigned long * const *src;
-        unsigned long idx = (word * BITS_PER_LONG) / DIRTY_MEMORY_BLOCK_SIZE;
-        unsigned long offset = BIT_WORD((word * BITS_PER_LONG) %
-                                        DIRTY_MEMORY_BLOCK_SIZE);
-        unsigned long page = BIT_WORD(start >> TARGET_PAGE_BITS);
-
-        src = qatomic_rcu_read(
-                &ram_list.dirty_memory[DIRTY_MEMORY_MIGRATION])->blocks;
-
-        for (k = page; k < page + nr; k++) {
-            if (src[idx][offset]) {
-                unsigned long bits = qatomic_xchg(&src[idx][offset], 0);
-                unsigned long new_dirty;
-                new_dirty = ~dest[k];
-                dest[k] |= bits;
-                new_dirty &= bits;
-                num_dirty += ctpopl(new_dirty);
-            }
-
-            if (++offset >= BITS_TO_LONGS(DIRTY_MEMORY_BLOCK_SIZE)) {
-                offset = 0;
-                idx++;
-            }
-        }
-        if (num_dirty) {
-            physical_memory_dirty_bits_cleared(start, length);
-        }
-
-        if (rb->clear_bmap) {
-            /*
-             * Postpone the dirty bitmap clear to the point before we
-             * really send the pages, also we will split the clear
-             * dirty procedure into smaller chunks.
-             */
-            clear_bmap_set(rb, start >> TARGET_PAGE_BITS,
-                           length >> TARGET_PAGE_BITS);
-        } else {
-            /* Slow path - still do that in a huge chunk */
-            memory_region_clear_dirty_bitmap(rb->mr, start, length);
-        }
+    if (physical_memory_dirty_range_aligned(rb, start, length)) {
+        num_dirty = physical_memory_sync_dirty_words(rb, start, length);
+        physical_memory_sync_dirty_done(rb, start, length, num_dirty);
     } else {
         ram_addr_t offset = rb->offset;
 
@@ -1022,6 +1068,109 @@ static void ramblock_sync_dirty_bitmap(RAMState *rs, RAMBlock *rb)
     rs->num_dirty_pages_period += new_dirty_pages;
 }
 
+/*
+ * Ranges smaller than this are not split further between the threads of
+ * the dirty-sync-threads pool.
+ */
+#define RAM_DIRTY_SYNC_MIN_CHUNK (256 * MiB)
+
+typedef struct RAMDirtySyncWork {
+    RAMBlock *rb;
+    ram_addr_t start;
+    ram_addr_t length;
+    uint64_t num_dirty;
+} RAMDirtySyncWork;
+
+static int ram_dirty_sync_work(void *opaque)
+{
+    RAMDirtySyncWork *work = opaque;
+
+    WITH_RCU_READ_LOCK_GUARD() {
+        work->num_dirty = physical_memory_sync_dirty_words(work->rb,
+                                                           work->start,
+                                                           work->length);
+    }
+    return 0;
+}
+
+/*
+ * Synchronize the dirty bitmaps of all RAMBlocks using the pool of
+ * dirty-sync-threads.  Word aligned blocks are split into chunks that are
+ * synchronized concurrently; only the copy out of the global dirty bitmap
+ * runs in the pool, while accounting and clearing the dirty log (which
+ * goes through the memory listeners) stays in the migration thread.
+ *
+ * Called with RCU critical section and bitmap_mutex held
+ */
+static void ram_sync_dirty_bitmap_parallel(RAMState *rs)
+{
+    g_autoptr(GArray) works = g_array_new(false, false,
+                                          sizeof(RAMDirtySyncWork));
+    uint64_t new_dirty_pages = 0;
+    ram_addr_t total = 0, chunk;
+    RAMBlock *block;
+    guint i;
+
+    RAMBLOCK_FOREACH_NOT_IGNORED(block) {
+        if (physical_memory_dirty_range_aligned(block, 0,
+                                                block->used_length)) {
+            total += block->used_length;
+        }
+    }
+    chunk = DIV_ROUND_UP(total, rs->dirty_sync_threads);
+    chunk = QEMU_ALIGN_UP(MAX(chunk, RAM_DIRTY_SYNC_MIN_CHUNK),
+                          dirty_bitmap_word_size());
+
+    RAMBLOCK_FOREACH_NOT_IGNORED(block) {
+        ram_addr_t start;
+
+        if (!physical_memory_dirty_range_aligned(block, 0,
+                                                 block->used_length)) {
+            ramblock_sync_dirty_bitmap(rs, block);
+            continue;
+        }
+        for (start = 0; start < block->used_length; start += chunk) {
+            RAMDirtySyncWork work = {
+                .rb = block,
+                .start = start,
+                .length = MIN(chunk, block->used_length - start),
+            };
+
+            g_array_append_val(works, work);
+        }
+    }
+
+    for (i = 0; i < works->len; i++) {
+        thread_pool_submit(rs->dirty_sync_pool, ram_dirty_sync_work,
+                           &g_array_index(works, RAMDirtySyncWork, i), NULL);
+    }
+    thread_pool_wait(rs->dirty_sync_pool);
+
+    for (i = 0; i < works->len; i++) {
+        RAMDirtySyncWork *work = &g_array_index(works, RAMDirtySyncWork, i);
+
+        physical_memory_sync_dirty_done(work->rb, work->start, work->length,
+                                        work->num_dirty);
+        new_dirty_pages += work->num_dirty;
+    }
+
+    rs->migration_dirty_pages += new_dirty_pages;
+    rs->num_dirty_pages_period += new_dirty_pages;
+}
+
+static void ram_dirty_sync_pool_update(RAMState *rs)
+{
+    int threads = migrate_dirty_sync_threads();
+
+    if (threads > 1 && !rs->dirty_sync_pool) {
+        rs->dirty_sync_pool = thread_pool_new();
+    }
+    if (threads > 1 && threads != rs->dirty_sync_threads) {
+        thread_pool_set_max_threads(rs->dirty_sync_pool, threads);
+    }
+    rs->dirty_sync_threads = threads;
+}
+
 /**
  * ram_pagesize_summary: calculate all the pagesizes of a VM
  *
@@ -1082,6 +1231,31 @@ static void migration_update_rates(RAMState *rs, int64_t end_time)
     }
 }
 
+/*
+ * Dirty page rate quota (MB/s) of each vCPU for vcpu-dirty-limit-auto:
+ * the vCPUs share the part of the bandwidth that the guest may dirty, and
+ * the quota is halved when the previous one did not bring the dirty rate
+ * below the threshold.
+ */
+static int64_t migration_dirty_limit_auto_quota(int64_t last_quota)
+{
+    MigrationState *s = migrate_get_current();
+    MachineState *ms = MACHINE(qdev_get_machine());
+    int64_t quota = 0;
+
+    if (s->mbps > 0) {
+        /* Mbps -> MB/s */
+        quota = s->mbps / 8 * migrate_throttle_trigger_threshold() / 100 /
+                ms->smp.cpus;
+    }
+
+    if (dirtylimit_in_service() && last_quota && quota >= last_quota) {
+        quota = last_quota / 2;
+    }
+
+    return MAX(quota, (int64_t)s->parameters.vcpu_dirty_limit);
+}
+
 /*
  * Enable dirty-limit to throttle down the guest
  */
@@ -1089,21 +1263,25 @@ static void migration_dirty_limit_guest(void)
 {
     /*
      * dirty page rate quota for all vCPUs fetched from
-     * migration parameter 'vcpu_dirty_limit'
+     * migration parameter 'vcpu_dirty_limit', or derived from the
+     * bandwidth with 'vcpu_dirty_limit_auto'
      */
     static int64_t quota_dirtyrate;
     MigrationState *s = migrate_get_current();
+    int64_t new_quota = s->parameters.vcpu_dirty_limit;
+
+    if (migrate_vcpu_dirty_limit_auto()) {
+        new_quota = migration_dirty_limit_auto_quota(quota_dirtyrate);
+    }
 
     /*
-     * If dirty limit already enabled and migration parameter
-     * vcpu-dirty-limit untouched.
+     * If dirty limit already enabled and the quota is unchanged.
      */
-    if (dirtylimit_in_service() &&
-        quota_dirtyrate == s->parameters.vcpu_dirty_limit) {
+    if (dirtylimit_in_service() && quota_dirtyrate == new_quota) {
         return;
     }
 
-    quota_dirtyrate = s->parameters.vcpu_dirty_limit;
+    quota_dirtyrate = new_quota;
 
     /*
      * Set all vCPU a quota dirtyrate, note that the second
@@ -1144,6 +1322,7 @@ static void migration_trigger_throttle(RAMState *rs)
 static void migration_bitmap_sync(RAMState *rs, bool last_stage)
 {
     RAMBlock *block;
+    int64_t start_us, sync_us;
     int64_t end_time;
 
     stat64_add(&mig_stats.dirty_sync_count, 1);
@@ -1153,18 +1332,27 @@ static void migration_bitmap_sync(RAMState *rs, bool last_stage)
     }
 
     trace_migration_bitmap_sync_start();
+    start_us = qemu_clock_get_us(QEMU_CLOCK_REALTIME);
     memory_global_dirty_log_sync(last_stage);
+    ram_dirty_sync_pool_update(rs);
 
     WITH_QEMU_LOCK_GUARD(&rs->bitmap_mutex) {
         WITH_RCU_READ_LOCK_GUARD() {
-            RAMBLOCK_FOREACH_NOT_IGNORED(block) {
-                ramblock_sync_dirty_bitmap(rs, block);
+            if (rs->dirty_sync_threads > 1) {
+                ram_sync_dirty_bitmap_parallel(rs);
+            } else {
+                RAMBLOCK_FOREACH_NOT_IGNORED(block) {
+                    ramblock_sync_dirty_bitmap(rs, block);
+                }
             }
             stat64_set(&mig_stats.dirty_bytes_last_sync, ram_bytes_remaining());
         }
     }
 
     memory_global_after_dirty_log_sync();
+    sync_us = qemu_clock_get_us(QEMU_CLOCK_REALTIME) - start_us;
+    stat64_add(&mig_stats.dirty_sync_time, sync_us);
+    stat64_set(&mig_stats.dirty_sync_last_time, sync_us);
     trace_migration_bitmap_sync_end(rs->num_dirty_pages_period);
 
     end_time = qemu_clock_get_ms(QEMU_CLOCK_REALTIME);
@@ -2230,6 +2418,59 @@ out:
  * @rs: current RAM state
  * @pss: data about the page we want to send
  */
+/*
+ * Can ram_save_multifd_word() be used for the page at @pss?  Only plain
+ * precopy over multifd qualifies, with pages that need no per-page work on
+ * the migration thread.
+ */
+static bool ram_save_multifd_word_possible(PageSearchStatus *pss)
+{
+    return migrate_multifd() && !migration_in_postcopy() &&
+           !migrate_rdma() && !migrate_background_snapshot() &&
+           migrate_zero_page_detection() != ZERO_PAGE_DETECTION_LEGACY &&
+           qemu_ram_pagesize(pss->block) == TARGET_PAGE_SIZE;
+}
+
+/*
+ * ram_save_multifd_word: queue to multifd all the dirty pages of the bitmap
+ * word containing pss->page, starting at pss->page
+ *
+ * Scanning the dirty bitmap and queuing pages for multifd one at a time is
+ * what limits the throughput of the migration thread with many channels;
+ * this consumes a whole word of the bitmap at once instead.
+ *
+ * Returns the number of pages queued or negative on error
+ */
+static int ram_save_multifd_word(RAMState *rs, PageSearchStatus *pss)
+{
+    RAMBlock *rb = pss->block;
+    unsigned long word = BIT_WORD(pss->page);
+    unsigned long base = word * BITS_PER_LONG;
+    unsigned long bits = rb->bmap[word] & BITMAP_FIRST_WORD_MASK(pss->page);
+    int pages = 0;
+
+    /* A clear_bmap chunk is at least one word, see CLEAR_BITMAP_SHIFT_MIN */
+    if (!rs->last_stage) {
+        migration_clear_memory_region_dirty_bitmap(rb, pss->page);
+    }
+
+    rb->bmap[word] &= ~bits;
+    rs->migration_dirty_pages -= ctpopl(bits);
+
+    while (bits) {
+        ram_addr_t offset = (ram_addr_t)(base + ctzl(bits)) << TARGET_PAGE_BITS;
+
+        bits &= bits - 1;
+        if (ram_save_multifd_page(rb, offset) < 0) {
+            return -1;
+        }
+        pages++;
+    }
+
+    pss->page = base + BITS_PER_LONG;
+    return pages;
+}
+
 static int ram_save_host_page(RAMState *rs, PageSearchStatus *pss)
 {
     bool page_dirty, preempt_active = postcopy_preempt_active();
@@ -2244,6 +2485,10 @@ static int ram_save_host_page(RAMState *rs, PageSearchStatus *pss)
         return 0;
     }
 
+    if (ram_save_multifd_word_possible(pss)) {
+        return ram_save_multifd_word(rs, pss);
+    }
+
     /* Update host page boundary information */
     pss_host_page_prepare(pss);
 
@@ -2432,6 +2677,7 @@ static void ram_state_cleanup(RAMState **rsp)
 {
     if (*rsp) {
         migration_page_queue_free(*rsp);
+        g_clear_pointer(&(*rsp)->dirty_sync_pool, thread_pool_free);
         qemu_mutex_destroy(&(*rsp)->bitmap_mutex);
         qemu_mutex_destroy(&(*rsp)->src_page_req_mutex);
         g_free(*rsp);
@@ -3871,12 +4117,34 @@ int ram_load_postcopy(QEMUFile *f, int channel)
              * however the source ensures it always sends all the components
              * of a host page in one chunk.
              */
-            page_buffer = tmp_page->tmp_huge_page +
-                          host_page_offset_from_ram_block_offset(block, addr);
+            if (block->postcopy_alias) {
+                /*
+                 * The page cache is filled through the alias mapping and
+                 * the page is mapped into the guest once complete, see
+                 * postcopy_place_page_minor().
+                 */
+                page_buffer = block->postcopy_alias + addr;
+            } else {
+                page_buffer = tmp_page->tmp_huge_page +
+                              host_page_offset_from_ram_block_offset(block,
+                                                                     addr);
+            }
             /* If all TP are zero then we can optimise the place */
             if (tmp_page->target_pages == 1) {
                 tmp_page->host_addr =
                     host_page_from_ram_block_offset(block, addr);
+                /*
+                 * UFFDIO_COPY fails on pages that are already there, make
+                 * sure that the alias does not overwrite them either.
+                 */
+                if (block->postcopy_alias &&
+                    ramblock_recv_bitmap_test_byte_offset(block, addr)) {
+                    error_report("Page already received on channel %d "
+                                 "(rb %s offset 0x"RAM_ADDR_FMT")",
+                                 channel, block->idstr, addr);
+                    ret = -EEXIST;
+                    break;
+                }
             } else if (tmp_page->host_addr !=
                        host_page_from_ram_block_offset(block, addr)) {
                 /* not the 1st TP within the HP */
@@ -3951,7 +4219,11 @@ int ram_load_postcopy(QEMUFile *f, int channel)
         }
 
         if (!ret && place_needed) {
-            if (tmp_page->all_zero) {
+            if (block->postcopy_alias) {
+                /* Zero pages were written to the page cache as well */
+                ret = postcopy_place_page_minor(mis, tmp_page->host_addr,
+                                                block);
+            } else if (tmp_page->all_zero) {
                 ret = postcopy_place_page_zero(mis, tmp_page->host_addr, block);
             } else {
                 ret = postcopy_place_page(mis, tmp_page->host_addr,
@@ -3975,14 +4247,99 @@ static bool postcopy_is_running(void)
  * Flush content of RAM cache into SVM's memory.
  * Only flush the pages that be dirtied by PVM or SVM or both.
  */
+/*
+ * Copies out of the COLO cache are grouped into works of at least this
+ * size for the threads of the dirty-sync-threads pool.
+ */
+#define RAM_COLO_FLUSH_MIN_CHUNK (4 * MiB)
+
+typedef struct RAMColoFlushRun {
+    void *dst;
+    const void *src;
+    size_t len;
+} RAMColoFlushRun;
+
+typedef struct RAMColoFlushWork {
+    const RAMColoFlushRun *runs;
+    guint n_runs;
+} RAMColoFlushWork;
+
+static int ram_colo_flush_work(void *opaque)
+{
+    RAMColoFlushWork *work = opaque;
+    guint i;
+
+    for (i = 0; i < work->n_runs; i++) {
+        memcpy(work->runs[i].dst, work->runs[i].src, work->runs[i].len);
+    }
+    return 0;
+}
+
+/* Queue a copy of @len bytes, split in pieces of at most @chunk bytes */
+static void ram_colo_flush_add_run(GArray *runs, void *dst, const void *src,
+                                   size_t len, size_t chunk)
+{
+    while (len) {
+        RAMColoFlushRun run = {
+            .dst = dst,
+            .src = src,
+            .len = MIN(len, chunk),
+        };
+
+        g_array_append_val(runs, run);
+        dst += run.len;
+        src += run.len;
+        len -= run.len;
+    }
+}
+
+/*
+ * Perform the copies in @runs with the dirty-sync-threads pool, giving each
+ * thread a group of consecutive runs adding up to about @chunk bytes.
+ *
+ * Called with RCU critical section
+ */
+static void ram_colo_flush_parallel(RAMState *rs, GArray *runs, size_t chunk)
+{
+    g_autoptr(GArray) works = g_array_new(false, false,
+                                          sizeof(RAMColoFlushWork));
+    RAMColoFlushWork *work = NULL;
+    size_t bytes = 0;
+    guint i;
+
+    for (i = 0; i < runs->len; i++) {
+        const RAMColoFlushRun *run = &g_array_index(runs, RAMColoFlushRun, i);
+
+        if (!work || bytes >= chunk) {
+            RAMColoFlushWork new_work = { .runs = run };
+
+            g_array_append_val(works, new_work);
+            work = &g_array_index(works, RAMColoFlushWork, works->len - 1);
+            bytes = 0;
+        }
+        work->n_runs++;
+        bytes += run->len;
+    }
+
+    for (i = 0; i < works->len; i++) {
+        thread_pool_submit(rs->dirty_sync_pool, ram_colo_flush_work,
+                           &g_array_index(works, RAMColoFlushWork, i), NULL);
+    }
+    thread_pool_wait(rs->dirty_sync_pool);
+}
+
 void colo_flush_ram_cache(void)
 {
     RAMBlock *block = NULL;
     void *dst_host;
     void *src_host;
     unsigned long offset = 0;
+    g_autoptr(GArray) runs = g_array_new(false, false,
+                                         sizeof(RAMColoFlushRun));
+    size_t chunk = 0;
 
     memory_global_dirty_log_sync(false);
+    ram_dirty_sync_pool_update(ram_state);
     qemu_mutex_lock(&ram_state->bitmap_mutex);
     WITH_RCU_READ_LOCK_GUARD() {
         RAMBLOCK_FOREACH_NOT_IGNORED(block) {
@@ -3991,6 +4348,11 @@ void colo_flush_ram_cache(void)
     }
 
     trace_colo_flush_ram_cache_begin(ram_state->migration_dirty_pages);
+    if (ram_state->dirty_sync_threads > 1) {
+        chunk = DIV_ROUND_UP(ram_state->migration_dirty_pages *
+                             TARGET_PAGE_SIZE, ram_state->dirty_sync_threads);
+        chunk = MAX(chunk, RAM_COLO_FLUSH_MIN_CHUNK);
+    }
     WITH_RCU_READ_LOCK_GUARD() {
         block = QLIST_FIRST_RCU(&ram_list.blocks);
 
@@ -4013,10 +4375,19 @@ void colo_flush_ram_cache(void)
                          + (((ram_addr_t)offset) << TARGET_PAGE_BITS);
                 src_host = block->colo_cache
                          + (((ram_addr_t)offset) << TARGET_PAGE_BITS);
-                memcpy(dst_host, src_host, TARGET_PAGE_SIZE * num);
+                if (chunk) {
+                    ram_colo_flush_add_run(runs, dst_host, src_host,
+                                           TARGET_PAGE_SIZE * num, chunk);
+                } else {
+                    memcpy(dst_host, src_host, TARGET_PAGE_SIZE * num);
+                }
                 offset += num;
             }
         }
+
+        if (runs->len) {
+            ram_colo_flush_parallel(ram_state, runs, chunk);
+        }
     }
     qemu_mutex_unlock(&ram_state->bitmap_mutex);
     trace_colo_flush_ram_cache_end();
@@ -4150,6 +4521,120 @@ err:
     return false;
 }
 
+#if defined(__linux__)
+/*
+ * Make the pages of the file range at @file_offset read as zero in the
+ * private file mapping at @host, unless the file already has a hole there.
+ */
+static void mmap_mapped_ram_zero(int fd, void *host, off_t file_offset,
+                                 size_t size)
+{
+    off_t data;
+
+    if (!size) {
+        return;
+    }
+    data = lseek(fd, file_offset, SEEK_DATA);
+    if (data < 0 || data >= file_offset + size) {
+        return;
+    }
+    /* Stale data from an earlier save; only non-zero pages get copied */
+    ram_handle_zero(host, size);
+}
+
+/*
+ * mmap_ramblock_mapped_ram: Map the pages of @block privately from the
+ * migration file instead of reading them.
+ *
+ * Guests restored from the same file then share the unmodified pages
+ * through the host page cache, and only pay for the pages they touch.
+ *
+ * Returns true if @block is now backed by the file, false if the caller
+ * must read the pages.
+ */
+static bool mmap_ramblock_mapped_ram(QEMUFile *f, RAMBlock *block,
+                                     long num_pages, unsigned long *bitmap)
+{
+    QIOChannel *ioc = qemu_file_get_ioc(f);
+    size_t host_page_size = qemu_real_host_page_size();
+    unsigned long set_bit_idx, clear_bit_idx = 0;
+    void *addr;
+    int fd;
+
+    if (!migrate_mapped_ram_mmap() ||
+        !object_dynamic_cast(OBJECT(ioc), TYPE_QIO_CHANNEL_FILE)) {
+        return false;
+    }
+
+    /*
+     * The mapping replaces the block's memory, so it must be private
+     * anonymous RAM of the host page size that nothing has pinned or
+     * registered elsewhere by file descriptor.  Discards of the block
+     * would bring back the file contents rather than zeroes, so devices
+     * that manage discards (virtio-mem) are excluded as well.
+     */
+    if (qemu_ram_is_shared(block) || block->fd >= 0 ||
+        block->guest_memfd >= 0 ||
+        qemu_ram_pagesize(block) != host_page_size ||
+        !QEMU_IS_ALIGNED(block->pages_offset, host_page_size) ||
+        !QEMU_IS_ALIGNED((uintptr_t)block->host, host_page_size) ||
+        ram_block_discard_is_disabled() ||
+        memory_region_has_ram_discard_manager(block->mr)) {
+        warn_report("mapped-ram-mmap: cannot map ramblock %s, reading it",
+                    block->idstr);
+        return false;
+    }
+
+    fd = QIO_CHANNEL_FILE(ioc)->fd;
+    addr = mmap(NULL, block->used_length, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE, fd, block->pages_offset);
+    if (addr == MAP_FAILED) {
+        warn_report("mapped-ram-mmap: cannot map ramblock %s: %s",
+                    block->idstr, strerror(errno));
+        return false;
+    }
+
+    /* Atomically replace the block's memory with the file mapping */
+    if (mremap(addr, block->used_length, block->used_length,
+               MREMAP_MAYMOVE | MREMAP_FIXED, block->host) == MAP_FAILED) {
+        warn_report("mapped-ram-mmap: cannot map ramblock %s: %s",
+                    block->idstr, strerror(errno));
+        munmap(addr, block->used_length);
+        return false;
+    }
+    if (!machine_dump_guest_core(current_machine)) {
+        qemu_madvise(block->host, block->used_length, QEMU_MADV_DONTDUMP);
+    }
+
+    /* Pages that are not in the file must read as zero */
+    for (set_bit_idx = find_first_bit(bitmap, num_pages);
+         set_bit_idx < num_pages;
+         set_bit_idx = find_next_bit(bitmap, num_pages, clear_bit_idx + 1)) {
+        mmap_mapped_ram_zero(fd, block->host +
+                             (clear_bit_idx << TARGET_PAGE_BITS),
+                             block->pages_offset +
+                             (clear_bit_idx << TARGET_PAGE_BITS),
+                             (set_bit_idx - clear_bit_idx) <<
+                             TARGET_PAGE_BITS);
+        clear_bit_idx = find_next_zero_bit(bitmap, num_pages,
+                                           set_bit_idx + 1);
+    }
+    mmap_mapped_ram_zero(fd, block->host + (clear_bit_idx << TARGET_PAGE_BITS),
+                         block->pages_offset +
+                         (clear_bit_idx << TARGET_PAGE_BITS),
+                         (num_pages - clear_bit_idx) << TARGET_PAGE_BITS);
+
+    trace_mmap_ramblock_mapped_ram(block->idstr, block->used_length);
+    return true;
+}
+#else
+static bool mmap_ramblock_mapped_ram(QEMUFile *f, RAMBlock *block,
+                                     long num_pages, unsigned long *bitmap)
+{
+    return false;
+}
+#endif
+
 static void parse_ramblock_mapped_ram(QEMUFile *f, RAMBlock *block,
                                       ram_addr_t length, Error **errp)
 {
@@ -4187,7 +4672,11 @@ static void parse_ramblock_mapped_ram(QEMUFile *f, RAMBlock *block,
         return;
     }
 
-    if (!read_ramblock_mapped_ram(f, block, num_pages, bitmap, errp)) {
+    if (mmap_ramblock_mapped_ram(f, block, num_pages, bitmap)) {
+        /* nothing to read */
+    } else if (mapped_ram_lazy_add_block(f, block, bitmap, num_pages)) {
+        g_steal_pointer(&bitmap);
+    } else if (!read_ramblock_mapped_ram(f, block, num_pages, bitmap, errp)) {
         return;
     }
 
@@ -4394,10 +4883,14 @@ static int ram_load_precopy(QEMUFile *f)
              * once and for all here to make sure all tasks we queued to
              * multifd threads are completed, so that all the ramblocks
              * (including all the guest memory pages within) are fully
-             * loaded after this sync returns.
+             * loaded after this sync returns.  Blocks that are loaded
+             * lazily are not, and only start being prefetched now.
              */
             if (migrate_mapped_ram()) {
                 multifd_recv_sync_main();
+                if (!ret) {
+                    mapped_ram_lazy_start();
+                }
             }
             break;
 
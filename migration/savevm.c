@@ -2269,12 +2269,12 @@ static void loadvm_postcopy_handle_resume(MigrationIncomingState *mis)
     migrate_send_rp_req_pages_pending(mis);
 
     /*
-     * It's time to switch state and release the fault thread to continue
+     * It's time to switch state and release the fault threads to continue
      * service page faults.  Note that this should be explicitly after the
-     * above call to migrate_send_rp_req_pages_pending().  In short:
-     * migrate_send_rp_message_req_pages() is not thread safe, yet.
+     * above call to migrate_send_rp_req_pages_pending(), so that the pending
+     * pages are requested before the new faults.
      */
-    qemu_sem_post(&mis->postcopy_pause_sem_fault);
+    postcopy_fault_thread_resume(mis);
 
     if (migrate_postcopy_preempt()) {
         /*
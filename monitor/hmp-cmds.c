@@ -100,10 +100,16 @@ void hmp_sync_profile(Monitor *mon, const QDict *qdict)
     if (op == NULL) {
         bool on = qsp_is_enabled();
 
-        monitor_printf(mon, "sync-profile is %s\n", on ? "on" : "off");
+        monitor_printf(mon, "sync-profile is %s", on ? "on" : "off");
+        if (on && qsp_get_sample_period() > 1) {
+            monitor_printf(mon, ", sampling 1/%u",
+                           qsp_get_sample_period());
+        }
+        monitor_printf(mon, "\n");
         return;
     }
     if (!strcmp(op, "on")) {
+        qsp_set_sample_period(qdict_get_try_int(qdict, "period", 1));
         qsp_enable();
     } else if (!strcmp(op, "off")) {
         qsp_disable();
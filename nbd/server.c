@@ -28,6 +28,7 @@
 #include "nbd-internal.h"
 #include "qemu/units.h"
 #include "qemu/memalign.h"
+#include "system/iothread.h"
 
 #define NBD_META_ID_BASE_ALLOCATION 0
 #define NBD_META_ID_ALLOCATION_DEPTH 1
@@ -75,9 +76,18 @@ static int system_errno_to_nbd_errno(int err)
     }
 }
 
+/*
+ * Read payloads smaller than this are cheaper to copy than to pin, and
+ * a client may have at most this many buffers waiting for zero copy
+ * completion before further replies are copied again.
+ */
+#define NBD_ZERO_COPY_MIN_SIZE (64 * KiB)
+#define NBD_ZERO_COPY_MAX_BUFS 64
+
 /* Definitions for opaque data types */
 
 typedef struct NBDRequestData NBDRequestData;
+typedef struct NBDZeroCopyBuf NBDZeroCopyBuf;
 
 struct NBDRequestData {
     NBDClient *client;
@@ -85,6 +95,13 @@ struct NBDRequestData {
     bool complete;
 };
 
+/* A read buffer that the kernel may still transmit from */
+struct NBDZeroCopyBuf {
+    uint8_t *data;
+    ssize_t seq; /* done once the socket completed this many writes */
+    QSIMPLEQ_ENTRY(NBDZeroCopyBuf) next;
+};
+
 struct NBDExport {
     BlockExport common;
 
@@ -101,6 +118,8 @@ struct NBDExport {
     bool allocation_depth;
     BdrvDirtyBitmap **export_bitmaps;
     size_t nr_export_bitmaps;
+
+    bool zero_copy;
 };
 
 static QTAILQ_HEAD(, NBDExport) exports = QTAILQ_HEAD_INITIALIZER(exports);
@@ -129,6 +148,7 @@ struct NBDClient {
     QemuMutex lock;
 
     NBDExport *exp;
+    AioContext *ctx; /* iothread of a multithreaded export, or NULL */
     QCryptoTLSCreds *tlscreds;
     char *tlsauthz;
     uint32_t handshake_max_secs;
@@ -140,6 +160,11 @@ struct NBDClient {
     CoMutex send_lock;
     Coroutine *send_coroutine;
 
+    /* MSG_ZEROCOPY read replies, see nbd_co_send_iov_payload() */
+    bool zero_copy;
+    QSIMPLEQ_HEAD(, NBDZeroCopyBuf) zero_copy_bufs; /* protected by send_lock */
+    unsigned nr_zero_copy_bufs; /* protected by send_lock */
+
     bool read_yielding; /* protected by lock */
     bool quiescing; /* protected by lock */
 
@@ -1574,6 +1599,17 @@ void nbd_client_put(NBDClient *client)
 
         object_unref(OBJECT(client->sioc));
         object_unref(OBJECT(client->ioc));
+        /*
+         * The socket is closed now.  Pages that the kernel still sends
+         * from are pinned by it, so the buffers can go.
+         */
+        while (!QSIMPLEQ_EMPTY(&client->zero_copy_bufs)) {
+            NBDZeroCopyBuf *buf = QSIMPLEQ_FIRST(&client->zero_copy_bufs);
+
+            QSIMPLEQ_REMOVE_HEAD(&client->zero_copy_bufs, next);
+            qemu_vfree(buf->data);
+            g_free(buf);
+        }
         if (client->tlscreds) {
             object_unref(OBJECT(client->tlscreds));
         }
@@ -1669,6 +1705,45 @@ static void nbd_request_put(NBDRequestData *req)
     nbd_client_receive_next_request(client);
 }
 
+/*
+ * The AioContext in which the requests of @client are handled: the
+ * iothread assigned by nbd_client_pick_iothread() if the export spans
+ * several, otherwise the export's own context.
+ */
+static AioContext *nbd_client_aio_context(NBDClient *client)
+{
+    return client->ctx ?: client->exp->common.ctx;
+}
+
+/*
+ * Assign a client of a multithreaded export to the iothread that
+ * currently serves the fewest clients.  Runs in the main loop thread,
+ * which owns the list of clients.
+ */
+static void nbd_client_pick_iothread(NBDClient *client)
+{
+    NBDExport *exp = client->exp;
+    NBDClient *other;
+    unsigned best_count = UINT_MAX;
+    size_t i;
+
+    assert(qemu_in_main_thread());
+
+    for (i = 0; i < exp->common.num_iothreads; i++) {
+        AioContext *ctx = iothread_get_aio_context(exp->common.iothreads[i]);
+        unsigned count = 0;
+
+        QTAILQ_FOREACH(other, &exp->clients, next) {
+            count += other->ctx == ctx;
+        }
+        if (count < best_count) {
+            best_count = count;
+            client->ctx = ctx;
+        }
+    }
+    trace_nbd_client_pick_iothread(exp->name, client->ctx, best_count);
+}
+
 static void blk_aio_attached(AioContext *ctx, void *opaque)
 {
     NBDExport *exp = opaque;
@@ -1755,7 +1830,7 @@ static bool nbd_drained_poll(void *opaque)
                  * qio_channel_yield().
                  */
                 if (client->recv_coroutine != NULL && client->read_yielding) {
-                    aio_bh_schedule_oneshot(nbd_export_aio_context(client->exp),
+                    aio_bh_schedule_oneshot(nbd_client_aio_context(client),
                                             nbd_wake_read_bh, client);
                 }
 
@@ -1933,6 +2008,7 @@ static int nbd_export_create(BlockExport *blk_exp, BlockExportOptions *exp_args,
     }
 
     exp->allocation_depth = arg->allocation_depth;
+    exp->zero_copy = arg->zero_copy;
 
     /*
      * We need to inhibit request queuing in the block layer to ensure we can
@@ -2026,12 +2102,13 @@ static void nbd_export_delete(BlockExport *blk_exp)
 }
 
 const BlockExportDriver blk_exp_nbd = {
-    .type               = BLOCK_EXPORT_TYPE_NBD,
-    .instance_size      = sizeof(NBDExport),
-    .supports_inactive  = true,
-    .create             = nbd_export_create,
-    .delete             = nbd_export_delete,
-    .request_shutdown   = nbd_export_request_shutdown,
+    .type                   = BLOCK_EXPORT_TYPE_NBD,
+    .instance_size          = sizeof(NBDExport),
+    .supports_inactive      = true,
+    .supports_multithread   = true,
+    .create                 = nbd_export_create,
+    .delete                 = nbd_export_delete,
+    .request_shutdown       = nbd_export_request_shutdown,
 };
 
 static int coroutine_fn nbd_co_send_iov(NBDClient *client, struct iovec *iov,
@@ -2051,6 +2128,94 @@ static int coroutine_fn nbd_co_send_iov(NBDClient *client, struct iovec *iov,
     return ret;
 }
 
+/*
+ * Release the zero copy buffers whose transmission the kernel has
+ * reported as complete.  Called with send_lock held.
+ */
+static void nbd_zero_copy_reap(NBDClient *client)
+{
+    NBDZeroCopyBuf *buf;
+    ssize_t done;
+
+    done = qio_channel_socket_zero_copy_completed(client->sioc, NULL);
+    if (done < 0) {
+        /* A broken socket fails the next send, which ends the client */
+        return;
+    }
+
+    while ((buf = QSIMPLEQ_FIRST(&client->zero_copy_bufs)) &&
+           buf->seq <= done) {
+        QSIMPLEQ_REMOVE_HEAD(&client->zero_copy_bufs, next);
+        client->nr_zero_copy_bufs--;
+        qemu_vfree(buf->data);
+        g_free(buf);
+    }
+}
+
+/*
+ * Send a reply whose last @iov element is read payload from the request
+ * buffer.  If the client allows it, the headers are copied as usual but
+ * the payload is queued with MSG_ZEROCOPY, saving a copy of every large
+ * read into the socket buffer.  @request->zero_copy is then set, and the
+ * caller must hand the buffer to nbd_co_zero_copy_hold() instead of
+ * freeing it.
+ */
+static int coroutine_fn nbd_co_send_iov_payload(NBDClient *client,
+                                                NBDRequest *request,
+                                                struct iovec *iov,
+                                                unsigned niov, Error **errp)
+{
+    struct iovec *payload = &iov[niov - 1];
+    int ret;
+
+    if (!client->zero_copy || payload->iov_len < NBD_ZERO_COPY_MIN_SIZE) {
+        return nbd_co_send_iov(client, iov, niov, errp);
+    }
+
+    qemu_co_mutex_lock(&client->send_lock);
+    nbd_zero_copy_reap(client);
+    if (client->nr_zero_copy_bufs >= NBD_ZERO_COPY_MAX_BUFS) {
+        qemu_co_mutex_unlock(&client->send_lock);
+        return nbd_co_send_iov(client, iov, niov, errp);
+    }
+    client->send_coroutine = qemu_coroutine_self();
+
+    /* The headers live on the stack, so they must not be sent zero copy */
+    ret = qio_channel_writev_all(client->ioc, iov, niov - 1, errp);
+    if (ret == 0) {
+        ret = qio_channel_writev_full_all(client->ioc, payload, 1, NULL, 0,
+                                          QIO_CHANNEL_WRITE_FLAG_ZERO_COPY,
+                                          errp);
+        request->zero_copy = true;
+    }
+
+    client->send_coroutine = NULL;
+    qemu_co_mutex_unlock(&client->send_lock);
+
+    return ret < 0 ? -EIO : 0;
+}
+
+/*
+ * Take ownership of the buffer of a request that was answered with
+ * zero copy sends.  It is freed once the socket has completed all the
+ * writes queued so far, which include the ones of this request.
+ */
+static void coroutine_fn nbd_co_zero_copy_hold(NBDClient *client,
+                                               NBDRequestData *req)
+{
+    NBDZeroCopyBuf *buf = g_new(NBDZeroCopyBuf, 1);
+
+    qemu_co_mutex_lock(&client->send_lock);
+    buf->data = req->data;
+    buf->seq = client->sioc->zero_copy_queued;
+    QSIMPLEQ_INSERT_TAIL(&client->zero_copy_bufs, buf, next);
+    client->nr_zero_copy_bufs++;
+    req->data = NULL;
+
+    nbd_zero_copy_reap(client);
+    qemu_co_mutex_unlock(&client->send_lock);
+}
+
 static inline void set_be_simple_reply(NBDSimpleReply *reply, uint64_t error,
                                        uint64_t cookie)
 {
@@ -2082,6 +2247,9 @@ static int coroutine_fn nbd_co_send_simple_reply(NBDClient *client,
                                    nbd_err_lookup(nbd_err), len);
     set_be_simple_reply(&reply, nbd_err, request->cookie);
 
+    if (len) {
+        return nbd_co_send_iov_payload(client, request, iov, 2, errp);
+    }
     return nbd_co_send_iov(client, iov, 2, errp);
 }
 
@@ -2163,7 +2331,7 @@ static int coroutine_fn nbd_co_send_chunk_read(NBDClient *client,
                  NBD_REPLY_TYPE_OFFSET_DATA, request);
     stq_be_p(&chunk.offset, offset);
 
-    return nbd_co_send_iov(client, iov, 3, errp);
+    return nbd_co_send_iov_payload(client, request, iov, 3, errp);
 }
 
 static int coroutine_fn nbd_co_send_chunk_error(NBDClient *client,
@@ -3149,6 +3317,9 @@ static coroutine_fn void nbd_trip(void *opaque)
     } else {
         ret = nbd_handle_request(client, &request, req->data, &local_err);
     }
+    if (request.zero_copy) {
+        nbd_co_zero_copy_hold(client, req);
+    }
     if (request.contexts && request.contexts != &client->contexts) {
         assert(request.type == NBD_CMD_BLOCK_STATUS);
         g_free(request.contexts->bitmaps);
@@ -3209,7 +3380,8 @@ static void nbd_client_receive_next_request(NBDClient *client)
         nbd_client_get(client);
         req = nbd_request_get(client);
         client->recv_coroutine = qemu_coroutine_create(nbd_trip, req);
-        aio_co_schedule(client->exp->common.ctx, client->recv_coroutine);
+        aio_co_schedule(nbd_client_aio_context(client),
+                        client->recv_coroutine);
     }
 }
 
@@ -3255,6 +3427,18 @@ static coroutine_fn void nbd_co_client_start(void *opaque)
     }
 
     timer_free(handshake_timer);
+
+    if (client->exp->common.num_iothreads) {
+        nbd_client_pick_iothread(client);
+    }
+
+    /* MSG_ZEROCOPY bypasses TLS, and AF_UNIX sockets refuse it */
+    if (client->exp->zero_copy && client->ioc == QIO_CHANNEL(client->sioc)) {
+        client->zero_copy =
+            qio_channel_socket_set_zero_copy(client->sioc, NULL) == 0;
+        trace_nbd_negotiate_zero_copy(client->zero_copy);
+    }
+
     WITH_QEMU_LOCK_GUARD(&client->lock) {
         nbd_client_receive_next_request(client);
     }
@@ -3292,6 +3476,7 @@ void nbd_client_new(QIOChannelSocket *sioc,
     object_ref(OBJECT(client->ioc));
     client->close_fn = close_fn;
     client->owner = owner;
+    QSIMPLEQ_INIT(&client->zero_copy_bufs);
 
     nbd_set_socket_send_buffer(sioc);
 
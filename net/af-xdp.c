@@ -51,6 +51,7 @@ typedef struct AFXDPState {
 
     uint32_t             xdp_flags;
     bool                 inhibit;
+    bool                 busy_poll;
 
     char                 *map_path;
     int                  map_fd;
@@ -142,6 +143,22 @@ static void af_xdp_writable(void *opaque)
     qemu_flush_queued_packets(&s->nc);
 }
 
+/* Make the kernel process newly submitted Tx descriptors. */
+static void af_xdp_kick_tx(AFXDPState *s)
+{
+    if (s->busy_poll) {
+        /*
+         * Interrupts are deferred while busy polling, so kick the Tx
+         * right away instead of waiting for the socket to become writable.
+         */
+        sendto(xsk_socket__fd(s->xsk), NULL, 0, MSG_DONTWAIT, NULL, 0);
+    }
+
+    if (xsk_ring_prod__needs_wakeup(&s->tx)) {
+        af_xdp_write_poll(s, true);
+    }
+}
+
 static ssize_t af_xdp_receive(NetClientState *nc,
                               const uint8_t *buf, size_t size)
 {
@@ -177,11 +194,74 @@ static ssize_t af_xdp_receive(NetClientState *nc,
     xsk_ring_prod__submit(&s->tx, 1);
     s->outstanding_tx++;
 
-    if (xsk_ring_prod__needs_wakeup(&s->tx)) {
+    af_xdp_kick_tx(s);
+
+    return size;
+}
+
+static int af_xdp_receive_batch(NetClientState *nc,
+                                const struct iovec **iovs,
+                                const int *iovcnts, int count)
+{
+    AFXDPState *s = DO_UPCAST(AFXDPState, nc, nc);
+    uint32_t n_descs, n_free, idx = 0;
+    int i, n_pkts;
+
+    /* Try to recover buffers that are already sent. */
+    af_xdp_complete_tx(s);
+
+    n_free = xsk_prod_nb_free(&s->tx, MIN(count, s->n_pool));
+    n_free = MIN(n_free, s->n_pool);
+
+    /* Oversized packets are dropped and do not need a descriptor. */
+    n_descs = 0;
+    for (n_pkts = 0; n_pkts < count; n_pkts++) {
+        if (iov_size(iovs[n_pkts], iovcnts[n_pkts]) >
+            XSK_UMEM__DEFAULT_FRAME_SIZE) {
+            continue;
+        }
+        if (n_descs == n_free) {
+            break;
+        }
+        n_descs++;
+    }
+
+    if (n_descs && !xsk_ring_prod__reserve(&s->tx, n_descs, &idx)) {
+        n_pkts = 0;
+        n_descs = 0;
+    }
+
+    for (i = 0; i < n_pkts; i++) {
+        size_t size = iov_size(iovs[i], iovcnts[i]);
+        struct xdp_desc *desc;
+
+        if (size > XSK_UMEM__DEFAULT_FRAME_SIZE) {
+            continue;
+        }
+
+        desc = xsk_ring_prod__tx_desc(&s->tx, idx++);
+        desc->addr = s->pool[--s->n_pool];
+        desc->len = size;
+        iov_to_buf(iovs[i], iovcnts[i], 0,
+                   xsk_umem__get_data(s->buffer, desc->addr), size);
+    }
+
+    if (n_descs) {
+        xsk_ring_prod__submit(&s->tx, n_descs);
+        s->outstanding_tx += n_descs;
+        af_xdp_kick_tx(s);
+    }
+
+    if (n_pkts < count) {
+        /*
+         * Out of buffers or space in tx ring.  Poll until we can write.
+         * The rest of the batch goes through af_xdp_receive() and is
+         * queued there.
+         */
         af_xdp_write_poll(s, true);
     }
 
-    return size;
+    return n_pkts;
 }
 
 /*
@@ -224,6 +304,11 @@ static void af_xdp_send(void *opaque)
     uint32_t i, n_rx, idx = 0;
     AFXDPState *s = opaque;
 
+    if (s->busy_poll) {
+        /* Let the kernel run the device's NAPI loop in our context. */
+        recvfrom(xsk_socket__fd(s->xsk), NULL, 0, MSG_DONTWAIT, NULL, NULL);
+    }
+
     n_rx = xsk_ring_cons__peek(&s->rx, AF_XDP_BATCH_SIZE, &idx);
     if (!n_rx) {
         return;
@@ -361,6 +446,10 @@ static int af_xdp_socket_create(AFXDPState *s,
         cfg.bind_flags |= XDP_COPY;
     }
 
+    if (opts->has_zero_copy && opts->zero_copy) {
+        cfg.bind_flags |= XDP_ZEROCOPY;
+    }
+
     queue_id = s->nc.queue_index;
     if (opts->has_start_queue && opts->start_queue > 0) {
         queue_id += opts->start_queue;
@@ -403,6 +492,34 @@ static int af_xdp_socket_create(AFXDPState *s,
     return 0;
 }
 
+static int af_xdp_busy_poll_setup(AFXDPState *s, uint32_t usecs,
+                                  Error **errp)
+{
+#if defined(SO_PREFER_BUSY_POLL) && defined(SO_BUSY_POLL_BUDGET)
+    int fd = xsk_socket__fd(s->xsk);
+    int prefer = 1, timeout = usecs, budget = AF_XDP_BATCH_SIZE;
+
+    if (setsockopt(fd, SOL_SOCKET, SO_PREFER_BUSY_POLL,
+                   &prefer, sizeof(prefer)) ||
+        setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL,
+                   &timeout, sizeof(timeout)) ||
+        setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL_BUDGET,
+                   &budget, sizeof(budget))) {
+        error_setg_errno(errp, errno,
+                         "failed to enable busy polling for %s queue_index: %d",
+                         s->ifname, s->nc.queue_index);
+        return -1;
+    }
+
+    s->busy_poll = true;
+    return 0;
+#else
+    error_setg(errp, "busy polling of AF_XDP sockets is not supported "
+               "by this QEMU build");
+    return -1;
+#endif
+}
+
 static int af_xdp_update_xsk_map(AFXDPState *s, Error **errp)
 {
     int xsk_fd, idx, error = 0;
@@ -437,6 +554,7 @@ static NetClientInfo net_af_xdp_info = {
     .type = NET_CLIENT_DRIVER_AF_XDP,
     .size = sizeof(AFXDPState),
     .receive = af_xdp_receive,
+    .receive_batch = af_xdp_receive_batch,
     .poll = af_xdp_poll,
     .cleanup = af_xdp_cleanup,
 };
@@ -516,6 +634,11 @@ int net_init_af_xdp(const Netdev *netdev,
         error_setg(errp, "'sock-fds' and 'map-path' are mutually exclusive");
         return -1;
     }
+    if (opts->has_force_copy && opts->force_copy &&
+        opts->has_zero_copy && opts->zero_copy) {
+        error_setg(errp, "'force-copy' and 'zero-copy' are mutually exclusive");
+        return -1;
+    }
     if (!opts->map_path && opts->has_map_start_index) {
         error_setg(errp, "'map-start-index' requires 'map-path'");
         return -1;
@@ -556,6 +679,8 @@ int net_init_af_xdp(const Netdev *netdev,
 
         if (af_xdp_umem_create(s, sock_fds ? sock_fds[i] : -1, &err) ||
             af_xdp_socket_create(s, opts, &err) ||
+            (opts->has_busy_poll_us && opts->busy_poll_us &&
+             af_xdp_busy_poll_setup(s, opts->busy_poll_us, &err)) ||
             af_xdp_update_xsk_map(s, &err)) {
             goto err;
         }
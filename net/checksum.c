@@ -16,14 +16,97 @@
  */
 
 #include "qemu/osdep.h"
+#include "qemu/units.h"
 #include "net/checksum.h"
 #include "net/eth.h"
+#include "host/cpuinfo.h"
+
+/*
+ * The accelerated functions return the sum of the native-endian 16-bit
+ * words of a buffer whose length is a multiple of 64 bytes.  Any sum that
+ * is congruent modulo 0xffff will do, e.g. of wider words, because the
+ * result is folded with end-around carry.  Vector lanes are widened to
+ * 64 bits at least every NET_CHECKSUM_CHUNK bytes so that they cannot
+ * overflow.
+ */
+typedef uint64_t (*net_checksum_accel_fn)(const void *, size_t);
+
+#define NET_CHECKSUM_CHUNK (64 * KiB)
+
+/* Below this length the byte-wise loop is used */
+#define NET_CHECKSUM_ACCEL_MIN 64
+
+static uint64_t net_checksum_int(const void *buf, size_t len)
+{
+    uint64_t sum = 0;
+    size_t i;
+
+    for (i = 0; i < len; i += 4) {
+        sum += ldl_he_p(buf + i);
+    }
+    return sum;
+}
+
+#include "host/checksum.c.inc"
+
+static net_checksum_accel_fn net_checksum_accel;
+static unsigned accel_index;
+
+bool test_net_checksum_next_accel(void)
+{
+    if (accel_index != 0) {
+        net_checksum_accel = accel_table[--accel_index];
+        return true;
+    }
+    return false;
+}
+
+static void __attribute__((constructor)) init_accel(void)
+{
+    accel_index = best_accel();
+    net_checksum_accel = accel_table[accel_index];
+}
+
+static uint32_t net_checksum_add_accel(int len, uint8_t *buf, int seq)
+{
+    size_t head = len & ~(size_t)(NET_CHECKSUM_ACCEL_MIN - 1);
+    uint64_t sum = net_checksum_accel(buf, head);
+    size_t i;
+
+    for (i = head; i + 1 < len; i += 2) {
+        sum += lduw_he_p(buf + i);
+    }
+    if (i < len) {
+        uint8_t last[2] = { buf[i], 0 };
+
+        sum += lduw_he_p(last);
+    }
+
+    sum = (sum & 0xffffffff) + (sum >> 32);
+    sum = (sum & 0xffffffff) + (sum >> 32);
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+
+    /*
+     * The sum of native-endian words is the byte-swapped checksum if the
+     * host byte order differs from the one implied by @seq.
+     */
+    if (HOST_BIG_ENDIAN == (seq & 1)) {
+        sum = bswap16(sum);
+    }
+    return sum;
+}
 
 uint32_t net_checksum_add_cont(int len, uint8_t *buf, int seq)
 {
     uint32_t sum1 = 0, sum2 = 0;
     int i;
 
+    if (len >= NET_CHECKSUM_ACCEL_MIN) {
+        return net_checksum_add_accel(len, buf, seq);
+    }
+
     for (i = 0; i < len - 1; i += 2) {
         sum1 += (uint32_t)buf[i];
         sum2 += (uint32_t)buf[i + 1];
@@ -136,6 +136,12 @@ struct CompareState {
     QEMUBH *event_bh;
     enum colo_event event;
 
+    /* Statistics, updated by the compare thread */
+    uint64_t released_packets;
+    uint64_t inconsistencies;
+    uint64_t compare_latency_total_ms;
+    uint64_t compare_latency_max_ms;
+
     QTAILQ_ENTRY(CompareState) next;
 };
 
@@ -184,6 +190,7 @@ static void notify_remote_frame(CompareState *s)
 
 static void colo_compare_inconsistency_notify(CompareState *s)
 {
+    s->inconsistencies++;
     if (s->notify_dev) {
         notify_remote_frame(s);
     } else {
@@ -299,7 +306,14 @@ static inline bool after(uint32_t seq1, uint32_t seq2)
 
 static void colo_release_primary_pkt(CompareState *s, Packet *pkt)
 {
+    int64_t latency = qemu_clock_get_ms(QEMU_CLOCK_HOST) - pkt->creation_ms;
     int ret;
+
+    /* Time the primary packet was held back waiting for the secondary */
+    s->released_packets++;
+    s->compare_latency_total_ms += latency;
+    s->compare_latency_max_ms = MAX(s->compare_latency_max_ms, latency);
+
     ret = compare_chr_send(s,
                            pkt->data,
                            pkt->size,
@@ -597,11 +611,9 @@ static int colo_packet_compare_other(Packet *spkt, Packet *ppkt)
                                        ppkt->size - offset);
 }
 
-static int colo_old_packet_check_one(Packet *pkt, int64_t *check_time)
+static int colo_old_packet_check_one(Packet *pkt, int64_t *deadline)
 {
-    int64_t now = qemu_clock_get_ms(QEMU_CLOCK_HOST);
-
-    if ((now - pkt->creation_ms) > (*check_time)) {
+    if (pkt->creation_ms < *deadline) {
         trace_colo_old_packet_check_found(pkt->creation_ms);
         return 0;
     } else {
@@ -619,29 +631,24 @@ void colo_compare_unregister_notifier(Notifier *notify)
     notifier_remove(notify);
 }
 
-static int colo_old_packet_check_one_conn(Connection *conn,
-                                          CompareState *s)
+/* Packets created before @deadline (in QEMU_CLOCK_HOST ms) are old */
+static bool colo_old_packet_check_one_conn(Connection *conn, int64_t deadline)
 {
     if (!g_queue_is_empty(&conn->primary_list)) {
         if (g_queue_find_custom(&conn->primary_list,
-                                &s->compare_timeout,
+                                &deadline,
                                 (GCompareFunc)colo_old_packet_check_one))
-            goto out;
+            return true;
     }
 
     if (!g_queue_is_empty(&conn->secondary_list)) {
         if (g_queue_find_custom(&conn->secondary_list,
-                                &s->compare_timeout,
+                                &deadline,
                                 (GCompareFunc)colo_old_packet_check_one))
-            goto out;
+            return true;
     }
 
-    return 1;
-
-out:
-    /* Do checkpoint will flush old packet */
-    colo_compare_inconsistency_notify(s);
-    return 0;
+    return false;
 }
 
 /*
@@ -652,13 +659,21 @@ out:
 static void colo_old_packet_check(void *opaque)
 {
     CompareState *s = opaque;
+    /* Read the clock once per scan rather than once per packet */
+    int64_t deadline = qemu_clock_get_ms(QEMU_CLOCK_HOST) - s->compare_timeout;
+    GList *l;
 
     /*
      * If we find one old packet, stop finding job and notify
      * COLO frame do checkpoint.
      */
-    g_queue_find_custom(&s->conn_list, s,
-                        (GCompareFunc)colo_old_packet_check_one_conn);
+    for (l = s->conn_list.head; l; l = l->next) {
+        if (colo_old_packet_check_one_conn(l->data, deadline)) {
+            /* Do checkpoint will flush old packet */
+            colo_compare_inconsistency_notify(s);
+            return;
+        }
+    }
 }
 
 static void colo_compare_packet(CompareState *s, Connection *conn,
@@ -1392,6 +1407,17 @@ static void colo_compare_init(Object *obj)
     s->vnet_hdr = false;
     object_property_add_bool(obj, "vnet_hdr_support", compare_get_vnet_hdr,
                              compare_set_vnet_hdr);
+
+    object_property_add_uint64_ptr(obj, "released_packets",
+                                   &s->released_packets, OBJ_PROP_FLAG_READ);
+    object_property_add_uint64_ptr(obj, "inconsistencies",
+                                   &s->inconsistencies, OBJ_PROP_FLAG_READ);
+    object_property_add_uint64_ptr(obj, "compare_latency_total_ms",
+                                   &s->compare_latency_total_ms,
+                                   OBJ_PROP_FLAG_READ);
+    object_property_add_uint64_ptr(obj, "compare_latency_max_ms",
+                                   &s->compare_latency_max_ms,
+                                   OBJ_PROP_FLAG_READ);
 }
 
 void colo_compare_cleanup(void)
@@ -916,6 +916,40 @@ ssize_t qemu_sendv_packet_async(NetClientState *sender,
                                    iov, iovcnt, sent_cb);
 }
 
+/*
+ * Send @count packets, described by @iovs and @iovcnts, in order.  If the
+ * peer supports it and no filter or pending delivery is in the way, the
+ * packets are passed to the peer in a single call.
+ *
+ * Returns the number of packets that were sent or dropped.  If this is
+ * less than @count, the packet at the returned index has been queued and
+ * @sent_cb will be called for it; the packets after it were not touched
+ * and should be sent again once @sent_cb has run.
+ */
+int qemu_sendv_packet_batch(NetClientState *sender,
+                            const struct iovec **iovs, const int *iovcnts,
+                            int count, NetPacketSent *sent_cb)
+{
+    NetClientState *peer = sender->peer;
+    int i = 0;
+
+    if (peer && peer->info->receive_batch &&
+        !sender->link_down && !peer->link_down && !peer->receive_disabled &&
+        QTAILQ_EMPTY(&sender->filters) && QTAILQ_EMPTY(&peer->filters) &&
+        !qemu_net_queue_delivering(peer->incoming_queue) &&
+        qemu_can_send_packet(sender)) {
+        i = peer->info->receive_batch(peer, iovs, iovcnts, count);
+    }
+
+    for (; i < count; i++) {
+        if (!qemu_sendv_packet_async(sender, iovs[i], iovcnts[i], sent_cb)) {
+            return i;
+        }
+    }
+
+    return count;
+}
+
 ssize_t
 qemu_sendv_packet(NetClientState *nc, const struct iovec *iov, int iovcnt)
 {
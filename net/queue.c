@@ -259,6 +259,11 @@ void qemu_net_queue_purge(NetQueue *queue, NetClientState *from)
     }
 }
 
+bool qemu_net_queue_delivering(NetQueue *queue)
+{
+    return queue->delivering;
+}
+
 bool qemu_net_queue_flush(NetQueue *queue)
 {
     if (queue->delivering)
@@ -31,6 +31,9 @@
 #include <sys/wait.h>
 #include <sys/socket.h>
 #include <net/if.h>
+#ifdef CONFIG_LINUX_IO_URING
+#include <poll.h>
+#endif
 
 #include "net/eth.h"
 #include "net/net.h"
@@ -39,9 +42,11 @@
 #include "system/system.h"
 #include "qapi/error.h"
 #include "qemu/cutils.h"
+#include "qemu/defer-call.h"
 #include "qemu/error-report.h"
 #include "qemu/main-loop.h"
 #include "qemu/sockets.h"
+#include "block/aio.h"
 #include "hw/virtio/vhost.h"
 
 #include "net/tap.h"
@@ -83,6 +88,19 @@ typedef struct TAPState {
     VHostNetState *vhost_net;
     unsigned host_vnet_hdr_len;
     Notifier exit;
+#ifdef CONFIG_LINUX_IO_URING
+    /* Receive through the main AioContext's io_uring instead of read() */
+    bool io_uring;
+    bool closing;
+    CqeHandler rx_cqe_handler;      /* for the READ or POLL_ADD in flight */
+    CqeHandler cancel_cqe_handler;
+    bool rx_in_flight;
+    bool rx_is_poll;                /* the request in flight is a POLL_ADD */
+    bool rx_need_poll;              /* last READ returned -EAGAIN */
+    bool cancel_in_flight;
+    int rx_len;                     /* bytes in buf not yet sent to the peer */
+    QEMUBH *rx_bh;
+#endif
 } TAPState;
 
 static void launch_script(const char *setup_script, const char *ifname,
@@ -90,9 +108,21 @@ static void launch_script(const char *setup_script, const char *ifname,
 
 static void tap_send(void *opaque);
 static void tap_writable(void *opaque);
+#ifdef CONFIG_LINUX_IO_URING
+static void tap_uring_update_rx(TAPState *s);
+#endif
 
 static void tap_update_fd_handler(TAPState *s)
 {
+#ifdef CONFIG_LINUX_IO_URING
+    if (s->io_uring) {
+        qemu_set_fd_handler(s->fd, NULL,
+                            s->write_poll && s->enabled ? tap_writable : NULL,
+                            s);
+        tap_uring_update_rx(s);
+        return;
+    }
+#endif
     qemu_set_fd_handler(s->fd,
                         s->read_poll && s->enabled ? tap_send : NULL,
                         s->write_poll && s->enabled ? tap_writable : NULL,
@@ -177,44 +207,57 @@ static void tap_send_completed(NetClientState *nc, ssize_t len)
     tap_read_poll(s, true);
 }
 
+/*
+ * Pass a packet of @size bytes read into s->buf to the peer.  Returns false
+ * if no further packets should be read for now.
+ */
+static bool tap_send_one(TAPState *s, int size)
+{
+    uint8_t *buf = s->buf;
+    uint8_t min_pkt[ETH_ZLEN];
+    size_t min_pktsz = sizeof(min_pkt);
+
+    if (s->host_vnet_hdr_len && size <= s->host_vnet_hdr_len) {
+        /* Invalid packet */
+        return false;
+    }
+
+    if (s->host_vnet_hdr_len && !s->using_vnet_hdr) {
+        buf  += s->host_vnet_hdr_len;
+        size -= s->host_vnet_hdr_len;
+    }
+
+    if (net_peer_needs_padding(&s->nc)) {
+        if (eth_pad_short_frame(min_pkt, &min_pktsz, buf, size)) {
+            buf = min_pkt;
+            size = min_pktsz;
+        }
+    }
+
+    size = qemu_send_packet_async(&s->nc, buf, size, tap_send_completed);
+    if (size == 0) {
+        tap_read_poll(s, false);
+        return false;
+    }
+    return size > 0;
+}
+
 static void tap_send(void *opaque)
 {
     TAPState *s = opaque;
     int size;
     int packets = 0;
 
-    while (true) {
-        uint8_t *buf = s->buf;
-        uint8_t min_pkt[ETH_ZLEN];
-        size_t min_pktsz = sizeof(min_pkt);
+    /* Let the peer publish the whole burst to the guest at once */
+    defer_call_begin();
 
+    while (true) {
         size = tap_read_packet(s->fd, s->buf, sizeof(s->buf));
         if (size <= 0) {
             break;
         }
 
-        if (s->host_vnet_hdr_len && size <= s->host_vnet_hdr_len) {
-            /* Invalid packet */
-            break;
-        }
-
-        if (s->host_vnet_hdr_len && !s->using_vnet_hdr) {
-            buf  += s->host_vnet_hdr_len;
-            size -= s->host_vnet_hdr_len;
-        }
-
-        if (net_peer_needs_padding(&s->nc)) {
-            if (eth_pad_short_frame(min_pkt, &min_pktsz, buf, size)) {
-                buf = min_pkt;
-                size = min_pktsz;
-            }
-        }
-
-        size = qemu_send_packet_async(&s->nc, buf, size, tap_send_completed);
-        if (size == 0) {
-            tap_read_poll(s, false);
-            break;
-        } else if (size < 0) {
+        if (!tap_send_one(s, size)) {
             break;
         }
 
@@ -229,8 +272,144 @@ static void tap_send(void *opaque)
             break;
         }
     }
+
+    defer_call_end();
+}
+
+#ifdef CONFIG_LINUX_IO_URING
+/*
+ * io_uring receive path
+ *
+ * A single READ of the tap fd is kept in flight in the main AioContext's
+ * io_uring, so it is submitted together with the event loop's own io_uring
+ * call and a packet costs no system call of its own.  Only one request is
+ * in flight at any time to preserve the packet order.  The tap fd is
+ * non-blocking, so an empty queue completes the READ with -EAGAIN; a
+ * POLL_ADD then waits for the next packet.
+ *
+ * Completions only record the result and schedule rx_bh in the iohandler
+ * context so that, like fd handlers, packets are never delivered from a
+ * nested aio_poll().
+ */
+
+static void tap_uring_prep_read(struct io_uring_sqe *sqe, void *opaque)
+{
+    TAPState *s = opaque;
+
+    /* tap is a stream device, the offset is ignored */
+    io_uring_prep_read(sqe, s->fd, s->buf, sizeof(s->buf), 0);
+}
+
+static void tap_uring_prep_poll(struct io_uring_sqe *sqe, void *opaque)
+{
+    TAPState *s = opaque;
+
+    io_uring_prep_poll_add(sqe, s->fd, POLLIN);
+}
+
+static void tap_uring_prep_cancel(struct io_uring_sqe *sqe, void *opaque)
+{
+    TAPState *s = opaque;
+
+    io_uring_prep_cancel(sqe, &s->rx_cqe_handler, 0);
+}
+
+static void tap_uring_rx_cb(CqeHandler *cqe_handler)
+{
+    TAPState *s = container_of(cqe_handler, TAPState, rx_cqe_handler);
+    int ret = cqe_handler->cqe.res;
+
+    s->rx_in_flight = false;
+    if (s->rx_is_poll) {
+        s->rx_need_poll = false;
+    } else if (ret > 0) {
+        s->rx_len = ret;
+        s->rx_need_poll = false;
+    } else {
+        /* -EAGAIN, -ECANCELED or an error, wait for the fd to be readable */
+        s->rx_need_poll = true;
+    }
+
+    if (!s->closing) {
+        qemu_bh_schedule(s->rx_bh);
+    }
+}
+
+static void tap_uring_cancel_cb(CqeHandler *cqe_handler)
+{
+    TAPState *s = container_of(cqe_handler, TAPState, cancel_cqe_handler);
+
+    s->cancel_in_flight = false;
+}
+
+static void tap_uring_rx_bh(void *opaque)
+{
+    TAPState *s = opaque;
+
+    if (!s->read_poll || !s->enabled || s->closing) {
+        return;
+    }
+
+    if (s->rx_len) {
+        int len = s->rx_len;
+
+        s->rx_len = 0;
+        if (!tap_send_one(s, len) && !s->read_poll) {
+            /* Restarted by tap_send_completed() */
+            return;
+        }
+    }
+
+    if (s->rx_in_flight) {
+        return;
+    }
+
+    s->rx_in_flight = true;
+    s->rx_is_poll = s->rx_need_poll;
+    aio_add_sqe(s->rx_is_poll ? tap_uring_prep_poll : tap_uring_prep_read,
+                s, &s->rx_cqe_handler);
+}
+
+static void tap_uring_update_rx(TAPState *s)
+{
+    if (s->read_poll && s->enabled) {
+        qemu_bh_schedule(s->rx_bh);
+    } else if (s->rx_in_flight && !s->cancel_in_flight) {
+        s->cancel_in_flight = true;
+        aio_add_sqe(tap_uring_prep_cancel, s, &s->cancel_cqe_handler);
+    }
+}
+
+static bool tap_uring_init(TAPState *s, Error **errp)
+{
+    if (!aio_has_io_uring()) {
+        error_setg(errp, "io-uring=on requires io_uring support in the "
+                   "event loop");
+        return false;
+    }
+
+    s->rx_cqe_handler.cb = tap_uring_rx_cb;
+    s->cancel_cqe_handler.cb = tap_uring_cancel_cb;
+    s->rx_bh = aio_bh_new(iohandler_get_aio_context(), tap_uring_rx_bh, s);
+    s->io_uring = true;
+    tap_update_fd_handler(s);
+    return true;
 }
 
+/* Called after read polling has been disabled, before closing the fd */
+static void tap_uring_cleanup(TAPState *s)
+{
+    s->closing = true;
+    tap_uring_update_rx(s);
+    while (s->rx_in_flight || s->cancel_in_flight) {
+        aio_poll(qemu_get_aio_context(), true);
+    }
+    qemu_bh_delete(s->rx_bh);
+    s->rx_bh = NULL;
+    s->io_uring = false;
+}
+#endif /* CONFIG_LINUX_IO_URING */
+
 static bool tap_has_ufo(NetClientState *nc)
 {
     TAPState *s = DO_UPCAST(TAPState, nc, nc);
@@ -336,6 +515,11 @@ static void tap_cleanup(NetClientState *nc)
 
     tap_read_poll(s, false);
     tap_write_poll(s, false);
+#ifdef CONFIG_LINUX_IO_URING
+    if (s->io_uring) {
+        tap_uring_cleanup(s);
+    }
+#endif
     close(s->fd);
     s->fd = -1;
 }
@@ -708,6 +892,17 @@ static void net_init_tap_one(const NetdevTapOptions *tap, NetClientState *peer,
         goto failed;
     }
 
+    if (tap->has_io_uring && tap->io_uring) {
+#ifdef CONFIG_LINUX_IO_URING
+        if (!tap_uring_init(s, errp)) {
+            goto failed;
+        }
+#else
+        error_setg(errp, "io-uring=on is not supported by this QEMU build");
+        goto failed;
+#endif
+    }
+
     if (tap->fd || tap->fds) {
         qemu_set_info_str(&s->nc, "fd=%d", fd);
     } else if (tap->helper) {
@@ -614,10 +614,11 @@ out:
         return 0;
     }
 
+    vhost_vdpa_iotlb_batch_begin_once(v->shared);
     r = vhost_vdpa_cvq_map_buf(&s->vhost_vdpa, s->cvq_cmd_out_buffer,
                                vhost_vdpa_net_cvq_cmd_page_len(), false);
     if (unlikely(r < 0)) {
-        return r;
+        goto out_batch;
     }
 
     r = vhost_vdpa_cvq_map_buf(&s->vhost_vdpa, s->status,
@@ -626,6 +627,8 @@ out:
         vhost_vdpa_cvq_unmap_buf(&s->vhost_vdpa, s->cvq_cmd_out_buffer);
     }
 
+out_batch:
+    vhost_vdpa_iotlb_batch_end(v->shared);
     return r;
 }
 
@@ -636,8 +639,10 @@ static void vhost_vdpa_net_cvq_stop(NetClientState *nc)
     assert(nc->info->type == NET_CLIENT_DRIVER_VHOST_VDPA);
 
     if (s->vhost_vdpa.shadow_vqs_enabled) {
+        vhost_vdpa_iotlb_batch_begin_once(s->vhost_vdpa.shared);
         vhost_vdpa_cvq_unmap_buf(&s->vhost_vdpa, s->cvq_cmd_out_buffer);
         vhost_vdpa_cvq_unmap_buf(&s->vhost_vdpa, s->status);
+        vhost_vdpa_iotlb_batch_end(s->vhost_vdpa.shared);
     }
 
     vhost_vdpa_net_client_stop(nc);
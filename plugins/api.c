@@ -610,6 +610,20 @@ void *qemu_plugin_scoreboard_find(struct qemu_plugin_scoreboard *score,
     return base_ptr + vcpu_index * g_array_get_element_size(score->data);
 }
 
+struct qemu_plugin_scoreboard *qemu_plugin_trace_buffer_new(size_t n_entries)
+{
+    return plugin_trace_buffer_new(n_entries);
+}
+
+uint64_t qemu_plugin_trace_buffer_get(struct qemu_plugin_scoreboard *buf,
+                                      unsigned int vcpu_index, uint64_t seq)
+{
+    uint64_t *ring = qemu_plugin_scoreboard_find(buf, vcpu_index);
+
+    g_assert(buf->trace_entries);
+    return ring[1 + (seq & (buf->trace_entries - 1))];
+}
+
 static uint64_t *plugin_u64_address(qemu_plugin_u64 entry,
                                     unsigned int vcpu_index)
 {
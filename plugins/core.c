@@ -12,6 +12,7 @@
  * SPDX-License-Identifier: GPL-2.0-or-later
  */
 #include "qemu/osdep.h"
+#include "qemu/host-utils.h"
 #include "qemu/lockable.h"
 #include "qemu/option.h"
 #include "qemu/plugin.h"
@@ -19,6 +20,7 @@
 #include "qemu/queue.h"
 #include "qemu/rcu_queue.h"
 #include "qemu/rcu.h"
+#include "qemu/thread.h"
 #include "exec/tb-flush.h"
 #include "tcg/tcg-op-common.h"
 #include "plugin.h"
@@ -367,6 +369,10 @@ static enum plugin_dyn_cb_type op_to_cb_type(enum qemu_plugin_op op)
         return PLUGIN_CB_INLINE_ADD_U64;
     case QEMU_PLUGIN_INLINE_STORE_U64:
         return PLUGIN_CB_INLINE_STORE_U64;
+    case QEMU_PLUGIN_INLINE_RECORD_U64:
+        return PLUGIN_CB_INLINE_RECORD_U64;
+    case QEMU_PLUGIN_INLINE_RECORD_VADDR:
+        return PLUGIN_CB_INLINE_RECORD_VADDR;
     default:
         g_assert_not_reached();
     }
@@ -383,6 +389,15 @@ void plugin_register_inline_op_on_entry(GArray **arr,
     struct qemu_plugin_inline_cb inline_cb = { .rw = rw,
                                                .entry = entry,
                                                .imm = imm };
+
+    if (op == QEMU_PLUGIN_INLINE_RECORD_U64 ||
+        op == QEMU_PLUGIN_INLINE_RECORD_VADDR) {
+        /* Records go to the ring that follows the count of a trace buffer */
+        g_assert(entry.score->trace_entries && entry.offset == 0);
+        /* Only memory accesses have an address to record */
+        g_assert(op != QEMU_PLUGIN_INLINE_RECORD_VADDR || rw);
+    }
+
     dyn_cb = plugin_get_dyn_cb(arr);
     dyn_cb->type = op_to_cb_type(op);
     dyn_cb->inline_insn = inline_cb;
@@ -626,6 +641,93 @@ void qemu_plugin_register_vcpu_discon_cb(qemu_plugin_id_t id,
     }
 }
 
+/*
+ * Disable CFI checks.
+ * The callback function has been loaded from an external library so we do not
+ * have type information
+ */
+QEMU_DISABLE_CFI
+static void plugin_vcpu_sample__async(CPUState *cpu, run_on_cpu_data unused)
+{
+    struct qemu_plugin_cb *cb, *next;
+    enum qemu_plugin_event ev = QEMU_PLUGIN_EV_VCPU_SAMPLE;
+    uint64_t pc;
+
+    qatomic_set(&cpu->plugin_state->sample_pending, false);
+    if (!test_bit(ev, cpu->plugin_state->event_mask)) {
+        return;
+    }
+
+    pc = cpu->cc->get_pc(cpu);
+    /* iterate safely; plugins might uninstall themselves at any time */
+    QLIST_FOREACH_SAFE_RCU(cb, &plugin.cb_lists[ev], entry, next) {
+        qemu_plugin_vcpu_sample_cb_t func = cb->f.vcpu_sample;
+
+        func(cpu->cpu_index, pc, cb->udata);
+    }
+}
+
+static void plugin_sample_cpu__locked(gpointer k, gpointer v, gpointer udata)
+{
+    CPUState *cpu = container_of(k, CPUState, cpu_index);
+
+    /* Do not wake up idle vCPUs, and do not pile up samples */
+    if (qatomic_read(&cpu->halted) ||
+        qatomic_xchg(&cpu->plugin_state->sample_pending, true)) {
+        return;
+    }
+    async_run_on_cpu(cpu, plugin_vcpu_sample__async, RUN_ON_CPU_NULL);
+}
+
+/*
+ * Sampling only needs the vCPUs to stop at a block boundary now and then,
+ * which async_run_on_cpu() does by kicking them; so the translated code
+ * is not instrumented at all.
+ */
+static void *plugin_sample_thread(void *opaque)
+{
+    uint64_t period_ns;
+
+    WITH_QEMU_LOCK_GUARD(&plugin.lock) {
+        period_ns = plugin.sample_period_ns;
+    }
+    while (true) {
+        g_usleep(MAX(period_ns / 1000, 1));
+
+        WITH_QEMU_LOCK_GUARD(&plugin.lock) {
+            if (test_bit(QEMU_PLUGIN_EV_VCPU_SAMPLE, plugin.mask)) {
+                g_hash_table_foreach(plugin.cpu_ht, plugin_sample_cpu__locked,
+                                     NULL);
+            }
+            period_ns = plugin.sample_period_ns;
+        }
+    }
+    return NULL;
+}
+
+void qemu_plugin_register_vcpu_sample_cb(qemu_plugin_id_t id,
+                                         uint64_t period_ns,
+                                         qemu_plugin_vcpu_sample_cb_t cb,
+                                         void *udata)
+{
+    QemuThread thread;
+    bool start;
+
+    g_assert(period_ns);
+    plugin_register_cb_udata(id, QEMU_PLUGIN_EV_VCPU_SAMPLE, cb, udata);
+
+    WITH_QEMU_LOCK_GUARD(&plugin.lock) {
+        start = !plugin.sample_period_ns;
+        if (start || period_ns < plugin.sample_period_ns) {
+            plugin.sample_period_ns = period_ns;
+        }
+    }
+    if (start) {
+        qemu_thread_create(&thread, "plugin-sample", plugin_sample_thread,
+                           NULL, QEMU_THREAD_DETACHED);
+    }
+}
+
 void qemu_plugin_register_flush_cb(qemu_plugin_id_t id,
                                    qemu_plugin_simple_cb_t cb)
 {
@@ -648,7 +750,7 @@ void qemu_plugin_flush_cb(void)
 
 void exec_inline_op(enum plugin_dyn_cb_type type,
                     struct qemu_plugin_inline_cb *cb,
-                    int cpu_index)
+                    int cpu_index, uint64_t vaddr)
 {
     char *ptr = cb->entry.score->data->data;
     size_t elem_size = g_array_get_element_size(
@@ -663,6 +765,16 @@ void exec_inline_op(enum plugin_dyn_cb_type type,
     case PLUGIN_CB_INLINE_STORE_U64:
         *val = cb->imm;
         break;
+    case PLUGIN_CB_INLINE_RECORD_U64:
+    case PLUGIN_CB_INLINE_RECORD_VADDR:
+    {
+        size_t n_entries = cb->entry.score->trace_entries;
+
+        val[1 + (*val & (n_entries - 1))] =
+            type == PLUGIN_CB_INLINE_RECORD_U64 ? cb->imm : vaddr;
+        *val += 1;
+        break;
+    }
     default:
         g_assert_not_reached();
     }
@@ -702,8 +814,11 @@ void qemu_plugin_vcpu_mem_cb(CPUState *cpu, uint64_t vaddr,
             break;
         case PLUGIN_CB_INLINE_ADD_U64:
         case PLUGIN_CB_INLINE_STORE_U64:
+        case PLUGIN_CB_INLINE_RECORD_U64:
+        case PLUGIN_CB_INLINE_RECORD_VADDR:
             if (rw & cb->inline_insn.rw) {
-                exec_inline_op(cb->type, &cb->inline_insn, cpu->cpu_index);
+                exec_inline_op(cb->type, &cb->inline_insn, cpu->cpu_index,
+                               vaddr);
             }
             break;
         default:
@@ -829,6 +944,16 @@ struct qemu_plugin_scoreboard *plugin_scoreboard_new(size_t element_size)
     return score;
 }
 
+struct qemu_plugin_scoreboard *plugin_trace_buffer_new(size_t n_entries)
+{
+    struct qemu_plugin_scoreboard *score;
+
+    n_entries = pow2ceil(MAX(n_entries, 1));
+    score = plugin_scoreboard_new((n_entries + 1) * sizeof(uint64_t));
+    score->trace_entries = n_entries;
+    return score;
+}
+
 void plugin_scoreboard_free(struct qemu_plugin_scoreboard *score)
 {
     qemu_rec_mutex_lock(&plugin.lock);
@@ -49,6 +49,8 @@ struct qemu_plugin_state {
     struct qht dyn_cb_arr_ht;
     /* How many vcpus were started */
     int num_vcpus;
+    /* Shortest sampling period requested, or 0 if sampling never started */
+    uint64_t sample_period_ns;
 };
 
 
@@ -111,7 +113,7 @@ void plugin_register_vcpu_mem_cb(GArray **arr,
 
 void exec_inline_op(enum plugin_dyn_cb_type type,
                     struct qemu_plugin_inline_cb *cb,
-                    int cpu_index);
+                    int cpu_index, uint64_t vaddr);
 
 int plugin_num_vcpus(void);
 
@@ -119,6 +121,8 @@ struct qemu_plugin_scoreboard *plugin_scoreboard_new(size_t element_size);
 
 void plugin_scoreboard_free(struct qemu_plugin_scoreboard *score);
 
+struct qemu_plugin_scoreboard *plugin_trace_buffer_new(size_t n_entries);
+
 /**
  * qemu_plugin_fillin_mode_info() - populate mode specific info
  * info: pointer to qemu_info_t structure
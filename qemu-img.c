@@ -34,6 +34,7 @@
 #include "qapi/qobject-output-visitor.h"
 #include "qobject/qjson.h"
 #include "qobject/qdict.h"
+#include "qobject/qnum.h"
 #include "qemu/cutils.h"
 #include "qemu/config-file.h"
 #include "qemu/option.h"
@@ -44,6 +45,9 @@
 #include "qemu/sockets.h"
 #include "qemu/units.h"
 #include "qemu/memalign.h"
+#include "qemu/host-utils.h"
+#include "qemu/timer.h"
+#include "qemu/xxhash.h"
 #include "qom/object_interfaces.h"
 #include "system/block-backend.h"
 #include "block/block_int.h"
@@ -87,6 +91,10 @@ enum {
     OPTION_FORCE = 276,
     OPTION_SKIP_BROKEN = 277,
     OPTION_LIMITS = 278,
+    OPTION_RANDOM = 279,
+    OPTION_READ_PERCENT = 280,
+    OPTION_RATE = 281,
+    OPTION_DEDUPLICATE = 282,
 };
 
 typedef enum OutputFormat {
@@ -1290,6 +1298,67 @@ static int compare_buffers(const uint8_t *buf1, const uint8_t *buf2,
 
 #define IO_BUF_SIZE (2 * MiB)
 
+typedef struct ReadPairState {
+    int pending;
+    int ret[2];
+} ReadPairState;
+
+typedef struct ReadPairReq {
+    ReadPairState *s;
+    int index;
+} ReadPairReq;
+
+static void read_pair_cb(void *opaque, int ret)
+{
+    ReadPairReq *req = opaque;
+
+    req->s->ret[req->index] = ret;
+    req->s->pending--;
+}
+
+/*
+ * Reads @bytes1 bytes from @blk1 into @buf1 and @bytes2 bytes from @blk2
+ * into @buf2, both starting at @offset, with both requests in flight at the
+ * same time.  A side with a byte count of zero is skipped.
+ *
+ * Returns 0 on success.  On failure, returns the negative errno of the
+ * failing read and sets *@failed to 1 or 2 depending on which one it was.
+ */
+static int read_pair(BlockBackend *blk1, uint8_t *buf1, int64_t bytes1,
+                     BlockBackend *blk2, uint8_t *buf2, int64_t bytes2,
+                     int64_t offset, int *failed)
+{
+    QEMUIOVector qiov[2] = {
+        QEMU_IOVEC_INIT_BUF(qiov[0], buf1, bytes1),
+        QEMU_IOVEC_INIT_BUF(qiov[1], buf2, bytes2),
+    };
+    BlockBackend *blk[2] = { blk1, blk2 };
+    ReadPairState s = {};
+    ReadPairReq reqs[2];
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        reqs[i] = (ReadPairReq) { .s = &s, .index = i };
+        if (qiov[i].size) {
+            s.pending++;
+            blk_aio_preadv(blk[i], offset, &qiov[i], 0, read_pair_cb,
+                           &reqs[i]);
+        }
+    }
+
+    while (s.pending) {
+        main_loop_wait(false);
+    }
+
+    for (i = 0; i < 2; i++) {
+        if (s.ret[i] < 0) {
+            *failed = i + 1;
+            return s.ret[i];
+        }
+    }
+    return 0;
+}
+
 /*
  * Check if passed sectors are empty (not allocated or contain only 0 bytes)
  *
@@ -1543,21 +1612,16 @@ static int img_compare(const img_cmd_t *ccmd, int argc, char **argv)
         } else if (allocated1 == allocated2) {
             if (allocated1) {
                 int64_t pnum;
+                int failed;
 
                 chunk = MIN(chunk, IO_BUF_SIZE);
-                ret = blk_pread(blk1, offset, chunk, buf1, 0);
-                if (ret < 0) {
-                    error_report("Error while reading offset %" PRId64
-                                 " of %s: %s",
-                                 offset, filename1, strerror(-ret));
-                    ret = 4;
-                    goto out;
-                }
-                ret = blk_pread(blk2, offset, chunk, buf2, 0);
+                ret = read_pair(blk1, buf1, chunk, blk2, buf2, chunk, offset,
+                                &failed);
                 if (ret < 0) {
                     error_report("Error while reading offset %" PRId64
-                                 " of %s: %s",
-                                 offset, filename2, strerror(-ret));
+                                 " of %s: %s", offset,
+                                 failed == 1 ? filename1 : filename2,
+                                 strerror(-ret));
                     ret = 4;
                     goto out;
                 }
@@ -1663,6 +1727,19 @@ enum ImgConvertBlockStatus {
 #define MAX_COROUTINES 16
 #define CONVERT_THROTTLE_GROUP "img_convert"
 
+/*
+ * Upper limit for the number of block status extents that the first pass of
+ * convert remembers for the copy pass (24 MB worth of extents).  Beyond that,
+ * the copy pass queries the block status again instead.
+ */
+#define MAX_STATUS_CACHE_EXTENTS (1 << 20)
+
+typedef struct ImgConvertStatusExtent {
+    int64_t sector_num;
+    int64_t sector_next_status;
+    enum ImgConvertBlockStatus status;
+} ImgConvertStatusExtent;
+
 typedef struct ImgConvertState {
     BlockBackend **src;
     int64_t *src_sectors;
@@ -1675,6 +1752,9 @@ typedef struct ImgConvertState {
     int64_t wr_offs;
     enum ImgConvertBlockStatus status;
     int64_t sector_next_status;
+    GArray *status_cache;       /* NULL if not (or no longer) recording */
+    guint status_cache_pos;     /* next extent to replay */
+    bool status_cache_replay;
     BlockBackend *target;
     bool has_zero_init;
     bool compressed;
@@ -1685,6 +1765,9 @@ typedef struct ImgConvertState {
     bool copy_range;
     bool salvage;
     bool quiet;
+    bool dedup;
+    bool dedup_shared;          /* set once a cluster was shared */
+    GHashTable *dedup_clusters; /* ImgConvertDedupEntry by content hash */
     int min_sparse;
     int alignment;
     size_t cluster_sectors;
@@ -1697,6 +1780,11 @@ typedef struct ImgConvertState {
     int ret;
 } ImgConvertState;
 
+typedef struct ImgConvertDedupEntry {
+    uint64_t hash;              /* must be first, used as the key */
+    int64_t offset;             /* target offset of the first copy */
+} ImgConvertDedupEntry;
+
 static void convert_select_part(ImgConvertState *s, int64_t sector_num,
                                 int *src_cur, int64_t *src_cur_offset)
 {
@@ -1709,6 +1797,56 @@ static void convert_select_part(ImgConvertState *s, int64_t sector_num,
     }
 }
 
+/*
+ * Fill s->status and s->sector_next_status for @sector_num from the extents
+ * recorded during the first pass, so that the copy pass does not have to
+ * repeat the (possibly expensive) block status queries.  Both passes walk the
+ * image in the same steps, so the extents are consumed in order.
+ *
+ * Returns true on success, false if the status must be queried.
+ */
+static bool convert_replay_status(ImgConvertState *s, int64_t sector_num)
+{
+    ImgConvertStatusExtent *e;
+
+    if (!s->status_cache_replay ||
+        s->status_cache_pos >= s->status_cache->len) {
+        return false;
+    }
+
+    e = &g_array_index(s->status_cache, ImgConvertStatusExtent,
+                       s->status_cache_pos);
+    if (e->sector_num != sector_num) {
+        return false;
+    }
+
+    s->status_cache_pos++;
+    s->status = e->status;
+    s->sector_next_status = e->sector_next_status;
+    return true;
+}
+
+static void convert_record_status(ImgConvertState *s, int64_t sector_num)
+{
+    ImgConvertStatusExtent e = {
+        .sector_num         = sector_num,
+        .sector_next_status = s->sector_next_status,
+        .status             = s->status,
+    };
+
+    if (!s->status_cache || s->status_cache_replay) {
+        return;
+    }
+
+    if (s->status_cache->len >= MAX_STATUS_CACHE_EXTENTS) {
+        g_array_free(s->status_cache, true);
+        s->status_cache = NULL;
+        return;
+    }
+
+    g_array_append_val(s->status_cache, e);
+}
+
 static int coroutine_mixed_fn GRAPH_RDLOCK
 convert_iteration_sectors(ImgConvertState *s, int64_t sector_num)
 {
@@ -1731,7 +1869,11 @@ convert_iteration_sectors(ImgConvertState *s, int64_t sector_num)
         }
     }
 
-    if (s->sector_next_status <= sector_num) {
+    if (s->sector_next_status <= sector_num &&
+        convert_replay_status(s, sector_num))
+    {
+        n = s->sector_next_status - sector_num;
+    } else if (s->sector_next_status <= sector_num) {
         uint64_t offset = (sector_num - src_cur_offset) * BDRV_SECTOR_SIZE;
         int64_t count;
         int tail;
@@ -1794,6 +1936,7 @@ convert_iteration_sectors(ImgConvertState *s, int64_t sector_num)
         }
 
         s->sector_next_status = sector_num + n;
+        convert_record_status(s, sector_num);
     }
 
     n = MIN(n, s->sector_next_status - sector_num);
@@ -1870,6 +2013,163 @@ static int coroutine_fn convert_co_read(ImgConvertState *s, int64_t sector_num,
 }
 
 
+static uint64_t convert_dedup_hash(const void *buf, size_t len)
+{
+    const uint64_t *p = buf;
+    uint64_t v1, v2, v3, v4;
+    size_t i;
+
+    v1 = QEMU_XXHASH_SEED + XXH_PRIME64_1 + XXH_PRIME64_2;
+    v2 = QEMU_XXHASH_SEED + XXH_PRIME64_2;
+    v3 = QEMU_XXHASH_SEED + 0;
+    v4 = QEMU_XXHASH_SEED - XXH_PRIME64_1;
+    for (i = 0; i < len / 8; i += 4) {
+        v1 = XXH64_round(v1, p[i + 0]);
+        v2 = XXH64_round(v2, p[i + 1]);
+        v3 = XXH64_round(v3, p[i + 2]);
+        v4 = XXH64_round(v4, p[i + 3]);
+    }
+    return XXH64_avalanche(XXH64_mergerounds(v1, v2, v3, v4) + len);
+}
+
+/*
+ * Try to avoid writing the target cluster at @offset with the data in @buf,
+ * either because a new target already reads the same data from its backing
+ * file, or because an identical cluster was written before and can be shared.
+ * @tmp is a cluster sized bounce buffer.
+ *
+ * Returns 1 if the cluster needs no write, 0 if it must be written and a
+ * negative error code on failure.
+ */
+static int coroutine_fn convert_dedup_cluster(ImgConvertState *s,
+                                              int64_t offset,
+                                              const uint8_t *buf,
+                                              uint64_t hash, uint8_t *tmp)
+{
+    int64_t len = s->cluster_sectors * BDRV_SECTOR_SIZE;
+    ImgConvertDedupEntry *e;
+    int ret;
+
+    if (s->target_has_backing && s->target_is_new) {
+        ret = blk_co_pread(s->target, offset, len, tmp, 0);
+        if (ret < 0) {
+            return ret;
+        }
+        if (!memcmp(tmp, buf, len)) {
+            return 1;
+        }
+    }
+
+    e = g_hash_table_lookup(s->dedup_clusters, &hash);
+    if (!e) {
+        return 0;
+    }
+
+    /* Compare the data, a hash collision must not corrupt the image */
+    ret = blk_co_pread(s->target, e->offset, len, tmp, 0);
+    if (ret < 0) {
+        return ret;
+    }
+    if (memcmp(tmp, buf, len)) {
+        return 0;
+    }
+
+    ret = blk_co_share_range(s->target, e->offset, offset, len);
+    if (ret == -ENOTSUP) {
+        /*
+         * Either the target cannot share at all, or this cluster cannot be
+         * shared any more (e.g. its refcount is at the maximum); in the
+         * latter case the new copy takes its place.
+         */
+        if (!s->dedup_shared) {
+            s->dedup = false;
+        }
+        g_hash_table_remove(s->dedup_clusters, &hash);
+        return 0;
+    }
+    if (ret < 0) {
+        return ret;
+    }
+
+    s->dedup_shared = true;
+    return 1;
+}
+
+/*
+ * Write @bytes from @buf to the target at @offset, sharing every full cluster
+ * that is identical to one written before instead of writing it again.
+ */
+static int coroutine_fn convert_co_write_dedup(ImgConvertState *s,
+                                               int64_t offset, int64_t bytes,
+                                               uint8_t *buf)
+{
+    int64_t cluster_size = s->cluster_sectors * BDRV_SECTOR_SIZE;
+    int64_t end = offset + bytes;
+    int64_t run = offset;
+    int64_t pos, next;
+    g_autofree uint64_t *hashes = NULL;
+    uint8_t *tmp;
+    int ret = 0;
+
+    hashes = g_new(uint64_t, DIV_ROUND_UP(bytes, cluster_size) + 1);
+    tmp = blk_blockalign(s->target, cluster_size);
+
+    for (pos = offset; pos < end; pos = next) {
+        uint64_t *hash = &hashes[(pos - offset) / cluster_size];
+
+        next = MIN(QEMU_ALIGN_DOWN(pos, cluster_size) + cluster_size, end);
+        if (!s->dedup || next - pos != cluster_size) {
+            continue;
+        }
+
+        *hash = convert_dedup_hash(buf + (pos - offset), cluster_size);
+        ret = convert_dedup_cluster(s, pos, buf + (pos - offset), *hash, tmp);
+        if (ret < 0) {
+            goto out;
+        }
+        if (ret == 0) {
+            continue;
+        }
+
+        if (pos > run) {
+            ret = blk_co_pwrite(s->target, run, pos - run,
+                                buf + (run - offset), 0);
+            if (ret < 0) {
+                goto out;
+            }
+        }
+        run = next;
+    }
+
+    if (end > run) {
+        ret = blk_co_pwrite(s->target, run, end - run, buf + (run - offset), 0);
+        if (ret < 0) {
+            goto out;
+        }
+    }
+    ret = 0;
+
+    /* Remember the clusters that were written for later duplicates */
+    for (pos = offset; s->dedup && pos < end; pos = next) {
+        uint64_t *hash = &hashes[(pos - offset) / cluster_size];
+        ImgConvertDedupEntry *e;
+
+        next = MIN(QEMU_ALIGN_DOWN(pos, cluster_size) + cluster_size, end);
+        if (next - pos != cluster_size ||
+            g_hash_table_contains(s->dedup_clusters, hash)) {
+            continue;
+        }
+        e = g_new(ImgConvertDedupEntry, 1);
+        e->hash = *hash;
+        e->offset = pos;
+        g_hash_table_add(s->dedup_clusters, e);
+    }
+
+out:
+    qemu_vfree(tmp);
+    return ret;
+}
+
 static int coroutine_fn convert_co_write(ImgConvertState *s, int64_t sector_num,
                                          int nb_sectors, uint8_t *buf,
                                          enum ImgConvertBlockStatus status)
@@ -1902,8 +2202,15 @@ static int coroutine_fn convert_co_write(ImgConvertState *s, int64_t sector_num,
                 (s->compressed &&
                  !buffer_is_zero(buf, n * BDRV_SECTOR_SIZE)))
             {
-                ret = blk_co_pwrite(s->target, sector_num << BDRV_SECTOR_BITS,
-                                    n << BDRV_SECTOR_BITS, buf, flags);
+                if (s->dedup) {
+                    ret = convert_co_write_dedup(s,
+                                                 sector_num << BDRV_SECTOR_BITS,
+                                                 n << BDRV_SECTOR_BITS, buf);
+                } else {
+                    ret = blk_co_pwrite(s->target,
+                                        sector_num << BDRV_SECTOR_BITS,
+                                        n << BDRV_SECTOR_BITS, buf, flags);
+                }
                 if (ret < 0) {
                     return ret;
                 }
@@ -2111,12 +2418,17 @@ static int convert_do_copy(ImgConvertState *s)
         s->buf_sectors = s->cluster_sectors;
     }
 
+    /* Remember the block status of the first pass for the copy pass */
+    s->status_cache = g_array_new(false, false,
+                                  sizeof(ImgConvertStatusExtent));
+
     while (sector_num < s->total_sectors) {
         bdrv_graph_rdlock_main_loop();
         n = convert_iteration_sectors(s, sector_num);
         bdrv_graph_rdunlock_main_loop();
         if (n < 0) {
-            return n;
+            ret = n;
+            goto out;
         }
         if (s->status == BLK_DATA || (!s->min_sparse && s->status == BLK_ZERO))
         {
@@ -2127,6 +2439,8 @@ static int convert_do_copy(ImgConvertState *s)
 
     /* Do the copy */
     s->sector_next_status = 0;
+    s->status_cache_replay = true;
+    s->status_cache_pos = 0;
     s->ret = -EINPROGRESS;
 
     qemu_co_mutex_init(&s->lock);
@@ -2144,11 +2458,17 @@ static int convert_do_copy(ImgConvertState *s)
         /* signal EOF to align */
         ret = blk_pwrite_compressed(s->target, 0, 0, NULL);
         if (ret < 0) {
-            return ret;
+            goto out;
         }
     }
 
-    return s->ret;
+    ret = s->ret;
+out:
+    if (s->status_cache) {
+        g_array_free(s->status_cache, true);
+        s->status_cache = NULL;
+    }
+    return ret;
 }
 
 /* Check that bitmaps can be copied, or output an error */
@@ -2230,6 +2550,7 @@ static void set_rate_limit(BlockBackend *blk, int64_t rate_limit)
 static int img_convert(const img_cmd_t *ccmd, int argc, char **argv)
 {
     int c, bs_i, flags, src_flags = BDRV_O_NO_SHARE;
+    uint32_t src_opt_transfer = 0;
     const char *fmt = NULL, *out_fmt = NULL, *cache = "unsafe",
                *src_cache = BDRV_DEFAULT_CACHE, *out_baseimg = NULL,
                *out_filename, *out_baseimg_param, *snapshot_name = NULL,
@@ -2285,6 +2606,7 @@ static int img_convert(const img_cmd_t *ccmd, int argc, char **argv)
             {"sparse-size", required_argument, 0, 'S'},
             {"no-create", no_argument, 0, 'n'},
             {"target-is-zero", no_argument, 0, OPTION_TARGET_IS_ZERO},
+            {"deduplicate", no_argument, 0, OPTION_DEDUPLICATE},
             {"force-share", no_argument, 0, 'U'},
             {"rate-limit", required_argument, 0, 'r'},
             {"parallel", required_argument, 0, 'm'},
@@ -2306,7 +2628,7 @@ static int img_convert(const img_cmd_t *ccmd, int argc, char **argv)
 "        [-l SNAPSHOT] [--bitmaps [--skip-broken-bitmaps]] [--salvage]\n"
 "        [-O TGT_FMT | --target-image-opts] [-o TGT_FMT_OPTS] [-t TGT_CACHE]\n"
 "        [-b BACKING_FILE [-F BACKING_FMT]] [-S SPARSE_SIZE]\n"
-"        [-n] [--target-is-zero] [-c]\n"
+"        [-n] [--target-is-zero] [--deduplicate] [-c]\n"
 "        [-U] [-r RATE] [-m NUM_PARALLEL] [-W] [-C] [-p] [-q] [--object OBJDEF]\n"
 "        SRC_FILE [SRC_FILE2...] TGT_FILE\n"
 ,
@@ -2345,6 +2667,8 @@ static int img_convert(const img_cmd_t *ccmd, int argc, char **argv)
 "     omit target volume creation (e.g. on rbd)\n"
 "  --target-is-zero\n"
 "     indicates that the target volume is pre-zeroed\n"
+"  --deduplicate\n"
+"     store identical clusters only once (qcow2 format only)\n"
 "  -c, --compress\n"
 "     create compressed output image (qcow and qcow2 formats only)\n"
 "  -U, --force-share\n"
@@ -2454,6 +2778,9 @@ static int img_convert(const img_cmd_t *ccmd, int argc, char **argv)
              */
             s.has_zero_init = true;
             break;
+        case OPTION_DEDUPLICATE:
+            s.dedup = true;
+            break;
         case 'c':
             s.compressed = true;
             break;
@@ -2507,6 +2834,11 @@ static int img_convert(const img_cmd_t *ccmd, int argc, char **argv)
         goto fail_getopt;
     }
 
+    if (s.dedup && (s.compressed || s.copy_range)) {
+        error_report("Cannot use --deduplicate with -c or -C");
+        goto fail_getopt;
+    }
+
     if (explict_min_sparse && s.copy_range) {
         error_report("Cannot enable copy offloading when -S is used");
         goto fail_getopt;
@@ -2591,6 +2923,7 @@ static int img_convert(const img_cmd_t *ccmd, int argc, char **argv)
             s.src_alignment[bs_i] = MAX(s.src_alignment[bs_i],
                                         bdi.cluster_size / BDRV_SECTOR_SIZE);
         }
+        src_opt_transfer = MAX(src_opt_transfer, src_bs->bl.opt_transfer);
         s.total_sectors += s.src_sectors[bs_i];
     }
 
@@ -2807,11 +3140,13 @@ static int img_convert(const img_cmd_t *ccmd, int argc, char **argv)
     }
 
     /* increase bufsectors from the default 4096 (2M) if opt_transfer
-     * or discard_alignment of the out_bs is greater. Limit to
-     * MAX_BUF_SECTORS as maximum which is currently 32768 (16MB). */
+     * or discard_alignment of the out_bs, or opt_transfer of a source, is
+     * greater. Limit to MAX_BUF_SECTORS as maximum which is currently
+     * 32768 (16MB). */
     s.buf_sectors = MIN(MAX_BUF_SECTORS,
                         MAX(s.buf_sectors,
-                            MAX(out_bs->bl.opt_transfer >> BDRV_SECTOR_BITS,
+                            MAX(MAX(out_bs->bl.opt_transfer,
+                                    src_opt_transfer) >> BDRV_SECTOR_BITS,
                                 out_bs->bl.pdiscard_alignment >>
                                 BDRV_SECTOR_BITS)));
 
@@ -2860,6 +3195,16 @@ static int img_convert(const img_cmd_t *ccmd, int argc, char **argv)
         s.cluster_sectors = bdi.cluster_size / BDRV_SECTOR_SIZE;
     }
 
+    if (s.dedup) {
+        if (s.compressed || !s.cluster_sectors) {
+            error_report("--deduplicate is not supported by the target");
+            ret = -1;
+            goto out;
+        }
+        s.dedup_clusters = g_hash_table_new_full(g_int64_hash, g_int64_equal,
+                                                 g_free, NULL);
+    }
+
     if (rate_limit) {
         set_rate_limit(s.target, rate_limit);
     }
@@ -2888,6 +3233,9 @@ out:
     }
     g_free(s.src_sectors);
     g_free(s.src_alignment);
+    if (s.dedup_clusters) {
+        g_hash_table_destroy(s.dedup_clusters);
+    }
 fail_getopt:
     qemu_opts_del(sn_opts);
     g_free(options);
@@ -3979,6 +4327,7 @@ static int img_rebase(const img_cmd_t *ccmd, int argc, char **argv)
         int64_t new_backing_size = 0;
         uint64_t offset;
         int64_t n, n_old = 0, n_new = 0;
+        int failed;
         float local_progress = 0;
 
         if (blk_old_backing && bdrv_opt_mem_align(blk_bs(blk_old_backing)) >
@@ -4097,23 +4446,16 @@ static int img_rebase(const img_cmd_t *ccmd, int argc, char **argv)
              * backing files may be smaller than the COW image.
              */
             memset(buf_old + n_old, 0, n - n_old);
+            memset(buf_new + n_new, 0, n - n_new);
             if (!n_old) {
                 old_backing_eof = true;
-            } else {
-                ret = blk_pread(blk_old_backing, offset, n_old, buf_old, 0);
-                if (ret < 0) {
-                    error_report("error while reading from old backing file");
-                    goto out;
-                }
             }
-
-            memset(buf_new + n_new, 0, n - n_new);
-            if (n_new) {
-                ret = blk_pread(blk_new_backing, offset, n_new, buf_new, 0);
-                if (ret < 0) {
-                    error_report("error while reading from new backing file");
-                    goto out;
-                }
+            ret = read_pair(blk_old_backing, buf_old, n_old,
+                            blk_new_backing, buf_new, n_new, offset, &failed);
+            if (ret < 0) {
+                error_report("error while reading from %s backing file",
+                             failed == 1 ? "old" : "new");
+                goto out;
             }
 
             /* If they differ, we need to write to the COW file */
@@ -4638,6 +4980,28 @@ out_no_progress:
     return 0;
 }
 
+/*
+ * Latency histogram with 16 linear sub-buckets per power of two, so that
+ * percentiles are accurate to about 6%.
+ */
+#define BENCH_LAT_SUB_BITS 4
+#define BENCH_LAT_BUCKETS (64 << BENCH_LAT_SUB_BITS)
+
+typedef struct BenchLatency {
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t min_ns;
+    uint64_t max_ns;
+    uint64_t hist[BENCH_LAT_BUCKETS];
+} BenchLatency;
+
+typedef struct BenchRequest {
+    struct BenchData *b;
+    bool write;
+    int64_t start_ns;
+    struct BenchRequest *next_free;
+} BenchRequest;
+
 typedef struct BenchData {
     BlockBackend *blk;
     uint64_t image_size;
@@ -4648,14 +5012,72 @@ typedef struct BenchData {
     int n;
     int flush_interval;
     bool drain_on_flush;
+    bool random;
+    int read_percent;
+    uint64_t rate;
     uint8_t *buf;
     QEMUIOVector *qiov;
 
     int in_flight;
     bool in_flush;
     uint64_t offset;
+    uint64_t submitted;
+    int64_t start_ns;
+    QEMUTimer *rate_timer;
+    BenchRequest *reqs;
+    BenchRequest *free_reqs;
+    BenchLatency lat[2]; /* indexed by BenchRequest.write */
 } BenchData;
 
+static int bench_lat_bucket(uint64_t ns)
+{
+    int shift;
+
+    if (ns < (1 << BENCH_LAT_SUB_BITS)) {
+        return ns;
+    }
+    shift = 63 - clz64(ns) - BENCH_LAT_SUB_BITS;
+    return ((shift + 1) << BENCH_LAT_SUB_BITS) +
+           ((ns >> shift) & ((1 << BENCH_LAT_SUB_BITS) - 1));
+}
+
+/* Returns the smallest latency that falls into @bucket */
+static uint64_t bench_lat_bucket_ns(int bucket)
+{
+    int shift;
+
+    if (bucket < (1 << BENCH_LAT_SUB_BITS)) {
+        return bucket;
+    }
+    shift = (bucket >> BENCH_LAT_SUB_BITS) - 1;
+    return (uint64_t)((1 << BENCH_LAT_SUB_BITS) |
+                      (bucket & ((1 << BENCH_LAT_SUB_BITS) - 1))) << shift;
+}
+
+static void bench_lat_add(BenchLatency *lat, uint64_t ns)
+{
+    lat->hist[bench_lat_bucket(ns)]++;
+    lat->total_ns += ns;
+    lat->min_ns = lat->count ? MIN(lat->min_ns, ns) : ns;
+    lat->max_ns = MAX(lat->max_ns, ns);
+    lat->count++;
+}
+
+static uint64_t bench_lat_percentile(BenchLatency *lat, double percentile)
+{
+    uint64_t target = MAX(1, (uint64_t)(lat->count * percentile / 100));
+    uint64_t sum = 0;
+    int i;
+
+    for (i = 0; i < BENCH_LAT_BUCKETS; i++) {
+        sum += lat->hist[i];
+        if (sum >= target) {
+            return MIN(MAX(bench_lat_bucket_ns(i), lat->min_ns), lat->max_ns);
+        }
+    }
+    return lat->max_ns;
+}
+
 static void bench_undrained_flush_cb(void *opaque, int ret)
 {
     if (ret < 0) {
@@ -4664,73 +5086,208 @@ static void bench_undrained_flush_cb(void *opaque, int ret)
     }
 }
 
-static void bench_cb(void *opaque, int ret)
+static uint64_t bench_next_offset(BenchData *b)
 {
-    BenchData *b = opaque;
-    BlockAIOCB *acb;
+    uint64_t offset = b->offset;
 
-    if (ret < 0) {
-        error_report("Failed request: %s", strerror(-ret));
-        exit(EXIT_FAILURE);
+    if (b->random) {
+        uint64_t nr_steps = 1;
+
+        if (b->image_size > b->bufsize) {
+            nr_steps = (b->image_size - b->bufsize) / b->step + 1;
+        }
+        offset = ((uint64_t)g_random_int() << 32 | g_random_int()) % nr_steps;
+        return offset * b->step;
     }
 
-    if (b->in_flush) {
-        /* Just finished a flush with drained queue: Start next requests */
-        assert(b->in_flight == 0);
-        b->in_flush = false;
-    } else if (b->in_flight > 0) {
-        int remaining = b->n - b->in_flight;
+    b->offset += b->step;
+    if (b->image_size <= b->bufsize) {
+        b->offset = 0;
+    } else {
+        b->offset %= b->image_size - b->bufsize;
+    }
+    return offset;
+}
 
-        b->n--;
-        b->in_flight--;
+static void bench_cb(void *opaque, int ret);
 
-        /* Time for flush? Drain queue if requested, then flush */
-        if (b->flush_interval && remaining % b->flush_interval == 0) {
-            if (!b->in_flight || !b->drain_on_flush) {
-                BlockCompletionFunc *cb;
+static void bench_submit(BenchData *b)
+{
+    BlockAIOCB *acb;
 
-                if (b->drain_on_flush) {
-                    b->in_flush = true;
-                    cb = bench_cb;
-                } else {
-                    cb = bench_undrained_flush_cb;
-                }
+    while (b->n > b->in_flight && b->in_flight < b->nrreq && !b->in_flush) {
+        BenchRequest *req;
+        int64_t now = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+        uint64_t offset;
 
-                acb = blk_aio_flush(b->blk, cb, b);
-                if (!acb) {
-                    error_report("Failed to issue flush request");
-                    exit(EXIT_FAILURE);
-                }
-            }
-            if (b->drain_on_flush) {
-                return;
+        /* With --rate, wait until this request is due */
+        if (b->rate) {
+            int64_t due = b->start_ns +
+                muldiv64(b->submitted, NANOSECONDS_PER_SECOND, b->rate);
+            if (now < due) {
+                timer_mod(b->rate_timer, due);
+                break;
             }
         }
-    }
 
-    while (b->n > b->in_flight && b->in_flight < b->nrreq) {
-        int64_t offset = b->offset;
+        req = b->free_reqs;
+        b->free_reqs = req->next_free;
+        req->write = b->write &&
+                     g_random_int_range(0, 100) >= b->read_percent;
+        req->start_ns = now;
+
         /* blk_aio_* might look for completed I/Os and kick bench_cb
          * again, so make sure this operation is counted by in_flight
          * and b->offset is ready for the next submission.
          */
+        offset = bench_next_offset(b);
         b->in_flight++;
-        b->offset += b->step;
-        if (b->image_size <= b->bufsize) {
-            b->offset = 0;
+        b->submitted++;
+        if (req->write) {
+            acb = blk_aio_pwritev(b->blk, offset, b->qiov, 0, bench_cb, req);
         } else {
-            b->offset %= b->image_size - b->bufsize;
+            acb = blk_aio_preadv(b->blk, offset, b->qiov, 0, bench_cb, req);
         }
-        if (b->write) {
-            acb = blk_aio_pwritev(b->blk, offset, b->qiov, 0, bench_cb, b);
+        if (!acb) {
+            error_report("Failed to issue request");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+static void bench_rate_timer_cb(void *opaque)
+{
+    bench_submit(opaque);
+}
+
+static void bench_drained_flush_cb(void *opaque, int ret)
+{
+    BenchData *b = opaque;
+
+    if (ret < 0) {
+        error_report("Failed flush request: %s", strerror(-ret));
+        exit(EXIT_FAILURE);
+    }
+
+    /* Just finished a flush with drained queue: Start next requests */
+    assert(b->in_flight == 0);
+    b->in_flush = false;
+    bench_submit(b);
+}
+
+static void bench_cb(void *opaque, int ret)
+{
+    BenchRequest *req = opaque;
+    BenchData *b = req->b;
+    BlockAIOCB *acb;
+    int remaining;
+
+    if (ret < 0) {
+        error_report("Failed request: %s", strerror(-ret));
+        exit(EXIT_FAILURE);
+    }
+
+    bench_lat_add(&b->lat[req->write],
+                  qemu_clock_get_ns(QEMU_CLOCK_REALTIME) - req->start_ns);
+    req->next_free = b->free_reqs;
+    b->free_reqs = req;
+
+    remaining = b->n - b->in_flight;
+    b->n--;
+    b->in_flight--;
+
+    /* Time for flush? Drain queue if requested, then flush */
+    if (b->flush_interval && remaining % b->flush_interval == 0) {
+        if (b->drain_on_flush) {
+            b->in_flush = true;
+            if (b->in_flight) {
+                return;
+            }
+            acb = blk_aio_flush(b->blk, bench_drained_flush_cb, b);
         } else {
-            acb = blk_aio_preadv(b->blk, offset, b->qiov, 0, bench_cb, b);
+            acb = blk_aio_flush(b->blk, bench_undrained_flush_cb, b);
         }
         if (!acb) {
-            error_report("Failed to issue request");
+            error_report("Failed to issue flush request");
             exit(EXIT_FAILURE);
         }
+        if (b->drain_on_flush) {
+            return;
+        }
     }
+
+    bench_submit(b);
+}
+
+static const double bench_percentiles[] = { 50, 90, 99, 99.9, 99.99 };
+
+static void bench_dump_human(BenchData *b, double seconds)
+{
+    int i, j;
+
+    for (i = 0; i < ARRAY_SIZE(b->lat); i++) {
+        BenchLatency *lat = &b->lat[i];
+
+        if (!lat->count) {
+            continue;
+        }
+        printf("%s: %" PRIu64 " requests, %.1f IOPS, %.1f MiB/s\n",
+               i ? "write" : "read", lat->count, lat->count / seconds,
+               lat->count * b->bufsize / seconds / MiB);
+        printf("  latency (us): min %.1f, avg %.1f, max %.1f\n",
+               lat->min_ns / 1000.0, lat->total_ns / 1000.0 / lat->count,
+               lat->max_ns / 1000.0);
+        printf("  percentiles (us):");
+        for (j = 0; j < ARRAY_SIZE(bench_percentiles); j++) {
+            printf("%s %g%% %.1f", j ? "," : "", bench_percentiles[j],
+                   bench_lat_percentile(lat, bench_percentiles[j]) / 1000.0);
+        }
+        printf("\n");
+    }
+}
+
+static void bench_dump_json(BenchData *b, double seconds)
+{
+    QDict *result = qdict_new();
+    GString *str;
+    int i, j;
+
+    qdict_put_int(result, "buffer-size", b->bufsize);
+    qdict_put_int(result, "depth", b->nrreq);
+    qdict_put_bool(result, "random", b->random);
+    qdict_put(result, "seconds", qnum_from_double(seconds));
+
+    for (i = 0; i < ARRAY_SIZE(b->lat); i++) {
+        BenchLatency *lat = &b->lat[i];
+        QDict *stats, *percentiles;
+
+        if (!lat->count) {
+            continue;
+        }
+
+        percentiles = qdict_new();
+        for (j = 0; j < ARRAY_SIZE(bench_percentiles); j++) {
+            g_autofree char *name = g_strdup_printf("%g", bench_percentiles[j]);
+            qdict_put_int(percentiles, name,
+                          bench_lat_percentile(lat, bench_percentiles[j]));
+        }
+
+        stats = qdict_new();
+        qdict_put_int(stats, "requests", lat->count);
+        qdict_put(stats, "iops", qnum_from_double(lat->count / seconds));
+        qdict_put(stats, "bytes-per-second",
+                  qnum_from_double(lat->count * b->bufsize / seconds));
+        qdict_put_int(stats, "min-latency-ns", lat->min_ns);
+        qdict_put_int(stats, "avg-latency-ns", lat->total_ns / lat->count);
+        qdict_put_int(stats, "max-latency-ns", lat->max_ns);
+        qdict_put(stats, "latency-percentiles-ns", percentiles);
+        qdict_put(result, i ? "write" : "read", stats);
+    }
+
+    str = qobject_to_json_pretty(QOBJECT(result), true);
+    printf("%s\n", str->str);
+    g_string_free(str, true);
+    qobject_unref(result);
 }
 
 static int img_bench(const img_cmd_t *ccmd, int argc, char **argv)
@@ -4757,6 +5314,11 @@ static int img_bench(const img_cmd_t *ccmd, int argc, char **argv)
     int i;
     bool force_share = false;
     size_t buf_size = 0;
+    bool random = false;
+    int read_percent = 0;
+    int64_t rate = 0;
+    OutputFormat output_format = OFORMAT_HUMAN;
+    double seconds;
 
     for (;;) {
         static const struct option long_options[] = {
@@ -4773,6 +5335,10 @@ static int img_bench(const img_cmd_t *ccmd, int argc, char **argv)
             {"pattern", required_argument, 0, OPTION_PATTERN},
             {"flush-interval", required_argument, 0, OPTION_FLUSH_INTERVAL},
             {"no-drain", no_argument, 0, OPTION_NO_DRAIN},
+            {"random", no_argument, 0, OPTION_RANDOM},
+            {"read-percent", required_argument, 0, OPTION_READ_PERCENT},
+            {"rate", required_argument, 0, OPTION_RATE},
+            {"output", required_argument, 0, OPTION_OUTPUT},
             {"aio", required_argument, 0, 'i'},
             {"native", no_argument, 0, 'n'},
             {"force-share", no_argument, 0, 'U'},
@@ -4790,8 +5356,9 @@ static int img_bench(const img_cmd_t *ccmd, int argc, char **argv)
         case 'h':
             cmd_help(ccmd, "[-f FMT | --image-opts] [-t CACHE]\n"
 "        [-c COUNT] [-d DEPTH] [-o OFFSET] [-s BUFFER_SIZE] [-S STEP_SIZE]\n"
-"        [-w [--pattern PATTERN] [--flush-interval INTERVAL [--no-drain]]]\n"
-"        [-i AIO] [-n] [-U] [-q] FILE\n"
+"        [-w [--pattern PATTERN] [--flush-interval INTERVAL [--no-drain]]\n"
+"            [--read-percent PERCENT]] [--random] [--rate IOPS]\n"
+"        [--output human|json] [-i AIO] [-n] [-U] [-q] FILE\n"
 ,
 "  -f, --format FMT\n"
 "     specify FILE format explicitly\n"
@@ -4820,6 +5387,14 @@ static int img_bench(const img_cmd_t *ccmd, int argc, char **argv)
 "     issue flush after this number of requests\n"
 "  --no-drain\n"
 "     do not wait when flushing pending requests\n"
+"  --read-percent PERCENT\n"
+"     in a write test, issue this percentage of requests as reads\n"
+"  --random\n"
+"     use random offsets (multiples of STEP_SIZE) instead of sequential ones\n"
+"  --rate IOPS\n"
+"     do not submit more than IOPS requests per second\n"
+"  --output human|json\n"
+"     output format for the results (default: human)\n"
 "  -i, --aio AIO\n"
 "     async-io backend (threads, native, io_uring)\n"
 "  -n, --native\n"
@@ -4910,6 +5485,25 @@ static int img_bench(const img_cmd_t *ccmd, int argc, char **argv)
         case OPTION_NO_DRAIN:
             drain_on_flush = false;
             break;
+        case OPTION_RANDOM:
+            random = true;
+            break;
+        case OPTION_READ_PERCENT:
+            read_percent = cvtnum_full("read percentage", optarg,
+                                       false, 0, 100);
+            if (read_percent < 0) {
+                return 1;
+            }
+            break;
+        case OPTION_RATE:
+            rate = cvtnum_full("request rate", optarg, false, 1, INT64_MAX);
+            if (rate < 0) {
+                return 1;
+            }
+            break;
+        case OPTION_OUTPUT:
+            output_format = parse_output_format(argv[0], optarg);
+            break;
         case 'U':
             force_share = true;
             break;
@@ -4934,6 +5528,11 @@ static int img_bench(const img_cmd_t *ccmd, int argc, char **argv)
         ret = -1;
         goto out;
     }
+    if (!is_write && read_percent) {
+        error_report("--read-percent is only available in write tests");
+        ret = -1;
+        goto out;
+    }
     if (flush_interval && flush_interval < depth) {
         error_report("Flush interval can't be smaller than depth");
         ret = -1;
@@ -4964,13 +5563,27 @@ static int img_bench(const img_cmd_t *ccmd, int argc, char **argv)
         .write          = is_write,
         .flush_interval = flush_interval,
         .drain_on_flush = drain_on_flush,
+        .random         = random,
+        .read_percent   = read_percent,
+        .rate           = rate,
     };
-    printf("Sending %d %s requests, %d bytes each, %d in parallel "
-           "(starting at offset %" PRId64 ", step size %d)\n",
-           data.n, data.write ? "write" : "read", data.bufsize, data.nrreq,
-           data.offset, data.step);
-    if (flush_interval) {
-        printf("Sending flush every %d requests\n", flush_interval);
+    if (output_format == OFORMAT_HUMAN) {
+        printf("Sending %d %s requests, %d bytes each, %d in parallel "
+               "(starting at offset %" PRId64 ", step size %d)\n",
+               data.n, data.write ? "write" : "read", data.bufsize,
+               data.nrreq, data.offset, data.step);
+        if (flush_interval) {
+            printf("Sending flush every %d requests\n", flush_interval);
+        }
+        if (read_percent) {
+            printf("Sending %d%% of the requests as reads\n", read_percent);
+        }
+        if (random) {
+            printf("Using random offsets\n");
+        }
+        if (rate) {
+            printf("Limiting to %" PRId64 " requests per second\n", rate);
+        }
     }
 
     buf_size = data.nrreq * data.bufsize;
@@ -4986,19 +5599,38 @@ static int img_bench(const img_cmd_t *ccmd, int argc, char **argv)
                        data.buf + i * data.bufsize, data.bufsize);
     }
 
+    data.reqs = g_new0(BenchRequest, data.nrreq);
+    for (i = 0; i < data.nrreq; i++) {
+        data.reqs[i].b = &data;
+        data.reqs[i].next_free = data.free_reqs;
+        data.free_reqs = &data.reqs[i];
+    }
+    data.rate_timer = timer_new_ns(QEMU_CLOCK_REALTIME, bench_rate_timer_cb,
+                                   &data);
+
     gettimeofday(&t1, NULL);
-    bench_cb(&data, 0);
+    data.start_ns = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+    bench_submit(&data);
 
     while (data.n > 0) {
         main_loop_wait(false);
     }
     gettimeofday(&t2, NULL);
 
-    printf("Run completed in %3.3f seconds.\n",
-           (t2.tv_sec - t1.tv_sec)
-           + ((double)(t2.tv_usec - t1.tv_usec) / 1000000));
+    seconds = (t2.tv_sec - t1.tv_sec)
+              + ((double)(t2.tv_usec - t1.tv_usec) / 1000000);
+    if (output_format == OFORMAT_JSON) {
+        bench_dump_json(&data, seconds);
+    } else {
+        printf("Run completed in %3.3f seconds.\n", seconds);
+        bench_dump_human(&data, seconds);
+    }
 
 out:
+    if (data.rate_timer) {
+        timer_free(data.rate_timer);
+    }
+    g_free(data.reqs);
     if (data.buf) {
         blk_unregister_buf(blk, data.buf, buf_size);
     }
@@ -233,6 +233,8 @@ DEF("accel", HAS_ARG, QEMU_OPTION_accel,
     "                one-insn-per-tb=on|off (one guest instruction per TCG translation block)\n"
     "                split-wx=on|off (enable TCG split w^x mapping)\n"
     "                tb-size=n (TCG translation block cache size)\n"
+    "                jmp-cache-size=n (TCG per-vCPU jump cache entries, default 4096)\n"
+    "                victim-tlb-size=n (TCG victim TLB entries per MMU mode, default 8)\n"
     "                dirty-ring-size=n (KVM dirty ring GFN count, default 0)\n"
     "                eager-split-size=n (KVM Eager Page Split chunk size, default 0, disabled. ARM only)\n"
     "                notify-vmexit=run|internal-error|disable,notify-window=n (enable notify VM exit and set notify window, x86 only)\n"
@@ -276,6 +278,23 @@ SRST
     ``tb-size=n``
         Controls the size (in MiB) of the TCG translation block cache.
 
+    ``jmp-cache-size=n``
+        Controls the number of entries in the per-vCPU cache that maps
+        guest PCs to TCG translation blocks. It must be a power of two
+        between 1024 and 1048576; the default is 4096. Guests that run
+        code from many different pages may benefit from a larger cache;
+        the ``tcg`` provider of ``query-stats`` reports its hit rate.
+
+    ``victim-tlb-size=n``
+        Controls the number of entries in the victim TLB, which keeps
+        the translations evicted from the main softmmu TLB of each MMU
+        mode. It must be a power of two between 8 and 4096; the default
+        is 8. Entries are grouped in sets of 8, so lookups stay cheap as
+        it grows. Guests with large working sets (e.g. JVMs or databases)
+        may benefit from a larger victim TLB; the ``tlb-victim-hits`` and
+        ``tlb-fills`` statistics of the ``tcg`` provider of
+        ``query-stats`` report how effective it is.
+
     ``thread=single|multi``
         Controls number of TCG threads. When the TCG is multi-threaded
         there will be one thread per vCPU therefore taking advantage of
@@ -1836,7 +1855,7 @@ ERST
 
 DEF("fsdev", HAS_ARG, QEMU_OPTION_fsdev,
     "-fsdev local,id=id,path=path,security_model=mapped-xattr|mapped-file|passthrough|none\n"
-    " [,writeout=immediate][,readonly=on][,fmode=fmode][,dmode=dmode]\n"
+    " [,writeout=immediate][,cache=none|loose][,readonly=on][,fmode=fmode][,dmode=dmode]\n"
     " [[,throttling.bps-total=b]|[[,throttling.bps-read=r][,throttling.bps-write=w]]]\n"
     " [[,throttling.iops-total=i]|[[,throttling.iops-read=r][,throttling.iops-write=w]]]\n"
     " [[,throttling.bps-total-max=bm]|[[,throttling.bps-read-max=rm][,throttling.bps-write-max=wm]]]\n"
@@ -1846,7 +1865,7 @@ DEF("fsdev", HAS_ARG, QEMU_OPTION_fsdev,
     QEMU_ARCH_ALL)
 
 SRST
-``-fsdev local,id=id,path=path,security_model=security_model [,writeout=writeout][,readonly=on][,fmode=fmode][,dmode=dmode] [,throttling.option=value[,throttling.option=value[,...]]]``
+``-fsdev local,id=id,path=path,security_model=security_model [,writeout=writeout][,cache=cache][,readonly=on][,fmode=fmode][,dmode=dmode] [,throttling.option=value[,throttling.option=value[,...]]]``
   \ 
 ``-fsdev synth,id=id[,readonly=on]``
     Define a new file system device. Valid options are:
@@ -1886,6 +1905,14 @@ SRST
         guest only when the data has been reported as written by the
         storage subsystem.
 
+    ``cache=cache``
+        This is an optional argument. Supported values are "none" (the
+        default) and "loose". With "loose" the server caches file
+        attributes for a short time, saving host stat calls on
+        metadata-heavy workloads. Changes made on the host behind the
+        server's back may not be visible to the guest until the cached
+        entry expires.
+
     ``readonly=on``
         Enables exporting 9p share as a readonly mount for guests. By
         default read-write access is given.
@@ -1941,12 +1968,12 @@ ERST
 
 DEF("virtfs", HAS_ARG, QEMU_OPTION_virtfs,
     "-virtfs local,path=path,mount_tag=tag,security_model=mapped-xattr|mapped-file|passthrough|none\n"
-    "        [,id=id][,writeout=immediate][,readonly=on][,fmode=fmode][,dmode=dmode][,multidevs=remap|forbid|warn]\n"
+    "        [,id=id][,writeout=immediate][,cache=none|loose][,readonly=on][,fmode=fmode][,dmode=dmode][,multidevs=remap|forbid|warn]\n"
     "-virtfs synth,mount_tag=tag[,id=id][,readonly=on]\n",
     QEMU_ARCH_ALL)
 
 SRST
-``-virtfs local,path=path,mount_tag=mount_tag ,security_model=security_model[,writeout=writeout][,readonly=on] [,fmode=fmode][,dmode=dmode][,multidevs=multidevs]``
+``-virtfs local,path=path,mount_tag=mount_tag ,security_model=security_model[,writeout=writeout][,cache=cache][,readonly=on] [,fmode=fmode][,dmode=dmode][,multidevs=multidevs]``
   \ 
 ``-virtfs synth,mount_tag=mount_tag``
     Define a new virtual filesystem device and expose it to the guest using
@@ -1996,6 +2023,14 @@ SRST
         guest only when the data has been reported as written by the
         storage subsystem.
 
+    ``cache=cache``
+        This is an optional argument. Supported values are "none" (the
+        default) and "loose". With "loose" the server caches file
+        attributes for a short time, saving host stat calls on
+        metadata-heavy workloads. Changes made on the host behind the
+        server's back may not be visible to the guest until the cached
+        entry expires.
+
     ``readonly=on``
         Enables exporting 9p share as a readonly mount for guests. By
         default read-write access is given.
@@ -2883,7 +2918,7 @@ DEF("netdev", HAS_ARG, QEMU_OPTION_netdev,
     "-netdev tap,id=str[,fd=h][,fds=x:y:...:z][,ifname=name][,script=file][,downscript=dfile]\n"
     "         [,br=bridge][,helper=helper][,sndbuf=nbytes][,vnet_hdr=on|off][,vhost=on|off]\n"
     "         [,vhostfd=h][,vhostfds=x:y:...:z][,vhostforce=on|off][,queues=n]\n"
-    "         [,poll-us=n]\n"
+    "         [,poll-us=n][,io-uring=on|off]\n"
     "                configure a host TAP network backend with ID 'str'\n"
     "                connected to a bridge (default=" DEFAULT_BRIDGE_INTERFACE ")\n"
     "                use network scripts 'file' (default=" DEFAULT_NETWORK_SCRIPT ")\n"
@@ -2906,6 +2941,7 @@ DEF("netdev", HAS_ARG, QEMU_OPTION_netdev,
     "                use 'queues=n' to specify the number of queues to be created for multiqueue TAP\n"
     "                use 'poll-us=n' to specify the maximum number of microseconds that could be\n"
     "                spent on busy polling for vhost net\n"
+    "                use io-uring=on to receive packets through io_uring\n"
     "-netdev bridge,id=str[,br=bridge][,helper=helper]\n"
     "                configure a host TAP network backend with ID 'str' that is\n"
     "                connected to a bridge (default=" DEFAULT_BRIDGE_INTERFACE ")\n"
@@ -2978,9 +3014,12 @@ DEF("netdev", HAS_ARG, QEMU_OPTION_netdev,
     "-netdev af-xdp,id=str,ifname=name[,mode=native|skb][,force-copy=on|off]\n"
     "         [,queues=n][,start-queue=m][,inhibit=on|off][,sock-fds=x:y:...:z]\n"
     "         [,map-path=/path/to/socket/map][,map-start-index=i]\n"
+    "         [,zero-copy=on|off][,busy-poll-us=n]\n"
     "                attach to the existing network interface 'name' with AF_XDP socket\n"
     "                use 'mode=MODE' to specify an XDP program attach mode\n"
     "                use 'force-copy=on|off' to force XDP copy mode even if device supports zero-copy (default: off)\n"
+    "                use 'zero-copy=on|off' to fail if the device does not support zero-copy (default: off) (Since 10.2)\n"
+    "                use 'busy-poll-us=n' to busy poll the device queues for up to n microseconds (default: 0) (Since 10.2)\n"
     "                use 'inhibit=on|off' to inhibit loading of a default XDP program (default: off)\n"
     "                with inhibit=on,\n"
     "                  use 'sock-fds' to provide file descriptors for already open AF_XDP sockets\n"
@@ -3817,7 +3856,7 @@ SRST
         # launch QEMU instance
         |qemu_system| linux.img -nic vde,sock=/tmp/myswitch
 
-``-netdev af-xdp,id=str,ifname=name[,mode=native|skb][,force-copy=on|off][,queues=n][,start-queue=m][,inhibit=on|off][,sock-fds=x:y:...:z][,map-path=/path/to/socket/map][,map-start-index=i]``
+``-netdev af-xdp,id=str,ifname=name[,mode=native|skb][,force-copy=on|off][,queues=n][,start-queue=m][,inhibit=on|off][,sock-fds=x:y:...:z][,map-path=/path/to/socket/map][,map-start-index=i][,zero-copy=on|off][,busy-poll-us=n]``
     Configure AF_XDP backend to connect to a network interface 'name'
     using AF_XDP socket.  A specific program attach mode for a default
     XDP program can be forced with 'mode', defaults to best-effort,
@@ -3882,6 +3921,14 @@ SRST
     for insertion into the socket map.  The combination of 'map-path' and
     'sock-fds' together is not supported.
 
+    By default, zero-copy mode is used if the device supports it and
+    copy mode otherwise.  'zero-copy=on' makes the backend fail to start
+    instead of falling back to copy mode.  'busy-poll-us' enables
+    preferred busy polling (``SO_PREFER_BUSY_POLL``) of the device
+    queues, which trades CPU time for lower latency and higher packet
+    rates.  It should be combined with non-zero ``napi_defer_hard_irqs``
+    and ``gro_flush_timeout`` settings of the interface.
+
 ``-netdev vhost-user,chardev=id[,vhostforce=on|off][,queues=n]``
     Establish a vhost-user netdev, backed by a chardev id. The chardev
     should be a unix domain socket backed one. The vhost-user uses a
@@ -5552,6 +5599,20 @@ SRST
     Enable synchronization profiling.
 ERST
 
+DEF("sync-profile-sample", HAS_ARG, QEMU_OPTION_sync_profile_sample,
+    "-sync-profile-sample period\n"
+    "                enable synchronization profiling of one in\n"
+    "                'period' lock acquisitions\n",
+    QEMU_ARCH_ALL)
+SRST
+``-sync-profile-sample period``
+    Enable synchronization profiling, but only time one in *period* lock
+    acquisitions and condition variable waits in each thread.  The
+    results are scaled to estimate the totals, and can be retrieved with
+    ``info sync-profile`` or with ``query-stats`` for the
+    ``lock-call-site`` target.
+ERST
+
 #if defined(CONFIG_TCG) && defined(CONFIG_LINUX)
 DEF("perfmap", 0, QEMU_OPTION_perfmap,
     "-perfmap        generate a /tmp/perf-${pid}.map file for perf\n",
@@ -5624,6 +5685,12 @@ SRST
         MADV\_MERGEABLE, so that Kernel Samepage Merging will consider
         the pages for memory deduplication.
 
+        With ``merge=off``, the ``merge-scan-interval`` option makes QEMU
+        look for zero and duplicate pages itself, one 2 MiB chunk every
+        that many milliseconds, and only mark the chunks that have many
+        of them as mergeable.  This suits guests started from the same
+        image.
+
         Setting the ``dump`` boolean option to off excludes the memory
         from core dumps. This feature is also known as MADV\_DONTDUMP.
 
@@ -5757,13 +5824,15 @@ SRST
         ``virtio-rng`` device. By default, the ``virtio-rng`` device
         uses this RNG backend.
 
-    ``-object rng-random,id=id,filename=/dev/random``
+    ``-object rng-random,id=id,filename=/dev/random[,pool-size=bytes]``
         Creates a random number generator backend which obtains entropy
         from a device on the host. The ``id`` parameter is a unique ID
         that will be used to reference this entropy backend from the
         ``virtio-rng`` device. The ``filename`` parameter specifies
         which file to obtain entropy from and if omitted defaults to
-        ``/dev/urandom``.
+        ``/dev/urandom``. A non-zero ``pool-size`` (at most 1 MiB)
+        prefetches that many bytes in a worker thread and serves guest
+        requests from them, refilling whenever the pool is half empty.
 
     ``-object rng-egd,id=id,chardev=chardevid``
         Creates a random number generator backend which obtains entropy
@@ -5986,6 +6055,10 @@ SRST
         size depend on user environment.
         If user want to use Xen COLO, need to add the notify\_dev to
         notify Xen colo-frame to do checkpoint.
+        The read-only properties released\_packets, inconsistencies,
+        compare\_latency\_total\_ms and compare\_latency\_max\_ms can
+        be read with qom-get to monitor how long primary packets are held
+        back and how often a checkpoint is requested.
 
         COLO-compare must be used with the help of filter-mirror,
         filter-redirector and filter-rewriter.
@@ -6047,13 +6120,16 @@ SRST
         If you want to know the detail of above command line, you can
         read the colo-compare git log.
 
-    ``-object cryptodev-backend-builtin,id=id[,queues=queues]``
+    ``-object cryptodev-backend-builtin,id=id[,queues=queues][,thread-pool=on|off]``
         Creates a cryptodev backend which executes crypto operations from
         the QEMU cipher APIs. The id parameter is a unique ID that will
         be used to reference this cryptodev backend from the
         ``virtio-crypto`` device. The queues parameter is optional,
         which specify the queue number of cryptodev backend, the default
-        of queues is 1.
+        of queues is 1. With ``thread-pool=on`` the operations run in
+        QEMU's worker thread pool instead of the main loop, so requests
+        on different sessions are processed in parallel; the default is
+        off.
 
         .. parsed-literal::
 
@@ -588,12 +588,12 @@ GuestFileRead *guest_file_read_unsafe(GuestFileHandle *gfh,
         gfh->state = RW_STATE_NEW;
     }
 
-    buf = g_malloc0(count + 1);
+    /* up to 48 MiB, only to be base64-encoded: no need to clear it */
+    buf = g_malloc(count);
     read_count = fread(buf, 1, count, fh);
     if (ferror(fh)) {
         error_setg_errno(errp, errno, "failed to read file");
     } else {
-        buf[read_count] = 0;
         read_data = g_new0(GuestFileRead, 1);
         read_data->count = read_count;
         read_data->eof = feof(fh);
@@ -375,12 +375,12 @@ GuestFileRead *guest_file_read_unsafe(GuestFileHandle *gfh,
     bool is_ok;
     DWORD read_count;
 
-    buf = g_malloc0(count + 1);
+    /* up to 48 MiB, only to be base64-encoded: no need to clear it */
+    buf = g_malloc(count);
     is_ok = ReadFile(fh, buf, count, &read_count, NULL);
     if (!is_ok) {
         error_setg_win32(errp, GetLastError(), "failed to read file");
     } else {
-        buf[read_count] = 0;
         read_data = g_new0(GuestFileRead, 1);
         read_data->count = (size_t)read_count;
         read_data->eof = read_count == 0;
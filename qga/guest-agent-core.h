@@ -17,10 +17,16 @@
 #include <pdh.h>
 #endif
 
+#include "qemu/units.h"
 #include "qapi/qmp-registry.h"
 #include "qga-qapi-types.h"
 
 #define QGA_READ_COUNT_DEFAULT 4096
+/*
+ * Bytes read from the channel at a time; large enough that a multi-MB
+ * guest-file-write request is not fed to the parser 4k at a time.
+ */
+#define QGA_CHANNEL_READ_SIZE (64 * KiB)
 
 typedef struct GAState GAState;
 typedef struct GACommandState GACommandState;
@@ -712,9 +712,10 @@ end:
 static gboolean channel_event_cb(GIOCondition condition, gpointer data)
 {
     GAState *s = data;
-    gchar buf[QGA_READ_COUNT_DEFAULT + 1];
+    static gchar buf[QGA_CHANNEL_READ_SIZE + 1];
     gsize count;
-    GIOStatus status = ga_channel_read(s->channel, buf, QGA_READ_COUNT_DEFAULT, &count);
+    GIOStatus status = ga_channel_read(s->channel, buf, QGA_CHANNEL_READ_SIZE,
+                                       &count);
     switch (status) {
     case G_IO_STATUS_ERROR:
         g_warning("error reading channel");
@@ -111,6 +111,17 @@ static void quoted_str(JSONWriter *writer, const char *str)
     g_string_append_c(writer->contents, '"');
 
     for (ptr = str; *ptr; ptr = end) {
+        /* Copy runs of printable ASCII that need no escaping in one go */
+        for (end = (char *)ptr;
+             *end >= 0x20 && *end < 0x7F && *end != '"' && *end != '\\';
+             end++) {
+            /* nothing */
+        }
+        if (end != ptr) {
+            g_string_append_len(writer->contents, ptr, end - ptr);
+            continue;
+        }
+
         cp = mod_utf8_codepoint(ptr, 6, &end);
         switch (cp) {
         case '\"':
@@ -212,16 +223,35 @@ void json_writer_null(JSONWriter *writer, const char *name)
     g_string_append(writer->contents, "null");
 }
 
+/*
+ * Numbers dominate the output of statistics queries; format them without
+ * going through the printf machinery.
+ */
+static void append_uint64(JSONWriter *writer, uint64_t val, bool negative)
+{
+    char buf[21];
+    char *p = buf + sizeof(buf);
+
+    do {
+        *--p = '0' + val % 10;
+        val /= 10;
+    } while (val);
+    if (negative) {
+        *--p = '-';
+    }
+    g_string_append_len(writer->contents, p, buf + sizeof(buf) - p);
+}
+
 void json_writer_int64(JSONWriter *writer, const char *name, int64_t val)
 {
     maybe_comma_name(writer, name);
-    g_string_append_printf(writer->contents, "%" PRId64, val);
+    append_uint64(writer, val < 0 ? -(uint64_t)val : val, val < 0);
 }
 
 void json_writer_uint64(JSONWriter *writer, const char *name, uint64_t val)
 {
     maybe_comma_name(writer, name);
-    g_string_append_printf(writer->contents, "%" PRIu64, val);
+    append_uint64(writer, val, false);
 }
 
 void json_writer_double(JSONWriter *writer, const char *name, double val)
@@ -13,6 +13,7 @@
 #include "system/replay.h"
 #include "system/runstate.h"
 #include "replay-internal.h"
+#include "qemu/bswap.h"
 #include "qemu/error-report.h"
 #include "qemu/main-loop.h"
 #include "trace.h"
@@ -54,6 +55,16 @@ static void replay_putc(uint8_t byte)
     }
 }
 
+/* Write a big-endian multi-byte value with a single stdio call */
+static void replay_put_bytes(const uint8_t *buf, size_t size)
+{
+    if (replay_file) {
+        if (fwrite(buf, 1, size, replay_file) != size) {
+            replay_write_error();
+        }
+    }
+}
+
 void replay_put_byte(uint8_t byte)
 {
     trace_replay_put_byte(byte);
@@ -70,29 +81,29 @@ void replay_put_event(uint8_t event)
 
 void replay_put_word(uint16_t word)
 {
+    uint8_t buf[2];
+
     trace_replay_put_word(word);
-    replay_putc(word >> 8);
-    replay_putc(word);
+    stw_be_p(buf, word);
+    replay_put_bytes(buf, sizeof(buf));
 }
 
 void replay_put_dword(uint32_t dword)
 {
-    int i;
+    uint8_t buf[4];
 
     trace_replay_put_dword(dword);
-    for (i = 24; i >= 0; i -= 8) {
-        replay_putc(dword >> i);
-    }
+    stl_be_p(buf, dword);
+    replay_put_bytes(buf, sizeof(buf));
 }
 
 void replay_put_qword(int64_t qword)
 {
-    int i;
+    uint8_t buf[8];
 
     trace_replay_put_qword(qword);
-    for (i = 56; i >= 0; i -= 8) {
-        replay_putc(qword >> i);
-    }
+    stq_be_p(buf, qword);
+    replay_put_bytes(buf, sizeof(buf));
 }
 
 void replay_put_array(const uint8_t *buf, size_t size)
@@ -137,15 +148,21 @@ uint16_t replay_get_word(void)
     return word;
 }
 
+static void replay_get_bytes(uint8_t *buf, size_t size)
+{
+    if (fread(buf, 1, size, replay_file) != size) {
+        replay_read_error();
+    }
+}
+
 uint32_t replay_get_dword(void)
 {
     uint32_t dword = 0;
-    int i;
+    uint8_t buf[4];
 
     if (replay_file) {
-        for (i = 24; i >= 0; i -= 8) {
-            dword |= replay_getc() << i;
-        }
+        replay_get_bytes(buf, sizeof(buf));
+        dword = ldl_be_p(buf);
     }
 
     trace_replay_get_dword(dword);
@@ -155,12 +172,11 @@ uint32_t replay_get_dword(void)
 int64_t replay_get_qword(void)
 {
     uint64_t qword = 0;
-    int i;
+    uint8_t buf[8];
 
     if (replay_file) {
-        for (i = 56; i >= 0; i -= 8) {
-            qword |= (uint64_t)replay_getc() << i;
-        }
+        replay_get_bytes(buf, sizeof(buf));
+        qword = ldq_be_p(buf);
     }
 
     trace_replay_get_qword(qword);
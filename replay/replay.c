@@ -17,6 +17,7 @@
 #include "replay-internal.h"
 #include "qemu/main-loop.h"
 #include "qemu/option.h"
+#include "qemu/units.h"
 #include "system/cpus.h"
 #include "qemu/error-report.h"
 
@@ -25,6 +26,7 @@
 #define REPLAY_VERSION              0xe0200c
 /* Size of replay log header */
 #define HEADER_SIZE                 (sizeof(uint32_t) + sizeof(uint64_t))
+#define REPLAY_FILE_BUF_SIZE        (1 * MiB)
 
 ReplayMode replay_mode = REPLAY_MODE_NONE;
 char *replay_snapshot;
@@ -362,6 +364,11 @@ static void replay_enable(const char *fname, int mode)
         fprintf(stderr, "Replay: open %s: %s\n", fname, strerror(errno));
         exit(1);
     }
+    /*
+     * Events are written and read a few bytes at a time; a large stdio
+     * buffer keeps that from turning into frequent small syscalls.
+     */
+    setvbuf(replay_file, NULL, _IOFBF, REPLAY_FILE_BUF_SIZE);
 
     replay_filename = g_strdup(fname);
     replay_mode = mode;
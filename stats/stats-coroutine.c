@@ -0,0 +1,87 @@
+/*
+ * Coroutine pool statistics for query-stats
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or
+ * (at your option) any later version.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/coroutine.h"
+#include "system/stats.h"
+
+static StatsList *coroutine_stats_add(StatsList *list, strList *names,
+                                      const char *name, uint64_t value)
+{
+    Stats *stats;
+
+    if (!apply_str_list_filter(name, names)) {
+        return list;
+    }
+
+    stats = g_new0(Stats, 1);
+    stats->name = g_strdup(name);
+    stats->value = g_new0(StatsValue, 1);
+    stats->value->type = QTYPE_QNUM;
+    stats->value->u.scalar = value;
+
+    QAPI_LIST_PREPEND(list, stats);
+    return list;
+}
+
+static void coroutine_stats_cb(StatsResultList **result, StatsTarget target,
+                               strList *names, strList *targets, Error **errp)
+{
+    StatsList *stats_list = NULL;
+    CoroutinePoolStats pool;
+
+    if (target != STATS_TARGET_VM) {
+        return;
+    }
+
+    qemu_coroutine_get_pool_stats(&pool);
+    stats_list = coroutine_stats_add(stats_list, names, "global-pool-size",
+                                     pool.global_pool_size);
+    stats_list = coroutine_stats_add(stats_list, names, "stacks-released",
+                                     pool.stacks_released);
+    stats_list = coroutine_stats_add(stats_list, names, "pool-refills",
+                                     pool.refills);
+    stats_list = coroutine_stats_add(stats_list, names, "deleted",
+                                     pool.deleted);
+    stats_list = coroutine_stats_add(stats_list, names, "created",
+                                     pool.created);
+
+    if (stats_list) {
+        add_stats_entry(result, STATS_PROVIDER_COROUTINE, NULL, stats_list);
+    }
+}
+
+static StatsSchemaValueList *coroutine_schema_add(StatsSchemaValueList *list,
+                                                  const char *name,
+                                                  StatsType type)
+{
+    StatsSchemaValue *value = g_new0(StatsSchemaValue, 1);
+
+    value->name = g_strdup(name);
+    value->type = type;
+    QAPI_LIST_PREPEND(list, value);
+    return list;
+}
+
+static void coroutine_stats_schemas_cb(StatsSchemaList **result, Error **errp)
+{
+    StatsSchemaValueList *list = NULL;
+
+    list = coroutine_schema_add(list, "global-pool-size", STATS_TYPE_INSTANT);
+    list = coroutine_schema_add(list, "stacks-released",
+                                STATS_TYPE_CUMULATIVE);
+    list = coroutine_schema_add(list, "pool-refills", STATS_TYPE_CUMULATIVE);
+    list = coroutine_schema_add(list, "deleted", STATS_TYPE_CUMULATIVE);
+    list = coroutine_schema_add(list, "created", STATS_TYPE_CUMULATIVE);
+    add_stats_schema(result, STATS_PROVIDER_COROUTINE, STATS_TARGET_VM, list);
+}
+
+static void __attribute__((__constructor__)) coroutine_stats_init(void)
+{
+    add_oob_stats_callbacks(STATS_PROVIDER_COROUTINE, coroutine_stats_cb,
+                            coroutine_stats_schemas_cb);
+}
@@ -91,6 +91,9 @@ static void print_stats_results(Monitor *mon, StatsTarget target,
         monitor_printf(mon, "provider: %s\n",
                        StatsProvider_str(result->provider));
     }
+    if (result->call_site) {
+        monitor_printf(mon, "call site: %s\n", result->call_site);
+    }
 
     for (stats_list = result->stats; stats_list;
              stats_list = stats_list->next,
@@ -156,6 +159,10 @@ static StatsFilter *stats_filter(StatsTarget target, const char *names,
         break;
     }
     case STATS_TARGET_CRYPTODEV:
+    case STATS_TARGET_IOTHREAD:
+    case STATS_TARGET_MEMORY_REGION:
+    case STATS_TARGET_LOCK_CALL_SITE:
+    case STATS_TARGET_DEVICE:
         break;
     default:
         break;
@@ -229,6 +236,10 @@ void hmp_info_stats(Monitor *mon, const QDict *qdict)
         filter = stats_filter(target, names, cpu_index, provider);
         break;
     case STATS_TARGET_CRYPTODEV:
+    case STATS_TARGET_IOTHREAD:
+    case STATS_TARGET_MEMORY_REGION:
+    case STATS_TARGET_LOCK_CALL_SITE:
+    case STATS_TARGET_DEVICE:
         filter = stats_filter(target, names, -1, provider);
         break;
     default:
@@ -0,0 +1,225 @@
+/*
+ * IOThread and main loop statistics for query-stats
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or
+ * (at your option) any later version.
+ */
+
+#include "qemu/osdep.h"
+#include "block/aio.h"
+#include "block/thread-pool.h"
+#include "qemu/main-loop.h"
+#include "qom/object.h"
+#include "system/iothread.h"
+#include "system/stats.h"
+
+static StatsList *iothread_stats_add(StatsList *list, strList *names,
+                                     const char *name, uint64_t value)
+{
+    Stats *stats;
+
+    if (!apply_str_list_filter(name, names)) {
+        return list;
+    }
+
+    stats = g_new0(Stats, 1);
+    stats->name = g_strdup(name);
+    stats->value = g_new0(StatsValue, 1);
+    stats->value->type = QTYPE_QNUM;
+    stats->value->u.scalar = value;
+
+    QAPI_LIST_PREPEND(list, stats);
+    return list;
+}
+
+static StatsList *aio_handler_stats_add(StatsList *list, strList *names,
+                                        AioContext *ctx)
+{
+    AioHandlerStats *st = &ctx->handler_stats;
+
+    if (!qatomic_read(&ctx->handler_stats_enabled)) {
+        return list;
+    }
+
+    if (apply_str_list_filter("loop-latency", names)) {
+        Stats *stats = g_new0(Stats, 1);
+        uint64List *buckets = NULL;
+        int i;
+
+        for (i = AIO_LOOP_HIST_BUCKETS - 1; i >= 0; i--) {
+            QAPI_LIST_PREPEND(buckets, stat64_get(&st->loop_us[i]));
+        }
+        stats->name = g_strdup("loop-latency");
+        stats->value = g_new0(StatsValue, 1);
+        stats->value->type = QTYPE_QLIST;
+        stats->value->u.list = buckets;
+        QAPI_LIST_PREPEND(list, stats);
+    }
+    list = iothread_stats_add(list, names, "loop-iterations",
+                              stat64_get(&st->iterations));
+    list = iothread_stats_add(list, names, "handler-max-ns",
+                              stat64_get(&st->handler_max_ns));
+    list = iothread_stats_add(list, names, "fd-handler-ns",
+                              stat64_get(&st->fd_ns));
+    list = iothread_stats_add(list, names, "fd-handler-runs",
+                              stat64_get(&st->fd_runs));
+    list = iothread_stats_add(list, names, "bh-ns",
+                              stat64_get(&st->bh_ns));
+    list = iothread_stats_add(list, names, "bh-runs",
+                              stat64_get(&st->bh_runs));
+    return list;
+}
+
+typedef struct {
+    StatsResultList **result;
+    strList *names;
+} IOThreadStatsArgs;
+
+static int iothread_stats_one(Object *object, void *opaque)
+{
+    IOThreadStatsArgs *args = opaque;
+    StatsList *stats_list = NULL;
+    IOThread *iothread;
+    AioContext *ctx;
+    ThreadPoolAio *pool;
+
+    iothread = (IOThread *)object_dynamic_cast(object, TYPE_IOTHREAD);
+    if (!iothread) {
+        return 0;
+    }
+
+    ctx = iothread_get_aio_context(iothread);
+    if (!ctx) {
+        return 0;
+    }
+
+#ifdef CONFIG_LINUX_IO_URING
+    {
+        AioIoUringStats *st = &ctx->io_uring_stats;
+
+        stats_list = iothread_stats_add(stats_list, args->names,
+                                        "io-uring-sq-full",
+                                        stat64_get(&st->sq_full));
+        stats_list = iothread_stats_add(stats_list, args->names,
+                                        "io-uring-cq-overflow",
+                                        stat64_get(&st->cq_overflow));
+        stats_list = iothread_stats_add(stats_list, args->names,
+                                        "io-uring-wait",
+                                        stat64_get(&st->wait));
+    }
+#endif
+
+    pool = qatomic_read(&ctx->thread_pool);
+    if (pool) {
+        ThreadPoolStats st;
+
+        thread_pool_get_stats(pool, &st);
+        stats_list = iothread_stats_add(stats_list, args->names,
+                                        "thread-pool-requests", st.requests);
+        stats_list = iothread_stats_add(stats_list, args->names,
+                                        "thread-pool-wait-ns", st.wait_ns);
+        stats_list = iothread_stats_add(stats_list, args->names,
+                                        "thread-pool-queued", st.queued);
+    }
+
+    stats_list = aio_handler_stats_add(stats_list, args->names, ctx);
+
+    if (stats_list) {
+        g_autofree char *path = object_get_canonical_path(object);
+        add_stats_entry(args->result, STATS_PROVIDER_AIO, path, stats_list);
+    }
+    return 0;
+}
+
+static void iothread_stats_cb(StatsResultList **result, StatsTarget target,
+                              strList *names, strList *targets, Error **errp)
+{
+    IOThreadStatsArgs args = {
+        .result = result,
+        .names = names,
+    };
+
+    if (target == STATS_TARGET_VM) {
+        StatsList *stats_list = aio_handler_stats_add(NULL, names,
+                                                      qemu_get_aio_context());
+
+        if (stats_list) {
+            add_stats_entry(result, STATS_PROVIDER_AIO, NULL, stats_list);
+        }
+        return;
+    }
+    if (target != STATS_TARGET_IOTHREAD) {
+        return;
+    }
+
+    object_child_foreach(object_get_objects_root(), iothread_stats_one,
+                         &args);
+}
+
+static StatsSchemaValueList *iothread_schema_add(StatsSchemaValueList *list,
+                                                 const char *name,
+                                                 StatsType type)
+{
+    StatsSchemaValue *value = g_new0(StatsSchemaValue, 1);
+
+    value->name = g_strdup(name);
+    value->type = type;
+    QAPI_LIST_PREPEND(list, value);
+    return list;
+}
+
+static StatsSchemaValueList *
+aio_handler_schema_add(StatsSchemaValueList *list)
+{
+    StatsSchemaValue *value = g_new0(StatsSchemaValue, 1);
+
+    value->name = g_strdup("loop-latency");
+    value->type = STATS_TYPE_LOG2_HISTOGRAM;
+    value->has_unit = true;
+    value->unit = STATS_UNIT_SECONDS;
+    value->has_base = true;
+    value->base = 10;
+    value->exponent = -6;
+    QAPI_LIST_PREPEND(list, value);
+
+    list = iothread_schema_add(list, "loop-iterations",
+                               STATS_TYPE_CUMULATIVE);
+    list = iothread_schema_add(list, "handler-max-ns", STATS_TYPE_PEAK);
+    list = iothread_schema_add(list, "fd-handler-ns", STATS_TYPE_CUMULATIVE);
+    list = iothread_schema_add(list, "fd-handler-runs",
+                               STATS_TYPE_CUMULATIVE);
+    list = iothread_schema_add(list, "bh-ns", STATS_TYPE_CUMULATIVE);
+    list = iothread_schema_add(list, "bh-runs", STATS_TYPE_CUMULATIVE);
+    return list;
+}
+
+static void iothread_stats_schemas_cb(StatsSchemaList **result, Error **errp)
+{
+    StatsSchemaValueList *list = NULL;
+
+#ifdef CONFIG_LINUX_IO_URING
+    list = iothread_schema_add(list, "io-uring-sq-full",
+                               STATS_TYPE_CUMULATIVE);
+    list = iothread_schema_add(list, "io-uring-cq-overflow",
+                               STATS_TYPE_CUMULATIVE);
+    list = iothread_schema_add(list, "io-uring-wait", STATS_TYPE_CUMULATIVE);
+#endif
+    list = iothread_schema_add(list, "thread-pool-requests",
+                               STATS_TYPE_CUMULATIVE);
+    list = iothread_schema_add(list, "thread-pool-wait-ns",
+                               STATS_TYPE_CUMULATIVE);
+    list = iothread_schema_add(list, "thread-pool-queued",
+                               STATS_TYPE_INSTANT);
+    list = aio_handler_schema_add(list);
+
+    add_stats_schema(result, STATS_PROVIDER_AIO, STATS_TARGET_IOTHREAD, list);
+
+    list = aio_handler_schema_add(NULL);
+    add_stats_schema(result, STATS_PROVIDER_AIO, STATS_TARGET_VM, list);
+}
+
+static void __attribute__((__constructor__)) iothread_stats_init(void)
+{
+    add_stats_callbacks(STATS_PROVIDER_AIO, iothread_stats_cb,
+                        iothread_stats_schemas_cb);
+}
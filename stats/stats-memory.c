@@ -0,0 +1,116 @@
+/*
+ * Memory region statistics for query-stats
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or
+ * (at your option) any later version.
+ */
+
+#include "qemu/osdep.h"
+#include "qom/object.h"
+#include "system/memory.h"
+#include "system/stats.h"
+
+static StatsList *memory_stats_add(StatsList *list, strList *names,
+                                   const char *name, uint64_t value)
+{
+    Stats *stats;
+
+    if (!apply_str_list_filter(name, names)) {
+        return list;
+    }
+
+    stats = g_new0(Stats, 1);
+    stats->name = g_strdup(name);
+    stats->value = g_new0(StatsValue, 1);
+    stats->value->type = QTYPE_QNUM;
+    stats->value->u.scalar = value;
+
+    QAPI_LIST_PREPEND(list, stats);
+    return list;
+}
+
+typedef struct {
+    StatsResultList **result;
+    strList *names;
+} MemoryStatsArgs;
+
+static int memory_stats_one(Object *object, void *opaque)
+{
+    MemoryStatsArgs *args = opaque;
+    StatsList *stats_list = NULL;
+    uint64_t reads, writes;
+    MemoryRegion *mr;
+
+    mr = (MemoryRegion *)object_dynamic_cast(object, TYPE_MEMORY_REGION);
+    if (!mr) {
+        return 0;
+    }
+
+    /* Only report the regions that were actually accessed */
+    reads = stat64_get(&mr->dispatch_reads);
+    writes = stat64_get(&mr->dispatch_writes);
+    if (!reads && !writes) {
+        return 0;
+    }
+
+    stats_list = memory_stats_add(stats_list, args->names, "bql-wait-ns",
+                                  stat64_get(&mr->bql_wait_ns));
+    stats_list = memory_stats_add(stats_list, args->names, "bql-contended",
+                                  stat64_get(&mr->bql_contended));
+    stats_list = memory_stats_add(stats_list, args->names, "bql-acquisitions",
+                                  stat64_get(&mr->bql_acquisitions));
+    stats_list = memory_stats_add(stats_list, args->names, "writes", writes);
+    stats_list = memory_stats_add(stats_list, args->names, "reads", reads);
+
+    if (stats_list) {
+        g_autofree char *path = object_get_canonical_path(object);
+        add_stats_entry(args->result, STATS_PROVIDER_MEMORY, path, stats_list);
+    }
+    return 0;
+}
+
+static void memory_stats_cb(StatsResultList **result, StatsTarget target,
+                            strList *names, strList *targets, Error **errp)
+{
+    MemoryStatsArgs args = {
+        .result = result,
+        .names = names,
+    };
+
+    if (target != STATS_TARGET_MEMORY_REGION) {
+        return;
+    }
+
+    object_child_foreach_recursive(object_get_root(), memory_stats_one,
+                                   &args);
+}
+
+static StatsSchemaValueList *memory_schema_add(StatsSchemaValueList *list,
+                                               const char *name)
+{
+    StatsSchemaValue *value = g_new0(StatsSchemaValue, 1);
+
+    value->name = g_strdup(name);
+    value->type = STATS_TYPE_CUMULATIVE;
+    QAPI_LIST_PREPEND(list, value);
+    return list;
+}
+
+static void memory_stats_schemas_cb(StatsSchemaList **result, Error **errp)
+{
+    StatsSchemaValueList *list = NULL;
+
+    list = memory_schema_add(list, "bql-wait-ns");
+    list = memory_schema_add(list, "bql-contended");
+    list = memory_schema_add(list, "bql-acquisitions");
+    list = memory_schema_add(list, "writes");
+    list = memory_schema_add(list, "reads");
+    add_stats_schema(result, STATS_PROVIDER_MEMORY,
+                     STATS_TARGET_MEMORY_REGION, list);
+}
+
+static void __attribute__((__constructor__)) memory_stats_init(void)
+{
+    add_stats_callbacks(STATS_PROVIDER_MEMORY, memory_stats_cb,
+                        memory_stats_schemas_cb);
+}
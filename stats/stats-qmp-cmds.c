@@ -8,31 +8,53 @@
 #include "qemu/osdep.h"
 #include "system/stats.h"
 #include "qapi/qapi-commands-stats.h"
+#include "qapi/qapi-events-stats.h"
+#include "qapi/clone-visitor.h"
+#include "qapi/qapi-visit-stats.h"
+#include "qemu/main-loop.h"
 #include "qemu/queue.h"
+#include "qemu/timer.h"
 #include "qapi/error.h"
 
 typedef struct StatsCallbacks {
     StatsProvider provider;
     StatRetrieveFunc *stats_cb;
     SchemaRetrieveFunc *schemas_cb;
+    bool oob_safe;
     QTAILQ_ENTRY(StatsCallbacks) next;
 } StatsCallbacks;
 
 static QTAILQ_HEAD(, StatsCallbacks) stats_callbacks =
     QTAILQ_HEAD_INITIALIZER(stats_callbacks);
 
-void add_stats_callbacks(StatsProvider provider,
-                         StatRetrieveFunc *stats_fn,
-                         SchemaRetrieveFunc *schemas_fn)
+static void do_add_stats_callbacks(StatsProvider provider,
+                                   StatRetrieveFunc *stats_fn,
+                                   SchemaRetrieveFunc *schemas_fn,
+                                   bool oob_safe)
 {
     StatsCallbacks *entry = g_new(StatsCallbacks, 1);
     entry->provider = provider;
     entry->stats_cb = stats_fn;
     entry->schemas_cb = schemas_fn;
+    entry->oob_safe = oob_safe;
 
     QTAILQ_INSERT_TAIL(&stats_callbacks, entry, next);
 }
 
+void add_stats_callbacks(StatsProvider provider,
+                         StatRetrieveFunc *stats_fn,
+                         SchemaRetrieveFunc *schemas_fn)
+{
+    do_add_stats_callbacks(provider, stats_fn, schemas_fn, false);
+}
+
+void add_oob_stats_callbacks(StatsProvider provider,
+                             StatRetrieveFunc *stats_fn,
+                             SchemaRetrieveFunc *schemas_fn)
+{
+    do_add_stats_callbacks(provider, stats_fn, schemas_fn, true);
+}
+
 static bool invoke_stats_cb(StatsCallbacks *entry,
                             StatsResultList **stats_results,
                             StatsFilter *filter, StatsRequest *request,
@@ -52,6 +74,21 @@ static bool invoke_stats_cb(StatsCallbacks *entry,
         names = request->has_names ? request->names : NULL;
     }
 
+    /*
+     * Out-of-band execution runs in the monitor I/O thread without the BQL;
+     * only providers that do not need it can be queried there.
+     */
+    if (!bql_locked() && !entry->oob_safe) {
+        if (request) {
+            error_setg(errp, "Statistics provider '%s' cannot be queried "
+                       "out-of-band", StatsProvider_str(entry->provider));
+            qapi_free_StatsResultList(*stats_results);
+            *stats_results = NULL;
+            return false;
+        }
+        return true;
+    }
+
     switch (filter->target) {
     case STATS_TARGET_VM:
         break;
@@ -65,6 +102,10 @@ static bool invoke_stats_cb(StatsCallbacks *entry,
         }
         break;
     case STATS_TARGET_CRYPTODEV:
+    case STATS_TARGET_IOTHREAD:
+    case STATS_TARGET_MEMORY_REGION:
+    case STATS_TARGET_LOCK_CALL_SITE:
+    case STATS_TARGET_DEVICE:
         break;
     default:
         abort();
@@ -103,6 +144,161 @@ StatsResultList *qmp_query_stats(StatsFilter *filter, Error **errp)
     return stats_results;
 }
 
+typedef struct StatsSubscription {
+    char *id;
+    StatsFilter *filter;
+    QEMUTimer *timer;
+    uint32_t interval;
+    /* Last reported value of each statistic, keyed by stats_key() */
+    GHashTable *last;
+    QTAILQ_ENTRY(StatsSubscription) next;
+} StatsSubscription;
+
+static QTAILQ_HEAD(, StatsSubscription) stats_subscriptions =
+    QTAILQ_HEAD_INITIALIZER(stats_subscriptions);
+
+static char *stats_key(StatsResult *result, Stats *stats)
+{
+    return g_strdup_printf("%s/%s/%s", StatsProvider_str(result->provider),
+                           result->qom_path ?: result->call_site ?: "",
+                           stats->name);
+}
+
+static char *stats_value_str(StatsValue *value)
+{
+    GString *str = g_string_new("");
+    uint64List *list;
+
+    switch (value->type) {
+    case QTYPE_QNUM:
+        g_string_append_printf(str, "%" PRIu64, value->u.scalar);
+        break;
+    case QTYPE_QBOOL:
+        g_string_append(str, value->u.boolean ? "true" : "false");
+        break;
+    case QTYPE_QLIST:
+        for (list = value->u.list; list; list = list->next) {
+            g_string_append_printf(str, "%" PRIu64 ",", list->value);
+        }
+        break;
+    default:
+        abort();
+    }
+    return g_string_free(str, false);
+}
+
+/*
+ * Drop the statistics that did not change since the last event from
+ * @results, as well as the results that become empty.
+ */
+static StatsResultList *stats_subscription_filter(StatsSubscription *sub,
+                                                  StatsResultList *results)
+{
+    StatsResultList **result_tail = &results;
+
+    while (*result_tail) {
+        StatsResultList *result = *result_tail;
+        StatsList **tail = &result->value->stats;
+
+        while (*tail) {
+            StatsList *stats = *tail;
+            char *key = stats_key(result->value, stats->value);
+            char *value = stats_value_str(stats->value->value);
+            const char *last = g_hash_table_lookup(sub->last, key);
+
+            if (last && g_str_equal(last, value)) {
+                *tail = stats->next;
+                stats->next = NULL;
+                qapi_free_StatsList(stats);
+                g_free(key);
+                g_free(value);
+            } else {
+                g_hash_table_replace(sub->last, key, value);
+                tail = &stats->next;
+            }
+        }
+
+        if (!result->value->stats) {
+            *result_tail = result->next;
+            result->next = NULL;
+            qapi_free_StatsResultList(result);
+        } else {
+            result_tail = &result->next;
+        }
+    }
+    return results;
+}
+
+static void stats_subscription_timer(void *opaque)
+{
+    StatsSubscription *sub = opaque;
+    StatsResultList *results;
+
+    results = qmp_query_stats(sub->filter, NULL);
+    results = stats_subscription_filter(sub, results);
+    if (results) {
+        qapi_event_send_stats(sub->id, results);
+        qapi_free_StatsResultList(results);
+    }
+    timer_mod(sub->timer,
+              qemu_clock_get_ms(QEMU_CLOCK_REALTIME) + sub->interval);
+}
+
+static StatsSubscription *stats_subscription_find(const char *id)
+{
+    StatsSubscription *sub;
+
+    QTAILQ_FOREACH(sub, &stats_subscriptions, next) {
+        if (g_str_equal(sub->id, id)) {
+            return sub;
+        }
+    }
+    return NULL;
+}
+
+void qmp_stats_subscribe(const char *id, uint32_t interval,
+                         StatsFilter *filter, Error **errp)
+{
+    StatsSubscription *sub;
+
+    if (stats_subscription_find(id)) {
+        error_setg(errp, "Stats subscription '%s' already exists", id);
+        return;
+    }
+    if (!interval) {
+        error_setg(errp, "Parameter 'interval' must be positive");
+        return;
+    }
+
+    sub = g_new0(StatsSubscription, 1);
+    sub->id = g_strdup(id);
+    sub->filter = QAPI_CLONE(StatsFilter, filter);
+    sub->interval = interval;
+    sub->last = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                      g_free, g_free);
+    sub->timer = timer_new_ms(QEMU_CLOCK_REALTIME, stats_subscription_timer,
+                              sub);
+    QTAILQ_INSERT_TAIL(&stats_subscriptions, sub, next);
+    timer_mod(sub->timer, qemu_clock_get_ms(QEMU_CLOCK_REALTIME) + interval);
+}
+
+void qmp_stats_unsubscribe(const char *id, Error **errp)
+{
+    StatsSubscription *sub = stats_subscription_find(id);
+
+    if (!sub) {
+        error_setg(errp, "Stats subscription '%s' not found", id);
+        return;
+    }
+
+    QTAILQ_REMOVE(&stats_subscriptions, sub, next);
+    timer_free(sub->timer);
+    g_hash_table_destroy(sub->last);
+    qapi_free_StatsFilter(sub->filter);
+    g_free(sub->id);
+    g_free(sub);
+}
+
 StatsSchemaList *qmp_query_stats_schemas(bool has_provider,
                                          StatsProvider provider,
                                          Error **errp)
@@ -113,6 +309,15 @@ StatsSchemaList *qmp_query_stats_schemas(bool has_provider,
 
     QTAILQ_FOREACH(entry, &stats_callbacks, next) {
         if (!has_provider || provider == entry->provider) {
+            if (!bql_locked() && !entry->oob_safe) {
+                if (!has_provider) {
+                    continue;
+                }
+                error_setg(errp, "Statistics provider '%s' cannot be queried "
+                           "out-of-band", StatsProvider_str(entry->provider));
+                qapi_free_StatsSchemaList(stats_results);
+                return NULL;
+            }
             entry->schemas_cb(&stats_results, errp);
             if (*errp) {
                 qapi_free_StatsSchemaList(stats_results);
@@ -136,6 +341,19 @@ void add_stats_entry(StatsResultList **stats_results, StatsProvider provider,
     QAPI_LIST_PREPEND(*stats_results, entry);
 }
 
+void add_stats_call_site_entry(StatsResultList **stats_results,
+                               StatsProvider provider, const char *call_site,
+                               StatsList *stats_list)
+{
+    StatsResult *entry = g_new0(StatsResult, 1);
+
+    entry->provider = provider;
+    entry->call_site = g_strdup(call_site);
+    entry->stats = stats_list;
+
+    QAPI_LIST_PREPEND(*stats_results, entry);
+}
+
 void add_stats_schema(StatsSchemaList **schema_results,
                       StatsProvider provider, StatsTarget target,
                       StatsSchemaValueList *stats_list)
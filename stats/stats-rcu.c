@@ -0,0 +1,87 @@
+/*
+ * RCU grace period and call_rcu() statistics for query-stats
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or
+ * (at your option) any later version.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/rcu.h"
+#include "system/stats.h"
+
+static StatsList *rcu_stats_add(StatsList *list, strList *names,
+                                const char *name, uint64_t value)
+{
+    Stats *stats;
+
+    if (!apply_str_list_filter(name, names)) {
+        return list;
+    }
+
+    stats = g_new0(Stats, 1);
+    stats->name = g_strdup(name);
+    stats->value = g_new0(StatsValue, 1);
+    stats->value->type = QTYPE_QNUM;
+    stats->value->u.scalar = value;
+
+    QAPI_LIST_PREPEND(list, stats);
+    return list;
+}
+
+static void rcu_stats_cb(StatsResultList **result, StatsTarget target,
+                         strList *names, strList *targets, Error **errp)
+{
+    StatsList *stats_list = NULL;
+    RCUStats rcu;
+
+    if (target != STATS_TARGET_VM) {
+        return;
+    }
+
+    rcu_get_stats(&rcu);
+    stats_list = rcu_stats_add(stats_list, names, "callbacks-pending",
+                               rcu.callbacks_pending);
+    stats_list = rcu_stats_add(stats_list, names, "callback-backlog-peak",
+                               rcu.callback_backlog_peak);
+    stats_list = rcu_stats_add(stats_list, names, "callbacks",
+                               rcu.callbacks);
+    stats_list = rcu_stats_add(stats_list, names, "forced-grace-periods",
+                               rcu.forced_grace_periods);
+    stats_list = rcu_stats_add(stats_list, names, "grace-periods",
+                               rcu.grace_periods);
+
+    if (stats_list) {
+        add_stats_entry(result, STATS_PROVIDER_RCU, NULL, stats_list);
+    }
+}
+
+static StatsSchemaValueList *rcu_schema_add(StatsSchemaValueList *list,
+                                            const char *name,
+                                            StatsType type)
+{
+    StatsSchemaValue *value = g_new0(StatsSchemaValue, 1);
+
+    value->name = g_strdup(name);
+    value->type = type;
+    QAPI_LIST_PREPEND(list, value);
+    return list;
+}
+
+static void rcu_stats_schemas_cb(StatsSchemaList **result, Error **errp)
+{
+    StatsSchemaValueList *list = NULL;
+
+    list = rcu_schema_add(list, "callbacks-pending", STATS_TYPE_INSTANT);
+    list = rcu_schema_add(list, "callback-backlog-peak", STATS_TYPE_PEAK);
+    list = rcu_schema_add(list, "callbacks", STATS_TYPE_CUMULATIVE);
+    list = rcu_schema_add(list, "forced-grace-periods",
+                          STATS_TYPE_CUMULATIVE);
+    list = rcu_schema_add(list, "grace-periods", STATS_TYPE_CUMULATIVE);
+    add_stats_schema(result, STATS_PROVIDER_RCU, STATS_TARGET_VM, list);
+}
+
+static void __attribute__((__constructor__)) rcu_stats_init(void)
+{
+    add_oob_stats_callbacks(STATS_PROVIDER_RCU, rcu_stats_cb,
+                            rcu_stats_schemas_cb);
+}
@@ -0,0 +1,74 @@
+/*
+ * Slab allocator statistics for query-stats
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or
+ * (at your option) any later version.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/slab.h"
+#include "system/stats.h"
+
+static StatsList *slab_stats_add(StatsList *list, strList *names,
+                                 const char *name, uint64_t value)
+{
+    Stats *stats;
+
+    if (!apply_str_list_filter(name, names)) {
+        return list;
+    }
+
+    stats = g_new0(Stats, 1);
+    stats->name = g_strdup(name);
+    stats->value = g_new0(StatsValue, 1);
+    stats->value->type = QTYPE_QNUM;
+    stats->value->u.scalar = value;
+
+    QAPI_LIST_PREPEND(list, stats);
+    return list;
+}
+
+static void slab_stats_cb(StatsResultList **result, StatsTarget target,
+                          strList *names, strList *targets, Error **errp)
+{
+    StatsList *stats_list = NULL;
+    uint64_t hits, misses;
+
+    if (target != STATS_TARGET_VM) {
+        return;
+    }
+
+    qemu_slab_get_stats(&hits, &misses);
+    stats_list = slab_stats_add(stats_list, names, "misses", misses);
+    stats_list = slab_stats_add(stats_list, names, "hits", hits);
+
+    if (stats_list) {
+        add_stats_entry(result, STATS_PROVIDER_SLAB, NULL, stats_list);
+    }
+}
+
+static StatsSchemaValueList *slab_schema_add(StatsSchemaValueList *list,
+                                             const char *name)
+{
+    StatsSchemaValue *value = g_new0(StatsSchemaValue, 1);
+
+    value->name = g_strdup(name);
+    value->type = STATS_TYPE_CUMULATIVE;
+    QAPI_LIST_PREPEND(list, value);
+    return list;
+}
+
+static void slab_stats_schemas_cb(StatsSchemaList **result, Error **errp)
+{
+    StatsSchemaValueList *list = NULL;
+
+    list = slab_schema_add(list, "misses");
+    list = slab_schema_add(list, "hits");
+    add_stats_schema(result, STATS_PROVIDER_SLAB, STATS_TARGET_VM, list);
+}
+
+static void __attribute__((__constructor__)) slab_stats_init(void)
+{
+    add_oob_stats_callbacks(STATS_PROVIDER_SLAB, slab_stats_cb,
+                            slab_stats_schemas_cb);
+}
@@ -0,0 +1,108 @@
+/*
+ * Synchronization profiler statistics for query-stats
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or
+ * (at your option) any later version.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/thread.h"
+#include "system/stats.h"
+
+/* only report the call sites with the longest total wait time */
+#define SYNC_PROFILE_MAX_CALL_SITES 64
+
+typedef struct {
+    StatsResultList **result;
+    strList *names;
+} SyncProfileStatsArgs;
+
+static StatsList *sync_profile_stats_add(StatsList *list, strList *names,
+                                         const char *name, uint64_t value)
+{
+    Stats *stats;
+
+    if (!apply_str_list_filter(name, names)) {
+        return list;
+    }
+
+    stats = g_new0(Stats, 1);
+    stats->name = g_strdup(name);
+    stats->value = g_new0(StatsValue, 1);
+    stats->value->type = QTYPE_QNUM;
+    stats->value->u.scalar = value;
+
+    QAPI_LIST_PREPEND(list, stats);
+    return list;
+}
+
+static void sync_profile_stats_one(void *opaque, const char *call_site,
+                                   const char *type, uint64_t wait_ns,
+                                   uint64_t n_acqs)
+{
+    SyncProfileStatsArgs *args = opaque;
+    StatsList *stats_list = NULL;
+
+    stats_list = sync_profile_stats_add(stats_list, args->names,
+                                        "acquisitions", n_acqs);
+    stats_list = sync_profile_stats_add(stats_list, args->names,
+                                        "wait-ns", wait_ns);
+
+    if (stats_list) {
+        add_stats_call_site_entry(args->result, STATS_PROVIDER_SYNC_PROFILE,
+                                  call_site, stats_list);
+    }
+}
+
+static void sync_profile_stats_cb(StatsResultList **result,
+                                  StatsTarget target, strList *names,
+                                  strList *targets, Error **errp)
+{
+    SyncProfileStatsArgs args = {
+        .result = result,
+        .names = names,
+    };
+
+    if (target != STATS_TARGET_LOCK_CALL_SITE || !qsp_is_enabled()) {
+        return;
+    }
+
+    qsp_foreach_call_site(SYNC_PROFILE_MAX_CALL_SITES,
+                          sync_profile_stats_one, &args);
+}
+
+static StatsSchemaValueList *
+sync_profile_schema_add(StatsSchemaValueList *list, const char *name,
+                        bool nanoseconds)
+{
+    StatsSchemaValue *value = g_new0(StatsSchemaValue, 1);
+
+    value->name = g_strdup(name);
+    value->type = STATS_TYPE_CUMULATIVE;
+    if (nanoseconds) {
+        value->has_unit = true;
+        value->unit = STATS_UNIT_SECONDS;
+        value->has_base = true;
+        value->base = 10;
+        value->exponent = -9;
+    }
+    QAPI_LIST_PREPEND(list, value);
+    return list;
+}
+
+static void sync_profile_stats_schemas_cb(StatsSchemaList **result,
+                                          Error **errp)
+{
+    StatsSchemaValueList *list = NULL;
+
+    list = sync_profile_schema_add(list, "acquisitions", false);
+    list = sync_profile_schema_add(list, "wait-ns", true);
+    add_stats_schema(result, STATS_PROVIDER_SYNC_PROFILE,
+                     STATS_TARGET_LOCK_CALL_SITE, list);
+}
+
+static void __attribute__((__constructor__)) sync_profile_stats_init(void)
+{
+    add_oob_stats_callbacks(STATS_PROVIDER_SYNC_PROFILE, sync_profile_stats_cb,
+                            sync_profile_stats_schemas_cb);
+}
@@ -523,7 +523,7 @@ static int vduse_queue_read_next_desc(struct vring_desc *desc, int i,
  * Fetch avail_idx from VQ memory only when we really need to know if
  * guest has added some buffers.
  */
-static bool vduse_queue_empty(VduseVirtq *vq)
+bool vduse_queue_empty(VduseVirtq *vq)
 {
     if (unlikely(!vq->vring.avail)) {
         return true;
@@ -586,6 +586,27 @@ static inline void vring_set_avail_event(VduseVirtq *vq, uint16_t val)
     memcpy(&vq->vring.used->ring[vq->vring.num], &val_le, sizeof(uint16_t));
 }
 
+void vduse_queue_set_notification(VduseVirtq *vq, bool enable)
+{
+    VduseDev *dev = vq->dev;
+
+    if (unlikely(!vq->vring.avail)) {
+        return;
+    }
+
+    if (vduse_dev_has_feature(dev, VIRTIO_RING_F_EVENT_IDX)) {
+        vring_set_avail_event(vq, vring_avail_idx(vq));
+    } else if (enable) {
+        vq->vring.used->flags &= htole16(~VRING_USED_F_NO_NOTIFY);
+    } else {
+        vq->vring.used->flags |= htole16(VRING_USED_F_NO_NOTIFY);
+    }
+    if (enable) {
+        /* Expose avail event/used flags before caller checks the avail idx */
+        smp_mb();
+    }
+}
+
 static bool vduse_queue_map_single_desc(VduseVirtq *vq, unsigned int *p_num_sg,
                                    struct iovec *iov, unsigned int max_num_sg,
                                    bool is_write, uint64_t pa, size_t sz)
@@ -106,6 +106,26 @@ void vduse_queue_push(VduseVirtq *vq, const VduseVirtqElement *elem,
  */
 void vduse_queue_notify(VduseVirtq *vq);
 
+/**
+ * vduse_queue_empty:
+ * @vq: specified virtqueue
+ *
+ * Check whether the driver has made new elements available.
+ *
+ * Returns: true if the available ring holds no new elements.
+ */
+bool vduse_queue_empty(VduseVirtq *vq);
+
+/**
+ * vduse_queue_set_notification:
+ * @vq: specified virtqueue
+ * @enable: whether the driver should kick the queue
+ *
+ * Ask the driver to stop (or resume) kicking the queue for new
+ * elements, e.g. while the device polls vduse_queue_empty().
+ */
+void vduse_queue_set_notification(VduseVirtq *vq, bool enable);
+
 /**
  * vduse_dev_get_priv:
  * @dev: VDUSE device
@@ -81,7 +81,7 @@ bool cpu_is_stopped(CPUState *cpu)
 
 bool cpu_work_list_empty(CPUState *cpu)
 {
-    return QSIMPLEQ_EMPTY_ATOMIC(&cpu->work_list);
+    return qatomic_read(&cpu->work_list.slh_first) == NULL;
 }
 
 bool cpu_thread_is_idle(CPUState *cpu)
@@ -578,6 +578,14 @@ void bql_lock_impl(const char *file, int line)
     bql_lock_fn(&bql, file, line);
 }
 
+bool bql_trylock_impl(const char *file, int line)
+{
+    QemuMutexTrylockFunc trylock_fn = qatomic_read(&qemu_mutex_trylock_func);
+
+    g_assert(!bql_locked());
+    return trylock_fn(&bql, file, line) == 0;
+}
+
 void bql_unlock(void)
 {
     g_assert(bql_locked());
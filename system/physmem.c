@@ -22,6 +22,7 @@
 #include "qapi/error.h"
 
 #include "qemu/cutils.h"
+#include "qemu/units.h"
 #include "qemu/cacheflush.h"
 #include "qemu/hbitmap.h"
 #include "qemu/madvise.h"
@@ -342,18 +343,82 @@ static MemoryRegionSection *phys_page_find(AddressSpaceDispatch *d, hwaddr addr)
     }
 }
 
+/*
+ * Sections recently hit by a vCPU thread.  Unlike mru_section, which all
+ * vCPUs share, this is not written by other threads, so vCPUs ringing
+ * different doorbells do not evict each other's entries.
+ *
+ * Entries are keyed by the dispatch they belong to; dispatch_gen is bumped
+ * whenever a dispatch is freed, so that a new dispatch allocated at the
+ * same address after a topology change does not match stale entries.
+ */
+#define DISPATCH_CACHE_SIZE 4
+
+typedef struct DispatchCache {
+    unsigned gen;
+    unsigned next;
+    AddressSpaceDispatch *d[DISPATCH_CACHE_SIZE];
+    MemoryRegionSection *section[DISPATCH_CACHE_SIZE];
+} DispatchCache;
+
+static unsigned dispatch_gen;
+static __thread DispatchCache dispatch_cache;
+
+/* Called from RCU critical section */
+static MemoryRegionSection *dispatch_cache_lookup(AddressSpaceDispatch *d,
+                                                  hwaddr addr)
+{
+    DispatchCache *c = &dispatch_cache;
+    unsigned gen = qatomic_read(&dispatch_gen);
+    int i;
+
+    if (unlikely(c->gen != gen)) {
+        memset(c, 0, sizeof(*c));
+        c->gen = gen;
+        return NULL;
+    }
+
+    for (i = 0; i < DISPATCH_CACHE_SIZE; i++) {
+        if (c->d[i] == d && section_covers_addr(c->section[i], addr)) {
+            return c->section[i];
+        }
+    }
+    return NULL;
+}
+
+static void dispatch_cache_insert(AddressSpaceDispatch *d,
+                                  MemoryRegionSection *section)
+{
+    DispatchCache *c = &dispatch_cache;
+
+    c->d[c->next] = d;
+    c->section[c->next] = section;
+    c->next = (c->next + 1) % DISPATCH_CACHE_SIZE;
+}
+
 /* Called from RCU critical section */
 static MemoryRegionSection *address_space_lookup_region(AddressSpaceDispatch *d,
                                                         hwaddr addr,
                                                         bool resolve_subpage)
 {
-    MemoryRegionSection *section = qatomic_read(&d->mru_section);
+    MemoryRegionSection *section = NULL;
     subpage_t *subpage;
 
-    if (!section || section == &d->map.sections[PHYS_SECTION_UNASSIGNED] ||
-        !section_covers_addr(section, addr)) {
-        section = phys_page_find(d, addr);
-        qatomic_set(&d->mru_section, section);
+    if (current_cpu) {
+        section = dispatch_cache_lookup(d, addr);
+    }
+    if (!section) {
+        section = qatomic_read(&d->mru_section);
+        if (!section ||
+            section == &d->map.sections[PHYS_SECTION_UNASSIGNED] ||
+            !section_covers_addr(section, addr)) {
+            section = phys_page_find(d, addr);
+            qatomic_set(&d->mru_section, section);
+        }
+        if (current_cpu &&
+            section != &d->map.sections[PHYS_SECTION_UNASSIGNED]) {
+            dispatch_cache_insert(d, section);
+        }
     }
     if (resolve_subpage && section->mr->subpage) {
         subpage = container_of(section->mr, subpage_t, iomem);
@@ -1220,6 +1285,9 @@ bool physical_memory_snapshot_get_dirty(DirtyBitmapSnapshot *snap,
     return false;
 }
 
+/* Words of a dirty log checked at once for being all clean (4096 pages) */
+#define DIRTY_LOG_SKIP_WORDS    (4096 / BITS_PER_LONG)
+
 uint64_t physical_memory_set_dirty_lebitmap(unsigned long *bitmap,
                                                 ram_addr_t start,
                                                 ram_addr_t pages)
@@ -1253,6 +1321,24 @@ uint64_t physical_memory_set_dirty_lebitmap(unsigned long *bitmap,
             }
 
             for (k = 0; k < nr; k++) {
+                /*
+                 * Dirty logs are usually sparse: skip clean stretches of
+                 * the bitmap with the vectorized zero check rather than
+                 * one word at a time.
+                 */
+                if ((k % DIRTY_LOG_SKIP_WORDS) == 0 &&
+                    k + DIRTY_LOG_SKIP_WORDS <= nr &&
+                    buffer_is_zero(&bitmap[k],
+                                   DIRTY_LOG_SKIP_WORDS * sizeof(long))) {
+                    k += DIRTY_LOG_SKIP_WORDS - 1;
+                    offset += DIRTY_LOG_SKIP_WORDS;
+                    while (offset >= BITS_TO_LONGS(DIRTY_MEMORY_BLOCK_SIZE)) {
+                        offset -= BITS_TO_LONGS(DIRTY_MEMORY_BLOCK_SIZE);
+                        idx++;
+                    }
+                    continue;
+                }
+
                 if (bitmap[k]) {
                     unsigned long temp = leul_to_cpu(bitmap[k]);
 
@@ -3031,6 +3117,8 @@ AddressSpaceDispatch *address_space_dispatch_new(FlatView *fv)
 
 void address_space_dispatch_free(AddressSpaceDispatch *d)
 {
+    /* Invalidate the dispatch caches before @d can be reused */
+    qatomic_inc(&dispatch_gen);
     phys_sections_free(&d->map);
     g_free(d);
 }
@@ -3198,7 +3286,14 @@ bool prepare_mmio_access(MemoryRegion *mr)
     bool release_lock = false;
 
     if (!bql_locked() && !mr->lockless_io) {
-        bql_lock();
+        if (!bql_trylock()) {
+            int64_t start = get_clock();
+
+            bql_lock();
+            stat64_inc(&mr->bql_contended);
+            stat64_add(&mr->bql_wait_ns, get_clock() - start);
+        }
+        stat64_inc(&mr->bql_acquisitions);
         release_lock = true;
     }
     if (mr->flush_coalesced_mmio) {
@@ -3561,9 +3656,94 @@ typedef struct {
     MemoryRegion *mr;
     hwaddr addr;
     size_t len;
+    /* size of @buffer, may be more than @len if the buffer is reused */
+    size_t alloc_len;
     uint8_t buffer[];
 } BounceBuffer;
 
+/*
+ * Freed bounce buffers are kept for reuse by the thread that freed them.
+ * DMA to MMIO usually maps and unmaps from the same AioContext, which
+ * then does not need to allocate, and fault in, a new buffer for every
+ * request.
+ */
+#define BOUNCE_BUFFER_CACHE_NUM     4
+#define BOUNCE_BUFFER_CACHE_MAX_LEN (1 * MiB)
+
+typedef struct {
+    BounceBuffer *buffers[BOUNCE_BUFFER_CACHE_NUM];
+    Notifier exit;
+    bool exit_registered;
+} BounceBufferCache;
+
+static __thread BounceBufferCache bounce_buffer_cache;
+
+static void bounce_buffer_cache_exit(Notifier *n, void *data)
+{
+    BounceBufferCache *cache = container_of(n, BounceBufferCache, exit);
+
+    for (int i = 0; i < BOUNCE_BUFFER_CACHE_NUM; i++) {
+        g_free(cache->buffers[i]);
+        cache->buffers[i] = NULL;
+    }
+}
+
+static BounceBuffer *bounce_buffer_alloc(size_t len)
+{
+    BounceBufferCache *cache = &bounce_buffer_cache;
+    BounceBuffer *bounce;
+
+    for (int i = 0; i < BOUNCE_BUFFER_CACHE_NUM; i++) {
+        bounce = cache->buffers[i];
+        if (bounce && bounce->alloc_len >= len) {
+            cache->buffers[i] = NULL;
+            trace_address_space_map_bounce(len, true);
+            return bounce;
+        }
+    }
+
+    bounce = g_malloc(len + sizeof(BounceBuffer));
+    bounce->alloc_len = len;
+    trace_address_space_map_bounce(len, false);
+    return bounce;
+}
+
+static void bounce_buffer_free(BounceBuffer *bounce)
+{
+    BounceBufferCache *cache = &bounce_buffer_cache;
+    int smallest = 0;
+
+    if (bounce->alloc_len > BOUNCE_BUFFER_CACHE_MAX_LEN) {
+        g_free(bounce);
+        return;
+    }
+
+    if (!cache->exit_registered) {
+        cache->exit.notify = bounce_buffer_cache_exit;
+        qemu_thread_atexit_add(&cache->exit);
+        cache->exit_registered = true;
+    }
+
+    /* Use an empty slot, or replace the smallest buffer if larger */
+    for (int i = 0; i < BOUNCE_BUFFER_CACHE_NUM; i++) {
+        if (!cache->buffers[i]) {
+            cache->buffers[i] = bounce;
+            return;
+        }
+        if (cache->buffers[i]->alloc_len <
+            cache->buffers[smallest]->alloc_len) {
+            smallest = i;
+        }
+    }
+    if (cache->buffers[smallest]->alloc_len < bounce->alloc_len) {
+        BounceBuffer *old = cache->buffers[smallest];
+
+        cache->buffers[smallest] = bounce;
+        bounce = old;
+    }
+    g_free(bounce);
+}
+
 static void
 address_space_unregister_map_client_do(AddressSpaceMapClient *client)
 {
@@ -3749,16 +3929,19 @@ void *address_space_map(AddressSpace *as,
             return NULL;
         }
 
-        BounceBuffer *bounce = g_malloc0(l + sizeof(BounceBuffer));
+        BounceBuffer *bounce = bounce_buffer_alloc(l);
         bounce->magic = BOUNCE_BUFFER_MAGIC;
         memory_region_ref(mr);
         bounce->mr = mr;
         bounce->addr = addr;
         bounce->len = l;
 
+        /* Do not let the device see data of an earlier request */
         if (!is_write) {
             flatview_read(fv, addr, attrs,
                           bounce->buffer, l);
+        } else {
+            memset(bounce->buffer, 0, l);
         }
 
         *plen = l;
@@ -3806,7 +3989,7 @@ void address_space_unmap(AddressSpace *as, void *buffer, hwaddr len,
     qatomic_sub(&as->bounce_buffer_size, bounce->len);
     bounce->magic = ~BOUNCE_BUFFER_MAGIC;
     memory_region_unref(bounce->mr);
-    g_free(bounce);
+    bounce_buffer_free(bounce);
     /* Write bounce_buffer_size before reading map_client_list. */
     smp_mb();
     address_space_notify_map_clients(as);
@@ -648,6 +648,40 @@ decode_set_slot_number(Packet *pkt)
     return has_valid_slot_assignment(pkt);
 }
 
+/*
+ * Per-thread cache of decoded packets, keyed by the packet words.  Firmware
+ * that rewrites its own code keeps invalidating and retranslating the same
+ * packets, and decoding dominates the cost of translating them again.
+ * Decoding depends only on the words, so a hit can reuse the previous result.
+ */
+#define DECODE_CACHE_BITS 8
+
+typedef struct DecodeCacheEntry {
+    uint32_t words[PACKET_WORDS_MAX];
+    int nwords;                 /* 0 when the entry is empty */
+    Packet pkt;
+} DecodeCacheEntry;
+
+static __thread DecodeCacheEntry *decode_cache;
+
+static DecodeCacheEntry *decode_cache_entry(const uint32_t *words)
+{
+    uint32_t idx = (words[0] * 0x9e3779b1u) >> (32 - DECODE_CACHE_BITS);
+
+    if (!decode_cache) {
+        decode_cache = g_new0(DecodeCacheEntry, 1 << DECODE_CACHE_BITS);
+    }
+    return &decode_cache[idx];
+}
+
+static void decode_copy_packet(Packet *dst, const Packet *src)
+{
+    *dst = *src;
+    if (src->vhist_insn) {
+        dst->vhist_insn = dst->insn + (src->vhist_insn - src->insn);
+    }
+}
+
 /*
  * decode_packet
  * Decodes packet with given words
@@ -664,6 +698,16 @@ int decode_packet(DisasContext *ctx, int max_words, const uint32_t *words,
     int new_insns = 0;
     int i;
     uint32_t encoding32;
+    DecodeCacheEntry *cached = NULL;
+
+    if (!disas_only) {
+        cached = decode_cache_entry(words);
+        if (cached->nwords && cached->nwords <= max_words &&
+            !memcmp(cached->words, words, cached->nwords * sizeof(*words))) {
+            decode_copy_packet(pkt, &cached->pkt);
+            return cached->nwords;
+        }
+    }
 
     /* Initialize */
     memset(pkt, 0, sizeof(*pkt));
@@ -738,6 +782,10 @@ int decode_packet(DisasContext *ctx, int max_words, const uint32_t *words,
         decode_shuffle_for_execution(pkt);
         decode_split_cmpjump(pkt);
         decode_set_insn_attr_fields(pkt);
+
+        memcpy(cached->words, words, words_read * sizeof(*words));
+        cached->nwords = words_read;
+        decode_copy_packet(&cached->pkt, pkt);
     }
 
     return words_read;
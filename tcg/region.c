@@ -555,15 +555,41 @@ static int alloc_code_gen_buffer(size_t size, int splitwx, Error **errp)
 static int alloc_code_gen_buffer_anon(size_t size, int prot,
                                       int flags, Error **errp)
 {
+    size_t align = QEMU_VMALLOC_ALIGN;
+    size_t map_size = size;
     void *buf;
 
-    buf = mmap(NULL, size, prot, flags, -1, 0);
+    /*
+     * Over-allocate so that the buffer can start on a huge page boundary.
+     * Otherwise the kernel can only back the aligned interior of the buffer
+     * with transparent huge pages, and hot code near either end of it pays
+     * extra iTLB misses.
+     */
+    if (align > qemu_real_host_page_size() && size >= align) {
+        map_size += align;
+    }
+
+    buf = mmap(NULL, map_size, prot, flags, -1, 0);
     if (buf == MAP_FAILED) {
         error_setg_errno(errp, errno,
                          "allocate %zu bytes for jit buffer", size);
         return -1;
     }
 
+    if (map_size != size) {
+        void *aligned = QEMU_ALIGN_PTR_UP(buf, align);
+        size_t head = aligned - buf;
+        size_t tail = map_size - head - size;
+
+        if (head) {
+            munmap(buf, head);
+        }
+        if (tail) {
+            munmap(aligned + size, tail);
+        }
+        buf = aligned;
+    }
+
     region.start_aligned = buf;
     region.total_size = size;
     return prot;
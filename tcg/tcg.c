@@ -4806,6 +4806,21 @@ static TCGReg tcg_reg_alloc(TCGContext *s, TCGRegSet required_regs,
             tcg_reg_free(s, reg, allocated_regs);
             return reg;
         } else {
+            /*
+             * Prefer evicting a value that is already in memory or is a
+             * constant: dropping it needs no store, and with many guest
+             * globals live this avoids a store/reload pair per spill.
+             */
+            for (i = 0; i < n; i++) {
+                TCGReg reg = order[i];
+                TCGTemp *ts = s->reg_to_temp[reg];
+
+                if (tcg_regset_test_reg(set, reg) &&
+                    (temp_readonly(ts) || ts->mem_coherent)) {
+                    tcg_reg_free(s, reg, allocated_regs);
+                    return reg;
+                }
+            }
             for (i = 0; i < n; i++) {
                 TCGReg reg = order[i];
                 if (tcg_regset_test_reg(set, reg)) {
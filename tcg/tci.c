@@ -325,6 +325,22 @@ static void tci_qemu_st(CPUArchState *env, uint64_t taddr, uint64_t val,
     }
 }
 
+/*
+ * The interpreter is direct threaded: each opcode handler fetches the next
+ * instruction and jumps straight to its handler through tci_dispatch[],
+ * instead of going back through a single switch.  Giving every handler its
+ * own indirect branch lets the host predict opcode sequences.  The switch is
+ * only used to dispatch the first instruction after entry.
+ */
+#define TCI_CASE(op)        case INDEX_op_##op: tci_label_##op
+#define TCI_CASE_DEFAULT    default: tci_label_default
+#define TCI_NEXT()                          \
+    do {                                    \
+        insn = *tb_ptr++;                   \
+        opc = extract32(insn, 0, 8);        \
+        goto *tci_dispatch[opc];            \
+    } while (0)
+
 /* Interpret pseudo code in tb. */
 /*
  * Disable CFI checks.
@@ -334,6 +350,94 @@ static void tci_qemu_st(CPUArchState *env, uint64_t taddr, uint64_t val,
 uintptr_t QEMU_DISABLE_CFI tcg_qemu_tb_exec(CPUArchState *env,
                                             const void *v_tb_ptr)
 {
+    static const void * const tci_dispatch[256] = {
+        [0 ... 255] = &&tci_label_default,
+        [INDEX_op_call] = &&tci_label_call,
+        [INDEX_op_br] = &&tci_label_br,
+#if TCG_TARGET_REG_BITS == 32
+        [INDEX_op_setcond2_i32] = &&tci_label_setcond2_i32,
+#elif TCG_TARGET_REG_BITS == 64
+        [INDEX_op_setcond] = &&tci_label_setcond,
+        [INDEX_op_movcond] = &&tci_label_movcond,
+#endif
+        [INDEX_op_mov] = &&tci_label_mov,
+        [INDEX_op_tci_movi] = &&tci_label_tci_movi,
+        [INDEX_op_tci_movl] = &&tci_label_tci_movl,
+        [INDEX_op_tci_setcarry] = &&tci_label_tci_setcarry,
+        [INDEX_op_ld8u] = &&tci_label_ld8u,
+        [INDEX_op_ld8s] = &&tci_label_ld8s,
+        [INDEX_op_ld16u] = &&tci_label_ld16u,
+        [INDEX_op_ld16s] = &&tci_label_ld16s,
+        [INDEX_op_ld] = &&tci_label_ld,
+        [INDEX_op_st8] = &&tci_label_st8,
+        [INDEX_op_st16] = &&tci_label_st16,
+        [INDEX_op_st] = &&tci_label_st,
+        [INDEX_op_add] = &&tci_label_add,
+        [INDEX_op_sub] = &&tci_label_sub,
+        [INDEX_op_mul] = &&tci_label_mul,
+        [INDEX_op_and] = &&tci_label_and,
+        [INDEX_op_or] = &&tci_label_or,
+        [INDEX_op_xor] = &&tci_label_xor,
+        [INDEX_op_andc] = &&tci_label_andc,
+        [INDEX_op_orc] = &&tci_label_orc,
+        [INDEX_op_eqv] = &&tci_label_eqv,
+        [INDEX_op_nand] = &&tci_label_nand,
+        [INDEX_op_nor] = &&tci_label_nor,
+        [INDEX_op_neg] = &&tci_label_neg,
+        [INDEX_op_not] = &&tci_label_not,
+        [INDEX_op_ctpop] = &&tci_label_ctpop,
+        [INDEX_op_addco] = &&tci_label_addco,
+        [INDEX_op_addci] = &&tci_label_addci,
+        [INDEX_op_addcio] = &&tci_label_addcio,
+        [INDEX_op_subbo] = &&tci_label_subbo,
+        [INDEX_op_subbi] = &&tci_label_subbi,
+        [INDEX_op_subbio] = &&tci_label_subbio,
+        [INDEX_op_muls2] = &&tci_label_muls2,
+        [INDEX_op_mulu2] = &&tci_label_mulu2,
+        [INDEX_op_tci_divs32] = &&tci_label_tci_divs32,
+        [INDEX_op_tci_divu32] = &&tci_label_tci_divu32,
+        [INDEX_op_tci_rems32] = &&tci_label_tci_rems32,
+        [INDEX_op_tci_remu32] = &&tci_label_tci_remu32,
+        [INDEX_op_tci_clz32] = &&tci_label_tci_clz32,
+        [INDEX_op_tci_ctz32] = &&tci_label_tci_ctz32,
+        [INDEX_op_tci_setcond32] = &&tci_label_tci_setcond32,
+        [INDEX_op_tci_movcond32] = &&tci_label_tci_movcond32,
+        [INDEX_op_shl] = &&tci_label_shl,
+        [INDEX_op_shr] = &&tci_label_shr,
+        [INDEX_op_sar] = &&tci_label_sar,
+        [INDEX_op_tci_rotl32] = &&tci_label_tci_rotl32,
+        [INDEX_op_tci_rotr32] = &&tci_label_tci_rotr32,
+        [INDEX_op_deposit] = &&tci_label_deposit,
+        [INDEX_op_extract] = &&tci_label_extract,
+        [INDEX_op_sextract] = &&tci_label_sextract,
+        [INDEX_op_brcond] = &&tci_label_brcond,
+        [INDEX_op_bswap16] = &&tci_label_bswap16,
+        [INDEX_op_bswap32] = &&tci_label_bswap32,
+#if TCG_TARGET_REG_BITS == 64
+        [INDEX_op_ld32u] = &&tci_label_ld32u,
+        [INDEX_op_ld32s] = &&tci_label_ld32s,
+        [INDEX_op_st32] = &&tci_label_st32,
+        [INDEX_op_divs] = &&tci_label_divs,
+        [INDEX_op_divu] = &&tci_label_divu,
+        [INDEX_op_rems] = &&tci_label_rems,
+        [INDEX_op_remu] = &&tci_label_remu,
+        [INDEX_op_clz] = &&tci_label_clz,
+        [INDEX_op_ctz] = &&tci_label_ctz,
+        [INDEX_op_rotl] = &&tci_label_rotl,
+        [INDEX_op_rotr] = &&tci_label_rotr,
+        [INDEX_op_ext_i32_i64] = &&tci_label_ext_i32_i64,
+        [INDEX_op_extu_i32_i64] = &&tci_label_extu_i32_i64,
+        [INDEX_op_bswap64] = &&tci_label_bswap64,
+#endif /* TCG_TARGET_REG_BITS == 64 */
+        [INDEX_op_exit_tb] = &&tci_label_exit_tb,
+        [INDEX_op_goto_tb] = &&tci_label_goto_tb,
+        [INDEX_op_goto_ptr] = &&tci_label_goto_ptr,
+        [INDEX_op_qemu_ld] = &&tci_label_qemu_ld,
+        [INDEX_op_qemu_st] = &&tci_label_qemu_st,
+        [INDEX_op_qemu_ld2] = &&tci_label_qemu_ld2,
+        [INDEX_op_qemu_st2] = &&tci_label_qemu_st2,
+        [INDEX_op_mb] = &&tci_label_mb,
+    };
     const uint32_t *tb_ptr = v_tb_ptr;
     tcg_target_ulong regs[TCG_TARGET_NB_REGS];
     uint64_t stack[(TCG_STATIC_CALL_ARGS_SIZE + TCG_STATIC_FRAME_SIZE)
@@ -361,7 +465,7 @@ uintptr_t QEMU_DISABLE_CFI tcg_qemu_tb_exec(CPUArchState *env,
         opc = extract32(insn, 0, 8);
 
         switch (opc) {
-        case INDEX_op_call:
+        TCI_CASE(call):
             {
                 void *call_slots[MAX_CALL_IARGS];
                 ffi_cif *cif;
@@ -412,158 +516,158 @@ uintptr_t QEMU_DISABLE_CFI tcg_qemu_tb_exec(CPUArchState *env,
             default:
                 g_assert_not_reached();
             }
-            break;
+            TCI_NEXT();
 
-        case INDEX_op_br:
+        TCI_CASE(br):
             tci_args_l(insn, tb_ptr, &ptr);
             tb_ptr = ptr;
-            continue;
+            TCI_NEXT();
 #if TCG_TARGET_REG_BITS == 32
-        case INDEX_op_setcond2_i32:
+        TCI_CASE(setcond2_i32):
             tci_args_rrrrrc(insn, &r0, &r1, &r2, &r3, &r4, &condition);
             regs[r0] = tci_compare64(tci_uint64(regs[r2], regs[r1]),
                                      tci_uint64(regs[r4], regs[r3]),
                                      condition);
-            break;
+            TCI_NEXT();
 #elif TCG_TARGET_REG_BITS == 64
-        case INDEX_op_setcond:
+        TCI_CASE(setcond):
             tci_args_rrrc(insn, &r0, &r1, &r2, &condition);
             regs[r0] = tci_compare64(regs[r1], regs[r2], condition);
-            break;
-        case INDEX_op_movcond:
+            TCI_NEXT();
+        TCI_CASE(movcond):
             tci_args_rrrrrc(insn, &r0, &r1, &r2, &r3, &r4, &condition);
             tmp32 = tci_compare64(regs[r1], regs[r2], condition);
             regs[r0] = regs[tmp32 ? r3 : r4];
-            break;
+            TCI_NEXT();
 #endif
-        case INDEX_op_mov:
+        TCI_CASE(mov):
             tci_args_rr(insn, &r0, &r1);
             regs[r0] = regs[r1];
-            break;
-        case INDEX_op_tci_movi:
+            TCI_NEXT();
+        TCI_CASE(tci_movi):
             tci_args_ri(insn, &r0, &t1);
             regs[r0] = t1;
-            break;
-        case INDEX_op_tci_movl:
+            TCI_NEXT();
+        TCI_CASE(tci_movl):
             tci_args_rl(insn, tb_ptr, &r0, &ptr);
             regs[r0] = *(tcg_target_ulong *)ptr;
-            break;
-        case INDEX_op_tci_setcarry:
+            TCI_NEXT();
+        TCI_CASE(tci_setcarry):
             carry = true;
-            break;
+            TCI_NEXT();
 
             /* Load/store operations (32 bit). */
 
-        case INDEX_op_ld8u:
+        TCI_CASE(ld8u):
             tci_args_rrs(insn, &r0, &r1, &ofs);
             ptr = (void *)(regs[r1] + ofs);
             regs[r0] = *(uint8_t *)ptr;
-            break;
-        case INDEX_op_ld8s:
+            TCI_NEXT();
+        TCI_CASE(ld8s):
             tci_args_rrs(insn, &r0, &r1, &ofs);
             ptr = (void *)(regs[r1] + ofs);
             regs[r0] = *(int8_t *)ptr;
-            break;
-        case INDEX_op_ld16u:
+            TCI_NEXT();
+        TCI_CASE(ld16u):
             tci_args_rrs(insn, &r0, &r1, &ofs);
             ptr = (void *)(regs[r1] + ofs);
             regs[r0] = *(uint16_t *)ptr;
-            break;
-        case INDEX_op_ld16s:
+            TCI_NEXT();
+        TCI_CASE(ld16s):
             tci_args_rrs(insn, &r0, &r1, &ofs);
             ptr = (void *)(regs[r1] + ofs);
             regs[r0] = *(int16_t *)ptr;
-            break;
-        case INDEX_op_ld:
+            TCI_NEXT();
+        TCI_CASE(ld):
             tci_args_rrs(insn, &r0, &r1, &ofs);
             ptr = (void *)(regs[r1] + ofs);
             regs[r0] = *(tcg_target_ulong *)ptr;
-            break;
-        case INDEX_op_st8:
+            TCI_NEXT();
+        TCI_CASE(st8):
             tci_args_rrs(insn, &r0, &r1, &ofs);
             ptr = (void *)(regs[r1] + ofs);
             *(uint8_t *)ptr = regs[r0];
-            break;
-        case INDEX_op_st16:
+            TCI_NEXT();
+        TCI_CASE(st16):
             tci_args_rrs(insn, &r0, &r1, &ofs);
             ptr = (void *)(regs[r1] + ofs);
             *(uint16_t *)ptr = regs[r0];
-            break;
-        case INDEX_op_st:
+            TCI_NEXT();
+        TCI_CASE(st):
             tci_args_rrs(insn, &r0, &r1, &ofs);
             ptr = (void *)(regs[r1] + ofs);
             *(tcg_target_ulong *)ptr = regs[r0];
-            break;
+            TCI_NEXT();
 
             /* Arithmetic operations (mixed 32/64 bit). */
 
-        case INDEX_op_add:
+        TCI_CASE(add):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = regs[r1] + regs[r2];
-            break;
-        case INDEX_op_sub:
+            TCI_NEXT();
+        TCI_CASE(sub):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = regs[r1] - regs[r2];
-            break;
-        case INDEX_op_mul:
+            TCI_NEXT();
+        TCI_CASE(mul):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = regs[r1] * regs[r2];
-            break;
-        case INDEX_op_and:
+            TCI_NEXT();
+        TCI_CASE(and):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = regs[r1] & regs[r2];
-            break;
-        case INDEX_op_or:
+            TCI_NEXT();
+        TCI_CASE(or):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = regs[r1] | regs[r2];
-            break;
-        case INDEX_op_xor:
+            TCI_NEXT();
+        TCI_CASE(xor):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = regs[r1] ^ regs[r2];
-            break;
-        case INDEX_op_andc:
+            TCI_NEXT();
+        TCI_CASE(andc):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = regs[r1] & ~regs[r2];
-            break;
-        case INDEX_op_orc:
+            TCI_NEXT();
+        TCI_CASE(orc):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = regs[r1] | ~regs[r2];
-            break;
-        case INDEX_op_eqv:
+            TCI_NEXT();
+        TCI_CASE(eqv):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = ~(regs[r1] ^ regs[r2]);
-            break;
-        case INDEX_op_nand:
+            TCI_NEXT();
+        TCI_CASE(nand):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = ~(regs[r1] & regs[r2]);
-            break;
-        case INDEX_op_nor:
+            TCI_NEXT();
+        TCI_CASE(nor):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = ~(regs[r1] | regs[r2]);
-            break;
-        case INDEX_op_neg:
+            TCI_NEXT();
+        TCI_CASE(neg):
             tci_args_rr(insn, &r0, &r1);
             regs[r0] = -regs[r1];
-            break;
-        case INDEX_op_not:
+            TCI_NEXT();
+        TCI_CASE(not):
             tci_args_rr(insn, &r0, &r1);
             regs[r0] = ~regs[r1];
-            break;
-        case INDEX_op_ctpop:
+            TCI_NEXT();
+        TCI_CASE(ctpop):
             tci_args_rr(insn, &r0, &r1);
             regs[r0] = ctpop_tr(regs[r1]);
-            break;
-        case INDEX_op_addco:
+            TCI_NEXT();
+        TCI_CASE(addco):
             tci_args_rrr(insn, &r0, &r1, &r2);
             t1 = regs[r1] + regs[r2];
             carry = t1 < regs[r1];
             regs[r0] = t1;
-            break;
-        case INDEX_op_addci:
+            TCI_NEXT();
+        TCI_CASE(addci):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = regs[r1] + regs[r2] + carry;
-            break;
-        case INDEX_op_addcio:
+            TCI_NEXT();
+        TCI_CASE(addcio):
             tci_args_rrr(insn, &r0, &r1, &r2);
             if (carry) {
                 t1 = regs[r1] + regs[r2] + 1;
@@ -573,17 +677,17 @@ uintptr_t QEMU_DISABLE_CFI tcg_qemu_tb_exec(CPUArchState *env,
                 carry = t1 < regs[r1];
             }
             regs[r0] = t1;
-            break;
-        case INDEX_op_subbo:
+            TCI_NEXT();
+        TCI_CASE(subbo):
             tci_args_rrr(insn, &r0, &r1, &r2);
             carry = regs[r1] < regs[r2];
             regs[r0] = regs[r1] - regs[r2];
-            break;
-        case INDEX_op_subbi:
+            TCI_NEXT();
+        TCI_CASE(subbi):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = regs[r1] - regs[r2] - carry;
-            break;
-        case INDEX_op_subbio:
+            TCI_NEXT();
+        TCI_CASE(subbio):
             tci_args_rrr(insn, &r0, &r1, &r2);
             if (carry) {
                 carry = regs[r1] <= regs[r2];
@@ -592,8 +696,8 @@ uintptr_t QEMU_DISABLE_CFI tcg_qemu_tb_exec(CPUArchState *env,
                 carry = regs[r1] < regs[r2];
                 regs[r0] = regs[r1] - regs[r2];
             }
-            break;
-        case INDEX_op_muls2:
+            TCI_NEXT();
+        TCI_CASE(muls2):
             tci_args_rrrr(insn, &r0, &r1, &r2, &r3);
 #if TCG_TARGET_REG_BITS == 32
             tmp64 = (int64_t)(int32_t)regs[r2] * (int32_t)regs[r3];
@@ -601,8 +705,8 @@ uintptr_t QEMU_DISABLE_CFI tcg_qemu_tb_exec(CPUArchState *env,
 #else
             muls64(&regs[r0], &regs[r1], regs[r2], regs[r3]);
 #endif
-            break;
-        case INDEX_op_mulu2:
+            TCI_NEXT();
+        TCI_CASE(mulu2):
             tci_args_rrrr(insn, &r0, &r1, &r2, &r3);
 #if TCG_TARGET_REG_BITS == 32
             tmp64 = (uint64_t)(uint32_t)regs[r2] * (uint32_t)regs[r3];
@@ -610,220 +714,220 @@ uintptr_t QEMU_DISABLE_CFI tcg_qemu_tb_exec(CPUArchState *env,
 #else
             mulu64(&regs[r0], &regs[r1], regs[r2], regs[r3]);
 #endif
-            break;
+            TCI_NEXT();
 
             /* Arithmetic operations (32 bit). */
 
-        case INDEX_op_tci_divs32:
+        TCI_CASE(tci_divs32):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = (int32_t)regs[r1] / (int32_t)regs[r2];
-            break;
-        case INDEX_op_tci_divu32:
+            TCI_NEXT();
+        TCI_CASE(tci_divu32):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = (uint32_t)regs[r1] / (uint32_t)regs[r2];
-            break;
-        case INDEX_op_tci_rems32:
+            TCI_NEXT();
+        TCI_CASE(tci_rems32):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = (int32_t)regs[r1] % (int32_t)regs[r2];
-            break;
-        case INDEX_op_tci_remu32:
+            TCI_NEXT();
+        TCI_CASE(tci_remu32):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = (uint32_t)regs[r1] % (uint32_t)regs[r2];
-            break;
-        case INDEX_op_tci_clz32:
+            TCI_NEXT();
+        TCI_CASE(tci_clz32):
             tci_args_rrr(insn, &r0, &r1, &r2);
             tmp32 = regs[r1];
             regs[r0] = tmp32 ? clz32(tmp32) : regs[r2];
-            break;
-        case INDEX_op_tci_ctz32:
+            TCI_NEXT();
+        TCI_CASE(tci_ctz32):
             tci_args_rrr(insn, &r0, &r1, &r2);
             tmp32 = regs[r1];
             regs[r0] = tmp32 ? ctz32(tmp32) : regs[r2];
-            break;
-        case INDEX_op_tci_setcond32:
+            TCI_NEXT();
+        TCI_CASE(tci_setcond32):
             tci_args_rrrc(insn, &r0, &r1, &r2, &condition);
             regs[r0] = tci_compare32(regs[r1], regs[r2], condition);
-            break;
-        case INDEX_op_tci_movcond32:
+            TCI_NEXT();
+        TCI_CASE(tci_movcond32):
             tci_args_rrrrrc(insn, &r0, &r1, &r2, &r3, &r4, &condition);
             tmp32 = tci_compare32(regs[r1], regs[r2], condition);
             regs[r0] = regs[tmp32 ? r3 : r4];
-            break;
+            TCI_NEXT();
 
             /* Shift/rotate operations. */
 
-        case INDEX_op_shl:
+        TCI_CASE(shl):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = regs[r1] << (regs[r2] % TCG_TARGET_REG_BITS);
-            break;
-        case INDEX_op_shr:
+            TCI_NEXT();
+        TCI_CASE(shr):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = regs[r1] >> (regs[r2] % TCG_TARGET_REG_BITS);
-            break;
-        case INDEX_op_sar:
+            TCI_NEXT();
+        TCI_CASE(sar):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = ((tcg_target_long)regs[r1]
                         >> (regs[r2] % TCG_TARGET_REG_BITS));
-            break;
-        case INDEX_op_tci_rotl32:
+            TCI_NEXT();
+        TCI_CASE(tci_rotl32):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = rol32(regs[r1], regs[r2] & 31);
-            break;
-        case INDEX_op_tci_rotr32:
+            TCI_NEXT();
+        TCI_CASE(tci_rotr32):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = ror32(regs[r1], regs[r2] & 31);
-            break;
-        case INDEX_op_deposit:
+            TCI_NEXT();
+        TCI_CASE(deposit):
             tci_args_rrrbb(insn, &r0, &r1, &r2, &pos, &len);
             regs[r0] = deposit_tr(regs[r1], pos, len, regs[r2]);
-            break;
-        case INDEX_op_extract:
+            TCI_NEXT();
+        TCI_CASE(extract):
             tci_args_rrbb(insn, &r0, &r1, &pos, &len);
             regs[r0] = extract_tr(regs[r1], pos, len);
-            break;
-        case INDEX_op_sextract:
+            TCI_NEXT();
+        TCI_CASE(sextract):
             tci_args_rrbb(insn, &r0, &r1, &pos, &len);
             regs[r0] = sextract_tr(regs[r1], pos, len);
-            break;
-        case INDEX_op_brcond:
+            TCI_NEXT();
+        TCI_CASE(brcond):
             tci_args_rl(insn, tb_ptr, &r0, &ptr);
             if (regs[r0]) {
                 tb_ptr = ptr;
             }
-            break;
-        case INDEX_op_bswap16:
+            TCI_NEXT();
+        TCI_CASE(bswap16):
             tci_args_rr(insn, &r0, &r1);
             regs[r0] = bswap16(regs[r1]);
-            break;
-        case INDEX_op_bswap32:
+            TCI_NEXT();
+        TCI_CASE(bswap32):
             tci_args_rr(insn, &r0, &r1);
             regs[r0] = bswap32(regs[r1]);
-            break;
+            TCI_NEXT();
 #if TCG_TARGET_REG_BITS == 64
             /* Load/store operations (64 bit). */
 
-        case INDEX_op_ld32u:
+        TCI_CASE(ld32u):
             tci_args_rrs(insn, &r0, &r1, &ofs);
             ptr = (void *)(regs[r1] + ofs);
             regs[r0] = *(uint32_t *)ptr;
-            break;
-        case INDEX_op_ld32s:
+            TCI_NEXT();
+        TCI_CASE(ld32s):
             tci_args_rrs(insn, &r0, &r1, &ofs);
             ptr = (void *)(regs[r1] + ofs);
             regs[r0] = *(int32_t *)ptr;
-            break;
-        case INDEX_op_st32:
+            TCI_NEXT();
+        TCI_CASE(st32):
             tci_args_rrs(insn, &r0, &r1, &ofs);
             ptr = (void *)(regs[r1] + ofs);
             *(uint32_t *)ptr = regs[r0];
-            break;
+            TCI_NEXT();
 
             /* Arithmetic operations (64 bit). */
 
-        case INDEX_op_divs:
+        TCI_CASE(divs):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = (int64_t)regs[r1] / (int64_t)regs[r2];
-            break;
-        case INDEX_op_divu:
+            TCI_NEXT();
+        TCI_CASE(divu):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = (uint64_t)regs[r1] / (uint64_t)regs[r2];
-            break;
-        case INDEX_op_rems:
+            TCI_NEXT();
+        TCI_CASE(rems):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = (int64_t)regs[r1] % (int64_t)regs[r2];
-            break;
-        case INDEX_op_remu:
+            TCI_NEXT();
+        TCI_CASE(remu):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = (uint64_t)regs[r1] % (uint64_t)regs[r2];
-            break;
-        case INDEX_op_clz:
+            TCI_NEXT();
+        TCI_CASE(clz):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = regs[r1] ? clz64(regs[r1]) : regs[r2];
-            break;
-        case INDEX_op_ctz:
+            TCI_NEXT();
+        TCI_CASE(ctz):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = regs[r1] ? ctz64(regs[r1]) : regs[r2];
-            break;
+            TCI_NEXT();
 
             /* Shift/rotate operations (64 bit). */
 
-        case INDEX_op_rotl:
+        TCI_CASE(rotl):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = rol64(regs[r1], regs[r2] & 63);
-            break;
-        case INDEX_op_rotr:
+            TCI_NEXT();
+        TCI_CASE(rotr):
             tci_args_rrr(insn, &r0, &r1, &r2);
             regs[r0] = ror64(regs[r1], regs[r2] & 63);
-            break;
-        case INDEX_op_ext_i32_i64:
+            TCI_NEXT();
+        TCI_CASE(ext_i32_i64):
             tci_args_rr(insn, &r0, &r1);
             regs[r0] = (int32_t)regs[r1];
-            break;
-        case INDEX_op_extu_i32_i64:
+            TCI_NEXT();
+        TCI_CASE(extu_i32_i64):
             tci_args_rr(insn, &r0, &r1);
             regs[r0] = (uint32_t)regs[r1];
-            break;
-        case INDEX_op_bswap64:
+            TCI_NEXT();
+        TCI_CASE(bswap64):
             tci_args_rr(insn, &r0, &r1);
             regs[r0] = bswap64(regs[r1]);
-            break;
+            TCI_NEXT();
 #endif /* TCG_TARGET_REG_BITS == 64 */
 
             /* QEMU specific operations. */
 
-        case INDEX_op_exit_tb:
+        TCI_CASE(exit_tb):
             tci_args_l(insn, tb_ptr, &ptr);
             return (uintptr_t)ptr;
 
-        case INDEX_op_goto_tb:
+        TCI_CASE(goto_tb):
             tci_args_l(insn, tb_ptr, &ptr);
             tb_ptr = *(void **)ptr;
-            break;
+            TCI_NEXT();
 
-        case INDEX_op_goto_ptr:
+        TCI_CASE(goto_ptr):
             tci_args_r(insn, &r0);
             ptr = (void *)regs[r0];
             if (!ptr) {
                 return 0;
             }
             tb_ptr = ptr;
-            break;
+            TCI_NEXT();
 
-        case INDEX_op_qemu_ld:
+        TCI_CASE(qemu_ld):
             tci_args_rrm(insn, &r0, &r1, &oi);
             taddr = regs[r1];
             regs[r0] = tci_qemu_ld(env, taddr, oi, tb_ptr);
-            break;
+            TCI_NEXT();
 
-        case INDEX_op_qemu_st:
+        TCI_CASE(qemu_st):
             tci_args_rrm(insn, &r0, &r1, &oi);
             taddr = regs[r1];
             tci_qemu_st(env, taddr, regs[r0], oi, tb_ptr);
-            break;
+            TCI_NEXT();
 
-        case INDEX_op_qemu_ld2:
+        TCI_CASE(qemu_ld2):
             tcg_debug_assert(TCG_TARGET_REG_BITS == 32);
             tci_args_rrrr(insn, &r0, &r1, &r2, &r3);
             taddr = regs[r2];
             oi = regs[r3];
             tmp64 = tci_qemu_ld(env, taddr, oi, tb_ptr);
             tci_write_reg64(regs, r1, r0, tmp64);
-            break;
+            TCI_NEXT();
 
-        case INDEX_op_qemu_st2:
+        TCI_CASE(qemu_st2):
             tcg_debug_assert(TCG_TARGET_REG_BITS == 32);
             tci_args_rrrr(insn, &r0, &r1, &r2, &r3);
             tmp64 = tci_uint64(regs[r1], regs[r0]);
             taddr = regs[r2];
             oi = regs[r3];
             tci_qemu_st(env, taddr, tmp64, oi, tb_ptr);
-            break;
+            TCI_NEXT();
 
-        case INDEX_op_mb:
+        TCI_CASE(mb):
             /* Ensure ordering for all kinds */
             smp_mb();
-            break;
-        default:
+            TCI_NEXT();
+        TCI_CASE_DEFAULT:
             g_assert_not_reached();
         }
     }
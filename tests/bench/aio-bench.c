@@ -0,0 +1,147 @@
+/*
+ * QEMU AioContext bottom half and coroutine scheduling speed benchmark
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or
+ * (at your option) any later version.  See the COPYING file in the
+ * top-level directory.
+ */
+#include "qemu/osdep.h"
+#include "qapi/error.h"
+#include "block/aio.h"
+#include "qemu/coroutine.h"
+#include "qemu/main-loop.h"
+
+static AioContext *ctx;
+
+static void bench_report(const char *name, double ops)
+{
+    g_test_maximized_result(ops / 1e6 / g_test_timer_last(),
+                            "%-24s %8.2f Mops/sec", name,
+                            ops / 1e6 / g_test_timer_last());
+}
+
+static void bench_bh_cb(void *opaque)
+{
+    uint64_t *count = opaque;
+
+    (*count)++;
+}
+
+/* schedule one persistent BH and run it, like a device completion */
+static void test_bh_schedule(void)
+{
+    uint64_t count = 0;
+    QEMUBH *bh = aio_bh_new(ctx, bench_bh_cb, &count);
+
+    g_test_timer_start();
+    do {
+        qemu_bh_schedule(bh);
+        aio_poll(ctx, false);
+    } while (g_test_timer_elapsed() < 0.5);
+    bench_report("bh schedule+poll", count);
+    qemu_bh_delete(bh);
+}
+
+/* allocate, schedule and free a BH every time */
+static void test_bh_oneshot(void)
+{
+    uint64_t count = 0;
+
+    g_test_timer_start();
+    do {
+        aio_bh_schedule_oneshot(ctx, bench_bh_cb, &count);
+        aio_poll(ctx, false);
+    } while (g_test_timer_elapsed() < 0.5);
+    bench_report("bh oneshot+poll", count);
+}
+
+/* run many BHs per poll, as with a batch of completions */
+static void test_bh_batch(void)
+{
+    uint64_t count = 0;
+    QEMUBH *bhs[64];
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(bhs); i++) {
+        bhs[i] = aio_bh_new(ctx, bench_bh_cb, &count);
+    }
+
+    g_test_timer_start();
+    do {
+        for (i = 0; i < ARRAY_SIZE(bhs); i++) {
+            qemu_bh_schedule(bhs[i]);
+        }
+        aio_poll(ctx, false);
+    } while (g_test_timer_elapsed() < 0.5);
+    bench_report("bh batch64+poll", count);
+
+    for (i = 0; i < ARRAY_SIZE(bhs); i++) {
+        qemu_bh_delete(bhs[i]);
+    }
+}
+
+static void coroutine_fn bench_co_yield(void *opaque)
+{
+    uint64_t *count = opaque;
+
+    for (;;) {
+        (*count)++;
+        qemu_coroutine_yield();
+    }
+}
+
+/* wake a coroutine through aio_co_schedule(), like a request resuming */
+static void test_co_schedule(void)
+{
+    uint64_t count = 0;
+    Coroutine *co = qemu_coroutine_create(bench_co_yield, &count);
+
+    qemu_coroutine_enter(co);
+    count = 0;
+
+    g_test_timer_start();
+    do {
+        aio_co_schedule(ctx, co);
+        aio_poll(ctx, false);
+    } while (g_test_timer_elapsed() < 0.5);
+    bench_report("co schedule+poll", count);
+
+    /* the coroutine never terminates; leak it */
+}
+
+static void coroutine_fn bench_co_empty(void *opaque)
+{
+    uint64_t *count = opaque;
+
+    (*count)++;
+}
+
+/* create and run a coroutine to completion, mostly the pool */
+static void test_co_create_enter(void)
+{
+    uint64_t count = 0;
+
+    g_test_timer_start();
+    do {
+        qemu_coroutine_enter(qemu_coroutine_create(bench_co_empty, &count));
+    } while (g_test_timer_elapsed() < 0.5);
+    bench_report("co create+enter", count);
+}
+
+int main(int argc, char **argv)
+{
+    qemu_init_main_loop(&error_fatal);
+    ctx = qemu_get_aio_context();
+
+    while (g_main_context_iteration(NULL, false)) {
+        /* drain pending events */
+    }
+
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func("/aio/bh/schedule", test_bh_schedule);
+    g_test_add_func("/aio/bh/oneshot", test_bh_oneshot);
+    g_test_add_func("/aio/bh/batch", test_bh_batch);
+    g_test_add_func("/aio/co/schedule", test_co_schedule);
+    g_test_add_func("/aio/co/create-enter", test_co_create_enter);
+    return g_test_run();
+}
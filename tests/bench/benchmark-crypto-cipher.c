@@ -12,12 +12,18 @@
  */
 #include "qemu/osdep.h"
 #include "qemu/units.h"
+#include "qemu/bswap.h"
 #include "crypto/init.h"
 #include "crypto/cipher.h"
 
+/*
+ * With a non-zero @sector_size, each chunk is processed as consecutive
+ * sectors with a plain64 IV each, as the LUKS block layer does.
+ */
 static void test_cipher_speed(size_t chunk_size,
                               QCryptoCipherMode mode,
-                              QCryptoCipherAlgo alg)
+                              QCryptoCipherAlgo alg,
+                              size_t sector_size)
 {
     QCryptoCipher *cipher;
     Error *err = NULL;
@@ -27,6 +33,7 @@ static void test_cipher_speed(size_t chunk_size,
     size_t niv;
     const size_t total = 2 * GiB;
     size_t remain;
+    uint64_t sector = 0;
 
     if (!qcrypto_cipher_supports(alg, mode)) {
         return;
@@ -61,36 +68,66 @@ static void test_cipher_speed(size_t chunk_size,
     g_test_timer_start();
     remain = total;
     while (remain) {
-        g_assert(qcrypto_cipher_encrypt(cipher,
-                                        plaintext,
-                                        ciphertext,
-                                        chunk_size,
-                                        &err) == 0);
+        if (sector_size) {
+            size_t done;
+
+            for (done = 0; done < chunk_size; done += sector_size) {
+                stq_le_p(iv, sector++);
+                g_assert(qcrypto_cipher_setiv(cipher, iv, niv, &err) == 0);
+                g_assert(qcrypto_cipher_encrypt(cipher,
+                                                plaintext + done,
+                                                ciphertext + done,
+                                                sector_size,
+                                                &err) == 0);
+            }
+        } else {
+            g_assert(qcrypto_cipher_encrypt(cipher,
+                                            plaintext,
+                                            ciphertext,
+                                            chunk_size,
+                                            &err) == 0);
+        }
         remain -= chunk_size;
     }
     g_test_timer_elapsed();
 
-    g_test_message("enc(%s-%s) chunk %zu bytes %.2f MB/sec ",
+    g_test_message("enc(%s-%s) chunk %zu bytes sector %zu bytes %.2f MB/sec ",
                    QCryptoCipherAlgo_str(alg),
                    QCryptoCipherMode_str(mode),
-                   chunk_size, (double)total / MiB / g_test_timer_last());
+                   chunk_size, sector_size,
+                   (double)total / MiB / g_test_timer_last());
 
     g_test_timer_start();
     remain = total;
     while (remain) {
-        g_assert(qcrypto_cipher_decrypt(cipher,
-                                        plaintext,
-                                        ciphertext,
-                                        chunk_size,
-                                        &err) == 0);
+        if (sector_size) {
+            size_t done;
+
+            for (done = 0; done < chunk_size; done += sector_size) {
+                stq_le_p(iv, sector++);
+                g_assert(qcrypto_cipher_setiv(cipher, iv, niv, &err) == 0);
+                g_assert(qcrypto_cipher_decrypt(cipher,
+                                                plaintext + done,
+                                                ciphertext + done,
+                                                sector_size,
+                                                &err) == 0);
+            }
+        } else {
+            g_assert(qcrypto_cipher_decrypt(cipher,
+                                            plaintext,
+                                            ciphertext,
+                                            chunk_size,
+                                            &err) == 0);
+        }
         remain -= chunk_size;
     }
     g_test_timer_elapsed();
 
-    g_test_message("dec(%s-%s) chunk %zu bytes %.2f MB/sec ",
+    g_test_message("dec(%s-%s) chunk %zu bytes sector %zu bytes %.2f MB/sec ",
                    QCryptoCipherAlgo_str(alg),
                    QCryptoCipherMode_str(mode),
-                   chunk_size, (double)total / MiB / g_test_timer_last());
+                   chunk_size, sector_size,
+                   (double)total / MiB / g_test_timer_last());
 
     qcrypto_cipher_free(cipher);
     g_free(plaintext);
@@ -105,7 +142,7 @@ static void test_cipher_speed_ecb_aes_128(const void *opaque)
     size_t chunk_size = (size_t)opaque;
     test_cipher_speed(chunk_size,
                       QCRYPTO_CIPHER_MODE_ECB,
-                      QCRYPTO_CIPHER_ALGO_AES_128);
+                      QCRYPTO_CIPHER_ALGO_AES_128, 0);
 }
 
 static void test_cipher_speed_ecb_aes_256(const void *opaque)
@@ -113,7 +150,7 @@ static void test_cipher_speed_ecb_aes_256(const void *opaque)
     size_t chunk_size = (size_t)opaque;
     test_cipher_speed(chunk_size,
                       QCRYPTO_CIPHER_MODE_ECB,
-                      QCRYPTO_CIPHER_ALGO_AES_256);
+                      QCRYPTO_CIPHER_ALGO_AES_256, 0);
 }
 
 static void test_cipher_speed_cbc_aes_128(const void *opaque)
@@ -121,7 +158,7 @@ static void test_cipher_speed_cbc_aes_128(const void *opaque)
     size_t chunk_size = (size_t)opaque;
     test_cipher_speed(chunk_size,
                       QCRYPTO_CIPHER_MODE_CBC,
-                      QCRYPTO_CIPHER_ALGO_AES_128);
+                      QCRYPTO_CIPHER_ALGO_AES_128, 0);
 }
 
 static void test_cipher_speed_cbc_aes_256(const void *opaque)
@@ -129,7 +166,7 @@ static void test_cipher_speed_cbc_aes_256(const void *opaque)
     size_t chunk_size = (size_t)opaque;
     test_cipher_speed(chunk_size,
                       QCRYPTO_CIPHER_MODE_CBC,
-                      QCRYPTO_CIPHER_ALGO_AES_256);
+                      QCRYPTO_CIPHER_ALGO_AES_256, 0);
 }
 
 static void test_cipher_speed_ctr_aes_128(const void *opaque)
@@ -137,7 +174,7 @@ static void test_cipher_speed_ctr_aes_128(const void *opaque)
     size_t chunk_size = (size_t)opaque;
     test_cipher_speed(chunk_size,
                       QCRYPTO_CIPHER_MODE_CTR,
-                      QCRYPTO_CIPHER_ALGO_AES_128);
+                      QCRYPTO_CIPHER_ALGO_AES_128, 0);
 }
 
 static void test_cipher_speed_ctr_aes_256(const void *opaque)
@@ -145,7 +182,7 @@ static void test_cipher_speed_ctr_aes_256(const void *opaque)
     size_t chunk_size = (size_t)opaque;
     test_cipher_speed(chunk_size,
                       QCRYPTO_CIPHER_MODE_CTR,
-                      QCRYPTO_CIPHER_ALGO_AES_256);
+                      QCRYPTO_CIPHER_ALGO_AES_256, 0);
 }
 
 static void test_cipher_speed_xts_aes_128(const void *opaque)
@@ -153,7 +190,7 @@ static void test_cipher_speed_xts_aes_128(const void *opaque)
     size_t chunk_size = (size_t)opaque;
     test_cipher_speed(chunk_size,
                       QCRYPTO_CIPHER_MODE_XTS,
-                      QCRYPTO_CIPHER_ALGO_AES_128);
+                      QCRYPTO_CIPHER_ALGO_AES_128, 0);
 }
 
 static void test_cipher_speed_xts_aes_256(const void *opaque)
@@ -161,7 +198,23 @@ static void test_cipher_speed_xts_aes_256(const void *opaque)
     size_t chunk_size = (size_t)opaque;
     test_cipher_speed(chunk_size,
                       QCRYPTO_CIPHER_MODE_XTS,
-                      QCRYPTO_CIPHER_ALGO_AES_256);
+                      QCRYPTO_CIPHER_ALGO_AES_256, 0);
+}
+
+static void test_cipher_speed_xtssec_aes_128(const void *opaque)
+{
+    size_t chunk_size = (size_t)opaque;
+    test_cipher_speed(chunk_size,
+                      QCRYPTO_CIPHER_MODE_XTS,
+                      QCRYPTO_CIPHER_ALGO_AES_128, 512);
+}
+
+static void test_cipher_speed_xtssec_aes_256(const void *opaque)
+{
+    size_t chunk_size = (size_t)opaque;
+    test_cipher_speed(chunk_size,
+                      QCRYPTO_CIPHER_MODE_XTS,
+                      QCRYPTO_CIPHER_ALGO_AES_256, 512);
 }
 
 
@@ -197,6 +250,8 @@ int main(int argc, char **argv)
         ADD_TEST(ctr, aes, 256, chunk);         \
         ADD_TEST(xts, aes, 128, chunk);         \
         ADD_TEST(xts, aes, 256, chunk);         \
+        ADD_TEST(xtssec, aes, 128, chunk);      \
+        ADD_TEST(xtssec, aes, 256, chunk);      \
     } while (0)
 
     ADD_TESTS(512);
@@ -0,0 +1,122 @@
+/*
+ * QEMU HBitmap scanning speed benchmark
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or
+ * (at your option) any later version.  See the COPYING file in the
+ * top-level directory.
+ */
+#include "qemu/osdep.h"
+#include "qemu/hbitmap.h"
+#include "qemu/units.h"
+
+/* A 1 TiB disk tracked with 64 KiB granularity, as for a dirty bitmap */
+#define BENCH_SIZE          (1 * TiB)
+#define BENCH_GRANULARITY   16
+#define BENCH_CLUSTER       (1ULL << BENCH_GRANULARITY)
+
+typedef struct BenchPattern {
+    const char *name;
+    /* set one cluster in every @stride, @run clusters at a time */
+    uint64_t stride;
+    uint64_t run;
+} BenchPattern;
+
+static const BenchPattern patterns[] = {
+    { "sparse", 4096, 1 },
+    { "medium", 64, 8 },
+    { "dense", 1024, 1000 },
+    { "full", 1, 1 },
+};
+
+static HBitmap *bench_alloc(const BenchPattern *p)
+{
+    HBitmap *hb = hbitmap_alloc(BENCH_SIZE, BENCH_GRANULARITY);
+    uint64_t pos;
+
+    for (pos = 0; pos < BENCH_SIZE; pos += p->stride * BENCH_CLUSTER) {
+        hbitmap_set(hb, pos, MIN(p->run * BENCH_CLUSTER, BENCH_SIZE - pos));
+    }
+    return hb;
+}
+
+static void test_next_dirty_area(const void *opaque)
+{
+    const BenchPattern *p = opaque;
+    HBitmap *hb = bench_alloc(p);
+    double total = 0;
+
+    g_test_timer_start();
+    do {
+        int64_t start = 0, dirty_start, dirty_count;
+
+        while (hbitmap_next_dirty_area(hb, start, BENCH_SIZE, INT64_MAX,
+                                       &dirty_start, &dirty_count)) {
+            start = dirty_start + dirty_count;
+        }
+        total += BENCH_SIZE;
+    } while (g_test_timer_elapsed() < 0.5);
+
+    g_test_message("%-6s next_dirty_area: %10.0f GiB/sec", p->name,
+                   total / GiB / g_test_timer_last());
+    hbitmap_free(hb);
+}
+
+static void test_count_range(const void *opaque)
+{
+    const BenchPattern *p = opaque;
+    HBitmap *hb = bench_alloc(p);
+    double total = 0;
+
+    g_test_timer_start();
+    do {
+        g_assert_cmpint(hbitmap_count_range(hb, 0, BENCH_SIZE), ==,
+                        hbitmap_count(hb));
+        total += BENCH_SIZE;
+    } while (g_test_timer_elapsed() < 0.5);
+
+    g_test_message("%-6s count_range:     %10.0f GiB/sec", p->name,
+                   total / GiB / g_test_timer_last());
+    hbitmap_free(hb);
+}
+
+static void test_serialize(const void *opaque)
+{
+    const BenchPattern *p = opaque;
+    HBitmap *hb = bench_alloc(p);
+    uint64_t len = hbitmap_serialization_size(hb, 0, BENCH_SIZE);
+    uint8_t *buf = g_malloc(len);
+    double total = 0;
+
+    g_test_timer_start();
+    do {
+        hbitmap_serialize_part(hb, buf, 0, BENCH_SIZE);
+        hbitmap_deserialize_part(hb, buf, 0, BENCH_SIZE, true);
+        total += BENCH_SIZE;
+    } while (g_test_timer_elapsed() < 0.5);
+
+    g_test_message("%-6s serialize:       %10.0f GiB/sec", p->name,
+                   total / GiB / g_test_timer_last());
+    g_free(buf);
+    hbitmap_free(hb);
+}
+
+int main(int argc, char **argv)
+{
+    int i;
+
+    g_test_init(&argc, &argv, NULL);
+    for (i = 0; i < ARRAY_SIZE(patterns); i++) {
+        const BenchPattern *p = &patterns[i];
+        g_autofree char *area = g_strdup_printf("/hbitmap/next_dirty_area/%s",
+                                                p->name);
+        g_autofree char *count = g_strdup_printf("/hbitmap/count_range/%s",
+                                                 p->name);
+        g_autofree char *ser = g_strdup_printf("/hbitmap/serialize/%s",
+                                               p->name);
+
+        g_test_add_data_func(area, p, test_next_dirty_area);
+        g_test_add_data_func(count, p, test_count_range);
+        g_test_add_data_func(ser, p, test_serialize);
+    }
+    return g_test_run();
+}
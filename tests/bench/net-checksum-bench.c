@@ -0,0 +1,48 @@
+/*
+ * QEMU Internet checksum speed benchmark
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or
+ * (at your option) any later version.  See the COPYING file in the
+ * top-level directory.
+ */
+#include "qemu/osdep.h"
+#include "qemu/units.h"
+#include "net/checksum.h"
+
+static void test(const void *opaque)
+{
+    size_t max = 64 * KiB;
+    uint8_t *buf = g_malloc(max);
+    int accel_index = 0;
+
+    memset(buf, 0x5a, max);
+
+    do {
+        if (accel_index != 0) {
+            g_test_message("%s", "");  /* gnu_printf Werror for simple "" */
+        }
+        for (size_t len = 64; len <= max; len *= 4) {
+            double total = 0.0;
+
+            g_test_timer_start();
+            do {
+                net_checksum_add(len, buf);
+                total += len;
+            } while (g_test_timer_elapsed() < 0.5);
+
+            total /= MiB;
+            g_test_message("net_checksum_add #%d: %6zu bytes %8.0f MB/sec",
+                           accel_index, len, total / g_test_timer_last());
+        }
+        accel_index++;
+    } while (test_net_checksum_next_accel());
+
+    g_free(buf);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_data_func("/net/checksum/speed", NULL, test);
+    return g_test_run();
+}
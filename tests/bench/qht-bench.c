@@ -11,6 +11,7 @@
 #include "qemu/rcu.h"
 #include "qemu/xxhash.h"
 #include "qemu/memalign.h"
+#include "qemu/timer.h"
 
 struct thread_stats {
     size_t rd;
@@ -21,6 +22,7 @@ struct thread_stats {
     size_t not_rm;
     size_t rz;
     size_t not_rz;
+    int64_t max_in_ns;
 };
 
 struct thread_info {
@@ -61,6 +63,7 @@ static double resize_rate; /* 0.0 to 1.0 */
 static unsigned int n_rz_threads = 1;
 static QemuThread *rz_threads;
 static bool precompute_hash;
+static bool grow_under_load;
 
 static double update_rate; /* 0.0 to 1.0 */
 static uint64_t update_threshold;
@@ -93,7 +96,10 @@ static const char commands_string[] =
     " -R = enable auto-resize\n"
     " -S = resize rate (0.0 to 100.0)\n"
     " -D = delay (in us) between potential resizes\n"
-    " -N = number of resize threads";
+    " -N = number of resize threads\n"
+    "\n"
+    " -G = grow under load: start from an empty table with auto-resize\n"
+    "      and report the worst insertion latency (default -u: 100.0)";
 
 static void usage_complete(int argc, char *argv[])
 {
@@ -181,7 +187,12 @@ static void do_rw(struct thread_info *info)
             bool written = false;
 
             if (qht_lookup(&ht, p, hash) == NULL) {
+                int64_t t0 = grow_under_load ? get_clock() : 0;
+
                 written = qht_insert(&ht, p, hash, NULL);
+                if (grow_under_load) {
+                    stats->max_in_ns = MAX(stats->max_in_ns, get_clock() - t0);
+                }
             }
             if (written) {
                 stats->in++;
@@ -276,6 +287,7 @@ static void pr_params(void)
     printf(" initial size hint: %zu\n", qht_n_elems);
     printf(" auto-resize:       %s\n",
            qht_mode & QHT_MODE_AUTO_RESIZE ? "on" : "off");
+    printf(" grow under load:   %s\n", grow_under_load ? "on" : "off");
     if (resize_rate) {
         printf(" resize_rate:       %f%%\n", resize_rate * 100.0);
         printf(" resize range:      %zu-%zu\n", resize_min, resize_max);
@@ -330,6 +342,15 @@ static void htable_init(void)
     /* some sanity checks */
     g_assert_cmpuint(lookup_range, <=, n);
 
+    if (grow_under_load) {
+        qht_mode |= QHT_MODE_AUTO_RESIZE;
+        qht_n_elems = 1;
+        init_size = 0;
+        if (!update_rate) {
+            update_rate = 1.0;
+        }
+    }
+
     /* compute thresholds */
     do_threshold(update_rate, &update_threshold);
     do_threshold(resize_rate, &resize_threshold);
@@ -384,6 +405,8 @@ static void add_stats(struct thread_stats *s, struct thread_info *info, int n)
 
         s->rz += stats->rz;
         s->not_rz += stats->not_rz;
+
+        s->max_in_ns = MAX(s->max_in_ns, stats->max_in_ns);
     }
 }
 
@@ -410,6 +433,9 @@ static void pr_stats(void)
            (double)s.in / 1e6,
            (double)s.in / (s.in + s.not_in) * 100,
            (double)(s.in + s.not_in) / 1e6);
+    if (grow_under_load) {
+        printf(" Max insert lat.:   %.2f us\n", (double)s.max_in_ns / 1e3);
+    }
     printf(" Removed:           %.2f M (%.2f%% of %.2fM)\n",
            (double)s.rm / 1e6,
            (double)s.rm / (s.rm + s.not_rm) * 100,
@@ -445,7 +471,7 @@ static void parse_args(int argc, char *argv[])
     int c;
 
     for (;;) {
-        c = getopt(argc, argv, "d:D:g:k:K:l:hn:N:o:pr:Rs:S:u:");
+        c = getopt(argc, argv, "d:D:g:Gk:K:l:hn:N:o:pr:Rs:S:u:");
         if (c < 0) {
             break;
         }
@@ -463,6 +489,9 @@ static void parse_args(int argc, char *argv[])
             qht_n_elems = atol(optarg);
             init_size = atol(optarg);
             break;
+        case 'G':
+            grow_under_load = true;
+            break;
         case 'h':
             usage_complete(argc, argv);
             exit(0);
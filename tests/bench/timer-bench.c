@@ -0,0 +1,89 @@
+/*
+ * QEMU timer list speed benchmark
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or
+ * (at your option) any later version.  See the COPYING file in the
+ * top-level directory.
+ */
+#include "qemu/osdep.h"
+#include "qemu/timer.h"
+
+static void timer_bench_cb(void *opaque)
+{
+}
+
+static void timer_bench_notify_cb(void *opaque, QEMUClockType type)
+{
+}
+
+static uint64_t xorshift64star(uint64_t x)
+{
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    return x * UINT64_C(2685821657736338717);
+}
+
+static void test(const void *opaque)
+{
+    size_t n_timers = GPOINTER_TO_SIZE(opaque);
+    QEMUTimerListGroup tlg;
+    QEMUTimer *timers = g_new0(QEMUTimer, n_timers);
+    uint64_t r = 1;
+    double ops;
+    size_t i;
+
+    timerlistgroup_init(&tlg, timer_bench_notify_cb, NULL);
+    for (i = 0; i < n_timers; i++) {
+        timer_init_full(&timers[i], &tlg, QEMU_CLOCK_VIRTUAL, SCALE_NS, 0,
+                        timer_bench_cb, NULL);
+        r = xorshift64star(r);
+        timer_mod_ns(&timers[i], r % (NANOSECONDS_PER_SECOND * 10));
+    }
+
+    /* re-arm random timers to random deadlines */
+    ops = 0;
+    g_test_timer_start();
+    do {
+        r = xorshift64star(r);
+        timer_mod_ns(&timers[r % n_timers],
+                     (r >> 32) % (NANOSECONDS_PER_SECOND * 10));
+        ops++;
+    } while (g_test_timer_elapsed() < 0.5);
+    g_test_message("%7zu timers: timer_mod %8.2f Mops/sec", n_timers,
+                   ops / 1e6 / g_test_timer_last());
+
+    /* cancel and re-arm random timers */
+    ops = 0;
+    g_test_timer_start();
+    do {
+        QEMUTimer *ts;
+
+        r = xorshift64star(r);
+        ts = &timers[r % n_timers];
+        timer_del(ts);
+        timer_mod_ns(ts, (r >> 32) % (NANOSECONDS_PER_SECOND * 10));
+        ops += 2;
+    } while (g_test_timer_elapsed() < 0.5);
+    g_test_message("%7zu timers: timer_del+timer_mod %8.2f Mops/sec",
+                   n_timers, ops / 1e6 / g_test_timer_last());
+
+    for (i = 0; i < n_timers; i++) {
+        timer_del(&timers[i]);
+    }
+    timerlistgroup_deinit(&tlg);
+    g_free(timers);
+}
+
+int main(int argc, char **argv)
+{
+    size_t n_timers;
+
+    g_test_init(&argc, &argv, NULL);
+    for (n_timers = 16; n_timers <= 16384; n_timers *= 4) {
+        g_autofree char *path = g_strdup_printf("/timer/mod/%zu", n_timers);
+
+        g_test_add_data_func(path, GSIZE_TO_POINTER(n_timers), test);
+    }
+    return g_test_run();
+}
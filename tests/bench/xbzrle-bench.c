@@ -0,0 +1,95 @@
+/*
+ * XBZRLE encoder speed benchmark
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or
+ * (at your option) any later version.  See the COPYING file in the
+ * top-level directory.
+ */
+#include "qemu/osdep.h"
+#include "qemu/units.h"
+#include "../../migration/xbzrle.h"
+
+#define XBZRLE_PAGE_SIZE 4096
+
+typedef struct {
+    const char *name;
+    /* Number of runs of changed bytes, and length of each run */
+    int runs;
+    int run_len;
+} XbzrleBenchPattern;
+
+static const XbzrleBenchPattern patterns[] = {
+    { "unchanged", 0, 0 },
+    { "counters", 8, 4 },
+    { "short runs", 64, 8 },
+    { "dense", 256, 8 },
+};
+
+static void bench_pattern(int accel_index, const XbzrleBenchPattern *pat,
+                          uint8_t *old, uint8_t *new, uint8_t *dst)
+{
+    double total = 0.0;
+    int i, j, dlen;
+
+    memcpy(new, old, XBZRLE_PAGE_SIZE);
+    for (i = 0; i < pat->runs; i++) {
+        int start = g_test_rand_int_range(0, XBZRLE_PAGE_SIZE - pat->run_len);
+
+        for (j = 0; j < pat->run_len; j++) {
+            new[start + j] ^= 0xff;
+        }
+    }
+
+    g_test_timer_start();
+    do {
+        dlen = xbzrle_encode_buffer(old, new, XBZRLE_PAGE_SIZE,
+                                    dst, XBZRLE_PAGE_SIZE);
+        total += XBZRLE_PAGE_SIZE;
+    } while (g_test_timer_elapsed() < 0.5);
+
+    total /= MiB;
+    if (dlen < 0) {
+        g_test_message("xbzrle_encode_buffer #%d: %-10s %8.0f MB/sec, "
+                       "overflow", accel_index, pat->name,
+                       total / g_test_timer_last());
+    } else {
+        g_test_message("xbzrle_encode_buffer #%d: %-10s %8.0f MB/sec, "
+                       "%4d bytes (%.1f%%)", accel_index, pat->name,
+                       total / g_test_timer_last(), dlen,
+                       dlen * 100.0 / XBZRLE_PAGE_SIZE);
+    }
+}
+
+static void test(const void *opaque)
+{
+    uint8_t *old = g_malloc(XBZRLE_PAGE_SIZE);
+    uint8_t *new = g_malloc(XBZRLE_PAGE_SIZE);
+    uint8_t *dst = g_malloc(XBZRLE_PAGE_SIZE);
+    int accel_index = 0;
+    int i;
+
+    for (i = 0; i < XBZRLE_PAGE_SIZE; i++) {
+        old[i] = g_test_rand_int();
+    }
+
+    do {
+        if (accel_index != 0) {
+            g_test_message("%s", "");  /* gnu_printf Werror for simple "" */
+        }
+        for (i = 0; i < ARRAY_SIZE(patterns); i++) {
+            bench_pattern(accel_index, &patterns[i], old, new, dst);
+        }
+        accel_index++;
+    } while (test_xbzrle_encode_next_accel());
+
+    g_free(old);
+    g_free(new);
+    g_free(dst);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_data_func("/xbzrle/speed", NULL, test);
+    return g_test_run();
+}
@@ -169,6 +169,39 @@ static void test_multifd_file_mapped_ram(void)
     test_file_common(&args, true);
 }
 
+static void test_multifd_file_mapped_ram_lazy(void)
+{
+    g_autofree char *uri = g_strdup_printf("file:%s/%s", tmpfs,
+                                           FILE_TEST_FILENAME);
+    MigrateCommon args = {
+        .connect_uri = uri,
+        .listen_uri = "defer",
+        .start = {
+            .caps[MIGRATION_CAPABILITY_MULTIFD] = true,
+            .caps[MIGRATION_CAPABILITY_MAPPED_RAM] = true,
+            .caps[MIGRATION_CAPABILITY_MAPPED_RAM_LAZY] = true,
+        },
+    };
+
+    test_file_common(&args, true);
+}
+
+static void test_file_mapped_ram_mmap(void)
+{
+    g_autofree char *uri = g_strdup_printf("file:%s/%s", tmpfs,
+                                           FILE_TEST_FILENAME);
+    MigrateCommon args = {
+        .connect_uri = uri,
+        .listen_uri = "defer",
+        .start = {
+            .caps[MIGRATION_CAPABILITY_MAPPED_RAM] = true,
+            .caps[MIGRATION_CAPABILITY_MAPPED_RAM_MMAP] = true,
+        },
+    };
+
+    test_file_common(&args, true);
+}
+
 static void *migrate_hook_start_multifd_mapped_ram_dio(QTestState *from,
                                                        QTestState *to)
 {
@@ -331,6 +364,14 @@ void migration_test_add_file(MigrationTestEnv *env)
                        test_multifd_file_mapped_ram);
     migration_test_add("/migration/multifd/file/mapped-ram/live",
                        test_multifd_file_mapped_ram_live);
+    if (env->has_uffd) {
+        migration_test_add("/migration/multifd/file/mapped-ram/lazy",
+                           test_multifd_file_mapped_ram_lazy);
+    }
+#ifdef __linux__
+    migration_test_add("/migration/file/mapped-ram/mmap",
+                       test_file_mapped_ram_mmap);
+#endif
 
 #ifndef _WIN32
     migration_test_add("/migration/multifd/file/mapped-ram/fdset",
@@ -363,6 +363,7 @@ void read_blocktime(QTestState *who)
     g_assert(qdict_haskey(rsp_return, "postcopy-latency-dist"));
     g_assert(qdict_haskey(rsp_return, "postcopy-vcpu-latency"));
     g_assert(qdict_haskey(rsp_return, "postcopy-non-vcpu-latency"));
+    g_assert(qdict_haskey(rsp_return, "postcopy-vcpu-latency-dist"));
     qobject_unref(rsp_return);
 }
 
@@ -13,6 +13,7 @@
 #include "qemu/osdep.h"
 #include "libqtest.h"
 #include "migration/framework.h"
+#include "migration/migration-qmp.h"
 #include "migration/migration-util.h"
 #include "qobject/qlist.h"
 #include "qemu/module.h"
@@ -72,6 +73,22 @@ static void test_postcopy_recovery_fail_reconnect(void)
     test_postcopy_recovery_common(&args);
 }
 
+static void *migrate_hook_start_postcopy_fault_threads(QTestState *from,
+                                                       QTestState *to)
+{
+    migrate_set_parameter_int(to, "postcopy-fault-threads", 4);
+    return NULL;
+}
+
+static void test_postcopy_recovery_fault_threads(void)
+{
+    MigrateCommon args = {
+        .start_hook = migrate_hook_start_postcopy_fault_threads,
+    };
+
+    test_postcopy_recovery_common(&args);
+}
+
 static void test_postcopy_preempt_recovery(void)
 {
     MigrateCommon args = {
@@ -129,6 +146,9 @@ void migration_test_add_postcopy(MigrationTestEnv *env)
         migration_test_add("/migration/postcopy/preempt/recovery/plain",
                            test_postcopy_preempt_recovery);
 
+        migration_test_add("/migration/postcopy/recovery/fault-threads",
+                           test_postcopy_recovery_fault_threads);
+
         migration_test_add(
             "/migration/postcopy/recovery/double-failures/handshake",
             test_postcopy_recovery_fail_handshake);
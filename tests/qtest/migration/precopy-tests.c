@@ -233,6 +233,25 @@ static void test_precopy_tcp_switchover_ack(void)
     test_precopy_common(&args);
 }
 
+static void *migrate_hook_start_predictive_switchover(QTestState *from,
+                                                     QTestState *to)
+{
+    migrate_set_parameter_bool(from, "predictive-switchover", true);
+    return NULL;
+}
+
+static void test_precopy_tcp_predictive_switchover(void)
+{
+    MigrateCommon args = {
+        .listen_uri = "tcp:127.0.0.1:0",
+        .start_hook = migrate_hook_start_predictive_switchover,
+        /* The guest must dirty memory for the model to have inputs */
+        .live = true,
+    };
+
+    test_precopy_common(&args);
+}
+
 #ifndef _WIN32
 static void *migrate_hook_start_fd(QTestState *from,
                                    QTestState *to)
@@ -1236,6 +1255,53 @@ static void test_dirty_limit(void)
     migrate_end(from, to, true);
 }
 
+/*
+ * Check that vcpu-dirty-limit-auto derives the limit from the bandwidth,
+ * and never goes below vcpu-dirty-limit.  Slow for the same reasons as
+ * test_dirty_limit().
+ */
+static void test_dirty_limit_auto(void)
+{
+    g_autofree char *uri = g_strdup_printf("unix:%s/migsocket", tmpfs);
+    QTestState *from, *to;
+    uint64_t throttle_us_per_full = 0;
+    const int64_t dirtylimit_period = 1000, dirtylimit_value = 1;
+    MigrateCommon args = {
+        .start = {
+            .hide_stderr = true,
+            .use_dirty_ring = true,
+        },
+        .listen_uri = uri,
+        .connect_uri = uri,
+    };
+
+    if (migrate_start(&from, &to, args.listen_uri, &args.start)) {
+        return;
+    }
+
+    migrate_set_parameter_bool(from, "vcpu-dirty-limit-auto", true);
+    migrate_dirty_limit_wait_showup(from, dirtylimit_period, dirtylimit_value);
+
+    migrate_qmp(from, to, args.connect_uri, NULL, "{}");
+
+    while (throttle_us_per_full == 0) {
+        throttle_us_per_full =
+            read_migrate_property_int(from,
+                                      "dirty-limit-throttle-time-per-round");
+        usleep(100);
+        g_assert_false(get_src()->stop_seen);
+    }
+
+    g_assert_cmpint(get_limit_rate(from), >=, dirtylimit_value);
+
+    migrate_cancel(from);
+    wait_for_migration_status(from, "cancelled", NULL);
+
+    migration_event_wait(to, "failed");
+    qtest_set_expected_status(to, EXIT_FAILURE);
+    migrate_end(from, to, false);
+}
+
 static void migration_test_add_precopy_smoke(MigrationTestEnv *env)
 {
     if (env->is_x86) {
@@ -1278,6 +1344,8 @@ void migration_test_add_precopy(MigrationTestEnv *env)
 
     migration_test_add("/migration/precopy/tcp/plain/switchover-ack",
                        test_precopy_tcp_switchover_ack);
+    migration_test_add("/migration/precopy/tcp/plain/predictive-switchover",
+                       test_precopy_tcp_predictive_switchover);
 
 #ifndef _WIN32
     migration_test_add("/migration/precopy/fd/tcp",
@@ -1296,6 +1364,8 @@ void migration_test_add_precopy(MigrationTestEnv *env)
             env->has_kvm && env->has_dirty_ring) {
             migration_test_add("/dirty_limit",
                                test_dirty_limit);
+            migration_test_add("/dirty_limit/auto",
+                               test_dirty_limit_auto);
         }
     }
     migration_test_add("/migration/multifd/tcp/channels/plain/none",
@@ -49,6 +49,11 @@ static struct qemu_plugin_scoreboard *data;
 static qemu_plugin_u64 data_insn;
 static qemu_plugin_u64 data_tb;
 static qemu_plugin_u64 data_mem;
+static struct qemu_plugin_scoreboard *tb_trace;
+static qemu_plugin_u64 tb_trace_count;
+static struct qemu_plugin_scoreboard *mem_trace;
+static qemu_plugin_u64 mem_trace_count;
+static const size_t trace_entries = 16;
 
 static uint64_t global_count_tb;
 static uint64_t global_count_insn;
@@ -142,6 +147,8 @@ static void plugin_exit(qemu_plugin_id_t id, void *udata)
             qemu_plugin_u64_get(insn_cond_num_trigger, i);
         const uint64_t insn_cond_left =
             qemu_plugin_u64_get(insn_cond_track_count, i);
+        const uint64_t tb_traced = qemu_plugin_u64_get(tb_trace_count, i);
+        const uint64_t mem_traced = qemu_plugin_u64_get(mem_trace_count, i);
         g_string_printf(stats, "cpu %d: tb (%" PRIu64 ", %" PRIu64
                         ", %" PRIu64 " * %" PRIu64 " + %" PRIu64
                         ") | "
@@ -164,6 +171,8 @@ static void plugin_exit(qemu_plugin_id_t id, void *udata)
         g_assert(tb_cond_left == tb % cond_trigger_limit);
         g_assert(insn_cond_trigger == insn / cond_trigger_limit);
         g_assert(insn_cond_left == insn % cond_trigger_limit);
+        g_assert(tb_traced == tb);
+        g_assert(mem_traced == mem);
     }
 
     stats_tb();
@@ -172,12 +181,26 @@ static void plugin_exit(qemu_plugin_id_t id, void *udata)
 
     qemu_plugin_scoreboard_free(counts);
     qemu_plugin_scoreboard_free(data);
+    qemu_plugin_scoreboard_free(tb_trace);
+    qemu_plugin_scoreboard_free(mem_trace);
+}
+
+/* The inline record registered before the callback must be the last one */
+static uint64_t last_record(struct qemu_plugin_scoreboard *trace,
+                            qemu_plugin_u64 count, unsigned int cpu_index)
+{
+    uint64_t n = qemu_plugin_u64_get(count, cpu_index);
+
+    g_assert(n > 0);
+    return qemu_plugin_trace_buffer_get(trace, cpu_index, n - 1);
 }
 
 static void vcpu_tb_exec(unsigned int cpu_index, void *udata)
 {
     qemu_plugin_u64_add(count_tb, cpu_index, 1);
     g_assert(qemu_plugin_u64_get(data_tb, cpu_index) == (uintptr_t) udata);
+    g_assert(last_record(tb_trace, tb_trace_count, cpu_index) ==
+             (uintptr_t) udata);
     g_mutex_lock(&tb_lock);
     max_cpu_index = MAX(max_cpu_index, cpu_index);
     global_count_tb++;
@@ -218,6 +241,7 @@ static void vcpu_mem_access(unsigned int cpu_index,
 {
     qemu_plugin_u64_add(count_mem, cpu_index, 1);
     g_assert(qemu_plugin_u64_get(data_mem, cpu_index) == (uintptr_t) udata);
+    g_assert(last_record(mem_trace, mem_trace_count, cpu_index) == vaddr);
     g_mutex_lock(&mem_lock);
     global_count_mem++;
     g_mutex_unlock(&mem_lock);
@@ -228,6 +252,9 @@ static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
     void *tb_store = tb;
     qemu_plugin_register_vcpu_tb_exec_inline_per_vcpu(
         tb, QEMU_PLUGIN_INLINE_STORE_U64, data_tb, (uintptr_t) tb_store);
+    qemu_plugin_register_vcpu_tb_exec_inline_per_vcpu(
+        tb, QEMU_PLUGIN_INLINE_RECORD_U64, tb_trace_count,
+        (uintptr_t) tb_store);
     qemu_plugin_register_vcpu_tb_exec_cb(
         tb, vcpu_tb_exec, QEMU_PLUGIN_CB_NO_REGS, tb_store);
     qemu_plugin_register_vcpu_tb_exec_inline_per_vcpu(
@@ -263,6 +290,10 @@ static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
             insn, QEMU_PLUGIN_MEM_RW,
             QEMU_PLUGIN_INLINE_STORE_U64,
             data_mem, (uintptr_t) mem_store);
+        qemu_plugin_register_vcpu_mem_inline_per_vcpu(
+            insn, QEMU_PLUGIN_MEM_RW,
+            QEMU_PLUGIN_INLINE_RECORD_VADDR,
+            mem_trace_count, 0);
         qemu_plugin_register_vcpu_mem_cb(insn, &vcpu_mem_access,
                                          QEMU_PLUGIN_CB_NO_REGS,
                                          QEMU_PLUGIN_MEM_RW, mem_store);
@@ -302,6 +333,10 @@ int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
     data_insn = qemu_plugin_scoreboard_u64_in_struct(data, CPUData, data_insn);
     data_tb = qemu_plugin_scoreboard_u64_in_struct(data, CPUData, data_tb);
     data_mem = qemu_plugin_scoreboard_u64_in_struct(data, CPUData, data_mem);
+    tb_trace = qemu_plugin_trace_buffer_new(trace_entries);
+    tb_trace_count = qemu_plugin_scoreboard_u64(tb_trace);
+    mem_trace = qemu_plugin_trace_buffer_new(trace_entries);
+    mem_trace_count = qemu_plugin_scoreboard_u64(mem_trace);
 
     qemu_plugin_register_vcpu_tb_trans_cb(id, vcpu_tb_trans);
     qemu_plugin_register_atexit_cb(id, plugin_exit, NULL);
@@ -800,6 +800,8 @@ static void int_number(void)
         { "1", 1 },
         { "-32", -32 },
         { "-0", 0, "0" },
+        { "9223372036854775807", INT64_MAX },
+        { "-9223372036854775808", INT64_MIN },
         {},
     };
     int i;
@@ -415,6 +415,27 @@ static void test_hbitmap_granularity(TestHBitmapData *data,
     g_assert_cmpint(hbitmap_count(data->hb), ==, 2);
 }
 
+static void test_hbitmap_count_range(TestHBitmapData *data,
+                                     const void *unused)
+{
+    hbitmap_test_init(data, L3, 1);
+    g_assert_cmpint(hbitmap_count_range(data->hb, 0, L3), ==, 0);
+
+    hbitmap_test_set(data, 0, 4);
+    hbitmap_test_set(data, L2 + 3, 1);
+    hbitmap_test_set(data, L3 - L1, L1);
+    g_assert_cmpint(hbitmap_count_range(data->hb, 0, L3), ==,
+                    hbitmap_count(data->hb));
+    g_assert_cmpint(hbitmap_count_range(data->hb, 0, 0), ==, 0);
+    g_assert_cmpint(hbitmap_count_range(data->hb, 1, 1), ==, 2);
+    g_assert_cmpint(hbitmap_count_range(data->hb, 1, 2), ==, 4);
+    g_assert_cmpint(hbitmap_count_range(data->hb, 3, L2), ==, 4);
+    g_assert_cmpint(hbitmap_count_range(data->hb, L2 + 3, 1), ==, 2);
+    g_assert_cmpint(hbitmap_count_range(data->hb, L2 + 4, L3 - L2 - L1 - 4),
+                    ==, 0);
+    g_assert_cmpint(hbitmap_count_range(data->hb, L3 - L1 - 1, 3), ==, 2);
+}
+
 static void test_hbitmap_iter_granularity(TestHBitmapData *data,
                                           const void *unused)
 {
@@ -1062,6 +1083,7 @@ int main(int argc, char **argv)
     hbitmap_test_add("/hbitmap/reset/general", test_hbitmap_reset);
     hbitmap_test_add("/hbitmap/reset/all", test_hbitmap_reset_all);
     hbitmap_test_add("/hbitmap/granularity", test_hbitmap_granularity);
+    hbitmap_test_add("/hbitmap/count_range", test_hbitmap_count_range);
 
     hbitmap_test_add("/hbitmap/truncate/nop", test_hbitmap_truncate_nop);
     hbitmap_test_add("/hbitmap/truncate/grow/negligible",
@@ -0,0 +1,70 @@
+/*
+ * Internet checksum test
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "net/checksum.h"
+
+#define BUF_SIZE (70 * 1024)
+
+/* Straightforward RFC 1071 sum of big-endian words starting at offset @seq */
+static uint16_t ref_checksum(const uint8_t *buf, int len, int seq)
+{
+    uint32_t sum = 0;
+    int i;
+
+    for (i = 0; i < len; i++) {
+        sum += (seq + i) & 1 ? buf[i] : buf[i] << 8;
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    return ~sum;
+}
+
+static void test_accel(uint8_t *buf)
+{
+    static const int lens[] = {
+        0, 1, 2, 3, 20, 63, 64, 65, 127, 128, 1500, 1514, 4095, 9000,
+        65535, 65536, 65537, BUF_SIZE - 64,
+    };
+    int i, a, seq;
+
+    for (i = 0; i < ARRAY_SIZE(lens); i++) {
+        for (a = 0; a < 64; a += 7) {
+            for (seq = 0; seq < 2; seq++) {
+                uint32_t sum = net_checksum_add_cont(lens[i], buf + a, seq);
+
+                g_assert_cmphex(net_checksum_finish(sum), ==,
+                                ref_checksum(buf + a, lens[i], seq));
+            }
+        }
+    }
+}
+
+static void test_checksum(const void *opaque)
+{
+    uint8_t fill = GPOINTER_TO_INT(opaque);
+    g_autofree uint8_t *buf = g_malloc(BUF_SIZE);
+    int i;
+
+    for (i = 0; i < BUF_SIZE; i++) {
+        buf[i] = fill ? fill : g_test_rand_int();
+    }
+
+    do {
+        test_accel(buf);
+    } while (test_net_checksum_next_accel());
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_data_func("/net/checksum/random", GINT_TO_POINTER(0),
+                         test_checksum);
+    g_test_add_data_func("/net/checksum/ones", GINT_TO_POINTER(0xff),
+                         test_checksum);
+
+    return g_test_run();
+}
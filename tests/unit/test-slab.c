@@ -0,0 +1,98 @@
+/*
+ * Per-thread slab allocator tests
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/slab.h"
+#include "qemu/thread.h"
+
+static void test_slab_reuse(void)
+{
+    uint64_t hits, misses, hits2, misses2;
+    void *p, *q;
+
+    qemu_slab_get_stats(&hits, &misses);
+
+    p = qemu_slab_alloc(100);
+    memset(p, 0xaa, 100);
+    qemu_slab_free(p, 100);
+
+    /* Same size class, served from the free list */
+    q = qemu_slab_alloc(128);
+    g_assert(q == p);
+    memset(q, 0x55, 128);
+    qemu_slab_free(q, 128);
+
+    qemu_slab_get_stats(&hits2, &misses2);
+    g_assert_cmpuint(hits2, ==, hits + 1);
+    g_assert_cmpuint(misses2, ==, misses + 1);
+}
+
+static void test_slab_large(void)
+{
+    uint64_t hits, misses, hits2, misses2;
+    void *p;
+
+    qemu_slab_get_stats(&hits, &misses);
+
+    /* Too large for the size classes, not counted */
+    p = qemu_slab_alloc(64 * 1024);
+    memset(p, 0, 64 * 1024);
+    qemu_slab_free(p, 64 * 1024);
+
+    qemu_slab_get_stats(&hits2, &misses2);
+    g_assert_cmpuint(hits2, ==, hits);
+    g_assert_cmpuint(misses2, ==, misses);
+}
+
+static void test_slab_g_free(void)
+{
+    /* Objects are plain allocations and may be released with g_free() */
+    g_free(qemu_slab_alloc(500));
+}
+
+static void *slab_thread_fn(void *opaque)
+{
+    void **objs = opaque;
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        objs[i] = qemu_slab_alloc(256);
+    }
+    return NULL;
+}
+
+static void test_slab_threads(void)
+{
+    uint64_t hits, misses, hits2, misses2;
+    void *objs[16];
+    QemuThread thread;
+    int i;
+
+    qemu_slab_get_stats(&hits, &misses);
+
+    qemu_thread_create(&thread, "slab-test", slab_thread_fn, objs,
+                       QEMU_THREAD_JOINABLE);
+    qemu_thread_join(&thread);
+
+    /* The exited thread's counters are kept, its objects can be freed here */
+    qemu_slab_get_stats(&hits2, &misses2);
+    g_assert_cmpuint(misses2 - misses + hits2 - hits, ==, 16);
+
+    for (i = 0; i < 16; i++) {
+        qemu_slab_free(objs[i], 256);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func("/slab/reuse", test_slab_reuse);
+    g_test_add_func("/slab/large", test_slab_large);
+    g_test_add_func("/slab/g_free", test_slab_g_free);
+    g_test_add_func("/slab/threads", test_slab_threads);
+    return g_test_run();
+}
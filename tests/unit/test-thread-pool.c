@@ -70,6 +70,56 @@ static void test_submit_aio(void)
     g_assert_cmpint(data.ret, ==, 0);
 }
 
+static bool bulk_release;
+
+static int bulk_cb(void *opaque)
+{
+    WorkerTestData *data = opaque;
+
+    while (!qatomic_read(&bulk_release)) {
+        g_usleep(1000);
+    }
+    return qatomic_fetch_inc(&data->n);
+}
+
+static void test_bulk_no_starvation(void)
+{
+    WorkerTestData bulk[40];
+    WorkerTestData data = { .n = 0, .ret = -EINPROGRESS };
+    int i;
+
+    /* Occupy more workers with bulk requests than they may take */
+    active = 0;
+    bulk_release = false;
+    for (i = 0; i < ARRAY_SIZE(bulk); i++) {
+        bulk[i] = (WorkerTestData) { .n = 0, .ret = -EINPROGRESS };
+        bulk[i].aiocb = thread_pool_submit_aio_prio(bulk_cb, &bulk[i],
+                                                    THREAD_POOL_PRIO_BULK,
+                                                    done_cb, &bulk[i]);
+        active++;
+    }
+
+    /* A normal request still completes while all bulk ones are blocked */
+    data.aiocb = thread_pool_submit_aio(worker_cb, &data, done_cb, &data);
+    active++;
+    while (data.ret == -EINPROGRESS) {
+        aio_poll(ctx, true);
+    }
+    g_assert_cmpint(data.ret, ==, 0);
+    for (i = 0; i < ARRAY_SIZE(bulk); i++) {
+        g_assert_cmpint(bulk[i].ret, ==, -EINPROGRESS);
+    }
+
+    qatomic_set(&bulk_release, true);
+    while (active > 0) {
+        aio_poll(ctx, true);
+    }
+    for (i = 0; i < ARRAY_SIZE(bulk); i++) {
+        g_assert_cmpint(bulk[i].n, ==, 1);
+        g_assert_cmpint(bulk[i].ret, ==, 0);
+    }
+}
+
 static void coroutine_fn co_test_cb(void *opaque)
 {
     WorkerTestData *data = opaque;
@@ -240,6 +290,8 @@ int main(int argc, char **argv)
     g_test_add_func("/thread-pool/submit-aio", test_submit_aio);
     g_test_add_func("/thread-pool/submit-co", test_submit_co);
     g_test_add_func("/thread-pool/submit-many", test_submit_many);
+    g_test_add_func("/thread-pool/bulk-no-starvation",
+                    test_bulk_no_starvation);
     g_test_add_func("/thread-pool/cancel", test_cancel);
     g_test_add_func("/thread-pool/cancel-async", test_cancel_async);
 
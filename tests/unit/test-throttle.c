@@ -734,6 +734,40 @@ static void test_accounting(void)
                                 (64.0 / 13)));
 }
 
+static void test_allowance(void)
+{
+    ThrottleConfig cfg;
+    double units;
+    uint64_t bytes;
+
+    throttle_config_init(&cfg);
+    cfg.buckets[THROTTLE_OPS_TOTAL].avg = 1000;
+    cfg.buckets[THROTTLE_OPS_WRITE].avg = 400;
+    cfg.buckets[THROTTLE_BPS_READ].avg = 1024 * 1024;
+    cfg.op_size = 4096;
+    throttle_config(&ts, QEMU_CLOCK_VIRTUAL, &cfg);
+
+    g_assert_cmpfloat(throttle_units(&ts, 512), ==, 1.0);
+    g_assert_cmpfloat(throttle_units(&ts, 16384), ==, 4.0);
+
+    /* the smallest of the total and per-direction limits applies */
+    throttle_allowance(&ts, THROTTLE_READ, NANOSECONDS_PER_SECOND / 10,
+                       &units, &bytes);
+    g_assert(double_cmp(units, 100));
+    g_assert_cmpuint(bytes, ==, 1024 * 1024 / 10);
+
+    throttle_allowance(&ts, THROTTLE_WRITE, NANOSECONDS_PER_SECOND / 10,
+                       &units, &bytes);
+    g_assert(double_cmp(units, 40));
+    g_assert_cmpuint(bytes, ==, UINT64_MAX);
+
+    /* units are accounted as given */
+    throttle_account_units(&ts, THROTTLE_WRITE, 2.5, 1000);
+    g_assert(double_cmp(ts.cfg.buckets[THROTTLE_OPS_TOTAL].level, 2.5));
+    g_assert(double_cmp(ts.cfg.buckets[THROTTLE_OPS_WRITE].level, 2.5));
+    g_assert(double_cmp(ts.cfg.buckets[THROTTLE_BPS_WRITE].level, 1000));
+}
+
 static void test_groups(void)
 {
     ThrottleConfig cfg1, cfg2;
@@ -829,6 +863,7 @@ int main(int argc, char **argv)
                     test_iops_size_is_missing_limit);
     g_test_add_func("/throttle/config_functions",   test_config_functions);
     g_test_add_func("/throttle/accounting",         test_accounting);
+    g_test_add_func("/throttle/allowance",          test_allowance);
     g_test_add_func("/throttle/groups",             test_groups);
     return g_test_run();
 }
@@ -173,6 +173,63 @@ static void test_encode_decode(void)
     }
 }
 
+static void encode_decode_random(void)
+{
+    uint8_t *old = g_malloc(XBZRLE_PAGE_SIZE);
+    uint8_t *new = g_malloc(XBZRLE_PAGE_SIZE);
+    uint8_t *compressed = g_malloc(XBZRLE_PAGE_SIZE);
+    int changes = g_test_rand_int_range(1, 64);
+    int i, dlen, rc;
+
+    for (i = 0; i < XBZRLE_PAGE_SIZE; i++) {
+        old[i] = g_test_rand_int();
+    }
+    memcpy(new, old, XBZRLE_PAGE_SIZE);
+
+    /* Runs of changed bytes of various lengths, at any alignment */
+    for (i = 0; i < changes; i++) {
+        int start = g_test_rand_int_range(0, XBZRLE_PAGE_SIZE);
+        int len = g_test_rand_int_range(1, 80);
+
+        while (len-- && start < XBZRLE_PAGE_SIZE) {
+            new[start++] ^= g_test_rand_int_range(1, 256);
+        }
+    }
+
+    dlen = xbzrle_encode_buffer(old, new, XBZRLE_PAGE_SIZE,
+                                compressed, XBZRLE_PAGE_SIZE);
+    if (dlen < 0) {
+        /* Too many changes to fit, nothing to check */
+        goto out;
+    }
+    g_assert(dlen <= XBZRLE_PAGE_SIZE);
+
+    rc = xbzrle_decode_buffer(compressed, dlen, old, XBZRLE_PAGE_SIZE);
+    g_assert(rc >= 0);
+    g_assert(memcmp(old, new, XBZRLE_PAGE_SIZE) == 0);
+
+out:
+    g_free(old);
+    g_free(new);
+    g_free(compressed);
+}
+
+static void test_encode_decode_accel(void)
+{
+    int i;
+
+    do {
+        test_encode_decode_zero();
+        test_encode_decode_unchanged();
+        test_encode_decode_1_byte();
+        test_encode_decode_overflow();
+        for (i = 0; i < 1000; i++) {
+            encode_decode_range();
+            encode_decode_random();
+        }
+    } while (test_xbzrle_encode_next_accel());
+}
+
 int main(int argc, char **argv)
 {
     g_test_init(&argc, &argv, NULL);
@@ -185,6 +242,7 @@ int main(int argc, char **argv)
     g_test_add_func("/xbzrle/encode_decode_overflow",
                     test_encode_decode_overflow);
     g_test_add_func("/xbzrle/encode_decode", test_encode_decode);
+    g_test_add_func("/xbzrle/encode_decode_accel", test_encode_decode_accel);
 
     return g_test_run();
 }
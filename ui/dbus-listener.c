@@ -40,6 +40,7 @@
 #include "ui/egl-helpers.h"
 #include "ui/egl-context.h"
 #include "ui/qemu-pixman.h"
+#include "ui/rect.h"
 #endif
 #include "trace.h"
 
@@ -75,6 +76,13 @@ struct _DBusDisplayListener {
     bool ds_mapped;
     bool can_share_map;
 
+    /*
+     * Only one UpdateMap call is in flight at a time; damage arriving
+     * meanwhile is merged and sent when the client has caught up.
+     */
+    bool map_update_pending;
+    QemuRect map_damage;
+
 #ifdef WIN32
     QemuDBusDisplay1ListenerWin32Map *map_proxy;
     QemuDBusDisplay1ListenerWin32D3d11 *d3d11_proxy;
@@ -819,6 +827,67 @@ static void ddl_scanout(DBusDisplayListener *ddl)
         g_object_ref(ddl));
 }
 
+static void ddl_update_map(DBusDisplayListener *ddl,
+                           int x, int y, int w, int h);
+
+static void dbus_update_map_cb(GObject *source_object,
+                               GAsyncResult *res,
+                               gpointer user_data)
+{
+    g_autoptr(GError) gerr = NULL;
+    DBusDisplayListener *ddl = user_data;
+    QemuRect damage = ddl->map_damage;
+    bool success;
+
+#ifdef WIN32
+    success = qemu_dbus_display1_listener_win32_map_call_update_map_finish(
+        ddl->map_proxy, res, &gerr);
+#else
+    success = qemu_dbus_display1_listener_unix_map_call_update_map_finish(
+        ddl->map_proxy, res, &gerr);
+#endif
+    if (!success) {
+        g_debug("Failed to call UpdateMap: %s", gerr->message);
+    }
+
+    ddl->map_update_pending = false;
+    qemu_rect_init(&ddl->map_damage, 0, 0, 0, 0);
+    if (damage.width && damage.height &&
+        ddl->ds && ddl->ds_share == SHARE_KIND_MAPPED) {
+        ddl_update_map(ddl, damage.x, damage.y, damage.width, damage.height);
+    }
+    g_object_unref(ddl);
+}
+
+static void ddl_update_map(DBusDisplayListener *ddl,
+                           int x, int y, int w, int h)
+{
+    if (ddl->map_update_pending) {
+        QemuRect rect;
+
+        qemu_rect_init(&rect, x, y, w, h);
+        qemu_rect_union(&ddl->map_damage, &rect, &ddl->map_damage);
+        return;
+    }
+
+    ddl->map_update_pending = true;
+#ifdef WIN32
+    qemu_dbus_display1_listener_win32_map_call_update_map(
+        ddl->map_proxy,
+        x, y, w, h,
+        G_DBUS_CALL_FLAGS_NONE,
+        DBUS_DEFAULT_TIMEOUT, NULL,
+        dbus_update_map_cb, g_object_ref(ddl));
+#else
+    qemu_dbus_display1_listener_unix_map_call_update_map(
+        ddl->map_proxy,
+        x, y, w, h,
+        G_DBUS_CALL_FLAGS_NONE,
+        DBUS_DEFAULT_TIMEOUT, NULL,
+        dbus_update_map_cb, g_object_ref(ddl));
+#endif
+}
+
 static void dbus_gfx_update(DisplayChangeListener *dcl,
                             int x, int y, int w, int h)
 {
@@ -829,19 +898,7 @@ static void dbus_gfx_update(DisplayChangeListener *dcl,
     trace_dbus_update(x, y, w, h);
 
     if (dbus_scanout_map(ddl)) {
-#ifdef WIN32
-        qemu_dbus_display1_listener_win32_map_call_update_map(
-            ddl->map_proxy,
-            x, y, w, h,
-            G_DBUS_CALL_FLAGS_NONE,
-            DBUS_DEFAULT_TIMEOUT, NULL, NULL, NULL);
-#else
-        qemu_dbus_display1_listener_unix_map_call_update_map(
-            ddl->map_proxy,
-            x, y, w, h,
-            G_DBUS_CALL_FLAGS_NONE,
-            DBUS_DEFAULT_TIMEOUT, NULL, NULL, NULL);
-#endif
+        ddl_update_map(ddl, x, y, w, h);
         return;
     }
 
@@ -880,6 +937,8 @@ static void dbus_gfx_switch(DisplayChangeListener *dcl,
 
     ddl->ds = new_surface;
     ddl->ds_share = SHARE_KIND_NONE;
+    /* The new surface is sent whole, drop damage of the old one */
+    qemu_rect_init(&ddl->map_damage, 0, 0, 0, 0);
 }
 
 static void dbus_mouse_set(DisplayChangeListener *dcl,
@@ -157,12 +157,17 @@ static void egl_scanout_flush(DisplayChangeListener *dcl,
         egl_texture_blend(edpy->gls, &edpy->blit_fb, &edpy->cursor_fb,
                           !edpy->y_0_top, edpy->pos_x, edpy->pos_y,
                           1.0, 1.0);
-    } else {
+        egl_fb_read(edpy->ds, &edpy->blit_fb);
+    } else if (edpy->blit_fb.width == surface_width(edpy->ds) &&
+               edpy->blit_fb.height == surface_height(edpy->ds)) {
         /* no cursor -> use simple framebuffer blit */
         egl_fb_blit(&edpy->blit_fb, &edpy->guest_fb, edpy->y_0_top);
+        /* only read back the damaged area */
+        egl_fb_read_rect(edpy->ds, &edpy->blit_fb, x, y, w, h);
+    } else {
+        egl_fb_blit(&edpy->blit_fb, &edpy->guest_fb, edpy->y_0_top);
+        egl_fb_read(edpy->ds, &edpy->blit_fb);
     }
-
-    egl_fb_read(edpy->ds, &edpy->blit_fb);
     dpy_gfx_update(edpy->dcl.con, x, y, w, h);
 }
 
@@ -854,6 +854,28 @@ static void spice_gl_draw(SimpleSpiceDisplay *ssd,
     spice_qxl_gl_draw_async(&ssd->qxl, x, y, w, h, cookie);
 }
 
+/*
+ * Updates between two refreshes are coalesced into their bounding box,
+ * so that a flush only asks spice to encode the area that changed.
+ */
+static void spice_gl_add_damage(SimpleSpiceDisplay *ssd,
+                                int x, int y, int w, int h)
+{
+    QemuRect rect;
+
+    qemu_rect_init(&rect, x, y, w, h);
+    qemu_rect_union(&ssd->gl_damage, &rect, &ssd->gl_damage);
+    ssd->gl_updates++;
+}
+
+static void spice_gl_draw_damage(SimpleSpiceDisplay *ssd)
+{
+    spice_gl_draw(ssd, ssd->gl_damage.x, ssd->gl_damage.y,
+                  ssd->gl_damage.width, ssd->gl_damage.height);
+    qemu_rect_init(&ssd->gl_damage, 0, 0, 0, 0);
+    ssd->gl_updates = 0;
+}
+
 static void spice_gl_refresh(DisplayChangeListener *dcl)
 {
     SimpleSpiceDisplay *ssd = container_of(dcl, SimpleSpiceDisplay, dcl);
@@ -865,9 +887,7 @@ static void spice_gl_refresh(DisplayChangeListener *dcl)
     if (qemu_console_is_gl_blocked(ssd->dcl.con)) {
         if (spice_remote_client && ssd->gl_updates && ssd->have_scanout) {
             glFlush();
-            spice_gl_draw(ssd, 0, 0,
-                          surface_width(ssd->ds), surface_height(ssd->ds));
-            ssd->gl_updates = 0;
+            spice_gl_draw_damage(ssd);
             /* E.g, to achieve 60 FPS, update_interval needs to be ~16.66 ms */
             dcl->update_interval = 1000 / spice_max_refresh_rate;
         }
@@ -878,9 +898,7 @@ static void spice_gl_refresh(DisplayChangeListener *dcl)
     if (ssd->gl_updates && ssd->have_surface) {
         qemu_spice_gl_block(ssd, true);
         glFlush();
-        spice_gl_draw(ssd, 0, 0,
-                      surface_width(ssd->ds), surface_height(ssd->ds));
-        ssd->gl_updates = 0;
+        spice_gl_draw_damage(ssd);
     }
 }
 
@@ -890,7 +908,7 @@ static void spice_gl_update(DisplayChangeListener *dcl,
     SimpleSpiceDisplay *ssd = container_of(dcl, SimpleSpiceDisplay, dcl);
 
     surface_gl_update_texture(ssd->gls, ssd->ds, x, y, w, h);
-    ssd->gl_updates++;
+    spice_gl_add_damage(ssd, x, y, w, h);
 }
 
 static bool spice_gl_replace_fd_texture(SimpleSpiceDisplay *ssd,
@@ -1066,6 +1084,7 @@ static void qemu_spice_gl_scanout_disable(DisplayChangeListener *dcl)
      */
     if (qemu_console_is_gl_blocked(ssd->dcl.con)) {
         if (spice_remote_client && ssd->gl_updates && ssd->have_scanout) {
+            qemu_rect_init(&ssd->gl_damage, 0, 0, 0, 0);
             ssd->gl_updates = 0;
             qemu_spice_gl_block(ssd, false);
         }
@@ -1236,6 +1255,7 @@ static void qemu_spice_gl_update(DisplayChangeListener *dcl,
     EGLint fourcc = 0;
     bool render_cursor = false;
     bool y_0_top = false; /* FIXME */
+    bool refresh;
     bool ret;
     uint32_t width, height, texture;
 
@@ -1252,6 +1272,8 @@ static void qemu_spice_gl_update(DisplayChangeListener *dcl,
         egl_fb_destroy(&ssd->blit_fb);
     }
 
+    refresh = ssd->guest_dmabuf_refresh || ssd->new_scanout_texture;
+
     if (ssd->guest_dmabuf_refresh) {
         QemuDmaBuf *dmabuf = ssd->guest_dmabuf;
         width = qemu_dmabuf_get_width(dmabuf);
@@ -1350,7 +1372,19 @@ static void qemu_spice_gl_update(DisplayChangeListener *dcl,
      * of submitting them arbitrarily.
      */
     if (spice_remote_client) {
-        ssd->gl_updates++;
+        if (render_cursor || refresh) {
+            /* the cursor may have moved anywhere, or the scanout changed */
+            if (ssd->guest_dmabuf) {
+                width = qemu_dmabuf_get_width(ssd->guest_dmabuf);
+                height = qemu_dmabuf_get_height(ssd->guest_dmabuf);
+            } else {
+                width = ssd->guest_fb.width;
+                height = ssd->guest_fb.height;
+            }
+            spice_gl_add_damage(ssd, 0, 0, width, height);
+        } else {
+            spice_gl_add_damage(ssd, x, y, w, h);
+        }
     } else {
         spice_gl_draw(ssd, x, y, w, h);
     }
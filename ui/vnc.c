@@ -3158,7 +3158,7 @@ static int vnc_refresh_server_surface(VncDisplay *vd)
     int has_dirty = 0;
     pixman_image_t *tmpbuf = NULL;
     unsigned long offset;
-    int x;
+    int x, next, nblocks = DIV_ROUND_UP(width, VNC_DIRTY_PIXELS_PER_BIT);
     uint8_t *guest_ptr, *server_ptr;
 
     struct timeval tv = { 0, 0 };
@@ -3212,28 +3212,48 @@ static int vnc_refresh_server_surface(VncDisplay *vd)
         }
         guest_ptr += x * cmp_bytes;
 
-        for (; x < DIV_ROUND_UP(width, VNC_DIRTY_PIXELS_PER_BIT);
-             x++, guest_ptr += cmp_bytes, server_ptr += cmp_bytes) {
-            int _cmp_bytes = cmp_bytes;
-            if (!test_and_clear_bit(x, vd->guest.dirty[y])) {
-                continue;
-            }
-            if ((x + 1) * cmp_bytes > line_bytes) {
-                _cmp_bytes = line_bytes - x * cmp_bytes;
-            }
-            assert(_cmp_bytes >= 0);
-            if (memcmp(server_ptr, guest_ptr, _cmp_bytes) == 0) {
-                continue;
-            }
-            memcpy(server_ptr, guest_ptr, _cmp_bytes);
-            if (!vd->non_adaptive) {
-                vnc_rect_updated(vd, x * VNC_DIRTY_PIXELS_PER_BIT,
-                                 y, &tv);
+        while (x < nblocks) {
+            int end = find_next_zero_bit(vd->guest.dirty[y], nblocks, x);
+            int run_bytes = MIN(end * cmp_bytes, line_bytes) - x * cmp_bytes;
+
+            /*
+             * Guests often redraw areas without changing them; compare a
+             * whole run of dirty blocks at once so that the common
+             * unchanged case costs a single wide memcmp().
+             */
+            bitmap_clear(vd->guest.dirty[y], x, end - x);
+            assert(run_bytes >= 0);
+            if (memcmp(server_ptr, guest_ptr, run_bytes) == 0) {
+                guest_ptr += (end - x) * cmp_bytes;
+                server_ptr += (end - x) * cmp_bytes;
+                x = end;
             }
-            QTAILQ_FOREACH(vs, &vd->clients, next) {
-                set_bit(x, vs->dirty[y]);
+
+            for (; x < end;
+                 x++, guest_ptr += cmp_bytes, server_ptr += cmp_bytes) {
+                int _cmp_bytes = cmp_bytes;
+                if ((x + 1) * cmp_bytes > line_bytes) {
+                    _cmp_bytes = line_bytes - x * cmp_bytes;
+                }
+                assert(_cmp_bytes >= 0);
+                if (memcmp(server_ptr, guest_ptr, _cmp_bytes) == 0) {
+                    continue;
+                }
+                memcpy(server_ptr, guest_ptr, _cmp_bytes);
+                if (!vd->non_adaptive) {
+                    vnc_rect_updated(vd, x * VNC_DIRTY_PIXELS_PER_BIT,
+                                     y, &tv);
+                }
+                QTAILQ_FOREACH(vs, &vd->clients, next) {
+                    set_bit(x, vs->dirty[y]);
+                }
+                has_dirty++;
             }
-            has_dirty++;
+
+            next = find_next_bit(vd->guest.dirty[y], nblocks, end);
+            guest_ptr += (next - end) * cmp_bytes;
+            server_ptr += (next - end) * cmp_bytes;
+            x = next;
         }
 
         y++;
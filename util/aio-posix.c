@@ -173,9 +173,9 @@ void aio_set_fd_handler(AioContext *ctx,
     }
 }
 
-static void aio_set_fd_poll(AioContext *ctx, int fd,
-                            IOHandler *io_poll_begin,
-                            IOHandler *io_poll_end)
+void aio_set_fd_poll(AioContext *ctx, int fd,
+                     IOHandler *io_poll_begin,
+                     IOHandler *io_poll_end)
 {
     AioHandler *node = find_aio_handler(ctx, fd);
 
@@ -365,9 +365,19 @@ static bool aio_dispatch_ready_handlers(AioContext *ctx,
     AioHandler *node;
 
     while ((node = QLIST_FIRST(ready_list))) {
+        int64_t start = aio_handler_stats_begin(ctx);
+
         QLIST_REMOVE(node, node_ready);
         progress = aio_dispatch_handler(ctx, node) || progress;
 
+        /* Deleted nodes are not freed while list_lock is held */
+        if (start) {
+            int64_t ns = aio_handler_stats_end(ctx, start,
+                                               &ctx->handler_stats.fd_runs,
+                                               &ctx->handler_stats.fd_ns);
+            trace_aio_fd_handler_run(ctx, node, node->pfd.fd, ns);
+        }
+
         /*
          * Adjust polling time only after aio_dispatch_handler(), which can
          * add the handler to ctx->poll_aio_handlers.
@@ -383,6 +393,7 @@ static bool aio_dispatch_ready_handlers(AioContext *ctx,
 void aio_dispatch(AioContext *ctx)
 {
     AioHandlerList ready_list = QLIST_HEAD_INITIALIZER(ready_list);
+    int64_t loop_start = aio_handler_stats_begin(ctx);
 
     qemu_lockcnt_inc(&ctx->list_lock);
 
@@ -401,6 +412,10 @@ void aio_dispatch(AioContext *ctx)
     qemu_lockcnt_dec(&ctx->list_lock);
 
     timerlistgroup_run_timers(&ctx->tlg);
+
+    if (loop_start) {
+        aio_loop_stats_end(ctx, loop_start);
+    }
 }
 
 static bool run_poll_handlers_once(AioContext *ctx,
@@ -551,14 +566,15 @@ static bool run_poll_handlers(AioContext *ctx, AioHandlerList *ready_list,
  * @ctx: the AioContext
  * @ready_list: list to add handlers that need to be run
  * @timeout: timeout for blocking wait, computed by the caller and updated if
- *    polling succeeds.
+ *    polling succeeds or is deferred by hybrid polling.
+ * @sleep_ns: set to the time that the blocking wait replaces polling for
  *
  * Note that the caller must have incremented ctx->list_lock.
  *
  * Returns: true if progress was made, false otherwise
  */
 static bool try_poll_mode(AioContext *ctx, AioHandlerList *ready_list,
-                          int64_t *timeout)
+                          int64_t *timeout, int64_t *sleep_ns)
 {
     AioHandler *node;
     int64_t max_ns;
@@ -573,6 +589,19 @@ static bool try_poll_mode(AioContext *ctx, AioHandlerList *ready_list,
     }
     max_ns = qemu_soonest_timeout(*timeout, max_ns);
 
+    if (max_ns && ctx->poll_hybrid_deadline) {
+        int64_t now = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
+
+        if (now < ctx->poll_hybrid_deadline) {
+            /* No completion expected yet, wait for events and poll later */
+            *sleep_ns = ctx->poll_hybrid_deadline - now;
+            *timeout = qemu_soonest_timeout(*timeout, *sleep_ns);
+            trace_poll_hybrid_sleep(ctx, *sleep_ns);
+            return false;
+        }
+        ctx->poll_hybrid_deadline = 0;
+    }
+
     if (max_ns && !ctx->fdmon_ops->need_wait(ctx)) {
         /*
          * Enable poll mode. It pairs with the poll_set_started() in
@@ -635,6 +664,8 @@ bool aio_poll(AioContext *ctx, bool blocking)
     int64_t timeout;
     int64_t start = 0;
     int64_t block_ns = 0;
+    int64_t sleep_ns = 0;
+    int64_t loop_start;
 
     /*
      * There cannot be two concurrent aio_poll calls for the same AioContext (or
@@ -655,7 +686,7 @@ bool aio_poll(AioContext *ctx, bool blocking)
     }
 
     timeout = blocking ? aio_compute_timeout(ctx) : 0;
-    progress = try_poll_mode(ctx, &ready_list, &timeout);
+    progress = try_poll_mode(ctx, &ready_list, &timeout, &sleep_ns);
     assert(!(timeout && progress));
 
     /*
@@ -707,9 +738,16 @@ bool aio_poll(AioContext *ctx, bool blocking)
 
     aio_notify_accept(ctx);
 
-    /* Calculate blocked time for adaptive polling */
+    /* Only the dispatch half of the iteration counts as loop latency */
+    loop_start = aio_handler_stats_begin(ctx);
+
+    /*
+     * Calculate blocked time for adaptive polling.  A hybrid polling sleep
+     * does not mean that polling should have lasted longer.
+     */
     if (ctx->poll_max_ns) {
         block_ns = qemu_clock_get_ns(QEMU_CLOCK_REALTIME) - start;
+        block_ns -= MIN(block_ns, sleep_ns);
     }
 
     if (ctx->fdmon_ops->dispatch) {
@@ -725,6 +763,10 @@ bool aio_poll(AioContext *ctx, bool blocking)
 
     progress |= timerlistgroup_run_timers(&ctx->tlg);
 
+    if (loop_start) {
+        aio_loop_stats_end(ctx, loop_start);
+    }
+
     return progress;
 }
 
@@ -796,6 +838,37 @@ void aio_context_set_poll_params(AioContext *ctx, int64_t max_ns,
     aio_notify(ctx);
 }
 
+/* Don't sleep for less than this, a wakeup costs about as much */
+#define AIO_HYBRID_POLL_MIN_SLEEP_NS 5000
+
+void aio_hybrid_poll_submitted(AioContext *ctx, AioHybridPoll *hp)
+{
+    int64_t sleep_ns = qatomic_read(&hp->latency_ns) / 2;
+    int64_t deadline;
+
+    if (!ctx->poll_max_ns || sleep_ns < AIO_HYBRID_POLL_MIN_SLEEP_NS) {
+        return;
+    }
+
+    /* The earliest expected completion wins */
+    deadline = qemu_clock_get_ns(QEMU_CLOCK_REALTIME) + sleep_ns;
+    if (!ctx->poll_hybrid_deadline || deadline < ctx->poll_hybrid_deadline) {
+        ctx->poll_hybrid_deadline = deadline;
+    }
+}
+
+void aio_hybrid_poll_completed(AioHybridPoll *hp, int64_t latency_ns)
+{
+    int64_t avg = qatomic_read(&hp->latency_ns);
+
+    /*
+     * Racing updates from several threads may lose a sample, which does
+     * not matter for an estimate.
+     */
+    qatomic_set(&hp->latency_ns,
+                avg ? avg - avg / 8 + latency_ns / 8 : latency_ns);
+}
+
 void aio_context_set_aio_params(AioContext *ctx, int64_t max_batch)
 {
     /*
@@ -807,6 +880,17 @@ void aio_context_set_aio_params(AioContext *ctx, int64_t max_batch)
     aio_notify(ctx);
 }
 
+bool aio_context_set_io_uring_sqpoll(AioContext *ctx, uint32_t idle_ms,
+                                     Error **errp)
+{
+#ifdef CONFIG_LINUX_IO_URING
+    return fdmon_io_uring_set_sqpoll(ctx, idle_ms, errp);
+#else
+    error_setg(errp, "io_uring is not supported in this build");
+    return false;
+#endif
+}
+
 #ifdef CONFIG_LINUX_IO_URING
 void aio_add_sqe(void (*prep_sqe)(struct io_uring_sqe *sqe, void *opaque),
                  void *opaque, CqeHandler *cqe_handler)
@@ -814,4 +898,10 @@ void aio_add_sqe(void (*prep_sqe)(struct io_uring_sqe *sqe, void *opaque),
     AioContext *ctx = qemu_get_current_aio_context();
     ctx->fdmon_ops->add_sqe(ctx, prep_sqe, opaque, cqe_handler);
 }
+
+void aio_add_linked_sqes(const AioSqe *sqes, unsigned nr)
+{
+    AioContext *ctx = qemu_get_current_aio_context();
+    ctx->fdmon_ops->add_linked_sqes(ctx, sqes, nr);
+}
 #endif /* CONFIG_LINUX_IO_URING */
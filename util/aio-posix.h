@@ -75,6 +75,8 @@ static inline void fdmon_epoll_disable(AioContext *ctx)
 
 #ifdef CONFIG_LINUX_IO_URING
 bool fdmon_io_uring_setup(AioContext *ctx, Error **errp);
+bool fdmon_io_uring_set_sqpoll(AioContext *ctx, uint32_t idle_ms,
+                               Error **errp);
 void fdmon_io_uring_destroy(AioContext *ctx);
 #endif /* !CONFIG_LINUX_IO_URING */
 
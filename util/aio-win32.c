@@ -178,6 +178,13 @@ void aio_set_event_notifier_poll(AioContext *ctx,
     /* Not implemented */
 }
 
+void aio_set_fd_poll(AioContext *ctx, int fd,
+                     IOHandler *io_poll_begin,
+                     IOHandler *io_poll_end)
+{
+    /* Not implemented */
+}
+
 bool aio_prepare(AioContext *ctx)
 {
     static struct timeval tv0;
@@ -439,3 +446,10 @@ void aio_context_set_poll_params(AioContext *ctx, int64_t max_ns,
 void aio_context_set_aio_params(AioContext *ctx, int64_t max_batch)
 {
 }
+
+bool aio_context_set_io_uring_sqpoll(AioContext *ctx, uint32_t idle_ms,
+                                     Error **errp)
+{
+    error_setg(errp, "io_uring is not available on Windows");
+    return false;
+}
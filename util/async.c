@@ -30,6 +30,7 @@
 #include "block/graph-lock.h"
 #include "qemu/main-loop.h"
 #include "qemu/atomic.h"
+#include "qemu/host-utils.h"
 #include "qemu/lockcnt.h"
 #include "qemu/rcu_queue.h"
 #include "block/raw-aio.h"
@@ -157,7 +158,10 @@ QEMUBH *aio_bh_new_full(AioContext *ctx, QEMUBHFunc *cb, void *opaque,
 
 void aio_bh_call(QEMUBH *bh)
 {
+    AioContext *ctx = bh->ctx;
+    const char *name = bh->name;
     bool last_engaged_in_io = false;
+    int64_t start = aio_handler_stats_begin(ctx);
 
     /* Make a copy of the guard-pointer as cb may free the bh */
     MemReentrancyGuard *reentrancy_guard = bh->reentrancy_guard;
@@ -174,6 +178,14 @@ void aio_bh_call(QEMUBH *bh)
     if (reentrancy_guard) {
         reentrancy_guard->engaged_in_io = last_engaged_in_io;
     }
+
+    /* bh may have been freed by cb, only use the copies from here on */
+    if (start) {
+        int64_t ns = aio_handler_stats_end(ctx, start,
+                                           &ctx->handler_stats.bh_runs,
+                                           &ctx->handler_stats.bh_ns);
+        trace_aio_bh_run(ctx, name, ns);
+    }
 }
 
 /* Multiple occurrences of aio_bh_poll cannot be called concurrently. */
@@ -739,6 +751,32 @@ void qemu_set_current_aio_context(AioContext *ctx)
     set_my_aiocontext(ctx);
 }
 
+void aio_context_set_handler_stats(AioContext *ctx, bool enabled)
+{
+    qatomic_set(&ctx->handler_stats_enabled, enabled);
+}
+
+int64_t aio_handler_stats_end(AioContext *ctx, int64_t start, Stat64 *runs,
+                              Stat64 *total_ns)
+{
+    int64_t ns = get_clock() - start;
+
+    stat64_inc(runs);
+    stat64_add(total_ns, ns);
+    stat64_max(&ctx->handler_stats.handler_max_ns, ns);
+    return ns;
+}
+
+void aio_loop_stats_end(AioContext *ctx, int64_t start)
+{
+    uint64_t us = (get_clock() - start) / SCALE_US;
+    int bucket = us ? 64 - clz64(us) : 0;
+
+    stat64_inc(&ctx->handler_stats.iterations);
+    stat64_inc(&ctx->handler_stats.loop_us[MIN(bucket,
+                                               AIO_LOOP_HIST_BUCKETS - 1)]);
+}
+
 void aio_context_set_thread_pool_params(AioContext *ctx, int64_t min,
                                         int64_t max, Error **errp)
 {
@@ -262,6 +262,13 @@ Coroutine *qemu_coroutine_new(void)
     return &co->base;
 }
 
+void qemu_coroutine_release_stack(Coroutine *co_)
+{
+    CoroutineSigAltStack *co = DO_UPCAST(CoroutineSigAltStack, base, co_);
+
+    qemu_release_stack(co->stack, co->stack_size, COROUTINE_STACK_KEEP);
+}
+
 void qemu_coroutine_delete(Coroutine *co_)
 {
     CoroutineSigAltStack *co = DO_UPCAST(CoroutineSigAltStack, base, co_);
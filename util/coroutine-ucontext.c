@@ -278,6 +278,13 @@ static void coroutine_fn terminate_asan(void *opaque)
 }
 #endif
 
+void qemu_coroutine_release_stack(Coroutine *co_)
+{
+    CoroutineUContext *co = DO_UPCAST(CoroutineUContext, base, co_);
+
+    qemu_release_stack(co->stack, co->stack_size, COROUTINE_STACK_KEEP);
+}
+
 void qemu_coroutine_delete(Coroutine *co_)
 {
     CoroutineUContext *co = DO_UPCAST(CoroutineUContext, base, co_);
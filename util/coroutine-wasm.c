@@ -73,6 +73,11 @@ Coroutine *qemu_coroutine_new(void)
     return &co->base;
 }
 
+void qemu_coroutine_release_stack(Coroutine *co_)
+{
+    /* Stacks are small and reused as they are */
+}
+
 void qemu_coroutine_delete(Coroutine *co_)
 {
     CoroutineEmscripten *co = DO_UPCAST(CoroutineEmscripten, base, co_);
@@ -79,6 +79,11 @@ Coroutine *qemu_coroutine_new(void)
     return &co->base;
 }
 
+void qemu_coroutine_release_stack(Coroutine *co_)
+{
+    /* Fiber stacks are managed by the system */
+}
+
 void qemu_coroutine_delete(Coroutine *co_)
 {
     CoroutineWin32 *co = DO_UPCAST(CoroutineWin32, base, co_);
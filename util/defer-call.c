@@ -33,6 +33,7 @@ typedef struct {
 /* Per-thread state */
 typedef struct {
     unsigned nesting_level;
+    unsigned next_call; /* next deferred call run by defer_call_end() */
     GArray *deferred_call_array;
 } DeferCallThreadState;
 
@@ -93,7 +94,7 @@ void defer_call(void (*fn)(void *), void *opaque)
      * then a binary search (glib 2.62+) or different data structure could be
      * used.
      */
-    for (guint i = 0; i < array->len; i++) {
+    for (guint i = thread_state->next_call; i < array->len; i++) {
         if (memcmp(&fns[i], &new_fn, sizeof(new_fn)) == 0) {
             return; /* already exists */
         }
@@ -110,7 +111,8 @@ void defer_call(void (*fn)(void *), void *opaque)
  * defer_call_end() in the same thread.
  *
  * Nesting is supported. defer_call() functions are only called at the
- * outermost defer_call_end().
+ * outermost defer_call_end().  Calls deferred by those functions themselves
+ * are batched as well and run before defer_call_end() returns.
  */
 void defer_call_begin(void)
 {
@@ -133,19 +135,28 @@ void defer_call_end(void)
 
     assert(thread_state->nesting_level > 0);
 
-    if (--thread_state->nesting_level > 0) {
+    if (thread_state->nesting_level > 1) {
+        thread_state->nesting_level--;
         return;
     }
 
     GArray *array = thread_state->deferred_call_array;
     if (!array) {
+        thread_state->nesting_level = 0;
         return;
     }
 
-    DeferredCall *fns = (DeferredCall *)array->data;
+    /*
+     * Stay nested while the calls run, so that defer_call() from within them
+     * appends to the array instead of running immediately.  For example,
+     * requests submitted by a deferred call are still batched by the block
+     * driver.  The array may grow and move, so index it on every iteration.
+     */
+    while (thread_state->next_call < array->len) {
+        DeferredCall call = g_array_index(array, DeferredCall,
+                                          thread_state->next_call++);
 
-    for (guint i = 0; i < array->len; i++) {
-        fns[i].fn(fns[i].opaque);
+        call.fn(call.opaque);
     }
 
     /*
@@ -153,4 +164,6 @@ void defer_call_end(void)
      * in the future.
      */
     g_array_set_size(array, 0);
+    thread_state->next_call = 0;
+    thread_state->nesting_level = 0;
 }
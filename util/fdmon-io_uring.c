@@ -41,12 +41,26 @@
  * fdmon_io_uring_wait().  Changes to AioHandlers are made by enqueuing them on
  * ctx->submit_list so that fdmon_io_uring_wait() can submit IORING_OP_POLL_ADD
  * and/or IORING_OP_POLL_REMOVE sqes for them.
+ *
+ * Each ring also has sparse fixed buffer and fixed file tables. Users of
+ * aio_add_sqe() allocate slots and fill them in with
+ * aio_io_uring_set_fixed_buf() and aio_io_uring_set_fixed_file(). A slot holds
+ * the same buffer or file in all rings, so an sqe can refer to it no matter
+ * which thread submits the request. Updating a table is done with
+ * io_uring_register(2) from the thread making the change. That is safe while
+ * other threads are submitting and waiting because the kernel keeps the old
+ * buffer or file alive until in-flight requests using it have completed.
+ *
+ * Rings can optionally be created in SQPOLL mode where a kernel thread picks
+ * up sqes so that submission does not require a syscall. All SQPOLL rings
+ * share a single kernel thread through IORING_SETUP_ATTACH_WQ.
  */
 
 #include "qemu/osdep.h"
 #include <poll.h>
 #include "qapi/error.h"
 #include "qemu/defer-call.h"
+#include "qemu/lockable.h"
 #include "qemu/rcu_queue.h"
 #include "aio-posix.h"
 #include "trace.h"
@@ -61,6 +75,32 @@ enum {
     FDMON_IO_URING_DELETE_AIO_HANDLER = (1 << 3),
 };
 
+/*
+ * The contents of the fixed buffer and fixed file tables. New rings are
+ * brought up to date from these copies.
+ */
+static QemuMutex fixed_lock;
+static QLIST_HEAD(, AioContext) fixed_ctxs =
+    QLIST_HEAD_INITIALIZER(fixed_ctxs);
+static struct iovec fixed_bufs[AIO_IO_URING_FIXED_BUFS];
+static int fixed_files[AIO_IO_URING_FIXED_FILES];
+
+/* Rings in SQPOLL mode, protected by sqpoll_lock */
+static QemuMutex sqpoll_lock;
+static QLIST_HEAD(, AioContext) sqpoll_ctxs =
+    QLIST_HEAD_INITIALIZER(sqpoll_ctxs);
+
+static void __attribute__((__constructor__)) fdmon_io_uring_fixed_init(void)
+{
+    int i;
+
+    qemu_mutex_init(&fixed_lock);
+    qemu_mutex_init(&sqpoll_lock);
+    for (i = 0; i < ARRAY_SIZE(fixed_files); i++) {
+        fixed_files[i] = -1;
+    }
+}
+
 static inline int poll_events_from_pfd(int pfd_events)
 {
     return (pfd_events & G_IO_IN ? POLLIN : 0) |
@@ -91,6 +131,8 @@ static struct io_uring_sqe *get_sqe(AioContext *ctx)
         return sqe;
     }
 
+    stat64_add(&ctx->io_uring_stats.sq_full, 1);
+
     /* No free sqes left, submit pending sqes first */
     do {
         ret = io_uring_submit(ring);
@@ -98,6 +140,15 @@ static struct io_uring_sqe *get_sqe(AioContext *ctx)
 
     assert(ret > 1);
     sqe = io_uring_get_sqe(ring);
+
+#ifdef HAVE_IO_URING_SQPOLL
+    /* The SQPOLL kernel thread may not have consumed the sqes yet */
+    while (!sqe && ctx->io_uring_sqpoll) {
+        io_uring_sqring_wait(ring);
+        sqe = io_uring_get_sqe(ring);
+    }
+#endif
+
     assert(sqe);
     return sqe;
 }
@@ -183,6 +234,46 @@ static void fdmon_io_uring_add_sqe(AioContext *ctx,
                                  cqe_handler);
 }
 
+static void fdmon_io_uring_add_linked_sqes(AioContext *ctx,
+                                           const AioSqe *sqes, unsigned nr)
+{
+    struct io_uring *ring = &ctx->fdmon_io_uring;
+    unsigned i;
+
+    /*
+     * The kernel ends a chain at the end of a submission, so get_sqe() must
+     * not submit in the middle of it.
+     */
+    if (io_uring_sq_space_left(ring) < nr) {
+        int ret;
+
+        stat64_add(&ctx->io_uring_stats.sq_full, 1);
+        do {
+            ret = io_uring_submit(ring);
+        } while (ret == -EINTR);
+
+#ifdef HAVE_IO_URING_SQPOLL
+        while (io_uring_sq_space_left(ring) < nr && ctx->io_uring_sqpoll) {
+            io_uring_sqring_wait(ring);
+        }
+#endif
+        assert(io_uring_sq_space_left(ring) >= nr);
+    }
+
+    for (i = 0; i < nr; i++) {
+        struct io_uring_sqe *sqe = get_sqe(ctx);
+
+        sqes[i].prep_sqe(sqe, sqes[i].opaque);
+        if (i < nr - 1) {
+            sqe->flags |= IOSQE_IO_LINK;
+        }
+        io_uring_sqe_set_data(sqe, sqes[i].cqe_handler);
+
+        trace_fdmon_io_uring_add_sqe(ctx, sqes[i].opaque, sqe->opcode,
+                                     sqe->fd, sqe->off, sqes[i].cqe_handler);
+    }
+}
+
 static void fdmon_special_cqe_handler(CqeHandler *cqe_handler)
 {
     /*
@@ -314,6 +405,7 @@ static int process_cq_ring(AioContext *ctx, AioHandlerList *ready_list)
 #ifdef HAVE_IO_URING_CQ_HAS_OVERFLOW
     /* If the CQ overflowed then fetch CQEs with a syscall */
     if (io_uring_cq_has_overflow(ring)) {
+        stat64_add(&ctx->io_uring_stats.cq_overflow, 1);
         io_uring_get_events(ring);
     }
 #endif
@@ -387,6 +479,8 @@ static int fdmon_io_uring_wait(AioContext *ctx, AioHandlerList *ready_list,
     unsigned wait_nr = 1; /* block until at least one cqe is ready */
     int ret;
 
+    stat64_add(&ctx->io_uring_stats.wait, 1);
+
     if (timeout == 0) {
         wait_nr = 0; /* non-blocking */
     } else if (timeout > 0) {
@@ -450,13 +544,155 @@ static const FDMonOps fdmon_io_uring_ops = {
     .gsource_check = fdmon_io_uring_gsource_check,
     .gsource_dispatch = fdmon_io_uring_gsource_dispatch,
     .add_sqe = fdmon_io_uring_add_sqe,
+    .add_linked_sqes = fdmon_io_uring_add_linked_sqes,
 };
 
+/* Set up the fixed buffer and fixed file tables for a new ring */
+static void fixed_setup(AioContext *ctx)
+{
+#ifdef HAVE_IO_URING_REGISTER_BUFFERS_SPARSE
+    struct io_uring *ring = &ctx->fdmon_io_uring;
+    int ret;
+
+    QEMU_LOCK_GUARD(&fixed_lock);
+
+    ret = io_uring_register_buffers_sparse(ring, AIO_IO_URING_FIXED_BUFS);
+    if (ret < 0) {
+        goto fail;
+    }
+
+    ret = io_uring_register_files_sparse(ring, AIO_IO_URING_FIXED_FILES);
+    if (ret < 0) {
+        goto fail;
+    }
+
+    ret = io_uring_register_buffers_update_tag(ring, 0, fixed_bufs, NULL,
+                                               AIO_IO_URING_FIXED_BUFS);
+    if (ret < 0) {
+        goto fail;
+    }
+
+    ret = io_uring_register_files_update(ring, 0, fixed_files,
+                                         AIO_IO_URING_FIXED_FILES);
+    if (ret < 0) {
+        goto fail;
+    }
+
+    ctx->io_uring_fixed = true;
+    QLIST_INSERT_HEAD(&fixed_ctxs, ctx, io_uring_fixed_next);
+    return;
+
+fail:
+    /* Not fatal, requests just won't use fixed buffers and files */
+    trace_fdmon_io_uring_fixed_setup_failed(ctx, ret);
+    io_uring_unregister_buffers(ring);
+    io_uring_unregister_files(ring);
+#endif /* HAVE_IO_URING_REGISTER_BUFFERS_SPARSE */
+}
+
+static void fixed_cleanup(AioContext *ctx)
+{
+    QEMU_LOCK_GUARD(&fixed_lock);
+
+    if (ctx->io_uring_fixed) {
+        QLIST_REMOVE(ctx, io_uring_fixed_next);
+        ctx->io_uring_fixed = false;
+    }
+}
+
+int aio_io_uring_set_fixed_buf(unsigned index, const struct iovec *iov)
+{
+    struct iovec new_iov = iov ? *iov : (struct iovec){};
+    struct iovec old_iov;
+    AioContext *ctx;
+    int ret;
+
+    assert(index < AIO_IO_URING_FIXED_BUFS);
+
+#ifndef HAVE_IO_URING_REGISTER_BUFFERS_SPARSE
+    if (iov) {
+        return -ENOTSUP;
+    }
+#endif
+
+    QEMU_LOCK_GUARD(&fixed_lock);
+
+    old_iov = fixed_bufs[index];
+    QLIST_FOREACH(ctx, &fixed_ctxs, io_uring_fixed_next) {
+        ret = io_uring_register_buffers_update_tag(&ctx->fdmon_io_uring, index,
+                                                   &new_iov, NULL, 1);
+        if (ret < 0) {
+            goto rollback;
+        }
+    }
+
+    fixed_bufs[index] = new_iov;
+    return 0;
+
+rollback:
+    {
+        AioContext *failed_ctx = ctx;
+
+        QLIST_FOREACH(ctx, &fixed_ctxs, io_uring_fixed_next) {
+            if (ctx == failed_ctx) {
+                break;
+            }
+            io_uring_register_buffers_update_tag(&ctx->fdmon_io_uring, index,
+                                                 &old_iov, NULL, 1);
+        }
+    }
+    return ret;
+}
+
+int aio_io_uring_set_fixed_file(unsigned index, int fd)
+{
+    AioContext *ctx;
+    int old_fd;
+    int ret;
+
+    assert(index < AIO_IO_URING_FIXED_FILES);
+
+#ifndef HAVE_IO_URING_REGISTER_BUFFERS_SPARSE
+    if (fd != -1) {
+        return -ENOTSUP;
+    }
+#endif
+
+    QEMU_LOCK_GUARD(&fixed_lock);
+
+    old_fd = fixed_files[index];
+    QLIST_FOREACH(ctx, &fixed_ctxs, io_uring_fixed_next) {
+        ret = io_uring_register_files_update(&ctx->fdmon_io_uring, index,
+                                             &fd, 1);
+        if (ret < 0) {
+            goto rollback;
+        }
+    }
+
+    fixed_files[index] = fd;
+    return 0;
+
+rollback:
+    {
+        AioContext *failed_ctx = ctx;
+
+        QLIST_FOREACH(ctx, &fixed_ctxs, io_uring_fixed_next) {
+            if (ctx == failed_ctx) {
+                break;
+            }
+            io_uring_register_files_update(&ctx->fdmon_io_uring, index,
+                                           &old_fd, 1);
+        }
+    }
+    return ret;
+}
+
 bool fdmon_io_uring_setup(AioContext *ctx, Error **errp)
 {
     int ret;
 
     ctx->io_uring_fd_tag = NULL;
+    ctx->io_uring_sqpoll = false;
 
     ret = io_uring_queue_init(FDMON_IO_URING_ENTRIES, &ctx->fdmon_io_uring, 0);
     if (ret != 0) {
@@ -466,12 +702,80 @@ bool fdmon_io_uring_setup(AioContext *ctx, Error **errp)
 
     QSLIST_INIT(&ctx->submit_list);
     QSIMPLEQ_INIT(&ctx->cqe_handler_ready_list);
+    fixed_setup(ctx);
     ctx->fdmon_ops = &fdmon_io_uring_ops;
     ctx->io_uring_fd_tag = g_source_add_unix_fd(&ctx->source,
             ctx->fdmon_io_uring.ring_fd, G_IO_IN);
     return true;
 }
 
+bool fdmon_io_uring_set_sqpoll(AioContext *ctx, uint32_t idle_ms,
+                               Error **errp)
+{
+#ifdef HAVE_IO_URING_SQPOLL
+    struct io_uring_params params = {
+        .flags = IORING_SETUP_SQPOLL,
+        .sq_thread_idle = idle_ms,
+    };
+    struct io_uring new_ring;
+    AioHandler *node;
+    int ret;
+
+    if (ctx->fdmon_ops != &fdmon_io_uring_ops) {
+        error_setg(errp, "io_uring is not available");
+        return false;
+    }
+    if (ctx->io_uring_sqpoll) {
+        return true;
+    }
+
+    /* Nothing may have been submitted to the old ring yet */
+    assert(!io_uring_sq_ready(&ctx->fdmon_io_uring));
+    assert(QSIMPLEQ_EMPTY(&ctx->cqe_handler_ready_list));
+
+    qemu_mutex_lock(&sqpoll_lock);
+    if (!QLIST_EMPTY(&sqpoll_ctxs)) {
+        params.flags |= IORING_SETUP_ATTACH_WQ;
+        params.wq_fd = QLIST_FIRST(&sqpoll_ctxs)->fdmon_io_uring.ring_fd;
+    }
+
+    ret = io_uring_queue_init_params(FDMON_IO_URING_ENTRIES, &new_ring,
+                                     &params);
+    if (ret != 0) {
+        qemu_mutex_unlock(&sqpoll_lock);
+        error_setg_errno(errp, -ret, "Failed to initialize io_uring in "
+                         "SQPOLL mode");
+        return false;
+    }
+
+    QLIST_INSERT_HEAD(&sqpoll_ctxs, ctx, io_uring_sqpoll_next);
+    qemu_mutex_unlock(&sqpoll_lock);
+
+    fixed_cleanup(ctx);
+    g_source_remove_unix_fd(&ctx->source, ctx->io_uring_fd_tag);
+    io_uring_queue_exit(&ctx->fdmon_io_uring);
+
+    ctx->fdmon_io_uring = new_ring;
+    ctx->io_uring_sqpoll = true;
+    ctx->io_uring_fd_tag = g_source_add_unix_fd(&ctx->source,
+            ctx->fdmon_io_uring.ring_fd, G_IO_IN);
+    fixed_setup(ctx);
+
+    /* Re-arm file descriptor monitoring on the new ring */
+    qemu_lockcnt_inc(&ctx->list_lock);
+    QLIST_FOREACH_RCU(node, &ctx->aio_handlers, node) {
+        if (!QLIST_IS_INSERTED(node, node_deleted)) {
+            enqueue(&ctx->submit_list, node, FDMON_IO_URING_ADD);
+        }
+    }
+    qemu_lockcnt_dec(&ctx->list_lock);
+    return true;
+#else
+    error_setg(errp, "io_uring SQPOLL mode is not supported in this build");
+    return false;
+#endif /* HAVE_IO_URING_SQPOLL */
+}
+
 void fdmon_io_uring_destroy(AioContext *ctx)
 {
     AioHandler *node;
@@ -480,6 +784,14 @@ void fdmon_io_uring_destroy(AioContext *ctx)
         return;
     }
 
+    if (ctx->io_uring_sqpoll) {
+        qemu_mutex_lock(&sqpoll_lock);
+        QLIST_REMOVE(ctx, io_uring_sqpoll_next);
+        qemu_mutex_unlock(&sqpoll_lock);
+        ctx->io_uring_sqpoll = false;
+    }
+
+    fixed_cleanup(ctx);
     io_uring_queue_exit(&ctx->fdmon_io_uring);
 
     /* Move handlers due to be removed onto the deleted list */
@@ -217,6 +217,35 @@ int64_t hbitmap_next_dirty(const HBitmap *hb, int64_t start, int64_t count)
     return MAX(start, first_dirty_off);
 }
 
+/* Number of words in a cache line, compared at once by hb_skip_full_words */
+#define HBITMAP_SCAN_WORDS (64 / sizeof(unsigned long))
+
+/* Return the index of the first word in [pos, end) that is not all ones,
+ * or end.  Long runs are skipped a cache line at a time, which the
+ * compiler can vectorize.
+ */
+static size_t hb_skip_full_words(const unsigned long *words, size_t pos,
+                                 size_t end)
+{
+    while (pos + HBITMAP_SCAN_WORDS <= end) {
+        unsigned long acc = (unsigned long)-1;
+        size_t i;
+
+        for (i = 0; i < HBITMAP_SCAN_WORDS; i++) {
+            acc &= words[pos + i];
+        }
+        if (acc != (unsigned long)-1) {
+            break;
+        }
+        pos += HBITMAP_SCAN_WORDS;
+    }
+
+    while (pos < end && words[pos] == (unsigned long)-1) {
+        pos++;
+    }
+    return pos;
+}
+
 int64_t hbitmap_next_zero(const HBitmap *hb, int64_t start, int64_t count)
 {
     size_t pos = (start >> hb->granularity) >> BITS_PER_LEVEL;
@@ -245,10 +274,7 @@ int64_t hbitmap_next_zero(const HBitmap *hb, int64_t start, int64_t count)
     assert((start >> hb->granularity) < hb->size);
 
     if (cur == (unsigned long)-1) {
-        do {
-            pos++;
-        } while (pos < sz && last_lev[pos] == (unsigned long)-1);
-
+        pos = hb_skip_full_words(last_lev, pos + 1, sz);
         if (pos >= sz) {
             return -1;
         }
@@ -381,7 +407,8 @@ static size_t hbitmap_iter_next_word(HBitmapIter *hbi, unsigned long *p_cur)
 /* Count the number of set bits between start and end, not accounting for
  * the granularity.  Also an example of how to use hbitmap_iter_next_word.
  */
-static uint64_t hb_count_between(HBitmap *hb, uint64_t start, uint64_t last)
+static uint64_t hb_count_between(const HBitmap *hb, uint64_t start,
+                                 uint64_t last)
 {
     HBitmapIter hbi;
     uint64_t count = 0;
@@ -408,6 +435,21 @@ static uint64_t hb_count_between(HBitmap *hb, uint64_t start, uint64_t last)
     return count;
 }
 
+uint64_t hbitmap_count_range(const HBitmap *hb, uint64_t start,
+                             uint64_t count)
+{
+    uint64_t first, last;
+
+    assert(start + count <= hb->orig_size);
+    if (!count) {
+        return 0;
+    }
+
+    first = start >> hb->granularity;
+    last = (start + count - 1) >> hb->granularity;
+    return hb_count_between(hb, first, last) << hb->granularity;
+}
+
 /* Setting starts at the last layer and propagates up if an element
  * changes.
  */
@@ -682,6 +724,12 @@ void hbitmap_serialize_part(const HBitmap *hb, uint8_t *buf,
     serialization_chunk(hb, start, count, &cur, &el_count);
     end = cur + el_count;
 
+    if (!HOST_BIG_ENDIAN) {
+        /* The serialized format is the in-memory one, copy it in bulk */
+        memcpy(buf, cur, el_count * sizeof(unsigned long));
+        return;
+    }
+
     while (cur != end) {
         unsigned long el =
             (BITS_PER_LONG == 32 ? cpu_to_le32(*cur) : cpu_to_le64(*cur));
@@ -705,17 +753,21 @@ void hbitmap_deserialize_part(HBitmap *hb, uint8_t *buf,
     serialization_chunk(hb, start, count, &cur, &el_count);
     end = cur + el_count;
 
-    while (cur != end) {
-        memcpy(cur, buf, sizeof(*cur));
+    if (!HOST_BIG_ENDIAN) {
+        memcpy(cur, buf, el_count * sizeof(unsigned long));
+    } else {
+        while (cur != end) {
+            memcpy(cur, buf, sizeof(*cur));
 
-        if (BITS_PER_LONG == 32) {
-            le32_to_cpus((uint32_t *)cur);
-        } else {
-            le64_to_cpus((uint64_t *)cur);
-        }
+            if (BITS_PER_LONG == 32) {
+                le32_to_cpus((uint32_t *)cur);
+            } else {
+                le64_to_cpus((uint64_t *)cur);
+            }
 
-        buf += sizeof(unsigned long);
-        cur++;
+            buf += sizeof(unsigned long);
+            cur++;
+        }
     }
     if (finish) {
         hbitmap_deserialize_finish(hb);
@@ -68,13 +68,15 @@ struct MemsetThread;
 static QLIST_HEAD(, MemsetContext) memset_contexts =
     QLIST_HEAD_INITIALIZER(memset_contexts);
 
-typedef struct MemsetContext {
+struct MemsetContext {
     bool all_threads_created;
     bool any_thread_failed;
     struct MemsetThread *threads;
     int num_threads;
+    /* threads of a background preallocation that did not finish yet */
+    int threads_running;
     QLIST_ENTRY(MemsetContext) next;
-} MemsetContext;
+};
 
 struct MemsetThread {
     char *addr;
@@ -440,6 +442,20 @@ static void *do_madv_populate_write_pages(void *arg)
     return (void *)(uintptr_t)ret;
 }
 
+static void *do_madv_populate_background(void *arg)
+{
+    MemsetThread *memset_args = (MemsetThread *)arg;
+    const size_t size = memset_args->numpages * memset_args->hpagesize;
+
+    if (size && qemu_madvise(memset_args->addr, size,
+                             QEMU_MADV_POPULATE_WRITE)) {
+        warn_report("preallocating memory in background failed: %s",
+                    strerror(errno));
+    }
+    qatomic_dec(&memset_args->context->threads_running);
+    return NULL;
+}
+
 static inline int get_memset_num_threads(size_t hpagesize, size_t numpages,
                                          int max_threads)
 {
@@ -610,6 +626,71 @@ static bool madv_populate_write_possible(char *area, size_t pagesize)
            errno != EINVAL;
 }
 
+MemsetContext *qemu_prealloc_mem_background(int fd, char *area, size_t sz,
+                                            int max_threads, ThreadContext *tc,
+                                            Error **errp)
+{
+#ifndef EMSCRIPTEN
+    size_t hpagesize = qemu_fd_getpagesize(fd);
+#else
+    size_t hpagesize = qemu_real_host_page_size();
+#endif
+    size_t numpages = DIV_ROUND_UP(sz, hpagesize);
+    size_t numpages_per_thread, leftover;
+    MemsetContext *context;
+    char *addr = area;
+    int i;
+
+    /*
+     * Touching the pages would need the SIGBUS handler installed while
+     * the guest runs, so only MADV_POPULATE_WRITE is supported.
+     */
+    if (!madv_populate_write_possible(area, hpagesize)) {
+        error_setg(errp, "background preallocation requires "
+                   "MADV_POPULATE_WRITE");
+        return NULL;
+    }
+
+    context = g_new0(MemsetContext, 1);
+    context->num_threads =
+        get_memset_num_threads(hpagesize, numpages, max_threads);
+    context->threads_running = context->num_threads;
+    context->all_threads_created = true;
+    context->threads = g_new0(MemsetThread, context->num_threads);
+    numpages_per_thread = numpages / context->num_threads;
+    leftover = numpages % context->num_threads;
+
+    for (i = 0; i < context->num_threads; i++) {
+        context->threads[i].addr = addr;
+        context->threads[i].numpages = numpages_per_thread + (i < leftover);
+        context->threads[i].hpagesize = hpagesize;
+        context->threads[i].context = context;
+        if (tc) {
+            thread_context_create_thread(tc, &context->threads[i].pgthread,
+                                         "prealloc_bg",
+                                         do_madv_populate_background,
+                                         &context->threads[i],
+                                         QEMU_THREAD_JOINABLE);
+        } else {
+            qemu_thread_create(&context->threads[i].pgthread, "prealloc_bg",
+                               do_madv_populate_background,
+                               &context->threads[i], QEMU_THREAD_JOINABLE);
+        }
+        addr += context->threads[i].numpages * hpagesize;
+    }
+
+    return context;
+}
+
+bool qemu_prealloc_mem_background_done(MemsetContext *context)
+{
+    if (qatomic_read(&context->threads_running)) {
+        return false;
+    }
+    wait_and_free_mem_prealloc_context(context);
+    return true;
+}
+
 bool qemu_prealloc_mem(int fd, char *area, size_t sz, int max_threads,
                        ThreadContext *tc, bool async, Error **errp)
 {
@@ -784,6 +865,29 @@ void qemu_free_stack(void *stack, size_t sz)
     munmap(stack, sz);
 }
 
+void qemu_release_stack(void *stack, size_t sz, size_t keep)
+{
+#ifndef CONFIG_DEBUG_STACK_USAGE
+    size_t pagesz = qemu_real_host_page_size();
+    size_t len;
+
+    /* Skip the guard page at the bottom and the pages still in use */
+    keep = ROUND_UP(keep, pagesz);
+    if (sz <= keep + pagesz) {
+        return;
+    }
+    len = sz - keep - pagesz;
+
+#ifdef MADV_FREE
+    /* Pages are only reclaimed under memory pressure */
+    if (madvise(stack + pagesz, len, MADV_FREE) == 0) {
+        return;
+    }
+#endif
+    qemu_madvise(stack + pagesz, len, QEMU_MADV_DONTNEED);
+#endif
+}
+
 /*
  * Disable CFI checks.
  * We are going to call a signal handler directly. Such handler may or may not
@@ -285,6 +285,19 @@ bool qemu_finish_async_prealloc_mem(Error **errp)
     return true;
 }
 
+MemsetContext *qemu_prealloc_mem_background(int fd, char *area, size_t sz,
+                                            int max_threads, ThreadContext *tc,
+                                            Error **errp)
+{
+    error_setg(errp, "background preallocation not supported on Windows");
+    return NULL;
+}
+
+bool qemu_prealloc_mem_background_done(MemsetContext *context)
+{
+    return true;
+}
+
 char *qemu_get_pid_name(pid_t pid)
 {
     /* XXX Implement me */
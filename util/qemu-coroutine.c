@@ -19,6 +19,7 @@
 #include "qemu/coroutine_int.h"
 #include "qemu/coroutine-tls.h"
 #include "qemu/cutils.h"
+#include "qemu/stats64.h"
 #include "block/aio.h"
 
 enum {
@@ -44,6 +45,12 @@ enum {
  * .-------------------.
  * | Batch 1 | Batch 2 | per-thread local_pool (maximum 2 batches)
  * `-------------------'
+ *
+ * The memory of a coroutine's stack is only committed when it is touched.
+ * Before a batch is parked in the global pool, where it may stay unused for
+ * a long time, the stacks are handed back to the host except for the part
+ * that the coroutine trampoline still uses.  A request that ran deep once
+ * therefore does not pin that stack memory for the lifetime of the pool.
  */
 typedef struct CoroutinePoolBatch {
     /* Batches are kept in a list */
@@ -63,6 +70,11 @@ static QemuMutex global_pool_lock; /* protects the following variables */
 static CoroutinePool global_pool = QSLIST_HEAD_INITIALIZER(global_pool);
 static unsigned int global_pool_size;
 static unsigned int global_pool_max_size = COROUTINE_POOL_BATCH_MAX_SIZE;
+static uint64_t global_pool_refills;
+static uint64_t global_pool_stacks_released;
+
+static Stat64 coroutines_created;
+static Stat64 coroutines_deleted;
 
 QEMU_DEFINE_STATIC_CO_TLS(CoroutinePool, local_pool);
 QEMU_DEFINE_STATIC_CO_TLS(Notifier, local_pool_cleanup_notifier);
@@ -81,6 +93,9 @@ static void coroutine_pool_batch_delete(CoroutinePoolBatch *batch)
     Coroutine *co;
     Coroutine *tmp;
 
+    if (batch->size) {
+        stat64_add(&coroutines_deleted, batch->size);
+    }
     QSLIST_FOREACH_SAFE(co, &batch->list, pool_next, tmp) {
         QSLIST_REMOVE_HEAD(&batch->list, pool_next);
         qemu_coroutine_delete(co);
@@ -144,6 +159,7 @@ static void coroutine_pool_refill_local(void)
         if (batch) {
             QSLIST_REMOVE_HEAD(&global_pool, next);
             global_pool_size -= batch->size;
+            global_pool_refills++;
         }
     }
 
@@ -156,10 +172,21 @@ static void coroutine_pool_refill_local(void)
 /* Add a batch of coroutines to the global pool */
 static void coroutine_pool_put_global(CoroutinePoolBatch *batch)
 {
+    Coroutine *co;
+
+    /*
+     * Must be done before the batch is visible to other threads, which might
+     * start using the coroutines right away.
+     */
+    QSLIST_FOREACH(co, &batch->list, pool_next) {
+        qemu_coroutine_release_stack(co);
+    }
+
     WITH_QEMU_LOCK_GUARD(&global_pool_lock) {
         unsigned int max = MIN(global_pool_max_size,
                                global_pool_hard_max_size);
 
+        global_pool_stacks_released += batch->size;
         if (global_pool_size < max) {
             QSLIST_INSERT_HEAD(&global_pool, batch, next);
 
@@ -224,6 +251,7 @@ Coroutine *qemu_coroutine_create(CoroutineEntry *entry, void *opaque)
 
     if (!co) {
         co = qemu_coroutine_new();
+        stat64_inc(&coroutines_created);
     }
 
     co->entry = entry;
@@ -361,6 +389,19 @@ void qemu_coroutine_dec_pool_size(unsigned int removing_pool_size)
     global_pool_max_size -= removing_pool_size;
 }
 
+void qemu_coroutine_get_pool_stats(CoroutinePoolStats *stats)
+{
+    QEMU_LOCK_GUARD(&global_pool_lock);
+
+    *stats = (CoroutinePoolStats) {
+        .created            = stat64_get(&coroutines_created),
+        .deleted            = stat64_get(&coroutines_deleted),
+        .refills            = global_pool_refills,
+        .stacks_released    = global_pool_stacks_released,
+        .global_pool_size   = global_pool_size,
+    };
+}
+
 static unsigned int get_global_pool_hard_max_size(void)
 {
 #ifdef __linux__
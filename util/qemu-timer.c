@@ -62,12 +62,19 @@ static QEMUClock qemu_clocks[QEMU_CLOCK_MAX];
  * used by different AioContexts / threads. Each clock also has
  * a list of the QEMUTimerLists associated with it, in order that
  * reenabling the clock can call all the notifiers.
+ *
+ * Active timers are kept in a pairing heap rooted at active_timers,
+ * so that the earliest timer is always at the root and timer_mod and
+ * timer_del do not have to walk all the armed timers.  Timers with
+ * the same expire_time are ordered by the sequence number they got
+ * when they were armed, i.e. they fire in the order they were armed.
  */
 
 struct QEMUTimerList {
     QEMUClock *clock;
     QemuMutex active_timers_lock;
     QEMUTimer *active_timers;
+    uint64_t timer_seq;
     QLIST_ENTRY(QEMUTimerList) list;
     QEMUTimerListNotifyCB *notify_cb;
     void *notify_opaque;
@@ -94,6 +101,113 @@ static bool timer_expired_ns(const QEMUTimer *timer_head, int64_t current_time)
     return timer_head && (timer_head->expire_time <= current_time);
 }
 
+static bool timer_before(const QEMUTimer *a, const QEMUTimer *b)
+{
+    return a->expire_time < b->expire_time ||
+           (a->expire_time == b->expire_time && a->seq < b->seq);
+}
+
+/* Link two heaps, whose roots have no siblings, and return the new root */
+static QEMUTimer *timer_heap_meld(QEMUTimer *a, QEMUTimer *b)
+{
+    if (!a) {
+        return b;
+    }
+    if (!b) {
+        return a;
+    }
+    if (timer_before(b, a)) {
+        QEMUTimer *tmp = a;
+        a = b;
+        b = tmp;
+    }
+    b->prev = a;
+    b->next = a->child;
+    if (a->child) {
+        a->child->prev = b;
+    }
+    a->child = b;
+    return a;
+}
+
+/*
+ * Merge a list of sibling heaps into one: meld them in pairs from left to
+ * right, then meld the pairs from right to left.
+ */
+static QEMUTimer *timer_heap_merge_pairs(QEMUTimer *first)
+{
+    QEMUTimer *pairs = NULL;
+    QEMUTimer *root = NULL;
+    QEMUTimer *a, *b;
+
+    while (first) {
+        a = first;
+        b = a->next;
+        first = b ? b->next : NULL;
+        a->next = a->prev = NULL;
+        if (b) {
+            b->next = b->prev = NULL;
+            a = timer_heap_meld(a, b);
+        }
+        /* the pairs are chained in reverse order through ->next */
+        a->next = pairs;
+        pairs = a;
+    }
+
+    while (pairs) {
+        a = pairs;
+        pairs = a->next;
+        a->next = NULL;
+        root = timer_heap_meld(root, a);
+    }
+    return root;
+}
+
+static void timer_heap_remove(QEMUTimerList *timer_list, QEMUTimer *ts)
+{
+    QEMUTimer *sub = timer_heap_merge_pairs(ts->child);
+
+    if (ts == timer_list->active_timers) {
+        qatomic_set(&timer_list->active_timers, sub);
+    } else {
+        if (ts->prev->child == ts) {
+            ts->prev->child = ts->next;
+        } else {
+            ts->prev->next = ts->next;
+        }
+        if (ts->next) {
+            ts->next->prev = ts->prev;
+        }
+        timer_list->active_timers = timer_heap_meld(timer_list->active_timers,
+                                                    sub);
+    }
+    ts->child = ts->next = ts->prev = NULL;
+}
+
+/*
+ * Find the earliest timer whose attributes are all in @attr_mask among
+ * @first, its siblings and their descendants, or return @best if none is
+ * earlier.  Children never expire earlier than their parent, so subtrees
+ * whose root is not earlier than @best are skipped.
+ */
+static QEMUTimer *timer_heap_first_match(QEMUTimer *first, int attr_mask,
+                                         QEMUTimer *best)
+{
+    QEMUTimer *t;
+
+    for (t = first; t; t = t->next) {
+        if (best && !timer_before(t, best)) {
+            continue;
+        }
+        if (!(t->attributes & ~attr_mask)) {
+            best = t;
+        } else {
+            best = timer_heap_first_match(t->child, attr_mask, best);
+        }
+    }
+    return best;
+}
+
 QEMUTimerList *timerlist_new(QEMUClockType type,
                              QEMUTimerListNotifyCB *cb,
                              void *opaque)
@@ -266,11 +380,9 @@ int64_t qemu_clock_deadline_ns_all(QEMUClockType type, int attr_mask)
             continue;
         }
         qemu_mutex_lock(&timer_list->active_timers_lock);
-        ts = timer_list->active_timers;
         /* Skip all external timers */
-        while (ts && (ts->attributes & ~attr_mask)) {
-            ts = ts->next;
-        }
+        ts = timer_heap_first_match(timer_list->active_timers, attr_mask,
+                                    NULL);
         if (!ts) {
             qemu_mutex_unlock(&timer_list->active_timers_lock);
             continue;
@@ -371,41 +483,23 @@ void timer_deinit(QEMUTimer *ts)
 
 static void timer_del_locked(QEMUTimerList *timer_list, QEMUTimer *ts)
 {
-    QEMUTimer **pt, *t;
-
-    ts->expire_time = -1;
-    pt = &timer_list->active_timers;
-    for(;;) {
-        t = *pt;
-        if (!t)
-            break;
-        if (t == ts) {
-            qatomic_set(pt, t->next);
-            break;
-        }
-        pt = &t->next;
+    if (ts->expire_time != -1) {
+        timer_heap_remove(timer_list, ts);
     }
+    ts->expire_time = -1;
 }
 
 static bool timer_mod_ns_locked(QEMUTimerList *timer_list,
                                 QEMUTimer *ts, int64_t expire_time)
 {
-    QEMUTimer **pt, *t;
-
-    /* add the timer in the sorted list */
-    pt = &timer_list->active_timers;
-    for (;;) {
-        t = *pt;
-        if (!timer_expired_ns(t, expire_time)) {
-            break;
-        }
-        pt = &t->next;
-    }
+    /* add the timer to the heap, after those with the same expire_time */
     ts->expire_time = MAX(expire_time, 0);
-    ts->next = *pt;
-    qatomic_set(pt, ts);
+    ts->seq = timer_list->timer_seq++;
+    ts->child = ts->next = ts->prev = NULL;
+    qatomic_set(&timer_list->active_timers,
+                timer_heap_meld(timer_list->active_timers, ts));
 
-    return pt == &timer_list->active_timers;
+    return timer_list->active_timers == ts;
 }
 
 static void timerlist_rearm(QEMUTimerList *timer_list)
@@ -552,8 +646,7 @@ bool timerlist_run_timers(QEMUTimerList *timer_list)
         }
 
         /* remove timer from the list before calling the callback */
-        timer_list->active_timers = ts->next;
-        ts->next = NULL;
+        timer_heap_remove(timer_list, ts);
         ts->expire_time = -1;
         cb = ts->cb;
         opaque = ts->opaque;
@@ -22,8 +22,9 @@
  * - Writes (i.e. insertions/removals) can be concurrent with writes to
  *   different buckets; writes to the same bucket are serialized through a lock.
  * - Optional auto-resizing: the hash table resizes up if the load surpasses
- *   a certain threshold. Resizing is done concurrently with readers; writes
- *   are serialized with the resize operation.
+ *   a certain threshold. Auto-resizing is done incrementally, concurrently
+ *   with both readers and writers; explicit resizes are done concurrently
+ *   with readers, and writes are serialized with the resize operation.
  *
  * The key structure is the bucket, which is cacheline-sized. Buckets
  * contain a few hash values and pointers; the u32 hash values are stored in
@@ -43,14 +44,23 @@
  * just-removed entry. This makes lookups slightly faster, since the moment an
  * invalid entry is found, the (failed) lookup is over.
  *
- * Resizing is done by taking all bucket spinlocks (so that no other writers can
- * race with us) and then copying all entries into a new hash map. Then, the
- * ht->map pointer is set, and the old map is freed once no RCU readers can see
- * it anymore.
+ * A map that is being resized points to its replacement through map->next,
+ * and its head buckets are migrated to the new map in index order: every
+ * head bucket below map->n_migrated has had its entries copied to map->next,
+ * and the new map is the only valid place to look for them. Lookups and
+ * writers that land on a migrated bucket simply move on to map->next. Once
+ * all buckets are migrated, the ht->map pointer is set, and the old map is
+ * freed once no RCU readers can see it anymore.
  *
- * Writers check for concurrent resizes by comparing ht->map before and after
- * acquiring their bucket lock. If they don't match, a resize has occurred
- * while the bucket spinlock was being acquired.
+ * Auto-resizing migrates a few buckets at a time from the insertion path, so
+ * that vCPUs inserting into the table are not stalled for a whole copy.
+ * Explicit resizes instead take all bucket spinlocks (so that no other writers
+ * can race with us), copy all entries into the new map and mark the old map
+ * as fully migrated before releasing the locks.
+ *
+ * Writers check for concurrent resizes by checking, with the bucket lock held,
+ * whether their head bucket has been migrated; the cursor only advances with
+ * the bucket's lock held.
  *
  * Related Work:
  * - Idea of cacheline-sized buckets with full hashes taken from:
@@ -176,6 +186,9 @@ struct qht_tsan_lock {
  * @n_added_buckets: number of added (i.e. "non-head") buckets
  * @n_added_buckets_threshold: threshold to trigger an upward resize once the
  *                             number of added buckets surpasses it.
+ * @next: map being resized into, or NULL.
+ * @n_migrated: number of head buckets, starting from index 0, whose entries
+ *              have been migrated to @next.
  * @tsan_bucket_locks: Array of striped locks to be used only under TSAN.
  *
  * Buckets are tracked in what we call a "map", i.e. this structure.
@@ -186,6 +199,8 @@ struct qht_map {
     size_t n_buckets;
     size_t n_added_buckets;
     size_t n_added_buckets_threshold;
+    struct qht_map *next;
+    size_t n_migrated;
 #ifdef CONFIG_TSAN
     struct qht_tsan_lock tsan_bucket_locks[QHT_TSAN_BUCKET_LOCKS];
 #endif
@@ -194,9 +209,13 @@ struct qht_map {
 /* trigger a resize when n_added_buckets > n_buckets / div */
 #define QHT_NR_ADDED_BUCKETS_THRESHOLD_DIV 8
 
+/* number of head buckets migrated by each insertion during an auto-resize */
+#define QHT_MIGRATE_BATCH 16
+
 static void qht_do_resize_reset(struct qht *ht, struct qht_map *new,
                                 bool reset);
 static void qht_grow_maybe(struct qht *ht);
+static void qht_resize_finish__locked(struct qht *ht);
 
 #ifdef QHT_DEBUG
 
@@ -308,6 +327,16 @@ struct qht_bucket *qht_map_to_bucket(const struct qht_map *map, uint32_t hash)
     return &map->buckets[hash & (map->n_buckets - 1)];
 }
 
+/*
+ * Whether @b's entries now live in map->next. Readers must check this
+ * within @b's seqlock read section; writers must hold @b's lock.
+ */
+static inline bool qht_bucket_is_migrated(const struct qht_map *map,
+                                          const struct qht_bucket *b)
+{
+    return (size_t)(b - map->buckets) < qatomic_load_acquire(&map->n_migrated);
+}
+
 /* acquire all bucket locks from a map */
 static void qht_map_lock_buckets(struct qht_map *map)
 {
@@ -332,17 +361,8 @@ static void qht_map_unlock_buckets(struct qht_map *map)
 }
 
 /*
- * Call with at least a bucket lock held.
- * @map should be the value read before acquiring the lock (or locks).
- */
-static inline bool qht_map_is_stale__locked(const struct qht *ht,
-                                            const struct qht_map *map)
-{
-    return map != ht->map;
-}
-
-/*
- * Grab all bucket locks, and set @pmap after making sure the map isn't stale.
+ * Grab all bucket locks, and set @pmap after making sure the map isn't stale
+ * nor partially migrated.
  *
  * Pairs with qht_map_unlock_buckets(), hence the pass-by-reference.
  *
@@ -355,14 +375,19 @@ void qht_map_lock_buckets__no_stale(struct qht *ht, struct qht_map **pmap)
 
     map = qatomic_rcu_read(&ht->map);
     qht_map_lock_buckets(map);
-    if (likely(!qht_map_is_stale__locked(ht, map))) {
+    /* a stale map has all of its buckets migrated */
+    if (likely(qatomic_read(&map->n_migrated) == 0)) {
         *pmap = map;
         return;
     }
     qht_map_unlock_buckets(map);
 
-    /* we raced with a resize; acquire ht->lock to see the updated ht->map */
+    /*
+     * We raced with a resize; acquire ht->lock to complete it and see the
+     * updated ht->map.
+     */
     qht_lock(ht);
+    qht_resize_finish__locked(ht);
     map = ht->map;
     qht_map_lock_buckets(map);
     qht_unlock(ht);
@@ -370,8 +395,8 @@ void qht_map_lock_buckets__no_stale(struct qht *ht, struct qht_map **pmap)
 }
 
 /*
- * Get a head bucket and lock it, making sure its parent map is not stale.
- * @pmap is filled with a pointer to the bucket's parent map.
+ * Get a head bucket and lock it, making sure it has not been migrated to a
+ * new map. @pmap is filled with a pointer to the bucket's parent map.
  *
  * Unlock with qht_bucket_unlock.
  *
@@ -385,23 +410,20 @@ struct qht_bucket *qht_bucket_lock__no_stale(struct qht *ht, uint32_t hash,
     struct qht_map *map;
 
     map = qatomic_rcu_read(&ht->map);
-    b = qht_map_to_bucket(map, hash);
-
-    qht_bucket_lock(map, b);
-    if (likely(!qht_map_is_stale__locked(ht, map))) {
-        *pmap = map;
-        return b;
+    for (;;) {
+        struct qht_map *next;
+
+        b = qht_map_to_bucket(map, hash);
+        qht_bucket_lock(map, b);
+        if (likely(!qht_bucket_is_migrated(map, b))) {
+            *pmap = map;
+            return b;
+        }
+        /* we raced with a resize; follow the bucket to the new map */
+        next = map->next;
+        qht_bucket_unlock(map, b);
+        map = next;
     }
-    qht_bucket_unlock(map, b);
-
-    /* we raced with a resize; acquire ht->lock to see the updated ht->map */
-    qht_lock(ht);
-    map = ht->map;
-    b = qht_map_to_bucket(map, hash);
-    qht_bucket_lock(map, b);
-    qht_unlock(ht);
-    *pmap = map;
-    return b;
 }
 
 static inline bool qht_map_needs_resize(const struct qht_map *map)
@@ -445,6 +467,8 @@ static struct qht_map *qht_map_create(size_t n_buckets)
     map->n_buckets = n_buckets;
 
     map->n_added_buckets = 0;
+    map->next = NULL;
+    map->n_migrated = 0;
     map->n_added_buckets_threshold = n_buckets /
         QHT_NR_ADDED_BUCKETS_THRESHOLD_DIV;
 
@@ -478,6 +502,9 @@ void qht_init(struct qht *ht, qht_cmp_func_t cmp, size_t n_elems,
 /* call only when there are no readers/writers left */
 void qht_destroy(struct qht *ht)
 {
+    if (ht->map->next) {
+        qht_map_destroy(ht->map->next);
+    }
     qht_map_destroy(ht->map);
     memset(ht, 0, sizeof(*ht));
 }
@@ -541,6 +568,7 @@ bool qht_reset_size(struct qht *ht, size_t n_elems)
     n_buckets = qht_elems_to_buckets(n_elems);
 
     qht_lock(ht);
+    qht_resize_finish__locked(ht);
     map = ht->map;
     if (n_buckets != map->n_buckets) {
         new = qht_map_create(n_buckets);
@@ -579,17 +607,25 @@ void *qht_do_lookup(const struct qht_bucket *head, qht_lookup_func_t func,
 }
 
 static __attribute__((noinline))
-void *qht_lookup__slowpath(const struct qht_bucket *b, qht_lookup_func_t func,
+void *qht_lookup__slowpath(const struct qht_map *map,
+                           const struct qht_bucket *b, qht_lookup_func_t func,
                            const void *userp, uint32_t hash)
 {
     unsigned int version;
     void *ret;
 
-    do {
+    for (;;) {
         version = seqlock_read_begin(&b->sequence);
+        if (qht_bucket_is_migrated(map, b)) {
+            map = qatomic_rcu_read(&map->next);
+            b = qht_map_to_bucket(map, hash);
+            continue;
+        }
         ret = qht_do_lookup(b, func, userp, hash);
-    } while (seqlock_read_retry(&b->sequence, version));
-    return ret;
+        if (!seqlock_read_retry(&b->sequence, version)) {
+            return ret;
+        }
+    }
 }
 
 void *qht_lookup_custom(const struct qht *ht, const void *userp, uint32_t hash,
@@ -604,15 +640,17 @@ void *qht_lookup_custom(const struct qht *ht, const void *userp, uint32_t hash,
     b = qht_map_to_bucket(map, hash);
 
     version = seqlock_read_begin(&b->sequence);
-    ret = qht_do_lookup(b, func, userp, hash);
-    if (likely(!seqlock_read_retry(&b->sequence, version))) {
-        return ret;
+    if (likely(!qht_bucket_is_migrated(map, b))) {
+        ret = qht_do_lookup(b, func, userp, hash);
+        if (likely(!seqlock_read_retry(&b->sequence, version))) {
+            return ret;
+        }
     }
     /*
      * Removing the do/while from the fastpath gives a 4% perf. increase when
      * running a 100%-lookup microbenchmark.
      */
-    return qht_lookup__slowpath(b, func, userp, hash);
+    return qht_lookup__slowpath(map, b, func, userp, hash);
 }
 
 void *qht_lookup(const struct qht *ht, const void *userp, uint32_t hash)
@@ -670,24 +708,93 @@ static void *qht_insert__locked(const struct qht *ht, struct qht_map *map,
     return NULL;
 }
 
+/*
+ * Copy the entries of @map's head bucket @idx to map->next, then mark the
+ * bucket as migrated. Call with ht->lock held.
+ */
+static void qht_map_migrate_bucket(struct qht *ht, struct qht_map *map,
+                                   size_t idx)
+{
+    struct qht_map *new = map->next;
+    struct qht_bucket *head = &map->buckets[idx];
+    struct qht_bucket *b;
+    int i;
+
+    g_assert(idx == map->n_migrated);
+    qht_bucket_lock(map, head);
+    for (b = head; b; b = b->next) {
+        for (i = 0; i < QHT_BUCKET_ENTRIES && b->pointers[i]; i++) {
+            struct qht_bucket *nb = qht_map_to_bucket(new, b->hashes[i]);
+
+            qht_bucket_lock(new, nb);
+            qht_insert__locked(ht, new, nb, b->pointers[i], b->hashes[i],
+                               NULL);
+            qht_bucket_debug__locked(nb);
+            qht_bucket_unlock(new, nb);
+        }
+    }
+
+    /* make lookups that are reading the old bucket retry in the new map */
+    seqlock_write_begin(&head->sequence);
+    qatomic_store_release(&map->n_migrated, idx + 1);
+    seqlock_write_end(&head->sequence);
+    qht_bucket_unlock(map, head);
+}
+
+/*
+ * Migrate up to @n head buckets of an ongoing resize, and switch ht->map
+ * once all of them are. Call with ht->lock held.
+ */
+static void qht_resize_step__locked(struct qht *ht, size_t n)
+{
+    struct qht_map *map = ht->map;
+    size_t end;
+
+    if (map->next == NULL) {
+        return;
+    }
+    end = map->n_buckets;
+    if (end - map->n_migrated > n) {
+        end = map->n_migrated + n;
+    }
+    while (map->n_migrated < end) {
+        qht_map_migrate_bucket(ht, map, map->n_migrated);
+    }
+    if (map->n_migrated == map->n_buckets) {
+        qatomic_rcu_set(&ht->map, map->next);
+        call_rcu(map, qht_map_destroy, rcu);
+    }
+}
+
+static void qht_resize_finish__locked(struct qht *ht)
+{
+    qht_resize_step__locked(ht, SIZE_MAX);
+}
+
+static inline bool qht_resize_in_progress(const struct qht *ht)
+{
+    const struct qht_map *map = qatomic_rcu_read(&ht->map);
+
+    return qatomic_read(&map->next) != NULL;
+}
+
 static __attribute__((noinline)) void qht_grow_maybe(struct qht *ht)
 {
     struct qht_map *map;
 
     /*
-     * If the lock is taken it probably means there's an ongoing resize,
-     * so bail out.
+     * If the lock is taken it probably means another thread is migrating
+     * buckets, so bail out.
      */
     if (qht_trylock(ht)) {
         return;
     }
     map = ht->map;
-    /* another thread might have just performed the resize we were after */
-    if (qht_map_needs_resize(map)) {
-        struct qht_map *new = qht_map_create(map->n_buckets * 2);
-
-        qht_do_resize(ht, new);
+    /* another thread might have just started the resize we were after */
+    if (map->next == NULL && qht_map_needs_resize(map)) {
+        qatomic_rcu_set(&map->next, qht_map_create(map->n_buckets * 2));
     }
+    qht_resize_step__locked(ht, QHT_MIGRATE_BATCH);
     qht_unlock(ht);
 }
 
@@ -706,7 +813,8 @@ bool qht_insert(struct qht *ht, void *p, uint32_t hash, void **existing)
     qht_bucket_debug__locked(b);
     qht_bucket_unlock(map, b);
 
-    if (unlikely(needs_resize) && ht->mode & QHT_MODE_AUTO_RESIZE) {
+    if (unlikely(needs_resize || qht_resize_in_progress(ht)) &&
+        ht->mode & QHT_MODE_AUTO_RESIZE) {
         qht_grow_maybe(ht);
     }
     if (likely(prev == NULL)) {
@@ -871,8 +979,7 @@ do_qht_iter(struct qht *ht, const struct qht_iter *iter, void *userp)
 {
     struct qht_map *map;
 
-    map = qatomic_rcu_read(&ht->map);
-    qht_map_lock_buckets(map);
+    qht_map_lock_buckets__no_stale(ht, &map);
     qht_map_iter__all_locked(map, iter, userp);
     qht_map_unlock_buckets(map);
 }
@@ -926,6 +1033,7 @@ static void qht_do_resize_reset(struct qht *ht, struct qht_map *new, bool reset)
     };
     struct qht_map_copy_data data;
 
+    qht_resize_finish__locked(ht);
     old = ht->map;
     qht_map_lock_buckets(old);
 
@@ -944,6 +1052,8 @@ static void qht_do_resize_reset(struct qht *ht, struct qht_map *new, bool reset)
     qht_map_iter__all_locked(old, &iter, &data);
     qht_map_debug__all_locked(new);
 
+    qatomic_rcu_set(&old->next, new);
+    qatomic_store_release(&old->n_migrated, old->n_buckets);
     qatomic_rcu_set(&ht->map, new);
     qht_map_unlock_buckets(old);
     call_rcu(old, qht_map_destroy, rcu);
@@ -955,6 +1065,7 @@ bool qht_resize(struct qht *ht, size_t n_elems)
     size_t ret = false;
 
     qht_lock(ht);
+    qht_resize_finish__locked(ht);
     if (n_buckets != ht->map->n_buckets) {
         struct qht_map *new;
 
@@ -967,60 +1078,81 @@ bool qht_resize(struct qht *ht, size_t n_elems)
     return ret;
 }
 
+static void qht_bucket_statistics(const struct qht_bucket *head,
+                                  struct qht_stats *stats)
+{
+    const struct qht_bucket *b;
+    unsigned int version;
+    size_t buckets;
+    size_t entries;
+    int j;
+
+    do {
+        version = seqlock_read_begin(&head->sequence);
+        buckets = 0;
+        entries = 0;
+        b = head;
+        do {
+            for (j = 0; j < QHT_BUCKET_ENTRIES; j++) {
+                if (qatomic_read(&b->pointers[j]) == NULL) {
+                    break;
+                }
+                entries++;
+            }
+            buckets++;
+            b = qatomic_rcu_read(&b->next);
+        } while (b);
+    } while (seqlock_read_retry(&head->sequence, version));
+
+    stats->head_buckets++;
+    if (entries) {
+        qdist_inc(&stats->chain, buckets);
+        qdist_inc(&stats->occupancy,
+                  (double)entries / QHT_BUCKET_ENTRIES / buckets);
+        stats->used_head_buckets++;
+        stats->entries += entries;
+    } else {
+        qdist_inc(&stats->occupancy, 0);
+    }
+}
+
 /* pass @stats to qht_statistics_destroy() when done */
 void qht_statistics_init(const struct qht *ht, struct qht_stats *stats)
 {
     const struct qht_map *map;
-    int i;
+    const struct qht_map *new;
+    size_t n_migrated = 0;
+    size_t i;
 
     map = qatomic_rcu_read(&ht->map);
 
+    stats->head_buckets = 0;
     stats->used_head_buckets = 0;
     stats->entries = 0;
     qdist_init(&stats->chain);
     qdist_init(&stats->occupancy);
     /* bail out if the qht has not yet been initialized */
     if (unlikely(map == NULL)) {
-        stats->head_buckets = 0;
         return;
     }
-    stats->head_buckets = map->n_buckets;
-
-    for (i = 0; i < map->n_buckets; i++) {
-        const struct qht_bucket *head = &map->buckets[i];
-        const struct qht_bucket *b;
-        unsigned int version;
-        size_t buckets;
-        size_t entries;
-        int j;
 
-        do {
-            version = seqlock_read_begin(&head->sequence);
-            buckets = 0;
-            entries = 0;
-            b = head;
-            do {
-                for (j = 0; j < QHT_BUCKET_ENTRIES; j++) {
-                    if (qatomic_read(&b->pointers[j]) == NULL) {
-                        break;
-                    }
-                    entries++;
-                }
-                buckets++;
-                b = qatomic_rcu_read(&b->next);
-            } while (b);
-        } while (seqlock_read_retry(&head->sequence, version));
-
-        if (entries) {
-            qdist_inc(&stats->chain, buckets);
-            qdist_inc(&stats->occupancy,
-                      (double)entries / QHT_BUCKET_ENTRIES / buckets);
-            stats->used_head_buckets++;
-            stats->entries += entries;
-        } else {
-            qdist_inc(&stats->occupancy, 0);
+    /*
+     * During an auto-resize, the new map is twice as large and its bucket i
+     * holds entries from the old map's bucket i % map->n_buckets; only count
+     * those whose old bucket has been migrated.
+     */
+    new = qatomic_rcu_read(&map->next);
+    if (new) {
+        n_migrated = qatomic_load_acquire(&map->n_migrated);
+        for (i = 0; i < new->n_buckets; i++) {
+            if ((i & (map->n_buckets - 1)) < n_migrated) {
+                qht_bucket_statistics(&new->buckets[i], stats);
+            }
         }
     }
+    for (i = n_migrated; i < map->n_buckets; i++) {
+        qht_bucket_statistics(&map->buckets[i], stats);
+    }
 }
 
 void qht_statistics_destroy(struct qht_stats *stats)
@@ -24,6 +24,11 @@
  * synchronization objects this might be expensive, but note that it is
  * very rarely called -- reports are generated only when requested by users.
  *
+ * To keep the overhead low enough for profiling to stay enabled on production
+ * hosts, QSP can sample only one in N operations. Each thread counts its own
+ * operations, and sampled ones are recorded with a weight of N, so that
+ * reports estimate the totals.
+ *
  * Reports are generated as a table where each row represents a call site. A
  * call site is the triplet formed by the __file__ and __LINE__ of the caller
  * as well as the address of the "object" (i.e. mutex, rec. mutex or condvar)
@@ -107,6 +112,10 @@ static size_t qsp_qemu_path_len;
 /* the address of qsp_thread gives us a unique 'thread ID' */
 static __thread int qsp_thread;
 
+/* profile one in qsp_sample_period operations */
+static unsigned int qsp_sample_period = 1;
+static __thread unsigned int qsp_sample_countdown;
+
 /*
  * Call sites are the same for all threads, so we track them in a separate hash
  * table to save memory.
@@ -344,46 +353,71 @@ static QSPEntry *qsp_entry_get(const void *obj, const char *file, int line,
  * @e is in the global hash table; it is only written to by the current thread,
  * so we write to it atomically (as in "write once") to prevent torn reads.
  */
-static inline void do_qsp_entry_record(QSPEntry *e, int64_t delta, bool acq)
+static inline void do_qsp_entry_record(QSPEntry *e, int64_t delta,
+                                       unsigned int weight, bool acq)
 {
-    qatomic_set_u64(&e->ns, e->ns + delta);
+    qatomic_set_u64(&e->ns, e->ns + delta * weight);
     if (acq) {
-        qatomic_set_u64(&e->n_acqs, e->n_acqs + 1);
+        qatomic_set_u64(&e->n_acqs, e->n_acqs + weight);
     }
 }
 
-static inline void qsp_entry_record(QSPEntry *e, int64_t delta)
+static inline void qsp_entry_record(QSPEntry *e, int64_t delta,
+                                    unsigned int weight)
+{
+    do_qsp_entry_record(e, delta, weight, true);
+}
+
+/*
+ * Return 0 if the current operation should not be profiled, otherwise the
+ * number of operations it stands for.
+ */
+static inline unsigned int qsp_sample_weight(void)
 {
-    do_qsp_entry_record(e, delta, true);
+    if (likely(qsp_sample_countdown)) {
+        qsp_sample_countdown--;
+        return 0;
+    }
+    qsp_sample_countdown = qatomic_read(&qsp_sample_period) - 1;
+    return qsp_sample_countdown + 1;
 }
 
 #define QSP_GEN_VOID(type_, qsp_t_, func_, impl_)                       \
     static void func_(type_ *obj, const char *file, int line)           \
     {                                                                   \
+        unsigned int weight = qsp_sample_weight();                      \
         QSPEntry *e;                                                    \
         int64_t t0, t1;                                                 \
                                                                         \
+        if (!weight) {                                                  \
+            impl_(obj, file, line);                                     \
+            return;                                                     \
+        }                                                               \
         t0 = get_clock();                                               \
         impl_(obj, file, line);                                         \
         t1 = get_clock();                                               \
                                                                         \
         e = qsp_entry_get(obj, file, line, qsp_t_);                     \
-        qsp_entry_record(e, t1 - t0);                                   \
+        qsp_entry_record(e, t1 - t0, weight);                           \
     }
 
 #define QSP_GEN_RET1(type_, qsp_t_, func_, impl_)                       \
     static int func_(type_ *obj, const char *file, int line)            \
     {                                                                   \
+        unsigned int weight = qsp_sample_weight();                      \
         QSPEntry *e;                                                    \
         int64_t t0, t1;                                                 \
         int err;                                                        \
                                                                         \
+        if (!weight) {                                                  \
+            return impl_(obj, file, line);                              \
+        }                                                               \
         t0 = get_clock();                                               \
         err = impl_(obj, file, line);                                   \
         t1 = get_clock();                                               \
                                                                         \
         e = qsp_entry_get(obj, file, line, qsp_t_);                     \
-        do_qsp_entry_record(e, t1 - t0, !err);                          \
+        do_qsp_entry_record(e, t1 - t0, weight, !err);                  \
         return err;                                                     \
     }
 
@@ -402,31 +436,40 @@ QSP_GEN_RET1(QemuRecMutex, QSP_REC_MUTEX, qsp_rec_mutex_trylock,
 static void
 qsp_cond_wait(QemuCond *cond, QemuMutex *mutex, const char *file, int line)
 {
+    unsigned int weight = qsp_sample_weight();
     QSPEntry *e;
     int64_t t0, t1;
 
+    if (!weight) {
+        qemu_cond_wait_impl(cond, mutex, file, line);
+        return;
+    }
     t0 = get_clock();
     qemu_cond_wait_impl(cond, mutex, file, line);
     t1 = get_clock();
 
     e = qsp_entry_get(cond, file, line, QSP_CONDVAR);
-    qsp_entry_record(e, t1 - t0);
+    qsp_entry_record(e, t1 - t0, weight);
 }
 
 static bool
 qsp_cond_timedwait(QemuCond *cond, QemuMutex *mutex, int ms,
                    const char *file, int line)
 {
+    unsigned int weight = qsp_sample_weight();
     QSPEntry *e;
     int64_t t0, t1;
     bool ret;
 
+    if (!weight) {
+        return qemu_cond_timedwait_impl(cond, mutex, ms, file, line);
+    }
     t0 = get_clock();
     ret = qemu_cond_timedwait_impl(cond, mutex, ms, file, line);
     t1 = get_clock();
 
     e = qsp_entry_get(cond, file, line, QSP_CONDVAR);
-    qsp_entry_record(e, t1 - t0);
+    qsp_entry_record(e, t1 - t0, weight);
     return ret;
 }
 
@@ -446,6 +489,16 @@ void qsp_enable(void)
     qatomic_set(&qemu_cond_timedwait_func, qsp_cond_timedwait);
 }
 
+void qsp_set_sample_period(unsigned int period)
+{
+    qatomic_set(&qsp_sample_period, MAX(period, 1));
+}
+
+unsigned int qsp_get_sample_period(void)
+{
+    return qatomic_read(&qsp_sample_period);
+}
+
 void qsp_disable(void)
 {
     qatomic_set(&qemu_mutex_lock_func, qemu_mutex_lock_impl);
@@ -662,6 +715,7 @@ struct QSPReportEntry {
     const void *obj;
     char *callsite_at;
     const char *typename;
+    uint64_t ns;
     double time_s;
     double ns_avg;
     uint64_t n_acqs;
@@ -692,6 +746,7 @@ static gboolean qsp_tree_report(gpointer key, gpointer value, gpointer udata)
     entry->n_objs = e->n_objs;
     entry->callsite_at = qsp_at(e->callsite);
     entry->typename = qsp_typenames[e->callsite->type];
+    entry->ns = e->ns;
     entry->time_s = e->ns * 1e-9;
     entry->n_acqs = e->n_acqs;
     entry->ns_avg = e->n_acqs ? e->ns / e->n_acqs : 0;
@@ -765,23 +820,45 @@ static void report_destroy(QSPReport *rep)
     g_free(rep->entries);
 }
 
+static void report_init(QSPReport *rep, size_t max, enum QSPSortBy sort_by,
+                        bool callsite_coalesce)
+{
+    GTree *tree = g_tree_new_full(qsp_tree_cmp, &sort_by, g_free, NULL);
+
+    rep->entries = g_new0(QSPReportEntry, max);
+    rep->n_entries = 0;
+    rep->max_n_entries = max;
+
+    qsp_mktree(tree, callsite_coalesce);
+    g_tree_foreach(tree, qsp_tree_report, rep);
+    g_tree_destroy(tree);
+}
+
 void qsp_report(size_t max, enum QSPSortBy sort_by,
                 bool callsite_coalesce)
 {
-    GTree *tree = g_tree_new_full(qsp_tree_cmp, &sort_by, g_free, NULL);
     QSPReport rep;
 
     qsp_init();
 
-    rep.entries = g_new0(QSPReportEntry, max);
-    rep.n_entries = 0;
-    rep.max_n_entries = max;
+    report_init(&rep, max, sort_by, callsite_coalesce);
+    pr_report(&rep);
+    report_destroy(&rep);
+}
 
-    qsp_mktree(tree, callsite_coalesce);
-    g_tree_foreach(tree, qsp_tree_report, &rep);
-    g_tree_destroy(tree);
+void qsp_foreach_call_site(size_t max, QSPCallSiteFunc *func, void *opaque)
+{
+    QSPReport rep;
+    size_t i;
 
-    pr_report(&rep);
+    qsp_init();
+
+    report_init(&rep, max, QSP_SORT_BY_TOTAL_WAIT_TIME, true);
+    for (i = 0; i < rep.n_entries; i++) {
+        const QSPReportEntry *e = &rep.entries[i];
+
+        func(opaque, e->callsite_at, e->typename, e->ns, e->n_acqs);
+    }
     report_destroy(&rep);
 }
 
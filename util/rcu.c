@@ -32,6 +32,7 @@
 #include "qemu/thread.h"
 #include "qemu/main-loop.h"
 #include "qemu/lockable.h"
+#include "qemu/stats64.h"
 #if defined(CONFIG_MALLOC_TRIM)
 #include <malloc.h>
 #endif
@@ -46,6 +47,17 @@
 
 #define RCU_CALL_MIN_SIZE        30
 
+/*
+ * While waiting for readers without forcing the grace period, poll
+ * every millisecond so that a burst of call_rcu() quickly switches to
+ * a forced grace period; give up polling after RCU_POLL_MAX_SLEEPS.
+ */
+#define RCU_POLL_INTERVAL_US     1000
+#define RCU_POLL_MAX_SLEEPS      50
+
+/* Number of callbacks to run before giving other threads a chance at the BQL */
+#define RCU_CALL_BQL_BATCH       100
+
 unsigned long rcu_gp_ctr = RCU_GP_LOCKED;
 
 QemuEvent rcu_gp_event;
@@ -54,6 +66,11 @@ static int rcu_call_count;
 static QemuMutex rcu_registry_lock;
 static QemuMutex rcu_sync_lock;
 
+static Stat64 rcu_grace_periods;
+static Stat64 rcu_forced_grace_periods;
+static Stat64 rcu_callbacks;
+static Stat64 rcu_callback_backlog_peak;
+
 /*
  * Check whether a quiescent state was crossed between the beginning of
  * update_counter_and_wait and now.
@@ -96,8 +113,10 @@ static void wait_for_readers(void)
          */
         if (!forced &&
             (qatomic_read(&rcu_call_count) >= RCU_CALL_MIN_SIZE ||
-             sleeps >= 5 || qatomic_read(&in_drain_call_rcu))) {
+             sleeps >= RCU_POLL_MAX_SLEEPS ||
+             qatomic_read(&in_drain_call_rcu))) {
             forced = true;
+            stat64_add(&rcu_forced_grace_periods, 1);
 
             QLIST_FOREACH(index, &registry, node) {
                 notifier_list_notify(&index->force_rcu, NULL);
@@ -160,7 +179,7 @@ static void wait_for_readers(void)
              */
             qemu_event_reset(&rcu_gp_event);
         } else {
-            g_usleep(10000);
+            g_usleep(RCU_POLL_INTERVAL_US);
             sleeps++;
         }
 
@@ -200,6 +219,7 @@ void synchronize_rcu(void)
         }
 
         wait_for_readers();
+        stat64_add(&rcu_grace_periods, 1);
     }
 }
 
@@ -285,7 +305,7 @@ static void *call_rcu_thread(void *opaque)
     rcu_register_thread();
 
     for (;;) {
-        int n;
+        int n, batch;
 
         /*
          * Fetch rcu_call_count now, we only must process elements that were
@@ -304,9 +324,12 @@ static void *call_rcu_thread(void *opaque)
             qemu_event_wait(&rcu_call_ready_event);
         }
 
+        stat64_max(&rcu_callback_backlog_peak, n);
         synchronize_rcu();
         qatomic_sub(&rcu_call_count, n);
+        stat64_add(&rcu_callbacks, n);
         bql_lock();
+        batch = 0;
         while (n > 0) {
             node = try_dequeue();
             while (!node) {
@@ -322,6 +345,16 @@ static void *call_rcu_thread(void *opaque)
 
             n--;
             node->func(node);
+
+            /*
+             * A large backlog can take a while to free; do not starve
+             * vCPU threads and the main loop for the whole of it.
+             */
+            if (++batch == RCU_CALL_BQL_BATCH && n > 0) {
+                bql_unlock();
+                bql_lock();
+                batch = 0;
+            }
         }
         bql_unlock();
     }
@@ -408,6 +441,15 @@ void rcu_unregister_thread(void)
     qemu_mutex_unlock(&rcu_registry_lock);
 }
 
+void rcu_get_stats(RCUStats *stats)
+{
+    stats->grace_periods = stat64_get(&rcu_grace_periods);
+    stats->forced_grace_periods = stat64_get(&rcu_forced_grace_periods);
+    stats->callbacks = stat64_get(&rcu_callbacks);
+    stats->callback_backlog_peak = stat64_get(&rcu_callback_backlog_peak);
+    stats->callbacks_pending = qatomic_read(&rcu_call_count);
+}
+
 void rcu_add_force_rcu_notifier(Notifier *n)
 {
     qemu_mutex_lock(&rcu_registry_lock);
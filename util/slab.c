@@ -0,0 +1,172 @@
+/*
+ * Per-thread free lists for frequently allocated objects
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/host-utils.h"
+#include "qemu/lockable.h"
+#include "qemu/notify.h"
+#include "qemu/queue.h"
+#include "qemu/slab.h"
+#include "qemu/stats64.h"
+#include "qemu/thread.h"
+
+/* Size classes are 64, 128, ..., 8192 bytes; larger objects bypass the lists */
+#define SLAB_MIN_SHIFT 6
+#define SLAB_MAX_SHIFT 13
+#define SLAB_NUM_CLASSES (SLAB_MAX_SHIFT - SLAB_MIN_SHIFT + 1)
+
+/* Objects kept per size class and thread; the rest go back to g_free() */
+#define SLAB_MAX_FREE 256
+
+typedef struct SlabFreeObject {
+    struct SlabFreeObject *next;
+} SlabFreeObject;
+
+typedef struct SlabThreadCache {
+    SlabFreeObject *free[SLAB_NUM_CLASSES];
+    unsigned int nfree[SLAB_NUM_CLASSES];
+
+    /* Only written by the owning thread, read by qemu_slab_get_stats() */
+    Stat64 hits;
+    Stat64 misses;
+
+    Notifier exit_notifier;
+    QLIST_ENTRY(SlabThreadCache) next;
+} SlabThreadCache;
+
+static __thread SlabThreadCache *slab_cache;
+
+static QemuMutex slab_lock;
+static QLIST_HEAD(, SlabThreadCache) slab_caches =
+    QLIST_HEAD_INITIALIZER(slab_caches);
+
+/* Counters of threads that have exited */
+static Stat64 slab_retired_hits;
+static Stat64 slab_retired_misses;
+
+static void __attribute__((__constructor__)) slab_init(void)
+{
+    qemu_mutex_init(&slab_lock);
+}
+
+static int slab_class(size_t size)
+{
+    int shift;
+
+    if (size > (1 << SLAB_MAX_SHIFT)) {
+        return -1;
+    }
+    shift = size <= (1 << SLAB_MIN_SHIFT) ? SLAB_MIN_SHIFT
+                                          : 64 - clz64(size - 1);
+    return shift - SLAB_MIN_SHIFT;
+}
+
+static void slab_thread_exit(Notifier *n, void *data)
+{
+    SlabThreadCache *c = container_of(n, SlabThreadCache, exit_notifier);
+    int i;
+
+    WITH_QEMU_LOCK_GUARD(&slab_lock) {
+        QLIST_REMOVE(c, next);
+        stat64_add(&slab_retired_hits, stat64_get(&c->hits));
+        stat64_add(&slab_retired_misses, stat64_get(&c->misses));
+    }
+
+    for (i = 0; i < SLAB_NUM_CLASSES; i++) {
+        while (c->free[i]) {
+            SlabFreeObject *obj = c->free[i];
+
+            c->free[i] = obj->next;
+            g_free(obj);
+        }
+    }
+
+    slab_cache = NULL;
+    g_free(c);
+}
+
+static SlabThreadCache *slab_get_thread_cache(void)
+{
+    SlabThreadCache *c = slab_cache;
+
+    if (likely(c)) {
+        return c;
+    }
+
+    c = g_new0(SlabThreadCache, 1);
+    c->exit_notifier.notify = slab_thread_exit;
+    qemu_thread_atexit_add(&c->exit_notifier);
+
+    WITH_QEMU_LOCK_GUARD(&slab_lock) {
+        QLIST_INSERT_HEAD(&slab_caches, c, next);
+    }
+
+    slab_cache = c;
+    return c;
+}
+
+void *qemu_slab_alloc(size_t size)
+{
+    SlabThreadCache *c;
+    SlabFreeObject *obj;
+    int i = slab_class(size);
+
+    if (i < 0) {
+        return g_malloc(size);
+    }
+
+    c = slab_get_thread_cache();
+    obj = c->free[i];
+    if (obj) {
+        c->free[i] = obj->next;
+        c->nfree[i]--;
+        stat64_add(&c->hits, 1);
+        return obj;
+    }
+
+    stat64_add(&c->misses, 1);
+    return g_malloc(1 << (i + SLAB_MIN_SHIFT));
+}
+
+void qemu_slab_free(void *ptr, size_t size)
+{
+    SlabThreadCache *c;
+    SlabFreeObject *obj = ptr;
+    int i = slab_class(size);
+
+    if (!ptr) {
+        return;
+    }
+
+    c = slab_cache;
+    if (i < 0 || !c || c->nfree[i] >= SLAB_MAX_FREE) {
+        /*
+         * Threads that never allocated from the slab (e.g. thread pool
+         * workers completing requests) do not get a cache of their own.
+         */
+        g_free(ptr);
+        return;
+    }
+
+    obj->next = c->free[i];
+    c->free[i] = obj;
+    c->nfree[i]++;
+}
+
+void qemu_slab_get_stats(uint64_t *hits, uint64_t *misses)
+{
+    SlabThreadCache *c;
+
+    QEMU_LOCK_GUARD(&slab_lock);
+
+    *hits = stat64_get(&slab_retired_hits);
+    *misses = stat64_get(&slab_retired_misses);
+    QLIST_FOREACH(c, &slab_caches, next) {
+        *hits += stat64_get(&c->hits);
+        *misses += stat64_get(&c->misses);
+    }
+}
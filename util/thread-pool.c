@@ -46,6 +46,9 @@ struct ThreadPoolElementAio {
     enum ThreadState state;
     int ret;
 
+    ThreadPoolPrio prio;
+    int64_t submit_ns;
+
     /* Access to this list is protected by lock.  */
     QTAILQ_ENTRY(ThreadPoolElementAio) reqs;
 
@@ -65,7 +68,11 @@ struct ThreadPoolAio {
     QLIST_HEAD(, ThreadPoolElementAio) head;
 
     /* The following variables are protected by lock.  */
-    QTAILQ_HEAD(, ThreadPoolElementAio) request_list;
+    QTAILQ_HEAD(, ThreadPoolElementAio) request_list[THREAD_POOL_PRIO__MAX];
+    int active_bulk;     /* workers running THREAD_POOL_PRIO_BULK requests */
+    uint64_t nr_queued;
+    uint64_t nr_requests;
+    uint64_t wait_ns;
     int cur_threads;
     int idle_threads;
     int new_threads;     /* backlog of threads we need to create */
@@ -74,6 +81,19 @@ struct ThreadPoolAio {
     int max_threads;
 };
 
+/* Returns the request a worker should pick up next, if any */
+static ThreadPoolElementAio *thread_pool_next_request(ThreadPoolAio *pool)
+{
+    ThreadPoolElementAio *req;
+
+    /* Runs with lock taken.  */
+    req = QTAILQ_FIRST(&pool->request_list[THREAD_POOL_PRIO_NORMAL]);
+    if (!req && pool->active_bulk < MAX(1, pool->max_threads / 2)) {
+        req = QTAILQ_FIRST(&pool->request_list[THREAD_POOL_PRIO_BULK]);
+    }
+    return req;
+}
+
 static void *worker_thread(void *opaque)
 {
     ThreadPoolAio *pool = opaque;
@@ -84,14 +104,16 @@ static void *worker_thread(void *opaque)
 
     while (pool->cur_threads <= pool->max_threads) {
         ThreadPoolElementAio *req;
+        ThreadPoolPrio prio;
         int ret;
 
-        if (QTAILQ_EMPTY(&pool->request_list)) {
+        req = thread_pool_next_request(pool);
+        if (!req) {
             pool->idle_threads++;
             ret = qemu_cond_timedwait(&pool->request_cond, &pool->lock, 10000);
             pool->idle_threads--;
             if (ret == 0 &&
-                QTAILQ_EMPTY(&pool->request_list) &&
+                !thread_pool_next_request(pool) &&
                 pool->cur_threads > pool->min_threads) {
                 /* Timed out + no work to do + no need for warm threads = exit.  */
                 break;
@@ -103,8 +125,16 @@ static void *worker_thread(void *opaque)
             continue;
         }
 
-        req = QTAILQ_FIRST(&pool->request_list);
-        QTAILQ_REMOVE(&pool->request_list, req, reqs);
+        QTAILQ_REMOVE(&pool->request_list[req->prio], req, reqs);
+        pool->nr_queued--;
+        pool->nr_requests++;
+        pool->wait_ns += qemu_clock_get_ns(QEMU_CLOCK_REALTIME) -
+                         req->submit_ns;
+        /* req may be freed once its state is THREAD_DONE */
+        prio = req->prio;
+        if (prio == THREAD_POOL_PRIO_BULK) {
+            pool->active_bulk++;
+        }
         req->state = THREAD_ACTIVE;
         qemu_mutex_unlock(&pool->lock);
 
@@ -117,6 +147,9 @@ static void *worker_thread(void *opaque)
 
         qemu_bh_schedule(pool->completion_bh);
         qemu_mutex_lock(&pool->lock);
+        if (prio == THREAD_POOL_PRIO_BULK) {
+            pool->active_bulk--;
+        }
     }
 
     pool->cur_threads--;
@@ -224,7 +257,8 @@ static void thread_pool_cancel(BlockAIOCB *acb)
 
     QEMU_LOCK_GUARD(&pool->lock);
     if (elem->state == THREAD_QUEUED) {
-        QTAILQ_REMOVE(&pool->request_list, elem, reqs);
+        QTAILQ_REMOVE(&pool->request_list[elem->prio], elem, reqs);
+        pool->nr_queued--;
         qemu_bh_schedule(pool->completion_bh);
 
         elem->state = THREAD_DONE;
@@ -238,8 +272,9 @@ static const AIOCBInfo thread_pool_aiocb_info = {
     .cancel_async       = thread_pool_cancel,
 };
 
-BlockAIOCB *thread_pool_submit_aio(ThreadPoolFunc *func, void *arg,
-                                   BlockCompletionFunc *cb, void *opaque)
+BlockAIOCB *thread_pool_submit_aio_prio(ThreadPoolFunc *func, void *arg,
+                                        ThreadPoolPrio prio,
+                                        BlockCompletionFunc *cb, void *opaque)
 {
     ThreadPoolElementAio *req;
     AioContext *ctx = qemu_get_current_aio_context();
@@ -253,6 +288,8 @@ BlockAIOCB *thread_pool_submit_aio(ThreadPoolFunc *func, void *arg,
     req->arg = arg;
     req->state = THREAD_QUEUED;
     req->pool = pool;
+    req->prio = prio;
+    req->submit_ns = qemu_clock_get_ns(QEMU_CLOCK_REALTIME);
 
     QLIST_INSERT_HEAD(&pool->head, req, all);
 
@@ -262,12 +299,20 @@ BlockAIOCB *thread_pool_submit_aio(ThreadPoolFunc *func, void *arg,
     if (pool->idle_threads == 0 && pool->cur_threads < pool->max_threads) {
         spawn_thread(pool);
     }
-    QTAILQ_INSERT_TAIL(&pool->request_list, req, reqs);
+    QTAILQ_INSERT_TAIL(&pool->request_list[prio], req, reqs);
+    pool->nr_queued++;
     qemu_mutex_unlock(&pool->lock);
     qemu_cond_signal(&pool->request_cond);
     return &req->common;
 }
 
+BlockAIOCB *thread_pool_submit_aio(ThreadPoolFunc *func, void *arg,
+                                   BlockCompletionFunc *cb, void *opaque)
+{
+    return thread_pool_submit_aio_prio(func, arg, THREAD_POOL_PRIO_NORMAL,
+                                       cb, opaque);
+}
+
 typedef struct ThreadPoolCo {
     Coroutine *co;
     int ret;
@@ -281,15 +326,32 @@ static void thread_pool_co_cb(void *opaque, int ret)
     aio_co_wake(co->co);
 }
 
-int coroutine_fn thread_pool_submit_co(ThreadPoolFunc *func, void *arg)
+int coroutine_fn thread_pool_submit_co_prio(ThreadPoolFunc *func, void *arg,
+                                            ThreadPoolPrio prio)
 {
     ThreadPoolCo tpc = { .co = qemu_coroutine_self(), .ret = -EINPROGRESS };
     assert(qemu_in_coroutine());
-    thread_pool_submit_aio(func, arg, thread_pool_co_cb, &tpc);
+    thread_pool_submit_aio_prio(func, arg, prio, thread_pool_co_cb, &tpc);
     qemu_coroutine_yield();
     return tpc.ret;
 }
 
+int coroutine_fn thread_pool_submit_co(ThreadPoolFunc *func, void *arg)
+{
+    return thread_pool_submit_co_prio(func, arg, THREAD_POOL_PRIO_NORMAL);
+}
+
+void thread_pool_get_stats(ThreadPoolAio *pool, ThreadPoolStats *stats)
+{
+    QEMU_LOCK_GUARD(&pool->lock);
+
+    *stats = (ThreadPoolStats) {
+        .requests   = pool->nr_requests,
+        .wait_ns    = pool->wait_ns,
+        .queued     = pool->nr_queued,
+    };
+}
+
 void thread_pool_update_params(ThreadPoolAio *pool, AioContext *ctx)
 {
     qemu_mutex_lock(&pool->lock);
@@ -332,7 +394,9 @@ static void thread_pool_init_one(ThreadPoolAio *pool, AioContext *ctx)
     pool->new_thread_bh = aio_bh_new(ctx, spawn_thread_bh_fn, pool);
 
     QLIST_INIT(&pool->head);
-    QTAILQ_INIT(&pool->request_list);
+    for (int i = 0; i < THREAD_POOL_PRIO__MAX; i++) {
+        QTAILQ_INIT(&pool->request_list[i]);
+    }
 
     thread_pool_update_params(pool, ctx);
 }
@@ -23,6 +23,7 @@
  */
 
 #include "qemu/osdep.h"
+#include <math.h>
 #include "qapi/error.h"
 #include "qemu/throttle.h"
 #include "qemu/timer.h"
@@ -462,6 +463,29 @@ bool throttle_schedule_timer(ThrottleState *ts,
     return true;
 }
 
+static const BucketType bucket_types_size[THROTTLE_MAX][2] = {
+    { THROTTLE_BPS_TOTAL, THROTTLE_BPS_READ },
+    { THROTTLE_BPS_TOTAL, THROTTLE_BPS_WRITE }
+};
+static const BucketType bucket_types_units[THROTTLE_MAX][2] = {
+    { THROTTLE_OPS_TOTAL, THROTTLE_OPS_READ },
+    { THROTTLE_OPS_TOTAL, THROTTLE_OPS_WRITE }
+};
+
+/* return the number of operations that an I/O of @size bytes counts for
+ *
+ * @size: the size of the I/O in bytes
+ * @ret:  the number of operations
+ */
+double throttle_units(ThrottleState *ts, uint64_t size)
+{
+    /* if cfg.op_size is defined and smaller than size we compute unit count */
+    if (ts->cfg.op_size && size > ts->cfg.op_size) {
+        return (double) size / ts->cfg.op_size;
+    }
+    return 1.0;
+}
+
 /* do the accounting for this operation
  *
  * @direction: throttle direction
@@ -470,22 +494,21 @@ bool throttle_schedule_timer(ThrottleState *ts,
 void throttle_account(ThrottleState *ts, ThrottleDirection direction,
                       uint64_t size)
 {
-    static const BucketType bucket_types_size[THROTTLE_MAX][2] = {
-        { THROTTLE_BPS_TOTAL, THROTTLE_BPS_READ },
-        { THROTTLE_BPS_TOTAL, THROTTLE_BPS_WRITE }
-    };
-    static const BucketType bucket_types_units[THROTTLE_MAX][2] = {
-        { THROTTLE_OPS_TOTAL, THROTTLE_OPS_READ },
-        { THROTTLE_OPS_TOTAL, THROTTLE_OPS_WRITE }
-    };
-    double units = 1.0;
+    throttle_account_units(ts, direction, throttle_units(ts, size), size);
+}
+
+/* do the accounting for operations that were already converted to units
+ *
+ * @direction: throttle direction
+ * @units:     the number of operations, as returned by throttle_units()
+ * @size:      the size of the operations in bytes
+ */
+void throttle_account_units(ThrottleState *ts, ThrottleDirection direction,
+                            double units, uint64_t size)
+{
     unsigned i;
 
     assert(direction < THROTTLE_MAX);
-    /* if cfg.op_size is defined and smaller than size we compute unit count */
-    if (ts->cfg.op_size && size > ts->cfg.op_size) {
-        units = (double) size / ts->cfg.op_size;
-    }
 
     for (i = 0; i < ARRAY_SIZE(bucket_types_size[THROTTLE_READ]); i++) {
         LeakyBucket *bkt;
@@ -504,6 +527,43 @@ void throttle_account(ThrottleState *ts, ThrottleDirection direction,
     }
 }
 
+/* compute how much I/O the average limits allow in a period of time
+ *
+ * Bursts are not taken into account.  Dimensions that are not limited
+ * are returned as INFINITY and UINT64_MAX respectively.
+ *
+ * @direction: throttle direction
+ * @ns:        the length of the period in nanoseconds
+ * @units:     the number of operations is written here
+ * @size:      the number of bytes is written here
+ */
+void throttle_allowance(ThrottleState *ts, ThrottleDirection direction,
+                        int64_t ns, double *units, uint64_t *size)
+{
+    double seconds = (double) ns / NANOSECONDS_PER_SECOND;
+    double bytes = INFINITY;
+    unsigned i;
+
+    assert(direction < THROTTLE_MAX);
+    *units = INFINITY;
+
+    for (i = 0; i < ARRAY_SIZE(bucket_types_size[THROTTLE_READ]); i++) {
+        LeakyBucket *bkt;
+
+        bkt = &ts->cfg.buckets[bucket_types_size[direction][i]];
+        if (bkt->avg) {
+            bytes = MIN(bytes, bkt->avg * seconds);
+        }
+
+        bkt = &ts->cfg.buckets[bucket_types_units[direction][i]];
+        if (bkt->avg) {
+            *units = MIN(*units, bkt->avg * seconds);
+        }
+    }
+
+    *size = bytes < (double) UINT64_MAX ? (uint64_t) bytes : UINT64_MAX;
+}
+
 /* return a ThrottleConfig based on the options in a ThrottleLimits
  *
  * @arg:    the ThrottleLimits object to read from
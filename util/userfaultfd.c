@@ -269,6 +269,39 @@ int uffd_copy_page(int uffd_fd, void *dst_addr, void *src_addr,
     return 0;
 }
 
+/**
+ * uffd_continue_page: map range of pages already in the page cache via UFFD-IO
+ *
+ * Install the page cache pages of the range to resolve the minor page
+ * faults somewhere in the range.
+ *
+ * Returns 0 on success, -errno in case of an error
+ *
+ * @uffd_fd: UFFD file descriptor
+ * @addr: base address
+ * @length: length of the range to map
+ * @dont_wake: do not wake threads waiting on the pages
+ */
+int uffd_continue_page(int uffd_fd, void *addr, uint64_t length,
+        bool dont_wake)
+{
+    struct uffdio_continue uffd_continue;
+
+    uffd_continue.range.start = (uintptr_t) addr;
+    uffd_continue.range.len = length;
+    uffd_continue.mode = dont_wake ? UFFDIO_CONTINUE_MODE_DONTWAKE : 0;
+
+    if (ioctl(uffd_fd, UFFDIO_CONTINUE, &uffd_continue)) {
+        int e = errno;
+        error_report("uffd_continue_page() failed: addr=%p length=%" PRIu64
+                " mode=%" PRIx64 " errno=%i", addr, length,
+                (uint64_t) uffd_continue.mode, e);
+        return -e;
+    }
+
+    return 0;
+}
+
 /**
  * uffd_zero_page: fill range of pages with zeroes via UFFD-IO
  *
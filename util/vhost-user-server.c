@@ -27,7 +27,9 @@
  * protocol messages over the UNIX domain socket.
  *
  * When virtqueues are set up libvhost-user calls set_watch() to monitor kick
- * fds. These fds are also handled in the VuServer->ctx AioContext.
+ * fds. These fds are also handled in the VuServer->ctx AioContext. With
+ * VuServer->poll_queues, the virtqueue rings are additionally polled whenever
+ * the AioContext busy-polls, and the driver is asked not to kick meanwhile.
  *
  * Both vu_client_trip() and kick fd monitoring can be stopped by shutting down
  * the socket connection. Shutting down the socket connection causes
@@ -278,6 +280,64 @@ static void kick_handler(void *opaque)
     }
 }
 
+static bool kick_poll(void *opaque)
+{
+    VuFdWatch *vu_fd_watch = opaque;
+    VuDev *vu_dev = vu_fd_watch->vu_dev;
+    VuVirtq *vq = vu_fd_watch->vq;
+
+    return !vu_dev->broken && vq->handler && vu_queue_started(vu_dev, vq) &&
+           !vu_queue_empty(vu_dev, vq);
+}
+
+/* Like kick_handler(), but without a kick to consume */
+static void kick_poll_ready(void *opaque)
+{
+    VuFdWatch *vu_fd_watch = opaque;
+    VuDev *vu_dev = vu_fd_watch->vu_dev;
+    VuVirtq *vq = vu_fd_watch->vq;
+
+    if (vq->handler) {
+        vq->handler(vu_dev, vq - vu_dev->vq);
+    }
+
+    if (vu_dev->broken) {
+        VuServer *server = container_of(vu_dev, VuServer, vu_dev);
+
+        qio_channel_shutdown(server->ioc, QIO_CHANNEL_SHUTDOWN_BOTH, NULL);
+    }
+}
+
+static void kick_poll_begin(void *opaque)
+{
+    VuFdWatch *vu_fd_watch = opaque;
+
+    if (vu_queue_started(vu_fd_watch->vu_dev, vu_fd_watch->vq)) {
+        vu_queue_set_notification(vu_fd_watch->vu_dev, vu_fd_watch->vq, 0);
+    }
+}
+
+static void kick_poll_end(void *opaque)
+{
+    VuFdWatch *vu_fd_watch = opaque;
+
+    if (vu_queue_started(vu_fd_watch->vu_dev, vu_fd_watch->vq)) {
+        vu_queue_set_notification(vu_fd_watch->vu_dev, vu_fd_watch->vq, 1);
+    }
+}
+
+static void set_vu_fd_watch_handler(AioContext *ctx, VuFdWatch *vu_fd_watch)
+{
+    if (vu_fd_watch->vq) {
+        aio_set_fd_handler(ctx, vu_fd_watch->fd, kick_handler, NULL,
+                           kick_poll, kick_poll_ready, vu_fd_watch);
+        aio_set_fd_poll(ctx, vu_fd_watch->fd, kick_poll_begin, kick_poll_end);
+    } else {
+        aio_set_fd_handler(ctx, vu_fd_watch->fd, kick_handler, NULL,
+                           NULL, NULL, vu_fd_watch);
+    }
+}
+
 static VuFdWatch *find_vu_fd_watch(VuServer *server, int fd)
 {
 
@@ -303,18 +363,26 @@ set_watch(VuDev *vu_dev, int fd, int vu_evt,
     VuFdWatch *vu_fd_watch = find_vu_fd_watch(server, fd);
 
     if (!vu_fd_watch) {
+        intptr_t qidx = (intptr_t)pvt;
+
         vu_fd_watch = g_new0(VuFdWatch, 1);
 
         QTAILQ_INSERT_TAIL(&server->vu_fd_watches, vu_fd_watch, next);
 
         vu_fd_watch->fd = fd;
         vu_fd_watch->cb = cb;
-        /* TODO: handle error more gracefully than aborting */
-        qemu_set_blocking(fd, false, &error_abort);
-        aio_set_fd_handler(server->ctx, fd, kick_handler,
-                           NULL, NULL, NULL, vu_fd_watch);
         vu_fd_watch->vu_dev = vu_dev;
         vu_fd_watch->pvt = pvt;
+
+        /* Kick fd watches carry the virtqueue index as @pvt */
+        if (server->poll_queues && qidx >= 0 && qidx < vu_dev->max_queues &&
+            vu_dev->vq[qidx].kick_fd == fd) {
+            vu_fd_watch->vq = &vu_dev->vq[qidx];
+        }
+
+        /* TODO: handle error more gracefully than aborting */
+        qemu_set_blocking(fd, false, &error_abort);
+        set_vu_fd_watch_handler(server->ctx, vu_fd_watch);
     }
 }
 
@@ -436,8 +504,7 @@ void vhost_user_server_attach_aio_context(VuServer *server, AioContext *ctx)
     }
 
     QTAILQ_FOREACH(vu_fd_watch, &server->vu_fd_watches, next) {
-        aio_set_fd_handler(ctx, vu_fd_watch->fd, kick_handler, NULL,
-                           NULL, NULL, vu_fd_watch);
+        set_vu_fd_watch_handler(ctx, vu_fd_watch);
     }
 
     if (server->co_trip) {
@@ -487,6 +554,7 @@ bool vhost_user_server_start(VuServer *server,
                              SocketAddress *socket_addr,
                              AioContext *ctx,
                              uint16_t max_queues,
+                             bool poll_queues,
                              const VuDevIface *vu_iface,
                              Error **errp)
 {
@@ -514,6 +582,7 @@ bool vhost_user_server_start(VuServer *server,
         .restart_listener_bh   = bh,
         .vu_iface              = vu_iface,
         .max_queues            = max_queues,
+        .poll_queues           = poll_queues,
         .ctx                   = ctx,
     };
 